@@ -1,6 +1,3 @@
-Texture2D diffuseTexture : register(t0);
-SamplerState textureSampler : register(s0);
-
 cbuffer LightBuffer : register(b1) {
     float3 LightDirection;
     float LightIntensity;
@@ -8,18 +5,35 @@ cbuffer LightBuffer : register(b1) {
     float AmbientIntensity;
 }
 
+// Froxel grid built on the CPU by ClusteredLighting
+cbuffer ClusterBuffer : register(b2) {
+    uint TilesX;
+    uint TilesY;
+    uint Slices;
+    uint LightCount;
+    float2 TilesPerPixel;
+    float SliceScale;
+    float SliceBias;
+}
+
+struct PointLight {
+    float4 PositionRadius;   // View space
+    float4 ColorIntensity;
+};
+
+StructuredBuffer<PointLight> Lights : register(t0);
+StructuredBuffer<uint2> Clusters : register(t1);      // Offset and count into LightIndices
+StructuredBuffer<uint> LightIndices : register(t2);
+
 struct PS_INPUT {
     float4 Position : SV_POSITION;
     float4 Color : COLOR;
     float3 Normal : NORMAL;
-    float2 TexCoord : TEXCOORD;
-    float3 WorldPos : POSITION;
+    float3 ViewPos : POSITION;
+    float3 ViewNormal : TEXCOORD0;
 };
 
 float4 main(PS_INPUT input) : SV_Target {
-    // Sample texture
-    float4 textureColor = diffuseTexture.Sample(textureSampler, input.TexCoord);
-    
     // Normalize vectors for lighting calculation
     float3 normal = normalize(input.Normal);
     float3 lightDir = normalize(-LightDirection);
@@ -27,10 +41,28 @@ float4 main(PS_INPUT input) : SV_Target {
     // Calculate diffuse lighting
     float diffuseFactor = max(dot(normal, lightDir), 0.0f) * LightIntensity;
     
-    // Combine lighting with texture and vertex color
-    float4 finalColor = textureColor * input.Color;
+    // Find this pixel's cluster: screen tile, then exponential depth slice
+    uint2 tile = min(uint2(input.Position.xy * TilesPerPixel), uint2(TilesX - 1, TilesY - 1));
+    float sliceIndex = floor(log(max(input.ViewPos.z, 1e-4f)) * SliceScale + SliceBias);
+    uint slice = (uint)clamp(sliceIndex, 0.0f, (float)(Slices - 1));
+    uint2 cluster = Clusters[(slice * TilesY + tile.y) * TilesX + tile.x];
+    
+    // Only the lights binned into this cluster are evaluated
+    float3 viewNormal = normalize(input.ViewNormal);
+    float3 pointLighting = float3(0.0f, 0.0f, 0.0f);
+    for (uint i = 0; i < cluster.y; ++i) {
+        PointLight light = Lights[LightIndices[cluster.x + i]];
+        float3 toLight = light.PositionRadius.xyz - input.ViewPos;
+        float distance = length(toLight);
+        float falloff = saturate(1.0f - distance / light.PositionRadius.w);
+        float lambert = max(dot(viewNormal, toLight / max(distance, 1e-4f)), 0.0f);
+        pointLighting += light.ColorIntensity.rgb * (light.ColorIntensity.w * falloff * falloff * lambert);
+    }
+    
+    // Combine lighting with vertex color
+    float4 finalColor = input.Color;
     float3 ambient = AmbientColor * AmbientIntensity;
-    float3 diffuse = finalColor.rgb * diffuseFactor;
+    float3 diffuse = finalColor.rgb * (diffuseFactor + pointLighting);
     
     // Final color with lighting
     float3 color = ambient + diffuse;
@@ -0,0 +1,28 @@
+// Generated from SceneVertexLayout in src/VertexFormats.h by VertexLayoutCheck --write; do not edit
+
+struct VertexInput {
+    float3 Position : POSITION;
+    float4 Color : COLOR;
+    float2 Normal : NORMAL;
+};
+
+struct VertexAttributes {
+    float4 Position;
+    float4 Color;
+    float3 Normal;
+};
+
+float3 DecodeOctahedral(float2 e) {
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+VertexAttributes DecodeVertex(VertexInput input) {
+    VertexAttributes output;
+    output.Position = float4(input.Position, 1.0f);
+    output.Color = input.Color;
+    output.Normal = DecodeOctahedral(input.Normal);
+    return output;
+}
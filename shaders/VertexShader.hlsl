@@ -1,43 +1,40 @@
+// VertexInput, VertexAttributes and DecodeVertex for the scene vertex format
+#include "VertexLayout.hlsli"
+
 cbuffer ConstantBuffer : register(b0) {
     matrix World;
     matrix View;
     matrix Projection;
 }
 
-struct VS_INPUT {
-    float4 Position : POSITION;
-    float4 Color : COLOR;
-    float3 Normal : NORMAL;
-    float2 TexCoord : TEXCOORD;
-};
-
 struct VS_OUTPUT {
     float4 Position : SV_POSITION;
     float4 Color : COLOR;
     float3 Normal : NORMAL;
-    float2 TexCoord : TEXCOORD;
-    float3 WorldPos : POSITION;
+    float3 ViewPos : POSITION;
+    float3 ViewNormal : TEXCOORD0;
 };
 
-VS_OUTPUT main(VS_INPUT input) {
+VS_OUTPUT main(VertexInput packed) {
+    VertexAttributes input = DecodeVertex(packed);
     VS_OUTPUT output;
     
     // Transform position from object space to world space
     float4 worldPosition = mul(input.Position, World);
     
     // Transform to view space, then projection space
-    output.Position = mul(worldPosition, View);
-    output.Position = mul(output.Position, Projection);
+    float4 viewPosition = mul(worldPosition, View);
+    output.Position = mul(viewPosition, Projection);
     
-    // Transform normal to world space
+    // Transform normal to world space for the directional light
     output.Normal = mul(input.Normal, (float3x3)World);
     
-    // Pass through color and texture coordinates
-    output.Color = input.Color;
-    output.TexCoord = input.TexCoord;
+    // Point lights are binned and shaded in view space
+    output.ViewPos = viewPosition.xyz;
+    output.ViewNormal = mul(output.Normal, (float3x3)View);
     
-    // Store world position for lighting calculations
-    output.WorldPos = worldPosition.xyz;
+    // Pass through color
+    output.Color = input.Color;
     
     return output;
 }
@@ -0,0 +1,238 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace {
+
+constexpr size_t TAG_COUNT = static_cast<size_t>(MemoryTag::Count);
+
+struct TagCounters {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> bytesAllocated;
+    std::atomic<uint64_t> bytesFreed;
+};
+
+// Static storage is zeroed before any constructor runs, so allocations made
+// during static initialization are counted safely
+TagCounters g_counters[TAG_COUNT];
+std::atomic<uint64_t> g_violations;
+AllocationTracker::FrameStats g_frameStart;
+AllocationTracker::FrameStats g_lastFrame;
+
+// Trivially initialized, so reading them inside operator new never allocates
+thread_local MemoryTag t_tag = MemoryTag::Untagged;
+thread_local uint32_t t_noAllocationDepth = 0;
+
+const char* const TAG_NAMES[TAG_COUNT] = { "untagged", "render", "culling", "lighting", "world", "ui", "jobs", "audio", "physics" };
+
+void Snapshot(AllocationTracker::FrameStats& stats) {
+    stats = {};
+    for (size_t i = 0; i < TAG_COUNT; ++i) {
+        AllocationTracker::TagStats& tag = stats.tags[i];
+        tag.allocations = g_counters[i].allocations.load(std::memory_order_relaxed);
+        tag.frees = g_counters[i].frees.load(std::memory_order_relaxed);
+        tag.bytesAllocated = g_counters[i].bytesAllocated.load(std::memory_order_relaxed);
+        tag.bytesFreed = g_counters[i].bytesFreed.load(std::memory_order_relaxed);
+        stats.allocations += tag.allocations;
+        stats.bytesAllocated += tag.bytesAllocated;
+    }
+    stats.violations = g_violations.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+bool AllocationTracker::IsEnabled() {
+#if defined(FPSGAME_TRACK_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::BeginFrame() {
+    Snapshot(g_frameStart);
+}
+
+const AllocationTracker::FrameStats& AllocationTracker::EndFrame() {
+    FrameStats end;
+    Snapshot(end);
+
+    g_lastFrame = {};
+    for (size_t i = 0; i < TAG_COUNT; ++i) {
+        TagStats& tag = g_lastFrame.tags[i];
+        tag.allocations = end.tags[i].allocations - g_frameStart.tags[i].allocations;
+        tag.frees = end.tags[i].frees - g_frameStart.tags[i].frees;
+        tag.bytesAllocated = end.tags[i].bytesAllocated - g_frameStart.tags[i].bytesAllocated;
+        tag.bytesFreed = end.tags[i].bytesFreed - g_frameStart.tags[i].bytesFreed;
+    }
+    g_lastFrame.allocations = end.allocations - g_frameStart.allocations;
+    g_lastFrame.bytesAllocated = end.bytesAllocated - g_frameStart.bytesAllocated;
+    g_lastFrame.violations = end.violations - g_frameStart.violations;
+    return g_lastFrame;
+}
+
+const AllocationTracker::FrameStats& AllocationTracker::GetLastFrame() {
+    return g_lastFrame;
+}
+
+AllocationTracker::TagStats AllocationTracker::GetTotals(MemoryTag tag) {
+    const TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    TagStats stats;
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.frees = counters.frees.load(std::memory_order_relaxed);
+    stats.bytesAllocated = counters.bytesAllocated.load(std::memory_order_relaxed);
+    stats.bytesFreed = counters.bytesFreed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t AllocationTracker::GetLiveBytes(MemoryTag tag) {
+    TagStats stats = GetTotals(tag);
+    return stats.bytesAllocated - stats.bytesFreed;
+}
+
+uint64_t AllocationTracker::GetViolations() {
+    return g_violations.load(std::memory_order_relaxed);
+}
+
+const char* AllocationTracker::GetTagName(MemoryTag tag) {
+    size_t index = static_cast<size_t>(tag);
+    return index < TAG_COUNT ? TAG_NAMES[index] : "invalid";
+}
+
+MemoryTag AllocationTracker::GetThreadTag() {
+    return t_tag;
+}
+
+void AllocationTracker::SetThreadTag(MemoryTag tag) {
+    t_tag = tag;
+}
+
+void AllocationTracker::RecordAllocation(size_t size, MemoryTag tag) {
+    TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+    if (t_noAllocationDepth > 0) {
+        g_violations.fetch_add(1, std::memory_order_relaxed);
+#if defined(FPSGAME_STRICT_ALLOCATIONS)
+        fprintf(stderr, "Heap allocation of %zu bytes (%s) inside a NoAllocationScope\n", size, GetTagName(tag));
+        abort();
+#endif
+    }
+}
+
+void AllocationTracker::RecordFree(size_t size, MemoryTag tag) {
+    TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesFreed.fetch_add(size, std::memory_order_relaxed);
+}
+
+NoAllocationScope::NoAllocationScope() {
+    t_noAllocationDepth++;
+}
+
+NoAllocationScope::~NoAllocationScope() {
+    t_noAllocationDepth--;
+}
+
+#if defined(FPSGAME_TRACK_ALLOCATIONS)
+
+namespace {
+
+// Sits just before every tracked block so frees can be charged to the allocating tag
+struct alignas(16) AllocationHeader {
+    uint64_t size;
+    uint32_t offset;  // From the start of the underlying block to the user pointer
+    uint8_t tag;
+};
+constexpr size_t HEADER_SIZE = sizeof(AllocationHeader);
+static_assert(HEADER_SIZE == 16, "Allocation header must keep the default new alignment");
+
+void* TrackedAllocate(size_t size, size_t alignment) {
+    MemoryTag tag = t_tag;
+    size_t offset = alignment > HEADER_SIZE ? alignment : HEADER_SIZE;
+
+    void* base;
+    if (offset > HEADER_SIZE) {
+#if defined(_MSC_VER)
+        base = _aligned_malloc(size + offset, alignment);
+#else
+        base = std::aligned_alloc(alignment, (size + offset + alignment - 1) & ~(alignment - 1));
+#endif
+    } else {
+        base = std::malloc(size + offset);
+    }
+    if (!base) return nullptr;
+
+    uint8_t* pointer = static_cast<uint8_t*>(base) + offset;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(pointer) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->tag = static_cast<uint8_t>(tag);
+    AllocationTracker::RecordAllocation(size, tag);
+    return pointer;
+}
+
+void* TrackedAllocateOrThrow(size_t size, size_t alignment) {
+    void* pointer = TrackedAllocate(size, alignment);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void TrackedFree(void* pointer) {
+    if (!pointer) return;
+
+    AllocationHeader* header = static_cast<AllocationHeader*>(pointer) - 1;
+    AllocationTracker::RecordFree(static_cast<size_t>(header->size), static_cast<MemoryTag>(header->tag));
+    void* base = static_cast<uint8_t*>(pointer) - header->offset;
+    if (header->offset > HEADER_SIZE) {
+#if defined(_MSC_VER)
+        _aligned_free(base);
+#else
+        std::free(base);
+#endif
+    } else {
+        std::free(base);
+    }
+}
+
+} // namespace
+
+void* operator new(size_t size) { return TrackedAllocateOrThrow(size, HEADER_SIZE); }
+void* operator new[](size_t size) { return TrackedAllocateOrThrow(size, HEADER_SIZE); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size, HEADER_SIZE); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size, HEADER_SIZE); }
+void* operator new(size_t size, std::align_val_t alignment) {
+    return TrackedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return TrackedAllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return TrackedAllocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return TrackedAllocate(size, static_cast<size_t>(alignment));
+}
+
+// The header records the alignment, so every form of delete frees the same way
+void operator delete(void* pointer) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { TrackedFree(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(pointer); }
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Subsystem an allocation is charged to; set per thread with MemoryTagScope
+enum class MemoryTag : uint8_t {
+    Untagged,
+    Render,
+    Culling,
+    Lighting,
+    World,
+    UI,
+    Jobs,
+    Audio,
+    Physics,
+    Count
+};
+
+// Counts every global operator new and delete by the calling thread's memory
+// tag. Requires building with FPSGAME_TRACK_ALLOCATIONS, which replaces the
+// global allocation functions; without it every count stays zero.
+//
+// BeginFrame and EndFrame bracket a frame on the main thread; EndFrame returns
+// what was allocated in between on any thread. Allocations made inside a
+// NoAllocationScope are counted as violations, and abort immediately when
+// FPSGAME_STRICT_ALLOCATIONS is also defined.
+class AllocationTracker {
+public:
+    struct TagStats {
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t bytesAllocated;
+        uint64_t bytesFreed;
+    };
+
+    struct FrameStats {
+        TagStats tags[static_cast<size_t>(MemoryTag::Count)];
+        uint64_t allocations;     // All tags
+        uint64_t bytesAllocated;
+        uint64_t violations;      // Allocations inside a NoAllocationScope
+    };
+
+    static bool IsEnabled();
+
+    static void BeginFrame();
+    static const FrameStats& EndFrame();
+    static const FrameStats& GetLastFrame();
+
+    // Since startup
+    static TagStats GetTotals(MemoryTag tag);
+    static uint64_t GetLiveBytes(MemoryTag tag);
+    static uint64_t GetViolations();
+
+    static const char* GetTagName(MemoryTag tag);
+
+    static MemoryTag GetThreadTag();
+    static void SetThreadTag(MemoryTag tag);
+
+    // Called by the replaced allocation functions
+    static void RecordAllocation(size_t size, MemoryTag tag);
+    static void RecordFree(size_t size, MemoryTag tag);
+};
+
+// Charges allocations on this thread to a subsystem until destroyed
+class MemoryTagScope {
+public:
+    explicit MemoryTagScope(MemoryTag tag) : m_previous(AllocationTracker::GetThreadTag()) {
+        AllocationTracker::SetThreadTag(tag);
+    }
+    ~MemoryTagScope() { AllocationTracker::SetThreadTag(m_previous); }
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+private:
+    MemoryTag m_previous;
+};
+
+// Marks code on this thread that must not reach the heap
+class NoAllocationScope {
+public:
+    NoAllocationScope();
+    ~NoAllocationScope();
+
+    NoAllocationScope(const NoAllocationScope&) = delete;
+    NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+};
@@ -0,0 +1,424 @@
+#include "AnimationClip.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float ROTATION_RANGE = 0.70710678f;  // The three smallest components of a unit quaternion lie within +-1/sqrt(2)
+const float ROTATION_STEPS = 32767.0f;
+const float RANGE_STEPS = 65535.0f;
+
+// Smallest three: the largest component is dropped and rebuilt from the others,
+// with the quaternion negated if needed so the dropped one is positive
+void EncodeRotation(const Float4& rotation, uint16_t* encoded) {
+    const float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i) {
+        if (fabsf(components[i]) > fabsf(components[largest])) largest = i;
+    }
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint16_t values[3];
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (i == largest) continue;
+        float normalized = (components[i] * sign + ROTATION_RANGE) / (2.0f * ROTATION_RANGE);
+        normalized = (std::min)((std::max)(normalized, 0.0f), 1.0f);
+        values[written++] = static_cast<uint16_t>(lroundf(normalized * ROTATION_STEPS));
+    }
+    encoded[0] = static_cast<uint16_t>(values[0] | ((largest & 1) << 15));
+    encoded[1] = static_cast<uint16_t>(values[1] | ((largest >> 1) << 15));
+    encoded[2] = values[2];
+}
+
+Float4 DecodeRotation(const uint16_t* encoded) {
+    uint32_t largest = (encoded[0] >> 15) | ((encoded[1] >> 15) << 1);
+    float components[4];
+    float sum = 0.0f;
+    uint32_t read = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (i == largest) continue;
+        float value = (encoded[read++] & 0x7fff) / ROTATION_STEPS * (2.0f * ROTATION_RANGE) - ROTATION_RANGE;
+        components[i] = value;
+        sum += value * value;
+    }
+    components[largest] = sqrtf((std::max)(0.0f, 1.0f - sum));
+    return { components[0], components[1], components[2], components[3] };
+}
+
+uint16_t EncodeRange(float value, float minimum, float extent) {
+    if (extent <= 0.0f) return 0;
+    float normalized = (std::min)((std::max)((value - minimum) / extent, 0.0f), 1.0f);
+    return static_cast<uint16_t>(lroundf(normalized * RANGE_STEPS));
+}
+
+float DecodeRange(uint16_t encoded, float minimum, float extent) {
+    return minimum + encoded / RANGE_STEPS * extent;
+}
+
+// One channel of a joint transform: rotation xyzw, translation xyz or scale
+void GetChannelValue(const JointTransform& transform, uint32_t channel, float* value) {
+    if (channel == 0) {
+        value[0] = transform.rotation.x;
+        value[1] = transform.rotation.y;
+        value[2] = transform.rotation.z;
+        value[3] = transform.rotation.w;
+    } else if (channel == 1) {
+        value[0] = transform.translation.x;
+        value[1] = transform.translation.y;
+        value[2] = transform.translation.z;
+    } else {
+        value[0] = transform.scale;
+    }
+}
+
+// Same interpolation the runtime uses: nlerp along the shorter arc, lerp otherwise
+void Interpolate(uint32_t channel, const float* a, const float* b, float alpha, float* result) {
+    if (channel == 0) {
+        float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        float sign = dot < 0.0f ? -1.0f : 1.0f;
+        float lengthSquared = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            result[i] = a[i] + (b[i] * sign - a[i]) * alpha;
+            lengthSquared += result[i] * result[i];
+        }
+        float inverseLength = 1.0f / sqrtf(lengthSquared);
+        for (int i = 0; i < 4; ++i) {
+            result[i] *= inverseLength;
+        }
+    } else {
+        uint32_t components = channel == 1 ? 3 : 1;
+        for (uint32_t i = 0; i < components; ++i) {
+            result[i] = a[i] + (b[i] - a[i]) * alpha;
+        }
+    }
+}
+
+// Angle between rotations, distance between translations, difference between scales
+float ChannelError(uint32_t channel, const float* a, const float* b) {
+    if (channel == 0) {
+        float dot = fabsf(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+        return 2.0f * acosf((std::min)(dot, 1.0f));
+    }
+    if (channel == 1) {
+        float x = a[0] - b[0], y = a[1] - b[1], z = a[2] - b[2];
+        return sqrtf(x * x + y * y + z * z);
+    }
+    return fabsf(a[0] - b[0]);
+}
+
+Float4x4 InverseAffine(const Float4x4& m) {
+    // Inverse of the upper 3x3 from cofactors, then the translation moved through it
+    float c00 = m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1];
+    float c01 = m.m[1][2] * m.m[2][0] - m.m[1][0] * m.m[2][2];
+    float c02 = m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0];
+    float determinant = m.m[0][0] * c00 + m.m[0][1] * c01 + m.m[0][2] * c02;
+    float inverse = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+    Float4x4 result = Float4x4::Identity();
+    result.m[0][0] = c00 * inverse;
+    result.m[1][0] = c01 * inverse;
+    result.m[2][0] = c02 * inverse;
+    result.m[0][1] = (m.m[0][2] * m.m[2][1] - m.m[0][1] * m.m[2][2]) * inverse;
+    result.m[1][1] = (m.m[0][0] * m.m[2][2] - m.m[0][2] * m.m[2][0]) * inverse;
+    result.m[2][1] = (m.m[0][1] * m.m[2][0] - m.m[0][0] * m.m[2][1]) * inverse;
+    result.m[0][2] = (m.m[0][1] * m.m[1][2] - m.m[0][2] * m.m[1][1]) * inverse;
+    result.m[1][2] = (m.m[0][2] * m.m[1][0] - m.m[0][0] * m.m[1][2]) * inverse;
+    result.m[2][2] = (m.m[0][0] * m.m[1][1] - m.m[0][1] * m.m[1][0]) * inverse;
+    for (int col = 0; col < 3; ++col) {
+        result.m[3][col] = -(m.m[3][0] * result.m[0][col] + m.m[3][1] * result.m[1][col] + m.m[3][2] * result.m[2][col]);
+    }
+    return result;
+}
+
+} // namespace
+
+Float4x4 JointMatrix(const JointTransform& transform) {
+    const Float4& q = transform.rotation;
+    const float s = transform.scale;
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    Float4x4 result;
+    result.m[0][0] = (1.0f - 2.0f * (yy + zz)) * s;
+    result.m[0][1] = 2.0f * (xy + wz) * s;
+    result.m[0][2] = 2.0f * (xz - wy) * s;
+    result.m[0][3] = 0.0f;
+    result.m[1][0] = 2.0f * (xy - wz) * s;
+    result.m[1][1] = (1.0f - 2.0f * (xx + zz)) * s;
+    result.m[1][2] = 2.0f * (yz + wx) * s;
+    result.m[1][3] = 0.0f;
+    result.m[2][0] = 2.0f * (xz + wy) * s;
+    result.m[2][1] = 2.0f * (yz - wx) * s;
+    result.m[2][2] = (1.0f - 2.0f * (xx + yy)) * s;
+    result.m[2][3] = 0.0f;
+    result.m[3][0] = transform.translation.x;
+    result.m[3][1] = transform.translation.y;
+    result.m[3][2] = transform.translation.z;
+    result.m[3][3] = 1.0f;
+    return result;
+}
+
+Skeleton::Skeleton() {
+}
+
+bool Skeleton::Initialize(const int32_t* parents, const JointTransform* bindPose, uint32_t jointCount) {
+    if (jointCount == 0) return false;
+    for (uint32_t joint = 0; joint < jointCount; ++joint) {
+        if (parents[joint] < -1 || parents[joint] >= static_cast<int32_t>(joint)) return false;
+    }
+
+    m_parents.assign(parents, parents + jointCount);
+    m_bindPose.assign(bindPose, bindPose + jointCount);
+
+    std::vector<Float4x4> model(jointCount);
+    m_inverseBind.resize(jointCount);
+    for (uint32_t joint = 0; joint < jointCount; ++joint) {
+        Float4x4 local = JointMatrix(bindPose[joint]);
+        model[joint] = parents[joint] < 0 ? local : Multiply(local, model[parents[joint]]);
+        m_inverseBind[joint] = InverseAffine(model[joint]);
+    }
+    return true;
+}
+
+Pose::Pose() :
+    m_jointCount(0),
+    m_capacity(0) {
+}
+
+void Pose::Resize(uint32_t jointCount) {
+    m_jointCount = jointCount;
+    m_capacity = (jointCount + 7) & ~7u;
+    m_data.assign(static_cast<size_t>(m_capacity) * STREAM_COUNT, 0.0f);
+    std::fill_n(GetStream(ROTATION_W), m_capacity, 1.0f);
+    std::fill_n(GetStream(SCALE), m_capacity, 1.0f);
+}
+
+JointTransform Pose::GetJoint(uint32_t joint) const {
+    JointTransform transform;
+    transform.rotation = { GetStream(ROTATION_X)[joint], GetStream(ROTATION_Y)[joint],
+                           GetStream(ROTATION_Z)[joint], GetStream(ROTATION_W)[joint] };
+    transform.translation = { GetStream(TRANSLATION_X)[joint], GetStream(TRANSLATION_Y)[joint],
+                              GetStream(TRANSLATION_Z)[joint] };
+    transform.scale = GetStream(SCALE)[joint];
+    return transform;
+}
+
+void Pose::SetJoint(uint32_t joint, const JointTransform& transform) {
+    GetStream(ROTATION_X)[joint] = transform.rotation.x;
+    GetStream(ROTATION_Y)[joint] = transform.rotation.y;
+    GetStream(ROTATION_Z)[joint] = transform.rotation.z;
+    GetStream(ROTATION_W)[joint] = transform.rotation.w;
+    GetStream(TRANSLATION_X)[joint] = transform.translation.x;
+    GetStream(TRANSLATION_Y)[joint] = transform.translation.y;
+    GetStream(TRANSLATION_Z)[joint] = transform.translation.z;
+    GetStream(SCALE)[joint] = transform.scale;
+}
+
+AnimationClip::AnimationClip() :
+    m_jointCount(0),
+    m_frameCount(0),
+    m_framesPerSecond(30.0f),
+    m_duration(0.0f) {
+    m_channels[CHANNEL_ROTATION].components = 3;
+    m_channels[CHANNEL_TRANSLATION].components = 3;
+    m_channels[CHANNEL_SCALE].components = 1;
+}
+
+bool AnimationClip::Build(const Skeleton& skeleton, const JointTransform* frames, uint32_t frameCount,
+                          float framesPerSecond, const CompressionSettings& settings) {
+    if (skeleton.GetJointCount() == 0 || frameCount == 0 || frameCount > MAX_FRAMES || !(framesPerSecond > 0.0f)) {
+        return false;
+    }
+
+    m_jointCount = skeleton.GetJointCount();
+    m_frameCount = frameCount;
+    m_framesPerSecond = framesPerSecond;
+    m_duration = (frameCount - 1) / framesPerSecond;
+    for (ChannelData& channel : m_channels) {
+        channel.tracks.clear();
+        channel.keyFrames.clear();
+        channel.keyValues.clear();
+    }
+
+    for (uint32_t joint = 0; joint < m_jointCount; ++joint) {
+        BuildTrack(CHANNEL_ROTATION, joint, frames, settings.rotationTolerance);
+        BuildTrack(CHANNEL_TRANSLATION, joint, frames, settings.translationTolerance);
+        BuildTrack(CHANNEL_SCALE, joint, frames, settings.scaleTolerance);
+    }
+    for (ChannelData& channel : m_channels) {
+        channel.keyFrames.shrink_to_fit();
+        channel.keyValues.shrink_to_fit();
+    }
+    return true;
+}
+
+void AnimationClip::BuildTrack(Channel channel, uint32_t joint, const JointTransform* frames, float tolerance) {
+    ChannelData& data = m_channels[channel];
+    const uint32_t components = data.components;
+    auto rawValue = [&](uint32_t frame, float* value) {
+        GetChannelValue(frames[static_cast<size_t>(frame) * m_jointCount + joint], channel, value);
+    };
+
+    // Quantization range over the whole track
+    Track track = {};
+    track.firstKey = static_cast<uint32_t>(data.keyFrames.size());
+    if (channel != CHANNEL_ROTATION) {
+        float minimum[3], maximum[3];
+        rawValue(0, minimum);
+        rawValue(0, maximum);
+        for (uint32_t frame = 1; frame < m_frameCount; ++frame) {
+            float value[4];
+            rawValue(frame, value);
+            for (uint32_t i = 0; i < components; ++i) {
+                minimum[i] = (std::min)(minimum[i], value[i]);
+                maximum[i] = (std::max)(maximum[i], value[i]);
+            }
+        }
+        float* trackMinimum = &track.minimum.x;
+        float* trackExtent = &track.extent.x;
+        for (uint32_t i = 0; i < components; ++i) {
+            trackMinimum[i] = minimum[i];
+            trackExtent[i] = maximum[i] - minimum[i];
+        }
+    }
+
+    // Every frame quantized and decoded again; keys are chosen among these so
+    // the tolerance also covers quantization error
+    std::vector<uint16_t> encoded(static_cast<size_t>(m_frameCount) * components);
+    std::vector<float> decoded(static_cast<size_t>(m_frameCount) * 4);
+    for (uint32_t frame = 0; frame < m_frameCount; ++frame) {
+        float value[4];
+        rawValue(frame, value);
+        uint16_t* key = &encoded[static_cast<size_t>(frame) * components];
+        float* result = &decoded[static_cast<size_t>(frame) * 4];
+        if (channel == CHANNEL_ROTATION) {
+            EncodeRotation({ value[0], value[1], value[2], value[3] }, key);
+            Float4 rotation = DecodeRotation(key);
+            result[0] = rotation.x;
+            result[1] = rotation.y;
+            result[2] = rotation.z;
+            result[3] = rotation.w;
+        } else {
+            for (uint32_t i = 0; i < components; ++i) {
+                key[i] = EncodeRange(value[i], (&track.minimum.x)[i], (&track.extent.x)[i]);
+                result[i] = DecodeRange(key[i], (&track.minimum.x)[i], (&track.extent.x)[i]);
+            }
+        }
+    }
+
+    auto withinTolerance = [&](const float* value, uint32_t frame) {
+        float raw[4];
+        rawValue(frame, raw);
+        return ChannelError(channel, value, raw) <= tolerance;
+    };
+
+    // A track that never leaves its first value needs one key
+    std::vector<uint32_t> keys(1, 0);
+    bool constant = true;
+    for (uint32_t frame = 1; frame < m_frameCount && constant; ++frame) {
+        constant = withinTolerance(&decoded[0], frame);
+    }
+
+    // Otherwise extend each span greedily while interpolating its ends still reproduces every frame inside
+    uint32_t start = 0;
+    while (!constant && start + 1 < m_frameCount) {
+        uint32_t end = start + 1;
+        while (end + 1 < m_frameCount && end + 1 - start <= MAX_KEY_SPAN) {
+            uint32_t candidate = end + 1;
+            bool fits = true;
+            for (uint32_t frame = start + 1; frame < candidate && fits; ++frame) {
+                float value[4];
+                float alpha = static_cast<float>(frame - start) / static_cast<float>(candidate - start);
+                Interpolate(channel, &decoded[static_cast<size_t>(start) * 4], &decoded[static_cast<size_t>(candidate) * 4],
+                            alpha, value);
+                fits = withinTolerance(value, frame);
+            }
+            if (!fits) break;
+            end = candidate;
+        }
+        keys.push_back(end);
+        start = end;
+    }
+
+    for (uint32_t frame : keys) {
+        data.keyFrames.push_back(static_cast<uint16_t>(frame));
+        const uint16_t* key = &encoded[static_cast<size_t>(frame) * components];
+        data.keyValues.insert(data.keyValues.end(), key, key + components);
+    }
+    track.keyCount = static_cast<uint32_t>(keys.size());
+    data.tracks.push_back(track);
+}
+
+void AnimationClip::SampleKeys(float time, Pose& from, Pose& to, float* alphas) const {
+    float clipTime = m_duration > 0.0f ? fmodf(time, m_duration) : 0.0f;
+    if (clipTime < 0.0f) clipTime += m_duration;
+    const float framePosition = (std::min)(clipTime * m_framesPerSecond, static_cast<float>(m_frameCount - 1));
+    const uint32_t frame = static_cast<uint32_t>(framePosition);
+    const uint32_t capacity = from.GetCapacity();
+
+    for (uint32_t channel = 0; channel < CHANNEL_COUNT; ++channel) {
+        const ChannelData& data = m_channels[channel];
+        float* alpha = alphas + static_cast<size_t>(channel) * capacity;
+
+        for (uint32_t joint = 0; joint < m_jointCount; ++joint) {
+            const Track& track = data.tracks[joint];
+            const uint16_t* keyFrames = data.keyFrames.data() + track.firstKey;
+
+            // Last key at or before the frame, never the final key so there is one after it
+            uint32_t first = 0;
+            uint32_t second = 0;
+            alpha[joint] = 0.0f;
+            if (track.keyCount > 1) {
+                first = static_cast<uint32_t>(std::upper_bound(keyFrames, keyFrames + track.keyCount, frame) - keyFrames);
+                first = (std::min)(first > 0 ? first - 1 : 0, track.keyCount - 2);
+                second = first + 1;
+                alpha[joint] = (framePosition - keyFrames[first]) / static_cast<float>(keyFrames[second] - keyFrames[first]);
+            }
+
+            const uint16_t* keyValues = data.keyValues.data() + static_cast<size_t>(track.firstKey) * data.components;
+            const uint16_t* firstKey = keyValues + first * data.components;
+            const uint16_t* secondKey = keyValues + second * data.components;
+            if (channel == CHANNEL_ROTATION) {
+                Float4 a = DecodeRotation(firstKey);
+                Float4 b = DecodeRotation(secondKey);
+                from.GetStream(Pose::ROTATION_X)[joint] = a.x;
+                from.GetStream(Pose::ROTATION_Y)[joint] = a.y;
+                from.GetStream(Pose::ROTATION_Z)[joint] = a.z;
+                from.GetStream(Pose::ROTATION_W)[joint] = a.w;
+                to.GetStream(Pose::ROTATION_X)[joint] = b.x;
+                to.GetStream(Pose::ROTATION_Y)[joint] = b.y;
+                to.GetStream(Pose::ROTATION_Z)[joint] = b.z;
+                to.GetStream(Pose::ROTATION_W)[joint] = b.w;
+            } else {
+                const Pose::Stream firstStream = channel == CHANNEL_TRANSLATION ? Pose::TRANSLATION_X : Pose::SCALE;
+                const float* minimum = &track.minimum.x;
+                const float* extent = &track.extent.x;
+                for (uint32_t i = 0; i < data.components; ++i) {
+                    Pose::Stream stream = static_cast<Pose::Stream>(firstStream + i);
+                    from.GetStream(stream)[joint] = DecodeRange(firstKey[i], minimum[i], extent[i]);
+                    to.GetStream(stream)[joint] = DecodeRange(secondKey[i], minimum[i], extent[i]);
+                }
+            }
+        }
+    }
+}
+
+uint32_t AnimationClip::GetKeyCount() const {
+    uint32_t keys = 0;
+    for (const ChannelData& channel : m_channels) {
+        keys += static_cast<uint32_t>(channel.keyFrames.size());
+    }
+    return keys;
+}
+
+size_t AnimationClip::GetMemoryBytes() const {
+    size_t bytes = sizeof(*this);
+    for (const ChannelData& channel : m_channels) {
+        bytes += channel.tracks.size() * sizeof(Track);
+        bytes += channel.keyFrames.size() * sizeof(uint16_t);
+        bytes += channel.keyValues.size() * sizeof(uint16_t);
+    }
+    return bytes;
+}
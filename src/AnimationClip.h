@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// Local transform of one joint relative to its parent
+struct JointTransform {
+    Float4 rotation;     // Unit quaternion, xyzw
+    Float3 translation;
+    float scale;         // Uniform
+};
+
+// Scale, then rotation, then translation, for row vectors like the rest of MathTypes
+Float4x4 JointMatrix(const JointTransform& transform);
+
+// Joint hierarchy with the bind pose. Parents come before their children, so
+// walking joints in order always visits a parent first.
+class Skeleton {
+public:
+    Skeleton();
+
+    // parents[i] is -1 for a root; false if a parent does not come before its child
+    bool Initialize(const int32_t* parents, const JointTransform* bindPose, uint32_t jointCount);
+
+    uint32_t GetJointCount() const { return static_cast<uint32_t>(m_parents.size()); }
+    int32_t GetParent(uint32_t joint) const { return m_parents[joint]; }
+    const JointTransform& GetBindPose(uint32_t joint) const { return m_bindPose[joint]; }
+    // Model space to joint space in the bind pose
+    const Float4x4* GetInverseBindMatrices() const { return m_inverseBind.data(); }
+
+private:
+    std::vector<int32_t> m_parents;
+    std::vector<JointTransform> m_bindPose;
+    std::vector<Float4x4> m_inverseBind;
+};
+
+// Joint transforms as structure of arrays, padded to a multiple of 8 joints
+// so poses can be interpolated 8 joints per step. Padding joints hold the
+// identity transform.
+class Pose {
+public:
+    enum Stream : uint32_t {
+        ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+        TRANSLATION_X, TRANSLATION_Y, TRANSLATION_Z,
+        SCALE,
+        STREAM_COUNT
+    };
+
+    Pose();
+
+    void Resize(uint32_t jointCount);
+
+    uint32_t GetJointCount() const { return m_jointCount; }
+    uint32_t GetCapacity() const { return m_capacity; }
+    float* GetStream(Stream stream) { return m_data.data() + static_cast<size_t>(stream) * m_capacity; }
+    const float* GetStream(Stream stream) const { return m_data.data() + static_cast<size_t>(stream) * m_capacity; }
+
+    JointTransform GetJoint(uint32_t joint) const;
+    void SetJoint(uint32_t joint, const JointTransform& transform);
+
+private:
+    std::vector<float> m_data;
+    uint32_t m_jointCount;
+    uint32_t m_capacity;
+};
+
+// Animation clip compressed from evenly spaced frames. Every joint has a
+// rotation, translation and scale track. A track keeps only the keys that
+// linear interpolation cannot reproduce within the tolerances, so constant
+// tracks shrink to one key. Rotations are quantized to 48 bits (the three
+// smallest components, 15 bits each, plus which one was dropped);
+// translations and scales to 16 bits per component within each track's range.
+class AnimationClip {
+public:
+    struct CompressionSettings {
+        float rotationTolerance;     // Radians
+        float translationTolerance;  // Units
+        float scaleTolerance;
+    };
+
+    AnimationClip();
+
+    // frames holds frameCount poses of every joint, frame-major. Looping
+    // clips should end on a copy of their first frame.
+    bool Build(const Skeleton& skeleton, const JointTransform* frames, uint32_t frameCount, float framesPerSecond,
+               const CompressionSettings& settings);
+
+    // Decodes the keys on either side of time into from and to, and the
+    // interpolation weight of each track into alphas: three arrays of the
+    // poses' capacity for the rotation, translation and scale tracks. Time
+    // wraps around the clip's duration.
+    void SampleKeys(float time, Pose& from, Pose& to, float* alphas) const;
+
+    float GetDuration() const { return m_duration; }
+    uint32_t GetJointCount() const { return m_jointCount; }
+    uint32_t GetFrameCount() const { return m_frameCount; }
+    uint32_t GetKeyCount() const;
+    size_t GetMemoryBytes() const;
+    // The same frames stored as JointTransforms
+    size_t GetUncompressedBytes() const { return static_cast<size_t>(m_frameCount) * m_jointCount * sizeof(JointTransform); }
+
+    // Constants
+    static constexpr uint32_t MAX_FRAMES = 65535;
+    static constexpr uint32_t MAX_KEY_SPAN = 64;  // Frames between two kept keys; bounds the build cost
+
+private:
+    enum Channel : uint32_t { CHANNEL_ROTATION, CHANNEL_TRANSLATION, CHANNEL_SCALE, CHANNEL_COUNT };
+
+    struct Track {
+        uint32_t firstKey;
+        uint32_t keyCount;
+        Float3 minimum;   // Dequantization range; unused for rotations
+        Float3 extent;
+    };
+
+    // Keys of every track of one channel, stored track after track
+    struct ChannelData {
+        std::vector<Track> tracks;         // One per joint
+        std::vector<uint16_t> keyFrames;
+        std::vector<uint16_t> keyValues;   // components per key
+        uint32_t components;
+    };
+
+    ChannelData m_channels[CHANNEL_COUNT];
+    uint32_t m_jointCount;
+    uint32_t m_frameCount;
+    float m_framesPerSecond;
+    float m_duration;
+
+    void BuildTrack(Channel channel, uint32_t joint, const JointTransform* frames, float tolerance);
+};
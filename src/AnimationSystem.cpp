@@ -0,0 +1,344 @@
+#include "AnimationSystem.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void AnimationSystem::SkinnedMesh::Resize(uint32_t vertices) {
+    vertexCount = vertices;
+    for (std::vector<float>& position : positions) {
+        position.assign(vertices, 0.0f);
+    }
+    for (uint32_t influence = 0; influence < INFLUENCES; ++influence) {
+        joints[influence].assign(vertices, 0);
+        weights[influence].assign(vertices, 0.0f);
+    }
+}
+
+AnimationSystem::AnimationSystem() :
+    m_maxJoints(0),
+    m_useSimd(IsSimdSupported()),
+    m_stats() {
+}
+
+AnimationSystem::~AnimationSystem() {
+}
+
+void AnimationSystem::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+bool AnimationSystem::IsSimdSupported() {
+    return CpuHasAvx2();
+}
+
+uint32_t AnimationSystem::AddCharacter(const Character& character) {
+    uint32_t index = static_cast<uint32_t>(m_characters.size());
+    uint32_t joints = character.skeleton->GetJointCount();
+    m_characters.push_back(character);
+    m_skinningOffsets.push_back(static_cast<uint32_t>(m_skinning.size()));
+    m_skinning.resize(m_skinning.size() + joints, Float4x4::Identity());
+    m_maxJoints = (std::max)(m_maxJoints, joints);
+    return index;
+}
+
+void AnimationSystem::PrepareWorkspace(Workspace& workspace) const {
+    if (workspace.from.GetJointCount() == m_maxJoints) return;
+    workspace.from.Resize(m_maxJoints);
+    workspace.to.Resize(m_maxJoints);
+    workspace.sampled[0].Resize(m_maxJoints);
+    workspace.sampled[1].Resize(m_maxJoints);
+    workspace.alphas.assign(static_cast<size_t>(workspace.from.GetCapacity()) * 3, 0.0f);
+    workspace.model.resize(m_maxJoints);
+}
+
+void AnimationSystem::Update(float deltaSeconds, JobSystem* jobs) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Scratch is sized here so the parallel part never allocates
+    const bool parallel = jobs && jobs->GetThreadCount() > 1 && m_characters.size() > CHARACTERS_PER_BATCH;
+    m_workspaces.resize((std::max)(m_workspaces.size(), static_cast<size_t>(parallel ? jobs->GetThreadCount() : 1)));
+    for (Workspace& workspace : m_workspaces) {
+        PrepareWorkspace(workspace);
+    }
+
+    uint32_t joints = 0;
+    for (Character& character : m_characters) {
+        for (int clip = 0; clip < 2; ++clip) {
+            if (!character.clips[clip]) continue;
+            float duration = character.clips[clip]->GetDuration();
+            character.times[clip] += deltaSeconds * character.speeds[clip];
+            if (duration > 0.0f) character.times[clip] = fmodf(character.times[clip], duration);
+        }
+        joints += character.skeleton->GetJointCount();
+    }
+
+    if (parallel) {
+        jobs->ParallelFor(m_characters.size(), CHARACTERS_PER_BATCH, [&](size_t begin, size_t end, uint32_t thread) {
+            for (size_t character = begin; character < end; ++character) {
+                AnimateCharacter(static_cast<uint32_t>(character), m_workspaces[thread]);
+            }
+        });
+    } else {
+        for (uint32_t character = 0; character < m_characters.size(); ++character) {
+            AnimateCharacter(character, m_workspaces[0]);
+        }
+    }
+
+    m_stats.characters = static_cast<uint32_t>(m_characters.size());
+    m_stats.joints = joints;
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AnimationSystem::AnimateCharacter(uint32_t index, Workspace& workspace) {
+    const Character& character = m_characters[index];
+    const Skeleton& skeleton = *character.skeleton;
+
+    Pose& pose = workspace.sampled[0];
+    if (character.clips[0]) {
+        SampleClip(*character.clips[0], character.times[0], pose, workspace);
+    } else {
+        for (uint32_t joint = 0; joint < skeleton.GetJointCount(); ++joint) {
+            pose.SetJoint(joint, skeleton.GetBindPose(joint));
+        }
+    }
+
+    const Pose* result = &pose;
+    if (character.clips[1] && character.blend > 0.0f) {
+        SampleClip(*character.clips[1], character.times[1], workspace.sampled[1], workspace);
+        std::fill_n(workspace.alphas.begin(), workspace.from.GetCapacity(), character.blend);
+        Interpolate(pose, workspace.sampled[1], workspace.alphas.data(), 0, workspace.from);
+        result = &workspace.from;
+    }
+
+    ComputeSkinningMatrices(skeleton, *result, workspace.model.data(), &m_skinning[m_skinningOffsets[index]]);
+}
+
+void AnimationSystem::SampleClip(const AnimationClip& clip, float time, Pose& pose) {
+    if (pose.GetJointCount() != clip.GetJointCount()) {
+        pose.Resize(clip.GetJointCount());
+    }
+    SampleClip(clip, time, pose, m_sampleWorkspace);
+}
+
+void AnimationSystem::SampleClip(const AnimationClip& clip, float time, Pose& pose, Workspace& workspace) const {
+    if (workspace.from.GetCapacity() != pose.GetCapacity()) {
+        workspace.from.Resize(pose.GetJointCount());
+        workspace.to.Resize(pose.GetJointCount());
+        workspace.alphas.assign(static_cast<size_t>(pose.GetCapacity()) * 3, 0.0f);
+    }
+    clip.SampleKeys(time, workspace.from, workspace.to, workspace.alphas.data());
+    Interpolate(workspace.from, workspace.to, workspace.alphas.data(), pose.GetCapacity(), pose);
+}
+
+void AnimationSystem::BlendPoses(const Pose& a, const Pose& b, const float* weights, Pose& result) {
+    // Copied so the padding joints read defined weights
+    std::vector<float>& alphas = m_sampleWorkspace.alphas;
+    alphas.assign(static_cast<size_t>(a.GetCapacity()) * 3, 0.0f);
+    std::copy(weights, weights + a.GetJointCount(), alphas.begin());
+    if (result.GetCapacity() != a.GetCapacity()) {
+        result.Resize(a.GetJointCount());
+    }
+    Interpolate(a, b, alphas.data(), 0, result);
+}
+
+void AnimationSystem::ComputeSkinningMatrices(const Skeleton& skeleton, const Pose& pose, Float4x4* model,
+                                              Float4x4* skinning) {
+    const Float4x4* inverseBind = skeleton.GetInverseBindMatrices();
+    for (uint32_t joint = 0; joint < skeleton.GetJointCount(); ++joint) {
+        Float4x4 local = JointMatrix(pose.GetJoint(joint));
+        int32_t parent = skeleton.GetParent(joint);
+        model[joint] = parent < 0 ? local : Multiply(local, model[parent]);
+        skinning[joint] = Multiply(inverseBind[joint], model[joint]);
+    }
+}
+
+void AnimationSystem::Interpolate(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride,
+                                  Pose& result) const {
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        InterpolateSimd(a, b, alphas, alphaStride, result);
+        return;
+    }
+#endif
+    InterpolateScalar(a, b, alphas, alphaStride, result);
+}
+
+void AnimationSystem::InterpolateScalar(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride,
+                                        Pose& result) const {
+    const float* rotationAlpha = alphas;
+    const float* translationAlpha = alphas + alphaStride;
+    const float* scaleAlpha = alphas + 2 * alphaStride;
+
+    for (uint32_t i = 0; i < result.GetCapacity(); ++i) {
+        // nlerp along the shorter arc
+        float ax = a.GetStream(Pose::ROTATION_X)[i], ay = a.GetStream(Pose::ROTATION_Y)[i];
+        float az = a.GetStream(Pose::ROTATION_Z)[i], aw = a.GetStream(Pose::ROTATION_W)[i];
+        float bx = b.GetStream(Pose::ROTATION_X)[i], by = b.GetStream(Pose::ROTATION_Y)[i];
+        float bz = b.GetStream(Pose::ROTATION_Z)[i], bw = b.GetStream(Pose::ROTATION_W)[i];
+        float dot = ax * bx + ay * by + az * bz + aw * bw;
+        if (dot < 0.0f) {
+            bx = -bx;
+            by = -by;
+            bz = -bz;
+            bw = -bw;
+        }
+        float t = rotationAlpha[i];
+        float rx = ax + (bx - ax) * t;
+        float ry = ay + (by - ay) * t;
+        float rz = az + (bz - az) * t;
+        float rw = aw + (bw - aw) * t;
+        float inverseLength = 1.0f / sqrtf(rx * rx + ry * ry + rz * rz + rw * rw);
+        result.GetStream(Pose::ROTATION_X)[i] = rx * inverseLength;
+        result.GetStream(Pose::ROTATION_Y)[i] = ry * inverseLength;
+        result.GetStream(Pose::ROTATION_Z)[i] = rz * inverseLength;
+        result.GetStream(Pose::ROTATION_W)[i] = rw * inverseLength;
+
+        for (uint32_t stream = Pose::TRANSLATION_X; stream <= Pose::SCALE; ++stream) {
+            Pose::Stream s = static_cast<Pose::Stream>(stream);
+            float alpha = stream == Pose::SCALE ? scaleAlpha[i] : translationAlpha[i];
+            float from = a.GetStream(s)[i];
+            result.GetStream(s)[i] = from + (b.GetStream(s)[i] - from) * alpha;
+        }
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void AnimationSystem::InterpolateSimd(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride,
+                                      Pose& result) const {
+    const float* rotationAlpha = alphas;
+    const float* translationAlpha = alphas + alphaStride;
+    const float* scaleAlpha = alphas + 2 * alphaStride;
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (uint32_t i = 0; i < result.GetCapacity(); i += 8) {
+        __m256 ax = _mm256_loadu_ps(a.GetStream(Pose::ROTATION_X) + i), ay = _mm256_loadu_ps(a.GetStream(Pose::ROTATION_Y) + i);
+        __m256 az = _mm256_loadu_ps(a.GetStream(Pose::ROTATION_Z) + i), aw = _mm256_loadu_ps(a.GetStream(Pose::ROTATION_W) + i);
+        __m256 bx = _mm256_loadu_ps(b.GetStream(Pose::ROTATION_X) + i), by = _mm256_loadu_ps(b.GetStream(Pose::ROTATION_Y) + i);
+        __m256 bz = _mm256_loadu_ps(b.GetStream(Pose::ROTATION_Z) + i), bw = _mm256_loadu_ps(b.GetStream(Pose::ROTATION_W) + i);
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)),
+                                                 _mm256_mul_ps(az, bz)), _mm256_mul_ps(aw, bw));
+
+        // Flip b's sign where the quaternions are more than half a turn apart
+        __m256 flip = _mm256_and_ps(_mm256_cmp_ps(dot, zero, _CMP_LT_OQ), signBit);
+        bx = _mm256_xor_ps(bx, flip);
+        by = _mm256_xor_ps(by, flip);
+        bz = _mm256_xor_ps(bz, flip);
+        bw = _mm256_xor_ps(bw, flip);
+
+        __m256 t = _mm256_loadu_ps(rotationAlpha + i);
+        __m256 rx = _mm256_add_ps(ax, _mm256_mul_ps(_mm256_sub_ps(bx, ax), t));
+        __m256 ry = _mm256_add_ps(ay, _mm256_mul_ps(_mm256_sub_ps(by, ay), t));
+        __m256 rz = _mm256_add_ps(az, _mm256_mul_ps(_mm256_sub_ps(bz, az), t));
+        __m256 rw = _mm256_add_ps(aw, _mm256_mul_ps(_mm256_sub_ps(bw, aw), t));
+        __m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, rx), _mm256_mul_ps(ry, ry)),
+                                                           _mm256_mul_ps(rz, rz)), _mm256_mul_ps(rw, rw));
+        __m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+        _mm256_storeu_ps(result.GetStream(Pose::ROTATION_X) + i, _mm256_mul_ps(rx, inverseLength));
+        _mm256_storeu_ps(result.GetStream(Pose::ROTATION_Y) + i, _mm256_mul_ps(ry, inverseLength));
+        _mm256_storeu_ps(result.GetStream(Pose::ROTATION_Z) + i, _mm256_mul_ps(rz, inverseLength));
+        _mm256_storeu_ps(result.GetStream(Pose::ROTATION_W) + i, _mm256_mul_ps(rw, inverseLength));
+
+        for (uint32_t stream = Pose::TRANSLATION_X; stream <= Pose::SCALE; ++stream) {
+            Pose::Stream s = static_cast<Pose::Stream>(stream);
+            __m256 alpha = _mm256_loadu_ps((stream == Pose::SCALE ? scaleAlpha : translationAlpha) + i);
+            __m256 from = _mm256_loadu_ps(a.GetStream(s) + i);
+            __m256 to = _mm256_loadu_ps(b.GetStream(s) + i);
+            _mm256_storeu_ps(result.GetStream(s) + i, _mm256_add_ps(from, _mm256_mul_ps(_mm256_sub_ps(to, from), alpha)));
+        }
+    }
+}
+#else
+void AnimationSystem::InterpolateSimd(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride,
+                                      Pose& result) const {
+    InterpolateScalar(a, b, alphas, alphaStride, result);
+}
+#endif
+
+void AnimationSystem::SkinPositions(const SkinnedMesh& mesh, const Float4x4* skinning, float* x, float* y,
+                                    float* z) const {
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        // Whole groups of 8 in registers; the tail uses the same formulas
+        uint32_t simdEnd = mesh.vertexCount & ~7u;
+        SkinPositionsSimd(mesh, skinning, 0, simdEnd, x, y, z);
+        SkinPositionsScalar(mesh, skinning, simdEnd, mesh.vertexCount, x, y, z);
+        return;
+    }
+#endif
+    SkinPositionsScalar(mesh, skinning, 0, mesh.vertexCount, x, y, z);
+}
+
+void AnimationSystem::SkinPositionsScalar(const SkinnedMesh& mesh, const Float4x4* skinning, uint32_t begin,
+                                          uint32_t end, float* x, float* y, float* z) const {
+    for (uint32_t vertex = begin; vertex < end; ++vertex) {
+        const Float3 position = { mesh.positions[0][vertex], mesh.positions[1][vertex], mesh.positions[2][vertex] };
+        Float3 skinned = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t influence = 0; influence < INFLUENCES; ++influence) {
+            float weight = mesh.weights[influence][vertex];
+            Float3 moved = TransformPoint(position, skinning[mesh.joints[influence][vertex]]);
+            skinned.x += weight * moved.x;
+            skinned.y += weight * moved.y;
+            skinned.z += weight * moved.z;
+        }
+        x[vertex] = skinned.x;
+        y[vertex] = skinned.y;
+        z[vertex] = skinned.z;
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void AnimationSystem::SkinPositionsSimd(const SkinnedMesh& mesh, const Float4x4* skinning, uint32_t begin,
+                                        uint32_t end, float* x, float* y, float* z) const {
+    const float* matrices = &skinning[0].m[0][0];
+    for (uint32_t vertex = begin; vertex < end; vertex += 8) {
+        __m256 px = _mm256_loadu_ps(mesh.positions[0].data() + vertex);
+        __m256 py = _mm256_loadu_ps(mesh.positions[1].data() + vertex);
+        __m256 pz = _mm256_loadu_ps(mesh.positions[2].data() + vertex);
+        __m256 sx = _mm256_setzero_ps(), sy = _mm256_setzero_ps(), sz = _mm256_setzero_ps();
+
+        for (uint32_t influence = 0; influence < INFLUENCES; ++influence) {
+            __m256 weight = _mm256_loadu_ps(mesh.weights[influence].data() + vertex);
+            __m256i base = _mm256_slli_epi32(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mesh.joints[influence].data() + vertex)), 4);
+
+            // Each lane gathers the 3x4 part of its own joint's matrix
+            __m256 moved[3];
+            for (int column = 0; column < 3; ++column) {
+                __m256 m0 = _mm256_i32gather_ps(matrices + 0 + column, base, 4);
+                __m256 m1 = _mm256_i32gather_ps(matrices + 4 + column, base, 4);
+                __m256 m2 = _mm256_i32gather_ps(matrices + 8 + column, base, 4);
+                __m256 m3 = _mm256_i32gather_ps(matrices + 12 + column, base, 4);
+                moved[column] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m0), _mm256_mul_ps(py, m1)),
+                                                            _mm256_mul_ps(pz, m2)), m3);
+            }
+            sx = _mm256_add_ps(sx, _mm256_mul_ps(weight, moved[0]));
+            sy = _mm256_add_ps(sy, _mm256_mul_ps(weight, moved[1]));
+            sz = _mm256_add_ps(sz, _mm256_mul_ps(weight, moved[2]));
+        }
+        _mm256_storeu_ps(x + vertex, sx);
+        _mm256_storeu_ps(y + vertex, sy);
+        _mm256_storeu_ps(z + vertex, sz);
+    }
+}
+#else
+void AnimationSystem::SkinPositionsSimd(const SkinnedMesh& mesh, const Float4x4* skinning, uint32_t begin,
+                                        uint32_t end, float* x, float* y, float* z) const {
+    SkinPositionsScalar(mesh, skinning, begin, end, x, y, z);
+}
+#endif
+
+void AnimationSystem::PlaceHitboxes(const Hitbox* hitboxes, uint32_t count, const Float4x4* skinning,
+                                    Capsule* capsules) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const Float4x4& matrix = skinning[hitboxes[i].joint];
+        capsules[i].start = TransformPoint(hitboxes[i].start, matrix);
+        capsules[i].end = TransformPoint(hitboxes[i].end, matrix);
+        capsules[i].radius = hitboxes[i].radius;
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AnimationClip.h"
+#include "MathTypes.h"
+
+class JobSystem;
+
+// Animates characters: each Update samples and blends up to two clips per
+// character and produces its skinning matrices (bind-pose model space to
+// posed model space). Characters are independent, so they are spread over the
+// job system with one set of scratch poses per thread.
+//
+// Key interpolation and pose blending run on structure-of-arrays poses with
+// an AVX2 path (8 joints per step, nlerp for rotations) and a scalar path that
+// evaluate the same expressions, as does CPU skinning of vertex positions, so
+// both paths give identical results. CPU skinning and PlaceHitboxes let a
+// headless process put hit volumes where the rendered character would be.
+class AnimationSystem {
+public:
+    struct Character {
+        const Skeleton* skeleton;
+        const AnimationClip* clips[2];  // The second may be null
+        float times[2];                 // Seconds into each clip
+        float speeds[2];                // Playback rate; Update advances the times
+        float blend;                    // Weight of the second clip
+    };
+
+    // Joints per skinned vertex; unused slots have weight 0
+    static constexpr uint32_t INFLUENCES = 4;
+
+    // Vertex positions bound to up to four joints each, as structure of arrays
+    struct SkinnedMesh {
+        uint32_t vertexCount;
+        std::vector<float> positions[3];       // Bind pose, model space
+        std::vector<int32_t> joints[INFLUENCES];
+        std::vector<float> weights[INFLUENCES];  // Sum to 1 per vertex
+
+        void Resize(uint32_t vertices);
+    };
+
+    // Capsule attached to a joint, in bind-pose model space
+    struct Hitbox {
+        uint32_t joint;
+        Float3 start;
+        Float3 end;
+        float radius;
+    };
+
+    struct Capsule {
+        Float3 start;
+        Float3 end;
+        float radius;
+    };
+
+    struct Stats {
+        uint32_t characters;
+        uint32_t joints;             // Summed over characters
+        double updateMilliseconds;
+    };
+
+    AnimationSystem();
+    ~AnimationSystem();
+
+    // Clips must be built for the character's skeleton. Returns the character's
+    // index; its skinning matrices live as long as the system.
+    uint32_t AddCharacter(const Character& character);
+    Character& GetCharacter(uint32_t character) { return m_characters[character]; }
+    uint32_t GetCharacterCount() const { return static_cast<uint32_t>(m_characters.size()); }
+
+    void Update(float deltaSeconds, JobSystem* jobs = nullptr);
+
+    const Float4x4* GetSkinningMatrices(uint32_t character) const { return &m_skinning[m_skinningOffsets[character]]; }
+    const Stats& GetStats() const { return m_stats; }
+
+    // Pose of one clip at time, interpolated between its keys
+    void SampleClip(const AnimationClip& clip, float time, Pose& pose);
+    // weights[joint] of b over a; one array lets a blend cover part of the body
+    void BlendPoses(const Pose& a, const Pose& b, const float* weights, Pose& result);
+    // Local joint transforms to skinning matrices; model receives each joint's model-space matrix
+    static void ComputeSkinningMatrices(const Skeleton& skeleton, const Pose& pose, Float4x4* model, Float4x4* skinning);
+
+    // Writes skinned positions as three arrays of mesh.vertexCount
+    void SkinPositions(const SkinnedMesh& mesh, const Float4x4* skinning, float* x, float* y, float* z) const;
+    static void PlaceHitboxes(const Hitbox* hitboxes, uint32_t count, const Float4x4* skinning, Capsule* capsules);
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+private:
+    // Per-thread scratch, sized for the largest skeleton
+    struct Workspace {
+        Pose from;
+        Pose to;
+        Pose sampled[2];
+        std::vector<float> alphas;   // Three arrays of the poses' capacity
+        std::vector<Float4x4> model;
+    };
+
+    std::vector<Character> m_characters;
+    std::vector<uint32_t> m_skinningOffsets;
+    std::vector<Float4x4> m_skinning;
+    std::vector<Workspace> m_workspaces;
+    uint32_t m_maxJoints;
+    bool m_useSimd;
+    Stats m_stats;
+    Workspace m_sampleWorkspace;  // For SampleClip and BlendPoses outside Update
+
+    void PrepareWorkspace(Workspace& workspace) const;
+    void AnimateCharacter(uint32_t character, Workspace& workspace);
+    void SampleClip(const AnimationClip& clip, float time, Pose& pose, Workspace& workspace) const;
+    void Interpolate(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride, Pose& result) const;
+    void InterpolateScalar(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride, Pose& result) const;
+    void InterpolateSimd(const Pose& a, const Pose& b, const float* alphas, uint32_t alphaStride, Pose& result) const;
+    void SkinPositionsScalar(const SkinnedMesh& mesh, const Float4x4* skinning, uint32_t begin, uint32_t end,
+                             float* x, float* y, float* z) const;
+    void SkinPositionsSimd(const SkinnedMesh& mesh, const Float4x4* skinning, uint32_t begin, uint32_t end,
+                           float* x, float* y, float* z) const;
+
+    // Constants
+    static constexpr size_t CHARACTERS_PER_BATCH = 4;
+};
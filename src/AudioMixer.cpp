@@ -0,0 +1,330 @@
+#include "AudioMixer.h"
+#include "AllocationTracker.h"
+#include "AudioSink.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+int64_t NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void UpdateMaximum(std::atomic<int64_t>& maximum, int64_t value) {
+    // Only the mixing thread writes, so no compare-exchange is needed
+    if (value > maximum.load(std::memory_order_relaxed)) {
+        maximum.store(value, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+AudioMixer::AudioMixer() :
+    m_activeCount(0),
+    m_fadingCount(0),
+    m_listenerPosition({ 0.0f, 0.0f, 0.0f }),
+    m_listenerRight({ 1.0f, 0.0f, 0.0f }),
+    m_running(false),
+    m_sink(nullptr),
+    m_useSimd(IsSimdSupported()),
+    m_statActiveVoices(0),
+    m_statBlocks(0),
+    m_statStolen(0),
+    m_statDropped(0),
+    m_statRejected(0),
+    m_statLastMixNanoseconds(0),
+    m_statMaxMixNanoseconds(0),
+    m_statMaxLatencyNanoseconds(0) {
+}
+
+AudioMixer::~AudioMixer() {
+    Shutdown();
+}
+
+bool AudioMixer::Initialize(uint32_t voiceCount, uint32_t commandCapacity) {
+    if (IsRunning() || voiceCount == 0) return false;
+    m_voices.assign(voiceCount, Voice());
+    m_fading.assign(MAX_FADING_VOICES, Voice());
+    m_activeCount = 0;
+    m_fadingCount = 0;
+    m_mix[0].assign(BLOCK_FRAMES, 0.0f);
+    m_mix[1].assign(BLOCK_FRAMES, 0.0f);
+    m_output.assign(BLOCK_FRAMES * 2, 0.0f);
+    return m_commands.Initialize(commandCapacity);
+}
+
+uint32_t AudioMixer::AddSound(const float* samples, uint32_t frameCount) {
+    if (IsRunning() || frameCount == 0) return INVALID_SOUND;
+    Sound sound = { m_samples.size(), frameCount };
+    m_samples.insert(m_samples.end(), samples, samples + frameCount);
+    // Zeros up to the next multiple of 8 and one step beyond, so a partial last step reads silence
+    m_samples.resize(m_samples.size() + (8 - frameCount % 8) + 8, 0.0f);
+    m_sounds.push_back(sound);
+    return static_cast<uint32_t>(m_sounds.size() - 1);
+}
+
+bool AudioMixer::Start(AudioSink* sink) {
+    if (IsRunning() || !sink || m_voices.empty()) return false;
+    if (!sink->Open(SAMPLE_RATE)) return false;
+    m_sink = sink;
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&AudioMixer::ThreadMain, this);
+    return true;
+}
+
+void AudioMixer::Shutdown() {
+    if (!IsRunning()) return;
+    m_running.store(false, std::memory_order_release);
+    m_thread.join();
+    m_sink->Close();
+    m_sink = nullptr;
+}
+
+bool AudioMixer::Play(uint32_t sound, const Float3& position, float volume, uint8_t priority) {
+    return Send({ CommandType::Play, sound, position, { 0.0f, 0.0f, 0.0f }, volume, priority, 0 });
+}
+
+bool AudioMixer::PlayLocal(uint32_t sound, float volume, uint8_t priority) {
+    return Send({ CommandType::PlayLocal, sound, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, volume, priority, 0 });
+}
+
+bool AudioMixer::SetListener(const Float3& position, const Float3& right) {
+    return Send({ CommandType::Listener, INVALID_SOUND, position, right, 0.0f, 0, 0 });
+}
+
+bool AudioMixer::StopAll() {
+    return Send({ CommandType::StopAll, INVALID_SOUND, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f, 0, 0 });
+}
+
+bool AudioMixer::Send(const Command& command) {
+    Command timed = command;
+    timed.sentNanoseconds = NowNanoseconds();
+    if (!m_commands.Push(timed)) {
+        m_statRejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+AudioMixer::Stats AudioMixer::GetStats() const {
+    Stats stats;
+    stats.activeVoices = m_statActiveVoices.load(std::memory_order_relaxed);
+    stats.blocks = m_statBlocks.load(std::memory_order_relaxed);
+    stats.stolenVoices = m_statStolen.load(std::memory_order_relaxed);
+    stats.droppedSounds = m_statDropped.load(std::memory_order_relaxed);
+    stats.rejectedCommands = m_statRejected.load(std::memory_order_relaxed);
+    stats.lastMixMicroseconds = m_statLastMixNanoseconds.load(std::memory_order_relaxed) / 1000.0;
+    stats.maxMixMicroseconds = m_statMaxMixNanoseconds.load(std::memory_order_relaxed) / 1000.0;
+    stats.maxStartLatencyMicroseconds = m_statMaxLatencyNanoseconds.load(std::memory_order_relaxed) / 1000.0;
+    return stats;
+}
+
+void AudioMixer::ThreadMain() {
+    MemoryTagScope tag(MemoryTag::Audio);
+    while (m_running.load(std::memory_order_acquire)) {
+        MixBlock(m_output.data());
+        if (!m_sink->Write(m_output.data(), BLOCK_FRAMES)) break;
+    }
+}
+
+void AudioMixer::MixBlock(float* frames) {
+    int64_t blockStart = NowNanoseconds();
+    NoAllocationScope noAllocation;
+
+    Command command;
+    while (m_commands.Pop(command)) {
+        Apply(command);
+    }
+
+    std::fill(m_mix[0].begin(), m_mix[0].end(), 0.0f);
+    std::fill(m_mix[1].begin(), m_mix[1].end(), 0.0f);
+
+    for (uint32_t i = 0; i < m_activeCount;) {
+        Voice& voice = m_voices[i];
+        const Sound& sound = m_sounds[voice.sound];
+        float target[2];
+        ComputeGains(voice, target);
+        uint32_t frameCount = (std::min)(BLOCK_FRAMES, sound.frameCount - voice.cursor);
+        float step[2] = { (target[0] - voice.gains[0]) / BLOCK_FRAMES, (target[1] - voice.gains[1]) / BLOCK_FRAMES };
+        MixVoice(&m_samples[sound.offset + voice.cursor], frameCount, voice.gains, step);
+        voice.gains[0] = target[0];
+        voice.gains[1] = target[1];
+        voice.cursor += frameCount;
+
+        if (voice.sentNanoseconds != 0) {
+            UpdateMaximum(m_statMaxLatencyNanoseconds, blockStart - voice.sentNanoseconds);
+            voice.sentNanoseconds = 0;
+        }
+        if (voice.cursor >= sound.frameCount) {
+            voice = m_voices[--m_activeCount];
+        } else {
+            ++i;
+        }
+    }
+
+    // Stolen and stopped voices ramp to silence over this block and are gone after it
+    for (uint32_t i = 0; i < m_fadingCount; ++i) {
+        Voice& voice = m_fading[i];
+        const Sound& sound = m_sounds[voice.sound];
+        uint32_t frameCount = (std::min)(BLOCK_FRAMES, sound.frameCount - voice.cursor);
+        float step[2] = { -voice.gains[0] / BLOCK_FRAMES, -voice.gains[1] / BLOCK_FRAMES };
+        MixVoice(&m_samples[sound.offset + voice.cursor], frameCount, voice.gains, step);
+    }
+    m_fadingCount = 0;
+
+    for (uint32_t frame = 0; frame < BLOCK_FRAMES; ++frame) {
+        frames[frame * 2] = (std::max)(-1.0f, (std::min)(1.0f, m_mix[0][frame]));
+        frames[frame * 2 + 1] = (std::max)(-1.0f, (std::min)(1.0f, m_mix[1][frame]));
+    }
+
+    int64_t mixNanoseconds = NowNanoseconds() - blockStart;
+    m_statLastMixNanoseconds.store(mixNanoseconds, std::memory_order_relaxed);
+    UpdateMaximum(m_statMaxMixNanoseconds, mixNanoseconds);
+    m_statActiveVoices.store(m_activeCount, std::memory_order_relaxed);
+    m_statBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioMixer::Apply(const Command& command) {
+    switch (command.type) {
+        case CommandType::Play:
+        case CommandType::PlayLocal:
+            StartVoice(command);
+            break;
+
+        case CommandType::Listener:
+            m_listenerPosition = command.position;
+            m_listenerRight = command.right;
+            break;
+
+        case CommandType::StopAll:
+            for (uint32_t i = 0; i < m_activeCount && m_fadingCount < MAX_FADING_VOICES; ++i) {
+                m_fading[m_fadingCount++] = m_voices[i];
+            }
+            m_activeCount = 0;
+            break;
+    }
+}
+
+void AudioMixer::StartVoice(const Command& command) {
+    if (command.sound >= m_sounds.size()) return;
+
+    Voice voice;
+    voice.sound = command.sound;
+    voice.cursor = 0;
+    voice.position = command.position;
+    voice.volume = command.volume;
+    voice.priority = command.priority;
+    voice.positional = command.type == CommandType::Play;
+    voice.sentNanoseconds = command.sentNanoseconds;
+    // Starts at its gains rather than ramping up, so attacks stay sharp
+    ComputeGains(voice, voice.gains);
+
+    if (m_activeCount < m_voices.size()) {
+        m_voices[m_activeCount++] = voice;
+        return;
+    }
+
+    // All busy: the lowest-priority voice, quietest among equals, may give way
+    uint32_t victim = 0;
+    float victimLoudness = (std::max)(m_voices[0].gains[0], m_voices[0].gains[1]);
+    for (uint32_t i = 1; i < m_activeCount; ++i) {
+        float loudness = (std::max)(m_voices[i].gains[0], m_voices[i].gains[1]);
+        if (m_voices[i].priority < m_voices[victim].priority ||
+            (m_voices[i].priority == m_voices[victim].priority && loudness < victimLoudness)) {
+            victim = i;
+            victimLoudness = loudness;
+        }
+    }
+    float loudness = (std::max)(voice.gains[0], voice.gains[1]);
+    if (voice.priority > m_voices[victim].priority ||
+        (voice.priority == m_voices[victim].priority && loudness >= victimLoudness)) {
+        if (m_fadingCount < MAX_FADING_VOICES) {
+            m_fading[m_fadingCount++] = m_voices[victim];
+        }
+        m_voices[victim] = voice;
+        m_statStolen.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_statDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AudioMixer::ComputeGains(const Voice& voice, float gains[2]) const {
+    float attenuation = voice.volume;
+    float pan = 0.0f;
+    if (voice.positional) {
+        float dx = voice.position.x - m_listenerPosition.x;
+        float dy = voice.position.y - m_listenerPosition.y;
+        float dz = voice.position.z - m_listenerPosition.z;
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (distance >= MAX_DISTANCE) {
+            attenuation = 0.0f;
+        } else if (distance > REFERENCE_DISTANCE) {
+            // Inverse distance, clamped to full volume inside the reference distance
+            attenuation *= REFERENCE_DISTANCE / (REFERENCE_DISTANCE + ROLLOFF * (distance - REFERENCE_DISTANCE));
+        }
+        if (distance > 1e-4f) {
+            float side = (dx * m_listenerRight.x + dy * m_listenerRight.y + dz * m_listenerRight.z) / distance;
+            pan = (std::max)(-1.0f, (std::min)(1.0f, side));
+        }
+    }
+
+    // Constant power: left and right gains squared always sum to the attenuation squared
+    float angle = (pan + 1.0f) * 0.785398163f;
+    gains[0] = std::cos(angle) * attenuation;
+    gains[1] = std::sin(angle) * attenuation;
+}
+
+void AudioMixer::MixVoice(const float* samples, uint32_t frameCount, const float start[2], const float step[2]) {
+    if (m_useSimd) {
+        MixVoiceSimd(samples, frameCount, start, step);
+    } else {
+        MixVoiceScalar(samples, frameCount, start, step);
+    }
+}
+
+void AudioMixer::MixVoiceScalar(const float* samples, uint32_t frameCount, const float start[2], const float step[2]) {
+    float* left = m_mix[0].data();
+    float* right = m_mix[1].data();
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        float position = static_cast<float>(frame);
+        left[frame] += samples[frame] * (start[0] + step[0] * position);
+        right[frame] += samples[frame] * (start[1] + step[1] * position);
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void AudioMixer::MixVoiceSimd(const float* samples, uint32_t frameCount, const float start[2], const float step[2]) {
+    // Steps past frameCount read the zero padding after the sound and add nothing
+    float* left = m_mix[0].data();
+    float* right = m_mix[1].data();
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 startLeft = _mm256_set1_ps(start[0]);
+    const __m256 startRight = _mm256_set1_ps(start[1]);
+    const __m256 stepLeft = _mm256_set1_ps(step[0]);
+    const __m256 stepRight = _mm256_set1_ps(step[1]);
+    for (uint32_t frame = 0; frame < frameCount; frame += 8) {
+        __m256 position = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(frame)), lanes);
+        __m256 sample = _mm256_loadu_ps(samples + frame);
+        __m256 gainLeft = _mm256_add_ps(startLeft, _mm256_mul_ps(stepLeft, position));
+        __m256 gainRight = _mm256_add_ps(startRight, _mm256_mul_ps(stepRight, position));
+        _mm256_storeu_ps(left + frame, _mm256_add_ps(_mm256_loadu_ps(left + frame), _mm256_mul_ps(sample, gainLeft)));
+        _mm256_storeu_ps(right + frame, _mm256_add_ps(_mm256_loadu_ps(right + frame), _mm256_mul_ps(sample, gainRight)));
+    }
+}
+#else
+void AudioMixer::MixVoiceSimd(const float* samples, uint32_t frameCount, const float start[2], const float step[2]) {
+    MixVoiceScalar(samples, frameCount, start, step);
+}
+#endif
+
+void AudioMixer::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+bool AudioMixer::IsSimdSupported() {
+    return CpuHasAvx2();
+}
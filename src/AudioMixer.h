@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "MathTypes.h"
+#include "SpscQueue.h"
+
+class AudioSink;
+
+// Mixes one-shot sounds on a dedicated thread. The game thread sends Play and
+// listener updates through a lock-free single-producer queue, which the mixer
+// drains at the start of every block, so a sound starts at most one block
+// (5.3 ms) after the call plus whatever the sink buffers.
+//
+// Voices are positional, attenuated by distance and panned with constant power
+// along the listener's right vector, or local to the listener. Gains ramp
+// across each block so moving sources do not click. When every voice is busy
+// a new sound takes the voice with the lowest priority, then the quietest; the
+// stolen sound fades out over one block. Mixing has an AVX2 path, 8 frames per
+// step, that gives the same output as the scalar path.
+class AudioMixer {
+public:
+    struct Stats {
+        uint32_t activeVoices;
+        uint64_t blocks;
+        uint64_t stolenVoices;
+        uint64_t droppedSounds;         // No voice could be stolen for them
+        uint64_t rejectedCommands;      // The queue was full
+        double lastMixMicroseconds;
+        double maxMixMicroseconds;
+        double maxStartLatencyMicroseconds;  // From Play until the sound's first block is mixed
+    };
+
+    AudioMixer();
+    ~AudioMixer();
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    bool Initialize(uint32_t voiceCount = DEFAULT_VOICES, uint32_t commandCapacity = DEFAULT_COMMANDS);
+    // Copies mono samples at SAMPLE_RATE; only before Start. Returns INVALID_SOUND on failure.
+    uint32_t AddSound(const float* samples, uint32_t frameCount);
+
+    // Opens sink and mixes into it on a new thread until Shutdown, which closes it
+    bool Start(AudioSink* sink);
+    void Shutdown();
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    // Game thread only; false when the command queue is full
+    bool Play(uint32_t sound, const Float3& position, float volume = 1.0f, uint8_t priority = 128);
+    bool PlayLocal(uint32_t sound, float volume = 1.0f, uint8_t priority = 128);
+    bool SetListener(const Float3& position, const Float3& right);
+    bool StopAll();
+
+    // Mixes the next BLOCK_FRAMES interleaved stereo frames on the calling
+    // thread, for offline rendering; never while the mixer thread runs
+    void MixBlock(float* frames);
+
+    Stats GetStats() const;
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    // Constants
+    static constexpr uint32_t SAMPLE_RATE = 48000;
+    static constexpr uint32_t BLOCK_FRAMES = 256;
+    static constexpr uint32_t DEFAULT_VOICES = 256;
+    static constexpr uint32_t DEFAULT_COMMANDS = 1024;
+    static constexpr uint32_t INVALID_SOUND = 0xFFFFFFFF;
+
+private:
+    enum class CommandType : uint32_t { Play, PlayLocal, Listener, StopAll };
+
+    struct Command {
+        CommandType type;
+        uint32_t sound;
+        Float3 position;
+        Float3 right;           // Listener only
+        float volume;
+        uint32_t priority;
+        int64_t sentNanoseconds;
+    };
+
+    struct Sound {
+        size_t offset;          // Into m_samples
+        uint32_t frameCount;
+    };
+
+    struct Voice {
+        uint32_t sound;
+        uint32_t cursor;        // Next frame to mix
+        Float3 position;
+        float volume;
+        uint32_t priority;
+        bool positional;
+        float gains[2];         // Left and right at the end of the last block
+        int64_t sentNanoseconds;  // Until the first block, for the latency stat
+    };
+
+    std::vector<float> m_samples;
+    std::vector<Sound> m_sounds;
+    std::vector<Voice> m_voices;
+    uint32_t m_activeCount;            // m_voices[0, m_activeCount) are playing
+    std::vector<Voice> m_fading;       // Stolen voices, silenced over one block
+    uint32_t m_fadingCount;
+    Float3 m_listenerPosition;
+    Float3 m_listenerRight;
+    std::vector<float> m_mix[2];       // Planar left and right for the current block
+    std::vector<float> m_output;       // Interleaved block for the sink
+
+    SpscQueue<Command> m_commands;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    AudioSink* m_sink;
+    bool m_useSimd;
+
+    // Written by whichever thread mixes, read by GetStats
+    std::atomic<uint32_t> m_statActiveVoices;
+    std::atomic<uint64_t> m_statBlocks;
+    std::atomic<uint64_t> m_statStolen;
+    std::atomic<uint64_t> m_statDropped;
+    std::atomic<uint64_t> m_statRejected;
+    std::atomic<int64_t> m_statLastMixNanoseconds;
+    std::atomic<int64_t> m_statMaxMixNanoseconds;
+    std::atomic<int64_t> m_statMaxLatencyNanoseconds;
+
+    bool Send(const Command& command);
+    void ThreadMain();
+    void Apply(const Command& command);
+    void StartVoice(const Command& command);
+    void ComputeGains(const Voice& voice, float gains[2]) const;
+    // Adds frameCount samples to left and right, ramping each gain from start by step per frame
+    void MixVoice(const float* samples, uint32_t frameCount, const float start[2], const float step[2]);
+    void MixVoiceScalar(const float* samples, uint32_t frameCount, const float start[2], const float step[2]);
+    void MixVoiceSimd(const float* samples, uint32_t frameCount, const float start[2], const float step[2]);
+
+    // Constants
+    static constexpr uint32_t MAX_FADING_VOICES = 32;
+    static constexpr float REFERENCE_DISTANCE = 2.0f;  // Metres; full volume inside
+    static constexpr float ROLLOFF = 1.0f;
+    static constexpr float MAX_DISTANCE = 150.0f;       // Silent beyond
+};
@@ -0,0 +1,100 @@
+#include "AudioSink.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+NullAudioSink::NullAudioSink(bool realTime) :
+    m_realTime(realTime),
+    m_sampleRate(0),
+    m_framesWritten(0) {
+}
+
+bool NullAudioSink::Open(uint32_t sampleRate) {
+    if (sampleRate == 0) return false;
+    m_sampleRate = sampleRate;
+    m_framesWritten = 0;
+    m_start = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool NullAudioSink::Write(const float* frames, uint32_t frameCount) {
+    (void)frames;
+    if (m_realTime && m_framesWritten + frameCount > BUFFER_FRAMES) {
+        // Wait until playback has drained enough of the buffer for these frames
+        uint64_t playedBy = m_framesWritten + frameCount - BUFFER_FRAMES;
+        std::this_thread::sleep_until(m_start + std::chrono::microseconds(playedBy * 1000000 / m_sampleRate));
+    }
+    m_framesWritten += frameCount;
+    return true;
+}
+
+WavAudioSink::WavAudioSink(const char* path) :
+    m_path(path),
+    m_file(nullptr),
+    m_sampleRate(0),
+    m_framesWritten(0) {
+}
+
+WavAudioSink::~WavAudioSink() {
+    Close();
+}
+
+bool WavAudioSink::Open(uint32_t sampleRate) {
+    Close();
+    m_file = fopen(m_path.c_str(), "wb");
+    if (!m_file) return false;
+    m_sampleRate = sampleRate;
+    m_framesWritten = 0;
+    return WriteHeader();
+}
+
+bool WavAudioSink::Write(const float* frames, uint32_t frameCount) {
+    if (!m_file) return false;
+    int16_t converted[CONVERT_FRAMES * 2];
+    for (uint32_t first = 0; first < frameCount; first += CONVERT_FRAMES) {
+        uint32_t count = (std::min)(CONVERT_FRAMES, frameCount - first);
+        for (uint32_t i = 0; i < count * 2; ++i) {
+            float sample = (std::max)(-1.0f, (std::min)(1.0f, frames[first * 2 + i]));
+            converted[i] = static_cast<int16_t>(sample * 32767.0f);
+        }
+        if (fwrite(converted, sizeof(int16_t) * 2, count, m_file) != count) return false;
+    }
+    m_framesWritten += frameCount;
+    return true;
+}
+
+void WavAudioSink::Close() {
+    if (!m_file) return;
+    fseek(m_file, 0, SEEK_SET);
+    WriteHeader();
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+bool WavAudioSink::WriteHeader() {
+    // Little-endian RIFF header for 16-bit stereo PCM
+    const uint32_t channels = 2;
+    const uint32_t bytesPerFrame = channels * sizeof(int16_t);
+    uint32_t dataBytes = static_cast<uint32_t>((std::min)(m_framesWritten * bytesPerFrame, uint64_t(0xFFFFFFFF) - 36));
+    uint8_t header[44];
+    auto put32 = [&](size_t offset, uint32_t value) {
+        for (int i = 0; i < 4; ++i) header[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    };
+    auto put16 = [&](size_t offset, uint32_t value) {
+        header[offset] = static_cast<uint8_t>(value);
+        header[offset + 1] = static_cast<uint8_t>(value >> 8);
+    };
+    memcpy(header, "RIFF", 4);
+    put32(4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);  // PCM
+    put16(22, channels);
+    put32(24, m_sampleRate);
+    put32(28, m_sampleRate * bytesPerFrame);
+    put16(32, bytesPerFrame);
+    put16(34, 16);
+    memcpy(header + 36, "data", 4);
+    put32(40, dataBytes);
+    return fwrite(header, sizeof(header), 1, m_file) == 1;
+}
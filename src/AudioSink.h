@@ -0,0 +1,64 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Destination of the mixer's output: interleaved stereo float frames
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+
+    virtual bool Open(uint32_t sampleRate) = 0;
+    // A sink that plays in real time blocks here until it has room, which
+    // paces the mixer thread
+    virtual bool Write(const float* frames, uint32_t frameCount) = 0;
+    virtual void Close() = 0;
+};
+
+// Discards audio. In real time it accepts frames at the sample rate with a
+// device-like buffer, so the mixer runs as it would against a sound card.
+class NullAudioSink : public AudioSink {
+public:
+    explicit NullAudioSink(bool realTime = true);
+
+    bool Open(uint32_t sampleRate) override;
+    bool Write(const float* frames, uint32_t frameCount) override;
+    void Close() override {}
+
+    uint64_t GetFramesWritten() const { return m_framesWritten; }
+
+private:
+    bool m_realTime;
+    uint32_t m_sampleRate;
+    uint64_t m_framesWritten;
+    std::chrono::steady_clock::time_point m_start;
+
+    // Constants
+    static constexpr uint32_t BUFFER_FRAMES = 1024;  // Queued ahead of playback, about 21 ms at 48 kHz
+};
+
+// Writes 16-bit stereo PCM to a WAV file as fast as frames arrive
+class WavAudioSink : public AudioSink {
+public:
+    explicit WavAudioSink(const char* path);
+    ~WavAudioSink() override;
+
+    bool Open(uint32_t sampleRate) override;
+    bool Write(const float* frames, uint32_t frameCount) override;
+    // Fills in the header's sizes
+    void Close() override;
+
+    uint64_t GetFramesWritten() const { return m_framesWritten; }
+
+private:
+    std::string m_path;
+    FILE* m_file;
+    uint32_t m_sampleRate;
+    uint64_t m_framesWritten;
+
+    bool WriteHeader();
+
+    // Constants
+    static constexpr uint32_t CONVERT_FRAMES = 256;  // Converted per fwrite, on the stack
+};
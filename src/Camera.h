@@ -24,6 +24,10 @@ public:
     DirectX::XMFLOAT3 GetForward() const;
     DirectX::XMFLOAT3 GetRight() const;
     DirectX::XMFLOAT3 GetUp() const;
+    float GetFieldOfView() const { return m_fieldOfView; }  // Vertical, in radians
+    float GetAspectRatio() const { return m_aspectRatio; }
+    float GetNearPlane() const { return m_nearPlane; }
+    float GetFarPlane() const { return m_farPlane; }
 
 private:
     // Camera properties
@@ -0,0 +1,306 @@
+#include "ClusteredLighting.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ClusteredLighting::ClusteredLighting() :
+    m_tilesX(0),
+    m_tilesY(0),
+    m_slices(0),
+    m_maxIndices(0),
+    m_tanHalfFovX(1.0f),
+    m_tanHalfFovY(1.0f),
+    m_nearPlane(0.1f),
+    m_farPlane(1000.0f),
+    m_useSimd(IsSimdSupported()),
+    m_lightCount(0),
+    m_stats() {
+}
+
+ClusteredLighting::~ClusteredLighting() {
+}
+
+bool ClusteredLighting::Initialize(uint32_t tilesX, uint32_t tilesY, uint32_t slices, uint32_t maxIndices) {
+    if (tilesX == 0 || tilesY == 0 || slices == 0 || maxIndices == 0) return false;
+
+    m_tilesX = tilesX;
+    m_tilesY = tilesY;
+    m_slices = slices;
+    m_maxIndices = maxIndices;
+    m_clusters.assign(static_cast<size_t>(tilesX) * tilesY * slices, Cluster());
+    m_indices.reserve(maxIndices);
+    m_sliceRects.resize(slices);
+    m_sliceIndices.resize(slices);
+
+    SetProjection(2.0f * atanf(m_tanHalfFovY), m_tanHalfFovX / m_tanHalfFovY, m_nearPlane, m_farPlane);
+    return true;
+}
+
+bool ClusteredLighting::IsSimdSupported() {
+    return CpuHasAvx2();
+}
+
+void ClusteredLighting::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+void ClusteredLighting::SetProjection(float verticalFieldOfView, float aspectRatio, float nearPlane, float farPlane) {
+    m_tanHalfFovY = tanf(verticalFieldOfView * 0.5f);
+    m_tanHalfFovX = m_tanHalfFovY * aspectRatio;
+    m_nearPlane = nearPlane;
+    m_farPlane = farPlane;
+
+    // Exponential slices keep clusters roughly cubic at every distance
+    m_sliceNear.resize(m_slices);
+    m_sliceFar.resize(m_slices);
+    const float ratio = farPlane / nearPlane;
+    for (uint32_t slice = 0; slice < m_slices; ++slice) {
+        m_sliceNear[slice] = nearPlane * powf(ratio, static_cast<float>(slice) / m_slices) * (1.0f - SLICE_OVERLAP);
+        m_sliceFar[slice] = nearPlane * powf(ratio, static_cast<float>(slice + 1) / m_slices) * (1.0f + SLICE_OVERLAP);
+    }
+}
+
+uint32_t ClusteredLighting::GetSlice(float viewZ) const {
+    ShaderConstants constants = GetShaderConstants(1.0f, 1.0f);
+    float slice = floorf(logf(std::max(viewZ, m_nearPlane)) * constants.sliceScale + constants.sliceBias);
+    return static_cast<uint32_t>(std::min(std::max(slice, 0.0f), static_cast<float>(m_slices - 1)));
+}
+
+ClusteredLighting::ShaderConstants ClusteredLighting::GetShaderConstants(float viewportWidth, float viewportHeight) const {
+    const float logRatio = logf(m_farPlane / m_nearPlane);
+
+    ShaderConstants constants;
+    constants.tilesX = m_tilesX;
+    constants.tilesY = m_tilesY;
+    constants.slices = m_slices;
+    constants.lightCount = static_cast<uint32_t>(m_gpuLights.size());
+    constants.tilesPerPixelX = m_tilesX / viewportWidth;
+    constants.tilesPerPixelY = m_tilesY / viewportHeight;
+    constants.sliceScale = m_slices / logRatio;
+    constants.sliceBias = -(m_slices * logf(m_nearPlane)) / logRatio;
+    return constants;
+}
+
+void ClusteredLighting::Build(const PointLight* lights, uint32_t lightCount, const Float4x4& view, JobSystem* jobs) {
+    m_stats = {};
+    m_stats.lights = lightCount;
+    m_lightCount = std::min(lightCount, MAX_LIGHTS);
+    m_stats.droppedLights = lightCount - m_lightCount;
+
+    // Padding lanes sit behind the camera with no radius, so they never pass the slice test
+    const size_t padded = (m_lightCount + 7) & ~7u;
+    m_lightX.assign(padded, 0.0f);
+    m_lightY.assign(padded, 0.0f);
+    m_lightZ.assign(padded, -1.0f);
+    m_lightRadius.assign(padded, 0.0f);
+    m_gpuLights.resize(m_lightCount);
+
+    for (uint32_t i = 0; i < m_lightCount; ++i) {
+        const PointLight& light = lights[i];
+        Float3 position = TransformPoint(light.position, view);
+        m_lightX[i] = position.x;
+        m_lightY[i] = position.y;
+        m_lightZ[i] = position.z;
+        m_lightRadius[i] = light.radius;
+        m_gpuLights[i].positionRadius = { position.x, position.y, position.z, light.radius };
+        m_gpuLights[i].colorIntensity = { light.color.x, light.color.y, light.color.z, light.intensity };
+    }
+
+    // Slices own disjoint clusters and scratch lists, so they bin independently
+    if (jobs && m_lightCount >= PARALLEL_MIN_LIGHTS) {
+        jobs->ParallelFor(m_slices, 1, [this](size_t begin, size_t end, uint32_t) {
+            for (size_t slice = begin; slice < end; ++slice) {
+                BinSlice(static_cast<uint32_t>(slice));
+            }
+        });
+    } else {
+        for (uint32_t slice = 0; slice < m_slices; ++slice) {
+            BinSlice(slice);
+        }
+    }
+
+    // Concatenate the per-slice lists in cluster order, within the index budget
+    m_indices.clear();
+    m_lightVisible.assign(m_lightCount, 0);
+    const uint32_t clustersPerSlice = m_tilesX * m_tilesY;
+    for (uint32_t slice = 0; slice < m_slices; ++slice) {
+        const std::vector<uint32_t>& sliceIndices = m_sliceIndices[slice];
+        for (const LightRect& rect : m_sliceRects[slice]) {
+            m_lightVisible[rect.light] = 1;
+        }
+
+        Cluster* clusters = &m_clusters[static_cast<size_t>(slice) * clustersPerSlice];
+        for (uint32_t i = 0; i < clustersPerSlice; ++i) {
+            Cluster& cluster = clusters[i];
+            uint32_t keep = std::min(cluster.count, m_maxIndices - static_cast<uint32_t>(m_indices.size()));
+            m_indices.insert(m_indices.end(), sliceIndices.begin() + cluster.offset,
+                             sliceIndices.begin() + cluster.offset + keep);
+            m_stats.droppedIndices += cluster.count - keep;
+            m_stats.maxLightsPerCluster = std::max(m_stats.maxLightsPerCluster, keep);
+            if (keep > 0) m_stats.occupiedClusters++;
+            cluster.offset = static_cast<uint32_t>(m_indices.size()) - keep;
+            cluster.count = keep;
+        }
+    }
+
+    for (uint8_t visible : m_lightVisible) {
+        m_stats.visibleLights += visible;
+    }
+    m_stats.indices = static_cast<uint32_t>(m_indices.size());
+}
+
+void ClusteredLighting::BinSlice(uint32_t slice) {
+    std::vector<LightRect>& rects = m_sliceRects[slice];
+    rects.clear();
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        FindRectsSimd(slice, rects);
+    } else {
+        FindRectsScalar(slice, rects);
+    }
+#else
+    FindRectsScalar(slice, rects);
+#endif
+
+    // Count, prefix sum, then fill; offsets are local to the slice until the merge
+    Cluster* clusters = &m_clusters[static_cast<size_t>(slice) * m_tilesX * m_tilesY];
+    std::memset(clusters, 0, sizeof(Cluster) * m_tilesX * m_tilesY);
+    for (const LightRect& rect : rects) {
+        for (int32_t y = rect.minY; y <= rect.maxY; ++y) {
+            for (int32_t x = rect.minX; x <= rect.maxX; ++x) {
+                clusters[y * m_tilesX + x].count++;
+            }
+        }
+    }
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < m_tilesX * m_tilesY; ++i) {
+        clusters[i].offset = total;
+        total += clusters[i].count;
+        clusters[i].count = 0;
+    }
+
+    std::vector<uint32_t>& indices = m_sliceIndices[slice];
+    indices.resize(total);
+    for (const LightRect& rect : rects) {
+        for (int32_t y = rect.minY; y <= rect.maxY; ++y) {
+            for (int32_t x = rect.minX; x <= rect.maxX; ++x) {
+                Cluster& cluster = clusters[y * m_tilesX + x];
+                indices[cluster.offset + cluster.count++] = rect.light;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::FindRectsScalar(uint32_t slice, std::vector<LightRect>& rects) const {
+    const float sliceNear = m_sliceNear[slice];
+    const float sliceFar = m_sliceFar[slice];
+    const float tilesX = static_cast<float>(m_tilesX);
+    const float tilesY = static_cast<float>(m_tilesY);
+    const float xScale = tilesX / (2.0f * m_tanHalfFovX);
+    const float xBias = tilesX * 0.5f;
+    const float yScale = tilesY / (2.0f * m_tanHalfFovY);
+    const float yBias = tilesY * 0.5f;
+
+    for (uint32_t i = 0; i < m_lightCount; ++i) {
+        float z = m_lightZ[i];
+        float r = m_lightRadius[i];
+
+        // Depth range of the sphere inside this slice
+        float a = std::max(z - r, sliceNear);
+        float b = std::min(z + r, sliceFar);
+        if (!(a <= b) || !(r > 0.0f)) continue;
+
+        // Widest cross-section of the sphere within [a, b]
+        float dz = std::max(std::max(a - z, z - b), 0.0f);
+        float rr = std::sqrt(std::max(r * r - dz * dz, 0.0f));
+        float xLo = m_lightX[i] - rr;
+        float xHi = m_lightX[i] + rr;
+        float yLo = m_lightY[i] - rr;
+        float yHi = m_lightY[i] + rr;
+
+        // Extreme slopes over the depth range, then tiles; rows count down from the top
+        float columnLo = std::min(xLo / a, xLo / b) * xScale + xBias;
+        float columnHi = std::max(xHi / a, xHi / b) * xScale + xBias;
+        float rowLo = yBias - std::max(yHi / a, yHi / b) * yScale;
+        float rowHi = yBias - std::min(yLo / a, yLo / b) * yScale;
+        if (!(columnHi >= 0.0f) || !(columnLo < tilesX) || !(rowHi >= 0.0f) || !(rowLo < tilesY)) continue;
+
+        LightRect rect;
+        rect.light = i;
+        rect.minX = static_cast<int32_t>(std::max(columnLo, 0.0f));
+        rect.maxX = static_cast<int32_t>(std::min(columnHi, tilesX - 1.0f));
+        rect.minY = static_cast<int32_t>(std::max(rowLo, 0.0f));
+        rect.maxY = static_cast<int32_t>(std::min(rowHi, tilesY - 1.0f));
+        rects.push_back(rect);
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void ClusteredLighting::FindRectsSimd(uint32_t slice, std::vector<LightRect>& rects) const {
+    const float tilesXf = static_cast<float>(m_tilesX);
+    const float tilesYf = static_cast<float>(m_tilesY);
+    const __m256 sliceNear = _mm256_set1_ps(m_sliceNear[slice]);
+    const __m256 sliceFar = _mm256_set1_ps(m_sliceFar[slice]);
+    const __m256 tilesX = _mm256_set1_ps(tilesXf);
+    const __m256 tilesY = _mm256_set1_ps(tilesYf);
+    const __m256 maxColumn = _mm256_set1_ps(tilesXf - 1.0f);
+    const __m256 maxRow = _mm256_set1_ps(tilesYf - 1.0f);
+    const __m256 xScale = _mm256_set1_ps(tilesXf / (2.0f * m_tanHalfFovX));
+    const __m256 xBias = _mm256_set1_ps(tilesXf * 0.5f);
+    const __m256 yScale = _mm256_set1_ps(tilesYf / (2.0f * m_tanHalfFovY));
+    const __m256 yBias = _mm256_set1_ps(tilesYf * 0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    alignas(32) int32_t minX[8], maxX[8], minY[8], maxY[8];
+    const uint32_t padded = (m_lightCount + 7) & ~7u;
+    for (uint32_t i = 0; i < padded; i += 8) {
+        __m256 z = _mm256_loadu_ps(&m_lightZ[i]);
+        __m256 r = _mm256_loadu_ps(&m_lightRadius[i]);
+
+        __m256 a = _mm256_max_ps(_mm256_sub_ps(z, r), sliceNear);
+        __m256 b = _mm256_min_ps(_mm256_add_ps(z, r), sliceFar);
+        __m256 active = _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ), _mm256_cmp_ps(r, zero, _CMP_GT_OQ));
+        if (_mm256_movemask_ps(active) == 0) continue;
+
+        __m256 dz = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(a, z), _mm256_sub_ps(z, b)), zero);
+        __m256 rr = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(dz, dz)), zero));
+        __m256 x = _mm256_loadu_ps(&m_lightX[i]);
+        __m256 y = _mm256_loadu_ps(&m_lightY[i]);
+        __m256 xLo = _mm256_sub_ps(x, rr);
+        __m256 xHi = _mm256_add_ps(x, rr);
+        __m256 yLo = _mm256_sub_ps(y, rr);
+        __m256 yHi = _mm256_add_ps(y, rr);
+
+        __m256 columnLo = _mm256_add_ps(_mm256_mul_ps(_mm256_min_ps(_mm256_div_ps(xLo, a), _mm256_div_ps(xLo, b)), xScale), xBias);
+        __m256 columnHi = _mm256_add_ps(_mm256_mul_ps(_mm256_max_ps(_mm256_div_ps(xHi, a), _mm256_div_ps(xHi, b)), xScale), xBias);
+        __m256 rowLo = _mm256_sub_ps(yBias, _mm256_mul_ps(_mm256_max_ps(_mm256_div_ps(yHi, a), _mm256_div_ps(yHi, b)), yScale));
+        __m256 rowHi = _mm256_sub_ps(yBias, _mm256_mul_ps(_mm256_min_ps(_mm256_div_ps(yLo, a), _mm256_div_ps(yLo, b)), yScale));
+
+        active = _mm256_and_ps(active, _mm256_cmp_ps(columnHi, zero, _CMP_GE_OQ));
+        active = _mm256_and_ps(active, _mm256_cmp_ps(columnLo, tilesX, _CMP_LT_OQ));
+        active = _mm256_and_ps(active, _mm256_cmp_ps(rowHi, zero, _CMP_GE_OQ));
+        active = _mm256_and_ps(active, _mm256_cmp_ps(rowLo, tilesY, _CMP_LT_OQ));
+        int mask = _mm256_movemask_ps(active);
+        if (mask == 0) continue;
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(minX), _mm256_cvttps_epi32(_mm256_max_ps(columnLo, zero)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(maxX), _mm256_cvttps_epi32(_mm256_min_ps(columnHi, maxColumn)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(minY), _mm256_cvttps_epi32(_mm256_max_ps(rowLo, zero)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(maxY), _mm256_cvttps_epi32(_mm256_min_ps(rowHi, maxRow)));
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            mask &= mask - 1;
+            rects.push_back({ i + lane, minX[lane], maxX[lane], minY[lane], maxY[lane] });
+        }
+    }
+}
+#else
+void ClusteredLighting::FindRectsSimd(uint32_t slice, std::vector<LightRect>& rects) const {
+    FindRectsScalar(slice, rects);
+}
+#endif
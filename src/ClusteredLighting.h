@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+class JobSystem;
+
+// Dynamic point light in world space
+struct PointLight {
+    Float3 position;
+    float radius;      // Influence ends here
+    Float3 color;
+    float intensity;
+};
+
+// Bins point lights into a view-space froxel grid: screen tiles in x and y and
+// exponentially spaced depth slices in z. Each pixel then only shades the
+// lights listed for its cluster. View space looks down +z (DirectXMath
+// convention); pass a view matrix with that handedness.
+//
+// Slices are binned independently, on the job system when one is given. The
+// sphere-versus-slice test has an AVX2 path (8 lights per step) and a scalar
+// path that evaluate the same expressions, so both produce identical lists.
+class ClusteredLighting {
+public:
+    struct Cluster {
+        uint32_t offset;  // Into the light index list
+        uint32_t count;
+    };
+
+    // Layout of the structured buffer read by the pixel shader
+    struct GpuLight {
+        Float4 positionRadius;   // View space
+        Float4 colorIntensity;
+    };
+
+    // Layout of the ClusterBuffer constant buffer
+    struct ShaderConstants {
+        uint32_t tilesX;
+        uint32_t tilesY;
+        uint32_t slices;
+        uint32_t lightCount;
+        float tilesPerPixelX;
+        float tilesPerPixelY;
+        float sliceScale;   // slice = log(viewZ) * sliceScale + sliceBias
+        float sliceBias;
+    };
+
+    struct Stats {
+        uint32_t lights;
+        uint32_t visibleLights;     // Lights touching at least one cluster
+        uint32_t indices;
+        uint32_t occupiedClusters;
+        uint32_t maxLightsPerCluster;
+        uint32_t droppedLights;     // Over MAX_LIGHTS
+        uint32_t droppedIndices;    // Over the index budget
+    };
+
+    ClusteredLighting();
+    ~ClusteredLighting();
+
+    bool Initialize(uint32_t tilesX = 16, uint32_t tilesY = 9, uint32_t slices = 24,
+                    uint32_t maxIndices = DEFAULT_MAX_INDICES);
+
+    // Vertical field of view in radians
+    void SetProjection(float verticalFieldOfView, float aspectRatio, float nearPlane, float farPlane);
+
+    void Build(const PointLight* lights, uint32_t lightCount, const Float4x4& view, JobSystem* jobs = nullptr);
+
+    // Slice a view-space depth falls in, using the shader's formula
+    uint32_t GetSlice(float viewZ) const;
+    uint32_t GetClusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice) const {
+        return (slice * m_tilesY + tileY) * m_tilesX + tileX;
+    }
+    ShaderConstants GetShaderConstants(float viewportWidth, float viewportHeight) const;
+
+    const std::vector<Cluster>& GetClusters() const { return m_clusters; }
+    const std::vector<uint32_t>& GetLightIndices() const { return m_indices; }
+    const std::vector<GpuLight>& GetGpuLights() const { return m_gpuLights; }
+    uint32_t GetTilesX() const { return m_tilesX; }
+    uint32_t GetTilesY() const { return m_tilesY; }
+    uint32_t GetSliceCount() const { return m_slices; }
+    uint32_t GetMaxIndices() const { return m_maxIndices; }
+    const Stats& GetStats() const { return m_stats; }
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    // Constants
+    static constexpr uint32_t MAX_LIGHTS = 4096;
+    static constexpr uint32_t DEFAULT_MAX_INDICES = 128 * 1024;
+
+private:
+    // Tile rectangle a light covers in one slice, inclusive
+    struct LightRect {
+        uint32_t light;
+        int32_t minX, maxX, minY, maxY;
+    };
+
+    uint32_t m_tilesX;
+    uint32_t m_tilesY;
+    uint32_t m_slices;
+    uint32_t m_maxIndices;
+    float m_tanHalfFovX;
+    float m_tanHalfFovY;
+    float m_nearPlane;
+    float m_farPlane;
+    bool m_useSimd;
+
+    // View-space lights as structure of arrays, padded to a multiple of 8
+    std::vector<float> m_lightX;
+    std::vector<float> m_lightY;
+    std::vector<float> m_lightZ;
+    std::vector<float> m_lightRadius;
+    uint32_t m_lightCount;
+
+    std::vector<float> m_sliceNear;
+    std::vector<float> m_sliceFar;
+    std::vector<std::vector<LightRect>> m_sliceRects;
+    std::vector<std::vector<uint32_t>> m_sliceIndices;
+    std::vector<uint8_t> m_lightVisible;
+
+    std::vector<Cluster> m_clusters;
+    std::vector<uint32_t> m_indices;
+    std::vector<GpuLight> m_gpuLights;
+    Stats m_stats;
+
+    void BinSlice(uint32_t slice);
+    void FindRectsScalar(uint32_t slice, std::vector<LightRect>& rects) const;
+    void FindRectsSimd(uint32_t slice, std::vector<LightRect>& rects) const;
+
+    // Constants
+    static constexpr float SLICE_OVERLAP = 1e-3f;          // Relative widening of each slice against rounding in the shader
+    static constexpr uint32_t PARALLEL_MIN_LIGHTS = 64;
+};
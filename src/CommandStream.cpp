@@ -0,0 +1,53 @@
+#include "CommandStream.h"
+
+CommandStream::CommandStream() {
+}
+
+CommandStream::~CommandStream() {
+}
+
+void CommandStream::Reset() {
+    m_commands.clear();
+    m_draws.clear();
+}
+
+void CommandStream::Reserve(size_t drawCount) {
+    m_commands.reserve(drawCount * 2);
+    m_draws.reserve(drawCount);
+}
+
+void CommandStream::SetShader(uint32_t shader) {
+    m_commands.push_back({ OP_SET_SHADER, shader });
+}
+
+void CommandStream::SetMaterial(uint32_t material) {
+    m_commands.push_back({ OP_SET_MATERIAL, material });
+}
+
+void CommandStream::SetMesh(uint32_t mesh) {
+    m_commands.push_back({ OP_SET_MESH, mesh });
+}
+
+void CommandStream::Draw(const DrawItem& item) {
+    m_commands.push_back({ OP_DRAW, static_cast<uint32_t>(m_draws.size()) });
+    m_draws.push_back(item);
+}
+
+void CommandStream::Replay(RenderBackend& backend) const {
+    for (const Command& command : m_commands) {
+        switch (command.opcode) {
+        case OP_SET_SHADER:
+            backend.SetShader(command.argument);
+            break;
+        case OP_SET_MATERIAL:
+            backend.SetMaterial(command.argument);
+            break;
+        case OP_SET_MESH:
+            backend.SetMesh(command.argument);
+            break;
+        case OP_DRAW:
+            backend.Draw(m_draws[command.argument]);
+            break;
+        }
+    }
+}
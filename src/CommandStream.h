@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RenderQueue.h"
+
+// API-neutral command buffer. Worker threads record into their own stream
+// through the RenderBackend interface and the owning graphics thread replays
+// the streams in order against the real backend.
+class CommandStream : public RenderBackend {
+public:
+    CommandStream();
+    ~CommandStream();
+
+    void Reset();
+    void Reserve(size_t drawCount);
+
+    // RenderBackend
+    void SetShader(uint32_t shader) override;
+    void SetMaterial(uint32_t material) override;
+    void SetMesh(uint32_t mesh) override;
+    void Draw(const DrawItem& item) override;
+
+    void Replay(RenderBackend& backend) const;
+
+    size_t GetCommandCount() const { return m_commands.size(); }
+    size_t GetDrawCount() const { return m_draws.size(); }
+
+private:
+    enum Opcode : uint32_t {
+        OP_SET_SHADER,
+        OP_SET_MATERIAL,
+        OP_SET_MESH,
+        OP_DRAW
+    };
+
+    struct Command {
+        Opcode opcode;
+        uint32_t argument;  // State id, or index into m_draws
+    };
+
+    std::vector<Command> m_commands;
+    std::vector<DrawItem> m_draws;
+};
@@ -0,0 +1,31 @@
+#include "CpuFeatures.h"
+#if FPSGAME_AVX2 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    bool DetectAvx2() {
+#if FPSGAME_AVX2
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        // The OS must save the YMM registers on context switches
+        return avx2 && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+#else
+        return false;
+#endif
+    }
+}
+
+bool CpuHasAvx2() {
+    static const bool supported = DetectAvx2();
+    return supported;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// SIMD support shared by the modules with AVX2 paths.
+//
+// FPSGAME_AVX2 is 1 when the build has AVX2 paths (FPSGAME_ENABLE_AVX2 on
+// x64). Functions using AVX2 intrinsics are marked FPSGAME_AVX2_TARGET, so
+// only they are compiled for AVX2 and the rest of the build still runs on any
+// x64 CPU; call them only when CpuHasAvx2() is true.
+#if defined(FPSGAME_ENABLE_AVX2) && (defined(__x86_64__) || defined(_M_X64))
+#define FPSGAME_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define FPSGAME_AVX2_TARGET
+#else
+#define FPSGAME_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define FPSGAME_AVX2 0
+#endif
+
+// The CPU and OS both support AVX2 and this build has AVX2 paths; detected once
+bool CpuHasAvx2();
@@ -0,0 +1,221 @@
+#include "D3D11ConstantRing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+    // DXGI queues at most three frames by default, so waits should be rare
+    constexpr UINT FRAMES_IN_FLIGHT = 4;
+}
+
+D3D11ConstantRing::D3D11ConstantRing() :
+    m_oldestQuery(0),
+    m_flushStart(0),
+    m_flushEnd(0),
+    m_discardPending(true),
+    m_bytesRequested(0) {
+}
+
+D3D11ConstantRing::~D3D11ConstantRing() {
+}
+
+bool D3D11ConstantRing::Initialize(ID3D11Device* device, ID3D11DeviceContext* context, UINT capacity) {
+    if (!device || !context) return false;
+
+    // Offset binding needs an 11.1 context and driver support
+    HRESULT hr = context->QueryInterface(__uuidof(ID3D11DeviceContext1),
+                                         reinterpret_cast<void**>(m_context.GetAddressOf()));
+    if (FAILED(hr)) return false;
+
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+    if (FAILED(hr) || !options.ConstantBufferOffsetting) {
+        m_context.Reset();
+        return false;
+    }
+
+    capacity = (capacity + CONSTANT_ALIGNMENT - 1) / CONSTANT_ALIGNMENT * CONSTANT_ALIGNMENT;
+    if (!m_allocator.Initialize(capacity, CONSTANT_ALIGNMENT, FRAMES_IN_FLIGHT)) return false;
+
+    m_device = device;
+    if (!CreateBuffer(capacity)) return false;
+
+    D3D11_QUERY_DESC qd = {};
+    qd.Query = D3D11_QUERY_EVENT;
+    m_frameQueries.assign(FRAMES_IN_FLIGHT, nullptr);
+    for (ComPtr<ID3D11Query>& query : m_frameQueries) {
+        hr = device->CreateQuery(&qd, query.GetAddressOf());
+        if (FAILED(hr)) {
+            m_buffer.Reset();
+            return false;
+        }
+    }
+    m_oldestQuery = 0;
+
+    m_shadow.assign(capacity, 0);
+    m_flushStart = 0;
+    m_flushEnd = 0;
+    m_discardPending = true;
+    m_bytesRequested = 0;
+    return true;
+}
+
+bool D3D11ConstantRing::CreateBuffer(UINT capacity) {
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = capacity;
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    ComPtr<ID3D11Buffer> buffer;
+    HRESULT hr = m_device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf());
+    if (FAILED(hr)) return false;
+
+    m_buffer = buffer;
+    return true;
+}
+
+void D3D11ConstantRing::Grow(UINT required) {
+    // Twice the need, so the ring still wraps and orphans at most every other frame
+    UINT capacity = m_allocator.GetCapacity();
+    while (capacity < MAX_CAPACITY && capacity < required * 2ull) {
+        capacity = (std::min)(capacity * 2, MAX_CAPACITY);
+    }
+    if (capacity == m_allocator.GetCapacity() || !CreateBuffer(capacity)) return;
+
+    // Draws already submitted keep a reference to the old buffer
+    m_allocator.Resize(capacity);
+    m_shadow.assign(capacity, 0);
+    m_oldestQuery = 0;
+    m_flushStart = 0;
+    m_flushEnd = 0;
+    m_discardPending = true;
+}
+
+void D3D11ConstantRing::BeginFrame() {
+    RetireCompletedFrames();
+    m_allocator.BeginFrame();
+
+    // The last frame fell back to UpdateSubresource for what did not fit
+    if (m_bytesRequested + CONSTANT_ALIGNMENT > m_allocator.GetCapacity()) {
+        Grow(m_bytesRequested + CONSTANT_ALIGNMENT);
+    }
+    m_bytesRequested = 0;
+
+    // Orphan the buffer instead of waiting when the next frame might not fit before the end;
+    // the frames in flight keep the old storage, so none of their queries matter any more
+    const FrameRingAllocator::Stats& stats = m_allocator.GetStats();
+    if (m_allocator.GetContiguousSpace() < stats.peakBytesPerFrame + CONSTANT_ALIGNMENT) {
+        m_allocator.Restart();
+        m_oldestQuery = 0;
+        m_discardPending = true;
+    }
+}
+
+bool D3D11ConstantRing::Allocate(UINT size, Allocation& allocation) {
+    UINT alignedSize = (size + 15) & ~15u;
+    m_bytesRequested += (alignedSize + CONSTANT_ALIGNMENT - 1) & ~(CONSTANT_ALIGNMENT - 1);
+
+    UINT offset = 0;
+    while (!m_allocator.Allocate(alignedSize, offset)) {
+        // Only space held by earlier frames can be reclaimed, so waiting must be able to help
+        if (m_allocator.GetFramesInFlight() == 0 || !m_allocator.FitsOnceRetired(alignedSize)) {
+            return false;
+        }
+        WaitForOldestFrame();
+    }
+
+    if (m_flushStart == m_flushEnd) {
+        m_flushStart = offset;
+    }
+    m_flushEnd = offset + alignedSize;
+
+    allocation.data = m_shadow.data() + offset;
+    allocation.firstConstant = offset / 16;
+    // The bound window is rounded up to 16 constants, but must stay inside the buffer
+    UINT remainingConstants = m_allocator.GetCapacity() / 16 - allocation.firstConstant;
+    allocation.numConstants = std::min((alignedSize / 16 + 15) & ~15u, remainingConstants);
+    return true;
+}
+
+void D3D11ConstantRing::Flush() {
+    if (m_flushStart == m_flushEnd) return;
+
+    D3D11_MAP mapType = m_discardPending ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = m_context->Map(m_buffer.Get(), 0, mapType, 0, &mapped);
+    if (FAILED(hr)) return;
+
+    BYTE* destination = static_cast<BYTE*>(mapped.pData);
+    if (m_flushEnd > m_flushStart) {
+        memcpy(destination + m_flushStart, m_shadow.data() + m_flushStart, m_flushEnd - m_flushStart);
+    } else {
+        // Pending allocations lapped the end of the buffer
+        UINT capacity = m_allocator.GetCapacity();
+        memcpy(destination + m_flushStart, m_shadow.data() + m_flushStart, capacity - m_flushStart);
+        memcpy(destination, m_shadow.data(), m_flushEnd);
+    }
+
+    m_context->Unmap(m_buffer.Get(), 0);
+    m_discardPending = false;
+    m_flushStart = m_flushEnd;
+}
+
+void D3D11ConstantRing::EndFrame() {
+    Flush();
+    if (m_allocator.GetFramesInFlight() == m_allocator.GetMaxFramesInFlight()) {
+        WaitForOldestFrame();
+    }
+
+    UINT slot = (m_oldestQuery + m_allocator.GetFramesInFlight()) % static_cast<UINT>(m_frameQueries.size());
+    m_context->End(m_frameQueries[slot].Get());
+    m_allocator.EndFrame();
+}
+
+void D3D11ConstantRing::RetireCompletedFrames() {
+    while (m_allocator.GetFramesInFlight() > 0) {
+        // S_FALSE until the GPU has passed the end of that frame
+        HRESULT hr = m_context->GetData(m_frameQueries[m_oldestQuery].Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        if (hr != S_OK) {
+            return;
+        }
+
+        m_oldestQuery = (m_oldestQuery + 1) % static_cast<UINT>(m_frameQueries.size());
+        m_allocator.RetireOldestFrame();
+    }
+}
+
+void D3D11ConstantRing::WaitForOldestFrame() {
+    ID3D11Query* query = m_frameQueries[m_oldestQuery].Get();
+    HRESULT hr = m_context->GetData(query, nullptr, 0, 0);
+
+    if (hr == S_FALSE) {
+        auto start = std::chrono::steady_clock::now();
+        do {
+            std::this_thread::yield();
+            hr = m_context->GetData(query, nullptr, 0, 0);
+        } while (hr == S_FALSE);
+
+        auto end = std::chrono::steady_clock::now();
+        m_allocator.RecordStall(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    m_oldestQuery = (m_oldestQuery + 1) % static_cast<UINT>(m_frameQueries.size());
+    m_allocator.RetireOldestFrame();
+}
+
+void D3D11ConstantRing::BindVS(UINT slot, const Allocation& allocation) {
+    m_context->VSSetConstantBuffers1(slot, 1, m_buffer.GetAddressOf(),
+                                     &allocation.firstConstant, &allocation.numConstants);
+}
+
+void D3D11ConstantRing::BindVS(ID3D11DeviceContext1* context, UINT slot, const Allocation& allocation) const {
+    context->VSSetConstantBuffers1(slot, 1, m_buffer.GetAddressOf(),
+                                   &allocation.firstConstant, &allocation.numConstants);
+}
+
+void D3D11ConstantRing::BindPS(UINT slot, const Allocation& allocation) {
+    m_context->PSSetConstantBuffers1(slot, 1, m_buffer.GetAddressOf(),
+                                     &allocation.firstConstant, &allocation.numConstants);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "FrameRingAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Per-frame constant buffer ring for D3D11.1. Draw constants are bump-allocated
+// from a CPU shadow, copied in one MAP_NO_OVERWRITE per flush and bound with
+// VSSetConstantBuffers1 offsets. The buffer is orphaned with MAP_DISCARD at a
+// frame boundary when the next frame might not fit. A frame that still runs
+// past the end wraps into space released by an event query per frame, and
+// waiting on one is counted as a stall. A frame that asks for more than the
+// buffer holds falls back for the rest of that frame, and the buffer grows at
+// the next frame boundary so large scenes stay on the offset path.
+class D3D11ConstantRing {
+public:
+    struct Allocation {
+        void* data;
+        UINT firstConstant;  // In 16-byte shader constants
+        UINT numConstants;
+    };
+
+    D3D11ConstantRing();
+    ~D3D11ConstantRing();
+
+    // Returns false if the runtime does not support constant buffer offsets; the
+    // buffer starts at capacity and grows up to MAX_CAPACITY on demand
+    bool Initialize(ID3D11Device* device, ID3D11DeviceContext* context, UINT capacity);
+
+    void BeginFrame();
+    bool Allocate(UINT size, Allocation& allocation);
+    // Copies allocations made since the last flush into the GPU buffer
+    void Flush();
+    void EndFrame();
+
+    void BindVS(UINT slot, const Allocation& allocation);
+    void BindPS(UINT slot, const Allocation& allocation);
+    // For deferred contexts recording on worker threads
+    void BindVS(ID3D11DeviceContext1* context, UINT slot, const Allocation& allocation) const;
+
+    bool IsInitialized() const { return m_buffer != nullptr; }
+    const FrameRingAllocator::Stats& GetStats() const { return m_allocator.GetStats(); }
+
+private:
+    ComPtr<ID3D11Device> m_device;
+    ComPtr<ID3D11DeviceContext1> m_context;
+    ComPtr<ID3D11Buffer> m_buffer;
+    FrameRingAllocator m_allocator;
+    std::vector<BYTE> m_shadow;
+    std::vector<ComPtr<ID3D11Query>> m_frameQueries;  // One per in-flight frame, oldest first
+    UINT m_oldestQuery;
+    UINT m_flushStart;
+    UINT m_flushEnd;
+    bool m_discardPending;
+    UINT m_bytesRequested;  // This frame, including allocations that did not fit
+
+    bool CreateBuffer(UINT capacity);
+    void Grow(UINT required);
+    void RetireCompletedFrames();
+    void WaitForOldestFrame();
+
+    // Offsets must be multiples of 16 constants (256 bytes)
+    static constexpr UINT CONSTANT_ALIGNMENT = 256;
+    // Half of D3D11's 128 MB resource limit, or 262144 draws of 256 bytes
+    static constexpr UINT MAX_CAPACITY = 64 * 1024 * 1024;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <d3d11.h>
+#include <array>
+#include "VertexLayout.h"
+
+// D3D11 side of VertexLayout: the DXGI format each vertex format is read as,
+// and the input elements for a layout, in declaration order
+
+inline DXGI_FORMAT GetDxgiFormat(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+        case VertexFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+        case VertexFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case VertexFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+        case VertexFormat::Unorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case VertexFormat::Octahedral16: return DXGI_FORMAT_R16G16_SNORM;
+    }
+    return DXGI_FORMAT_UNKNOWN;
+}
+
+template <typename Layout>
+std::array<D3D11_INPUT_ELEMENT_DESC, Layout::ELEMENT_COUNT> MakeInputElements(UINT inputSlot = 0) {
+    std::array<D3D11_INPUT_ELEMENT_DESC, Layout::ELEMENT_COUNT> elements = {};
+    for (UINT i = 0; i < Layout::ELEMENT_COUNT; ++i) {
+        const VertexElement& element = Layout::ELEMENTS[i];
+        elements[i] = { GetSemanticName(element.semantic), 0, GetDxgiFormat(element.format), inputSlot,
+                        element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+    }
+    return elements;
+}
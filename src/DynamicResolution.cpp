@@ -0,0 +1,114 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+DynamicResolution::DynamicResolution() :
+    m_targetMilliseconds(16.0f),
+    m_minScale(DEFAULT_MIN_SCALE),
+    m_maxScale(1.0f),
+    m_proportional(DEFAULT_PROPORTIONAL),
+    m_integral(DEFAULT_INTEGRAL),
+    m_derivative(DEFAULT_DERIVATIVE),
+    m_maxIncrease(DEFAULT_MAX_INCREASE),
+    m_pixelFraction(1.0f),
+    m_scale(1.0f),
+    m_lastError(0.0f),
+    m_previousError(0.0f),
+    m_frame(0),
+    m_scaleSum(0.0),
+    m_traceCapacity(0),
+    m_traceNext(0),
+    m_stats() {
+    ResetStats();
+}
+
+bool DynamicResolution::Initialize(float targetMilliseconds, float minScale, float maxScale) {
+    if (!(targetMilliseconds > 0.0f) || !(minScale > 0.0f) || minScale > maxScale) return false;
+
+    m_targetMilliseconds = targetMilliseconds;
+    m_minScale = minScale;
+    m_maxScale = maxScale;
+    Reset();
+    return true;
+}
+
+void DynamicResolution::SetGains(float proportional, float integral, float derivative) {
+    m_proportional = proportional;
+    m_integral = integral;
+    m_derivative = derivative;
+}
+
+void DynamicResolution::Reset() {
+    m_pixelFraction = m_maxScale * m_maxScale;
+    m_scale = m_maxScale;
+    m_lastError = 0.0f;
+    m_previousError = 0.0f;
+}
+
+float DynamicResolution::Update(float frameMilliseconds) {
+    // Relative headroom: positive under budget, negative over it
+    float error = (m_targetMilliseconds - frameMilliseconds) / m_targetMilliseconds;
+    error = std::max(error, -1.0f);
+    if (error > 0.0f && error < HEADROOM) error = 0.0f;
+
+    // Velocity form: the integral term is the step itself, so clamping the output cannot wind up
+    float correction = m_proportional * (error - m_lastError) + m_integral * error +
+                       m_derivative * (error - 2.0f * m_lastError + m_previousError);
+    correction = std::min(correction, m_maxIncrease);
+    m_previousError = m_lastError;
+    m_lastError = error;
+
+    const float minFraction = m_minScale * m_minScale;
+    const float maxFraction = m_maxScale * m_maxScale;
+    m_pixelFraction = std::min(std::max(m_pixelFraction * (1.0f + correction), minFraction), maxFraction);
+
+    float previousScale = m_scale;
+    m_scale = std::sqrt(m_pixelFraction);
+
+    m_stats.frames++;
+    if (frameMilliseconds > m_targetMilliseconds) m_stats.framesOverTarget++;
+    if (std::fabs(m_scale - previousScale) >= 0.01f) m_stats.scaleChanges++;
+    m_stats.minScale = std::min(m_stats.minScale, m_scale);
+    m_scaleSum += m_scale;
+    m_stats.averageScale = static_cast<float>(m_scaleSum / m_stats.frames);
+
+    if (m_traceCapacity > 0) {
+        TraceSample sample = { m_frame, frameMilliseconds, m_scale };
+        if (m_trace.size() < m_traceCapacity) {
+            m_trace.push_back(sample);
+        } else {
+            m_trace[m_traceNext] = sample;
+        }
+        m_traceNext = (m_traceNext + 1) % m_traceCapacity;
+    }
+    m_frame++;
+    return m_scale;
+}
+
+void DynamicResolution::SetTraceCapacity(uint32_t capacity) {
+    m_traceCapacity = capacity;
+    m_traceNext = 0;
+    m_trace.clear();
+    m_trace.reserve(capacity);
+}
+
+bool DynamicResolution::WriteTrace(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    // Oldest sample first once the ring has wrapped
+    fprintf(file, "frame,frame_ms,scale,target_ms\n");
+    size_t start = m_trace.size() < m_traceCapacity ? 0 : m_traceNext;
+    for (size_t i = 0; i < m_trace.size(); ++i) {
+        const TraceSample& sample = m_trace[(start + i) % m_trace.size()];
+        fprintf(file, "%u,%.3f,%.4f,%.3f\n", sample.frame, sample.frameMilliseconds, sample.scale, m_targetMilliseconds);
+    }
+    return fclose(file) == 0;
+}
+
+void DynamicResolution::ResetStats() {
+    m_stats = {};
+    m_stats.minScale = m_maxScale;
+    m_scaleSum = 0.0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Chooses a render scale from measured frame times. A PID controller in
+// velocity form works on the rendered pixel fraction, since scene cost is
+// roughly proportional to pixel count: each update multiplies the fraction by
+// (1 + correction), clamped to [minScale^2, maxScale^2]. Increases are rate
+// limited so a short quiet stretch cannot overshoot into the next spike.
+// Frame times must come from the work the scale affects, such as GPU
+// timestamps around the scene pass, not a vsync-locked frame interval.
+class DynamicResolution {
+public:
+    struct TraceSample {
+        uint32_t frame;
+        float frameMilliseconds;
+        float scale;  // Chosen after this measurement, used for a later frame
+    };
+
+    struct Stats {
+        uint32_t frames;
+        uint32_t framesOverTarget;
+        uint32_t scaleChanges;      // Updates that moved the scale by at least one percent
+        float minScale;
+        float averageScale;
+    };
+
+    DynamicResolution();
+
+    // Target time for the measured work, and the range of the per-axis scale
+    bool Initialize(float targetMilliseconds, float minScale = DEFAULT_MIN_SCALE, float maxScale = 1.0f);
+    void SetGains(float proportional, float integral, float derivative);
+    void SetMaxIncrease(float fractionPerUpdate) { m_maxIncrease = fractionPerUpdate; }
+
+    // Feeds one frame time and returns the per-axis scale to render at
+    float Update(float frameMilliseconds);
+    void Reset();
+
+    float GetScale() const { return m_scale; }
+    float GetTargetMilliseconds() const { return m_targetMilliseconds; }
+
+    // Keeps the most recent samples, up to capacity; zero disables tracing
+    void SetTraceCapacity(uint32_t capacity);
+    const std::vector<TraceSample>& GetTrace() const { return m_trace; }
+    // CSV with one row per sample: frame, frame_ms, scale, target_ms
+    bool WriteTrace(const char* path) const;
+
+    void ResetStats();
+    const Stats& GetStats() const { return m_stats; }
+
+    // Constants
+    static constexpr float DEFAULT_MIN_SCALE = 0.5f;
+    static constexpr float DEFAULT_PROPORTIONAL = 0.3f;
+    static constexpr float DEFAULT_INTEGRAL = 0.12f;
+    static constexpr float DEFAULT_DERIVATIVE = 0.05f;
+    static constexpr float DEFAULT_MAX_INCREASE = 0.02f;
+
+private:
+    float m_targetMilliseconds;
+    float m_minScale;
+    float m_maxScale;
+    float m_proportional;
+    float m_integral;
+    float m_derivative;
+    float m_maxIncrease;
+
+    float m_pixelFraction;
+    float m_scale;
+    float m_lastError;
+    float m_previousError;
+    uint32_t m_frame;
+    double m_scaleSum;
+
+    std::vector<TraceSample> m_trace;  // Ring buffer once full
+    uint32_t m_traceCapacity;
+    uint32_t m_traceNext;
+    Stats m_stats;
+
+    // Constants
+    static constexpr float HEADROOM = 0.1f;  // Relative slack under target treated as on target, so noise settles below budget
+};
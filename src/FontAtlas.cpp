@@ -0,0 +1,134 @@
+#include "FontAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+FontAtlas::FontAtlas() :
+    m_fontId(0),
+    m_width(0),
+    m_height(0),
+    m_lineHeight(0.0f),
+    m_ascent(0.0f),
+    m_dirty(false),
+    m_shelfX(0),
+    m_shelfY(0),
+    m_shelfHeight(0),
+    m_solidGlyph() {
+    std::fill(std::begin(m_asciiLookup), std::end(m_asciiLookup), -1);
+}
+
+FontAtlas::~FontAtlas() {
+}
+
+bool FontAtlas::Initialize(uint32_t fontId, int width, int height) {
+    if (width <= SOLID_BLOCK_SIZE || height <= SOLID_BLOCK_SIZE) {
+        return false;
+    }
+
+    m_fontId = fontId;
+    m_width = width;
+    m_height = height;
+    m_pixels.assign(static_cast<size_t>(width) * height, 0);
+    m_glyphs.clear();
+    m_extendedLookup.clear();
+    std::fill(std::begin(m_asciiLookup), std::end(m_asciiLookup), -1);
+    m_shelfX = 0;
+    m_shelfY = 0;
+    m_shelfHeight = 0;
+
+    // Reserve a solid block in the corner and sample its center to avoid filtering bleed
+    int x = 0;
+    int y = 0;
+    if (!Allocate(SOLID_BLOCK_SIZE, SOLID_BLOCK_SIZE, x, y)) {
+        return false;
+    }
+    for (int row = 0; row < SOLID_BLOCK_SIZE; ++row) {
+        std::memset(&m_pixels[static_cast<size_t>(y + row) * m_width + x], 0xff, SOLID_BLOCK_SIZE);
+    }
+
+    float center = SOLID_BLOCK_SIZE * 0.5f;
+    m_solidGlyph = {};
+    m_solidGlyph.u0 = m_solidGlyph.u1 = (x + center) / m_width;
+    m_solidGlyph.v0 = m_solidGlyph.v1 = (y + center) / m_height;
+
+    m_dirty = true;
+    return true;
+}
+
+void FontAtlas::SetMetrics(float lineHeight, float ascent) {
+    m_lineHeight = lineHeight;
+    m_ascent = ascent;
+}
+
+bool FontAtlas::AddGlyph(uint32_t codepoint, int width, int height, const uint8_t* coverage, int pitch,
+                         float offsetX, float offsetY, float advance) {
+    Glyph glyph = {};
+    glyph.width = static_cast<float>(width);
+    glyph.height = static_cast<float>(height);
+    glyph.offsetX = offsetX;
+    glyph.offsetY = offsetY;
+    glyph.advance = advance;
+
+    // Whitespace and other empty glyphs only need metrics
+    if (width > 0 && height > 0 && coverage) {
+        int x = 0;
+        int y = 0;
+        if (!Allocate(width, height, x, y)) {
+            return false;
+        }
+
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(&m_pixels[static_cast<size_t>(y + row) * m_width + x],
+                        coverage + static_cast<size_t>(row) * pitch, width);
+        }
+
+        glyph.u0 = static_cast<float>(x) / m_width;
+        glyph.v0 = static_cast<float>(y) / m_height;
+        glyph.u1 = static_cast<float>(x + width) / m_width;
+        glyph.v1 = static_cast<float>(y + height) / m_height;
+        m_dirty = true;
+    }
+
+    int32_t index = static_cast<int32_t>(m_glyphs.size());
+    m_glyphs.push_back(glyph);
+    if (codepoint < 128) {
+        m_asciiLookup[codepoint] = index;
+    } else {
+        m_extendedLookup[codepoint] = index;
+    }
+    return true;
+}
+
+const FontAtlas::Glyph* FontAtlas::FindGlyph(uint32_t codepoint) const {
+    int32_t index = -1;
+    if (codepoint < 128) {
+        index = m_asciiLookup[codepoint];
+    } else {
+        auto it = m_extendedLookup.find(codepoint);
+        if (it != m_extendedLookup.end()) {
+            index = it->second;
+        }
+    }
+    return index >= 0 ? &m_glyphs[index] : nullptr;
+}
+
+bool FontAtlas::Allocate(int width, int height, int& x, int& y) {
+    int paddedWidth = width + GLYPH_PADDING;
+    int paddedHeight = height + GLYPH_PADDING;
+
+    // Start a new shelf when the current one is out of horizontal space
+    if (m_shelfX + paddedWidth > m_width) {
+        m_shelfY += m_shelfHeight;
+        m_shelfX = 0;
+        m_shelfHeight = 0;
+    }
+
+    if (paddedWidth > m_width || m_shelfY + paddedHeight > m_height) {
+        return false;
+    }
+
+    x = m_shelfX;
+    y = m_shelfY;
+    m_shelfX += paddedWidth;
+    m_shelfHeight = std::max(m_shelfHeight, paddedHeight);
+    return true;
+}
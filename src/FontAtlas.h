@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Single-channel glyph atlas. Glyphs are rasterized once by the platform layer
+// and shelf-packed into one texture that the UI samples for all text.
+class FontAtlas {
+public:
+    struct Glyph {
+        float u0, v0, u1, v1;   // Atlas texture coordinates
+        float width, height;    // Bitmap size in pixels
+        float offsetX, offsetY; // Pen position to bitmap top-left
+        float advance;          // Horizontal pen advance
+    };
+
+    FontAtlas();
+    ~FontAtlas();
+
+    bool Initialize(uint32_t fontId, int width, int height);
+    void SetMetrics(float lineHeight, float ascent);
+
+    // Copies an 8-bit coverage bitmap into the atlas. Returns false if it does not fit.
+    bool AddGlyph(uint32_t codepoint, int width, int height, const uint8_t* coverage, int pitch,
+                  float offsetX, float offsetY, float advance);
+    const Glyph* FindGlyph(uint32_t codepoint) const;
+
+    // Fully covered texel block so untextured quads can share the atlas texture
+    const Glyph& GetSolidGlyph() const { return m_solidGlyph; }
+
+    // Getters
+    uint32_t GetId() const { return m_fontId; }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    float GetLineHeight() const { return m_lineHeight; }
+    float GetAscent() const { return m_ascent; }
+    const uint8_t* GetPixels() const { return m_pixels.data(); }
+
+    // Set when new glyphs were packed and the GPU copy is stale
+    bool IsDirty() const { return m_dirty; }
+    void ClearDirty() { m_dirty = false; }
+
+private:
+    uint32_t m_fontId;
+    int m_width;
+    int m_height;
+    float m_lineHeight;
+    float m_ascent;
+    bool m_dirty;
+    std::vector<uint8_t> m_pixels;
+
+    // Shelf packer state
+    int m_shelfX;
+    int m_shelfY;
+    int m_shelfHeight;
+
+    // Glyph lookup (ASCII is a direct index, everything else goes through the map)
+    std::vector<Glyph> m_glyphs;
+    int32_t m_asciiLookup[128];
+    std::unordered_map<uint32_t, int32_t> m_extendedLookup;
+    Glyph m_solidGlyph;
+
+    bool Allocate(int width, int height, int& x, int& y);
+
+    // Constants
+    static constexpr int GLYPH_PADDING = 1;
+    static constexpr int SOLID_BLOCK_SIZE = 4;
+};
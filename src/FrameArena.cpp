@@ -0,0 +1,91 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+LinearAllocator::LinearAllocator() :
+    m_capacity(0),
+    m_used(0),
+    m_highWater(0),
+    m_overflowBytes(0),
+    m_overflowCount(0) {
+}
+
+LinearAllocator::~LinearAllocator() {
+}
+
+bool LinearAllocator::Initialize(size_t capacity) {
+    m_block.reset(capacity > 0 ? new uint8_t[capacity] : nullptr);
+    m_capacity = capacity;
+    m_used = 0;
+    m_highWater = 0;
+    m_overflow.clear();
+    m_overflowBytes = 0;
+    m_overflowCount = 0;
+    return true;
+}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment) {
+    // Align the address rather than the offset, so alignments above new[]'s guarantee also hold
+    uintptr_t base = reinterpret_cast<uintptr_t>(m_block.get());
+    uintptr_t aligned = (base + m_used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    size_t end = static_cast<size_t>(aligned - base) + size;
+    if (m_block && end <= m_capacity) {
+        m_used = end;
+        m_highWater = std::max(m_highWater, GetUsed());
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Out of room this frame: serve from the heap and remember how much was needed
+    size_t blockSize = size + alignment;
+    m_overflow.emplace_back(new uint8_t[blockSize]);
+    m_overflowBytes += blockSize;
+    m_overflowCount++;
+    m_highWater = std::max(m_highWater, GetUsed());
+    uintptr_t overflowBase = reinterpret_cast<uintptr_t>(m_overflow.back().get());
+    return reinterpret_cast<void*>((overflowBase + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+void LinearAllocator::Reset() {
+    if (!m_overflow.empty()) {
+        m_overflow.clear();
+        m_overflowBytes = 0;
+        size_t capacity = m_highWater * GROWTH_NUMERATOR / GROWTH_DENOMINATOR;
+        m_block.reset(new uint8_t[capacity]);
+        m_capacity = capacity;
+    }
+    m_used = 0;
+}
+
+FrameArena::FrameArena() :
+    m_threadCount(0) {
+}
+
+FrameArena::~FrameArena() {
+}
+
+bool FrameArena::Initialize(uint32_t threadCount, size_t bytesPerThread) {
+    if (threadCount == 0) return false;
+
+    m_allocators.reset(new ThreadAllocator[threadCount]);
+    m_threadCount = threadCount;
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_allocators[i].allocator.Initialize(bytesPerThread);
+    }
+    return true;
+}
+
+void FrameArena::BeginFrame() {
+    for (uint32_t i = 0; i < m_threadCount; ++i) {
+        m_allocators[i].allocator.Reset();
+    }
+}
+
+FrameArena::Stats FrameArena::GetStats() const {
+    Stats stats = {};
+    for (uint32_t i = 0; i < m_threadCount; ++i) {
+        const LinearAllocator& allocator = m_allocators[i].allocator;
+        stats.usedBytes += allocator.GetUsed();
+        stats.capacityBytes += allocator.GetCapacity();
+        stats.overflows += allocator.GetOverflowCount();
+    }
+    return stats;
+}
@@ -0,0 +1,129 @@
+#include "FrameRingAllocator.h"
+#include <algorithm>
+
+FrameRingAllocator::FrameRingAllocator() :
+    m_capacity(0),
+    m_alignment(1),
+    m_head(0),
+    m_tail(0),
+    m_oldestFrame(0),
+    m_framesInFlight(0),
+    m_stats() {
+}
+
+FrameRingAllocator::~FrameRingAllocator() {
+}
+
+bool FrameRingAllocator::Initialize(uint32_t capacity, uint32_t alignment, uint32_t maxFramesInFlight) {
+    // Alignment must be a power of two that evenly divides the buffer
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) return false;
+    if (capacity == 0 || capacity % alignment != 0) return false;
+    if (maxFramesInFlight == 0) return false;
+
+    m_capacity = capacity;
+    m_alignment = alignment;
+    m_head = 0;
+    m_tail = 0;
+    m_frameEnds.assign(maxFramesInFlight, 0);
+    m_oldestFrame = 0;
+    m_framesInFlight = 0;
+    m_stats = {};
+    return true;
+}
+
+bool FrameRingAllocator::Allocate(uint32_t size, uint32_t& offset) {
+    if (size == 0 || size > m_capacity) {
+        m_stats.failedAllocations++;
+        return false;
+    }
+
+    uint64_t start = (m_head + m_alignment - 1) & ~static_cast<uint64_t>(m_alignment - 1);
+
+    // Allocations never straddle the end of the buffer; skip to the next lap instead
+    uint64_t lapOffset = start % m_capacity;
+    if (lapOffset + size > m_capacity) {
+        start += m_capacity - lapOffset;
+    }
+
+    if (start + size - m_tail > m_capacity) {
+        m_stats.failedAllocations++;
+        return false;
+    }
+
+    offset = static_cast<uint32_t>(start % m_capacity);
+    m_stats.bytesThisFrame += (start + size) - m_head;
+    m_stats.allocationsThisFrame++;
+    m_head = start + size;
+    return true;
+}
+
+void FrameRingAllocator::BeginFrame() {
+    m_stats.bytesThisFrame = 0;
+    m_stats.allocationsThisFrame = 0;
+}
+
+bool FrameRingAllocator::EndFrame() {
+    m_stats.bytesLastFrame = m_stats.bytesThisFrame;
+    m_stats.peakBytesPerFrame = std::max(m_stats.peakBytesPerFrame, m_stats.bytesThisFrame);
+
+    // Only the backend knows when the GPU is done, so space is never released here
+    if (m_framesInFlight == m_frameEnds.size()) {
+        return false;
+    }
+
+    uint32_t slot = (m_oldestFrame + m_framesInFlight) % static_cast<uint32_t>(m_frameEnds.size());
+    m_frameEnds[slot] = m_head;
+    m_framesInFlight++;
+    return true;
+}
+
+void FrameRingAllocator::RetireOldestFrame() {
+    if (m_framesInFlight == 0) return;
+
+    m_tail = m_frameEnds[m_oldestFrame];
+    m_oldestFrame = (m_oldestFrame + 1) % static_cast<uint32_t>(m_frameEnds.size());
+    m_framesInFlight--;
+}
+
+void FrameRingAllocator::Restart() {
+    m_head = 0;
+    m_tail = 0;
+    m_oldestFrame = 0;
+    m_framesInFlight = 0;
+}
+
+bool FrameRingAllocator::Resize(uint32_t capacity) {
+    if (capacity == 0 || capacity % m_alignment != 0) return false;
+
+    m_capacity = capacity;
+    Restart();
+    return true;
+}
+
+void FrameRingAllocator::RecordStall(double milliseconds) {
+    m_stats.stalls++;
+    m_stats.stallMilliseconds += milliseconds;
+}
+
+uint32_t FrameRingAllocator::GetContiguousSpace() const {
+    return m_capacity - static_cast<uint32_t>(m_head % m_capacity);
+}
+
+bool FrameRingAllocator::FitsOnceRetired(uint32_t size) const {
+    if (size == 0 || size > m_capacity) return false;
+
+    // Retiring everything moves the tail to the end of the newest in-flight frame;
+    // what the current frame has allocated stays
+    uint64_t tail = m_tail;
+    if (m_framesInFlight > 0) {
+        uint32_t newest = (m_oldestFrame + m_framesInFlight - 1) % static_cast<uint32_t>(m_frameEnds.size());
+        tail = m_frameEnds[newest];
+    }
+
+    uint64_t start = (m_head + m_alignment - 1) & ~static_cast<uint64_t>(m_alignment - 1);
+    uint64_t lapOffset = start % m_capacity;
+    if (lapOffset + size > m_capacity) {
+        start += m_capacity - lapOffset;
+    }
+    return start + size - tail <= m_capacity;
+}
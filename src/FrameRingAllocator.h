@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Linear sub-allocator over a GPU buffer that is written front to back and
+// recycled once the GPU has finished with the frames that used each region.
+// Graphics backends own the buffer and fences; this class only tracks offsets.
+class FrameRingAllocator {
+public:
+    struct Stats {
+        uint64_t bytesThisFrame;
+        uint64_t bytesLastFrame;
+        uint64_t peakBytesPerFrame;
+        uint64_t allocationsThisFrame;
+        uint64_t failedAllocations;
+        uint64_t stalls;            // Times the CPU had to wait for the GPU to release space
+        double stallMilliseconds;
+    };
+
+    FrameRingAllocator();
+    ~FrameRingAllocator();
+
+    bool Initialize(uint32_t capacity, uint32_t alignment, uint32_t maxFramesInFlight);
+
+    // Returns false if the space is still owned by in-flight frames
+    bool Allocate(uint32_t size, uint32_t& offset);
+
+    void BeginFrame();
+    // Returns false if every frame is still in flight; the backend must retire
+    // one first, and until it does this frame's allocations count toward the next
+    bool EndFrame();
+
+    // Called by the backend once the fence of the oldest in-flight frame has signalled
+    void RetireOldestFrame();
+    // Called after the backend orphaned the buffer; allocation restarts at offset zero
+    void Restart();
+    // Called after the backend replaced the buffer with one of a new capacity; also restarts
+    bool Resize(uint32_t capacity);
+
+    void RecordStall(double milliseconds);
+
+    uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+    uint32_t GetMaxFramesInFlight() const { return static_cast<uint32_t>(m_frameEnds.size()); }
+    uint32_t GetCapacity() const { return m_capacity; }
+    uint32_t GetAlignment() const { return m_alignment; }
+    // Bytes left before the write position reaches the end of the buffer
+    uint32_t GetContiguousSpace() const;
+    // Whether Allocate could succeed once every in-flight frame is retired; if
+    // not, waiting for the GPU cannot help
+    bool FitsOnceRetired(uint32_t size) const;
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    uint32_t m_capacity;
+    uint32_t m_alignment;
+
+    // Absolute positions; the buffer offset is position % capacity
+    uint64_t m_head;
+    uint64_t m_tail;
+
+    // Write position at the end of each in-flight frame, oldest first
+    std::vector<uint64_t> m_frameEnds;
+    uint32_t m_oldestFrame;
+    uint32_t m_framesInFlight;
+
+    Stats m_stats;
+};
@@ -0,0 +1,172 @@
+#include "GLConstantRing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+GLConstantRing::GLConstantRing() :
+    m_buffer(0),
+    m_mapped(nullptr),
+    m_oldestFence(0),
+    m_glGenBuffers(nullptr),
+    m_glDeleteBuffers(nullptr),
+    m_glBindBuffer(nullptr),
+    m_glBindBufferRange(nullptr),
+    m_glBufferStorage(nullptr),
+    m_glMapBufferRange(nullptr),
+    m_glUnmapBuffer(nullptr),
+    m_glFenceSync(nullptr),
+    m_glClientWaitSync(nullptr),
+    m_glDeleteSync(nullptr) {
+}
+
+GLConstantRing::~GLConstantRing() {
+    Shutdown();
+}
+
+bool GLConstantRing::LoadEntryPoints(GLProcLoader loader) {
+    m_glGenBuffers = reinterpret_cast<PFNGLGENBUFFERSPROC>(loader("glGenBuffers"));
+    m_glDeleteBuffers = reinterpret_cast<PFNGLDELETEBUFFERSPROC>(loader("glDeleteBuffers"));
+    m_glBindBuffer = reinterpret_cast<PFNGLBINDBUFFERPROC>(loader("glBindBuffer"));
+    m_glBindBufferRange = reinterpret_cast<PFNGLBINDBUFFERRANGEPROC>(loader("glBindBufferRange"));
+    m_glBufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(loader("glBufferStorage"));
+    m_glMapBufferRange = reinterpret_cast<PFNGLMAPBUFFERRANGEPROC>(loader("glMapBufferRange"));
+    m_glUnmapBuffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(loader("glUnmapBuffer"));
+    m_glFenceSync = reinterpret_cast<PFNGLFENCESYNCPROC>(loader("glFenceSync"));
+    m_glClientWaitSync = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(loader("glClientWaitSync"));
+    m_glDeleteSync = reinterpret_cast<PFNGLDELETESYNCPROC>(loader("glDeleteSync"));
+
+    return m_glGenBuffers && m_glDeleteBuffers && m_glBindBuffer && m_glBindBufferRange &&
+           m_glBufferStorage && m_glMapBufferRange && m_glUnmapBuffer &&
+           m_glFenceSync && m_glClientWaitSync && m_glDeleteSync;
+}
+
+bool GLConstantRing::Initialize(uint32_t capacity, uint32_t framesInFlight, GLProcLoader loader) {
+    Shutdown();
+
+    // The loader hands out stubs for anything it has heard of, so ask the context
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    int major = 0, minor = 0;
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return false;
+    bool bufferStorage = major > 4 || (major == 4 && minor >= 4) ||
+                         (extensions && strstr(extensions, "GL_ARB_buffer_storage"));
+    if (!bufferStorage || !LoadEntryPoints(loader)) return false;
+
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0) alignment = 256;
+    capacity = (capacity + alignment - 1) / alignment * alignment;
+
+    if (!m_allocator.Initialize(capacity, static_cast<uint32_t>(alignment), framesInFlight)) {
+        return false;
+    }
+
+    // Coherent persistent mapping: writes become visible without explicit flushes
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    m_glGenBuffers(1, &m_buffer);
+    m_glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    m_glBufferStorage(GL_UNIFORM_BUFFER, capacity, nullptr, flags);
+    m_mapped = static_cast<uint8_t*>(m_glMapBufferRange(GL_UNIFORM_BUFFER, 0, capacity, flags));
+    m_glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (!m_mapped) {
+        Shutdown();
+        return false;
+    }
+
+    m_fences.assign(framesInFlight, nullptr);
+    m_oldestFence = 0;
+    return true;
+}
+
+void GLConstantRing::Shutdown() {
+    if (m_buffer == 0) return;
+
+    for (GLsync& fence : m_fences) {
+        if (fence) {
+            m_glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (m_mapped) {
+        m_glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        m_glUnmapBuffer(GL_UNIFORM_BUFFER);
+        m_glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        m_mapped = nullptr;
+    }
+
+    m_glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
+
+void GLConstantRing::BeginFrame() {
+    RetireCompletedFrames();
+    m_allocator.BeginFrame();
+}
+
+bool GLConstantRing::Allocate(uint32_t size, Allocation& allocation) {
+    uint32_t offset = 0;
+    while (!m_allocator.Allocate(size, offset)) {
+        // Only space held by earlier frames can be reclaimed, so waiting must be able to help
+        if (m_allocator.GetFramesInFlight() == 0 || !m_allocator.FitsOnceRetired(size)) {
+            return false;
+        }
+        WaitForOldestFrame();
+    }
+
+    allocation.data = m_mapped + offset;
+    allocation.offset = offset;
+    allocation.size = size;
+    return true;
+}
+
+void GLConstantRing::Bind(GLuint bindingIndex, const Allocation& allocation) const {
+    m_glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, m_buffer, allocation.offset, allocation.size);
+}
+
+void GLConstantRing::EndFrame() {
+    if (m_allocator.GetFramesInFlight() == m_allocator.GetMaxFramesInFlight()) {
+        WaitForOldestFrame();
+    }
+
+    uint32_t slot = (m_oldestFence + m_allocator.GetFramesInFlight()) % static_cast<uint32_t>(m_fences.size());
+    m_fences[slot] = m_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_allocator.EndFrame();
+}
+
+void GLConstantRing::RetireCompletedFrames() {
+    while (m_allocator.GetFramesInFlight() > 0) {
+        GLsync fence = m_fences[m_oldestFence];
+        GLenum result = m_glClientWaitSync(fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            return;
+        }
+
+        m_glDeleteSync(fence);
+        m_fences[m_oldestFence] = nullptr;
+        m_oldestFence = (m_oldestFence + 1) % static_cast<uint32_t>(m_fences.size());
+        m_allocator.RetireOldestFrame();
+    }
+}
+
+void GLConstantRing::WaitForOldestFrame() {
+    GLsync fence = m_fences[m_oldestFence];
+    GLenum result = m_glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+        auto start = std::chrono::steady_clock::now();
+        const GLuint64 oneMillisecond = 1000000;
+        do {
+            result = m_glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, oneMillisecond);
+        } while (result == GL_TIMEOUT_EXPIRED);
+
+        auto end = std::chrono::steady_clock::now();
+        m_allocator.RecordStall(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    m_glDeleteSync(fence);
+    m_fences[m_oldestFence] = nullptr;
+    m_oldestFence = (m_oldestFence + 1) % static_cast<uint32_t>(m_fences.size());
+    m_allocator.RetireOldestFrame();
+}
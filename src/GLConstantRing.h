@@ -0,0 +1,60 @@
+#pragma once
+#include <GL/freeglut.h>
+#include <GL/glext.h>
+#include <cstdint>
+#include <vector>
+#include "FrameRingAllocator.h"
+
+// Resolves GL entry points, such as glutGetProcAddress or eglGetProcAddress
+typedef void (*GLProc)();
+typedef GLProc (*GLProcLoader)(const char* name);
+
+// Persistently mapped uniform buffer ring for the OpenGL path. Per-draw
+// uniforms are written straight into mapped memory; a fence per frame tells
+// the ring when a region can be reused.
+class GLConstantRing {
+public:
+    struct Allocation {
+        void* data;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLConstantRing();
+    ~GLConstantRing();
+
+    // Requires GL 4.4 or ARB_buffer_storage; returns false otherwise
+    bool Initialize(uint32_t capacity, uint32_t framesInFlight = 3, GLProcLoader loader = glutGetProcAddress);
+    void Shutdown();
+
+    void BeginFrame();
+    bool Allocate(uint32_t size, Allocation& allocation);
+    void Bind(GLuint bindingIndex, const Allocation& allocation) const;
+    void EndFrame();
+
+    bool IsInitialized() const { return m_buffer != 0; }
+    const FrameRingAllocator::Stats& GetStats() const { return m_allocator.GetStats(); }
+
+private:
+    FrameRingAllocator m_allocator;
+    GLuint m_buffer;
+    uint8_t* m_mapped;
+    std::vector<GLsync> m_fences;  // One per in-flight frame, oldest first
+    uint32_t m_oldestFence;
+
+    // Entry points loaded at runtime
+    PFNGLGENBUFFERSPROC m_glGenBuffers;
+    PFNGLDELETEBUFFERSPROC m_glDeleteBuffers;
+    PFNGLBINDBUFFERPROC m_glBindBuffer;
+    PFNGLBINDBUFFERRANGEPROC m_glBindBufferRange;
+    PFNGLBUFFERSTORAGEPROC m_glBufferStorage;
+    PFNGLMAPBUFFERRANGEPROC m_glMapBufferRange;
+    PFNGLUNMAPBUFFERPROC m_glUnmapBuffer;
+    PFNGLFENCESYNCPROC m_glFenceSync;
+    PFNGLCLIENTWAITSYNCPROC m_glClientWaitSync;
+    PFNGLDELETESYNCPROC m_glDeleteSync;
+
+    bool LoadEntryPoints(GLProcLoader loader);
+    void RetireCompletedFrames();
+    void WaitForOldestFrame();
+};
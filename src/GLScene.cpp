@@ -0,0 +1,530 @@
+#include "GLScene.h"
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "CommandStream.h"
+#include "WorldFile.h"
+
+// Camera position and orientation
+float cameraX = 0.0f;
+float cameraY = 1.7f;  // Eye level
+float cameraZ = 5.0f;
+float cameraAngleX = 0.0f;
+float cameraAngleY = 0.0f;
+
+float aspectRatio = 800.0f / 600.0f;
+GLProcLoader glProcLoader = glutGetProcAddress;
+
+RenderQueue renderQueue;
+JobSystem jobSystem;
+RenderCapture renderCapture;
+OcclusionCuller occlusionCuller;
+WorldStreamer worldStreamer;
+LodSelector lodSelector;
+LodMesh floorMesh;
+
+const SceneObject sceneObjects[SCENE_OBJECT_COUNT] = {
+    { MESH_FLOOR, { -10.0f, 0.0f, -10.0f }, { 10.0f, 0.0f, 10.0f }, false },
+    { MESH_CUBE, { -0.5f, 0.0f, -2.5f }, { 0.5f, 1.0f, -1.5f }, true },
+    { MESH_CUBE, { -2.5f, 0.0f, -2.5f }, { -1.5f, 1.0f, -1.5f }, true },
+    { MESH_CUBE, { 1.5f, 0.0f, -2.5f }, { 2.5f, 1.0f, -1.5f }, true }
+};
+
+PhysicsWorld crates;
+uint32_t firstCrate = 0;
+SceneGraph sceneGraph;
+GLSceneBackend sceneBackend;
+
+namespace {
+
+// Parallel recording; streams are replayed in order on the GL thread
+std::vector<CommandStream> commandStreams;
+std::vector<RenderBackend*> streamPointers;
+const size_t PARALLEL_RECORD_MIN_DRAWS = 2048;
+const size_t DRAWS_PER_STREAM = 1024;
+
+// LOD each object used last frame, for hysteresis
+uint32_t sceneObjectLods[SCENE_OBJECT_COUNT] = {};
+
+void drawCubeGeometry() {
+    glBegin(GL_QUADS);
+
+    // Front face (red)
+    glColor3f(1.0f, 0.0f, 0.0f);
+    glVertex3f(-0.5f, -0.5f, 0.5f);
+    glVertex3f(0.5f, -0.5f, 0.5f);
+    glVertex3f(0.5f, 0.5f, 0.5f);
+    glVertex3f(-0.5f, 0.5f, 0.5f);
+
+    // Back face (green)
+    glColor3f(0.0f, 1.0f, 0.0f);
+    glVertex3f(-0.5f, -0.5f, -0.5f);
+    glVertex3f(-0.5f, 0.5f, -0.5f);
+    glVertex3f(0.5f, 0.5f, -0.5f);
+    glVertex3f(0.5f, -0.5f, -0.5f);
+
+    // Top face (blue)
+    glColor3f(0.0f, 0.0f, 1.0f);
+    glVertex3f(-0.5f, 0.5f, -0.5f);
+    glVertex3f(-0.5f, 0.5f, 0.5f);
+    glVertex3f(0.5f, 0.5f, 0.5f);
+    glVertex3f(0.5f, 0.5f, -0.5f);
+
+    // Bottom face (yellow)
+    glColor3f(1.0f, 1.0f, 0.0f);
+    glVertex3f(-0.5f, -0.5f, -0.5f);
+    glVertex3f(0.5f, -0.5f, -0.5f);
+    glVertex3f(0.5f, -0.5f, 0.5f);
+    glVertex3f(-0.5f, -0.5f, 0.5f);
+
+    // Right face (magenta)
+    glColor3f(1.0f, 0.0f, 1.0f);
+    glVertex3f(0.5f, -0.5f, -0.5f);
+    glVertex3f(0.5f, 0.5f, -0.5f);
+    glVertex3f(0.5f, 0.5f, 0.5f);
+    glVertex3f(0.5f, -0.5f, 0.5f);
+
+    // Left face (cyan)
+    glColor3f(0.0f, 1.0f, 1.0f);
+    glVertex3f(-0.5f, -0.5f, -0.5f);
+    glVertex3f(-0.5f, -0.5f, 0.5f);
+    glVertex3f(-0.5f, 0.5f, 0.5f);
+    glVertex3f(-0.5f, 0.5f, -0.5f);
+
+    glEnd();
+}
+
+void drawFloorGeometry(uint32_t lod) {
+    const MeshLod& range = floorMesh.chain.lods[lod];
+    const uint32_t* indices = &floorMesh.chain.indices[range.firstIndex];
+
+    glBegin(GL_TRIANGLES);
+    glColor3f(0.5f, 0.5f, 0.5f);
+    for (uint32_t i = 0; i < range.indexCount; ++i) {
+        const Float3& position = floorMesh.positions[indices[i]];
+        glVertex3f(position.x, position.y, position.z);
+    }
+    glEnd();
+}
+
+void submitDraw(uint32_t mesh, uint32_t lod, uint32_t material, const Float4x4& world) {
+    DrawItem item = { world, 0, material, mesh, lod, 0 };
+
+    // Distance along the view direction, normalized to the far plane
+    float dx = world.m[3][0] - cameraX;
+    float dy = world.m[3][1] - cameraY;
+    float dz = world.m[3][2] - cameraZ;
+    float yaw = cameraAngleY * 3.14159f / 180.0f;
+    float pitch = cameraAngleX * 3.14159f / 180.0f;
+    float depth = dx * sinf(yaw) * cosf(pitch) - dy * sinf(pitch) - dz * cosf(yaw) * cosf(pitch);
+
+    renderQueue.Submit(RenderQueue::MakeKey(RenderQueue::PASS_OPAQUE, 0, material, mesh, depth / 100.0f), item);
+}
+
+void executeQueue(RenderBackend& backend) {
+    if (renderCapture.IsCapturing()) {
+        renderQueue.Execute(renderCapture);
+    }
+
+    // The scene's uniform ring fences once per queue, whichever backend forwards to it
+    sceneBackend.BeginFrame();
+    size_t drawCount = renderQueue.GetSize();
+    if (drawCount < PARALLEL_RECORD_MIN_DRAWS || jobSystem.GetThreadCount() < 2) {
+        renderQueue.Execute(backend);
+    } else {
+        uint32_t streamCount = static_cast<uint32_t>(std::min<size_t>(jobSystem.GetThreadCount(),
+                                                                      (drawCount + DRAWS_PER_STREAM - 1) / DRAWS_PER_STREAM));
+        recordStreams(streamCount);
+        for (uint32_t i = 0; i < streamCount; ++i) {
+            commandStreams[i].Replay(backend);
+        }
+    }
+    sceneBackend.EndFrame();
+}
+
+// Nodes with a mesh, at the world matrices of the last update
+void submitSceneGraph() {
+    const Float4x4* worlds = sceneGraph.GetWorldMatrices();
+    const uint32_t* meshes = sceneGraph.GetSlotUserData();
+    for (uint32_t slot = 0; slot < sceneGraph.GetNodeCount(); ++slot) {
+        if (meshes[slot] != SceneGraph::NO_USER_DATA) {
+            submitDraw(meshes[slot], 0, MATERIAL_OPAQUE, worlds[slot]);
+        }
+    }
+}
+
+// World matrix for a mesh stretched to fill the given bounds
+Float4x4 objectWorld(uint32_t mesh, const Float3& center, const Float3& halfExtents) {
+    // The floor grid is flat and 20 units across; the cube is a unit cube
+    float meshHalfSize = mesh == MESH_FLOOR ? 10.0f : 0.5f;
+    float scaleY = mesh == MESH_FLOOR ? 1.0f : halfExtents.y / meshHalfSize;
+    return Multiply(Float4x4::Scale(halfExtents.x / meshHalfSize, scaleY, halfExtents.z / meshHalfSize),
+                    Float4x4::Translation(center.x, center.y, center.z));
+}
+
+// Distance from the camera to the nearest point of a box
+float cameraDistance(const Float3& boundsMin, const Float3& boundsMax) {
+    float dx = std::max(std::max(boundsMin.x - cameraX, cameraX - boundsMax.x), 0.0f);
+    float dy = std::max(std::max(boundsMin.y - cameraY, cameraY - boundsMax.y), 0.0f);
+    float dz = std::max(std::max(boundsMin.z - cameraZ, cameraZ - boundsMax.z), 0.0f);
+    return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+// Draws with the fixed-function colors and projection, but takes the world
+// matrix from the uniform ring; it is row-vector, which std140's column-major
+// mat4 reads as the transpose
+const char* const SCENE_VERTEX_SHADER =
+    "#version 150 compatibility\n"
+    "layout(std140) uniform DrawConstants { mat4 world; };\n"
+    "void main() {\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * (world * gl_Vertex);\n"
+    "}\n";
+const char* const SCENE_FRAGMENT_SHADER =
+    "#version 150 compatibility\n"
+    "void main() { gl_FragColor = gl_Color; }\n";
+
+// Returns 0 if the context cannot compile or link the program
+GLuint buildSceneProgram(GLuint constantsBinding) {
+    auto glCreateShader = reinterpret_cast<PFNGLCREATESHADERPROC>(glProcLoader("glCreateShader"));
+    auto glShaderSource = reinterpret_cast<PFNGLSHADERSOURCEPROC>(glProcLoader("glShaderSource"));
+    auto glCompileShader = reinterpret_cast<PFNGLCOMPILESHADERPROC>(glProcLoader("glCompileShader"));
+    auto glGetShaderiv = reinterpret_cast<PFNGLGETSHADERIVPROC>(glProcLoader("glGetShaderiv"));
+    auto glDeleteShader = reinterpret_cast<PFNGLDELETESHADERPROC>(glProcLoader("glDeleteShader"));
+    auto glCreateProgram = reinterpret_cast<PFNGLCREATEPROGRAMPROC>(glProcLoader("glCreateProgram"));
+    auto glAttachShader = reinterpret_cast<PFNGLATTACHSHADERPROC>(glProcLoader("glAttachShader"));
+    auto glLinkProgram = reinterpret_cast<PFNGLLINKPROGRAMPROC>(glProcLoader("glLinkProgram"));
+    auto glGetProgramiv = reinterpret_cast<PFNGLGETPROGRAMIVPROC>(glProcLoader("glGetProgramiv"));
+    auto glDeleteProgram = reinterpret_cast<PFNGLDELETEPROGRAMPROC>(glProcLoader("glDeleteProgram"));
+    auto glGetUniformBlockIndex = reinterpret_cast<PFNGLGETUNIFORMBLOCKINDEXPROC>(glProcLoader("glGetUniformBlockIndex"));
+    auto glUniformBlockBinding = reinterpret_cast<PFNGLUNIFORMBLOCKBINDINGPROC>(glProcLoader("glUniformBlockBinding"));
+    if (!glCreateShader || !glShaderSource || !glCompileShader || !glGetShaderiv || !glDeleteShader ||
+        !glCreateProgram || !glAttachShader || !glLinkProgram || !glGetProgramiv || !glDeleteProgram ||
+        !glGetUniformBlockIndex || !glUniformBlockBinding) {
+        return 0;
+    }
+
+    auto compile = [&](GLenum type, const char* source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glDeleteShader(shader);
+            return 0u;
+        }
+        return shader;
+    };
+
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, SCENE_VERTEX_SHADER);
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, SCENE_FRAGMENT_SHADER);
+    GLuint program = 0;
+    if (vertexShader && fragmentShader) {
+        program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        GLuint block = linked ? glGetUniformBlockIndex(program, "DrawConstants") : GL_INVALID_INDEX;
+        if (block == GL_INVALID_INDEX) {
+            glDeleteProgram(program);
+            program = 0;
+        } else {
+            glUniformBlockBinding(program, block, constantsBinding);
+        }
+    }
+    if (vertexShader) glDeleteShader(vertexShader);
+    if (fragmentShader) glDeleteShader(fragmentShader);
+    return program;
+}
+
+} // namespace
+
+void init() {
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    sceneBackend.InitializeConstants();
+}
+
+Float4x4 buildViewProjection(float x, float y, float z, float angleX, float angleY, float aspect) {
+    float pitch = angleX * 3.14159f / 180.0f;
+    float yaw = angleY * 3.14159f / 180.0f;
+
+    Float4x4 rotateY = Float4x4::Identity();
+    rotateY.m[0][0] = cosf(yaw);
+    rotateY.m[0][2] = -sinf(yaw);
+    rotateY.m[2][0] = sinf(yaw);
+    rotateY.m[2][2] = cosf(yaw);
+
+    Float4x4 rotateX = Float4x4::Identity();
+    rotateX.m[1][1] = cosf(pitch);
+    rotateX.m[1][2] = sinf(pitch);
+    rotateX.m[2][1] = -sinf(pitch);
+    rotateX.m[2][2] = cosf(pitch);
+
+    // gluPerspective, transposed for row vectors
+    float f = 1.0f / tanf(fieldOfView * 3.14159f / 360.0f);
+    Float4x4 projection = {};
+    projection.m[0][0] = f / aspect;
+    projection.m[1][1] = f;
+    projection.m[2][2] = (farPlane + nearPlane) / (nearPlane - farPlane);
+    projection.m[2][3] = -1.0f;
+    projection.m[3][2] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+
+    Float4x4 view = Multiply(Multiply(Float4x4::Translation(-x, -y, -z), rotateY), rotateX);
+    return Multiply(view, projection);
+}
+
+void buildFloorMesh(LodMesh& mesh) {
+    const int GRID_SIZE = 20;
+    std::vector<uint32_t> indices;
+    for (int z = 0; z <= GRID_SIZE; ++z) {
+        for (int x = 0; x <= GRID_SIZE; ++x) {
+            mesh.positions.push_back({ static_cast<float>(x - GRID_SIZE / 2), 0.0f, static_cast<float>(z - GRID_SIZE / 2) });
+        }
+    }
+    for (int z = 0; z < GRID_SIZE; ++z) {
+        for (int x = 0; x < GRID_SIZE; ++x) {
+            uint32_t corner = z * (GRID_SIZE + 1) + x;
+            uint32_t next = corner + GRID_SIZE + 1;
+            indices.insert(indices.end(), { corner, corner + 1, next + 1, corner, next + 1, next });
+        }
+    }
+    mesh.chain = MeshSimplifier::BuildLodChain(mesh.positions.data(), static_cast<uint32_t>(mesh.positions.size()),
+                                               indices.data(), static_cast<uint32_t>(indices.size()));
+}
+
+GLSceneBackend::GLSceneBackend() :
+    m_mesh(MESH_FLOOR),
+    m_program(0),
+    m_programBound(false),
+    m_glUseProgram(nullptr) {
+}
+
+bool GLSceneBackend::InitializeConstants() {
+    ShutdownConstants();
+    m_glUseProgram = reinterpret_cast<PFNGLUSEPROGRAMPROC>(glProcLoader("glUseProgram"));
+    if (!m_glUseProgram || !m_constants.Initialize(CONSTANT_RING_SIZE, 3, glProcLoader)) {
+        return false;
+    }
+
+    m_program = buildSceneProgram(DRAW_CONSTANTS_BINDING);
+    if (m_program == 0) {
+        m_constants.Shutdown();
+        return false;
+    }
+    return true;
+}
+
+void GLSceneBackend::ShutdownConstants() {
+    if (m_program == 0) return;
+
+    auto glDeleteProgram = reinterpret_cast<PFNGLDELETEPROGRAMPROC>(glProcLoader("glDeleteProgram"));
+    glDeleteProgram(m_program);
+    m_program = 0;
+    m_constants.Shutdown();
+}
+
+void GLSceneBackend::BeginFrame() {
+    if (m_program) m_constants.BeginFrame();
+}
+
+void GLSceneBackend::EndFrame() {
+    if (m_program) m_constants.EndFrame();
+}
+
+void GLSceneBackend::BeginRange() {
+    if (m_program) {
+        m_glUseProgram(m_program);
+        m_programBound = true;
+    }
+}
+
+void GLSceneBackend::EndRange() {
+    if (m_programBound) {
+        m_glUseProgram(0);
+        m_programBound = false;
+    }
+}
+
+void GLSceneBackend::SetMaterial(uint32_t material) {
+    if (material == MATERIAL_TRANSLUCENT) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+void GLSceneBackend::Draw(const DrawItem& item) {
+    GLConstantRing::Allocation constants;
+    bool ringed = m_programBound && m_constants.Allocate(sizeof(item.world), constants);
+    if (ringed) {
+        memcpy(constants.data, &item.world.m[0][0], sizeof(item.world));
+        m_constants.Bind(DRAW_CONSTANTS_BINDING, constants);
+    } else {
+        if (m_programBound) m_glUseProgram(0);
+        glPushMatrix();
+        glMultMatrixf(&item.world.m[0][0]);
+    }
+
+    if (m_mesh == MESH_CUBE) {
+        drawCubeGeometry();
+    } else {
+        drawFloorGeometry(item.lod);
+    }
+
+    if (!ringed) {
+        glPopMatrix();
+        if (m_programBound) m_glUseProgram(m_program);
+    }
+}
+
+uint32_t recordStreams(uint32_t streamCount) {
+    if (commandStreams.size() < streamCount) {
+        commandStreams.resize(streamCount);
+    }
+
+    streamPointers.clear();
+    for (uint32_t i = 0; i < streamCount; ++i) {
+        commandStreams[i].Reset();
+        streamPointers.push_back(&commandStreams[i]);
+    }
+    renderQueue.ExecuteParallel(jobSystem, streamPointers.data(), streamCount);
+    return streamCount;
+}
+
+void submitStreamedWorld() {
+    const std::vector<const WorldChunk*>& chunks = worldStreamer.GetResidentChunks();
+    auto boundsOf = [](const WorldObject& object, Float3& boundsMin, Float3& boundsMax) {
+        boundsMin = { object.position.x - object.halfExtents.x, object.position.y - object.halfExtents.y,
+                      object.position.z - object.halfExtents.z };
+        boundsMax = { object.position.x + object.halfExtents.x, object.position.y + object.halfExtents.y,
+                      object.position.z + object.halfExtents.z };
+    };
+
+    Float3 boundsMin, boundsMax;
+    for (const WorldChunk* chunk : chunks) {
+        for (const WorldObject& object : chunk->objects) {
+            if (object.flags & WORLD_OBJECT_OCCLUDER) {
+                boundsOf(object, boundsMin, boundsMax);
+                occlusionCuller.RasterizeBox(boundsMin, boundsMax, Float4x4::Identity());
+            }
+        }
+    }
+    occlusionCuller.EndOccluders();
+
+    const std::vector<MeshLod>& floorLods = floorMesh.chain.lods;
+    for (const WorldChunk* chunk : chunks) {
+        for (const WorldObject& object : chunk->objects) {
+            boundsOf(object, boundsMin, boundsMax);
+            bool occluder = (object.flags & WORLD_OBJECT_OCCLUDER) != 0;
+            if (!occluder && !occlusionCuller.IsVisible(boundsMin, boundsMax)) continue;
+
+            // Streamed objects keep no LOD history, so they select without hysteresis
+            uint32_t lod = 0;
+            if (object.mesh == MESH_FLOOR) {
+                float scale = object.halfExtents.x / 10.0f;
+                lod = lodSelector.Select(floorLods.data(), static_cast<uint32_t>(floorLods.size()),
+                                         cameraDistance(boundsMin, boundsMax) / scale, 0);
+            }
+            submitDraw(object.mesh, lod, MATERIAL_OPAQUE, objectWorld(object.mesh, object.position, object.halfExtents));
+        }
+    }
+}
+
+void drawScene(RenderBackend& backend) {
+    renderQueue.Clear();
+    lodSelector.ResetStats();
+
+    if (worldStreamer.IsInitialized()) {
+        occlusionCuller.BeginFrame(buildViewProjection(cameraX, cameraY, cameraZ, cameraAngleX, cameraAngleY, aspectRatio));
+        submitStreamedWorld();
+        submitSceneGraph();
+        renderQueue.Sort();
+        executeQueue(backend);
+        return;
+    }
+
+    // Occluders first, then everything else is tested against them
+    occlusionCuller.BeginFrame(buildViewProjection(cameraX, cameraY, cameraZ, cameraAngleX, cameraAngleY, aspectRatio));
+    for (const SceneObject& object : sceneObjects) {
+        if (object.occluder) {
+            occlusionCuller.RasterizeBox(object.boundsMin, object.boundsMax, Float4x4::Identity());
+        }
+    }
+    occlusionCuller.EndOccluders();
+
+    for (size_t i = 0; i < SCENE_OBJECT_COUNT; ++i) {
+        const SceneObject& object = sceneObjects[i];
+        if (!object.occluder && !occlusionCuller.IsVisible(object.boundsMin, object.boundsMax)) {
+            continue;
+        }
+
+        // Only the floor has a simplified chain; cubes keep their hand-built faces
+        if (object.mesh == MESH_FLOOR) {
+            const std::vector<MeshLod>& lods = floorMesh.chain.lods;
+            sceneObjectLods[i] = lodSelector.Select(lods.data(), static_cast<uint32_t>(lods.size()),
+                                                    cameraDistance(object.boundsMin, object.boundsMax), sceneObjectLods[i]);
+        }
+
+        // Meshes are authored around the origin; the floor already is
+        Float4x4 world = Float4x4::Identity();
+        if (object.mesh == MESH_CUBE) {
+            world = Float4x4::Translation((object.boundsMin.x + object.boundsMax.x) * 0.5f,
+                                          (object.boundsMin.y + object.boundsMax.y) * 0.5f,
+                                          (object.boundsMin.z + object.boundsMax.z) * 0.5f);
+        }
+        submitDraw(object.mesh, sceneObjectLods[i], MATERIAL_OPAQUE, world);
+    }
+
+    const Float4x4 crateScale = Float4x4::Scale(CRATE_HALF_SIZE * 2.0f, CRATE_HALF_SIZE * 2.0f, CRATE_HALF_SIZE * 2.0f);
+    for (uint32_t body = firstCrate; body < crates.GetBodyCount(); ++body) {
+        submitDraw(MESH_CUBE, 0, MATERIAL_OPAQUE, Multiply(crateScale, crates.GetWorldMatrix(body)));
+    }
+    submitSceneGraph();
+
+    renderQueue.Sort();
+    executeQueue(backend);
+}
+
+bool generateWorld(const char* path, float sizeMeters) {
+    const float CHUNK_SIZE = 64.0f;
+    uint32_t chunks = std::max(1u, static_cast<uint32_t>(ceilf(sizeMeters / CHUNK_SIZE)));
+    float origin = -0.5f * chunks * CHUNK_SIZE;
+
+    return WorldFile::Write(path, chunks, chunks, CHUNK_SIZE, origin, origin,
+        [&](int32_t chunkX, int32_t chunkZ, std::vector<WorldObject>& objects) {
+            // Seeded per chunk so any chunk can be regenerated on its own
+            uint32_t seed = static_cast<uint32_t>(chunkX) * 73856093u ^ static_cast<uint32_t>(chunkZ) * 19349663u;
+            auto random01 = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+            };
+
+            float minX = origin + chunkX * CHUNK_SIZE;
+            float minZ = origin + chunkZ * CHUNK_SIZE;
+            float half = CHUNK_SIZE * 0.5f;
+            objects.push_back({ MESH_FLOOR, 0, { minX + half, 0.0f, minZ + half }, { half, 0.0f, half } });
+
+            int buildings = static_cast<int>(random01() * 4.0f);
+            for (int i = 0; i < buildings; ++i) {
+                Float3 extents = { 3.0f + random01() * 6.0f, 3.0f + random01() * 10.0f, 3.0f + random01() * 6.0f };
+                float x = minX + extents.x + random01() * (CHUNK_SIZE - 2.0f * extents.x);
+                float z = minZ + extents.z + random01() * (CHUNK_SIZE - 2.0f * extents.z);
+                objects.push_back({ MESH_CUBE, WORLD_OBJECT_OCCLUDER, { x, extents.y, z }, extents });
+            }
+
+            int props = 40 + static_cast<int>(random01() * 80.0f);
+            for (int i = 0; i < props; ++i) {
+                float size = 0.2f + random01() * 0.6f;
+                float x = minX + random01() * CHUNK_SIZE;
+                float z = minZ + random01() * CHUNK_SIZE;
+                objects.push_back({ MESH_CUBE, 0, { x, size, z }, { size, size, size } });
+            }
+        });
+}
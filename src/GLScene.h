@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "GLConstantRing.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "MathTypes.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
+#include "PhysicsWorld.h"
+#include "RenderCapture.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "WorldStreamer.h"
+
+// The OpenGL build's scene and how it is drawn: camera, culling, LOD
+// selection, the render queue and the fixed-function backend. Shared by the
+// game and the flythrough regression gate, so both draw exactly the same
+// frames; like the rest of the GLUT build it is kept in globals.
+
+// Scene ids referenced by DrawItems
+enum SceneMesh : uint32_t { MESH_FLOOR = 0, MESH_CUBE = 1 };
+enum SceneMaterial : uint32_t { MATERIAL_OPAQUE = 0, MATERIAL_TRANSLUCENT = 1 };
+
+// Camera position and orientation
+extern float cameraX;
+extern float cameraY;
+extern float cameraZ;
+extern float cameraAngleX;
+extern float cameraAngleY;
+
+// Projection, kept in sync with reshape()
+const float fieldOfView = 45.0f;
+const float nearPlane = 0.1f;
+const float farPlane = 100.0f;
+extern float aspectRatio;
+
+// glutGetProcAddress, unless the context was made without GLUT
+extern GLProcLoader glProcLoader;
+
+extern RenderQueue renderQueue;
+extern JobSystem jobSystem;
+extern RenderCapture renderCapture;
+extern OcclusionCuller occlusionCuller;
+
+extern WorldStreamer worldStreamer;
+const float WORLD_LOAD_RADIUS = 128.0f;
+const uint32_t WORLD_MAX_RESIDENT_CHUNKS = 64;
+
+// Level of detail; the viewport height comes from reshape()
+extern LodSelector lodSelector;
+const float LOD_PIXEL_ERROR = 1.0f;
+
+// Indexed geometry with an offline-built LOD chain
+struct LodMesh {
+    std::vector<Float3> positions;
+    MeshLodChain chain;
+};
+extern LodMesh floorMesh;
+
+struct SceneObject {
+    uint32_t mesh;
+    Float3 boundsMin;
+    Float3 boundsMax;
+    bool occluder;
+};
+
+const size_t SCENE_OBJECT_COUNT = 4;
+extern const SceneObject sceneObjects[SCENE_OBJECT_COUNT];
+
+// Crates drawn with the scene; bodies before firstCrate are the static cubes
+extern PhysicsWorld crates;
+extern uint32_t firstCrate;
+const float CRATE_HALF_SIZE = 0.25f;
+
+extern SceneGraph sceneGraph;
+
+// Render queue backend. When the context has buffer storage, each draw's world
+// matrix is written into a persistently mapped uniform ring and read by a small
+// compatibility-profile program; otherwise, or when the ring is full, it goes
+// through the fixed-function matrix stack.
+class GLSceneBackend : public RenderBackend {
+public:
+    GLSceneBackend();
+
+    // Needs a current context; stays on the fixed-function path if anything is missing
+    bool InitializeConstants();
+    void ShutdownConstants();
+
+    // Bracket each frame's draws so ring space is fenced and reused
+    void BeginFrame();
+    void EndFrame();
+
+    void BeginRange() override;
+    void EndRange() override;
+    void SetShader(uint32_t) override {}
+    void SetMaterial(uint32_t material) override;
+    void SetMesh(uint32_t mesh) override { m_mesh = mesh; }
+    void Draw(const DrawItem& item) override;
+
+    bool HasConstantRing() const { return m_program != 0; }
+    const GLConstantRing& GetConstantRing() const { return m_constants; }
+
+private:
+    uint32_t m_mesh;
+    GLConstantRing m_constants;
+    GLuint m_program;
+    bool m_programBound;
+    PFNGLUSEPROGRAMPROC m_glUseProgram;
+
+    // Constants
+    static constexpr uint32_t CONSTANT_RING_SIZE = 4 * 1024 * 1024;
+    static constexpr GLuint DRAW_CONSTANTS_BINDING = 0;
+};
+
+extern GLSceneBackend sceneBackend;
+
+void init();
+
+// Row-vector view-projection matching the fixed-function camera in display()
+Float4x4 buildViewProjection(float x, float y, float z, float angleX, float angleY, float aspect);
+
+// Builds the 20x20 floor grid as indexed triangles, wound like the old quads
+void buildFloorMesh(LodMesh& mesh);
+
+// Records the sorted queue into streamCount command streams on the job system
+uint32_t recordStreams(uint32_t streamCount);
+
+// Resident chunks replace the built-in scene when a world is streamed
+void submitStreamedWorld();
+
+// Culls, selects LODs, sorts and draws a frame from the current camera
+void drawScene(RenderBackend& backend = sceneBackend);
+
+// Procedural test map: a floor tile per chunk, a few buildings and scattered props
+bool generateWorld(const char* path, float sizeMeters);
@@ -0,0 +1,99 @@
+#pragma once
+#include <GL/freeglut.h>
+#include <GL/glext.h>
+#include <cstdint>
+#include "VertexLayout.h"
+
+// OpenGL side of VertexLayout. Generic attributes go to location i for the
+// layout's i-th element, for shader programs; the fixed-function arrays take
+// position, color, normal and texture coordinates by semantic.
+
+struct GLVertexFormat {
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+};
+
+inline GLVertexFormat GetGLVertexFormat(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::Float2: return { 2, GL_FLOAT, GL_FALSE };
+        case VertexFormat::Float3: return { 3, GL_FLOAT, GL_FALSE };
+        case VertexFormat::Float4: return { 4, GL_FLOAT, GL_FALSE };
+        case VertexFormat::Half2: return { 2, GL_HALF_FLOAT, GL_FALSE };
+        case VertexFormat::Unorm8x4: return { 4, GL_UNSIGNED_BYTE, GL_TRUE };
+        case VertexFormat::Octahedral16: return { 2, GL_SHORT, GL_TRUE };
+    }
+    return { 0, GL_FLOAT, GL_FALSE };
+}
+
+// Requires GL 2.0 for glVertexAttribPointer, GL 3.0 or ARB_half_float_vertex
+// for Half2; returns false if the entry points are missing
+template <typename Layout>
+bool BindVertexAttributes(const void* vertices) {
+    static PFNGLVERTEXATTRIBPOINTERPROC glVertexAttribPointerProc =
+        reinterpret_cast<PFNGLVERTEXATTRIBPOINTERPROC>(glutGetProcAddress("glVertexAttribPointer"));
+    static PFNGLENABLEVERTEXATTRIBARRAYPROC glEnableVertexAttribArrayProc =
+        reinterpret_cast<PFNGLENABLEVERTEXATTRIBARRAYPROC>(glutGetProcAddress("glEnableVertexAttribArray"));
+    if (!glVertexAttribPointerProc || !glEnableVertexAttribArrayProc) return false;
+
+    const uint8_t* base = static_cast<const uint8_t*>(vertices);
+    for (GLuint i = 0; i < Layout::ELEMENT_COUNT; ++i) {
+        GLVertexFormat format = GetGLVertexFormat(Layout::ELEMENTS[i].format);
+        glVertexAttribPointerProc(i, format.components, format.type, format.normalized, Layout::STRIDE,
+                                  base + Layout::ELEMENTS[i].offset);
+        glEnableVertexAttribArrayProc(i);
+    }
+    return true;
+}
+
+template <typename Layout>
+void UnbindVertexAttributes() {
+    static PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArrayProc =
+        reinterpret_cast<PFNGLDISABLEVERTEXATTRIBARRAYPROC>(glutGetProcAddress("glDisableVertexAttribArray"));
+    if (!glDisableVertexAttribArrayProc) return;
+    for (GLuint i = 0; i < Layout::ELEMENT_COUNT; ++i) glDisableVertexAttribArrayProc(i);
+}
+
+// Fixed function has nowhere to unfold octahedral normals, and GL 1.x takes
+// no half-float arrays, so those layouts need BindVertexAttributes and a shader
+template <typename Layout>
+void BindFixedFunctionArrays(const void* vertices) {
+    static_assert(!Layout::Has(VertexSemantic::Normal) ||
+                  Layout::ELEMENTS[Layout::IndexOf(VertexSemantic::Normal)].format == VertexFormat::Float3,
+                  "Fixed-function normals must be Float3");
+    static_assert(!Layout::Has(VertexSemantic::TexCoord) ||
+                  Layout::ELEMENTS[Layout::IndexOf(VertexSemantic::TexCoord)].format == VertexFormat::Float2,
+                  "Fixed-function texture coordinates must be Float2");
+
+    const uint8_t* base = static_cast<const uint8_t*>(vertices);
+    for (const VertexElement& element : Layout::ELEMENTS) {
+        GLVertexFormat format = GetGLVertexFormat(element.format);
+        const uint8_t* pointer = base + element.offset;
+        switch (element.semantic) {
+            case VertexSemantic::Position:
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glVertexPointer(format.components, format.type, Layout::STRIDE, pointer);
+                break;
+            case VertexSemantic::Color:
+                glEnableClientState(GL_COLOR_ARRAY);
+                glColorPointer(format.components, format.type, Layout::STRIDE, pointer);
+                break;
+            case VertexSemantic::Normal:
+                glEnableClientState(GL_NORMAL_ARRAY);
+                glNormalPointer(format.type, Layout::STRIDE, pointer);
+                break;
+            case VertexSemantic::TexCoord:
+                glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+                glTexCoordPointer(format.components, format.type, Layout::STRIDE, pointer);
+                break;
+        }
+    }
+}
+
+template <typename Layout>
+void UnbindFixedFunctionArrays() {
+    if (Layout::Has(VertexSemantic::Position)) glDisableClientState(GL_VERTEX_ARRAY);
+    if (Layout::Has(VertexSemantic::Color)) glDisableClientState(GL_COLOR_ARRAY);
+    if (Layout::Has(VertexSemantic::Normal)) glDisableClientState(GL_NORMAL_ARRAY);
+    if (Layout::Has(VertexSemantic::TexCoord)) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
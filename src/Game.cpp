@@ -1,14 +1,54 @@
 #include "Game.h"
+#include "AllocationTracker.h"
+#include "SoundSynth.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <stdexcept>
+#include <string>
 
 Game::Game() : 
     m_hwnd(nullptr),
     m_width(0),
     m_height(0),
-    m_gameState(GameState::MainMenu) {
+    m_gameState(GameState::MainMenu),
+    m_lastAmmo(0),
+    m_muzzleFlashActive(false),
+    m_shotCount(0),
+    m_firstCrate(0),
+    m_cameraNode(SceneGraph::INVALID_NODE),
+    m_platformNode(SceneGraph::INVALID_NODE),
+    m_tick(0),
+    m_tickAccumulator(0.0f),
+    m_updateMetric(MetricsRegistry::INVALID_METRIC),
+    m_tickMetric(MetricsRegistry::INVALID_METRIC),
+    m_shotMetric(MetricsRegistry::INVALID_METRIC),
+    m_awakeBodiesMetric(MetricsRegistry::INVALID_METRIC),
+    m_sceneRecomputedMetric(MetricsRegistry::INVALID_METRIC),
+    m_sceneSkippedMetric(MetricsRegistry::INVALID_METRIC),
+    m_captureUnsaved(false),
+    m_gunshotSound(AudioMixer::INVALID_SOUND),
+    m_impactSound(AudioMixer::INVALID_SOUND),
+    m_footstepCount(0),
+    m_strideDistance(0.0f),
+    m_lastStepPosition(0.0f, 0.0f, 0.0f),
+    m_firstFramePresented(false) {
+    for (uint32_t& sound : m_footstepSounds) {
+        sound = AudioMixer::INVALID_SOUND;
+    }
 }
 
 Game::~Game() {
+#ifdef _DEBUG
+    // Scale against scene time for the last minute, for tuning the controller
+    if (m_renderer && m_renderer->IsDynamicResolutionEnabled()) {
+        m_renderer->GetDynamicResolution().WriteTrace(RESOLUTION_TRACE_PATH);
+    }
+#endif
+    // The mixer thread writes to a sink until it stops
+    if (m_audio) {
+        m_audio->Shutdown();
+    }
     // Smart pointers will automatically clean up resources
 }
 
@@ -16,92 +56,177 @@ bool Game::Initialize(HWND hwnd, int width, int height) {
     m_hwnd = hwnd;
     m_width = width;
     m_height = height;
+    m_initializeStart = std::chrono::steady_clock::now();
 
-    // Initialize all subsystems
-    if (!InitializeRenderer()) {
-        throw std::runtime_error("Failed to initialize renderer");
-        return false;
-    }
-
-    if (!InitializeInput()) {
-        throw std::runtime_error("Failed to initialize input");
-        return false;
-    }
+    // Every object exists before any stage runs, so stages can hand each other pointers
+    m_renderer = std::make_unique<Renderer>();
+    m_input = std::make_unique<Input>();
+    m_camera = std::make_unique<Camera>();
+    m_player = std::make_unique<Player>();
+    m_uiOverlay = std::make_unique<UIOverlay>();
+    m_worldStreamer = std::make_unique<WorldStreamer>();
+    m_particles = std::make_unique<ParticleSystem>();
+    m_physics = std::make_unique<PhysicsWorld>();
+    m_sceneGraph = std::make_unique<SceneGraph>();
+    m_audio = std::make_unique<AudioMixer>();
+    m_metrics = std::make_unique<MetricsRegistry>();
+    m_capture = std::make_unique<RenderCapture>();
+    m_renderer->SetCapture(m_capture.get());
 
-    if (!InitializeCamera()) {
-        throw std::runtime_error("Failed to initialize camera");
-        return false;
-    }
+    // Only real dependencies are ordered; everything else initializes concurrently
+    StartupGraph graph;
+    Renderer::StartupStages renderer = m_renderer->AddStartupStages(graph, m_hwnd, m_width, m_height);
+    StartupGraph::StageId input = graph.AddStage("input", [this] { return InitializeInput(); },
+                                                 {}, StartupGraph::STAGE_MAIN_THREAD);
+    StartupGraph::StageId camera = graph.AddStage("camera", [this] { return InitializeCamera(); });
+    StartupGraph::StageId player = graph.AddStage("player", [this] { return InitializePlayer(); }, { input, camera });
+    StartupGraph::StageId ui = m_uiOverlay->AddStartupStages(graph, m_renderer.get(), m_input.get(), renderer.device);
+    graph.AddStage("ui.bindPlayer", [this] {
+        // HUD widgets read health and ammo straight from the player
+        m_uiOverlay->BindPlayer(m_player.get());
+        return true;
+    }, { ui, player });
+    graph.AddStage("world", [this] { return InitializeWorld(); }, { camera, renderer.ready });
+    graph.AddStage("particles", [this] { return InitializeParticles(); }, { renderer.ready });
+    graph.AddStage("physics", [this] { return InitializePhysics(); }, { renderer.ready });
+    graph.AddStage("sceneGraph", [this] { return InitializeSceneGraph(); }, { camera, renderer.ready });
+    graph.AddStage("metrics", [this] { return InitializeMetrics(); }, { renderer.ready });
+    // On the main thread because the device sink must be closed on the thread that opened it
+    graph.AddStage("audio", [this] { return InitializeAudio(); }, {}, StartupGraph::STAGE_MAIN_THREAD);
 
-    if (!InitializePlayer()) {
-        throw std::runtime_error("Failed to initialize player");
-        return false;
+    bool succeeded = graph.Run();
+    m_startupTimeline = graph.FormatTimeline();
+    if (!succeeded) {
+        throw std::runtime_error(graph.GetError());
     }
+    return true;
+}
 
-    if (!InitializeUI()) {
-        throw std::runtime_error("Failed to initialize UI");
-        return false;
-    }
+bool Game::InitializeInput() {
+    if (!m_input->Initialize(m_hwnd)) throw std::runtime_error("Input could not attach to the window");
+    return true;
+}
 
+bool Game::InitializeCamera() {
+    if (!m_camera->Initialize(DirectX::XMFLOAT3(0.0f, 0.0f, -5.0f))) throw std::runtime_error("Camera setup failed");
     return true;
 }
 
-bool Game::InitializeRenderer() {
-    try {
-        m_renderer = std::make_unique<Renderer>();
-        return m_renderer->Initialize(m_hwnd, m_width, m_height);
-    }
-    catch (const std::exception& e) {
-        // Log error
-        return false;
+bool Game::InitializePlayer() {
+    if (!m_player->Initialize(m_camera.get(), m_input.get())) {
+        throw std::runtime_error("Player needs a camera and input");
     }
+    m_lastStepPosition = m_player->GetPosition();
+    m_lastTickTime = std::chrono::steady_clock::now();
+    return true;
 }
 
-bool Game::InitializeInput() {
-    try {
-        m_input = std::make_unique<Input>();
-        return m_input->Initialize(m_hwnd);
-    }
-    catch (const std::exception& e) {
-        // Log error
-        return false;
+bool Game::InitializeWorld() {
+    // Without a world file the renderer keeps its built-in scene
+    if (m_worldStreamer->Initialize(WORLD_PATH, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS)) {
+        m_worldStreamer->SetRequiredRadius(m_camera->GetFarPlane());
+        m_renderer->SetWorld(m_worldStreamer.get());
     }
+    return true;
 }
 
-bool Game::InitializeCamera() {
-    try {
-        m_camera = std::make_unique<Camera>();
-        return m_camera->Initialize(DirectX::XMFLOAT3(0.0f, 0.0f, -5.0f));
+bool Game::InitializeParticles() {
+    if (!m_particles->Initialize()) throw std::runtime_error("Particle spawn queue allocation failed");
+    m_renderer->SetParticles(m_particles.get());
+    m_lastParticleUpdate = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool Game::InitializePhysics() {
+    // The renderer's built-in cubes, then a pile of crates beyond them
+    static const Float3 SCENE_CUBES[] = { { 0.0f, 0.5f, -2.0f }, { -2.0f, 0.5f, -2.0f }, { 2.0f, 0.5f, -2.0f } };
+    const uint32_t sceneCubeCount = sizeof(SCENE_CUBES) / sizeof(SCENE_CUBES[0]);
+    if (!m_physics->Initialize(sceneCubeCount + CRATE_COUNT)) {
+        throw std::runtime_error("Physics world allocation failed");
+    }
+    for (const Float3& center : SCENE_CUBES) {
+        PhysicsWorld::BoxDesc desc = {};
+        desc.position = center;
+        desc.orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        desc.halfExtents = { 0.5f, 0.5f, 0.5f };
+        m_physics->AddBox(desc);
     }
-    catch (const std::exception& e) {
-        // Log error
-        return false;
+    m_firstCrate = m_physics->GetBodyCount();
+    for (uint32_t i = 0; i < CRATE_COUNT; ++i) {
+        PhysicsWorld::BoxDesc desc = {};
+        float spacing = CRATE_HALF_SIZE * 2.08f;
+        desc.position = { (i % 3 - 1.0f) * spacing, CRATE_HALF_SIZE + (i / 9) * spacing, 2.0f + (i / 3 % 3 - 1.0f) * spacing };
+        desc.orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        desc.halfExtents = { CRATE_HALF_SIZE, CRATE_HALF_SIZE, CRATE_HALF_SIZE };
+        desc.mass = CRATE_MASS;
+        m_physics->AddBox(desc);
     }
+    m_renderer->SetPhysics(m_physics.get(), m_firstCrate);
+    m_lastPhysicsUpdate = std::chrono::steady_clock::now();
+    return true;
 }
 
-bool Game::InitializePlayer() {
-    try {
-        m_player = std::make_unique<Player>();
-        return m_player->Initialize(m_camera.get(), m_input.get());
-    }
-    catch (const std::exception& e) {
-        // Log error
-        return false;
+bool Game::InitializeSceneGraph() {
+    // The weapon sits below and right of the view; the platform's mesh is a child so its
+    // scale does not stretch the crate riding on it
+    m_cameraNode = m_sceneGraph->AddNode(SceneGraph::INVALID_NODE, Float4x4::Identity());
+    m_sceneGraph->AddNode(m_cameraNode, Multiply(Float4x4::Scale(0.08f, 0.08f, 0.5f), Float4x4::Translation(0.25f, -0.2f, 0.6f)),
+                          Renderer::MESH_CUBE);
+    m_platformNode = m_sceneGraph->AddNode(SceneGraph::INVALID_NODE, Float4x4::Translation(0.0f, 0.1f, 6.0f));
+    m_sceneGraph->AddNode(m_platformNode, Float4x4::Scale(2.0f, 0.2f, 2.0f), Renderer::MESH_CUBE);
+    m_sceneGraph->AddNode(m_platformNode, Multiply(Float4x4::Scale(0.5f, 0.5f, 0.5f), Float4x4::Translation(0.4f, 0.35f, 0.0f)),
+                          Renderer::MESH_CUBE);
+    m_sceneGraph->Update();
+    m_renderer->SetSceneGraph(m_sceneGraph.get());
+    m_sceneStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool Game::InitializeAudio() {
+    if (!m_audio->Initialize()) throw std::runtime_error("Audio mixer setup failed");
+    std::vector<float> samples = SynthesizeGunshot(AudioMixer::SAMPLE_RATE);
+    m_gunshotSound = m_audio->AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
+    samples = SynthesizeImpact(AudioMixer::SAMPLE_RATE);
+    m_impactSound = m_audio->AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
+    for (uint32_t i = 0; i < FOOTSTEP_VARIATIONS; ++i) {
+        samples = SynthesizeFootstep(AudioMixer::SAMPLE_RATE, i);
+        m_footstepSounds[i] = m_audio->AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
     }
+
+    // Without an output device the game still runs, mixing into silence at the same pace
+    m_audioDevice = std::make_unique<WasapiAudioSink>();
+    if (m_audio->Start(m_audioDevice.get())) return true;
+    m_silentAudio = std::make_unique<NullAudioSink>();
+    if (!m_audio->Start(m_silentAudio.get())) throw std::runtime_error("Audio mixer thread could not start");
+    return true;
 }
 
-bool Game::InitializeUI() {
-    try {
-        m_uiOverlay = std::make_unique<UIOverlay>();
-        return m_uiOverlay->Initialize(m_renderer.get());
+bool Game::InitializeMetrics() {
+    if (!m_metrics->Initialize()) throw std::runtime_error("Metrics registry allocation failed");
+    m_updateMetric = m_metrics->AddHistogram("fpsgame_game_update", "Game::Update time");
+    m_tickMetric = m_metrics->AddCounter("fpsgame_simulation_ticks_total", "Simulation ticks run");
+    m_shotMetric = m_metrics->AddCounter("fpsgame_shots_total", "Shots fired by the player");
+    m_awakeBodiesMetric = m_metrics->AddGauge("fpsgame_physics_awake_bodies", "Rigid bodies simulated last step");
+    m_sceneRecomputedMetric = m_metrics->AddGauge("fpsgame_scene_nodes_recomputed", "Scene graph world matrices rebuilt last frame");
+    m_sceneSkippedMetric = m_metrics->AddGauge("fpsgame_scene_nodes_skipped", "Clean scene graph nodes skipped last frame");
+    if (m_updateMetric == MetricsRegistry::INVALID_METRIC || m_tickMetric == MetricsRegistry::INVALID_METRIC ||
+        m_shotMetric == MetricsRegistry::INVALID_METRIC || m_awakeBodiesMetric == MetricsRegistry::INVALID_METRIC ||
+        m_sceneRecomputedMetric == MetricsRegistry::INVALID_METRIC || m_sceneSkippedMetric == MetricsRegistry::INVALID_METRIC) {
+        throw std::runtime_error("Metrics registry is full");
     }
-    catch (const std::exception& e) {
-        // Log error
-        return false;
+    m_renderer->SetMetrics(m_metrics.get());
+    m_uiOverlay->SetMetrics(m_metrics.get());
+    if (!m_metrics->StartExport(METRICS_PATH)) {
+        throw std::runtime_error(std::string("Metrics export to ") + METRICS_PATH + " could not start");
     }
+    return true;
 }
 
 void Game::Update() {
+    // A frame is this Update plus the following Render
+    AllocationTracker::BeginFrame();
+    MetricsTimerScope timer(m_metrics.get(), m_updateMetric);
+
     switch (m_gameState) {
         case GameState::MainMenu:
             UpdateUI();
@@ -111,6 +236,10 @@ void Game::Update() {
             UpdateInput();
             UpdatePlayer();
             UpdateCamera();
+            UpdateAudio();
+            UpdateParticles();
+            UpdatePhysics();
+            UpdateSceneGraph();
             UpdateUI();
             break;
 
@@ -129,6 +258,9 @@ void Game::UpdateInput() {
             m_gameState = (m_gameState == GameState::Playing) ? 
                          GameState::Paused : GameState::Playing;
         }
+        if (m_input->IsKeyPressed(VK_F9)) {
+            ToggleCapture();
+        }
     }
 }
 
@@ -140,16 +272,185 @@ void Game::UpdateCamera() {
 
 void Game::UpdatePlayer() {
     if (m_player) {
-        m_player->Update();
+        // The clock only decides how many fixed ticks are due; the simulation never sees it.
+        // After a long stall (or a pause) the backlog is dropped rather than replayed.
+        auto now = std::chrono::steady_clock::now();
+        m_tickAccumulator += std::chrono::duration<float>(now - m_lastTickTime).count();
+        m_lastTickTime = now;
+        m_tickAccumulator = (std::min)(m_tickAccumulator, MAX_TICKS_PER_FRAME * Simulation::TICK_SECONDS);
+
+        m_player->SampleInput();
+        while (m_tickAccumulator >= Simulation::TICK_SECONDS) {
+            m_tickAccumulator -= Simulation::TICK_SECONDS;
+            m_player->Update(m_tick++);
+            m_metrics->Increment(m_tickMetric);
+
+            int ammo = m_player->GetAmmo();
+            if (ammo < m_lastAmmo) {
+                m_muzzleFlashStart = now;
+                m_muzzleFlashActive = true;
+                m_metrics->Increment(m_shotMetric);
+                EmitShotParticles();
+                PlayShotSounds();
+                PushShotCrate();
+            }
+            m_lastAmmo = ammo;
+        }
+
+        if (m_worldStreamer && m_worldStreamer->IsInitialized()) {
+            MemoryTagScope tag(MemoryTag::World);
+            DirectX::XMFLOAT3 position = m_player->GetPosition();
+            DirectX::XMFLOAT3 velocity = m_player->GetVelocity();
+            m_worldStreamer->Update({ position.x, position.y, position.z }, { velocity.x, velocity.y, velocity.z });
+        }
+    }
+}
+
+void Game::UpdateParticles() {
+    auto now = std::chrono::steady_clock::now();
+    float deltaSeconds = std::chrono::duration<float>(now - m_lastParticleUpdate).count();
+    m_lastParticleUpdate = now;
+    m_particles->Update((std::min)(deltaSeconds, MAX_PARTICLE_STEP), &m_renderer->GetJobSystem());
+}
+
+void Game::UpdatePhysics() {
+    MemoryTagScope tag(MemoryTag::Physics);
+    auto now = std::chrono::steady_clock::now();
+    float deltaSeconds = std::chrono::duration<float>(now - m_lastPhysicsUpdate).count();
+    m_lastPhysicsUpdate = now;
+    m_physics->Step((std::min)(deltaSeconds, MAX_PHYSICS_STEP), &m_renderer->GetJobSystem());
+    m_metrics->SetGauge(m_awakeBodiesMetric, m_physics->GetStats().awakeBodies);
+}
+
+void Game::UpdateSceneGraph() {
+    // The camera's world matrix is the inverse of its view
+    Float4x4 cameraWorld;
+    DirectX::XMStoreFloat4x4(reinterpret_cast<DirectX::XMFLOAT4X4*>(&cameraWorld),
+                             DirectX::XMMatrixInverse(nullptr, m_camera->GetViewMatrix()));
+    m_sceneGraph->SetLocal(m_cameraNode, cameraWorld);
+
+    float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_sceneStart).count();
+    float phase = fmodf(seconds, PLATFORM_PERIOD) / PLATFORM_PERIOD * 6.2831853f;
+    m_sceneGraph->SetLocal(m_platformNode, Float4x4::Translation(sinf(phase) * PLATFORM_TRAVEL, 0.1f, 6.0f));
+
+    m_sceneGraph->Update();
+    const SceneGraph::Stats& stats = m_sceneGraph->GetStats();
+    m_metrics->SetGauge(m_sceneRecomputedMetric, stats.recomputed);
+    m_metrics->SetGauge(m_sceneSkippedMetric, stats.skipped);
+}
+
+Float3 Game::GetShotHit(uint32_t* crate) const {
+    // Where the shot meets a box or the ground, or the end of its range
+    DirectX::XMFLOAT3 position = m_player->GetPosition();
+    DirectX::XMFLOAT3 forward = m_player->GetForwardVector();
+    float distance = forward.y < -0.001f ? (std::min)(-position.y / forward.y, SHOT_RANGE) : SHOT_RANGE;
+    PhysicsWorld::RayHit hit;
+    if (m_physics->RayCast({ position.x, position.y, position.z }, { forward.x, forward.y, forward.z }, distance, hit)) {
+        distance = hit.distance;
+        if (crate) *crate = hit.body;
+    } else if (crate) {
+        *crate = PhysicsWorld::INVALID_BODY;
     }
+    return { position.x + forward.x * distance, position.y + forward.y * distance, position.z + forward.z * distance };
+}
+
+void Game::PushShotCrate() {
+    // Static scene cubes ignore the impulse
+    uint32_t crate;
+    Float3 hit = GetShotHit(&crate);
+    if (crate == PhysicsWorld::INVALID_BODY) return;
+    DirectX::XMFLOAT3 forward = m_player->GetForwardVector();
+    m_physics->ApplyImpulse(crate, { forward.x * SHOT_IMPULSE, forward.y * SHOT_IMPULSE, forward.z * SHOT_IMPULSE }, hit);
+}
+
+void Game::EmitShotParticles() {
+    DirectX::XMFLOAT3 position = m_player->GetPosition();
+    DirectX::XMFLOAT3 forward = m_player->GetForwardVector();
+    Float3 direction = { forward.x, forward.y, forward.z };
+    Float3 muzzle = { position.x + forward.x * 0.5f, position.y + forward.y * 0.5f, position.z + forward.z * 0.5f };
+
+    // Sparks and smoke at the hit
+    Float3 hit = GetShotHit();
+    Float3 back = { -forward.x, -forward.y, -forward.z };
+
+    uint32_t seed = ++m_shotCount * 2654435761u;
+    m_particles->Emit({ PARTICLE_MUZZLE_FLASH, 24, muzzle, direction, 3.0f, 0.6f, seed });
+    m_particles->Emit({ PARTICLE_IMPACT, 48, hit, back, 4.0f, 1.0f, seed + 1 });
+    m_particles->Emit({ PARTICLE_SMOKE, 12, hit, back, 0.4f, 1.0f, seed + 2 });
+}
+
+void Game::PlayShotSounds() {
+    // Our own gun never gives way to other sounds; the impact is placed in the world
+    m_audio->PlayLocal(m_gunshotSound, 0.8f, 255);
+    m_audio->Play(m_impactSound, GetShotHit(), 1.0f, 160);
+}
+
+void Game::UpdateAudio() {
+    // A footstep every stride walked on the ground
+    DirectX::XMFLOAT3 position = m_player->GetPosition();
+    float dx = position.x - m_lastStepPosition.x;
+    float dz = position.z - m_lastStepPosition.z;
+    m_lastStepPosition = position;
+    if (std::fabs(m_player->GetVelocity().y) < 0.01f) {
+        m_strideDistance += std::sqrt(dx * dx + dz * dz);
+        if (m_strideDistance >= STRIDE_LENGTH) {
+            m_strideDistance -= STRIDE_LENGTH;
+            m_audio->PlayLocal(m_footstepSounds[m_footstepCount++ % FOOTSTEP_VARIATIONS], 0.5f, 64);
+        }
+    }
+
+    // The listener is the camera, panning along its right vector
+    DirectX::XMFLOAT3 eye = m_camera->GetPosition();
+    DirectX::XMFLOAT3 right = m_camera->GetRight();
+    m_audio->SetListener({ eye.x, eye.y, eye.z }, { right.x, right.y, right.z });
 }
 
 void Game::UpdateUI() {
     if (m_uiOverlay) {
+        MemoryTagScope tag(MemoryTag::UI);
         m_uiOverlay->Update(m_gameState);
     }
 }
 
+void Game::SubmitLights() {
+    if (!m_muzzleFlashActive || !m_player) return;
+
+    float age = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_muzzleFlashStart).count();
+    if (age >= MUZZLE_FLASH_SECONDS) {
+        m_muzzleFlashActive = false;
+        return;
+    }
+
+    // Slightly ahead of the player, fading out over the flash
+    DirectX::XMFLOAT3 position = m_player->GetPosition();
+    DirectX::XMFLOAT3 forward = m_player->GetForwardVector();
+    PointLight flash;
+    flash.position = { position.x + forward.x * 0.5f, position.y + forward.y * 0.5f, position.z + forward.z * 0.5f };
+    flash.radius = MUZZLE_FLASH_RADIUS;
+    flash.color = { 1.0f, 0.75f, 0.4f };
+    flash.intensity = MUZZLE_FLASH_INTENSITY * (1.0f - age / MUZZLE_FLASH_SECONDS);
+    m_renderer->SubmitLight(flash);
+}
+
+void Game::ToggleCapture() {
+    if (m_capture->IsCapturing()) {
+        m_capture->Stop();
+        SaveCapture();
+        return;
+    }
+    m_capture->Start();
+    m_captureUnsaved = true;
+}
+
+void Game::SaveCapture() {
+    m_captureUnsaved = false;
+    char line[160];
+    bool saved = m_capture->Save(CAPTURE_PATH);
+    snprintf(line, sizeof(line), "%s %u frames to %s\n", saved ? "Captured" : "Could not write",
+             m_capture->GetFrameCount(), CAPTURE_PATH);
+    OutputDebugStringA(line);
+}
+
 void Game::Render() {
     if (!m_renderer) return;
 
@@ -162,6 +463,7 @@ void Game::Render() {
 
         case GameState::Playing:
             // Render 3D scene
+            SubmitLights();
             m_renderer->Render(m_camera.get());
             
             // Render HUD
@@ -178,4 +480,20 @@ void Game::Render() {
     }
 
     m_renderer->EndScene();
+    AllocationTracker::EndFrame();
+
+    // Captures also end by themselves after RenderCapture::DEFAULT_MAX_FRAMES
+    if (m_captureUnsaved && !m_capture->IsCapturing()) {
+        SaveCapture();
+    }
+
+    if (!m_firstFramePresented) {
+        // Time to first frame closes the startup timeline
+        m_firstFramePresented = true;
+        char line[64];
+        snprintf(line, sizeof(line), "first frame %.2f ms\n", std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_initializeStart).count());
+        m_startupTimeline += line;
+        OutputDebugStringA(m_startupTimeline.c_str());
+    }
 }
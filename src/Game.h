@@ -2,12 +2,22 @@
 #include <windows.h>
 #include <d3d11.h>
 #include <directxmath.h>
+#include <chrono>
 #include <memory>
+#include <string>
+#include "AudioMixer.h"
 #include "Renderer.h"
+#include "StartupGraph.h"
 #include "Input.h"
+#include "MetricsRegistry.h"
 #include "Camera.h"
+#include "ParticleSystem.h"
+#include "PhysicsWorld.h"
 #include "Player.h"
+#include "SceneGraph.h"
 #include "UIOverlay.h"
+#include "WasapiAudioSink.h"
+#include "WorldStreamer.h"
 
 class Game {
 public:
@@ -18,6 +28,9 @@ public:
     void Update();
     void Render();
 
+    // Per-stage startup times, plus time to first frame once it is presented
+    const std::string& GetStartupTimeline() const { return m_startupTimeline; }
+
 private:
     // Window properties
     HWND m_hwnd;
@@ -30,6 +43,17 @@ private:
     std::unique_ptr<Camera> m_camera;
     std::unique_ptr<Player> m_player;
     std::unique_ptr<UIOverlay> m_uiOverlay;
+    std::unique_ptr<WorldStreamer> m_worldStreamer;
+    std::unique_ptr<ParticleSystem> m_particles;
+    std::unique_ptr<PhysicsWorld> m_physics;
+    std::unique_ptr<SceneGraph> m_sceneGraph;
+    // The sinks outlive the mixer, which is shut down first
+    std::unique_ptr<WasapiAudioSink> m_audioDevice;
+    std::unique_ptr<NullAudioSink> m_silentAudio;
+    std::unique_ptr<AudioMixer> m_audio;
+    std::unique_ptr<MetricsRegistry> m_metrics;
+    std::unique_ptr<RenderCapture> m_capture;   // F9 starts and stops; written to CAPTURE_PATH
+    bool m_captureUnsaved;
 
     // Game states
     enum class GameState {
@@ -39,16 +63,96 @@ private:
     };
     GameState m_gameState;
 
-    // Initialize subsystems
-    bool InitializeRenderer();
+    // Muzzle flash point light, started when the player's ammo drops
+    int m_lastAmmo;
+    std::chrono::steady_clock::time_point m_muzzleFlashStart;
+    bool m_muzzleFlashActive;
+    uint32_t m_shotCount;             // Seeds each shot's particle bursts
+    std::chrono::steady_clock::time_point m_lastParticleUpdate;
+
+    // Fixed simulation ticks, run as wall-clock time accumulates
+    uint32_t m_tick;
+    float m_tickAccumulator;
+    std::chrono::steady_clock::time_point m_lastTickTime;
+
+    // Crates knocked about by shots; the scene's cubes are static bodies before them
+    uint32_t m_firstCrate;
+    std::chrono::steady_clock::time_point m_lastPhysicsUpdate;
+
+    // Scene graph roots moved each frame: the weapon hangs off the camera, a crate rides the platform
+    uint32_t m_cameraNode;
+    uint32_t m_platformNode;
+    std::chrono::steady_clock::time_point m_sceneStart;
+
+    // Sounds, and distance walked since the last footstep
+    static constexpr uint32_t FOOTSTEP_VARIATIONS = 4;
+    uint32_t m_gunshotSound;
+    uint32_t m_impactSound;
+    uint32_t m_footstepSounds[FOOTSTEP_VARIATIONS];
+    uint32_t m_footstepCount;
+    float m_strideDistance;
+    DirectX::XMFLOAT3 m_lastStepPosition;
+
+    // Metric ids
+    uint32_t m_updateMetric;
+    uint32_t m_tickMetric;
+    uint32_t m_shotMetric;
+    uint32_t m_awakeBodiesMetric;
+    uint32_t m_sceneRecomputedMetric;
+    uint32_t m_sceneSkippedMetric;
+
+    // Startup
+    std::chrono::steady_clock::time_point m_initializeStart;
+    bool m_firstFramePresented;
+    std::string m_startupTimeline;
+
+    // Initialize subsystems; run as startup graph stages
     bool InitializeInput();
     bool InitializeCamera();
     bool InitializePlayer();
-    bool InitializeUI();
+    bool InitializeWorld();
+    bool InitializeParticles();
+    bool InitializePhysics();
+    bool InitializeSceneGraph();
+    bool InitializeAudio();
+    bool InitializeMetrics();
 
     // Update subsystems
     void UpdateInput();
     void UpdateCamera();
     void UpdatePlayer();
+    void UpdateParticles();
+    void UpdatePhysics();
+    void UpdateSceneGraph();
+    Float3 GetShotHit(uint32_t* crate = nullptr) const;
+    void PushShotCrate();
+    void EmitShotParticles();
+    void PlayShotSounds();
+    void UpdateAudio();
     void UpdateUI();
+    void SubmitLights();
+    void ToggleCapture();
+    void SaveCapture();
+
+    // Constants
+    static constexpr const char* WORLD_PATH = "world.bin";
+    static constexpr float WORLD_LOAD_RADIUS = 192.0f;
+    static constexpr uint32_t WORLD_MAX_RESIDENT_CHUNKS = 96;
+    static constexpr const char* METRICS_PATH = "metrics.prom";  // For a Prometheus textfile collector
+    static constexpr const char* CAPTURE_PATH = "frames.rcap";
+    static constexpr const char* RESOLUTION_TRACE_PATH = "resolution_trace.csv";
+    static constexpr float MUZZLE_FLASH_SECONDS = 0.08f;
+    static constexpr float MUZZLE_FLASH_RADIUS = 8.0f;
+    static constexpr float MUZZLE_FLASH_INTENSITY = 4.0f;
+    static constexpr float SHOT_RANGE = 100.0f;
+    static constexpr float MAX_PARTICLE_STEP = 0.1f;  // Seconds; longer gaps, e.g. while paused, are clamped
+    static constexpr float STRIDE_LENGTH = 0.8f;      // Metres walked per footstep
+    static constexpr float MAX_PHYSICS_STEP = 1.0f / 30.0f;
+    static constexpr float MAX_TICKS_PER_FRAME = 8.0f;
+    static constexpr uint32_t CRATE_COUNT = 27;       // A 3 x 3 x 3 pile
+    static constexpr float CRATE_HALF_SIZE = 0.25f;
+    static constexpr float CRATE_MASS = 5.0f;
+    static constexpr float SHOT_IMPULSE = 15.0f;
+    static constexpr float PLATFORM_TRAVEL = 3.0f;    // Metres either side of the middle
+    static constexpr float PLATFORM_PERIOD = 6.0f;    // Seconds per round trip
 };
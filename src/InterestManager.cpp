@@ -0,0 +1,382 @@
+#include "InterestManager.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+enum CellVisibility : uint8_t { CELL_UNKNOWN, CELL_VISIBLE, CELL_HIDDEN };
+
+float Component(const Float3& v, uint32_t axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+bool Contains(const Float3& minimum, const Float3& maximum, const Float3& point) {
+    return point.x >= minimum.x && point.x <= maximum.x && point.y >= minimum.y && point.y <= maximum.y &&
+           point.z >= minimum.z && point.z <= maximum.z;
+}
+
+// Slab test of the segment from..to against a box
+bool SegmentHitsBox(const Float3& from, const Float3& to, const Float3& minimum, const Float3& maximum) {
+    float enter = 0.0f, exit = 1.0f;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        float start = Component(from, axis);
+        float delta = Component(to, axis) - start;
+        float low = Component(minimum, axis), high = Component(maximum, axis);
+        if (std::fabs(delta) < 1e-8f) {
+            if (start < low || start > high) return false;
+            continue;
+        }
+        float t0 = (low - start) / delta, t1 = (high - start) / delta;
+        if (t0 > t1) std::swap(t0, t1);
+        enter = std::max(enter, t0);
+        exit = std::min(exit, t1);
+        if (enter > exit) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+InterestManager::InterestManager() :
+    m_entityCount(0),
+    m_cellChanges(0),
+    m_useVisibility(true),
+    m_tick(0),
+    m_stats() {
+}
+
+InterestManager::~InterestManager() {
+}
+
+bool InterestManager::Initialize(uint32_t maxEntities, uint32_t maxClients) {
+    if (maxEntities == 0 || maxEntities == INVALID_INDEX || maxClients == 0 || maxClients == INVALID_INDEX) return false;
+
+    m_positions.assign(maxEntities, Float3{});
+    m_importance.assign(maxEntities, 0.0f);
+    m_bucket.assign(maxEntities, 0);
+    m_bucketSlot.assign(maxEntities, INVALID_INDEX);
+    // Handed out lowest index first
+    m_freeEntities.resize(maxEntities);
+    for (uint32_t i = 0; i < maxEntities; ++i) m_freeEntities[i] = maxEntities - 1 - i;
+    m_buckets.assign(BUCKET_COUNT, std::vector<BucketEntry>());
+    m_entityCount = 0;
+    m_cellChanges = 0;
+
+    m_occluderMin.clear();
+    m_occluderMax.clear();
+    m_occluderBuckets.assign(BUCKET_COUNT, std::vector<OccluderEntry>());
+
+    m_clients.clear();
+    m_clients.resize(maxClients);
+    for (Client& client : m_clients) {
+        client.view = {};
+        client.active = false;
+        client.sent.assign(MIN_SENT_CAPACITY, { INVALID_INDEX, 0 });
+        client.sentCount = 0;
+    }
+    m_tick = 0;
+    m_stats = {};
+    return true;
+}
+
+int32_t InterestManager::ToCell(float coordinate) {
+    return static_cast<int32_t>(std::floor(coordinate / CELL_SIZE));
+}
+
+uint32_t InterestManager::HashCell(int32_t cellX, int32_t cellZ) {
+    uint32_t hash = static_cast<uint32_t>(cellX) * 0x9E3779B1u + static_cast<uint32_t>(cellZ) * 0x85EBCA77u;
+    hash ^= hash >> 15;
+    return hash & (BUCKET_COUNT - 1);
+}
+
+uint32_t InterestManager::AddEntity(const Float3& position, float importance) {
+    if (m_freeEntities.empty()) return INVALID_INDEX;
+    uint32_t entity = m_freeEntities.back();
+    m_freeEntities.pop_back();
+
+    int32_t cellX = ToCell(position.x), cellZ = ToCell(position.z);
+    uint32_t bucket = HashCell(cellX, cellZ);
+    m_positions[entity] = position;
+    m_importance[entity] = importance;
+    m_bucket[entity] = bucket;
+    m_bucketSlot[entity] = static_cast<uint32_t>(m_buckets[bucket].size());
+    m_buckets[bucket].push_back({ position, entity, cellX, cellZ });
+    ++m_entityCount;
+
+    // A reused index is a new entity to every client
+    for (Client& client : m_clients) {
+        if (GetLastSent(client, entity) != 0) SetLastSent(client, entity, 0);
+    }
+    return entity;
+}
+
+void InterestManager::RemoveEntity(uint32_t entity) {
+    if (!IsEntityAlive(entity)) return;
+    RemoveFromBucket(entity, m_bucket[entity]);
+    m_bucketSlot[entity] = INVALID_INDEX;
+    m_freeEntities.push_back(entity);
+    --m_entityCount;
+}
+
+void InterestManager::RemoveFromBucket(uint32_t entity, uint32_t bucket) {
+    std::vector<BucketEntry>& entries = m_buckets[bucket];
+    uint32_t slot = m_bucketSlot[entity];
+    entries[slot] = entries.back();
+    m_bucketSlot[entries[slot].entity] = slot;
+    entries.pop_back();
+}
+
+void InterestManager::MoveEntity(uint32_t entity, const Float3& position) {
+    if (!IsEntityAlive(entity)) return;
+    m_positions[entity] = position;
+    BucketEntry& entry = m_buckets[m_bucket[entity]][m_bucketSlot[entity]];
+    int32_t cellX = ToCell(position.x), cellZ = ToCell(position.z);
+    if (cellX == entry.cellX && cellZ == entry.cellZ) {
+        entry.position = position;
+        return;
+    }
+
+    ++m_cellChanges;
+    uint32_t bucket = HashCell(cellX, cellZ);
+    if (bucket == m_bucket[entity]) {
+        entry = { position, entity, cellX, cellZ };
+        return;
+    }
+    RemoveFromBucket(entity, m_bucket[entity]);
+    m_bucket[entity] = bucket;
+    m_bucketSlot[entity] = static_cast<uint32_t>(m_buckets[bucket].size());
+    m_buckets[bucket].push_back({ position, entity, cellX, cellZ });
+}
+
+uint32_t InterestManager::AddClient(const ClientView& view) {
+    for (uint32_t client = 0; client < m_clients.size(); ++client) {
+        if (m_clients[client].active) continue;
+        m_clients[client].view = view;
+        m_clients[client].active = true;
+        ClearSent(m_clients[client]);
+        return client;
+    }
+    return INVALID_INDEX;
+}
+
+void InterestManager::RemoveClient(uint32_t client) {
+    m_clients[client].active = false;
+    m_clients[client].relevant.clear();
+    m_clients[client].sendList.clear();
+}
+
+uint32_t InterestManager::GetLastSent(const Client& client, uint32_t entity) {
+    uint32_t mask = static_cast<uint32_t>(client.sent.size()) - 1;
+    for (uint32_t slot = (entity * 0x9E3779B1u) & mask;; slot = (slot + 1) & mask) {
+        const SentEntry& entry = client.sent[slot];
+        if (entry.entity == entity) return entry.tick;
+        if (entry.entity == INVALID_INDEX) return 0;
+    }
+}
+
+void InterestManager::SetLastSent(Client& client, uint32_t entity, uint32_t tick) {
+    uint32_t mask = static_cast<uint32_t>(client.sent.size()) - 1;
+    for (uint32_t slot = (entity * 0x9E3779B1u) & mask;; slot = (slot + 1) & mask) {
+        SentEntry& entry = client.sent[slot];
+        if (entry.entity == entity) {
+            entry.tick = tick;
+            return;
+        }
+        if (entry.entity == INVALID_INDEX) {
+            entry = { entity, tick };
+            ++client.sentCount;
+            return;
+        }
+    }
+}
+
+void InterestManager::ReserveSent(Client& client, uint32_t sends) const {
+    // At most half full, so probes stay short and always find an empty slot
+    if ((client.sentCount + sends) * 2 <= client.sent.size()) return;
+
+    // Entries that can no longer change a score are dropped, and never-sent ones with them
+    uint32_t live = 0;
+    for (const SentEntry& entry : client.sent) {
+        if (entry.entity != INVALID_INDEX && entry.tick != 0 && m_tick + 1 - entry.tick < MAX_STALE_TICKS) ++live;
+    }
+    size_t capacity = client.sent.size();
+    while ((live + sends) * 4 > capacity) capacity *= 2;
+    while (capacity > MIN_SENT_CAPACITY && (live + sends) * 8 <= capacity) capacity /= 2;
+
+    client.sentSpare.assign(capacity, { INVALID_INDEX, 0 });
+    client.sentSpare.swap(client.sent);
+    client.sentCount = 0;
+    for (const SentEntry& entry : client.sentSpare) {
+        if (entry.entity != INVALID_INDEX && entry.tick != 0 && m_tick + 1 - entry.tick < MAX_STALE_TICKS) {
+            SetLastSent(client, entry.entity, entry.tick);
+        }
+    }
+}
+
+void InterestManager::ClearSent(Client& client) {
+    std::fill(client.sent.begin(), client.sent.end(), SentEntry{ INVALID_INDEX, 0 });
+    client.sentCount = 0;
+}
+
+void InterestManager::AddOccluder(const Float3& minimum, const Float3& maximum) {
+    uint32_t occluder = static_cast<uint32_t>(m_occluderMin.size());
+    m_occluderMin.push_back(minimum);
+    m_occluderMax.push_back(maximum);
+    for (int32_t cellZ = ToCell(minimum.z); cellZ <= ToCell(maximum.z); ++cellZ) {
+        for (int32_t cellX = ToCell(minimum.x); cellX <= ToCell(maximum.x); ++cellX) {
+            m_occluderBuckets[HashCell(cellX, cellZ)].push_back({ occluder, cellX, cellZ });
+        }
+    }
+}
+
+void InterestManager::Update(JobSystem* jobs) {
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t threads = jobs ? jobs->GetThreadCount() : 1;
+    if (m_scratch.size() < threads) m_scratch.resize(threads);
+    for (QueryScratch& scratch : m_scratch) {
+        scratch.entriesVisited = 0;
+        scratch.hidden = 0;
+    }
+
+    if (jobs) {
+        jobs->ParallelFor(m_clients.size(), CLIENTS_PER_BATCH, [this](size_t begin, size_t end, uint32_t thread) {
+            for (size_t client = begin; client < end; ++client) {
+                if (m_clients[client].active) UpdateClient(static_cast<uint32_t>(client), m_scratch[thread]);
+            }
+        });
+    } else {
+        for (uint32_t client = 0; client < m_clients.size(); ++client) {
+            if (m_clients[client].active) UpdateClient(client, m_scratch[0]);
+        }
+    }
+
+    m_stats = {};
+    m_stats.entities = m_entityCount;
+    m_stats.cellChanges = m_cellChanges;
+    for (const QueryScratch& scratch : m_scratch) {
+        m_stats.entriesVisited += scratch.entriesVisited;
+        m_stats.hidden += scratch.hidden;
+    }
+    for (const Client& client : m_clients) {
+        if (!client.active) continue;
+        ++m_stats.clients;
+        m_stats.relevant += client.relevant.size();
+        m_stats.sent += client.sendList.size();
+    }
+    m_cellChanges = 0;
+    ++m_tick;
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void InterestManager::UpdateClient(uint32_t clientIndex, QueryScratch& scratch) {
+    Client& client = m_clients[clientIndex];
+    const ClientView& view = client.view;
+    client.relevant.clear();
+    client.sendList.clear();
+
+    const Float3& eye = view.position;
+    float range = view.viewDistance, rangeSquared = range * range;
+    const float alwaysSquared = ALWAYS_RELEVANT_DISTANCE * ALWAYS_RELEVANT_DISTANCE;
+    int32_t minX = ToCell(eye.x - range), maxX = ToCell(eye.x + range);
+    int32_t minZ = ToCell(eye.z - range), maxZ = ToCell(eye.z + range);
+    uint32_t windowWidth = static_cast<uint32_t>(maxX - minX + 1);
+    bool visibility = m_useVisibility && !m_occluderMin.empty();
+    if (visibility) scratch.cellVisibility.assign(static_cast<size_t>(windowWidth) * (maxZ - minZ + 1), CELL_UNKNOWN);
+
+    for (int32_t cellZ = minZ; cellZ <= maxZ; ++cellZ) {
+        for (int32_t cellX = minX; cellX <= maxX; ++cellX) {
+            // Skip cells whose nearest point on the ground is out of range
+            float nearestX = std::min(std::max(eye.x, cellX * CELL_SIZE), (cellX + 1) * CELL_SIZE);
+            float nearestZ = std::min(std::max(eye.z, cellZ * CELL_SIZE), (cellZ + 1) * CELL_SIZE);
+            float cellDx = nearestX - eye.x, cellDz = nearestZ - eye.z;
+            if (cellDx * cellDx + cellDz * cellDz > rangeSquared) continue;
+
+            const std::vector<BucketEntry>& entries = m_buckets[HashCell(cellX, cellZ)];
+            scratch.entriesVisited += entries.size();
+            for (const BucketEntry& entry : entries) {
+                if (entry.cellX != cellX || entry.cellZ != cellZ) continue;
+                float dx = entry.position.x - eye.x, dy = entry.position.y - eye.y, dz = entry.position.z - eye.z;
+                float distanceSquared = dx * dx + dy * dy + dz * dz;
+                if (distanceSquared > rangeSquared) continue;
+
+                if (visibility && distanceSquared > alwaysSquared) {
+                    uint8_t& state = scratch.cellVisibility[static_cast<size_t>(cellZ - minZ) * windowWidth + (cellX - minX)];
+                    if (state == CELL_UNKNOWN) state = IsCellVisible(eye, cellX, cellZ) ? CELL_VISIBLE : CELL_HIDDEN;
+                    if (state == CELL_HIDDEN) {
+                        ++scratch.hidden;
+                        continue;
+                    }
+                }
+
+                uint32_t lastSent = GetLastSent(client, entry.entity);
+                uint32_t waited = lastSent == 0 ? MAX_STALE_TICKS : std::min(m_tick + 1 - lastSent, MAX_STALE_TICKS);
+                float score = m_importance[entry.entity] * static_cast<float>(waited) /
+                              (1.0f + std::sqrt(distanceSquared) / PRIORITY_FALLOFF);
+                client.relevant.push_back({ entry.entity, score });
+            }
+        }
+    }
+
+    // Ties go to the lower index, so the choice never depends on bucket order
+    size_t sendCount = std::min<size_t>(view.sendBudget, client.relevant.size());
+    std::partial_sort(client.relevant.begin(), client.relevant.begin() + sendCount, client.relevant.end(),
+                      [](const RelevantEntity& a, const RelevantEntity& b) {
+                          return a.score > b.score || (a.score == b.score && a.entity < b.entity);
+                      });
+    ReserveSent(client, static_cast<uint32_t>(sendCount));
+    for (size_t i = 0; i < sendCount; ++i) {
+        client.sendList.push_back(client.relevant[i].entity);
+        SetLastSent(client, client.relevant[i].entity, m_tick + 1);
+    }
+}
+
+bool InterestManager::IsCellVisible(const Float3& eye, int32_t cellX, int32_t cellZ) const {
+    if (ToCell(eye.x) == cellX && ToCell(eye.z) == cellZ) return true;
+
+    // The centre and corners pulled slightly inwards; seeing any of them sees the cell
+    const float inset = CELL_SIZE * 0.05f;
+    float minX = cellX * CELL_SIZE + inset, maxX = (cellX + 1) * CELL_SIZE - inset;
+    float minZ = cellZ * CELL_SIZE + inset, maxZ = (cellZ + 1) * CELL_SIZE - inset;
+    const Float3 targets[5] = {
+        { (minX + maxX) * 0.5f, TARGET_HEIGHT, (minZ + maxZ) * 0.5f },
+        { minX, TARGET_HEIGHT, minZ }, { maxX, TARGET_HEIGHT, minZ },
+        { minX, TARGET_HEIGHT, maxZ }, { maxX, TARGET_HEIGHT, maxZ },
+    };
+    for (const Float3& target : targets) {
+        if (!IsSegmentBlocked(eye, target)) return true;
+    }
+    return false;
+}
+
+bool InterestManager::IsSegmentBlocked(const Float3& from, const Float3& to) const {
+    // Walks the cells the segment crosses on the ground plane
+    int32_t cellX = ToCell(from.x), cellZ = ToCell(from.z);
+    int32_t endX = ToCell(to.x), endZ = ToCell(to.z);
+    float dx = to.x - from.x, dz = to.z - from.z;
+    int32_t stepX = dx > 0.0f ? 1 : -1, stepZ = dz > 0.0f ? 1 : -1;
+    float nextX = dx != 0.0f ? ((stepX > 0 ? cellX + 1 : cellX) * CELL_SIZE - from.x) / dx : INFINITY;
+    float nextZ = dz != 0.0f ? ((stepZ > 0 ? cellZ + 1 : cellZ) * CELL_SIZE - from.z) / dz : INFINITY;
+    float deltaX = dx != 0.0f ? CELL_SIZE / std::fabs(dx) : INFINITY;
+    float deltaZ = dz != 0.0f ? CELL_SIZE / std::fabs(dz) : INFINITY;
+
+    uint32_t cellCount = static_cast<uint32_t>(std::abs(endX - cellX) + std::abs(endZ - cellZ)) + 1;
+    for (uint32_t i = 0; i < cellCount; ++i) {
+        for (const OccluderEntry& entry : m_occluderBuckets[HashCell(cellX, cellZ)]) {
+            if (entry.cellX != cellX || entry.cellZ != cellZ) continue;
+            const Float3& minimum = m_occluderMin[entry.occluder];
+            const Float3& maximum = m_occluderMax[entry.occluder];
+            // A client inside a building still sees out of it
+            if (Contains(minimum, maximum, from)) continue;
+            if (SegmentHitsBox(from, to, minimum, maximum)) return true;
+        }
+        if (nextX < nextZ) {
+            cellX += stepX;
+            nextX += deltaX;
+        } else {
+            cellZ += stepZ;
+            nextZ += deltaZ;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+class JobSystem;
+
+// Server-side interest management: which entities each client hears about,
+// and which of those get this tick's bandwidth.
+//
+// Entities live in a spatial hash of CELL_SIZE squares on the ground plane,
+// a fixed table of buckets indexed by a hash of the cell coordinates. Moving
+// an entity only touches the hash when it crosses into another cell, so the
+// cost per tick follows how many entities move, not how many clients look.
+// A client's query visits the buckets of the cells its view circle overlaps
+// and keeps the entries recorded under exactly that cell, which filters out
+// both hash collisions and duplicates.
+//
+// Each relevant entity is scored by importance, nearness and how many ticks
+// it has waited since it was last sent to that client, so distant entities
+// still get through eventually. The best sendBudget are sent. With occluders
+// added, cells that every test ray from the client's eye reaches only
+// through an occluder count as hidden. Hidden entities are left out unless
+// they are within ALWAYS_RELEVANT_DISTANCE.
+//
+// Clients are independent, so Update runs them in parallel on the job
+// system, and the result does not depend on thread count.
+class InterestManager {
+public:
+    struct ClientView {
+        Float3 position;      // Eye
+        float viewDistance;
+        uint32_t sendBudget;  // Entities sent per tick
+    };
+
+    struct RelevantEntity {
+        uint32_t entity;
+        float score;
+    };
+
+    struct Stats {
+        uint32_t entities;
+        uint32_t clients;
+        uint32_t cellChanges;       // Entities that crossed a cell since the previous Update
+        uint64_t entriesVisited;    // Bucket entries looked at by all queries
+        uint64_t relevant;          // Summed over clients
+        uint64_t hidden;            // In range but in a hidden cell
+        uint64_t sent;
+        double updateMilliseconds;
+    };
+
+    InterestManager();
+    ~InterestManager();
+
+    bool Initialize(uint32_t maxEntities, uint32_t maxClients);
+
+    // Returns the entity's index, or INVALID_INDEX when full
+    uint32_t AddEntity(const Float3& position, float importance);
+    void RemoveEntity(uint32_t entity);
+    void MoveEntity(uint32_t entity, const Float3& position);
+    void SetImportance(uint32_t entity, float importance) { m_importance[entity] = importance; }
+
+    // Returns the client's index, or INVALID_INDEX when full
+    uint32_t AddClient(const ClientView& view);
+    void RemoveClient(uint32_t client);
+    void SetClientView(uint32_t client, const ClientView& view) { m_clients[client].view = view; }
+
+    // A static axis-aligned box that blocks sight, such as a building
+    void AddOccluder(const Float3& minimum, const Float3& maximum);
+    void SetVisibilityEnabled(bool enabled) { m_useVisibility = enabled; }
+
+    // Recomputes every client's relevant set and send list, and advances the tick
+    void Update(JobSystem* jobs = nullptr);
+
+    // In range and not hidden, in no particular order
+    const std::vector<RelevantEntity>& GetRelevant(uint32_t client) const { return m_clients[client].relevant; }
+    // This tick's entities for the client, highest score first
+    const std::vector<uint32_t>& GetSendList(uint32_t client) const { return m_clients[client].sendList; }
+
+    uint32_t GetTick() const { return m_tick; }
+    const Float3& GetPosition(uint32_t entity) const { return m_positions[entity]; }
+    bool IsEntityAlive(uint32_t entity) const { return entity < m_bucketSlot.size() && m_bucketSlot[entity] != INVALID_INDEX; }
+    bool IsClientActive(uint32_t client) const { return m_clients[client].active; }
+    uint32_t GetMaxEntities() const { return static_cast<uint32_t>(m_positions.size()); }
+    uint32_t GetMaxClients() const { return static_cast<uint32_t>(m_clients.size()); }
+    const Stats& GetStats() const { return m_stats; }
+
+    // Constants
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+    static constexpr float CELL_SIZE = 32.0f;
+    static constexpr uint32_t BUCKET_COUNT = 4096;                // Power of two
+    static constexpr float ALWAYS_RELEVANT_DISTANCE = 20.0f;      // Heard if not seen
+    static constexpr float PRIORITY_FALLOFF = 16.0f;              // Score halves this far away
+    static constexpr uint32_t MAX_STALE_TICKS = 60;               // Waiting counts for no more than this
+    static constexpr float TARGET_HEIGHT = 1.0f;                  // Above the ground, for visibility rays
+
+private:
+    // Position is duplicated here so queries read buckets front to back
+    struct BucketEntry {
+        Float3 position;
+        uint32_t entity;
+        int32_t cellX;
+        int32_t cellZ;
+    };
+
+    struct OccluderEntry {
+        uint32_t occluder;
+        int32_t cellX;
+        int32_t cellZ;
+    };
+
+    // Open-addressed, linearly probed; tick is when the entity was last sent plus one, 0 never
+    struct SentEntry {
+        uint32_t entity;  // INVALID_INDEX when empty
+        uint32_t tick;
+    };
+
+    // Only sends within MAX_STALE_TICKS change a score, so a client's sent set
+    // drops older entries whenever it is rebuilt and holds a few send budgets'
+    // worth of entities rather than a slot per entity
+    struct Client {
+        ClientView view;
+        bool active;
+        std::vector<RelevantEntity> relevant;
+        std::vector<uint32_t> sendList;
+        std::vector<SentEntry> sent;       // Power-of-two size
+        std::vector<SentEntry> sentSpare;  // Rebuilt into, then swapped
+        uint32_t sentCount;                // Occupied entries
+    };
+
+    // Per thread, reused across clients: visibility of each cell in the client's window
+    struct QueryScratch {
+        std::vector<uint8_t> cellVisibility;
+        uint64_t entriesVisited;
+        uint64_t hidden;
+    };
+
+    // Entities
+    std::vector<Float3> m_positions;
+    std::vector<float> m_importance;
+    std::vector<uint32_t> m_bucket;
+    std::vector<uint32_t> m_bucketSlot;      // Index in its bucket, INVALID_INDEX when free
+    std::vector<uint32_t> m_freeEntities;
+    std::vector<std::vector<BucketEntry>> m_buckets;
+    uint32_t m_entityCount;
+    uint32_t m_cellChanges;
+
+    // Occluders
+    std::vector<Float3> m_occluderMin;
+    std::vector<Float3> m_occluderMax;
+    std::vector<std::vector<OccluderEntry>> m_occluderBuckets;
+    bool m_useVisibility;
+
+    std::vector<Client> m_clients;
+    std::vector<QueryScratch> m_scratch;
+    uint32_t m_tick;
+    Stats m_stats;
+
+    static int32_t ToCell(float coordinate);
+    static uint32_t HashCell(int32_t cellX, int32_t cellZ);
+    void RemoveFromBucket(uint32_t entity, uint32_t bucket);
+
+    static uint32_t GetLastSent(const Client& client, uint32_t entity);
+    static void SetLastSent(Client& client, uint32_t entity, uint32_t tick);
+    void ReserveSent(Client& client, uint32_t sends) const;
+    static void ClearSent(Client& client);
+
+    void UpdateClient(uint32_t client, QueryScratch& scratch);
+    bool IsCellVisible(const Float3& eye, int32_t cellX, int32_t cellZ) const;
+    bool IsSegmentBlocked(const Float3& from, const Float3& to) const;
+
+    // Constants
+    static constexpr size_t CLIENTS_PER_BATCH = 4;
+    static constexpr uint32_t MIN_SENT_CAPACITY = 64;  // Power of two
+};
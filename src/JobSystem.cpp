@@ -0,0 +1,115 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem() :
+    m_generation(0),
+    m_busyWorkers(0),
+    m_quit(false),
+    m_function(nullptr),
+    m_count(0),
+    m_batchSize(1),
+    m_nextBatch(0),
+    m_tag(MemoryTag::Untagged) {
+}
+
+JobSystem::~JobSystem() {
+    Shutdown();
+}
+
+bool JobSystem::Initialize(uint32_t workerCount) {
+    Shutdown();
+
+    if (workerCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    // m_generation carries over from any previous Initialize; workers start from its current value,
+    // read here rather than in the thread, so a loop started before a worker first runs is not missed
+    m_quit = false;
+    m_busyWorkers = 0;
+    try {
+        for (uint32_t i = 0; i < workerCount; ++i) {
+            m_workers.emplace_back(&JobSystem::WorkerMain, this, i + 1, m_generation);
+        }
+    } catch (const std::system_error&) {
+        Shutdown();
+        return false;
+    }
+    return true;
+}
+
+void JobSystem::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, const RangeFunction& function) {
+    if (count == 0) return;
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    // Not worth waking anyone for a single batch
+    if (m_workers.empty() || count <= batchSize) {
+        function(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &function;
+        m_count = count;
+        m_batchSize = batchSize;
+        m_tag = AllocationTracker::GetThreadTag();
+        m_nextBatch.store(0, std::memory_order_relaxed);
+        m_busyWorkers = static_cast<uint32_t>(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    RunBatches(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_function = nullptr;
+}
+
+void JobSystem::WorkerMain(uint32_t thread, uint64_t seenGeneration) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || m_generation != seenGeneration; });
+            if (m_quit) return;
+            seenGeneration = m_generation;
+        }
+
+        {
+            MemoryTagScope tag(m_tag);
+            RunBatches(thread);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+void JobSystem::RunBatches(uint32_t thread) {
+    const size_t batchCount = (m_count + m_batchSize - 1) / m_batchSize;
+    for (;;) {
+        size_t batch = m_nextBatch.fetch_add(1, std::memory_order_relaxed);
+        if (batch >= batchCount) break;
+
+        size_t begin = batch * m_batchSize;
+        size_t end = std::min(begin + m_batchSize, m_count);
+        (*m_function)(begin, end, thread);
+    }
+}
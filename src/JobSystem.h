@@ -0,0 +1,69 @@
+#pragma once
+#include "AllocationTracker.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed pool of worker threads for fork-join loops. The calling thread takes
+// part in every loop as thread index 0, workers are 1..N. One loop runs at a
+// time and ParallelFor must not be called from inside a loop body.
+class JobSystem {
+public:
+    // Receives a [begin, end) range and the index of the thread running it.
+    // Non-owning, so passing a capturing lambda never allocates; the callable
+    // only has to outlive the ParallelFor call.
+    class RangeFunction {
+    public:
+        template <typename Function,
+                  typename = std::enable_if_t<!std::is_same<Function, RangeFunction>::value>>
+        RangeFunction(const Function& function) :
+            m_callable(&function),
+            m_invoke([](const void* callable, size_t begin, size_t end, uint32_t thread) {
+                (*static_cast<const Function*>(callable))(begin, end, thread);
+            }) {}
+
+        void operator()(size_t begin, size_t end, uint32_t thread) const { m_invoke(m_callable, begin, end, thread); }
+
+    private:
+        const void* m_callable;
+        void (*m_invoke)(const void* callable, size_t begin, size_t end, uint32_t thread);
+    };
+
+    JobSystem();
+    ~JobSystem();
+
+    // workerCount 0 uses one worker per hardware thread besides the caller
+    bool Initialize(uint32_t workerCount = 0);
+    void Shutdown();
+
+    // Splits [0, count) into batches of at most batchSize and blocks until all have run
+    void ParallelFor(size_t count, size_t batchSize, const RangeFunction& function);
+
+    // Worker threads plus the calling thread
+    uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation;
+    uint32_t m_busyWorkers;
+    bool m_quit;
+
+    // Current loop
+    const RangeFunction* m_function;
+    size_t m_count;
+    size_t m_batchSize;
+    std::atomic<size_t> m_nextBatch;
+    MemoryTag m_tag;  // Caller's, so worker allocations are charged to the same subsystem
+
+    void WorkerMain(uint32_t thread, uint64_t seenGeneration);
+    void RunBatches(uint32_t thread);
+};
@@ -0,0 +1,45 @@
+#include "LodSelector.h"
+#include <algorithm>
+#include <cmath>
+
+LodSelector::LodSelector() :
+    m_pixelsPerUnit(1.0f),
+    m_threshold(DEFAULT_PIXEL_THRESHOLD),
+    m_hysteresis(DEFAULT_HYSTERESIS),
+    m_stats() {
+}
+
+void LodSelector::SetProjection(float verticalFieldOfView, float viewportHeight) {
+    m_pixelsPerUnit = viewportHeight / (2.0f * std::tan(verticalFieldOfView * 0.5f));
+}
+
+void LodSelector::SetThreshold(float pixels, float hysteresis) {
+    m_threshold = pixels;
+    m_hysteresis = std::max(0.0f, std::min(hysteresis, 0.9f));
+}
+
+float LodSelector::ProjectError(float error, float distance) const {
+    return error * m_pixelsPerUnit / std::max(distance, 1e-3f);
+}
+
+uint32_t LodSelector::Select(const MeshLod* lods, uint32_t lodCount, float distance, uint32_t currentLod) {
+    if (lodCount == 0) return 0;
+    uint32_t lod = std::min(currentLod, lodCount - 1);
+
+    // Coarsen only once the next level is clearly under the threshold...
+    const float coarsenBelow = m_threshold * (1.0f - m_hysteresis);
+    while (lod + 1 < lodCount && ProjectError(lods[lod + 1].error, distance) <= coarsenBelow) {
+        lod++;
+    }
+    // ...and refine only once the current level is clearly over it
+    const float refineAbove = m_threshold * (1.0f + m_hysteresis);
+    while (lod > 0 && ProjectError(lods[lod].error, distance) > refineAbove) {
+        lod--;
+    }
+
+    m_stats.selections++;
+    if (lod != currentLod) m_stats.switches++;
+    m_stats.trianglesFull += lods[0].indexCount / 3;
+    m_stats.trianglesSelected += lods[lod].indexCount / 3;
+    return lod;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include "MeshSimplifier.h"
+
+// Picks a LOD from the screen-space size of each level's simplification error.
+// A level is acceptable while its error projects to fewer pixels than the
+// threshold; a hysteresis band around the threshold keeps objects near a
+// switching distance from flickering between two levels.
+class LodSelector {
+public:
+    struct Stats {
+        uint32_t selections;
+        uint32_t switches;
+        uint64_t trianglesFull;      // Triangles had every object used LOD 0
+        uint64_t trianglesSelected;
+    };
+
+    LodSelector();
+
+    // Vertical field of view in radians and viewport height in pixels
+    void SetProjection(float verticalFieldOfView, float viewportHeight);
+    // Allowed error in pixels and the relative width of the hysteresis band
+    void SetThreshold(float pixels, float hysteresis = DEFAULT_HYSTERESIS);
+
+    // Error in pixels of an object-space error seen at the given view distance
+    float ProjectError(float error, float distance) const;
+
+    // Returns the LOD to draw; currentLod is the level used last frame
+    uint32_t Select(const MeshLod* lods, uint32_t lodCount, float distance, uint32_t currentLod);
+
+    void ResetStats() { m_stats = {}; }
+    const Stats& GetStats() const { return m_stats; }
+
+    // Constants
+    static constexpr float DEFAULT_PIXEL_THRESHOLD = 1.0f;
+    static constexpr float DEFAULT_HYSTERESIS = 0.25f;
+
+private:
+    float m_pixelsPerUnit;  // Pixels covered by one unit at distance one
+    float m_threshold;
+    float m_hysteresis;
+    Stats m_stats;
+};
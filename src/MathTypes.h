@@ -0,0 +1,68 @@
+#pragma once
+
+// Plain math types for code shared by the D3D11 and OpenGL paths. Matrices are
+// row-major with row vectors (v * M) like DirectXMath, so the same memory can be
+// loaded with XMLoadFloat4x4 or passed straight to glMultMatrixf.
+
+struct Float2 {
+    float x, y;
+};
+
+struct Float3 {
+    float x, y, z;
+};
+
+struct Float4 {
+    float x, y, z, w;
+};
+
+struct Float4x4 {
+    float m[4][4];
+
+    static Float4x4 Identity() {
+        return { { { 1.0f, 0.0f, 0.0f, 0.0f },
+                   { 0.0f, 1.0f, 0.0f, 0.0f },
+                   { 0.0f, 0.0f, 1.0f, 0.0f },
+                   { 0.0f, 0.0f, 0.0f, 1.0f } } };
+    }
+
+    static Float4x4 Translation(float x, float y, float z) {
+        Float4x4 result = Identity();
+        result.m[3][0] = x;
+        result.m[3][1] = y;
+        result.m[3][2] = z;
+        return result;
+    }
+
+    static Float4x4 Scale(float x, float y, float z) {
+        Float4x4 result = Identity();
+        result.m[0][0] = x;
+        result.m[1][1] = y;
+        result.m[2][2] = z;
+        return result;
+    }
+};
+
+inline Float4x4 Multiply(const Float4x4& a, const Float4x4& b) {
+    Float4x4 result;
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            result.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] +
+                                 a.m[row][2] * b.m[2][col] + a.m[row][3] * b.m[3][col];
+        }
+    }
+    return result;
+}
+
+inline Float3 TransformPoint(const Float3& p, const Float4x4& m) {
+    return { p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+             p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+             p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2] };
+}
+
+inline Float4 TransformPoint4(const Float3& p, const Float4x4& m) {
+    return { p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+             p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+             p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2],
+             p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3] };
+}
@@ -0,0 +1,81 @@
+#include "MeshFile.h"
+#include <cstring>
+#include <fstream>
+#include "MeshOptimizer.h"
+
+bool MeshFile::Write(const char* path, const MeshAsset& mesh, bool compressIndices) {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream || mesh.stride == 0) return false;
+
+    std::vector<uint8_t> encoded;
+    if (compressIndices) {
+        MeshOptimizer::EncodeIndexBuffer(encoded, mesh.chain.indices.data(), static_cast<uint32_t>(mesh.chain.indices.size()));
+    }
+
+    Header header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size() / mesh.stride);
+    header.stride = mesh.stride;
+    header.elementCount = static_cast<uint32_t>(mesh.elements.size());
+    header.lodCount = static_cast<uint32_t>(mesh.chain.lods.size());
+    header.indexCount = static_cast<uint32_t>(mesh.chain.indices.size());
+    header.indexEncoding = compressIndices ? INDEX_DELTA_VARINT : INDEX_RAW;
+    header.indexBytes = static_cast<uint32_t>(compressIndices ? encoded.size() : mesh.chain.indices.size() * sizeof(uint32_t));
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(mesh.elements.data()), mesh.elements.size() * sizeof(VertexElement));
+    stream.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(header.vertexCount) * header.stride);
+    stream.write(reinterpret_cast<const char*>(mesh.chain.lods.data()), mesh.chain.lods.size() * sizeof(MeshLod));
+    if (compressIndices) {
+        stream.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    } else {
+        stream.write(reinterpret_cast<const char*>(mesh.chain.indices.data()), header.indexBytes);
+    }
+    return static_cast<bool>(stream);
+}
+
+bool MeshFile::Read(const char* path, MeshAsset& mesh) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) return false;
+
+    Header header;
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.stride == 0 ||
+        (header.indexEncoding != INDEX_RAW && header.indexEncoding != INDEX_DELTA_VARINT) ||
+        (header.indexEncoding == INDEX_RAW && header.indexBytes != static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t))) {
+        return false;
+    }
+
+    mesh.stride = header.stride;
+    mesh.elements.resize(header.elementCount);
+    mesh.vertices.resize(static_cast<size_t>(header.vertexCount) * header.stride);
+    mesh.chain.lods.resize(header.lodCount);
+    mesh.chain.indices.resize(header.indexCount);
+    std::vector<uint8_t> indexData(header.indexBytes);
+    if (!stream.read(reinterpret_cast<char*>(mesh.elements.data()), mesh.elements.size() * sizeof(VertexElement)) ||
+        !stream.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size()) ||
+        !stream.read(reinterpret_cast<char*>(mesh.chain.lods.data()), mesh.chain.lods.size() * sizeof(MeshLod)) ||
+        !stream.read(reinterpret_cast<char*>(indexData.data()), indexData.size())) {
+        return false;
+    }
+
+    if (header.indexEncoding == INDEX_DELTA_VARINT) {
+        if (!MeshOptimizer::DecodeIndexBuffer(mesh.chain.indices.data(), header.indexCount, indexData.data(), indexData.size())) {
+            return false;
+        }
+    } else {
+        memcpy(mesh.chain.indices.data(), indexData.data(), indexData.size());
+    }
+
+    for (const VertexElement& element : mesh.elements) {
+        if (element.offset + GetVertexFormatSize(element.format) > header.stride) return false;
+    }
+    for (const MeshLod& lod : mesh.chain.lods) {
+        if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > header.indexCount) return false;
+    }
+    for (uint32_t index : mesh.chain.indices) {
+        if (index >= header.vertexCount) return false;
+    }
+    return true;
+}
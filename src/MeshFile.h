@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+
+// A converted mesh: packed vertices described by their layout's elements, and
+// the LOD chain's shared index list
+struct MeshAsset {
+    std::vector<VertexElement> elements;
+    uint32_t stride;
+    std::vector<uint8_t> vertices;
+    MeshLodChain chain;
+};
+
+// Binary mesh asset written by --convert-mesh, little endian:
+//
+//   Header
+//   VertexElement[elementCount]
+//   vertex data, vertexCount * stride bytes
+//   MeshLod[lodCount]
+//   index data, indexBytes, raw or as MeshOptimizer::EncodeIndexBuffer wrote it
+class MeshFile {
+public:
+    enum IndexEncoding : uint32_t {
+        INDEX_RAW = 0,              // uint32_t per index
+        INDEX_DELTA_VARINT = 1
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t stride;
+        uint32_t elementCount;
+        uint32_t lodCount;
+        uint32_t indexCount;
+        uint32_t indexEncoding;
+        uint32_t indexBytes;
+        uint32_t reserved;
+    };
+
+    static bool Write(const char* path, const MeshAsset& mesh, bool compressIndices);
+    // Fails on a malformed file or one whose LODs reach past its indices or vertices
+    static bool Read(const char* path, MeshAsset& mesh);
+
+    // Constants
+    static constexpr uint32_t FILE_MAGIC = 0x4D535046;  // "FPSM"
+    static constexpr uint32_t FILE_VERSION = 1;
+};
@@ -0,0 +1,479 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // Forsyth's scoring: the three most recent vertices score a flat value so
+    // the strip-like order does not just reuse the last triangle's edge, older
+    // ones decay with position, and vertices with few triangles left get a
+    // boost so they are finished off rather than stranded
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+    const uint32_t MAX_SCORED_VALENCE = 32;
+
+    struct ScoreTables {
+        float cache[MeshOptimizer::MODEL_CACHE_SIZE];
+        float valence[MAX_SCORED_VALENCE];
+
+        ScoreTables() {
+            const uint32_t size = MeshOptimizer::MODEL_CACHE_SIZE;
+            for (uint32_t i = 0; i < size; ++i) {
+                cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                                 : powf(1.0f - static_cast<float>(i - 3) / (size - 3), CACHE_DECAY_POWER);
+            }
+            valence[0] = 0.0f;
+            for (uint32_t i = 1; i < MAX_SCORED_VALENCE; ++i) {
+                valence[i] = VALENCE_BOOST_SCALE * powf(static_cast<float>(i), -VALENCE_BOOST_POWER);
+            }
+        }
+
+        float Score(int32_t cachePosition, uint32_t remaining) const {
+            if (remaining == 0) return -1.0f;
+            float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+            return score + valence[std::min(remaining, MAX_SCORED_VALENCE - 1)];
+        }
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Float3 Cross(const Float3& a, const Float3& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    // Post-transform FIFO cache tracked by timestamps: a vertex is cached if
+    // fewer than cacheSize misses happened since it was loaded
+    class FifoCache {
+    public:
+        FifoCache(uint32_t vertexCount, uint32_t cacheSize) :
+            m_loaded(vertexCount, 0), m_time(cacheSize + 1), m_size(cacheSize) {}
+
+        bool Access(uint32_t vertex) {
+            if (m_time - m_loaded[vertex] < m_size) return true;
+            m_loaded[vertex] = ++m_time;
+            return false;
+        }
+
+        void Clear() { m_time += m_size + 1; }
+
+    private:
+        std::vector<uint64_t> m_loaded;
+        uint64_t m_time;
+        uint32_t m_size;
+    };
+
+    uint32_t HashVertex(const uint8_t* bytes, uint32_t stride) {
+        uint32_t hash = 2166136261u;
+        for (uint32_t i = 0; i < stride; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+}
+
+uint32_t MeshOptimizer::GenerateVertexRemap(uint32_t* remap, const uint32_t* indices, uint32_t indexCount,
+                                            const void* vertices, uint32_t vertexCount, uint32_t stride) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+    std::fill(remap, remap + vertexCount, INVALID_INDEX);
+
+    // Open addressing over the vertex bytes; the table holds the first vertex seen with each value
+    uint32_t tableSize = 16;
+    while (tableSize < vertexCount * 2) tableSize *= 2;
+    std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+
+    uint32_t unique = 0;
+    uint32_t count = indices ? indexCount : vertexCount;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t vertex = indices ? indices[i] : i;
+        if (remap[vertex] != INVALID_INDEX) continue;
+
+        const uint8_t* data = bytes + static_cast<size_t>(vertex) * stride;
+        uint32_t slot = HashVertex(data, stride) & (tableSize - 1);
+        while (table[slot] != INVALID_INDEX &&
+               memcmp(bytes + static_cast<size_t>(table[slot]) * stride, data, stride) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == INVALID_INDEX) {
+            table[slot] = vertex;
+            remap[vertex] = unique++;
+        } else {
+            remap[vertex] = remap[table[slot]];
+        }
+    }
+    return unique;
+}
+
+void MeshOptimizer::RemapVertexBuffer(void* destination, const void* vertices, uint32_t vertexCount, uint32_t stride,
+                                      const uint32_t* remap) {
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        if (remap[i] == INVALID_INDEX) continue;
+        memcpy(static_cast<uint8_t*>(destination) + static_cast<size_t>(remap[i]) * stride,
+               static_cast<const uint8_t*>(vertices) + static_cast<size_t>(i) * stride, stride);
+    }
+}
+
+void MeshOptimizer::RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                     const uint32_t* remap) {
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        destination[i] = remap[indices[i]];
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                        uint32_t vertexCount) {
+    static const ScoreTables scores;
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles using each vertex; the first remaining[v] of its run are not yet emitted
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; ++i) remaining[indices[i]]++;
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; ++t) {
+            for (int corner = 0; corner < 3; ++corner) adjacency[fill[indices[t * 3 + corner]]++] = t;
+        }
+    }
+
+    std::vector<float> vertexScore(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) vertexScore[v] = scores.Score(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+    std::vector<uint8_t> emitted(triangleCount, 0);
+
+    uint32_t cache[MODEL_CACHE_SIZE + 3];
+    uint32_t newCache[MODEL_CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    uint32_t cursor = 0;    // Every triangle before it is emitted
+    uint32_t best = INVALID_INDEX;
+
+    for (uint32_t output = 0; output < triangleCount; ++output) {
+        // Nothing in the cache has triangles left: restart at the next unemitted triangle
+        if (best == INVALID_INDEX) {
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const uint32_t* triangle = indices + best * 3;
+        memcpy(destination + output * 3, triangle, 3 * sizeof(uint32_t));
+        emitted[best] = 1;
+
+        // The triangle's vertices move to the front, the rest shift back, and any beyond the cache fall out
+        uint32_t newCount = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t vertex = triangle[corner];
+            newCache[newCount++] = vertex;
+
+            uint32_t* run = &adjacency[adjacencyStart[vertex]];
+            uint32_t count = remaining[vertex];
+            for (uint32_t i = 0; i < count; ++i) {
+                if (run[i] == best) {
+                    std::swap(run[i], run[count - 1]);
+                    break;
+                }
+            }
+            remaining[vertex]--;
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            uint32_t vertex = cache[i];
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) newCache[newCount++] = vertex;
+        }
+
+        for (uint32_t i = 0; i < newCount; ++i) {
+            uint32_t vertex = newCache[i];
+            int32_t position = i < MODEL_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+            float score = scores.Score(position, remaining[vertex]);
+            float delta = score - vertexScore[vertex];
+            vertexScore[vertex] = score;
+            const uint32_t* run = &adjacency[adjacencyStart[vertex]];
+            for (uint32_t j = 0; j < remaining[vertex]; ++j) triangleScore[run[j]] += delta;
+        }
+        cacheCount = std::min(newCount, MODEL_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        // Only triangles touching the cache are candidates
+        best = INVALID_INDEX;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            const uint32_t* run = &adjacency[adjacencyStart[cache[i]]];
+            for (uint32_t j = 0; j < remaining[cache[i]]; ++j) {
+                if (triangleScore[run[j]] > bestScore) {
+                    bestScore = triangleScore[run[j]];
+                    best = run[j];
+                }
+            }
+        }
+    }
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                     const Float3* positions, uint32_t vertexCount, float threshold) {
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Hard boundaries where the cache order restarted: all three vertices miss
+    FifoCache fifo(vertexCount, ANALYZE_CACHE_SIZE);
+    std::vector<uint32_t> hardStarts;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        uint32_t misses = 0;
+        for (int corner = 0; corner < 3; ++corner) misses += fifo.Access(indices[t * 3 + corner]) ? 0 : 1;
+        if (t == 0 || misses == 3) hardStarts.push_back(t);
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Soft boundaries inside each: a cluster ends as soon as its own ACMR,
+    // counted from a cold cache, is within threshold of the hard cluster's
+    std::vector<uint32_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+        uint32_t start = hardStarts[h], end = hardStarts[h + 1];
+        fifo.Clear();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            for (int corner = 0; corner < 3; ++corner) clusterMisses += fifo.Access(indices[t * 3 + corner]) ? 0 : 1;
+        }
+        float target = threshold * clusterMisses / (end - start);
+
+        fifo.Clear();
+        uint32_t softStart = start, misses = 0;
+        clusterStarts.push_back(start);
+        for (uint32_t t = start; t < end; ++t) {
+            for (int corner = 0; corner < 3; ++corner) misses += fifo.Access(indices[t * 3 + corner]) ? 0 : 1;
+            if (t + 1 < end && misses <= target * (t + 1 - softStart)) {
+                clusterStarts.push_back(t + 1);
+                softStart = t + 1;
+                misses = 0;
+                fifo.Clear();
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // Area-weighted centroid and normal of each cluster, and of the whole mesh
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<Float3> centroids(clusterCount), normals(clusterCount);
+    Float3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        Float3 centroid = { 0.0f, 0.0f, 0.0f }, normal = { 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+            const Float3& a = positions[indices[t * 3]];
+            const Float3& b = positions[indices[t * 3 + 1]];
+            const Float3& d = positions[indices[t * 3 + 2]];
+            Float3 faceNormal = Cross(Sub(b, a), Sub(d, a));
+            float faceArea = sqrtf(Dot(faceNormal, faceNormal));
+            centroid.x += (a.x + b.x + d.x) * faceArea;
+            centroid.y += (a.y + b.y + d.y) * faceArea;
+            centroid.z += (a.z + b.z + d.z) * faceArea;
+            normal.x += faceNormal.x;
+            normal.y += faceNormal.y;
+            normal.z += faceNormal.z;
+            area += faceArea;
+        }
+        meshCentroid.x += centroid.x;
+        meshCentroid.y += centroid.y;
+        meshCentroid.z += centroid.z;
+        meshArea += area;
+        float scale = area > 0.0f ? 1.0f / (3.0f * area) : 0.0f;
+        centroids[c] = { centroid.x * scale, centroid.y * scale, centroid.z * scale };
+        float length = sqrtf(Dot(normal, normal));
+        normals[c] = length > 0.0f ? Float3{ normal.x / length, normal.y / length, normal.z / length } : Float3{ 0.0f, 0.0f, 0.0f };
+    }
+    float meshScale = meshArea > 0.0f ? 1.0f / (3.0f * meshArea) : 0.0f;
+    meshCentroid = { meshCentroid.x * meshScale, meshCentroid.y * meshScale, meshCentroid.z * meshScale };
+
+    // Clusters facing out from the centre tend to hide the rest, so they go first
+    std::vector<float> keys(clusterCount);
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        keys[c] = Dot(Sub(centroids[c], meshCentroid), normals[c]);
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    uint32_t* out = destination;
+    for (uint32_t c : order) {
+        uint32_t count = (clusterStarts[c + 1] - clusterStarts[c]) * 3;
+        memcpy(out, indices + clusterStarts[c] * 3, count * sizeof(uint32_t));
+        out += count;
+    }
+}
+
+uint32_t MeshOptimizer::GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, uint32_t indexCount,
+                                                 uint32_t vertexCount) {
+    std::fill(remap, remap + vertexCount, INVALID_INDEX);
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        if (remap[indices[i]] == INVALID_INDEX) remap[indices[i]] = next++;
+    }
+    return next;
+}
+
+void MeshOptimizer::OptimizeLodChain(MeshLodChain& chain, const Float3* positions, uint32_t vertexCount, float threshold) {
+    std::vector<uint32_t> scratch;
+    for (const MeshLod& lod : chain.lods) {
+        uint32_t* range = chain.indices.data() + lod.firstIndex;
+        scratch.resize(lod.indexCount);
+        OptimizeVertexCache(scratch.data(), range, lod.indexCount, vertexCount);
+        OptimizeOverdraw(range, scratch.data(), lod.indexCount, positions, vertexCount, threshold);
+    }
+}
+
+void MeshOptimizer::EncodeIndexBuffer(std::vector<uint8_t>& encoded, const uint32_t* indices, uint32_t indexCount) {
+    encoded.clear();
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        int32_t delta = static_cast<int32_t>(indices[i] - previous);
+        uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        while (zigzag >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(zigzag));
+        previous = indices[i];
+    }
+}
+
+bool MeshOptimizer::DecodeIndexBuffer(uint32_t* destination, uint32_t indexCount, const uint8_t* encoded, size_t size) {
+    size_t cursor = 0;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        uint32_t zigzag = 0;
+        for (uint32_t shift = 0;; shift += 7) {
+            if (cursor >= size || shift > 28) return false;
+            uint8_t byte = encoded[cursor++];
+            zigzag |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+        previous += delta;
+        destination[i] = previous;
+    }
+    return cursor == size;
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount,
+                                                                  uint32_t vertexCount, uint32_t cacheSize) {
+    FifoCache fifo(vertexCount, cacheSize);
+    std::vector<uint8_t> used(vertexCount, 0);
+    uint32_t unique = 0;
+    VertexCacheStats stats = {};
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        if (!fifo.Access(indices[i])) stats.transformedVertices++;
+        if (!used[indices[i]]) {
+            used[indices[i]] = 1;
+            unique++;
+        }
+    }
+    stats.acmr = indexCount >= 3 ? static_cast<float>(stats.transformedVertices) / (indexCount / 3) : 0.0f;
+    stats.atvr = unique > 0 ? static_cast<float>(stats.transformedVertices) / unique : 0.0f;
+    return stats;
+}
+
+MeshOptimizer::OverdrawStats MeshOptimizer::AnalyzeOverdraw(const uint32_t* indices, uint32_t indexCount,
+                                                            const Float3* positions, uint32_t vertexCount) {
+    OverdrawStats stats = {};
+    if (indexCount < 3 || vertexCount == 0) return stats;
+
+    Float3 boundsMin = positions[indices[0]], boundsMax = boundsMin;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        const Float3& p = positions[indices[i]];
+        boundsMin = { std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z) };
+        boundsMax = { std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z) };
+    }
+    float extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+    float scale = extent > 0.0f ? (OVERDRAW_GRID - 1) / extent : 0.0f;
+
+    std::vector<float> depth(OVERDRAW_GRID * OVERDRAW_GRID);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (float sign = -1.0f; sign <= 1.0f; sign += 2.0f) {
+            // Looking along sign * axis; the screen is the other two axes
+            std::fill(depth.begin(), depth.end(), 1e30f);
+            auto project = [&](const Float3& p, float& u, float& v, float& z) {
+                const float coordinates[3] = { (p.x - boundsMin.x) * scale, (p.y - boundsMin.y) * scale, (p.z - boundsMin.z) * scale };
+                u = coordinates[(axis + 1) % 3];
+                v = coordinates[(axis + 2) % 3];
+                z = sign * coordinates[axis];
+            };
+
+            for (uint32_t t = 0; t + 2 < indexCount; t += 3) {
+                const Float3& a = positions[indices[t]];
+                const Float3& b = positions[indices[t + 1]];
+                const Float3& c = positions[indices[t + 2]];
+                // Back faces point along the view direction
+                Float3 normal = Cross(Sub(b, a), Sub(c, a));
+                const float components[3] = { normal.x, normal.y, normal.z };
+                if (sign * components[axis] >= 0.0f) continue;
+
+                float u[3], v[3], z[3];
+                project(a, u[0], v[0], z[0]);
+                project(b, u[1], v[1], z[1]);
+                project(c, u[2], v[2], z[2]);
+                float area = (u[1] - u[0]) * (v[2] - v[0]) - (u[2] - u[0]) * (v[1] - v[0]);
+                if (area == 0.0f) continue;
+
+                int minX = std::max(0, static_cast<int>(floorf(std::min(std::min(u[0], u[1]), u[2]))));
+                int maxX = std::min(static_cast<int>(OVERDRAW_GRID) - 1, static_cast<int>(ceilf(std::max(std::max(u[0], u[1]), u[2]))));
+                int minY = std::max(0, static_cast<int>(floorf(std::min(std::min(v[0], v[1]), v[2]))));
+                int maxY = std::min(static_cast<int>(OVERDRAW_GRID) - 1, static_cast<int>(ceilf(std::max(std::max(v[0], v[1]), v[2]))));
+                for (int y = minY; y <= maxY; ++y) {
+                    for (int x = minX; x <= maxX; ++x) {
+                        float px = x + 0.5f, py = y + 0.5f;
+                        float w0 = ((u[1] - px) * (v[2] - py) - (u[2] - px) * (v[1] - py)) / area;
+                        float w1 = ((u[2] - px) * (v[0] - py) - (u[0] - px) * (v[2] - py)) / area;
+                        float w2 = 1.0f - w0 - w1;
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                        float pixelDepth = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                        float& stored = depth[y * OVERDRAW_GRID + x];
+                        if (pixelDepth < stored) {
+                            if (stored == 1e30f) stats.coveredPixels++;
+                            stored = pixelDepth;
+                            stats.shadedPixels++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    stats.overdraw = stats.coveredPixels > 0 ? static_cast<float>(stats.shadedPixels) / stats.coveredPixels : 0.0f;
+    return stats;
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(const uint32_t* indices, uint32_t indexCount,
+                                                                  uint32_t vertexCount, uint32_t stride) {
+    // Vertices are only fetched when they miss the post-transform cache
+    FifoCache fifo(vertexCount, ANALYZE_CACHE_SIZE);
+    std::vector<uint64_t> lines(FETCH_CACHE_LINES, ~0ull);
+    std::vector<uint8_t> used(vertexCount, 0);
+    uint64_t usedBytes = 0;
+    VertexFetchStats stats = {};
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        uint32_t vertex = indices[i];
+        if (!used[vertex]) {
+            used[vertex] = 1;
+            usedBytes += stride;
+        }
+        if (fifo.Access(vertex)) continue;
+
+        uint64_t first = static_cast<uint64_t>(vertex) * stride / FETCH_LINE_BYTES;
+        uint64_t last = (static_cast<uint64_t>(vertex) * stride + stride - 1) / FETCH_LINE_BYTES;
+        for (uint64_t line = first; line <= last; ++line) {
+            uint64_t& slot = lines[line % FETCH_CACHE_LINES];
+            if (slot != line) {
+                slot = line;
+                stats.bytesFetched += FETCH_LINE_BYTES;
+            }
+        }
+    }
+    stats.overfetch = usedBytes > 0 ? static_cast<float>(stats.bytesFetched) / usedBytes : 0.0f;
+    return stats;
+}
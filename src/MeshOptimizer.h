@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+#include "MeshSimplifier.h"
+
+// Offline mesh processing for index and vertex order, run when assets are
+// converted rather than at load. Exporters write triangles and vertices in
+// whatever order they were modelled; the steps below, applied in order, turn
+// that into buffers the GPU reads efficiently:
+//
+//   GenerateVertexRemap + Remap*     merge bit-identical vertices
+//   OptimizeVertexCache              triangle order for post-transform cache hits
+//   OptimizeOverdraw                 cluster order so front faces draw first
+//   GenerateVertexFetchRemap         vertex order of first use, for fetch locality
+//   EncodeIndexBuffer                optional compression of the result
+//
+// Positions are read as a Float3 at the start of each vertex, as in
+// Renderer::CreateMesh. Front faces are clockwise, as in the D3D11 renderer.
+class MeshOptimizer {
+public:
+    struct VertexCacheStats {
+        uint32_t transformedVertices;
+        float acmr;     // Vertices transformed per triangle; 0.5 is ideal for a regular grid, 3 the worst
+        float atvr;     // Vertices transformed per unique vertex; 1 is ideal
+    };
+
+    struct OverdrawStats {
+        uint64_t coveredPixels;
+        uint64_t shadedPixels;
+        float overdraw;   // Shaded per covered pixel; 1 is ideal
+    };
+
+    struct VertexFetchStats {
+        uint64_t bytesFetched;
+        float overfetch;  // Bytes fetched per byte of vertices used; 1 is ideal
+    };
+
+    // remap[v] is v's index among the unique vertices, in order of first use
+    // by indices (or by vertex order when indices is null); unreferenced
+    // vertices get INVALID_INDEX. Returns the unique vertex count.
+    static uint32_t GenerateVertexRemap(uint32_t* remap, const uint32_t* indices, uint32_t indexCount,
+                                        const void* vertices, uint32_t vertexCount, uint32_t stride);
+    // destination holds the remap's unique vertex count; may not alias vertices
+    static void RemapVertexBuffer(void* destination, const void* vertices, uint32_t vertexCount, uint32_t stride,
+                                  const uint32_t* remap);
+    // destination may alias indices
+    static void RemapIndexBuffer(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                 const uint32_t* remap);
+
+    // Forsyth's linear-speed greedy ordering: the next triangle is the best
+    // scored among those touching the modelled cache. destination may not alias indices.
+    static void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                    uint32_t vertexCount);
+
+    // Splits a cache-optimized list into clusters that each keep their ACMR
+    // within threshold of the whole list's, then sorts the clusters so those
+    // facing out from the mesh centre come first (Sander et al.). destination
+    // may not alias indices.
+    static void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, uint32_t indexCount,
+                                 const Float3* positions, uint32_t vertexCount, float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+    // Vertices in order of first use, for RemapVertexBuffer and RemapIndexBuffer. Returns the used vertex count.
+    static uint32_t GenerateVertexFetchRemap(uint32_t* remap, const uint32_t* indices, uint32_t indexCount,
+                                             uint32_t vertexCount);
+
+    // Per-level cache and overdraw ordering of a chain built by MeshSimplifier
+    static void OptimizeLodChain(MeshLodChain& chain, const Float3* positions, uint32_t vertexCount,
+                                 float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+    // Zigzag varint of each index's difference from the previous one, which
+    // after fetch ordering is mostly small. Decode returns false on malformed data.
+    static void EncodeIndexBuffer(std::vector<uint8_t>& encoded, const uint32_t* indices, uint32_t indexCount);
+    static bool DecodeIndexBuffer(uint32_t* destination, uint32_t indexCount, const uint8_t* encoded, size_t size);
+
+    // FIFO cache, as most hardware behaves
+    static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+                                               uint32_t cacheSize = ANALYZE_CACHE_SIZE);
+    // Depth-tested, back-face culled software rasterization of the mesh from
+    // the six axis directions, scaled to fit an OVERDRAW_GRID square
+    static OverdrawStats AnalyzeOverdraw(const uint32_t* indices, uint32_t indexCount,
+                                         const Float3* positions, uint32_t vertexCount);
+    // A direct-mapped cache of 64-byte lines, read on post-transform cache misses
+    static VertexFetchStats AnalyzeVertexFetch(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount,
+                                               uint32_t stride);
+
+    // Constants
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+    static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+    static constexpr uint32_t ANALYZE_CACHE_SIZE = 16;
+    static constexpr uint32_t OVERDRAW_GRID = 256;
+    static constexpr uint32_t FETCH_LINE_BYTES = 64;
+    static constexpr uint32_t FETCH_CACHE_LINES = 256;   // 16 KB
+    static constexpr uint32_t MODEL_CACHE_SIZE = 32;     // Forsyth's scoring cache
+};
@@ -0,0 +1,356 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    // Symmetric 4x4 error quadric stored as its upper triangle
+    struct Quadric {
+        double a2, ab, ac, ad;
+        double b2, bc, bd;
+        double c2, cd;
+        double d2;
+
+        static Quadric FromPlane(double a, double b, double c, double d) {
+            return { a * a, a * b, a * c, a * d,
+                     b * b, b * c, b * d,
+                     c * c, c * d,
+                     d * d };
+        }
+
+        void Add(const Quadric& q) {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+        }
+
+        // Sum of squared distances from p to every accumulated plane
+        double Evaluate(const Float3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            return x * x * a2 + 2.0 * x * y * ab + 2.0 * x * z * ac + 2.0 * x * ad +
+                   y * y * b2 + 2.0 * y * z * bc + 2.0 * y * bd +
+                   z * z * c2 + 2.0 * z * cd +
+                   d2;
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse& other) const {
+            if (cost != other.cost) return cost > other.cost;
+            // Tie-break on ids so results do not depend on heap internals
+            if (from != other.from) return from > other.from;
+            return to > other.to;
+        }
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Float3 Cross(const Float3& a, const Float3& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+    double Dot(const Float3& a, const Float3& b) {
+        return static_cast<double>(a.x) * b.x + static_cast<double>(a.y) * b.y + static_cast<double>(a.z) * b.z;
+    }
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b) {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    class Simplifier {
+    public:
+        Simplifier(const Float3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) :
+            m_positions(positions),
+            m_quadrics(vertexCount, Quadric()),
+            m_vertexTriangles(vertexCount),
+            m_versions(vertexCount, 0),
+            m_boundary(vertexCount, false),
+            m_liveTriangles(0) {
+            m_triangles.assign(indices, indices + indexCount - indexCount % 3);
+            m_triangleAlive.assign(m_triangles.size() / 3, true);
+            m_liveTriangles = static_cast<uint32_t>(m_triangleAlive.size());
+
+            for (uint32_t t = 0; t < m_triangleAlive.size(); ++t) {
+                uint32_t* v = &m_triangles[t * 3];
+                if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2] ||
+                    v[0] >= vertexCount || v[1] >= vertexCount || v[2] >= vertexCount) {
+                    m_triangleAlive[t] = false;
+                    m_liveTriangles--;
+                    continue;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    m_vertexTriangles[v[i]].push_back(t);
+                }
+            }
+
+            BuildQuadrics();
+        }
+
+        float Run(uint32_t targetTriangles, float maxError) {
+            const double maxCost = static_cast<double>(maxError) * maxError;
+            double worstCost = 0.0;
+
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+            for (uint32_t t = 0; t < m_triangleAlive.size(); ++t) {
+                if (!m_triangleAlive[t]) continue;
+                const uint32_t* v = &m_triangles[t * 3];
+                for (int i = 0; i < 3; ++i) {
+                    PushEdge(queue, v[i], v[(i + 1) % 3]);
+                }
+            }
+
+            while (m_liveTriangles > targetTriangles && !queue.empty()) {
+                Collapse collapse = queue.top();
+                queue.pop();
+                if (collapse.cost > maxCost) break;
+
+                // Skip entries made stale by earlier collapses
+                if (collapse.fromVersion != m_versions[collapse.from] || collapse.toVersion != m_versions[collapse.to]) {
+                    continue;
+                }
+                if (!IsCollapseValid(collapse.from, collapse.to)) continue;
+
+                Apply(collapse.from, collapse.to);
+                worstCost = std::max(worstCost, collapse.cost);
+
+                // Re-queue edges around the surviving vertex
+                for (uint32_t t : m_vertexTriangles[collapse.to]) {
+                    const uint32_t* v = &m_triangles[t * 3];
+                    for (int i = 0; i < 3; ++i) {
+                        if (v[i] != collapse.to) PushEdge(queue, collapse.to, v[i]);
+                    }
+                }
+            }
+
+            return static_cast<float>(std::sqrt(worstCost));
+        }
+
+        std::vector<uint32_t> GetIndices() const {
+            std::vector<uint32_t> indices;
+            indices.reserve(m_liveTriangles * 3);
+            for (uint32_t t = 0; t < m_triangleAlive.size(); ++t) {
+                if (!m_triangleAlive[t]) continue;
+                indices.insert(indices.end(), &m_triangles[t * 3], &m_triangles[t * 3] + 3);
+            }
+            return indices;
+        }
+
+    private:
+        const Float3* m_positions;
+        std::vector<uint32_t> m_triangles;
+        std::vector<bool> m_triangleAlive;
+        std::vector<Quadric> m_quadrics;
+        std::vector<std::vector<uint32_t>> m_vertexTriangles;
+        std::vector<uint32_t> m_versions;
+        std::vector<bool> m_boundary;
+        std::unordered_map<uint64_t, uint32_t> m_edgeUse;  // Triangles sharing each edge
+        uint32_t m_liveTriangles;
+
+        void BuildQuadrics() {
+            for (uint32_t t = 0; t < m_triangleAlive.size(); ++t) {
+                if (!m_triangleAlive[t]) continue;
+                const uint32_t* v = &m_triangles[t * 3];
+                for (int i = 0; i < 3; ++i) {
+                    m_edgeUse[EdgeKey(v[i], v[(i + 1) % 3])]++;
+                }
+            }
+
+            for (uint32_t t = 0; t < m_triangleAlive.size(); ++t) {
+                if (!m_triangleAlive[t]) continue;
+                const uint32_t* v = &m_triangles[t * 3];
+                const Float3& p0 = m_positions[v[0]];
+                Float3 normal = Cross(Sub(m_positions[v[1]], p0), Sub(m_positions[v[2]], p0));
+                double length = std::sqrt(Dot(normal, normal));
+                if (length <= 0.0) continue;
+
+                // Unweighted planes make the cost a bound on the squared distance moved
+                double a = normal.x / length, b = normal.y / length, c = normal.z / length;
+                double d = -(a * p0.x + b * p0.y + c * p0.z);
+                Quadric plane = Quadric::FromPlane(a, b, c, d);
+                for (int i = 0; i < 3; ++i) {
+                    m_quadrics[v[i]].Add(plane);
+                }
+
+                // Open edges get a plane through the edge, perpendicular to the face
+                for (int i = 0; i < 3; ++i) {
+                    uint32_t e0 = v[i];
+                    uint32_t e1 = v[(i + 1) % 3];
+                    if (m_edgeUse[EdgeKey(e0, e1)] != 1) continue;
+
+                    m_boundary[e0] = true;
+                    m_boundary[e1] = true;
+                    Float3 edge = Sub(m_positions[e1], m_positions[e0]);
+                    Float3 side = Cross(edge, { static_cast<float>(a), static_cast<float>(b), static_cast<float>(c) });
+                    double sideLength = std::sqrt(Dot(side, side));
+                    if (sideLength <= 0.0) continue;
+
+                    double sa = side.x / sideLength, sb = side.y / sideLength, sc = side.z / sideLength;
+                    double sd = -(sa * m_positions[e0].x + sb * m_positions[e0].y + sc * m_positions[e0].z);
+                    Quadric constraint = Quadric::FromPlane(sa, sb, sc, sd);
+                    m_quadrics[e0].Add(constraint);
+                    m_quadrics[e1].Add(constraint);
+                }
+            }
+        }
+
+        template <typename Queue>
+        void PushEdge(Queue& queue, uint32_t a, uint32_t b) {
+            Quadric combined = m_quadrics[a];
+            combined.Add(m_quadrics[b]);
+
+            // Half-edge collapse: try both directions and keep the cheaper
+            double costAB = combined.Evaluate(m_positions[b]);
+            double costBA = combined.Evaluate(m_positions[a]);
+            if (costAB <= costBA) {
+                queue.push({ std::max(costAB, 0.0), a, b, m_versions[a], m_versions[b] });
+            } else {
+                queue.push({ std::max(costBA, 0.0), b, a, m_versions[b], m_versions[a] });
+            }
+        }
+
+        bool IsCollapseValid(uint32_t from, uint32_t to) const {
+            // Boundary vertices may only slide along their own open edges
+            if (m_boundary[from]) {
+                auto found = m_edgeUse.find(EdgeKey(from, to));
+                if (found == m_edgeUse.end() || found->second != 1) return false;
+            }
+
+            // Link condition: an interior edge may share exactly two neighbours, an open edge one
+            std::vector<uint32_t> fromNeighbours;
+            std::vector<uint32_t> toNeighbours;
+            CollectNeighbours(from, fromNeighbours);
+            CollectNeighbours(to, toNeighbours);
+            uint32_t shared = 0;
+            for (uint32_t n : fromNeighbours) {
+                if (std::binary_search(toNeighbours.begin(), toNeighbours.end(), n)) shared++;
+            }
+            uint32_t sharedTriangles = 0;
+            for (uint32_t t : m_vertexTriangles[from]) {
+                const uint32_t* v = &m_triangles[t * 3];
+                if (v[0] == to || v[1] == to || v[2] == to) sharedTriangles++;
+            }
+            if (sharedTriangles == 0 || shared != sharedTriangles) return false;
+
+            // Reject collapses that flip or flatten a surviving triangle
+            const Float3& target = m_positions[to];
+            for (uint32_t t : m_vertexTriangles[from]) {
+                const uint32_t* v = &m_triangles[t * 3];
+                if (v[0] == to || v[1] == to || v[2] == to) continue;
+
+                Float3 before[3];
+                Float3 after[3];
+                for (int i = 0; i < 3; ++i) {
+                    before[i] = m_positions[v[i]];
+                    after[i] = v[i] == from ? target : before[i];
+                }
+                Float3 oldNormal = Cross(Sub(before[1], before[0]), Sub(before[2], before[0]));
+                Float3 newNormal = Cross(Sub(after[1], after[0]), Sub(after[2], after[0]));
+                double oldLength = std::sqrt(Dot(oldNormal, oldNormal));
+                double newLength = std::sqrt(Dot(newNormal, newNormal));
+                if (newLength <= 1e-12 * std::max(oldLength, 1.0)) return false;
+                if (Dot(oldNormal, newNormal) < 0.2 * oldLength * newLength) return false;
+            }
+            return true;
+        }
+
+        void CollectNeighbours(uint32_t vertex, std::vector<uint32_t>& neighbours) const {
+            for (uint32_t t : m_vertexTriangles[vertex]) {
+                const uint32_t* v = &m_triangles[t * 3];
+                for (int i = 0; i < 3; ++i) {
+                    if (v[i] != vertex) neighbours.push_back(v[i]);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        }
+
+        void Apply(uint32_t from, uint32_t to) {
+            for (uint32_t t : m_vertexTriangles[from]) {
+                uint32_t* v = &m_triangles[t * 3];
+                bool hasTo = v[0] == to || v[1] == to || v[2] == to;
+
+                // Edge use counts follow the triangles they belong to
+                for (int i = 0; i < 3; ++i) {
+                    auto found = m_edgeUse.find(EdgeKey(v[i], v[(i + 1) % 3]));
+                    if (found != m_edgeUse.end() && --found->second == 0) m_edgeUse.erase(found);
+                }
+
+                if (hasTo) {
+                    m_triangleAlive[t] = false;
+                    m_liveTriangles--;
+                    for (int i = 0; i < 3; ++i) {
+                        if (v[i] != from && v[i] != to) {
+                            std::vector<uint32_t>& list = m_vertexTriangles[v[i]];
+                            list.erase(std::remove(list.begin(), list.end(), t), list.end());
+                        }
+                    }
+                    std::vector<uint32_t>& toList = m_vertexTriangles[to];
+                    toList.erase(std::remove(toList.begin(), toList.end(), t), toList.end());
+                    continue;
+                }
+
+                for (int i = 0; i < 3; ++i) {
+                    if (v[i] == from) v[i] = to;
+                }
+                for (int i = 0; i < 3; ++i) {
+                    m_edgeUse[EdgeKey(v[i], v[(i + 1) % 3])]++;
+                }
+                m_vertexTriangles[to].push_back(t);
+            }
+
+            m_vertexTriangles[from].clear();
+            m_quadrics[to].Add(m_quadrics[from]);
+            m_boundary[to] = m_boundary[to] || m_boundary[from];
+            m_versions[from]++;
+            m_versions[to]++;
+        }
+    };
+}
+
+MeshSimplifier::Result MeshSimplifier::Simplify(const Float3* positions, uint32_t vertexCount,
+                                                const uint32_t* indices, uint32_t indexCount,
+                                                uint32_t targetIndexCount, float maxError) {
+    Simplifier simplifier(positions, vertexCount, indices, indexCount);
+    Result result;
+    result.error = simplifier.Run(std::max(targetIndexCount / 3, MIN_TRIANGLES), maxError);
+    result.indices = simplifier.GetIndices();
+    return result;
+}
+
+MeshLodChain MeshSimplifier::BuildLodChain(const Float3* positions, uint32_t vertexCount,
+                                           const uint32_t* indices, uint32_t indexCount,
+                                           uint32_t maxLevels, float maxError) {
+    MeshLodChain chain;
+    chain.indices.assign(indices, indices + indexCount);
+    chain.lods.push_back({ 0, indexCount, 0.0f });
+
+    std::vector<uint32_t> previous(indices, indices + indexCount);
+    float accumulatedError = 0.0f;
+    while (chain.lods.size() < maxLevels) {
+        uint32_t target = static_cast<uint32_t>(previous.size() * LEVEL_REDUCTION);
+        Result level = Simplify(positions, vertexCount, previous.data(), static_cast<uint32_t>(previous.size()),
+                                target, maxError);
+
+        // Each level starts from the previous one, so errors add up
+        if (level.indices.size() > previous.size() * MIN_LEVEL_REDUCTION) break;
+        accumulatedError += level.error;
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(chain.indices.size());
+        lod.indexCount = static_cast<uint32_t>(level.indices.size());
+        lod.error = accumulatedError;
+        chain.indices.insert(chain.indices.end(), level.indices.begin(), level.indices.end());
+        chain.lods.push_back(lod);
+
+        if (level.indices.size() <= MIN_TRIANGLES * 3) break;
+        previous.swap(level.indices);
+    }
+    return chain;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// One level of detail: a range of the chain's index list
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;  // Object-space distance the surface may have moved from LOD 0
+};
+
+// All levels share the original vertex buffer; only the index list changes
+struct MeshLodChain {
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+};
+
+// Quadric error edge-collapse simplifier (Garland-Heckbert). Vertices are only
+// ever collapsed onto existing vertices, so simplified index lists keep using
+// the source vertex buffer. Open edges, including attribute seams that were
+// authored as split vertices, are preserved by boundary constraint planes.
+class MeshSimplifier {
+public:
+    struct Result {
+        std::vector<uint32_t> indices;
+        float error;  // Largest collapse error, as a distance
+    };
+
+    // Collapses edges until the index count reaches targetIndexCount or the next
+    // collapse would move the surface further than maxError
+    static Result Simplify(const Float3* positions, uint32_t vertexCount,
+                           const uint32_t* indices, uint32_t indexCount,
+                           uint32_t targetIndexCount, float maxError);
+
+    // Halves the triangle count per level until a level stops shrinking meaningfully
+    static MeshLodChain BuildLodChain(const Float3* positions, uint32_t vertexCount,
+                                      const uint32_t* indices, uint32_t indexCount,
+                                      uint32_t maxLevels = 8, float maxError = 1e30f);
+
+private:
+    // Constants
+    static constexpr float LEVEL_REDUCTION = 0.5f;
+    static constexpr float MIN_LEVEL_REDUCTION = 0.9f;  // Stop when a level keeps more than this fraction
+    static constexpr uint32_t MIN_TRIANGLES = 2;
+};
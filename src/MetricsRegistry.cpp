@@ -0,0 +1,278 @@
+#include "MetricsRegistry.h"
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<uint32_t> g_nextShard(0);
+
+// Exported histogram buckets start at 2^10 ns (about a microsecond) and double from there
+const uint32_t FIRST_EXPORTED_EXPONENT = 10;
+
+bool IsValidName(const char* name) {
+    if (!name || !*name) return false;
+    for (const char* c = name; *c; ++c) {
+        bool letter = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || *c == '_' || *c == ':';
+        if (!letter && (c == name || *c < '0' || *c > '9')) return false;
+    }
+    return true;
+}
+
+void AppendHelp(std::string& text, const std::string& name, const std::string& help, const char* type) {
+    text += "# HELP " + name + " ";
+    for (char c : help) {
+        if (c == '\\') text += "\\\\";
+        else if (c == '\n') text += "\\n";
+        else text += c;
+    }
+    text += "\n# TYPE " + name + " " + type + "\n";
+}
+
+void AppendLine(std::string& text, const char* format, ...) {
+    char line[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(line, sizeof(line), format, arguments);
+    va_end(arguments);
+    text += line;
+}
+
+} // namespace
+
+MetricsRegistry::MetricsRegistry() :
+    m_shardStride(0),
+    m_usedSlots(0),
+    m_exportInterval(DEFAULT_EXPORT_MILLISECONDS),
+    m_stopExport(false),
+    m_exports(0),
+    m_exportFailures(0) {
+}
+
+MetricsRegistry::~MetricsRegistry() {
+    StopExport();
+}
+
+bool MetricsRegistry::Initialize(uint32_t slotCapacity) {
+    if (slotCapacity == 0 || m_slots) return false;
+
+    // Whole cache lines per shard, so neighbouring shards never share one
+    m_shardStride = (slotCapacity + 7) & ~7u;
+    size_t slotCount = static_cast<size_t>(m_shardStride) * SHARD_COUNT;
+    m_slots.reset(new std::atomic<uint64_t>[slotCount]);
+    for (size_t i = 0; i < slotCount; ++i) {
+        m_slots[i].store(0, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+uint32_t MetricsRegistry::AssignShard() {
+    return g_nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+}
+
+uint32_t MetricsRegistry::Add(const char* name, const char* help, Kind kind, uint32_t slotCount) {
+    if (!m_slots || !IsValidName(name)) return INVALID_METRIC;
+
+    std::lock_guard<std::mutex> lock(m_metricsMutex);
+    if (m_usedSlots + slotCount > m_shardStride) return INVALID_METRIC;
+    for (const Metric& metric : m_metrics) {
+        if (metric.name == name) return INVALID_METRIC;
+    }
+    Metric metric;
+    metric.name = name;
+    metric.help = help ? help : "";
+    metric.kind = kind;
+    metric.slot = m_usedSlots;
+    m_metrics.push_back(metric);
+    m_usedSlots += slotCount;
+    return metric.slot;
+}
+
+uint32_t MetricsRegistry::AddCounter(const char* name, const char* help) {
+    return Add(name, help, Kind::Counter, 1);
+}
+
+uint32_t MetricsRegistry::AddGauge(const char* name, const char* help) {
+    return Add(name, help, Kind::Gauge, 1);
+}
+
+uint32_t MetricsRegistry::AddHistogram(const char* name, const char* help) {
+    return Add(name, help, Kind::Histogram, HISTOGRAM_SLOTS);
+}
+
+uint64_t MetricsRegistry::GetBucketStart(uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    if (bucket >= BUCKET_COUNT) return 1ull << MAX_EXPONENT;
+    uint32_t exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    return static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t MetricsRegistry::SumShards(uint32_t slot) const {
+    uint64_t sum = 0;
+    for (uint32_t shard = 0; shard < SHARD_COUNT; ++shard) {
+        sum += m_slots[static_cast<size_t>(shard) * m_shardStride + slot].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t MetricsRegistry::GetCounter(uint32_t counter) const {
+    return SumShards(counter);
+}
+
+int64_t MetricsRegistry::GetGauge(uint32_t gauge) const {
+    return static_cast<int64_t>(m_slots[gauge].load(std::memory_order_relaxed));
+}
+
+MetricsRegistry::HistogramSnapshot MetricsRegistry::GetHistogram(uint32_t histogram) const {
+    // The count is the bucket total rather than a slot of its own, so it always agrees with them
+    HistogramSnapshot snapshot;
+    snapshot.count = 0;
+    snapshot.sumNanoseconds = SumShards(histogram);
+    snapshot.buckets.resize(BUCKET_COUNT);
+    for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        snapshot.buckets[bucket] = SumShards(histogram + 1 + bucket);
+        snapshot.count += snapshot.buckets[bucket];
+    }
+    return snapshot;
+}
+
+uint64_t MetricsRegistry::GetPercentile(const HistogramSnapshot& histogram, double quantile) {
+    if (histogram.count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(histogram.count - 1));
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+        seen += histogram.buckets[bucket];
+        if (seen > rank) {
+            uint64_t start = GetBucketStart(bucket);
+            return start + (GetBucketStart(bucket + 1) - start) / 2;
+        }
+    }
+    return GetBucketStart(BUCKET_COUNT);
+}
+
+std::string MetricsRegistry::FormatPrometheus() const {
+    std::string text;
+    std::lock_guard<std::mutex> lock(m_metricsMutex);
+    for (const Metric& metric : m_metrics) {
+        switch (metric.kind) {
+            case Kind::Counter:
+                AppendHelp(text, metric.name, metric.help, "counter");
+                AppendLine(text, "%s %" PRIu64 "\n", metric.name.c_str(), GetCounter(metric.slot));
+                break;
+
+            case Kind::Gauge:
+                AppendHelp(text, metric.name, metric.help, "gauge");
+                AppendLine(text, "%s %" PRId64 "\n", metric.name.c_str(), GetGauge(metric.slot));
+                break;
+
+            case Kind::Histogram: {
+                // Power-of-two bounds keep the series stable between scrapes; the finer buckets stay in-process
+                std::string name = metric.name + "_seconds";
+                AppendHelp(text, name, metric.help, "histogram");
+                HistogramSnapshot snapshot = GetHistogram(metric.slot);
+                uint64_t cumulative = 0;
+                uint32_t bucket = 0;
+                for (uint32_t exponent = FIRST_EXPORTED_EXPONENT; exponent < MAX_EXPONENT; ++exponent) {
+                    uint32_t end = (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+                    for (; bucket < end; ++bucket) cumulative += snapshot.buckets[bucket];
+                    AppendLine(text, "%s_bucket{le=\"%.9g\"} %" PRIu64 "\n", name.c_str(),
+                               static_cast<double>(1ull << exponent) * 1e-9, cumulative);
+                }
+                AppendLine(text, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name.c_str(), snapshot.count);
+                AppendLine(text, "%s_sum %.9f\n", name.c_str(), static_cast<double>(snapshot.sumNanoseconds) * 1e-9);
+                AppendLine(text, "%s_count %" PRIu64 "\n", name.c_str(), snapshot.count);
+                break;
+            }
+        }
+    }
+    return text;
+}
+
+bool MetricsRegistry::StartExport(const char* path, uint32_t intervalMilliseconds) {
+    if (!m_slots || !path || !*path || intervalMilliseconds == 0 || m_exporter.joinable()) return false;
+#if defined(_WIN32)
+    if (strncmp(path, "unix:", 5) == 0) return false;
+#endif
+    m_exportPath = path;
+    m_exportInterval = intervalMilliseconds;
+    m_stopExport = false;
+    m_exporter = std::thread(&MetricsRegistry::ExportMain, this);
+    return true;
+}
+
+void MetricsRegistry::StopExport() {
+    if (!m_exporter.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_exportMutex);
+        m_stopExport = true;
+    }
+    m_exportWake.notify_one();
+    m_exporter.join();
+}
+
+void MetricsRegistry::ExportMain() {
+    std::unique_lock<std::mutex> lock(m_exportMutex);
+    bool stopping = false;
+    while (!stopping) {
+        stopping = m_exportWake.wait_for(lock, std::chrono::milliseconds(m_exportInterval),
+                                         [this] { return m_stopExport; });
+        lock.unlock();
+        if (Export(FormatPrometheus())) {
+            m_exports.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_exportFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+        lock.lock();
+    }
+}
+
+bool MetricsRegistry::Export(const std::string& text) const {
+    if (m_exportPath.compare(0, 5, "unix:") == 0) {
+#if defined(_WIN32)
+        return false;
+#else
+        // Nobody listening is a failed flush, not an error; the next one tries again
+        std::string socketPath = m_exportPath.substr(5);
+        sockaddr_un address = {};
+        if (socketPath.size() >= sizeof(address.sun_path)) return false;
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        int socketHandle = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (socketHandle < 0) return false;
+        bool sent = connect(socketHandle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        int flags = 0;
+#if defined(MSG_NOSIGNAL)
+        flags = MSG_NOSIGNAL;   // A reader that hangs up early must not kill the game with SIGPIPE
+#endif
+        for (size_t offset = 0; sent && offset < text.size();) {
+            ssize_t written = send(socketHandle, text.data() + offset, text.size() - offset, flags);
+            sent = written > 0;
+            if (sent) offset += static_cast<size_t>(written);
+        }
+        close(socketHandle);
+        return sent;
+#endif
+    }
+
+    // Written beside the target and renamed over it, so readers see the old snapshot or the new one
+    std::string temporaryPath = m_exportPath + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = fclose(file) == 0 && written;
+    if (!written) return false;
+#if defined(_WIN32)
+    return MoveFileExA(temporaryPath.c_str(), m_exportPath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(temporaryPath.c_str(), m_exportPath.c_str()) == 0;
+#endif
+}
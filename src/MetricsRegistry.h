@@ -0,0 +1,173 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Counters, gauges and latency histograms cheap enough to record from the
+// frame loop and worker threads. Every metric is a range of 64-bit slots, and
+// each thread records into one of SHARD_COUNT copies of all the slots, picked
+// the first time the thread records, so threads rarely share a cache line and
+// a counter increment is one uncontended relaxed add. Readers sum the shards.
+//
+// Histograms bucket nanosecond values HDR-style: exact below 8, then 8 linear
+// sub-buckets per power of two, so any value lands in a bucket within 12.5%
+// of it, up to 2^40 ns (18 minutes); larger values share the last bucket.
+//
+// Metrics are registered up front (registration takes a lock, recording never
+// does) and recorded by id. StartExport flushes a snapshot in the Prometheus
+// text format on a background thread, either to a file, replaced atomically so
+// a textfile collector never reads half of one, or, for a path starting with
+// "unix:", to whoever is listening on that Unix socket (not on Windows).
+class MetricsRegistry {
+public:
+    enum class Kind : uint8_t { Counter, Gauge, Histogram };
+
+    struct HistogramSnapshot {
+        uint64_t count;
+        uint64_t sumNanoseconds;
+        std::vector<uint64_t> buckets;  // BUCKET_COUNT entries, not cumulative
+    };
+
+    MetricsRegistry();
+    ~MetricsRegistry();
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    // slotCapacity bounds the metrics: a counter or gauge takes one slot, a histogram HISTOGRAM_SLOTS
+    bool Initialize(uint32_t slotCapacity = DEFAULT_SLOTS);
+
+    // Names follow Prometheus rules ([a-zA-Z_:][a-zA-Z0-9_:]*) and are used as
+    // given; histograms get a _seconds suffix on export. INVALID_METRIC when
+    // full, the name is taken or invalid. Any thread.
+    uint32_t AddCounter(const char* name, const char* help);
+    uint32_t AddGauge(const char* name, const char* help);
+    uint32_t AddHistogram(const char* name, const char* help);
+
+    // Hot path; any thread, lock-free
+    void Increment(uint32_t counter, uint64_t amount = 1) {
+        Shard(counter)->fetch_add(amount, std::memory_order_relaxed);
+    }
+    void SetGauge(uint32_t gauge, int64_t value) {
+        m_slots[gauge].store(static_cast<uint64_t>(value), std::memory_order_relaxed);
+    }
+    void RecordNanoseconds(uint32_t histogram, uint64_t nanoseconds) {
+        std::atomic<uint64_t>* slots = Shard(histogram);
+        slots[0].fetch_add(nanoseconds, std::memory_order_relaxed);
+        slots[1 + GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Summed across shards; a snapshot taken while threads record may miss
+    // their latest few updates but never counts one twice
+    uint64_t GetCounter(uint32_t counter) const;
+    int64_t GetGauge(uint32_t gauge) const;
+    HistogramSnapshot GetHistogram(uint32_t histogram) const;
+    // Value at a quantile in [0, 1], the midpoint of its bucket; 0 if empty
+    static uint64_t GetPercentile(const HistogramSnapshot& histogram, double quantile);
+
+    // Every metric in the Prometheus text exposition format
+    std::string FormatPrometheus() const;
+
+    // Flushes every intervalMilliseconds, and once more from StopExport
+    bool StartExport(const char* path, uint32_t intervalMilliseconds = DEFAULT_EXPORT_MILLISECONDS);
+    void StopExport();
+    bool IsExporting() const { return m_exporter.joinable(); }
+    uint64_t GetExportCount() const { return m_exports.load(std::memory_order_relaxed); }
+    uint64_t GetExportFailures() const { return m_exportFailures.load(std::memory_order_relaxed); }
+
+    static uint32_t GetBucket(uint64_t nanoseconds) {
+        if (nanoseconds < SUB_BUCKETS) return static_cast<uint32_t>(nanoseconds);
+#if defined(_MSC_VER)
+        unsigned long exponent;
+        _BitScanReverse64(&exponent, nanoseconds);
+#else
+        uint32_t exponent = 63 - static_cast<uint32_t>(__builtin_clzll(nanoseconds));
+#endif
+        if (exponent >= MAX_EXPONENT) return BUCKET_COUNT - 1;
+        uint32_t subBucket = static_cast<uint32_t>(nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (static_cast<uint32_t>(exponent) - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+    }
+    // Smallest value in a bucket; the bucket ends where the next one starts
+    static uint64_t GetBucketStart(uint32_t bucket);
+
+    // Constants
+    static constexpr uint32_t SHARD_COUNT = 16;
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t MAX_EXPONENT = 40;
+    static constexpr uint32_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    static constexpr uint32_t HISTOGRAM_SLOTS = BUCKET_COUNT + 1;   // The sum, then the buckets
+    static constexpr uint32_t DEFAULT_SLOTS = 4096;
+    static constexpr uint32_t DEFAULT_EXPORT_MILLISECONDS = 1000;
+    static constexpr uint32_t INVALID_METRIC = 0xFFFFFFFF;
+
+private:
+    struct Metric {
+        std::string name;
+        std::string help;
+        Kind kind;
+        uint32_t slot;
+    };
+
+    // Shard s holds slots [s * m_shardStride, (s + 1) * m_shardStride); gauges live in shard 0 alone
+    std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+    uint32_t m_shardStride;
+    uint32_t m_usedSlots;
+    std::vector<Metric> m_metrics;
+    mutable std::mutex m_metricsMutex;
+
+    std::thread m_exporter;
+    std::string m_exportPath;
+    uint32_t m_exportInterval;
+    bool m_stopExport;
+    std::mutex m_exportMutex;
+    std::condition_variable m_exportWake;
+    std::atomic<uint64_t> m_exports;
+    std::atomic<uint64_t> m_exportFailures;
+
+    std::atomic<uint64_t>* Shard(uint32_t slot) {
+        return &m_slots[static_cast<size_t>(GetThreadShard()) * m_shardStride + slot];
+    }
+    uint64_t SumShards(uint32_t slot) const;
+    uint32_t Add(const char* name, const char* help, Kind kind, uint32_t slotCount);
+    void ExportMain();
+    bool Export(const std::string& text) const;
+
+    static uint32_t GetThreadShard() {
+        static thread_local uint32_t shard = AssignShard();
+        return shard;
+    }
+    static uint32_t AssignShard();
+};
+
+// Records the time from construction to destruction into a histogram
+class MetricsTimerScope {
+public:
+    MetricsTimerScope(MetricsRegistry* registry, uint32_t histogram) :
+        m_registry(registry),
+        m_histogram(histogram),
+        m_start(std::chrono::steady_clock::now()) {}
+    ~MetricsTimerScope() {
+        if (!m_registry || m_histogram == MetricsRegistry::INVALID_METRIC) return;
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_registry->RecordNanoseconds(m_histogram,
+                                      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    MetricsTimerScope(const MetricsTimerScope&) = delete;
+    MetricsTimerScope& operator=(const MetricsTimerScope&) = delete;
+
+private:
+    MetricsRegistry* m_registry;
+    uint32_t m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
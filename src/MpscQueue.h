@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free queue for many producer threads and one consumer. Each
+// slot carries a sequence number that tells producers and the consumer whose
+// turn it is, so neither side ever blocks; Push fails instead when the queue
+// is full. Capacity is rounded up to a power of two.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : m_mask(0), m_enqueue(0), m_dequeue(0) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Not thread-safe; call before any Push or Pop
+    bool Initialize(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = size - 1;
+        m_enqueue.store(0, std::memory_order_relaxed);
+        m_dequeue = 0;
+        return true;
+    }
+
+    // Any thread
+    bool Push(const T& value) {
+        size_t position = m_enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = m_slots[position & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                // The slot is free for this position; claim it unless another producer got there first
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;  // Full: the consumer has not freed this slot yet
+            } else {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    bool Pop(T& value) {
+        Slot& slot = m_slots[m_dequeue & m_mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(m_dequeue + 1) < 0) {
+            return false;  // Empty, or the producer that claimed the slot has not finished writing
+        }
+        value = slot.value;
+        slot.sequence.store(m_dequeue + m_mask + 1, std::memory_order_release);
+        m_dequeue++;
+        return true;
+    }
+
+    size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueue;  // Producers and consumer on separate cache lines
+    alignas(64) size_t m_dequeue;
+};
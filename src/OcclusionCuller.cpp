@@ -0,0 +1,455 @@
+#include "OcclusionCuller.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+    // Edge function A * x + (B * y + C), evaluated identically by both paths
+    struct Edge {
+        float a, b, c;
+    };
+
+    Edge MakeEdge(float x0, float y0, float x1, float y1) {
+        return { y0 - y1, x1 - x0, x0 * y1 - x1 * y0 };
+    }
+
+    // Box corners and the twelve triangles covering its faces
+    const uint32_t BOX_INDICES[36] = {
+        0, 1, 3, 0, 3, 2,   // -x
+        4, 6, 7, 4, 7, 5,   // +x
+        0, 4, 5, 0, 5, 1,   // -y
+        2, 3, 7, 2, 7, 6,   // +y
+        0, 2, 6, 0, 6, 4,   // -z
+        1, 5, 7, 1, 7, 3    // +z
+    };
+
+    void MakeBoxCorners(const Float3& boundsMin, const Float3& boundsMax, Float3 corners[8]) {
+        for (int i = 0; i < 8; ++i) {
+            corners[i].x = (i & 4) ? boundsMax.x : boundsMin.x;
+            corners[i].y = (i & 2) ? boundsMax.y : boundsMin.y;
+            corners[i].z = (i & 1) ? boundsMax.z : boundsMin.z;
+        }
+    }
+}
+
+OcclusionCuller::OcclusionCuller() :
+    m_width(0),
+    m_height(0),
+    m_tilesX(0),
+    m_tilesY(0),
+    m_viewProjection(Float4x4::Identity()),
+    m_useSimd(IsSimdSupported()),
+    m_stats() {
+}
+
+OcclusionCuller::~OcclusionCuller() {
+}
+
+bool OcclusionCuller::Initialize(uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) return false;
+
+    m_width = (width + 7) & ~7u;
+    m_height = height;
+    m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+    m_depth.assign(static_cast<size_t>(m_width) * m_height, FLT_MAX);
+    m_tileMaxDepth.assign(static_cast<size_t>(m_tilesX) * m_tilesY, FLT_MAX);
+    m_rowSpans.resize(m_height);
+    return true;
+}
+
+bool OcclusionCuller::IsSimdSupported() {
+    return CpuHasAvx2();
+}
+
+void OcclusionCuller::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+void OcclusionCuller::BeginFrame(const Float4x4& viewProjection) {
+    m_viewProjection = viewProjection;
+    std::fill(m_depth.begin(), m_depth.end(), FLT_MAX);
+    std::fill(m_tileMaxDepth.begin(), m_tileMaxDepth.end(), FLT_MAX);
+    m_stats = {};
+}
+
+void OcclusionCuller::RasterizeMesh(const Float3* positions, uint32_t vertexCount,
+                                    const uint32_t* indices, uint32_t indexCount, const Float4x4& world) {
+    if (m_depth.empty()) return;
+    m_stats.occluders++;
+
+    Float4x4 worldViewProjection = Multiply(world, m_viewProjection);
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+        if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) {
+            continue;
+        }
+        Float4 clip[3] = {
+            TransformPoint4(positions[indices[i]], worldViewProjection),
+            TransformPoint4(positions[indices[i + 1]], worldViewProjection),
+            TransformPoint4(positions[indices[i + 2]], worldViewProjection)
+        };
+        ClipAndRasterize(clip);
+    }
+}
+
+void OcclusionCuller::ClipAndRasterize(const Float4* triangle) {
+    int inFront = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (triangle[i].w >= NEAR_CLIP_W) inFront++;
+    }
+    if (inFront == 3) {
+        RasterizeTriangle(triangle[0], triangle[1], triangle[2]);
+        return;
+    }
+    if (inFront == 0) {
+        m_stats.trianglesSkipped++;
+        return;
+    }
+
+    // Walls next to the camera are the best occluders, so clip rather than drop them
+    Float4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        const Float4& a = triangle[i];
+        const Float4& b = triangle[(i + 1) % 3];
+        bool aInside = a.w >= NEAR_CLIP_W;
+        bool bInside = b.w >= NEAR_CLIP_W;
+        if (aInside) {
+            polygon[count++] = a;
+        }
+        if (aInside != bInside) {
+            float t = (NEAR_CLIP_W - a.w) / (b.w - a.w);
+            polygon[count++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                                 a.z + (b.z - a.z) * t, NEAR_CLIP_W };
+        }
+    }
+
+    for (int i = 1; i + 1 < count; ++i) {
+        RasterizeTriangle(polygon[0], polygon[i], polygon[i + 1]);
+    }
+}
+
+void OcclusionCuller::RasterizeBox(const Float3& boundsMin, const Float3& boundsMax, const Float4x4& world) {
+    Float3 corners[8];
+    MakeBoxCorners(boundsMin, boundsMax, corners);
+    RasterizeMesh(corners, 8, BOX_INDICES, 36, world);
+}
+
+namespace {
+    struct TriangleSetup {
+        Edge edges[3];
+        float zA, zB, zC;  // Depth plane z = zA * x + (zB * y + zC)
+    };
+
+    TriangleSetup SetupTriangle(const float* x, const float* y, const float* z) {
+        TriangleSetup setup;
+        setup.edges[0] = MakeEdge(x[1], y[1], x[2], y[2]);
+        setup.edges[1] = MakeEdge(x[2], y[2], x[0], y[0]);
+        setup.edges[2] = MakeEdge(x[0], y[0], x[1], y[1]);
+
+        float area = setup.edges[0].c + setup.edges[1].c + setup.edges[2].c;
+        float invArea = 1.0f / area;
+        float w0 = z[0] * invArea;
+        float w1 = z[1] * invArea;
+        float w2 = z[2] * invArea;
+        setup.zA = setup.edges[0].a * w0 + setup.edges[1].a * w1 + setup.edges[2].a * w2;
+        setup.zB = setup.edges[0].b * w0 + setup.edges[1].b * w1 + setup.edges[2].b * w2;
+        setup.zC = setup.edges[0].c * w0 + setup.edges[1].c * w1 + setup.edges[2].c * w2;
+        return setup;
+    }
+}
+
+void OcclusionCuller::RasterizeTriangle(const Float4& v0, const Float4& v1, const Float4& v2) {
+    const Float4* vertices[3] = { &v0, &v1, &v2 };
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; ++i) {
+        float invW = 1.0f / vertices[i]->w;
+        x[i] = (vertices[i]->x * invW * 0.5f + 0.5f) * m_width;
+        y[i] = (0.5f - vertices[i]->y * invW * 0.5f) * m_height;
+        z[i] = vertices[i]->z * invW;
+    }
+
+    // Both windings are accepted so occluders work regardless of handedness
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (std::fabs(area) < 1e-6f) {
+        m_stats.trianglesSkipped++;
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+    }
+
+    float minXf = std::min({ x[0], x[1], x[2] });
+    float maxXf = std::max({ x[0], x[1], x[2] });
+    float minYf = std::min({ y[0], y[1], y[2] });
+    float maxYf = std::max({ y[0], y[1], y[2] });
+
+    int minX = std::max(0, static_cast<int>(std::floor(minXf)));
+    int maxX = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::ceil(maxXf)));
+    int minY = std::max(0, static_cast<int>(std::floor(minYf)));
+    int maxY = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::ceil(maxYf)));
+    if (minX > maxX || minY > maxY) {
+        m_stats.trianglesSkipped++;
+        return;
+    }
+
+    // Row setup is shared by both paths, which keeps libm calls out of the AVX2 loop
+    TriangleSetup setup = SetupTriangle(x, y, z);
+    float inverseA[3];
+    for (int i = 0; i < 3; ++i) {
+        inverseA[i] = setup.edges[i].a != 0.0f ? 1.0f / setup.edges[i].a : 0.0f;
+    }
+
+    for (int row = minY; row <= maxY; ++row) {
+        RowSpan& span = m_rowSpans[row];
+        float py = static_cast<float>(row) + 0.5f;
+        for (int i = 0; i < 3; ++i) {
+            span.edges[i] = setup.edges[i].b * py + setup.edges[i].c;
+        }
+        span.depth = setup.zB * py + setup.zC;
+
+        // Narrow the box to the pixels this row can cover. The bounds are padded
+        // so rounding never drops a pixel; the exact test happens per pixel.
+        float lower = static_cast<float>(minX);
+        float upper = static_cast<float>(maxX) + 1.0f;
+        bool empty = false;
+        for (int i = 0; i < 3; ++i) {
+            float crossing = -span.edges[i] * inverseA[i];
+            if (setup.edges[i].a > 0.0f) {
+                lower = std::max(lower, crossing);
+            } else if (setup.edges[i].a < 0.0f) {
+                upper = std::min(upper, crossing);
+            } else if (span.edges[i] <= 0.0f) {
+                empty = true;
+            }
+        }
+        if (empty || lower > upper) {
+            span.minX = 0;
+            span.maxX = -1;
+            continue;
+        }
+        // Both bounds are non-negative here, so truncation stands in for floor
+        span.minX = std::max(minX, static_cast<int>(lower) - 1);
+        span.maxX = std::min(maxX, static_cast<int>(upper) + 1);
+    }
+
+    const float edgeA[3] = { setup.edges[0].a, setup.edges[1].a, setup.edges[2].a };
+    m_stats.trianglesRasterized++;
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        RasterizeSimd(edgeA, setup.zA, minY, maxY);
+        return;
+    }
+#endif
+    RasterizeScalar(edgeA, setup.zA, minY, maxY);
+}
+
+void OcclusionCuller::RasterizeScalar(const float* edgeA, float depthA, int minY, int maxY) {
+    for (int y = minY; y <= maxY; ++y) {
+        const RowSpan& span = m_rowSpans[y];
+        float* row = &m_depth[static_cast<size_t>(y) * m_width];
+
+        for (int x = span.minX; x <= span.maxX; ++x) {
+            float px = static_cast<float>(x) + 0.5f;
+            float e0 = edgeA[0] * px + span.edges[0];
+            float e1 = edgeA[1] * px + span.edges[1];
+            float e2 = edgeA[2] * px + span.edges[2];
+            if (e0 > 0.0f && e1 > 0.0f && e2 > 0.0f) {
+                float depth = depthA * px + span.depth;
+                row[x] = std::min(row[x], depth);
+            }
+        }
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void OcclusionCuller::RasterizeSimd(const float* edgeA, float depthA, int minY, int maxY) {
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(edgeA[0]);
+    const __m256 a1 = _mm256_set1_ps(edgeA[1]);
+    const __m256 a2 = _mm256_set1_ps(edgeA[2]);
+    const __m256 zA = _mm256_set1_ps(depthA);
+
+    for (int y = minY; y <= maxY; ++y) {
+        const RowSpan& span = m_rowSpans[y];
+        if (span.minX > span.maxX) continue;
+
+        __m256 rowE0 = _mm256_set1_ps(span.edges[0]);
+        __m256 rowE1 = _mm256_set1_ps(span.edges[1]);
+        __m256 rowE2 = _mm256_set1_ps(span.edges[2]);
+        __m256 rowZ = _mm256_set1_ps(span.depth);
+        __m256i lower = _mm256_set1_epi32(span.minX - 1);
+        __m256i upper = _mm256_set1_epi32(span.maxX + 1);
+        float* row = &m_depth[static_cast<size_t>(y) * m_width];
+
+        // Rows are a multiple of 8 wide, so aligned groups never run past the end
+        for (int x = span.minX & ~7; x <= span.maxX; x += 8) {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+            __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), rowE0);
+            __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), rowE1);
+            __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), rowE2);
+
+            __m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GT_OQ),
+                            _mm256_and_ps(_mm256_cmp_ps(e1, zero, _CMP_GT_OQ),
+                                          _mm256_cmp_ps(e2, zero, _CMP_GT_OQ)));
+
+            // Restrict to the row span so both paths touch the same pixels
+            __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndices);
+            __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(lane, lower), _mm256_cmpgt_epi32(upper, lane));
+            inside = _mm256_and_ps(inside, _mm256_castsi256_ps(inRange));
+            if (_mm256_testz_ps(inside, inside)) continue;
+
+            __m256 depth = _mm256_add_ps(_mm256_mul_ps(zA, px), rowZ);
+            __m256 current = _mm256_loadu_ps(row + x);
+            __m256 nearer = _mm256_min_ps(current, depth);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, nearer, inside));
+        }
+    }
+}
+#else
+void OcclusionCuller::RasterizeSimd(const float* edgeA, float depthA, int minY, int maxY) {
+    RasterizeScalar(edgeA, depthA, minY, maxY);
+}
+#endif
+
+void OcclusionCuller::EndOccluders() {
+    for (uint32_t tileY = 0; tileY < m_tilesY; ++tileY) {
+        for (uint32_t tileX = 0; tileX < m_tilesX; ++tileX) {
+            uint32_t endY = std::min((tileY + 1) * TILE_SIZE, m_height);
+            float farthest = -FLT_MAX;
+            for (uint32_t y = tileY * TILE_SIZE; y < endY; ++y) {
+                const float* row = &m_depth[static_cast<size_t>(y) * m_width + tileX * TILE_SIZE];
+                for (uint32_t x = 0; x < TILE_SIZE; ++x) {
+                    farthest = std::max(farthest, row[x]);
+                }
+            }
+            m_tileMaxDepth[tileY * m_tilesX + tileX] = farthest;
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const Float3& boundsMin, const Float3& boundsMax) {
+    m_stats.objectsTested++;
+    if (m_depth.empty()) return true;
+
+    Float3 corners[8];
+    MakeBoxCorners(boundsMin, boundsMax, corners);
+
+    Float4 clip[8];
+    uint32_t outsideAll = 0x1f;
+    bool crossesNearPlane = false;
+    for (int i = 0; i < 8; ++i) {
+        clip[i] = TransformPoint4(corners[i], m_viewProjection);
+        uint32_t outside = 0;
+        if (clip[i].x < -clip[i].w) outside |= 1;
+        if (clip[i].x > clip[i].w) outside |= 2;
+        if (clip[i].y < -clip[i].w) outside |= 4;
+        if (clip[i].y > clip[i].w) outside |= 8;
+        if (clip[i].w < NEAR_CLIP_W) {
+            outside |= 16;
+            crossesNearPlane = true;
+        }
+        outsideAll &= outside;
+    }
+
+    // Every corner beyond the same side plane or behind the camera
+    if (outsideAll != 0) {
+        m_stats.objectsOffscreen++;
+        return false;
+    }
+    // Anything reaching the camera plane cannot be judged from screen space
+    if (crossesNearPlane) return true;
+
+    float minXf = FLT_MAX, maxXf = -FLT_MAX;
+    float minYf = FLT_MAX, maxYf = -FLT_MAX;
+    float nearest = FLT_MAX;
+    for (const Float4& corner : clip) {
+        float invW = 1.0f / corner.w;
+        float x = (corner.x * invW * 0.5f + 0.5f) * m_width;
+        float y = (0.5f - corner.y * invW * 0.5f) * m_height;
+        minXf = std::min(minXf, x);
+        maxXf = std::max(maxXf, x);
+        minYf = std::min(minYf, y);
+        maxYf = std::max(maxYf, y);
+        nearest = std::min(nearest, corner.z * invW);
+    }
+
+    int minX = std::max(0, static_cast<int>(std::floor(minXf)));
+    int maxX = std::min(static_cast<int>(m_width) - 1, static_cast<int>(std::ceil(maxXf)));
+    int minY = std::max(0, static_cast<int>(std::floor(minYf)));
+    int maxY = std::min(static_cast<int>(m_height) - 1, static_cast<int>(std::ceil(maxYf)));
+    if (minX > maxX || minY > maxY) {
+        m_stats.objectsOffscreen++;
+        return false;
+    }
+
+    // Coarse pass: a tile whose farthest occluder is not in front of the box may let it through
+    bool needsPixelTest = false;
+    for (int tileY = minY / static_cast<int>(TILE_SIZE); tileY <= maxY / static_cast<int>(TILE_SIZE); ++tileY) {
+        for (int tileX = minX / static_cast<int>(TILE_SIZE); tileX <= maxX / static_cast<int>(TILE_SIZE); ++tileX) {
+            if (m_tileMaxDepth[tileY * m_tilesX + tileX] >= nearest) {
+                needsPixelTest = true;
+                break;
+            }
+        }
+        if (needsPixelTest) break;
+    }
+
+    bool visible = false;
+    if (needsPixelTest) {
+#if FPSGAME_AVX2
+        visible = m_useSimd ? TestRectSimd(minX, maxX, minY, maxY, nearest)
+                            : TestRectScalar(minX, maxX, minY, maxY, nearest);
+#else
+        visible = TestRectScalar(minX, maxX, minY, maxY, nearest);
+#endif
+    }
+
+    if (!visible) {
+        m_stats.objectsOccluded++;
+    }
+    return visible;
+}
+
+bool OcclusionCuller::TestRectScalar(int minX, int maxX, int minY, int maxY, float depth) const {
+    for (int y = minY; y <= maxY; ++y) {
+        const float* row = &m_depth[static_cast<size_t>(y) * m_width];
+        for (int x = minX; x <= maxX; ++x) {
+            if (row[x] >= depth) return true;
+        }
+    }
+    return false;
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+bool OcclusionCuller::TestRectSimd(int minX, int maxX, int minY, int maxY, float depth) const {
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 objectDepth = _mm256_set1_ps(depth);
+    const __m256i lower = _mm256_set1_epi32(minX - 1);
+    const __m256i upper = _mm256_set1_epi32(maxX + 1);
+
+    int startX = minX & ~7;
+    for (int y = minY; y <= maxY; ++y) {
+        const float* row = &m_depth[static_cast<size_t>(y) * m_width];
+        for (int x = startX; x <= maxX; x += 8) {
+            __m256i lane = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndices);
+            __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(lane, lower), _mm256_cmpgt_epi32(upper, lane));
+            __m256 behind = _mm256_cmp_ps(_mm256_loadu_ps(row + x), objectDepth, _CMP_GE_OQ);
+            __m256 mask = _mm256_and_ps(behind, _mm256_castsi256_ps(inRange));
+            if (!_mm256_testz_ps(mask, mask)) return true;
+        }
+    }
+    return false;
+}
+#else
+bool OcclusionCuller::TestRectSimd(int minX, int maxX, int minY, int maxY, float depth) const {
+    return TestRectScalar(minX, maxX, minY, maxY, depth);
+}
+#endif
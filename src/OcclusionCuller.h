@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// CPU occlusion culling against a low-resolution depth buffer. A handful of
+// large occluders are rasterized each frame, a max-depth tile hierarchy is
+// built on top, and object bounds are tested before submission. Depth is
+// clip z / w from the supplied view-projection, so it works with both D3D
+// [0, 1] and GL [-1, 1] projections as long as larger means farther.
+//
+// Rasterization and tests have an AVX2 path (8 pixels per step) and a scalar
+// path that evaluate the same expressions in the same order, so both produce
+// bit-identical buffers and results.
+class OcclusionCuller {
+public:
+    struct Stats {
+        uint32_t occluders;
+        uint32_t trianglesRasterized;
+        uint32_t trianglesSkipped;    // Behind the camera, off screen or degenerate
+        uint32_t objectsTested;
+        uint32_t objectsOccluded;
+        uint32_t objectsOffscreen;
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    // The width is rounded up to a multiple of 8
+    bool Initialize(uint32_t width = 256, uint32_t height = 128);
+
+    // Clears the depth buffer and sets the camera for this frame
+    void BeginFrame(const Float4x4& viewProjection);
+
+    void RasterizeMesh(const Float3* positions, uint32_t vertexCount,
+                       const uint32_t* indices, uint32_t indexCount, const Float4x4& world);
+    void RasterizeBox(const Float3& boundsMin, const Float3& boundsMax, const Float4x4& world);
+
+    // Builds the tile hierarchy; call once after the last occluder
+    void EndOccluders();
+
+    // False when the world-space box is fully hidden by occluders or off screen
+    bool IsVisible(const Float3& boundsMin, const Float3& boundsMax);
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    const float* GetDepthBuffer() const { return m_depth.data(); }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_tilesX;
+    uint32_t m_tilesY;
+    std::vector<float> m_depth;        // Nearest occluder depth per pixel
+    std::vector<float> m_tileMaxDepth; // Farthest depth per tile
+    Float4x4 m_viewProjection;
+    bool m_useSimd;
+    Stats m_stats;
+
+    // Per-row edge and depth offsets plus the pixel range the row can cover
+    struct RowSpan {
+        int minX;
+        int maxX;
+        float edges[3];
+        float depth;
+    };
+    std::vector<RowSpan> m_rowSpans;
+
+    void ClipAndRasterize(const Float4* triangle);
+    void RasterizeTriangle(const Float4& v0, const Float4& v1, const Float4& v2);
+    void RasterizeScalar(const float* edgeA, float depthA, int minY, int maxY);
+    void RasterizeSimd(const float* edgeA, float depthA, int minY, int maxY);
+    bool TestRectScalar(int minX, int maxX, int minY, int maxY, float depth) const;
+    bool TestRectSimd(int minX, int maxX, int minY, int maxY, float depth) const;
+
+    // Constants
+    static constexpr uint32_t TILE_SIZE = 8;
+    // Clip distance in view-space units; keeps projected coordinates small enough
+    // for float edge functions while staying in front of any sensible near plane
+    static constexpr float NEAR_CLIP_W = 0.05f;
+};
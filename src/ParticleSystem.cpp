@@ -0,0 +1,469 @@
+#include "ParticleSystem.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+#if FPSGAME_AVX2
+// Lane permutations that move the set lanes of an 8-bit mask to the front, and the number set
+struct PackTable {
+    uint32_t permutation[256][8];
+    uint32_t count[256];
+
+    PackTable() {
+        for (uint32_t mask = 0; mask < 256; ++mask) {
+            uint32_t packed = 0;
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+                if (mask & (1u << lane)) permutation[mask][packed++] = lane;
+            }
+            count[mask] = packed;
+            for (uint32_t lane = packed; lane < 8; ++lane) permutation[mask][lane] = 0;
+        }
+    }
+};
+
+const PackTable& GetPackTable() {
+    static const PackTable table;
+    return table;
+}
+#endif
+
+uint32_t RoundUp8(uint32_t value) {
+    return (value + 7) & ~7u;
+}
+
+} // namespace
+
+ParticleSystem::ParticleSystem() :
+    m_useSimd(IsSimdSupported()),
+    m_stats(),
+    m_rejectedParticles(0) {
+    for (Pool& pool : m_pools) {
+        pool.settings = {};
+        pool.front = 0;
+        pool.capacity = 0;
+        pool.count = 0;
+    }
+}
+
+ParticleSystem::~ParticleSystem() {
+}
+
+bool ParticleSystem::Initialize(uint32_t queueCapacity) {
+    if (queueCapacity == 0 || !m_queue.Initialize(queueCapacity)) return false;
+
+    // Short, bright and additive
+    TypeSettings flash = {};
+    flash.minLifetime = 0.04f;
+    flash.maxLifetime = 0.09f;
+    flash.gravity = { 0.0f, 0.0f, 0.0f };
+    flash.drag = 8.0f;
+    flash.startSize = 0.18f;
+    flash.endSize = 0.03f;
+    flash.startColor = { 1.0f, 0.85f, 0.5f, 1.0f };
+    flash.endColor = { 1.0f, 0.4f, 0.1f, 0.0f };
+    flash.additive = true;
+    flash.maxParticles = DEFAULT_MAX_PARTICLES;
+    SetTypeSettings(PARTICLE_MUZZLE_FLASH, flash);
+
+    // Sparks that fall
+    TypeSettings impact = flash;
+    impact.minLifetime = 0.25f;
+    impact.maxLifetime = 0.6f;
+    impact.gravity = { 0.0f, -9.81f, 0.0f };
+    impact.drag = 1.0f;
+    impact.startSize = 0.06f;
+    impact.endSize = 0.01f;
+    impact.startColor = { 1.0f, 0.8f, 0.4f, 1.0f };
+    impact.endColor = { 0.8f, 0.2f, 0.0f, 0.0f };
+    SetTypeSettings(PARTICLE_IMPACT, impact);
+
+    // Slow, growing and alpha blended
+    TypeSettings smoke = flash;
+    smoke.minLifetime = 1.5f;
+    smoke.maxLifetime = 3.0f;
+    smoke.gravity = { 0.0f, 0.6f, 0.0f };
+    smoke.drag = 1.5f;
+    smoke.startSize = 0.2f;
+    smoke.endSize = 1.2f;
+    smoke.startColor = { 0.55f, 0.55f, 0.55f, 0.5f };
+    smoke.endColor = { 0.3f, 0.3f, 0.3f, 0.0f };
+    smoke.additive = false;
+    SetTypeSettings(PARTICLE_SMOKE, smoke);
+
+    m_stats = {};
+    return true;
+}
+
+void ParticleSystem::SetTypeSettings(ParticleType type, const TypeSettings& settings) {
+    m_pools[type].settings = settings;
+}
+
+void ParticleSystem::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+bool ParticleSystem::IsSimdSupported() {
+    return CpuHasAvx2();
+}
+
+bool ParticleSystem::Emit(const Burst& burst) {
+    if (burst.type >= PARTICLE_TYPE_COUNT || m_queue.GetCapacity() == 0) return false;
+    if (!m_queue.Push(burst)) {
+        m_rejectedParticles.fetch_add(burst.count, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void ParticleSystem::Update(float deltaSeconds, JobSystem* jobs) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Drained here, so the pools are only ever touched by the thread calling Update
+    uint32_t before = 0;
+    for (const Pool& pool : m_pools) {
+        before += pool.count;
+    }
+    Burst burst;
+    while (m_queue.Pop(burst)) {
+        SpawnBurst(burst);
+    }
+    uint32_t afterSpawn = 0;
+    for (const Pool& pool : m_pools) {
+        afterSpawn += pool.count;
+    }
+
+    for (Pool& pool : m_pools) {
+        const TypeSettings& settings = pool.settings;
+        Step step;
+        step.deltaSeconds = deltaSeconds;
+        step.gravityX = settings.gravity.x * deltaSeconds;
+        step.gravityY = settings.gravity.y * deltaSeconds;
+        step.gravityZ = settings.gravity.z * deltaSeconds;
+        step.dragFactor = (std::max)(0.0f, 1.0f - settings.drag * deltaSeconds);
+        UpdatePool(pool, step, jobs);
+    }
+
+    uint32_t alive = 0;
+    for (const Pool& pool : m_pools) {
+        alive += pool.count;
+    }
+    m_stats.alive = alive;
+    m_stats.spawned = afterSpawn - before;
+    m_stats.died = afterSpawn - alive;
+    m_stats.dropped += m_rejectedParticles.exchange(0, std::memory_order_relaxed);
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::SpawnBurst(const Burst& burst) {
+    Pool& pool = m_pools[burst.type];
+    const TypeSettings& settings = pool.settings;
+    uint32_t room = settings.maxParticles > pool.count ? settings.maxParticles - pool.count : 0;
+    uint32_t count = (std::min)(burst.count, room);
+    m_stats.dropped += burst.count - count;
+    if (count == 0) return;
+    Reserve(pool, pool.count + count);
+
+    uint32_t seed = burst.seed;
+    auto random01 = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+    };
+
+    float* streams = pool.Streams(pool.front);
+    const size_t capacity = pool.capacity;
+    float* positionX = streams + STREAM_POSITION_X * capacity;
+    float* positionY = streams + STREAM_POSITION_Y * capacity;
+    float* positionZ = streams + STREAM_POSITION_Z * capacity;
+    float* velocityX = streams + STREAM_VELOCITY_X * capacity;
+    float* velocityY = streams + STREAM_VELOCITY_Y * capacity;
+    float* velocityZ = streams + STREAM_VELOCITY_Z * capacity;
+    float* age = streams + STREAM_AGE * capacity;
+    float* lifetime = streams + STREAM_LIFETIME * capacity;
+
+    float jitter = burst.spread * burst.speed * 2.0f;
+    for (uint32_t i = pool.count; i < pool.count + count; ++i) {
+        positionX[i] = burst.position.x;
+        positionY[i] = burst.position.y;
+        positionZ[i] = burst.position.z;
+        velocityX[i] = burst.direction.x * burst.speed + (random01() - 0.5f) * jitter;
+        velocityY[i] = burst.direction.y * burst.speed + (random01() - 0.5f) * jitter;
+        velocityZ[i] = burst.direction.z * burst.speed + (random01() - 0.5f) * jitter;
+        age[i] = 0.0f;
+        lifetime[i] = settings.minLifetime + (settings.maxLifetime - settings.minLifetime) * random01();
+    }
+    pool.count += count;
+}
+
+void ParticleSystem::Reserve(Pool& pool, uint32_t count) {
+    if (count <= pool.capacity) return;
+
+    // Grows geometrically so a steady stream of bursts stops allocating
+    uint32_t capacity = RoundUp8((std::max)({ count, pool.capacity * 2, 1024u }));
+    capacity = (std::min)(capacity, RoundUp8((std::max)(count, pool.settings.maxParticles)));
+
+    std::vector<float> grown(static_cast<size_t>(capacity) * STREAM_COUNT, 0.0f);
+    const float* old = pool.Streams(pool.front);
+    for (uint32_t stream = 0; stream < STREAM_COUNT && pool.count > 0; ++stream) {
+        memcpy(&grown[static_cast<size_t>(stream) * capacity], old + static_cast<size_t>(stream) * pool.capacity,
+               pool.count * sizeof(float));
+    }
+    pool.buffers[pool.front].swap(grown);
+    pool.buffers[pool.front ^ 1].assign(static_cast<size_t>(capacity) * STREAM_COUNT, 0.0f);
+    pool.capacity = capacity;
+}
+
+void ParticleSystem::UpdatePool(Pool& pool, const Step& step, JobSystem* jobs) {
+    if (pool.count == 0) return;
+
+    const uint32_t blocks = (pool.count + PARALLEL_BLOCK - 1) / PARALLEL_BLOCK;
+    uint32_t survivors;
+    if (jobs && jobs->GetThreadCount() > 1 && blocks > 1) {
+        // Count first so every block knows where its survivors start in the other buffer
+        pool.blockOffsets.resize(blocks + 1);
+        pool.blockOffsets[0] = 0;
+        jobs->ParallelFor(blocks, 1, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t block = begin; block < end; ++block) {
+                uint32_t first = static_cast<uint32_t>(block) * PARALLEL_BLOCK;
+                uint32_t last = (std::min)(first + PARALLEL_BLOCK, pool.count);
+                pool.blockOffsets[block + 1] = CountSurvivors(pool, first, last, step.deltaSeconds);
+            }
+        });
+        for (uint32_t block = 0; block < blocks; ++block) {
+            pool.blockOffsets[block + 1] += pool.blockOffsets[block];
+        }
+        jobs->ParallelFor(blocks, 1, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t block = begin; block < end; ++block) {
+                uint32_t first = static_cast<uint32_t>(block) * PARALLEL_BLOCK;
+                uint32_t last = (std::min)(first + PARALLEL_BLOCK, pool.count);
+                UpdateRange(pool, step, first, last, pool.blockOffsets[block], pool.blockOffsets[block + 1]);
+            }
+        });
+        survivors = pool.blockOffsets[blocks];
+    } else {
+        survivors = UpdateRange(pool, step, 0, pool.count, 0, pool.capacity);
+    }
+
+    pool.front ^= 1;
+    pool.count = survivors;
+}
+
+uint32_t ParticleSystem::CountSurvivors(const Pool& pool, uint32_t begin, uint32_t end, float deltaSeconds) const {
+    const float* streams = pool.Streams(pool.front);
+    const float* age = streams + STREAM_AGE * static_cast<size_t>(pool.capacity);
+    const float* lifetime = streams + STREAM_LIFETIME * static_cast<size_t>(pool.capacity);
+    uint32_t survivors = 0;
+    for (uint32_t i = begin; i < end; ++i) {
+        survivors += (age[i] + deltaSeconds < lifetime[i]) ? 1 : 0;
+    }
+    return survivors;
+}
+
+uint32_t ParticleSystem::UpdateRange(Pool& pool, const Step& step, uint32_t begin, uint32_t end,
+                                     uint32_t writeOffset, uint32_t writeLimit) const {
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        return UpdateRangeSimd(pool, step, begin, end, writeOffset, writeLimit);
+    }
+#endif
+    (void)writeLimit;
+    return UpdateRangeScalar(pool, step, begin, end, writeOffset);
+}
+
+uint32_t ParticleSystem::UpdateRangeScalar(Pool& pool, const Step& step, uint32_t begin, uint32_t end,
+                                           uint32_t writeOffset) const {
+    const size_t capacity = pool.capacity;
+    const float* source = pool.Streams(pool.front);
+    float* target = pool.Streams(pool.front ^ 1);
+
+    uint32_t write = writeOffset;
+    for (uint32_t i = begin; i < end; ++i) {
+        float age = source[STREAM_AGE * capacity + i] + step.deltaSeconds;
+        float lifetime = source[STREAM_LIFETIME * capacity + i];
+        if (!(age < lifetime)) continue;
+
+        float velocityX = (source[STREAM_VELOCITY_X * capacity + i] + step.gravityX) * step.dragFactor;
+        float velocityY = (source[STREAM_VELOCITY_Y * capacity + i] + step.gravityY) * step.dragFactor;
+        float velocityZ = (source[STREAM_VELOCITY_Z * capacity + i] + step.gravityZ) * step.dragFactor;
+        target[STREAM_POSITION_X * capacity + write] = source[STREAM_POSITION_X * capacity + i] + velocityX * step.deltaSeconds;
+        target[STREAM_POSITION_Y * capacity + write] = source[STREAM_POSITION_Y * capacity + i] + velocityY * step.deltaSeconds;
+        target[STREAM_POSITION_Z * capacity + write] = source[STREAM_POSITION_Z * capacity + i] + velocityZ * step.deltaSeconds;
+        target[STREAM_VELOCITY_X * capacity + write] = velocityX;
+        target[STREAM_VELOCITY_Y * capacity + write] = velocityY;
+        target[STREAM_VELOCITY_Z * capacity + write] = velocityZ;
+        target[STREAM_AGE * capacity + write] = age;
+        target[STREAM_LIFETIME * capacity + write] = lifetime;
+        write++;
+    }
+    return write - writeOffset;
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+uint32_t ParticleSystem::UpdateRangeSimd(Pool& pool, const Step& step, uint32_t begin, uint32_t end,
+                                         uint32_t writeOffset, uint32_t writeLimit) const {
+    const PackTable& table = GetPackTable();
+    const size_t capacity = pool.capacity;
+    const float* source = pool.Streams(pool.front);
+    float* target = pool.Streams(pool.front ^ 1);
+
+    const __m256 deltaSeconds = _mm256_set1_ps(step.deltaSeconds);
+    const __m256 gravityX = _mm256_set1_ps(step.gravityX);
+    const __m256 gravityY = _mm256_set1_ps(step.gravityY);
+    const __m256 gravityZ = _mm256_set1_ps(step.gravityZ);
+    const __m256 dragFactor = _mm256_set1_ps(step.dragFactor);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    uint32_t write = writeOffset;
+    for (uint32_t i = begin; i < end; i += 8) {
+        // Reads past end stay inside the padded capacity; those lanes are masked off
+        uint32_t valid = end - i >= 8 ? 0xffu : (1u << (end - i)) - 1u;
+        __m256 age = _mm256_add_ps(_mm256_loadu_ps(source + STREAM_AGE * capacity + i), deltaSeconds);
+        __m256 lifetime = _mm256_loadu_ps(source + STREAM_LIFETIME * capacity + i);
+        uint32_t alive = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(age, lifetime, _CMP_LT_OQ))) & valid;
+        if (alive == 0) continue;
+
+        __m256 velocityX = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(source + STREAM_VELOCITY_X * capacity + i), gravityX), dragFactor);
+        __m256 velocityY = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(source + STREAM_VELOCITY_Y * capacity + i), gravityY), dragFactor);
+        __m256 velocityZ = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(source + STREAM_VELOCITY_Z * capacity + i), gravityZ), dragFactor);
+        __m256 positionX = _mm256_add_ps(_mm256_loadu_ps(source + STREAM_POSITION_X * capacity + i), _mm256_mul_ps(velocityX, deltaSeconds));
+        __m256 positionY = _mm256_add_ps(_mm256_loadu_ps(source + STREAM_POSITION_Y * capacity + i), _mm256_mul_ps(velocityY, deltaSeconds));
+        __m256 positionZ = _mm256_add_ps(_mm256_loadu_ps(source + STREAM_POSITION_Z * capacity + i), _mm256_mul_ps(velocityZ, deltaSeconds));
+
+        // Left-pack the survivors and append them
+        const __m256i permutation = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.permutation[alive]));
+        const uint32_t count = table.count[alive];
+        const __m256 values[STREAM_COUNT] = { positionX, positionY, positionZ, velocityX, velocityY, velocityZ, age, lifetime };
+        if (write + 8 <= writeLimit) {
+            for (uint32_t stream = 0; stream < STREAM_COUNT; ++stream) {
+                _mm256_storeu_ps(target + stream * capacity + write, _mm256_permutevar8x32_ps(values[stream], permutation));
+            }
+        } else {
+            // Near the end of this block's output a full store would reach into the next block's
+            const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(count)), laneIndex);
+            for (uint32_t stream = 0; stream < STREAM_COUNT; ++stream) {
+                _mm256_maskstore_ps(target + stream * capacity + write, mask, _mm256_permutevar8x32_ps(values[stream], permutation));
+            }
+        }
+        write += count;
+    }
+    return write - writeOffset;
+}
+#else
+uint32_t ParticleSystem::UpdateRangeSimd(Pool& pool, const Step& step, uint32_t begin, uint32_t end,
+                                         uint32_t writeOffset, uint32_t) const {
+    return UpdateRangeScalar(pool, step, begin, end, writeOffset);
+}
+#endif
+
+uint32_t ParticleSystem::WriteInstances(ParticleType type, ParticleInstance* destination, uint32_t capacity,
+                                        JobSystem* jobs) const {
+    const Pool& pool = m_pools[type];
+    const uint32_t count = (std::min)(pool.count, capacity);
+    if (count == 0) return 0;
+
+    auto writeRange = [&](uint32_t begin, uint32_t end) {
+#if FPSGAME_AVX2
+        if (m_useSimd) {
+            // Whole groups of 8 transpose in registers; the scalar tail uses the same formulas
+            uint32_t simdEnd = begin + ((end - begin) & ~7u);
+            WriteInstanceRangeSimd(pool, destination, begin, simdEnd);
+            WriteInstanceRange(pool, destination, simdEnd, end);
+            return;
+        }
+#endif
+        WriteInstanceRange(pool, destination, begin, end);
+    };
+
+    const uint32_t blocks = (count + INSTANCE_BLOCK - 1) / INSTANCE_BLOCK;
+    if (jobs && jobs->GetThreadCount() > 1 && blocks > 1) {
+        jobs->ParallelFor(blocks, 1, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t block = begin; block < end; ++block) {
+                uint32_t first = static_cast<uint32_t>(block) * INSTANCE_BLOCK;
+                writeRange(first, (std::min)(first + INSTANCE_BLOCK, count));
+            }
+        });
+    } else {
+        writeRange(0, count);
+    }
+    return count;
+}
+
+void ParticleSystem::WriteInstanceRange(const Pool& pool, ParticleInstance* destination, uint32_t begin,
+                                        uint32_t end) const {
+    const TypeSettings& settings = pool.settings;
+    const size_t capacity = pool.capacity;
+    const float* streams = pool.Streams(pool.front);
+    const float sizeRange = settings.endSize - settings.startSize;
+    const Float4 colorRange = { settings.endColor.x - settings.startColor.x, settings.endColor.y - settings.startColor.y,
+                                settings.endColor.z - settings.startColor.z, settings.endColor.w - settings.startColor.w };
+
+    for (uint32_t i = begin; i < end; ++i) {
+        float t = streams[STREAM_AGE * capacity + i] / streams[STREAM_LIFETIME * capacity + i];
+        ParticleInstance& instance = destination[i];
+        instance.position = { streams[STREAM_POSITION_X * capacity + i], streams[STREAM_POSITION_Y * capacity + i],
+                              streams[STREAM_POSITION_Z * capacity + i] };
+        instance.size = settings.startSize + sizeRange * t;
+        instance.color = { settings.startColor.x + colorRange.x * t, settings.startColor.y + colorRange.y * t,
+                           settings.startColor.z + colorRange.z * t, settings.startColor.w + colorRange.w * t };
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void ParticleSystem::WriteInstanceRangeSimd(const Pool& pool, ParticleInstance* destination, uint32_t begin,
+                                            uint32_t end) const {
+    const TypeSettings& settings = pool.settings;
+    const size_t capacity = pool.capacity;
+    const float* streams = pool.Streams(pool.front);
+    const __m256 startSize = _mm256_set1_ps(settings.startSize);
+    const __m256 sizeRange = _mm256_set1_ps(settings.endSize - settings.startSize);
+    const __m256 startColor[4] = { _mm256_set1_ps(settings.startColor.x), _mm256_set1_ps(settings.startColor.y),
+                                   _mm256_set1_ps(settings.startColor.z), _mm256_set1_ps(settings.startColor.w) };
+    const __m256 colorRange[4] = { _mm256_set1_ps(settings.endColor.x - settings.startColor.x),
+                                   _mm256_set1_ps(settings.endColor.y - settings.startColor.y),
+                                   _mm256_set1_ps(settings.endColor.z - settings.startColor.z),
+                                   _mm256_set1_ps(settings.endColor.w - settings.startColor.w) };
+
+    for (uint32_t i = begin; i < end; i += 8) {
+        __m256 t = _mm256_div_ps(_mm256_loadu_ps(streams + STREAM_AGE * capacity + i),
+                                 _mm256_loadu_ps(streams + STREAM_LIFETIME * capacity + i));
+        __m256 c0 = _mm256_loadu_ps(streams + STREAM_POSITION_X * capacity + i);
+        __m256 c1 = _mm256_loadu_ps(streams + STREAM_POSITION_Y * capacity + i);
+        __m256 c2 = _mm256_loadu_ps(streams + STREAM_POSITION_Z * capacity + i);
+        __m256 c3 = _mm256_add_ps(startSize, _mm256_mul_ps(sizeRange, t));
+        __m256 c4 = _mm256_add_ps(startColor[0], _mm256_mul_ps(colorRange[0], t));
+        __m256 c5 = _mm256_add_ps(startColor[1], _mm256_mul_ps(colorRange[1], t));
+        __m256 c6 = _mm256_add_ps(startColor[2], _mm256_mul_ps(colorRange[2], t));
+        __m256 c7 = _mm256_add_ps(startColor[3], _mm256_mul_ps(colorRange[3], t));
+
+        // 8x8 transpose: column k holds field k of 8 particles, row k becomes instance k
+        __m256 t0 = _mm256_unpacklo_ps(c0, c1), t1 = _mm256_unpackhi_ps(c0, c1);
+        __m256 t2 = _mm256_unpacklo_ps(c2, c3), t3 = _mm256_unpackhi_ps(c2, c3);
+        __m256 t4 = _mm256_unpacklo_ps(c4, c5), t5 = _mm256_unpackhi_ps(c4, c5);
+        __m256 t6 = _mm256_unpacklo_ps(c6, c7), t7 = _mm256_unpackhi_ps(c6, c7);
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        float* out = reinterpret_cast<float*>(destination + i);
+        _mm256_storeu_ps(out + 0, _mm256_permute2f128_ps(s0, s4, 0x20));
+        _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(s1, s5, 0x20));
+        _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(s2, s6, 0x20));
+        _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(s3, s7, 0x20));
+        _mm256_storeu_ps(out + 32, _mm256_permute2f128_ps(s0, s4, 0x31));
+        _mm256_storeu_ps(out + 40, _mm256_permute2f128_ps(s1, s5, 0x31));
+        _mm256_storeu_ps(out + 48, _mm256_permute2f128_ps(s2, s6, 0x31));
+        _mm256_storeu_ps(out + 56, _mm256_permute2f128_ps(s3, s7, 0x31));
+    }
+}
+#else
+void ParticleSystem::WriteInstanceRangeSimd(const Pool& pool, ParticleInstance* destination, uint32_t begin,
+                                            uint32_t end) const {
+    WriteInstanceRange(pool, destination, begin, end);
+}
+#endif
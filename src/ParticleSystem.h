@@ -0,0 +1,146 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+#include "MpscQueue.h"
+
+class JobSystem;
+
+// Particle pools; each is drawn with one instanced draw
+enum ParticleType : uint32_t {
+    PARTICLE_MUZZLE_FLASH = 0,
+    PARTICLE_IMPACT = 1,
+    PARTICLE_SMOKE = 2,
+    PARTICLE_TYPE_COUNT
+};
+
+// Per-instance vertex data for a camera-facing quad, 32 bytes
+struct ParticleInstance {
+    Float3 position;
+    float size;
+    Float4 color;
+};
+
+// Particles stored as structure of arrays, one pool per type. Bursts can be
+// emitted from any thread through a lock-free queue and are spawned at the
+// start of the next Update, which integrates, ages and removes dead particles
+// while compacting the arrays. Update and WriteInstances have an AVX2 path
+// (8 particles per step) and a scalar path that evaluate the same expressions,
+// so both give identical results. Large pools are split into blocks on the
+// job system: one pass counts each block's survivors, a second writes them to
+// their final place in the other buffer.
+class ParticleSystem {
+public:
+    struct Burst {
+        ParticleType type;
+        uint32_t count;
+        Float3 position;
+        Float3 direction;   // Normalized; particles leave along it at speed
+        float speed;
+        float spread;       // Random velocity added, as a fraction of speed
+        uint32_t seed;
+    };
+
+    struct TypeSettings {
+        float minLifetime;   // Seconds
+        float maxLifetime;
+        Float3 gravity;      // Acceleration; smoke rises
+        float drag;          // Fraction of velocity lost per second
+        float startSize;     // Quad size over the particle's life
+        float endSize;
+        Float4 startColor;
+        Float4 endColor;
+        bool additive;       // Blend mode the renderer should use
+        uint32_t maxParticles;
+    };
+
+    struct Stats {
+        uint32_t alive;             // All types, after the last Update
+        uint32_t spawned;           // Last Update
+        uint32_t died;
+        uint32_t dropped;           // Over a pool's limit or a full queue, since Initialize
+        double updateMilliseconds;
+    };
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    bool Initialize(uint32_t queueCapacity = DEFAULT_QUEUE_CAPACITY);
+
+    void SetTypeSettings(ParticleType type, const TypeSettings& settings);
+    const TypeSettings& GetTypeSettings(ParticleType type) const { return m_pools[type].settings; }
+
+    // Any thread; false if the queue is full
+    bool Emit(const Burst& burst);
+
+    void Update(float deltaSeconds, JobSystem* jobs = nullptr);
+
+    uint32_t GetCount(ParticleType type) const { return m_pools[type].count; }
+
+    // Fills destination with up to capacity instances of one type, ready for
+    // an instanced draw; returns how many were written
+    uint32_t WriteInstances(ParticleType type, ParticleInstance* destination, uint32_t capacity,
+                            JobSystem* jobs = nullptr) const;
+
+    const Stats& GetStats() const { return m_stats; }
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    // Constants
+    static constexpr uint32_t DEFAULT_QUEUE_CAPACITY = 1024;
+    static constexpr uint32_t DEFAULT_MAX_PARTICLES = 1 << 20;
+
+private:
+    // Streams of one buffer, each capacity floats long
+    enum Stream : uint32_t {
+        STREAM_POSITION_X, STREAM_POSITION_Y, STREAM_POSITION_Z,
+        STREAM_VELOCITY_X, STREAM_VELOCITY_Y, STREAM_VELOCITY_Z,
+        STREAM_AGE, STREAM_LIFETIME,
+        STREAM_COUNT
+    };
+
+    struct Pool {
+        TypeSettings settings;
+        std::vector<float> buffers[2];      // Update reads one and writes the survivors to the other
+        uint32_t front;
+        uint32_t capacity;                  // Per stream, a multiple of 8
+        uint32_t count;
+        std::vector<uint32_t> blockOffsets; // Where each block's survivors go
+
+        float* Streams(uint32_t buffer) { return buffers[buffer].data(); }
+        const float* Streams(uint32_t buffer) const { return buffers[buffer].data(); }
+    };
+
+    // Per-update constants shared by both paths
+    struct Step {
+        float deltaSeconds;
+        float gravityX, gravityY, gravityZ;  // Already scaled by deltaSeconds
+        float dragFactor;
+    };
+
+    Pool m_pools[PARTICLE_TYPE_COUNT];
+    MpscQueue<Burst> m_queue;
+    bool m_useSimd;
+    Stats m_stats;
+    std::atomic<uint32_t> m_rejectedParticles;  // From full-queue Emits, folded into the stats by Update
+
+    void SpawnBurst(const Burst& burst);
+    void Reserve(Pool& pool, uint32_t count);
+    void UpdatePool(Pool& pool, const Step& step, JobSystem* jobs);
+    uint32_t CountSurvivors(const Pool& pool, uint32_t begin, uint32_t end, float deltaSeconds) const;
+    uint32_t UpdateRange(Pool& pool, const Step& step, uint32_t begin, uint32_t end, uint32_t writeOffset,
+                         uint32_t writeLimit) const;
+    uint32_t UpdateRangeScalar(Pool& pool, const Step& step, uint32_t begin, uint32_t end, uint32_t writeOffset) const;
+    uint32_t UpdateRangeSimd(Pool& pool, const Step& step, uint32_t begin, uint32_t end, uint32_t writeOffset,
+                             uint32_t writeLimit) const;
+    void WriteInstanceRange(const Pool& pool, ParticleInstance* destination, uint32_t begin, uint32_t end) const;
+    void WriteInstanceRangeSimd(const Pool& pool, ParticleInstance* destination, uint32_t begin, uint32_t end) const;
+
+    // Constants
+    static constexpr uint32_t PARALLEL_BLOCK = 16384;  // Particles per job; a multiple of 8
+    static constexpr uint32_t INSTANCE_BLOCK = 16384;
+};
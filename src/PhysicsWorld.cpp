@@ -0,0 +1,921 @@
+#include "PhysicsWorld.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+Float3 Add(const Float3& a, const Float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+Float3 Subtract(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+Float3 Scale(const Float3& v, float s) { return { v.x * s, v.y * s, v.z * s }; }
+float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Float3 Cross(const Float3& a, const Float3& b) {
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+float Component(const Float3& v, uint32_t axis) { return axis == 0 ? v.x : (axis == 1 ? v.y : v.z); }
+
+Float3 Normalize(const Float3& v) {
+    float length = std::sqrt(Dot(v, v));
+    return length > 1e-12f ? Scale(v, 1.0f / length) : Float3{ 0.0f, 1.0f, 0.0f };
+}
+
+// Rows of a 3x3 matrix times a column vector
+Float3 Transform(const Float3 rows[3], const Float3& v) {
+    return { Dot(rows[0], v), Dot(rows[1], v), Dot(rows[2], v) };
+}
+
+// World directions of a rotation's local x, y and z axes
+void RotationAxes(const Float4& q, Float3 axes[3]) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    axes[0] = { 1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy) };
+    axes[1] = { 2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx) };
+    axes[2] = { 2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy) };
+}
+
+// A unit vector perpendicular to n, and a third completing the basis
+void TangentBasis(const Float3& n, Float3 tangents[2]) {
+    Float3 other = std::fabs(n.x) < 0.57f ? Float3{ 1.0f, 0.0f, 0.0f } : Float3{ 0.0f, 1.0f, 0.0f };
+    tangents[0] = Normalize(Cross(n, other));
+    tangents[1] = Cross(n, tangents[0]);
+}
+
+uint64_t PairKey(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+uint64_t CellKey(int32_t x, int32_t y, int32_t z) {
+    const uint64_t MASK = (1u << 21) - 1;
+    return ((static_cast<uint64_t>(x) & MASK) << 42) | ((static_cast<uint64_t>(y) & MASK) << 21) |
+           (static_cast<uint64_t>(z) & MASK);
+}
+
+int32_t CellCoordinate(float value, float cellSize) {
+    return static_cast<int32_t>(std::floor(value / cellSize));
+}
+
+// Polygon clipped to dot(p, normal) <= offset; output holds up to count + 1 points
+uint32_t ClipPolygon(const Float3* input, uint32_t count, const Float3& normal, float offset, Float3* output) {
+    uint32_t outputCount = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Float3& current = input[i];
+        const Float3& next = input[(i + 1) % count];
+        float currentDistance = Dot(current, normal) - offset;
+        float nextDistance = Dot(next, normal) - offset;
+        if (currentDistance <= 0.0f) output[outputCount++] = current;
+        if ((currentDistance <= 0.0f) != (nextDistance <= 0.0f)) {
+            float t = currentDistance / (currentDistance - nextDistance);
+            output[outputCount++] = Add(current, Scale(Subtract(next, current), t));
+        }
+    }
+    return outputCount;
+}
+
+// Keeps four of count points that cover the contact area: the deepest, the
+// farthest from it, and the farthest on either side of the line between them
+uint32_t ReduceContacts(Float3* points, float* depths, uint32_t count, const Float3& normal) {
+    if (count <= 4) return count;
+    uint32_t chosen[4];
+    chosen[0] = static_cast<uint32_t>(std::max_element(depths, depths + count) - depths);
+    float best = -1.0f;
+    chosen[1] = chosen[0];
+    for (uint32_t i = 0; i < count; ++i) {
+        Float3 offset = Subtract(points[i], points[chosen[0]]);
+        if (Dot(offset, offset) > best) {
+            best = Dot(offset, offset);
+            chosen[1] = i;
+        }
+    }
+    Float3 edge = Subtract(points[chosen[1]], points[chosen[0]]);
+    float most = 0.0f, least = 0.0f;
+    chosen[2] = chosen[3] = chosen[0];
+    for (uint32_t i = 0; i < count; ++i) {
+        float side = Dot(Cross(edge, Subtract(points[i], points[chosen[0]])), normal);
+        if (side > most) {
+            most = side;
+            chosen[2] = i;
+        }
+        if (side < least) {
+            least = side;
+            chosen[3] = i;
+        }
+    }
+    Float3 keptPoints[4];
+    float keptDepths[4];
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (std::find(chosen, chosen + i, chosen[i]) != chosen + i) continue;
+        keptPoints[kept] = points[chosen[i]];
+        keptDepths[kept++] = depths[chosen[i]];
+    }
+    std::copy(keptPoints, keptPoints + kept, points);
+    std::copy(keptDepths, keptDepths + kept, depths);
+    return kept;
+}
+
+// Runs function(i) for every index, on the job system when there is more than one batch
+template <typename Function>
+void ForEach(JobSystem* jobs, size_t count, size_t batchSize, const Function& function) {
+    if (jobs && count > batchSize) {
+        jobs->ParallelFor(count, batchSize, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t i = begin; i < end; ++i) function(i);
+        });
+    } else {
+        for (size_t i = 0; i < count; ++i) function(i);
+    }
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+PhysicsWorld::PhysicsWorld() :
+    m_maxBodies(0),
+    m_awakeUnsorted(false),
+    m_sleepingCount(0),
+    m_restingDirty(false),
+    m_stats() {
+}
+
+PhysicsWorld::~PhysicsWorld() {
+}
+
+bool PhysicsWorld::Initialize(uint32_t maxBodies) {
+    if (maxBodies == 0 || maxBodies == INVALID_BODY) return false;
+    m_maxBodies = maxBodies;
+    m_bodies.clear();
+    m_bodies.reserve(maxBodies);
+    m_frames.resize(maxBodies);
+    m_boundsMin.resize(maxBodies);
+    m_boundsMax.resize(maxBodies);
+    m_unionParent.resize(maxBodies);
+    m_islandOf.resize(maxBodies);
+    m_awake.clear();
+    m_awake.reserve(maxBodies);
+    m_awakeUnsorted = false;
+    m_sleepingCount = 0;
+    m_manifolds.clear();
+    m_previousManifolds.clear();
+    m_sleepingIslands.clear();
+    m_freeSleepingIslands.clear();
+    m_restingEntries.clear();
+    m_restingDirty = false;
+    m_stats = {};
+    return true;
+}
+
+uint32_t PhysicsWorld::AddBox(const BoxDesc& desc) {
+    if (m_bodies.size() >= m_maxBodies) return INVALID_BODY;
+
+    Body body = {};
+    body.position = desc.position;
+    float length = std::sqrt(desc.orientation.x * desc.orientation.x + desc.orientation.y * desc.orientation.y +
+                             desc.orientation.z * desc.orientation.z + desc.orientation.w * desc.orientation.w);
+    body.orientation = length > 0.0f ? Float4{ desc.orientation.x / length, desc.orientation.y / length,
+                                               desc.orientation.z / length, desc.orientation.w / length }
+                                     : Float4{ 0.0f, 0.0f, 0.0f, 1.0f };
+    body.halfExtents = desc.halfExtents;
+    body.sleepingIsland = INVALID_BODY;
+    if (desc.mass > 0.0f) {
+        // Solid box: I = m / 3 * (b^2 + c^2) with half extents
+        float x2 = desc.halfExtents.x * desc.halfExtents.x;
+        float y2 = desc.halfExtents.y * desc.halfExtents.y;
+        float z2 = desc.halfExtents.z * desc.halfExtents.z;
+        body.inverseMass = 1.0f / desc.mass;
+        body.inverseInertia = { 3.0f / (desc.mass * (y2 + z2)), 3.0f / (desc.mass * (x2 + z2)),
+                                3.0f / (desc.mass * (x2 + y2)) };
+        body.linearVelocity = desc.linearVelocity;
+        body.angularVelocity = desc.angularVelocity;
+        body.state = STATE_AWAKE;
+        m_awake.push_back(static_cast<uint32_t>(m_bodies.size()));
+    } else {
+        body.state = STATE_STATIC;
+        m_restingDirty = true;
+    }
+
+    uint32_t index = static_cast<uint32_t>(m_bodies.size());
+    m_bodies.push_back(body);
+    RefreshFrame(index);
+    ComputeBounds(index);
+    return index;
+}
+
+Float4x4 PhysicsWorld::GetWorldMatrix(uint32_t body) const {
+    const Body& box = m_bodies[body];
+    Float3 axes[3];
+    RotationAxes(box.orientation, axes);
+    Float4x4 world = Float4x4::Identity();
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        world.m[axis][0] = axes[axis].x;
+        world.m[axis][1] = axes[axis].y;
+        world.m[axis][2] = axes[axis].z;
+    }
+    world.m[3][0] = box.position.x;
+    world.m[3][1] = box.position.y;
+    world.m[3][2] = box.position.z;
+    return world;
+}
+
+void PhysicsWorld::RefreshFrame(uint32_t body) {
+    const Body& box = m_bodies[body];
+    Frame& frame = m_frames[body];
+    RotationAxes(box.orientation, frame.axes);
+    // R * diag(inverse inertia) * R^T, where the axes are R's columns
+    for (uint32_t row = 0; row < 3; ++row) {
+        float values[3];
+        for (uint32_t column = 0; column < 3; ++column) {
+            float sum = 0.0f;
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+                sum += Component(box.inverseInertia, axis) * Component(frame.axes[axis], row) *
+                       Component(frame.axes[axis], column);
+            }
+            values[column] = sum;
+        }
+        frame.inverseInertia[row] = { values[0], values[1], values[2] };
+    }
+}
+
+void PhysicsWorld::ComputeBounds(uint32_t body) {
+    const Body& box = m_bodies[body];
+    const Frame& frame = m_frames[body];
+    // Half extent of the rotated box along each world axis
+    Float3 reach;
+    float* extent = &reach.x;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        extent[axis] = BOUNDS_MARGIN;
+        for (uint32_t local = 0; local < 3; ++local) {
+            extent[axis] += std::fabs(Component(frame.axes[local], axis)) * Component(box.halfExtents, local);
+        }
+    }
+    m_boundsMin[body] = Subtract(box.position, reach);
+    m_boundsMax[body] = Add(box.position, reach);
+}
+
+void PhysicsWorld::AddGridEntries(uint32_t body, std::vector<GridEntry>& entries) const {
+    const Float3& low = m_boundsMin[body];
+    const Float3& high = m_boundsMax[body];
+    for (int32_t x = CellCoordinate(low.x, CELL_SIZE); x <= CellCoordinate(high.x, CELL_SIZE); ++x) {
+        for (int32_t y = CellCoordinate(low.y, CELL_SIZE); y <= CellCoordinate(high.y, CELL_SIZE); ++y) {
+            for (int32_t z = CellCoordinate(low.z, CELL_SIZE); z <= CellCoordinate(high.z, CELL_SIZE); ++z) {
+                entries.push_back({ CellKey(x, y, z), body });
+            }
+        }
+    }
+}
+
+void PhysicsWorld::FindPairs() {
+    auto byCell = [](const GridEntry& a, const GridEntry& b) {
+        return a.cell < b.cell || (a.cell == b.cell && a.body < b.body);
+    };
+    auto overlaps = [this](uint32_t a, uint32_t b) {
+        return m_boundsMin[a].x <= m_boundsMax[b].x && m_boundsMin[b].x <= m_boundsMax[a].x &&
+               m_boundsMin[a].y <= m_boundsMax[b].y && m_boundsMin[b].y <= m_boundsMax[a].y &&
+               m_boundsMin[a].z <= m_boundsMax[b].z && m_boundsMin[b].z <= m_boundsMax[a].z;
+    };
+    // Boxes spanning several cells meet in each of them; only the cell holding the
+    // minimum corner of their overlap reports the pair
+    auto homeCell = [this](uint32_t a, uint32_t b) {
+        return CellKey(CellCoordinate((std::max)(m_boundsMin[a].x, m_boundsMin[b].x), CELL_SIZE),
+                       CellCoordinate((std::max)(m_boundsMin[a].y, m_boundsMin[b].y), CELL_SIZE),
+                       CellCoordinate((std::max)(m_boundsMin[a].z, m_boundsMin[b].z), CELL_SIZE));
+    };
+
+    if (m_restingDirty) {
+        m_restingEntries.clear();
+        for (uint32_t body = 0; body < m_bodies.size(); ++body) {
+            if (m_bodies[body].state != STATE_AWAKE) AddGridEntries(body, m_restingEntries);
+        }
+        std::sort(m_restingEntries.begin(), m_restingEntries.end(), byCell);
+        m_restingDirty = false;
+    }
+
+    m_awakeEntries.clear();
+    for (uint32_t body : m_awake) {
+        AddGridEntries(body, m_awakeEntries);
+    }
+    std::sort(m_awakeEntries.begin(), m_awakeEntries.end(), byCell);
+
+    m_pairs.clear();
+    for (size_t first = 0; first < m_awakeEntries.size();) {
+        uint64_t cell = m_awakeEntries[first].cell;
+        size_t last = first + 1;
+        while (last < m_awakeEntries.size() && m_awakeEntries[last].cell == cell) ++last;
+
+        for (size_t i = first; i < last; ++i) {
+            uint32_t a = m_awakeEntries[i].body;
+            for (size_t j = i + 1; j < last; ++j) {
+                uint32_t b = m_awakeEntries[j].body;
+                if (overlaps(a, b) && homeCell(a, b) == cell) m_pairs.push_back(PairKey(a, b));
+            }
+        }
+
+        auto resting = std::lower_bound(m_restingEntries.begin(), m_restingEntries.end(), GridEntry{ cell, 0 }, byCell);
+        for (; resting != m_restingEntries.end() && resting->cell == cell; ++resting) {
+            for (size_t i = first; i < last; ++i) {
+                uint32_t a = m_awakeEntries[i].body;
+                uint32_t b = resting->body;
+                if (overlaps(a, b) && homeCell(a, b) == cell) {
+                    m_pairs.push_back(a < b ? PairKey(a, b) : PairKey(b, a));
+                }
+            }
+        }
+        first = last;
+    }
+
+    for (uint32_t body : m_awake) {
+        if (m_boundsMin[body].y <= GROUND_HEIGHT) m_pairs.push_back(PairKey(body, INVALID_BODY));
+    }
+    std::sort(m_pairs.begin(), m_pairs.end());
+}
+
+void PhysicsWorld::Collide(uint64_t pair, Manifold& manifold) const {
+    manifold.key = pair;
+    manifold.a = static_cast<uint32_t>(pair >> 32);
+    manifold.b = static_cast<uint32_t>(pair);
+    manifold.pointCount = 0;
+    if (manifold.b == INVALID_BODY) {
+        CollideGround(manifold.a, manifold);
+    } else {
+        CollideBoxes(manifold.a, manifold.b, manifold);
+    }
+    if (manifold.pointCount == 0) return;
+
+    TangentBasis(manifold.normal, manifold.tangents);
+    const Body& a = m_bodies[manifold.a];
+    const Frame& frame = m_frames[manifold.a];
+    for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+        ContactPoint& point = manifold.points[i];
+        Float3 offset = Subtract(point.position, a.position);
+        point.localA = { Dot(offset, frame.axes[0]), Dot(offset, frame.axes[1]), Dot(offset, frame.axes[2]) };
+        point.normal.impulse = 0.0f;
+        point.tangents[0].impulse = point.tangents[1].impulse = 0.0f;
+    }
+}
+
+void PhysicsWorld::CollideGround(uint32_t body, Manifold& manifold) const {
+    const Body& box = m_bodies[body];
+    const Frame& frame = m_frames[body];
+    Float3 corners[8];
+    float depths[8];
+    uint32_t count = 0;
+    for (uint32_t corner = 0; corner < 8; ++corner) {
+        Float3 point = box.position;
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            float sign = (corner >> axis) & 1 ? 1.0f : -1.0f;
+            point = Add(point, Scale(frame.axes[axis], sign * Component(box.halfExtents, axis)));
+        }
+        float depth = GROUND_HEIGHT - point.y;
+        if (depth >= -CONTACT_MARGIN) {
+            corners[count] = point;
+            depths[count++] = depth;
+        }
+    }
+    manifold.normal = { 0.0f, -1.0f, 0.0f };
+    count = ReduceContacts(corners, depths, count, manifold.normal);
+    for (uint32_t i = 0; i < count; ++i) {
+        manifold.points[i].position = corners[i];
+        manifold.points[i].penetration = depths[i];
+    }
+    manifold.pointCount = count;
+}
+
+void PhysicsWorld::CollideBoxes(uint32_t a, uint32_t b, Manifold& manifold) const {
+    const Body* boxes[2] = { &m_bodies[a], &m_bodies[b] };
+    const Frame* frames[2] = { &m_frames[a], &m_frames[b] };
+    const Float3 delta = Subtract(boxes[1]->position, boxes[0]->position);
+
+    // Separating axis test over both boxes' face normals and the nine edge-pair axes;
+    // the axis of least penetration gives the contact normal
+    float absolute[3][3];
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            absolute[i][j] = std::fabs(Dot(frames[0]->axes[i], frames[1]->axes[j])) + 1e-6f;
+        }
+    }
+    float faceSeparation[2] = { -1e30f, -1e30f };
+    uint32_t faceAxis[2] = { 0, 0 };
+    for (uint32_t i = 0; i < 3; ++i) {
+        float projectionA = Component(boxes[0]->halfExtents, i);
+        float projectionB = 0.0f;
+        for (uint32_t j = 0; j < 3; ++j) projectionB += Component(boxes[1]->halfExtents, j) * absolute[i][j];
+        float separation = std::fabs(Dot(delta, frames[0]->axes[i])) - projectionA - projectionB;
+        if (separation > CONTACT_MARGIN) return;
+        if (separation > faceSeparation[0]) {
+            faceSeparation[0] = separation;
+            faceAxis[0] = i;
+        }
+    }
+    for (uint32_t j = 0; j < 3; ++j) {
+        float projectionA = 0.0f;
+        for (uint32_t i = 0; i < 3; ++i) projectionA += Component(boxes[0]->halfExtents, i) * absolute[i][j];
+        float projectionB = Component(boxes[1]->halfExtents, j);
+        float separation = std::fabs(Dot(delta, frames[1]->axes[j])) - projectionA - projectionB;
+        if (separation > CONTACT_MARGIN) return;
+        if (separation > faceSeparation[1]) {
+            faceSeparation[1] = separation;
+            faceAxis[1] = j;
+        }
+    }
+    float edgeSeparation = -1e30f;
+    uint32_t edgeAxes[2] = { 0, 0 };
+    Float3 edgeNormal = { 0.0f, 1.0f, 0.0f };
+    for (uint32_t i = 0; i < 3; ++i) {
+        for (uint32_t j = 0; j < 3; ++j) {
+            Float3 axis = Cross(frames[0]->axes[i], frames[1]->axes[j]);
+            float length = std::sqrt(Dot(axis, axis));
+            if (length < 1e-4f) continue;  // Parallel edges; the face axes cover them
+            axis = Scale(axis, 1.0f / length);
+            float projection = 0.0f;
+            for (uint32_t k = 0; k < 3; ++k) {
+                projection += Component(boxes[0]->halfExtents, k) * std::fabs(Dot(frames[0]->axes[k], axis)) +
+                              Component(boxes[1]->halfExtents, k) * std::fabs(Dot(frames[1]->axes[k], axis));
+            }
+            float separation = std::fabs(Dot(delta, axis)) - projection;
+            if (separation > CONTACT_MARGIN) return;
+            if (separation > edgeSeparation) {
+                edgeSeparation = separation;
+                edgeAxes[0] = i;
+                edgeAxes[1] = j;
+                edgeNormal = Dot(delta, axis) < 0.0f ? Scale(axis, -1.0f) : axis;
+            }
+        }
+    }
+
+    // Faces are preferred unless an edge axis separates clearly more, so the choice does not flicker
+    const float RELATIVE_TOLERANCE = 0.95f;
+    const float ABSOLUTE_TOLERANCE = 0.005f;
+    uint32_t reference = faceSeparation[1] > RELATIVE_TOLERANCE * faceSeparation[0] + ABSOLUTE_TOLERANCE ? 1 : 0;
+    float bestFace = faceSeparation[reference];
+    if (edgeSeparation > RELATIVE_TOLERANCE * bestFace + ABSOLUTE_TOLERANCE) {
+        // Closest points between the two edges nearest each other along the normal
+        Float3 points[2];
+        const Float3 towards[2] = { edgeNormal, Scale(edgeNormal, -1.0f) };
+        for (uint32_t box = 0; box < 2; ++box) {
+            points[box] = boxes[box]->position;
+            for (uint32_t k = 0; k < 3; ++k) {
+                if (k == edgeAxes[box]) continue;
+                float sign = Dot(frames[box]->axes[k], towards[box]) > 0.0f ? 1.0f : -1.0f;
+                points[box] = Add(points[box], Scale(frames[box]->axes[k], sign * Component(boxes[box]->halfExtents, k)));
+            }
+        }
+        const Float3& directionA = frames[0]->axes[edgeAxes[0]];
+        const Float3& directionB = frames[1]->axes[edgeAxes[1]];
+        Float3 between = Subtract(points[0], points[1]);
+        float cosine = Dot(directionA, directionB);
+        float alongA = Dot(directionA, between);
+        float alongB = Dot(directionB, between);
+        float denominator = 1.0f - cosine * cosine;
+        float s = denominator > 1e-6f ? (cosine * alongB - alongA) / denominator : 0.0f;
+        float t = denominator > 1e-6f ? (alongB - cosine * alongA) / denominator : 0.0f;
+        float extentA = Component(boxes[0]->halfExtents, edgeAxes[0]);
+        float extentB = Component(boxes[1]->halfExtents, edgeAxes[1]);
+        s = (std::max)(-extentA, (std::min)(extentA, s));
+        t = (std::max)(-extentB, (std::min)(extentB, t));
+        Float3 closestA = Add(points[0], Scale(directionA, s));
+        Float3 closestB = Add(points[1], Scale(directionB, t));
+        manifold.normal = edgeNormal;
+        manifold.points[0].position = Scale(Add(closestA, closestB), 0.5f);
+        manifold.points[0].penetration = -edgeSeparation;
+        manifold.pointCount = 1;
+        return;
+    }
+
+    // Face contact: clip the incident face of the other box against the reference face's sides
+    const uint32_t incident = 1 - reference;
+    const Body& referenceBox = *boxes[reference];
+    const Frame& referenceFrame = *frames[reference];
+    const Body& incidentBox = *boxes[incident];
+    const Frame& incidentFrame = *frames[incident];
+    const uint32_t axis = faceAxis[reference];
+    Float3 toIncident = Subtract(incidentBox.position, referenceBox.position);
+    Float3 referenceNormal = referenceFrame.axes[axis];
+    if (Dot(toIncident, referenceNormal) < 0.0f) referenceNormal = Scale(referenceNormal, -1.0f);
+
+    uint32_t incidentAxis = 0;
+    float mostAligned = -1.0f;
+    for (uint32_t j = 0; j < 3; ++j) {
+        float alignment = std::fabs(Dot(incidentFrame.axes[j], referenceNormal));
+        if (alignment > mostAligned) {
+            mostAligned = alignment;
+            incidentAxis = j;
+        }
+    }
+    float incidentSign = Dot(incidentFrame.axes[incidentAxis], referenceNormal) > 0.0f ? -1.0f : 1.0f;
+    Float3 incidentCenter = Add(incidentBox.position, Scale(incidentFrame.axes[incidentAxis],
+                                                           incidentSign * Component(incidentBox.halfExtents, incidentAxis)));
+    uint32_t side1 = (incidentAxis + 1) % 3, side2 = (incidentAxis + 2) % 3;
+    Float3 u = Scale(incidentFrame.axes[side1], Component(incidentBox.halfExtents, side1));
+    Float3 v = Scale(incidentFrame.axes[side2], Component(incidentBox.halfExtents, side2));
+    Float3 polygon[8] = { Add(Add(incidentCenter, u), v), Add(Subtract(incidentCenter, u), v),
+                          Subtract(Subtract(incidentCenter, u), v), Subtract(Add(incidentCenter, u), v) };
+    uint32_t count = 4;
+
+    Float3 referenceCenter = Add(referenceBox.position, Scale(referenceNormal, Component(referenceBox.halfExtents, axis)));
+    Float3 clipped[8];
+    for (uint32_t k = 1; k < 3; ++k) {
+        uint32_t sideAxis = (axis + k) % 3;
+        const Float3& direction = referenceFrame.axes[sideAxis];
+        float offset = Dot(referenceCenter, direction);
+        float extent = Component(referenceBox.halfExtents, sideAxis);
+        count = ClipPolygon(polygon, count, direction, offset + extent, clipped);
+        count = ClipPolygon(clipped, count, Scale(direction, -1.0f), extent - offset, polygon);
+        if (count == 0) return;
+    }
+
+    float depths[8];
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        float depth = -Dot(Subtract(polygon[i], referenceCenter), referenceNormal);
+        if (depth >= -CONTACT_MARGIN) {
+            // Halfway between the two surfaces
+            polygon[kept] = Add(polygon[i], Scale(referenceNormal, depth * 0.5f));
+            depths[kept++] = depth;
+        }
+    }
+    manifold.normal = reference == 0 ? referenceNormal : Scale(referenceNormal, -1.0f);
+    kept = ReduceContacts(polygon, depths, kept, referenceNormal);
+    for (uint32_t i = 0; i < kept; ++i) {
+        manifold.points[i].position = polygon[i];
+        manifold.points[i].penetration = depths[i];
+    }
+    manifold.pointCount = kept;
+}
+
+void PhysicsWorld::WarmStartFromPrevious(Manifold& manifold) const {
+    auto previous = std::lower_bound(m_previousManifolds.begin(), m_previousManifolds.end(), manifold.key,
+                                     [](const Manifold& m, uint64_t key) { return m.key < key; });
+    if (previous == m_previousManifolds.end() || previous->key != manifold.key) return;
+
+    for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+        ContactPoint& point = manifold.points[i];
+        float closest = MATCH_DISTANCE * MATCH_DISTANCE;
+        for (uint32_t j = 0; j < previous->pointCount; ++j) {
+            Float3 offset = Subtract(point.localA, previous->points[j].localA);
+            float distance = Dot(offset, offset);
+            if (distance < closest) {
+                closest = distance;
+                point.normal.impulse = previous->points[j].normal.impulse;
+                point.tangents[0].impulse = previous->points[j].tangents[0].impulse;
+                point.tangents[1].impulse = previous->points[j].tangents[1].impulse;
+            }
+        }
+    }
+}
+
+void PhysicsWorld::Step(float deltaSeconds, JobSystem* jobs) {
+    auto stepStart = std::chrono::steady_clock::now();
+    if (deltaSeconds <= 0.0f) return;
+
+    // Islands and their manifolds are laid out in body order
+    if (m_awakeUnsorted) {
+        std::sort(m_awake.begin(), m_awake.end());
+        m_awakeUnsorted = false;
+    }
+    ForEach(jobs, m_awake.size(), BODIES_PER_BATCH, [this](size_t i) {
+        RefreshFrame(m_awake[i]);
+        ComputeBounds(m_awake[i]);
+    });
+    FindPairs();
+    m_stats.broadphaseMilliseconds = MillisecondsSince(stepStart);
+
+    auto narrowStart = std::chrono::steady_clock::now();
+    m_manifolds.resize(m_pairs.size());
+    ForEach(jobs, m_pairs.size(), PAIRS_PER_BATCH, [this](size_t i) {
+        Collide(m_pairs[i], m_manifolds[i]);
+        WarmStartFromPrevious(m_manifolds[i]);
+    });
+    m_manifolds.erase(std::remove_if(m_manifolds.begin(), m_manifolds.end(),
+                                     [](const Manifold& m) { return m.pointCount == 0; }),
+                      m_manifolds.end());
+
+    // Touched sleepers wake after this step; until then they hold still like static boxes
+    m_wakeList.clear();
+    uint32_t contacts = 0;
+    for (const Manifold& manifold : m_manifolds) {
+        contacts += manifold.pointCount;
+        if (m_bodies[manifold.a].state == STATE_SLEEPING) m_wakeList.push_back(manifold.a);
+        if (manifold.b != INVALID_BODY && m_bodies[manifold.b].state == STATE_SLEEPING) m_wakeList.push_back(manifold.b);
+    }
+    m_stats.narrowphaseMilliseconds = MillisecondsSince(narrowStart);
+
+    auto solveStart = std::chrono::steady_clock::now();
+    BuildIslands();
+    if (jobs && m_islands.size() > 1) {
+        jobs->ParallelFor(m_islands.size(), 1, [&](size_t begin, size_t end, uint32_t) {
+            for (size_t i = begin; i < end; ++i) SolveIsland(m_islands[i], deltaSeconds);
+        });
+    } else {
+        for (Island& island : m_islands) SolveIsland(island, deltaSeconds);
+    }
+
+    uint32_t largestIsland = 0;
+    bool anyAsleep = false;
+    for (const Island& island : m_islands) {
+        largestIsland = (std::max)(largestIsland, island.bodyCount);
+        if (island.fallsAsleep) {
+            PutIslandToSleep(island);
+            anyAsleep = true;
+        }
+    }
+    if (anyAsleep) {
+        m_awake.erase(std::remove_if(m_awake.begin(), m_awake.end(),
+                                     [this](uint32_t body) { return m_bodies[body].state != STATE_AWAKE; }),
+                      m_awake.end());
+    }
+    for (uint32_t body : m_wakeList) {
+        WakeIsland(body);
+    }
+    m_previousManifolds.swap(m_manifolds);
+    m_stats.solveMilliseconds = MillisecondsSince(solveStart);
+
+    m_stats.awakeBodies = static_cast<uint32_t>(m_awake.size());
+    m_stats.sleepingBodies = m_sleepingCount;
+    m_stats.pairs = static_cast<uint32_t>(m_pairs.size());
+    m_stats.contacts = contacts;
+    m_stats.islands = static_cast<uint32_t>(m_islands.size());
+    m_stats.largestIsland = largestIsland;
+    m_stats.stepMilliseconds = MillisecondsSince(stepStart);
+}
+
+uint32_t PhysicsWorld::FindRoot(uint32_t body) {
+    while (m_unionParent[body] != body) {
+        m_unionParent[body] = m_unionParent[m_unionParent[body]];  // Path halving
+        body = m_unionParent[body];
+    }
+    return body;
+}
+
+void PhysicsWorld::BuildIslands() {
+    // Union awake bodies through their contacts; static, sleeping and ground contacts do not join islands
+    for (uint32_t body : m_awake) {
+        m_unionParent[body] = body;
+        m_islandOf[body] = INVALID_BODY;
+    }
+    for (const Manifold& manifold : m_manifolds) {
+        if (manifold.b == INVALID_BODY) continue;
+        if (m_bodies[manifold.a].state != STATE_AWAKE || m_bodies[manifold.b].state != STATE_AWAKE) continue;
+        uint32_t rootA = FindRoot(manifold.a), rootB = FindRoot(manifold.b);
+        if (rootA != rootB) m_unionParent[(std::max)(rootA, rootB)] = (std::min)(rootA, rootB);
+    }
+
+    // Number islands in order of their lowest body, then lay bodies and manifolds out island by island
+    m_islands.clear();
+    for (uint32_t body : m_awake) {
+        uint32_t root = FindRoot(body);
+        if (m_islandOf[root] == INVALID_BODY) {
+            m_islandOf[root] = static_cast<uint32_t>(m_islands.size());
+            m_islands.push_back({ 0, 0, 0, 0, false });
+        }
+        m_islandOf[body] = m_islandOf[root];
+        m_islands[m_islandOf[body]].bodyCount++;
+    }
+    auto manifoldIsland = [this](const Manifold& manifold) {
+        return m_bodies[manifold.a].state == STATE_AWAKE ? m_islandOf[manifold.a] : m_islandOf[manifold.b];
+    };
+    for (const Manifold& manifold : m_manifolds) {
+        m_islands[manifoldIsland(manifold)].manifoldCount++;
+    }
+    uint32_t bodyOffset = 0, manifoldOffset = 0;
+    for (Island& island : m_islands) {
+        island.firstBody = bodyOffset;
+        island.firstManifold = manifoldOffset;
+        bodyOffset += island.bodyCount;
+        manifoldOffset += island.manifoldCount;
+        island.bodyCount = 0;
+        island.manifoldCount = 0;
+    }
+    m_islandBodies.resize(bodyOffset);
+    m_islandManifolds.resize(manifoldOffset);
+    for (uint32_t body : m_awake) {
+        Island& island = m_islands[m_islandOf[body]];
+        m_islandBodies[island.firstBody + island.bodyCount++] = body;
+    }
+    for (uint32_t i = 0; i < m_manifolds.size(); ++i) {
+        Island& island = m_islands[manifoldIsland(m_manifolds[i])];
+        m_islandManifolds[island.firstManifold + island.manifoldCount++] = i;
+    }
+}
+
+void PhysicsWorld::SolveIsland(Island& island, float deltaSeconds) {
+    const uint32_t* bodies = &m_islandBodies[island.firstBody];
+    const uint32_t* manifolds = &m_islandManifolds[island.firstManifold];
+
+    // Gravity and damping
+    float linearDamping = 1.0f / (1.0f + deltaSeconds * LINEAR_DAMPING);
+    float angularDamping = 1.0f / (1.0f + deltaSeconds * ANGULAR_DAMPING);
+    for (uint32_t i = 0; i < island.bodyCount; ++i) {
+        Body& body = m_bodies[bodies[i]];
+        body.linearVelocity.y += GRAVITY * deltaSeconds;
+        body.linearVelocity = Scale(body.linearVelocity, linearDamping);
+        body.angularVelocity = Scale(body.angularVelocity, angularDamping);
+    }
+
+    // Bodies outside the island (static, sleeping or the ground) act with infinite mass;
+    // they share this still velocity so nothing outside the island is written
+    Float3 still[2] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    const Float3 noInertia[3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    struct SolverBody {
+        Float3* linear;
+        Float3* angular;
+        float inverseMass;
+        const Float3* inverseInertia;
+    };
+    auto solverBody = [&](uint32_t index) -> SolverBody {
+        if (index != INVALID_BODY && m_bodies[index].state == STATE_AWAKE) {
+            Body& body = m_bodies[index];
+            return { &body.linearVelocity, &body.angularVelocity, body.inverseMass, m_frames[index].inverseInertia };
+        }
+        return { &still[0], &still[1], 0.0f, noInertia };
+    };
+    auto applyImpulse = [](SolverBody& a, SolverBody& b, const ContactRow& row, const Float3& direction, float impulse) {
+        *a.linear = Subtract(*a.linear, Scale(direction, impulse * a.inverseMass));
+        *a.angular = Subtract(*a.angular, Scale(row.turnA, impulse));
+        *b.linear = Add(*b.linear, Scale(direction, impulse * b.inverseMass));
+        *b.angular = Add(*b.angular, Scale(row.turnB, impulse));
+    };
+    // Separating speed along the row's direction
+    auto relativeSpeed = [](const SolverBody& a, const SolverBody& b, const ContactRow& row, const Float3& direction) {
+        return Dot(direction, Subtract(*b.linear, *a.linear)) + Dot(*b.angular, row.angularB) - Dot(*a.angular, row.angularA);
+    };
+
+    // Jacobians, effective masses and position bias, then last step's impulses applied up front
+    for (uint32_t m = 0; m < island.manifoldCount; ++m) {
+        Manifold& manifold = m_manifolds[manifolds[m]];
+        SolverBody a = solverBody(manifold.a);
+        SolverBody b = solverBody(manifold.b);
+        Float3 centerB = manifold.b == INVALID_BODY ? Float3{ 0.0f, 0.0f, 0.0f } : m_bodies[manifold.b].position;
+        const Float3 directions[3] = { manifold.normal, manifold.tangents[0], manifold.tangents[1] };
+        for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+            ContactPoint& point = manifold.points[i];
+            Float3 offsetA = Subtract(point.position, m_bodies[manifold.a].position);
+            Float3 offsetB = Subtract(point.position, centerB);
+            ContactRow* rows[3] = { &point.normal, &point.tangents[0], &point.tangents[1] };
+            for (uint32_t r = 0; r < 3; ++r) {
+                ContactRow& row = *rows[r];
+                row.angularA = Cross(offsetA, directions[r]);
+                row.angularB = Cross(offsetB, directions[r]);
+                row.turnA = Transform(a.inverseInertia, row.angularA);
+                row.turnB = Transform(b.inverseInertia, row.angularB);
+                float mass = a.inverseMass + b.inverseMass + Dot(row.angularA, row.turnA) + Dot(row.angularB, row.turnB);
+                row.mass = mass > 0.0f ? 1.0f / mass : 0.0f;
+                applyImpulse(a, b, row, directions[r], row.impulse);
+            }
+            // Push apart overlap beyond the slop; a speculative gap lets bodies close it in one step
+            if (point.penetration > PENETRATION_SLOP) {
+                point.bias = BAUMGARTE / deltaSeconds * (point.penetration - PENETRATION_SLOP);
+            } else {
+                point.bias = point.penetration < 0.0f ? point.penetration / deltaSeconds : 0.0f;
+            }
+        }
+    }
+
+    for (uint32_t iteration = 0; iteration < VELOCITY_ITERATIONS; ++iteration) {
+        for (uint32_t m = 0; m < island.manifoldCount; ++m) {
+            Manifold& manifold = m_manifolds[manifolds[m]];
+            SolverBody a = solverBody(manifold.a);
+            SolverBody b = solverBody(manifold.b);
+            for (uint32_t i = 0; i < manifold.pointCount; ++i) {
+                ContactPoint& point = manifold.points[i];
+
+                // Friction first, bounded by the current normal impulse
+                float limit = FRICTION * point.normal.impulse;
+                for (uint32_t t = 0; t < 2; ++t) {
+                    ContactRow& row = point.tangents[t];
+                    float speed = relativeSpeed(a, b, row, manifold.tangents[t]);
+                    float accumulated = (std::max)(-limit, (std::min)(limit, row.impulse - row.mass * speed));
+                    applyImpulse(a, b, row, manifold.tangents[t], accumulated - row.impulse);
+                    row.impulse = accumulated;
+                }
+
+                // Non-penetration: the separating speed must reach the bias
+                ContactRow& row = point.normal;
+                float speed = relativeSpeed(a, b, row, manifold.normal);
+                float accumulated = (std::max)(0.0f, row.impulse + row.mass * (point.bias - speed));
+                applyImpulse(a, b, row, manifold.normal, accumulated - row.impulse);
+                row.impulse = accumulated;
+            }
+        }
+    }
+
+    // Integrate positions and track how long every body has been still
+    float stillSeconds = 1e30f;
+    for (uint32_t i = 0; i < island.bodyCount; ++i) {
+        Body& body = m_bodies[bodies[i]];
+        body.position = Add(body.position, Scale(body.linearVelocity, deltaSeconds));
+        const Float3& w = body.angularVelocity;
+        Float4& q = body.orientation;
+        float h = 0.5f * deltaSeconds;
+        Float4 spin = { h * (w.x * q.w + w.y * q.z - w.z * q.y), h * (w.y * q.w + w.z * q.x - w.x * q.z),
+                        h * (w.z * q.w + w.x * q.y - w.y * q.x), h * -(w.x * q.x + w.y * q.y + w.z * q.z) };
+        q = { q.x + spin.x, q.y + spin.y, q.z + spin.z, q.w + spin.w };
+        float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q = { q.x / length, q.y / length, q.z / length, q.w / length };
+
+        bool resting = Dot(body.linearVelocity, body.linearVelocity) < SLEEP_LINEAR_SPEED * SLEEP_LINEAR_SPEED &&
+                       Dot(w, w) < SLEEP_ANGULAR_SPEED * SLEEP_ANGULAR_SPEED;
+        body.sleepSeconds = resting ? body.sleepSeconds + deltaSeconds : 0.0f;
+        stillSeconds = (std::min)(stillSeconds, body.sleepSeconds);
+    }
+    island.fallsAsleep = stillSeconds >= SLEEP_SECONDS;
+}
+
+void PhysicsWorld::PutIslandToSleep(const Island& island) {
+    uint32_t index;
+    if (!m_freeSleepingIslands.empty()) {
+        index = m_freeSleepingIslands.back();
+        m_freeSleepingIslands.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_sleepingIslands.size());
+        m_sleepingIslands.emplace_back();
+    }
+    std::vector<uint32_t>& members = m_sleepingIslands[index];
+    members.assign(m_islandBodies.begin() + island.firstBody, m_islandBodies.begin() + island.firstBody + island.bodyCount);
+    for (uint32_t body : members) {
+        Body& sleeper = m_bodies[body];
+        sleeper.state = STATE_SLEEPING;
+        sleeper.sleepingIsland = index;
+        sleeper.linearVelocity = { 0.0f, 0.0f, 0.0f };
+        sleeper.angularVelocity = { 0.0f, 0.0f, 0.0f };
+        RefreshFrame(body);
+        ComputeBounds(body);
+    }
+    m_sleepingCount += island.bodyCount;
+    m_restingDirty = true;
+}
+
+void PhysicsWorld::WakeIsland(uint32_t body) {
+    if (m_bodies[body].state != STATE_SLEEPING) return;
+    uint32_t index = m_bodies[body].sleepingIsland;
+    for (uint32_t member : m_sleepingIslands[index]) {
+        Body& sleeper = m_bodies[member];
+        sleeper.state = STATE_AWAKE;
+        sleeper.sleepSeconds = 0.0f;
+        sleeper.sleepingIsland = INVALID_BODY;
+    }
+    m_awake.insert(m_awake.end(), m_sleepingIslands[index].begin(), m_sleepingIslands[index].end());
+    m_awakeUnsorted = true;
+    m_sleepingCount -= static_cast<uint32_t>(m_sleepingIslands[index].size());
+    m_sleepingIslands[index].clear();
+    m_freeSleepingIslands.push_back(index);
+    m_restingDirty = true;
+}
+
+void PhysicsWorld::ApplyImpulse(uint32_t body, const Float3& impulse, const Float3& point) {
+    if (m_bodies[body].state == STATE_STATIC) return;
+    WakeIsland(body);
+    Body& target = m_bodies[body];
+    RefreshFrame(body);
+    target.sleepSeconds = 0.0f;
+    target.linearVelocity = Add(target.linearVelocity, Scale(impulse, target.inverseMass));
+    target.angularVelocity = Add(target.angularVelocity,
+                                 Transform(m_frames[body].inverseInertia, Cross(Subtract(point, target.position), impulse)));
+}
+
+bool PhysicsWorld::RayCast(const Float3& origin, const Float3& direction, float maxDistance, RayHit& hit) const {
+    hit.body = INVALID_BODY;
+    hit.distance = maxDistance;
+    for (uint32_t body = 0; body < m_bodies.size(); ++body) {
+        const Body& box = m_bodies[body];
+        Float3 axes[3];
+        RotationAxes(box.orientation, axes);
+
+        // Slab test in the box's space
+        Float3 offset = Subtract(origin, box.position);
+        float enter = 0.0f, exit = hit.distance;
+        uint32_t enterAxis = 0;
+        float enterSign = 1.0f;
+        bool missed = false;
+        for (uint32_t axis = 0; axis < 3 && !missed; ++axis) {
+            float start = Dot(offset, axes[axis]);
+            float speed = Dot(direction, axes[axis]);
+            float extent = Component(box.halfExtents, axis);
+            if (std::fabs(speed) < 1e-8f) {
+                missed = std::fabs(start) > extent;
+                continue;
+            }
+            float near = (-extent - start) / speed, far = (extent - start) / speed;
+            float sign = -1.0f;
+            if (near > far) {
+                std::swap(near, far);
+                sign = 1.0f;
+            }
+            if (near > enter) {
+                enter = near;
+                enterAxis = axis;
+                enterSign = sign;
+            }
+            exit = (std::min)(exit, far);
+            missed = enter > exit;
+        }
+        if (missed || enter >= hit.distance || enter <= 0.0f) continue;
+        hit.body = body;
+        hit.distance = enter;
+        hit.point = Add(origin, Scale(direction, enter));
+        hit.normal = Scale(axes[enterAxis], enterSign);
+    }
+    return hit.body != INVALID_BODY;
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+class JobSystem;
+
+// Rigid boxes on the y = 0 ground plane. Each step integrates gravity, finds
+// overlapping pairs on a uniform grid, builds contact manifolds (separating
+// axis test with face clipping for box pairs), groups touching bodies into
+// islands and solves each island with sequential impulses, warm started from
+// the previous step's contacts. Islands are independent, so they are solved in
+// parallel on the job system, and the result does not depend on thread count.
+//
+// An island whose bodies have all been nearly still for SLEEP_SECONDS falls
+// asleep. Sleeping and static bodies are kept in a separate grid that is only
+// rebuilt when that set changes; they are neither integrated nor tested
+// against each other, so a settled pile costs close to nothing. Touching or
+// pushing a sleeping body wakes its whole island.
+class PhysicsWorld {
+public:
+    struct BoxDesc {
+        Float3 position;
+        Float4 orientation;     // Unit quaternion, xyzw
+        Float3 halfExtents;
+        float mass;             // 0 makes the box static
+        Float3 linearVelocity;
+        Float3 angularVelocity;
+    };
+
+    struct Stats {
+        uint32_t awakeBodies;
+        uint32_t sleepingBodies;   // Not counting static ones
+        uint32_t pairs;
+        uint32_t contacts;
+        uint32_t islands;
+        uint32_t largestIsland;
+        double broadphaseMilliseconds;
+        double narrowphaseMilliseconds;
+        double solveMilliseconds;
+        double stepMilliseconds;
+    };
+
+    struct RayHit {
+        uint32_t body;
+        float distance;
+        Float3 point;
+        Float3 normal;
+    };
+
+    PhysicsWorld();
+    ~PhysicsWorld();
+
+    bool Initialize(uint32_t maxBodies);
+    // Returns the body's index, or INVALID_BODY when the world is full
+    uint32_t AddBox(const BoxDesc& desc);
+
+    void Step(float deltaSeconds, JobSystem* jobs = nullptr);
+
+    // Nearest box along a normalized direction within maxDistance
+    bool RayCast(const Float3& origin, const Float3& direction, float maxDistance, RayHit& hit) const;
+    // Adds an impulse at a world point and wakes the body's island
+    void ApplyImpulse(uint32_t body, const Float3& impulse, const Float3& point);
+
+    uint32_t GetBodyCount() const { return static_cast<uint32_t>(m_bodies.size()); }
+    Float3 GetPosition(uint32_t body) const { return m_bodies[body].position; }
+    Float4 GetOrientation(uint32_t body) const { return m_bodies[body].orientation; }
+    Float3 GetHalfExtents(uint32_t body) const { return m_bodies[body].halfExtents; }
+    bool IsAwake(uint32_t body) const { return m_bodies[body].state == STATE_AWAKE; }
+    // Rotation then translation, as a row-vector matrix
+    Float4x4 GetWorldMatrix(uint32_t body) const;
+    const Stats& GetStats() const { return m_stats; }
+
+    // Constants
+    static constexpr uint32_t INVALID_BODY = 0xFFFFFFFF;
+    static constexpr float GRAVITY = -9.81f;
+    static constexpr float SLEEP_SECONDS = 0.5f;
+
+private:
+    enum State : uint8_t { STATE_AWAKE, STATE_SLEEPING, STATE_STATIC };
+
+    struct Body {
+        Float3 position;
+        Float4 orientation;
+        Float3 linearVelocity;
+        Float3 angularVelocity;
+        Float3 halfExtents;
+        float inverseMass;
+        Float3 inverseInertia;   // Diagonal, in body space
+        float sleepSeconds;      // How long the body has been nearly still
+        uint32_t sleepingIsland; // Index into m_sleepingIslands while asleep
+        State state;
+    };
+
+    // Rotation matrix rows and world-space inverse inertia, refreshed each step for awake bodies
+    struct Frame {
+        Float3 axes[3];
+        Float3 inverseInertia[3];
+    };
+
+    // One direction a contact pushes along, with its Jacobian terms precomputed for the solver
+    struct ContactRow {
+        Float3 angularA;         // Offset from A's center crossed with the direction
+        Float3 angularB;
+        Float3 turnA;            // World inverse inertia times angularA
+        Float3 turnB;
+        float mass;
+        float impulse;           // Accumulated, and carried over to warm start the next step
+    };
+
+    struct ContactPoint {
+        Float3 position;
+        Float3 localA;           // In body A's space, to match points across steps
+        float penetration;
+        float bias;
+        ContactRow normal;
+        ContactRow tangents[2];
+    };
+
+    // Contacts between two bodies, or a body and the ground when b is INVALID_BODY
+    struct Manifold {
+        uint64_t key;            // a and b, for finding last step's manifold
+        uint32_t a;
+        uint32_t b;
+        Float3 normal;           // From a towards b
+        Float3 tangents[2];
+        uint32_t pointCount;
+        ContactPoint points[4];
+
+        // Left uninitialized: the narrowphase writes every manifold it resizes the array for
+        Manifold() {}
+    };
+
+    // A cell a body's box overlaps; sorted by cell so bodies sharing one are adjacent
+    struct GridEntry {
+        uint64_t cell;
+        uint32_t body;
+    };
+
+    struct Island {
+        uint32_t firstBody;      // Into m_islandBodies
+        uint32_t bodyCount;
+        uint32_t firstManifold;  // Into m_islandManifolds
+        uint32_t manifoldCount;
+        bool fallsAsleep;
+    };
+
+    std::vector<Body> m_bodies;
+    std::vector<Frame> m_frames;
+    std::vector<Float3> m_boundsMin;
+    std::vector<Float3> m_boundsMax;
+    uint32_t m_maxBodies;
+
+    // Broadphase. m_awake is kept in body order as islands sleep and wake, so a step
+    // never scans the bodies that are at rest
+    std::vector<uint32_t> m_awake;
+    bool m_awakeUnsorted;          // Woken islands were appended
+    uint32_t m_sleepingCount;
+    std::vector<GridEntry> m_awakeEntries;
+    std::vector<GridEntry> m_restingEntries;   // Sleeping and static bodies
+    bool m_restingDirty;
+    std::vector<uint64_t> m_pairs;             // a << 32 | b with a < b, or b = INVALID_BODY for the ground
+
+    // Contacts, this step's and last step's for warm starting, both sorted by key
+    std::vector<Manifold> m_manifolds;
+    std::vector<Manifold> m_previousManifolds;
+
+    // Islands
+    std::vector<uint32_t> m_unionParent;
+    std::vector<uint32_t> m_islandOf;
+    std::vector<Island> m_islands;
+    std::vector<uint32_t> m_islandBodies;
+    std::vector<uint32_t> m_islandManifolds;
+    std::vector<std::vector<uint32_t>> m_sleepingIslands;
+    std::vector<uint32_t> m_freeSleepingIslands;
+    std::vector<uint32_t> m_wakeList;
+
+    Stats m_stats;
+
+    void RefreshFrame(uint32_t body);
+    void ComputeBounds(uint32_t body);
+    void AddGridEntries(uint32_t body, std::vector<GridEntry>& entries) const;
+    void FindPairs();
+    void Collide(uint64_t pair, Manifold& manifold) const;
+    void CollideGround(uint32_t body, Manifold& manifold) const;
+    void CollideBoxes(uint32_t a, uint32_t b, Manifold& manifold) const;
+    void WarmStartFromPrevious(Manifold& manifold) const;
+    void WakeIsland(uint32_t body);
+    uint32_t FindRoot(uint32_t body);
+    void BuildIslands();
+    void SolveIsland(Island& island, float deltaSeconds);
+    void PutIslandToSleep(const Island& island);
+
+    // Constants
+    static constexpr float GROUND_HEIGHT = 0.0f;
+    static constexpr float CELL_SIZE = 2.0f;
+    static constexpr float BOUNDS_MARGIN = 0.05f;
+    static constexpr float CONTACT_MARGIN = 0.02f;       // Speculative contacts start this far apart
+    static constexpr uint32_t VELOCITY_ITERATIONS = 10;
+    static constexpr float BAUMGARTE = 0.2f;
+    static constexpr float PENETRATION_SLOP = 0.01f;
+    static constexpr float FRICTION = 0.6f;
+    static constexpr float LINEAR_DAMPING = 0.01f;   // Fraction lost per second
+    static constexpr float ANGULAR_DAMPING = 0.05f;
+    static constexpr float SLEEP_LINEAR_SPEED = 0.08f;   // Metres per second
+    static constexpr float SLEEP_ANGULAR_SPEED = 0.1f;   // Radians per second
+    static constexpr float MATCH_DISTANCE = 0.05f;       // Contact points closer than this across steps are the same
+    static constexpr size_t BODIES_PER_BATCH = 256;
+    static constexpr size_t PAIRS_PER_BATCH = 64;
+};
@@ -0,0 +1,365 @@
+#include "RenderCapture.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const uint32_t CAPTURE_MAGIC = 0x50414352;  // "RCAP"
+const uint32_t CAPTURE_VERSION = 1;
+
+enum Opcode : uint8_t {
+    OP_BEGIN_FRAME,
+    OP_END_FRAME,
+    OP_BEGIN_RANGE,
+    OP_END_RANGE,
+    OP_SET_SHADER,
+    OP_SET_MATERIAL,
+    OP_SET_MESH,
+    OP_DRAW_TRANSLATION,  // lod, userData, 3 floats: the translation of an otherwise identity matrix
+    OP_DRAW_AFFINE,     // lod, userData, 12 floats: the first three columns of each row
+    OP_DRAW,            // lod, userData, 16 floats
+    OP_BATCH,           // kind, type, count
+    OP_COUNT
+};
+
+const char* const COMMAND_NAMES[CaptureReplayer::COMMAND_TYPE_COUNT] = {
+    "frame", "range", "setShader", "setMaterial", "setMesh", "draw", "particles", "uiQuads", "lines", "fullscreen"
+};
+
+struct Command {
+    Opcode opcode;
+    uint32_t arguments[3];
+    DrawItem item;          // Draws only; state ids are filled in by the replayer
+};
+
+bool ReadVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        if (cursor == end) return false;
+        uint8_t byte = *cursor++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Advances past one command; false if the stream ends inside it or the opcode is unknown
+bool Decode(const uint8_t*& cursor, const uint8_t* end, Command& command) {
+    if (cursor == end || *cursor >= OP_COUNT) return false;
+    command.opcode = static_cast<Opcode>(*cursor++);
+    switch (command.opcode) {
+        case OP_SET_SHADER:
+        case OP_SET_MATERIAL:
+        case OP_SET_MESH:
+            return ReadVarint(cursor, end, command.arguments[0]);
+
+        case OP_BATCH:
+            return ReadVarint(cursor, end, command.arguments[0]) && command.arguments[0] < CaptureTarget::BATCH_KIND_COUNT &&
+                   ReadVarint(cursor, end, command.arguments[1]) && ReadVarint(cursor, end, command.arguments[2]);
+
+        case OP_DRAW_TRANSLATION:
+        case OP_DRAW_AFFINE:
+        case OP_DRAW: {
+            if (!ReadVarint(cursor, end, command.item.lod) || !ReadVarint(cursor, end, command.item.userData)) return false;
+            bool translation = command.opcode == OP_DRAW_TRANSLATION;
+            bool affine = command.opcode == OP_DRAW_AFFINE;
+            size_t bytes = (translation ? 3 : (affine ? 12 : 16)) * sizeof(float);
+            if (static_cast<size_t>(end - cursor) < bytes) return false;
+            Float4x4& world = command.item.world;
+            if (translation) {
+                world = Float4x4::Identity();
+                memcpy(world.m[3], cursor, bytes);
+            } else if (affine) {
+                for (int row = 0; row < 4; ++row) {
+                    memcpy(world.m[row], cursor + row * 3 * sizeof(float), 3 * sizeof(float));
+                    world.m[row][3] = row == 3 ? 1.0f : 0.0f;
+                }
+            } else {
+                memcpy(world.m, cursor, bytes);
+            }
+            cursor += bytes;
+            return true;
+        }
+
+        default:
+            return true;
+    }
+}
+
+} // namespace
+
+RenderCapture::RenderCapture() :
+    m_frameStart(0),
+    m_frameCount(0),
+    m_maxFrames(0),
+    m_capturing(false),
+    m_inFrame(false) {
+}
+
+RenderCapture::~RenderCapture() {
+}
+
+void RenderCapture::Start(uint32_t maxFrames) {
+    m_bytes.clear();
+    m_frameCount = 0;
+    m_maxFrames = maxFrames;
+    m_capturing = maxFrames > 0;
+    m_inFrame = false;
+}
+
+void RenderCapture::Stop() {
+    // A frame cut short would replay as an unbalanced one
+    if (m_inFrame) {
+        m_bytes.resize(m_frameStart);
+        m_inFrame = false;
+    }
+    m_capturing = false;
+}
+
+void RenderCapture::BeginFrame() {
+    if (!m_capturing || m_inFrame) return;
+    m_frameStart = m_bytes.size();
+    m_inFrame = true;
+    WriteOpcode(OP_BEGIN_FRAME);
+}
+
+void RenderCapture::EndFrame() {
+    if (!IsRecording()) return;
+    WriteOpcode(OP_END_FRAME);
+    m_inFrame = false;
+    if (++m_frameCount >= m_maxFrames) {
+        m_capturing = false;
+    }
+}
+
+void RenderCapture::DrawBatch(BatchKind kind, uint32_t type, uint32_t count) {
+    if (!IsRecording()) return;
+    WriteOpcode(OP_BATCH);
+    WriteVarint(kind);
+    WriteVarint(type);
+    WriteVarint(count);
+}
+
+void RenderCapture::BeginRange() {
+    if (IsRecording()) WriteOpcode(OP_BEGIN_RANGE);
+}
+
+void RenderCapture::EndRange() {
+    if (IsRecording()) WriteOpcode(OP_END_RANGE);
+}
+
+void RenderCapture::SetShader(uint32_t shader) {
+    if (!IsRecording()) return;
+    WriteOpcode(OP_SET_SHADER);
+    WriteVarint(shader);
+}
+
+void RenderCapture::SetMaterial(uint32_t material) {
+    if (!IsRecording()) return;
+    WriteOpcode(OP_SET_MATERIAL);
+    WriteVarint(material);
+}
+
+void RenderCapture::SetMesh(uint32_t mesh) {
+    if (!IsRecording()) return;
+    WriteOpcode(OP_SET_MESH);
+    WriteVarint(mesh);
+}
+
+void RenderCapture::Draw(const DrawItem& item) {
+    if (!IsRecording()) return;
+    const Float4x4& world = item.world;
+    bool affine = world.m[0][3] == 0.0f && world.m[1][3] == 0.0f && world.m[2][3] == 0.0f && world.m[3][3] == 1.0f;
+    bool translation = affine &&
+                       world.m[0][0] == 1.0f && world.m[0][1] == 0.0f && world.m[0][2] == 0.0f &&
+                       world.m[1][0] == 0.0f && world.m[1][1] == 1.0f && world.m[1][2] == 0.0f &&
+                       world.m[2][0] == 0.0f && world.m[2][1] == 0.0f && world.m[2][2] == 1.0f;
+    WriteOpcode(translation ? OP_DRAW_TRANSLATION : (affine ? OP_DRAW_AFFINE : OP_DRAW));
+    WriteVarint(item.lod);
+    WriteVarint(item.userData);
+    if (translation) {
+        WriteFloats(world.m[3], 3);
+    } else if (affine) {
+        for (int row = 0; row < 4; ++row) {
+            WriteFloats(world.m[row], 3);
+        }
+    } else {
+        WriteFloats(&world.m[0][0], 16);
+    }
+}
+
+void RenderCapture::WriteOpcode(uint8_t opcode) {
+    m_bytes.push_back(opcode);
+}
+
+void RenderCapture::WriteVarint(uint32_t value) {
+    while (value >= 0x80) {
+        m_bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    m_bytes.push_back(static_cast<uint8_t>(value));
+}
+
+void RenderCapture::WriteFloats(const float* values, size_t count) {
+    // Little-endian, like every platform we ship
+    size_t offset = m_bytes.size();
+    m_bytes.resize(offset + count * sizeof(float));
+    memcpy(&m_bytes[offset], values, count * sizeof(float));
+}
+
+bool RenderCapture::Save(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    const uint32_t header[3] = { CAPTURE_MAGIC, CAPTURE_VERSION, m_frameCount };
+    bool written = fwrite(header, sizeof(header), 1, file) == 1 &&
+                   (m_bytes.empty() || fwrite(m_bytes.data(), m_bytes.size(), 1, file) == 1);
+    return fclose(file) == 0 && written;
+}
+
+CaptureReplayer::CaptureReplayer() :
+    m_frameCount(0) {
+}
+
+CaptureReplayer::~CaptureReplayer() {
+}
+
+bool CaptureReplayer::Load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return Load(bytes);
+}
+
+bool CaptureReplayer::Load(const std::vector<uint8_t>& bytes) {
+    m_bytes.clear();
+    m_frameCount = 0;
+
+    uint32_t header[3];
+    if (bytes.size() < sizeof(header)) return false;
+    memcpy(header, bytes.data(), sizeof(header));
+    if (header[0] != CAPTURE_MAGIC || header[1] != CAPTURE_VERSION) return false;
+
+    // Every command must decode, and frames must be balanced and complete
+    const uint8_t* cursor = bytes.data() + sizeof(header);
+    const uint8_t* end = bytes.data() + bytes.size();
+    uint32_t frames = 0;
+    bool inFrame = false;
+    Command command;
+    while (cursor != end) {
+        if (!Decode(cursor, end, command)) return false;
+        if (command.opcode == OP_BEGIN_FRAME) {
+            if (inFrame) return false;
+            inFrame = true;
+        } else if (command.opcode == OP_END_FRAME) {
+            if (!inFrame) return false;
+            inFrame = false;
+            frames++;
+        } else if (!inFrame) {
+            return false;
+        }
+    }
+    if (inFrame || frames != header[2]) return false;
+
+    m_bytes.assign(bytes.begin() + sizeof(header), bytes.end());
+    m_frameCount = frames;
+    return true;
+}
+
+CaptureReplayer::Stats CaptureReplayer::Replay(CaptureTarget& target, bool timeCommands) const {
+    using Clock = std::chrono::steady_clock;
+    Stats stats = {};
+
+    // What one pair of clock reads costs, taken off every timed command
+    double clockOverhead = 0.0;
+    if (timeCommands) {
+        const int SAMPLES = 1000;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < SAMPLES; ++i) {
+            Clock::now();
+        }
+        clockOverhead = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / SAMPLES;
+    }
+
+    // Draws take the bound state, as they did when the queue executed
+    DrawItem item = {};
+    const uint8_t* cursor = m_bytes.data();
+    const uint8_t* end = cursor + m_bytes.size();
+    Clock::time_point replayStart = Clock::now();
+    Clock::time_point frameStart = replayStart;
+    Command command;
+    while (cursor != end && Decode(cursor, end, command)) {
+        CommandType type;
+        Clock::time_point commandStart;
+        if (timeCommands) commandStart = Clock::now();
+        switch (command.opcode) {
+            case OP_BEGIN_FRAME:
+                type = COMMAND_FRAME;
+                frameStart = Clock::now();
+                target.BeginFrame();
+                break;
+            case OP_END_FRAME: {
+                type = COMMAND_FRAME;
+                target.EndFrame();
+                double frameMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+                stats.maxFrameMilliseconds = frameMilliseconds > stats.maxFrameMilliseconds ? frameMilliseconds
+                                                                                            : stats.maxFrameMilliseconds;
+                stats.frames++;
+                break;
+            }
+            case OP_BEGIN_RANGE:
+                type = COMMAND_RANGE;
+                target.BeginRange();
+                break;
+            case OP_END_RANGE:
+                type = COMMAND_RANGE;
+                target.EndRange();
+                break;
+            case OP_SET_SHADER:
+                type = COMMAND_SET_SHADER;
+                item.shader = command.arguments[0];
+                target.SetShader(item.shader);
+                break;
+            case OP_SET_MATERIAL:
+                type = COMMAND_SET_MATERIAL;
+                item.material = command.arguments[0];
+                target.SetMaterial(item.material);
+                break;
+            case OP_SET_MESH:
+                type = COMMAND_SET_MESH;
+                item.mesh = command.arguments[0];
+                target.SetMesh(item.mesh);
+                break;
+            case OP_BATCH:
+                type = static_cast<CommandType>(COMMAND_PARTICLES + command.arguments[0]);
+                target.DrawBatch(static_cast<CaptureTarget::BatchKind>(command.arguments[0]), command.arguments[1],
+                                 command.arguments[2]);
+                break;
+            default:
+                type = COMMAND_DRAW;
+                item.world = command.item.world;
+                item.lod = command.item.lod;
+                item.userData = command.item.userData;
+                target.Draw(item);
+                break;
+        }
+        CommandStats& commandStats = stats.commands[type];
+        commandStats.count++;
+        if (timeCommands) {
+            double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - commandStart).count();
+            commandStats.milliseconds += milliseconds > clockOverhead ? milliseconds - clockOverhead : 0.0;
+        }
+    }
+    stats.totalMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - replayStart).count();
+    return stats;
+}
+
+const char* CaptureReplayer::GetCommandName(CommandType type) {
+    return type < COMMAND_TYPE_COUNT ? COMMAND_NAMES[type] : "invalid";
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RenderQueue.h"
+
+// What a captured frame is replayed into: the render queue's state changes
+// and draws, plus batches drawn outside the queue (particles, UI quads,
+// overlay lines, full-screen passes), which are only described by a count
+class CaptureTarget : public RenderBackend {
+public:
+    enum BatchKind : uint32_t {
+        BATCH_PARTICLES,    // type is the particle type, count its instances
+        BATCH_UI_QUADS,
+        BATCH_LINES,
+        BATCH_FULLSCREEN,
+        BATCH_KIND_COUNT
+    };
+
+    virtual void BeginFrame() {}
+    virtual void EndFrame() {}
+    virtual void DrawBatch(BatchKind kind, uint32_t type, uint32_t count) = 0;
+};
+
+// Discards everything, so a replay measures decoding and dispatch alone
+class NullCaptureTarget : public CaptureTarget {
+public:
+    void SetShader(uint32_t) override {}
+    void SetMaterial(uint32_t) override {}
+    void SetMesh(uint32_t) override {}
+    void Draw(const DrawItem&) override {}
+    void DrawBatch(BatchKind, uint32_t, uint32_t) override {}
+};
+
+// Records the command stream a renderer issues, frame by frame, for offline
+// replay. The render queue is captured by executing it into this backend
+// just before the real one, so the stream holds exactly the state changes
+// Execute makes, not the raw queue. Each command is an opcode byte and varint
+// arguments; a draw only carries its LOD, user data and world matrix (3
+// floats for a pure translation, 12 when affine), since shader, material and
+// mesh are the bound state.
+// Commands outside Start..Stop, or outside BeginFrame..EndFrame, are dropped.
+class RenderCapture : public CaptureTarget {
+public:
+    RenderCapture();
+    ~RenderCapture();
+
+    // Discards any earlier capture; recording ends by itself after maxFrames
+    void Start(uint32_t maxFrames = DEFAULT_MAX_FRAMES);
+    void Stop();
+    bool IsCapturing() const { return m_capturing; }
+
+    // CaptureTarget
+    void BeginFrame() override;
+    void EndFrame() override;
+    void DrawBatch(BatchKind kind, uint32_t type, uint32_t count) override;
+    void BeginRange() override;
+    void EndRange() override;
+    void SetShader(uint32_t shader) override;
+    void SetMaterial(uint32_t material) override;
+    void SetMesh(uint32_t mesh) override;
+    void Draw(const DrawItem& item) override;
+
+    uint32_t GetFrameCount() const { return m_frameCount; }
+    const std::vector<uint8_t>& GetBytes() const { return m_bytes; }
+    bool Save(const char* path) const;
+
+    // Constants
+    static constexpr uint32_t DEFAULT_MAX_FRAMES = 600;
+
+private:
+    std::vector<uint8_t> m_bytes;
+    size_t m_frameStart;        // Where the open frame began, to drop it on Stop
+    uint32_t m_frameCount;
+    uint32_t m_maxFrames;
+    bool m_capturing;
+    bool m_inFrame;
+
+    bool IsRecording() const { return m_capturing && m_inFrame; }
+    void WriteOpcode(uint8_t opcode);
+    void WriteVarint(uint32_t value);
+    void WriteFloats(const float* values, size_t count);
+};
+
+// Loads a capture and re-issues it into a target, timing each command type
+class CaptureReplayer {
+public:
+    enum CommandType : uint32_t {
+        COMMAND_FRAME,          // BeginFrame and EndFrame
+        COMMAND_RANGE,          // BeginRange and EndRange
+        COMMAND_SET_SHADER,
+        COMMAND_SET_MATERIAL,
+        COMMAND_SET_MESH,
+        COMMAND_DRAW,
+        COMMAND_PARTICLES,      // Batches, one type per kind
+        COMMAND_UI_QUADS,
+        COMMAND_LINES,
+        COMMAND_FULLSCREEN,
+        COMMAND_TYPE_COUNT
+    };
+
+    struct CommandStats {
+        uint64_t count;
+        double milliseconds;    // Clock overhead subtracted; only with timeCommands
+    };
+
+    struct Stats {
+        uint32_t frames;
+        double totalMilliseconds;
+        double maxFrameMilliseconds;
+        CommandStats commands[COMMAND_TYPE_COUNT];
+    };
+
+    CaptureReplayer();
+    ~CaptureReplayer();
+
+    // Reads and validates the whole file, so Replay never meets a malformed command
+    bool Load(const char* path);
+    bool Load(const std::vector<uint8_t>& bytes);
+
+    // timeCommands reads the clock around every command, which slows the
+    // replay down; frame times are only meaningful without it
+    Stats Replay(CaptureTarget& target, bool timeCommands) const;
+
+    uint32_t GetFrameCount() const { return m_frameCount; }
+    size_t GetByteCount() const { return m_bytes.size(); }
+    static const char* GetCommandName(CommandType type);
+
+private:
+    std::vector<uint8_t> m_bytes;   // Commands only, the header stripped
+    uint32_t m_frameCount;
+};
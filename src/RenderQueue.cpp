@@ -0,0 +1,178 @@
+#include "RenderQueue.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstring>
+
+RenderQueue::RenderQueue() : m_stats() {
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth01) {
+    depth01 = std::max(0.0f, std::min(depth01, 1.0f));
+    uint64_t depth = static_cast<uint64_t>(depth01 * 0xffffff) & 0xffffff;
+
+    uint64_t key = static_cast<uint64_t>(pass & 0xf) << 60;
+    if (pass >= PASS_TRANSLUCENT) {
+        // Farthest first, then state
+        key |= (0xffffff - depth) << 36;
+        key |= static_cast<uint64_t>(shader & 0xff) << 28;
+        key |= static_cast<uint64_t>(material & 0xfff) << 16;
+        key |= static_cast<uint64_t>(mesh & 0xffff);
+    } else {
+        key |= static_cast<uint64_t>(shader & 0xff) << 52;
+        key |= static_cast<uint64_t>(material & 0xfff) << 40;
+        key |= static_cast<uint64_t>(mesh & 0xffff) << 24;
+        key |= depth;
+    }
+    return key;
+}
+
+void RenderQueue::Clear() {
+    m_entries.clear();
+    m_items.clear();
+}
+
+void RenderQueue::Reserve(size_t count) {
+    m_entries.reserve(count);
+    m_scratch.reserve(count);
+    m_items.reserve(count);
+}
+
+void RenderQueue::Submit(uint64_t key, const DrawItem& item) {
+    m_entries.push_back({ key, static_cast<uint32_t>(m_items.size()), 0 });
+    m_items.push_back(item);
+}
+
+void RenderQueue::Resize(size_t count) {
+    m_entries.resize(count);
+    m_items.resize(count);
+}
+
+void RenderQueue::Set(size_t index, uint64_t key, const DrawItem& item) {
+    m_entries[index] = { key, static_cast<uint32_t>(index), 0 };
+    m_items[index] = item;
+}
+
+void RenderQueue::Sort() {
+    RadixSort(m_entries, m_scratch);
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    const size_t count = entries.size();
+    if (count < 2) return;
+    scratch.resize(count);
+
+    // One pass builds the histograms for all eight digits
+    uint32_t histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (const SortEntry& entry : entries) {
+        uint64_t key = entry.key;
+        for (int digit = 0; digit < 8; ++digit) {
+            histograms[digit][(key >> (digit * 8)) & 0xff]++;
+        }
+    }
+
+    SortEntry* source = entries.data();
+    SortEntry* destination = scratch.data();
+
+    for (int digit = 0; digit < 8; ++digit) {
+        uint32_t* histogram = histograms[digit];
+        uint32_t firstKeyDigit = static_cast<uint32_t>((source[0].key >> (digit * 8)) & 0xff);
+        if (histogram[firstKeyDigit] == count) {
+            continue;
+        }
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (int bucket = 0; bucket < 256; ++bucket) {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bucket = static_cast<uint32_t>((source[i].key >> (digit * 8)) & 0xff);
+            destination[offsets[bucket]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != entries.data()) {
+        std::memcpy(entries.data(), source, count * sizeof(SortEntry));
+    }
+}
+
+void RenderQueue::Execute(RenderBackend& backend) {
+    m_stats = {};
+    ExecuteRange(0, m_entries.size(), backend, m_stats);
+}
+
+void RenderQueue::ExecuteParallel(JobSystem& jobs, RenderBackend* const* backends, uint32_t backendCount) {
+    m_stats = {};
+    if (backendCount == 0) return;
+
+    m_partitionStats.assign(backendCount, Stats());
+    jobs.ParallelFor(backendCount, 1, [&](size_t first, size_t last, uint32_t) {
+        for (size_t part = first; part < last; ++part) {
+            size_t begin, end;
+            GetPartition(static_cast<uint32_t>(part), backendCount, begin, end);
+            ExecuteRange(begin, end, *backends[part], m_partitionStats[part]);
+        }
+    });
+
+    for (const Stats& stats : m_partitionStats) {
+        m_stats.draws += stats.draws;
+        m_stats.shaderChanges += stats.shaderChanges;
+        m_stats.materialChanges += stats.materialChanges;
+        m_stats.meshChanges += stats.meshChanges;
+        m_stats.redundantChangesAvoided += stats.redundantChangesAvoided;
+    }
+}
+
+void RenderQueue::GetPartition(uint32_t part, uint32_t partCount, size_t& begin, size_t& end) const {
+    const size_t count = m_entries.size();
+    begin = count * part / partCount;
+    end = count * (part + 1) / partCount;
+}
+
+void RenderQueue::ExecuteRange(size_t begin, size_t end, RenderBackend& backend, Stats& stats) const {
+    // Each range starts from unknown state so it can be recorded independently
+    const uint32_t NONE = 0xffffffffu;
+    uint32_t currentShader = NONE;
+    uint32_t currentMaterial = NONE;
+    uint32_t currentMesh = NONE;
+
+    backend.BeginRange();
+    for (size_t i = begin; i < end; ++i) {
+        const DrawItem& item = m_items[m_entries[i].item];
+
+        if (item.shader != currentShader) {
+            backend.SetShader(item.shader);
+            currentShader = item.shader;
+            stats.shaderChanges++;
+        } else {
+            stats.redundantChangesAvoided++;
+        }
+
+        if (item.material != currentMaterial) {
+            backend.SetMaterial(item.material);
+            currentMaterial = item.material;
+            stats.materialChanges++;
+        } else {
+            stats.redundantChangesAvoided++;
+        }
+
+        if (item.mesh != currentMesh) {
+            backend.SetMesh(item.mesh);
+            currentMesh = item.mesh;
+            stats.meshChanges++;
+        } else {
+            stats.redundantChangesAvoided++;
+        }
+
+        backend.Draw(item);
+        stats.draws++;
+    }
+    backend.EndRange();
+}
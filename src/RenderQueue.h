@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+class JobSystem;
+
+// Everything a backend needs to issue one draw
+struct DrawItem {
+    Float4x4 world;
+    uint32_t shader;
+    uint32_t material;
+    uint32_t mesh;
+    uint32_t lod;       // Index into the mesh's LOD chain; 0 is full detail
+    uint32_t userData;  // Backend-defined, e.g. a constant ring offset
+};
+
+// Receives state changes and draws from RenderQueue::Execute. Calls are only
+// made when the bound state actually differs from the previous draw.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() {}
+
+    // Bracket each contiguous slice of the queue handed to this backend
+    virtual void BeginRange() {}
+    virtual void EndRange() {}
+
+    virtual void SetShader(uint32_t shader) = 0;      // Shaders and input layout
+    virtual void SetMaterial(uint32_t material) = 0;  // Blend state and textures
+    virtual void SetMesh(uint32_t mesh) = 0;          // Vertex and index buffers
+    virtual void Draw(const DrawItem& item) = 0;
+};
+
+// Draw packets tagged with a 64-bit sort key, radix sorted once per frame.
+//
+// Opaque key layout (most significant first):
+//   pass:4 | shader:8 | material:12 | mesh:16 | depth:24 (front to back)
+// Translucent passes move depth above the state bits and invert it so
+// blended geometry is drawn back to front.
+class RenderQueue {
+public:
+    enum Pass : uint32_t {
+        PASS_OPAQUE = 0,
+        PASS_TRANSLUCENT = 8,
+        PASS_OVERLAY = 12
+    };
+
+    struct Stats {
+        uint32_t draws;
+        uint32_t shaderChanges;
+        uint32_t materialChanges;
+        uint32_t meshChanges;
+        uint32_t redundantChangesAvoided;
+    };
+
+    RenderQueue();
+    ~RenderQueue();
+
+    static uint64_t MakeKey(uint32_t pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth01);
+
+    void Clear();
+    void Reserve(size_t count);
+    void Submit(uint64_t key, const DrawItem& item);
+    // Resize then Set lets several threads fill disjoint slots of the queue
+    void Resize(size_t count);
+    void Set(size_t index, uint64_t key, const DrawItem& item);
+    void Sort();
+    void Execute(RenderBackend& backend);
+
+    // Records contiguous slices of the sorted queue into one backend each, in
+    // parallel. Submitting the backends in array order preserves key order.
+    void ExecuteParallel(JobSystem& jobs, RenderBackend* const* backends, uint32_t backendCount);
+    // Slice of the sorted queue handed to backend `part` by ExecuteParallel
+    void GetPartition(uint32_t part, uint32_t partCount, size_t& begin, size_t& end) const;
+
+    size_t GetSize() const { return m_entries.size(); }
+    const DrawItem& GetSortedItem(size_t index) const { return m_items[m_entries[index].item]; }
+    uint64_t GetSortedKey(size_t index) const { return m_entries[index].key; }
+
+    // Stats for the last executed frame
+    const Stats& GetStats() const { return m_stats; }
+
+    struct SortEntry {
+        uint64_t key;
+        uint32_t item;
+        uint32_t padding;
+    };
+
+    // LSD radix sort on 8-bit digits; passes where every key shares the digit are skipped
+    static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+private:
+    std::vector<SortEntry> m_entries;
+    std::vector<SortEntry> m_scratch;
+    std::vector<DrawItem> m_items;
+    std::vector<Stats> m_partitionStats;
+    Stats m_stats;
+
+    void ExecuteRange(size_t begin, size_t end, RenderBackend& backend, Stats& stats) const;
+};
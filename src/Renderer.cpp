@@ -1,29 +1,130 @@
 #include "Renderer.h"
+#include "D3D11VertexLayout.h"
 #include <d3dcompiler.h>
 #include <directxcolors.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
 using namespace DirectX;
 
-Renderer::Renderer() : m_hwnd(nullptr), m_width(0), m_height(0) {}
+namespace {
+
+std::string DescribeFailure(const char* call, HRESULT hr) {
+    char text[128];
+    snprintf(text, sizeof(text), "%s failed (HRESULT 0x%08lX)", call, static_cast<unsigned long>(hr));
+    return text;
+}
+
+// Serves the scene vertex declarations generated from SceneVertexLayout in
+// place of shaders/VertexLayout.hlsli, so a stale copy on disk can never
+// disagree with the input layout
+class VertexLayoutInclude : public ID3DInclude {
+public:
+    VertexLayoutInclude() : m_text(SceneVertexLayout::GetHlslDeclarations()) {}
+
+    HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID, LPCVOID* data, UINT* bytes) override {
+        if (strcmp(fileName, "VertexLayout.hlsli") != 0) return E_FAIL;
+        *data = m_text.data();
+        *bytes = static_cast<UINT>(m_text.size());
+        return S_OK;
+    }
+
+    HRESULT __stdcall Close(LPCVOID) override { return S_OK; }
+
+private:
+    std::string m_text;
+};
+
+// The compiler's own messages say which line is wrong
+std::string DescribeCompileFailure(const char* shader, HRESULT hr, ID3DBlob* errors) {
+    std::string text = DescribeFailure(shader, hr);
+    if (errors) {
+        text += ": ";
+        text.append(static_cast<const char*>(errors->GetBufferPointer()), errors->GetBufferSize());
+    }
+    return text;
+}
+
+} // namespace
+
+Renderer::Renderer() :
+    m_featureLevel(D3D_FEATURE_LEVEL_10_0),
+    m_dynamicResolutionEnabled(false),
+    m_sceneWidth(0),
+    m_sceneHeight(0),
+    m_sceneTimers(),
+    m_sceneTimerFrame(0),
+    m_sceneShader(SHADER_VERTEX_COLOR),
+    m_world(nullptr),
+    m_physics(nullptr),
+    m_firstPhysicsBody(0),
+    m_sceneGraph(nullptr),
+    m_capture(nullptr),
+    m_metrics(nullptr),
+    m_endSceneMetric(MetricsRegistry::INVALID_METRIC),
+    m_particles(nullptr),
+    m_frameView(XMMatrixIdentity()),
+    m_frameProjection(XMMatrixIdentity()),
+    m_recordStats(),
+    m_hwnd(nullptr),
+    m_width(0),
+    m_height(0) {}
 
 Renderer::~Renderer() {}
 
 bool Renderer::Initialize(HWND hwnd, int width, int height) {
+    StartupGraph graph;
+    AddStartupStages(graph, hwnd, width, height);
+    return graph.Run();
+}
+
+Renderer::StartupStages Renderer::AddStartupStages(StartupGraph& graph, HWND hwnd, int width, int height) {
     m_hwnd = hwnd;
     m_width = width;
     m_height = height;
+    m_sceneWidth = width;
+    m_sceneHeight = height;
 
-    if (!InitializeDevice()) return false;
-    if (!InitializeRenderTarget()) return false;
-    if (!InitializeDepthStencil()) return false;
-    if (!InitializeRasterizerState()) return false;
-    if (!InitializeShaders()) return false;
-    if (!InitializeConstantBuffer()) return false;
+    // Slots are filled by whichever stage compiles each shader
+    m_shaders.resize(SHADER_COUNT);
 
-    return true;
+    StartupStages stages;
+    stages.device = graph.AddStage("renderer.device", [this] { return InitializeDevice(); },
+                                   {}, StartupGraph::STAGE_MAIN_THREAD);
+    std::vector<StartupGraph::StageId> parts = {
+        graph.AddStage("renderer.targets", [this] {
+            return InitializeRenderTarget() && InitializeDepthStencil() && InitializeRasterizerState();
+        }, { stages.device }),
+        graph.AddStage("renderer.shaders", [this] { return InitializeShaders(); }, { stages.device }),
+        graph.AddStage("renderer.constants", [this] { return InitializeConstantBuffer(); }, { stages.device }),
+        graph.AddStage("renderer.materials", [this] { return InitializeMaterials(); }, { stages.device }),
+        graph.AddStage("renderer.meshes", [this] { return InitializeMeshes(); }, { stages.device }),
+        graph.AddStage("renderer.recorders", [this] {
+            InitializeRecorders();
+            if (!m_frameArena.Initialize(m_jobSystem.GetThreadCount())) {
+                throw std::runtime_error("Frame arena needs at least one thread");
+            }
+            return true;
+        }, { stages.device }),
+        graph.AddStage("renderer.lighting", [this] { return InitializeLighting(); }, { stages.device }),
+        graph.AddStage("renderer.resolution", [this] { return InitializeDynamicResolution(); }, { stages.device }),
+        graph.AddStage("renderer.particles", [this] { return InitializeParticles(); }, { stages.device }),
+        graph.AddStage("renderer.occlusion", [this] {
+            if (!m_occlusionCuller.Initialize(OCCLUSION_WIDTH, OCCLUSION_HEIGHT)) {
+                throw std::runtime_error("Occlusion buffer size is invalid");
+            }
+            return true;
+        })
+    };
+    stages.ready = graph.AddStage("renderer", nullptr, parts);
+    return stages;
 }
 
 bool Renderer::InitializeDevice() {
@@ -49,28 +150,27 @@ bool Renderer::InitializeDevice() {
     sd.SampleDesc.Quality = 0;
     sd.Windowed = TRUE;
 
-    D3D_FEATURE_LEVEL featureLevel;
-
     HRESULT hr = D3D11CreateDeviceAndSwapChain(
         nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, createDeviceFlags,
         featureLevels, numFeatureLevels, D3D11_SDK_VERSION,
         &sd, m_swapChain.GetAddressOf(),
-        m_device.GetAddressOf(), &featureLevel,
+        m_device.GetAddressOf(), &m_featureLevel,
         m_deviceContext.GetAddressOf()
     );
-
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("D3D11CreateDeviceAndSwapChain", hr));
+    return true;
 }
 
 bool Renderer::InitializeRenderTarget() {
     ComPtr<ID3D11Texture2D> backBuffer;
     HRESULT hr = m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), 
                                        reinterpret_cast<void**>(backBuffer.GetAddressOf()));
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("IDXGISwapChain::GetBuffer", hr));
 
     hr = m_device->CreateRenderTargetView(backBuffer.Get(), nullptr, 
                                         m_renderTargetView.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateRenderTargetView (back buffer)", hr));
+    return true;
 }
 
 bool Renderer::InitializeDepthStencil() {
@@ -88,11 +188,11 @@ bool Renderer::InitializeDepthStencil() {
     ComPtr<ID3D11Texture2D> depthStencilBuffer;
     HRESULT hr = m_device->CreateTexture2D(&depthStencilDesc, nullptr, 
                                           depthStencilBuffer.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateTexture2D (depth stencil)", hr));
 
     hr = m_device->CreateDepthStencilView(depthStencilBuffer.Get(), nullptr, 
                                          m_depthStencilView.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateDepthStencilView", hr));
 
     D3D11_DEPTH_STENCIL_DESC dsDesc = {};
     dsDesc.DepthEnable = true;
@@ -100,7 +200,8 @@ bool Renderer::InitializeDepthStencil() {
     dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
 
     hr = m_device->CreateDepthStencilState(&dsDesc, m_depthStencilState.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateDepthStencilState (scene)", hr));
+    return true;
 }
 
 bool Renderer::InitializeRasterizerState() {
@@ -112,38 +213,38 @@ bool Renderer::InitializeRasterizerState() {
 
     HRESULT hr = m_device->CreateRasterizerState(&rasterizerDesc, 
                                                 m_rasterizerState.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateRasterizerState", hr));
+    return true;
 }
 
 bool Renderer::InitializeShaders() {
     // Note: In a real implementation, we would load and compile shaders from files
     // For this example, we'll use simple hardcoded shaders
-    const char* vsSource = R"(
+    // VertexInput and DecodeVertex are generated from SceneVertexLayout
+    const std::string vsSource = SceneVertexLayout::GetHlslDeclarations() + R"(
         cbuffer ConstantBuffer : register(b0) {
             matrix World;
             matrix View;
             matrix Projection;
         };
         
-        struct VS_INPUT {
-            float4 Pos : POSITION;
-            float4 Color : COLOR;
-        };
-        
         struct VS_OUTPUT {
             float4 Pos : SV_POSITION;
             float4 Color : COLOR;
         };
         
-        VS_OUTPUT main(VS_INPUT input) {
+        VS_OUTPUT main(VertexInput input) {
+            VertexAttributes vertex = DecodeVertex(input);
             VS_OUTPUT output;
-            output.Pos = mul(input.Pos, World);
+            output.Pos = mul(vertex.Position, World);
             output.Pos = mul(output.Pos, View);
             output.Pos = mul(output.Pos, Projection);
-            output.Color = input.Color;
+            output.Color = vertex.Color;
             return output;
         }
     )";
+    static_assert(SceneVertexLayout::Provides<VertexSemantic::Position, VertexSemantic::Color>(),
+                  "The vertex color shader reads position and color");
 
     const char* psSource = R"(
         struct PS_INPUT {
@@ -161,40 +262,39 @@ bool Renderer::InitializeShaders() {
     ComPtr<ID3DBlob> psBlob;
     ComPtr<ID3DBlob> errorBlob;
 
-    HRESULT hr = D3DCompile(vsSource, strlen(vsSource), nullptr, nullptr, nullptr,
+    HRESULT hr = D3DCompile(vsSource.data(), vsSource.size(), nullptr, nullptr, nullptr,
                            "main", "vs_4_0", 0, 0, vsBlob.GetAddressOf(), 
                            errorBlob.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Scene vertex shader", hr, errorBlob.Get()));
 
     hr = D3DCompile(psSource, strlen(psSource), nullptr, nullptr, nullptr,
                     "main", "ps_4_0", 0, 0, psBlob.GetAddressOf(), 
                     errorBlob.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Scene pixel shader", hr, errorBlob.Get()));
 
     // Create shader objects
     hr = m_device->CreateVertexShader(vsBlob->GetBufferPointer(), 
                                      vsBlob->GetBufferSize(), nullptr, 
                                      m_vertexShader.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateVertexShader (scene)", hr));
 
     hr = m_device->CreatePixelShader(psBlob->GetBufferPointer(), 
                                     psBlob->GetBufferSize(), nullptr, 
                                     m_pixelShader.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreatePixelShader (scene)", hr));
 
     // Create input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 
-          D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, 
-          D3D11_INPUT_PER_VERTEX_DATA, 0 }
-    };
+    auto layout = MakeInputElements<SceneVertexLayout>();
 
-    hr = m_device->CreateInputLayout(layout, ARRAYSIZE(layout),
+    hr = m_device->CreateInputLayout(layout.data(), static_cast<UINT>(layout.size()),
                                    vsBlob->GetBufferPointer(),
                                    vsBlob->GetBufferSize(),
                                    m_inputLayout.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateInputLayout (scene)", hr));
+
+    // Register as SHADER_VERTEX_COLOR
+    m_shaders[SHADER_VERTEX_COLOR] = { m_vertexShader, m_pixelShader, m_inputLayout };
+    return true;
 }
 
 bool Renderer::InitializeConstantBuffer() {
@@ -204,22 +304,528 @@ bool Renderer::InitializeConstantBuffer() {
     bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
     HRESULT hr = m_device->CreateBuffer(&bd, nullptr, m_constantBuffer.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (constants)", hr));
+
+    // Optional: without D3D11.1 offsets every draw goes through UpdateSubresource instead
+    m_constantRing.Initialize(m_device.Get(), m_deviceContext.Get(), CONSTANT_RING_SIZE);
+    return true;
+}
+
+bool Renderer::InitializeMaterials() {
+    // MATERIAL_OPAQUE uses the default blend state
+    m_materials.push_back({});
+
+    // MATERIAL_TRANSLUCENT
+    D3D11_BLEND_DESC blendDesc = {};
+    blendDesc.RenderTarget[0].BlendEnable = TRUE;
+    blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+    blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+    blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+    blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+    blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+    Material translucent;
+    HRESULT hr = m_device->CreateBlendState(&blendDesc, translucent.blendState.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBlendState (translucent)", hr));
+    m_materials.push_back(translucent);
+
+    return true;
+}
+
+bool Renderer::InitializeMeshes() {
+    // MESH_FLOOR: 20x20 grey grid on y = 0, matching the GLUT scene
+    const int gridSize = 20;
+    const Float4 floorColor = { 0.5f, 0.5f, 0.5f, 1.0f };
+    std::vector<SceneVertex> vertices;
+    std::vector<UINT> indices;
+
+    for (int z = 0; z <= gridSize; ++z) {
+        for (int x = 0; x <= gridSize; ++x) {
+            SceneVertex vertex;
+            vertex.Set<VertexSemantic::Position>({ static_cast<float>(x - gridSize / 2), 0.0f,
+                                                   static_cast<float>(z - gridSize / 2) });
+            vertex.Set<VertexSemantic::Color>(floorColor);
+            vertex.Set<VertexSemantic::Normal>({ 0.0f, 1.0f, 0.0f });
+            vertices.push_back(vertex);
+        }
+    }
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            UINT corner = z * (gridSize + 1) + x;
+            UINT above = corner + gridSize + 1;
+            // Clockwise when seen from above
+            indices.insert(indices.end(), { corner, above, above + 1, corner, above + 1, corner + 1 });
+        }
+    }
+
+    Mesh floor;
+    CreateMesh("Floor", vertices.data(), static_cast<UINT>(vertices.size()), sizeof(SceneVertex),
+               indices.data(), static_cast<UINT>(indices.size()), floor);
+    m_meshes.push_back(floor);
+
+    // MESH_CUBE: unit cube with one flat color per face
+    struct Face {
+        XMFLOAT3 normal;
+        XMFLOAT4 color;
+    };
+    const Face faces[] = {
+        { XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f) },
+        { XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f) },
+        { XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f) },
+        { XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT4(1.0f, 0.0f, 1.0f, 1.0f) },
+        { XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT4(0.0f, 1.0f, 1.0f, 1.0f) }
+    };
+
+    vertices.clear();
+    indices.clear();
+    for (const Face& face : faces) {
+        // Build the face basis as seen from outside so the winding is clockwise
+        XMVECTOR normal = XMLoadFloat3(&face.normal);
+        XMVECTOR forward = XMVectorNegate(normal);
+        XMVECTOR up = fabsf(face.normal.y) > 0.5f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)
+                                                  : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+        XMVECTOR right = XMVector3Cross(up, forward);
+        XMVECTOR center = XMVectorScale(normal, 0.5f);
+        right = XMVectorScale(right, 0.5f);
+        up = XMVectorScale(up, 0.5f);
+
+        UINT base = static_cast<UINT>(vertices.size());
+        XMVECTOR corners[4] = {
+            center - right - up,
+            center - right + up,
+            center + right + up,
+            center + right - up
+        };
+        SceneVertex vertex;
+        vertex.Set<VertexSemantic::Color>({ face.color.x, face.color.y, face.color.z, face.color.w });
+        vertex.Set<VertexSemantic::Normal>({ face.normal.x, face.normal.y, face.normal.z });
+        for (XMVECTOR corner : corners) {
+            XMFLOAT3 position;
+            XMStoreFloat3(&position, corner);
+            vertex.Set<VertexSemantic::Position>({ position.x, position.y, position.z });
+            vertices.push_back(vertex);
+        }
+        indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+    }
+
+    Mesh cube;
+    CreateMesh("Cube", vertices.data(), static_cast<UINT>(vertices.size()), sizeof(SceneVertex),
+               indices.data(), static_cast<UINT>(indices.size()), cube);
+    m_meshes.push_back(cube);
+
+    m_renderQueue.Reserve(1024);
+    return true;
+}
+
+bool Renderer::InitializeRecorders() {
+    m_recordStats = {};
+
+    // Single-threaded recording still works without workers
+    if (!m_jobSystem.Initialize()) return true;
+
+    // One deferred context per thread that can take part in recording
+    for (uint32_t i = 0; i < m_jobSystem.GetThreadCount(); ++i) {
+        ContextRecorder recorder;
+        HRESULT hr = m_device->CreateDeferredContext(0, recorder.context.GetAddressOf());
+        if (FAILED(hr)) break;
+        recorder.context.As(&recorder.context1);
+        m_deferredRecorders.push_back(recorder);
+    }
+
+    // Fall back to the immediate context rather than record on one deferred context
+    if (m_deferredRecorders.size() < 2) {
+        m_deferredRecorders.clear();
+    }
+    return true;
+}
+
+bool Renderer::InitializeLighting() {
+    // Optional: structured buffers need feature level 11_0, so older devices keep vertex colors.
+    // Past that, a shader that does not compile or a resource that cannot be created fails startup.
+    if (m_featureLevel < D3D_FEATURE_LEVEL_11_0) return true;
+    if (!m_clusteredLighting.Initialize(CLUSTER_TILES_X, CLUSTER_TILES_Y, CLUSTER_SLICES)) return true;
+
+    ComPtr<ID3DBlob> vsBlob;
+    ComPtr<ID3DBlob> psBlob;
+    CompileShaderFromFile(L"shaders/VertexShader.hlsl", "main", "vs_5_0", vsBlob.GetAddressOf());
+    CompileShaderFromFile(L"shaders/PixelShader.hlsl", "main", "ps_5_0", psBlob.GetAddressOf());
+
+    ShaderProgram program;
+    HRESULT hr = m_device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(),
+                                              nullptr, program.vertexShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateVertexShader (clustered lighting)", hr));
+    hr = m_device->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(),
+                                     nullptr, program.pixelShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreatePixelShader (clustered lighting)", hr));
+
+    static_assert(SceneVertexLayout::Provides<VertexSemantic::Position, VertexSemantic::Color, VertexSemantic::Normal>(),
+                  "shaders/VertexShader.hlsl reads position, color and normal");
+    auto layout = MakeInputElements<SceneVertexLayout>();
+    hr = m_device->CreateInputLayout(layout.data(), static_cast<UINT>(layout.size()), vsBlob->GetBufferPointer(),
+                                     vsBlob->GetBufferSize(), program.inputLayout.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateInputLayout (clustered lighting)", hr));
+
+    // Light data is rewritten every frame
+    CreateStructuredBuffer("Light data", sizeof(ClusteredLighting::GpuLight), ClusteredLighting::MAX_LIGHTS,
+                           m_lightDataBuffer, m_lightingViews[0]);
+    CreateStructuredBuffer("Clusters", sizeof(ClusteredLighting::Cluster),
+                           CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES, m_clusterBuffer, m_lightingViews[1]);
+    CreateStructuredBuffer("Light indices", sizeof(uint32_t), m_clusteredLighting.GetMaxIndices(),
+                           m_lightIndexBuffer, m_lightingViews[2]);
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    bd.ByteWidth = sizeof(LightConstants);
+    hr = m_device->CreateBuffer(&bd, nullptr, m_lightConstantBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (light constants)", hr));
+    bd.ByteWidth = sizeof(ClusteredLighting::ShaderConstants);
+    hr = m_device->CreateBuffer(&bd, nullptr, m_clusterConstantBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (cluster constants)", hr));
+
+    // Register as SHADER_CLUSTERED_LIT
+    m_shaders[SHADER_CLUSTERED_LIT] = program;
+    m_sceneShader = SHADER_CLUSTERED_LIT;
+    return true;
+}
+
+bool Renderer::InitializeDynamicResolution() {
+    // Fullscreen triangle that stretches the rendered part of the scene target over the back buffer
+    const char* vsSource = R"(
+        cbuffer UpscaleBuffer : register(b0) {
+            float2 UvScale;
+            float2 UvMax;
+        };
+
+        struct VS_OUTPUT {
+            float4 Pos : SV_POSITION;
+            float2 Uv : TEXCOORD0;
+        };
+
+        VS_OUTPUT main(uint id : SV_VertexID) {
+            VS_OUTPUT output;
+            float2 corner = float2((id << 1) & 2, id & 2);
+            output.Pos = float4(corner * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+            output.Uv = corner * UvScale;
+            return output;
+        }
+    )";
+
+    const char* psSource = R"(
+        cbuffer UpscaleBuffer : register(b0) {
+            float2 UvScale;
+            float2 UvMax;
+        };
+
+        Texture2D Scene : register(t0);
+        SamplerState LinearClamp : register(s0);
+
+        struct PS_INPUT {
+            float4 Pos : SV_POSITION;
+            float2 Uv : TEXCOORD0;
+        };
+
+        float4 main(PS_INPUT input) : SV_Target {
+            return Scene.Sample(LinearClamp, min(input.Uv, UvMax));
+        }
+    )";
+
+    ComPtr<ID3DBlob> vsBlob;
+    ComPtr<ID3DBlob> psBlob;
+    ComPtr<ID3DBlob> errorBlob;
+
+    HRESULT hr = D3DCompile(vsSource, strlen(vsSource), nullptr, nullptr, nullptr,
+                            "main", "vs_4_0", 0, 0, vsBlob.GetAddressOf(), errorBlob.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Upscale vertex shader", hr, errorBlob.Get()));
+    hr = D3DCompile(psSource, strlen(psSource), nullptr, nullptr, nullptr,
+                    "main", "ps_4_0", 0, 0, psBlob.GetAddressOf(), errorBlob.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Upscale pixel shader", hr, errorBlob.Get()));
+
+    hr = m_device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr,
+                                      m_upscaleVertexShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateVertexShader (upscale)", hr));
+    hr = m_device->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr,
+                                     m_upscalePixelShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreatePixelShader (upscale)", hr));
+
+    // The scene target stays at window size; lower scales render into its top-left corner
+    D3D11_TEXTURE2D_DESC targetDesc = {};
+    targetDesc.Width = m_width;
+    targetDesc.Height = m_height;
+    targetDesc.MipLevels = 1;
+    targetDesc.ArraySize = 1;
+    targetDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    targetDesc.SampleDesc.Count = 1;
+    targetDesc.Usage = D3D11_USAGE_DEFAULT;
+    targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+    hr = m_device->CreateTexture2D(&targetDesc, nullptr, m_sceneTarget.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateTexture2D (scene target)", hr));
+    hr = m_device->CreateRenderTargetView(m_sceneTarget.Get(), nullptr, m_sceneTargetView.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateRenderTargetView (scene target)", hr));
+    hr = m_device->CreateShaderResourceView(m_sceneTarget.Get(), nullptr, m_sceneTargetResource.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateShaderResourceView (scene target)", hr));
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = sizeof(UpscaleConstants);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    hr = m_device->CreateBuffer(&bd, nullptr, m_upscaleConstantBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (upscale constants)", hr));
+
+    D3D11_SAMPLER_DESC samplerDesc = {};
+    samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = m_device->CreateSamplerState(&samplerDesc, m_upscaleSampler.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateSamplerState (upscale)", hr));
+
+    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+    dsDesc.DepthEnable = false;
+    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+    hr = m_device->CreateDepthStencilState(&dsDesc, m_upscaleDepthState.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateDepthStencilState (upscale)", hr));
+
+    // Optional: without timestamps there is nothing to steer by, so the scale stays at 1
+    D3D11_QUERY_DESC queryDesc = {};
+    for (SceneTimer& timer : m_sceneTimers) {
+        queryDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+        if (FAILED(m_device->CreateQuery(&queryDesc, timer.disjoint.GetAddressOf()))) return true;
+        queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+        if (FAILED(m_device->CreateQuery(&queryDesc, timer.begin.GetAddressOf()))) return true;
+        if (FAILED(m_device->CreateQuery(&queryDesc, timer.end.GetAddressOf()))) return true;
+        timer.pending = false;
+    }
+
+    m_dynamicResolution.Initialize(SCENE_TARGET_MILLISECONDS, MIN_SCENE_SCALE);
+    m_dynamicResolution.SetTraceCapacity(RESOLUTION_TRACE_FRAMES);
+    m_dynamicResolutionEnabled = true;
+    return true;
+}
+
+bool Renderer::InitializeParticles() {
+    // Camera-facing quads built from SV_VertexID, one instance per particle
+    const char* vsSource = R"(
+        cbuffer ParticleBuffer : register(b0) {
+            matrix ViewProjection;
+            float3 CameraRight;
+            float Padding0;
+            float3 CameraUp;
+            float Padding1;
+        };
+
+        struct VS_INPUT {
+            float4 PositionSize : POSITION;
+            float4 Color : COLOR;
+            uint Corner : SV_VertexID;
+        };
+
+        struct VS_OUTPUT {
+            float4 Pos : SV_POSITION;
+            float4 Color : COLOR;
+        };
+
+        VS_OUTPUT main(VS_INPUT input) {
+            VS_OUTPUT output;
+            float2 corner = float2((input.Corner & 2) ? 0.5f : -0.5f, (input.Corner & 1) ? 0.5f : -0.5f);
+            float3 position = input.PositionSize.xyz +
+                              (CameraRight * corner.x + CameraUp * corner.y) * input.PositionSize.w;
+            output.Pos = mul(float4(position, 1.0f), ViewProjection);
+            output.Color = input.Color;
+            return output;
+        }
+    )";
+
+    const char* psSource = R"(
+        struct PS_INPUT {
+            float4 Pos : SV_POSITION;
+            float4 Color : COLOR;
+        };
+
+        float4 main(PS_INPUT input) : SV_Target {
+            return input.Color;
+        }
+    )";
+
+    ComPtr<ID3DBlob> vsBlob;
+    ComPtr<ID3DBlob> psBlob;
+    ComPtr<ID3DBlob> errorBlob;
+
+    HRESULT hr = D3DCompile(vsSource, strlen(vsSource), nullptr, nullptr, nullptr,
+                            "main", "vs_4_0", 0, 0, vsBlob.GetAddressOf(), errorBlob.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Particle vertex shader", hr, errorBlob.Get()));
+    hr = D3DCompile(psSource, strlen(psSource), nullptr, nullptr, nullptr,
+                    "main", "ps_4_0", 0, 0, psBlob.GetAddressOf(), errorBlob.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeCompileFailure("Particle pixel shader", hr, errorBlob.Get()));
+
+    hr = m_device->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr,
+                                      m_particleVertexShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateVertexShader (particles)", hr));
+    hr = m_device->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr,
+                                     m_particlePixelShader.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreatePixelShader (particles)", hr));
+
+    // Both elements step once per instance; the quad corner comes from the vertex id
+    D3D11_INPUT_ELEMENT_DESC layout[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+    };
+    hr = m_device->CreateInputLayout(layout, ARRAYSIZE(layout), vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(),
+                                     m_particleInputLayout.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateInputLayout (particles)", hr));
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = sizeof(ParticleInstance) * PARTICLE_INSTANCE_CAPACITY;
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    hr = m_device->CreateBuffer(&bd, nullptr, m_particleInstanceBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (particle instances)", hr));
+
+    bd.ByteWidth = sizeof(ParticleConstants);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    hr = m_device->CreateBuffer(&bd, nullptr, m_particleConstantBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (particle constants)", hr));
+
+    D3D11_BLEND_DESC blendDesc = {};
+    blendDesc.RenderTarget[0].BlendEnable = TRUE;
+    blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+    blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+    blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+    blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+    blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+    blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    hr = m_device->CreateBlendState(&blendDesc, m_particleAdditiveBlend.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBlendState (additive particles)", hr));
+    blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    hr = m_device->CreateBlendState(&blendDesc, m_particleAlphaBlend.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBlendState (alpha particles)", hr));
+
+    // Tested against the scene but never written, so particles do not hide each other
+    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+    dsDesc.DepthEnable = true;
+    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsDesc.DepthFunc = D3D11_COMPARISON_LESS;
+    hr = m_device->CreateDepthStencilState(&dsDesc, m_particleDepthState.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateDepthStencilState (particles)", hr));
+    return true;
+}
+
+void Renderer::SetDynamicResolutionEnabled(bool enabled) {
+    m_dynamicResolutionEnabled = enabled && m_sceneTimers[0].disjoint;
+    if (!m_dynamicResolutionEnabled) {
+        m_dynamicResolution.Reset();
+    }
+}
+
+void Renderer::CreateStructuredBuffer(const char* name, UINT stride, UINT count, ComPtr<ID3D11Buffer>& buffer,
+                                      ComPtr<ID3D11ShaderResourceView>& view) {
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = stride * count;
+    bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    bd.StructureByteStride = stride;
+
+    HRESULT hr = m_device->CreateBuffer(&bd, nullptr, buffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure((std::string(name) + " buffer").c_str(), hr));
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srvDesc.Buffer.FirstElement = 0;
+    srvDesc.Buffer.NumElements = count;
+
+    hr = m_device->CreateShaderResourceView(buffer.Get(), &srvDesc, view.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure((std::string(name) + " view").c_str(), hr));
+}
+
+void Renderer::CompileShaderFromFile(const WCHAR* filename, const char* entryPoint,
+                                     const char* shaderModel, ID3DBlob** blob) {
+    UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+    flags |= D3DCOMPILE_DEBUG;
+#endif
+
+    ComPtr<ID3DBlob> errorBlob;
+    VertexLayoutInclude include;
+    HRESULT hr = D3DCompileFromFile(filename, nullptr, &include, entryPoint,
+                                    shaderModel, flags, 0, blob, errorBlob.GetAddressOf());
+    if (FAILED(hr)) {
+        // Keep the compiler log as the stage's failure cause
+        char name[MAX_PATH];
+        WideCharToMultiByte(CP_UTF8, 0, filename, -1, name, MAX_PATH, nullptr, nullptr);
+        throw std::runtime_error(DescribeCompileFailure(name, hr, errorBlob.Get()));
+    }
+}
+
+void Renderer::CreateMesh(const char* name, const void* vertices, UINT vertexCount, UINT stride,
+                          const UINT* indices, UINT indexCount, Mesh& mesh) {
+    // Every level indexes the same vertices, so one index buffer holds the whole chain
+    std::vector<Float3> positions(vertexCount);
+    for (UINT i = 0; i < vertexCount; ++i) {
+        memcpy(&positions[i], static_cast<const BYTE*>(vertices) + i * stride, sizeof(Float3));
+    }
+    MeshLodChain chain = MeshSimplifier::BuildLodChain(positions.data(), vertexCount, indices, indexCount);
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_IMMUTABLE;
+    bd.ByteWidth = vertexCount * stride;
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA initData = {};
+    initData.pSysMem = vertices;
+
+    HRESULT hr = m_device->CreateBuffer(&bd, &initData, mesh.vertexBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure((std::string(name) + " vertex buffer").c_str(), hr));
+
+    bd.ByteWidth = static_cast<UINT>(chain.indices.size() * sizeof(UINT));
+    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    initData.pSysMem = chain.indices.data();
+
+    hr = m_device->CreateBuffer(&bd, &initData, mesh.indexBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure((std::string(name) + " index buffer").c_str(), hr));
+
+    mesh.stride = stride;
+    mesh.lods = chain.lods;
 }
 
 void Renderer::BeginScene() {
+    if (m_capture) {
+        m_capture->BeginFrame();
+    }
+    m_frameArena.BeginFrame();
+    if (m_constantRing.IsInitialized()) {
+        m_constantRing.BeginFrame();
+    }
+
     // Clear render target and depth stencil
     float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
     m_deviceContext->ClearRenderTargetView(m_renderTargetView.Get(), clearColor);
     m_deviceContext->ClearDepthStencilView(m_depthStencilView.Get(), 
                                          D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 
                                          1.0f, 0);
+    if (m_sceneTargetView) {
+        m_deviceContext->ClearRenderTargetView(m_sceneTargetView.Get(), clearColor);
+    }
 
-    // Set render target
-    m_deviceContext->OMSetRenderTargetView(m_renderTargetView.Get(), 
-                                         m_depthStencilView.Get());
+    // Menus draw straight to the back buffer; Render switches to the scene target
+    BindBackBuffer();
+}
+
+void Renderer::BindBackBuffer() {
+    m_deviceContext->OMSetRenderTargets(1, m_renderTargetView.GetAddressOf(), m_depthStencilView.Get());
 
-    // Set viewport
     D3D11_VIEWPORT viewport = {};
     viewport.Width = static_cast<float>(m_width);
     viewport.Height = static_cast<float>(m_height);
@@ -228,30 +834,548 @@ void Renderer::BeginScene() {
     m_deviceContext->RSSetViewports(1, &viewport);
 }
 
+void Renderer::BindSceneState(ID3D11DeviceContext* context) {
+    // Deferred contexts start from default state, so everything the scene relies on is set here
+    ID3D11RenderTargetView* target = m_sceneTargetView ? m_sceneTargetView.Get() : m_renderTargetView.Get();
+    context->OMSetRenderTargets(1, &target, m_depthStencilView.Get());
+    context->OMSetDepthStencilState(m_depthStencilState.Get(), 0);
+    context->RSSetState(m_rasterizerState.Get());
+
+    D3D11_VIEWPORT viewport = {};
+    viewport.Width = static_cast<float>(m_sceneWidth);
+    viewport.Height = static_cast<float>(m_sceneHeight);
+    viewport.MinDepth = 0.0f;
+    viewport.MaxDepth = 1.0f;
+    context->RSSetViewports(1, &viewport);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    if (m_sceneShader == SHADER_CLUSTERED_LIT) {
+        ID3D11Buffer* constantBuffers[] = { m_lightConstantBuffer.Get(), m_clusterConstantBuffer.Get() };
+        ID3D11ShaderResourceView* views[] = { m_lightingViews[0].Get(), m_lightingViews[1].Get(), m_lightingViews[2].Get() };
+        context->PSSetConstantBuffers(1, 2, constantBuffers);
+        context->PSSetShaderResources(0, 3, views);
+    }
+}
+
+void Renderer::UploadLights(Camera* camera) {
+    MemoryTagScope tag(MemoryTag::Lighting);
+
+    // Bin in the camera's view space, then replace last frame's buffers before any draw reads them
+    Float4x4 view;
+    XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&view), camera->GetViewMatrix());
+    m_clusteredLighting.SetProjection(camera->GetFieldOfView(), camera->GetAspectRatio(),
+                                      camera->GetNearPlane(), camera->GetFarPlane());
+    m_clusteredLighting.Build(m_lights.data(), static_cast<uint32_t>(m_lights.size()), view, &m_jobSystem);
+    m_lights.clear();
+
+    const std::vector<ClusteredLighting::GpuLight>& lights = m_clusteredLighting.GetGpuLights();
+    const std::vector<ClusteredLighting::Cluster>& clusters = m_clusteredLighting.GetClusters();
+    const std::vector<uint32_t>& indices = m_clusteredLighting.GetLightIndices();
+    WriteBuffer(m_lightDataBuffer.Get(), lights.data(), lights.size() * sizeof(lights[0]));
+    WriteBuffer(m_clusterBuffer.Get(), clusters.data(), clusters.size() * sizeof(clusters[0]));
+    WriteBuffer(m_lightIndexBuffer.Get(), indices.data(), indices.size() * sizeof(indices[0]));
+
+    LightConstants light;
+    light.lightDirection = XMFLOAT3(0.3f, -1.0f, 0.4f);
+    light.lightIntensity = 0.8f;
+    light.ambientColor = XMFLOAT3(1.0f, 1.0f, 1.0f);
+    light.ambientIntensity = 0.2f;
+    WriteBuffer(m_lightConstantBuffer.Get(), &light, sizeof(light));
+
+    ClusteredLighting::ShaderConstants grid =
+        m_clusteredLighting.GetShaderConstants(static_cast<float>(m_sceneWidth), static_cast<float>(m_sceneHeight));
+    WriteBuffer(m_clusterConstantBuffer.Get(), &grid, sizeof(grid));
+}
+
+void Renderer::WriteBuffer(ID3D11Buffer* buffer, const void* data, size_t size) {
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(m_deviceContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+    if (size > 0) {
+        memcpy(mapped.pData, data, size);
+    }
+    m_deviceContext->Unmap(buffer, 0);
+}
+
 void Renderer::Render(Camera* camera, bool dimScene) {
     if (!camera) return;
+    MemoryTagScope tag(MemoryTag::Render);
+
+    // Scale picked from frames already read back; rounding keeps the aspect ratio within a pixel
+    float scale = m_dynamicResolutionEnabled ? m_dynamicResolution.GetScale() : 1.0f;
+    m_sceneWidth = (std::max)(1, static_cast<int>(m_width * scale + 0.5f));
+    m_sceneHeight = (std::max)(1, static_cast<int>(m_height * scale + 0.5f));
+
+    SceneTimer& timer = m_sceneTimers[m_sceneTimerFrame % ARRAYSIZE(m_sceneTimers)];
+    bool timed = m_dynamicResolutionEnabled && !timer.pending;
+    if (timed) {
+        m_deviceContext->Begin(timer.disjoint.Get());
+        m_deviceContext->End(timer.begin.Get());
+    }
+
+    BindSceneState(m_deviceContext.Get());
+    RenderScene(camera);
+    RenderParticles(camera);
+
+    if (timed) {
+        m_deviceContext->End(timer.end.Get());
+        m_deviceContext->End(timer.disjoint.Get());
+        timer.pending = true;
+    }
+    m_sceneTimerFrame++;
+
+    UpscaleScene();
+}
+
+void Renderer::RenderScene(Camera* camera) {
+    // Shaders expect column-major matrices
+    m_frameView = XMMatrixTranspose(camera->GetViewMatrix());
+    m_frameProjection = XMMatrixTranspose(camera->GetProjectionMatrix());
+
+    m_renderQueue.Clear();
+    if (m_world && m_world->IsInitialized()) {
+        SubmitWorld(camera);
+    } else {
+        SubmitScene(camera);
+    }
+    SubmitPhysics(camera);
+    SubmitSceneGraph(camera);
+    m_renderQueue.Sort();
+    if (m_capture && m_capture->IsCapturing()) {
+        m_renderQueue.Execute(*m_capture);
+    }
+
+    if (m_sceneShader == SHADER_CLUSTERED_LIT) {
+        UploadLights(camera);
+    } else {
+        m_lights.clear();
+    }
+
+    const size_t drawCount = m_renderQueue.GetSize();
+    uint32_t recorderCount = 0;
+    if (drawCount >= PARALLEL_RECORD_MIN_DRAWS && !m_deferredRecorders.empty()) {
+        recorderCount = static_cast<uint32_t>((std::min)(m_deferredRecorders.size(),
+                                                         (drawCount + DRAWS_PER_RECORDER - 1) / DRAWS_PER_RECORDER));
+    }
+
+    auto recordStart = std::chrono::steady_clock::now();
+
+    if (recorderCount == 0) {
+        // Small scenes: write constants, upload once, then draw on the immediate context
+        m_immediateRecorder.Prepare(this, m_deviceContext.Get(), drawCount, false);
+        if (m_constantRing.IsInitialized()) {
+            m_constantRing.Flush();
+        }
+        auto submitStart = std::chrono::steady_clock::now();
+        m_renderQueue.Execute(m_immediateRecorder);
+
+        auto submitEnd = std::chrono::steady_clock::now();
+        m_recordStats.recorders = 0;
+        m_recordStats.recordMilliseconds = std::chrono::duration<double, std::milli>(submitStart - recordStart).count();
+        m_recordStats.submitMilliseconds = std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+        return;
+    }
+
+    // Each recorder owns a contiguous slice of the sorted queue and its own constants
+    m_recorderPointers.clear();
+    for (uint32_t i = 0; i < recorderCount; ++i) {
+        size_t begin, end;
+        m_renderQueue.GetPartition(i, recorderCount, begin, end);
+        ContextRecorder& recorder = m_deferredRecorders[i];
+        recorder.Prepare(this, recorder.context.Get(), end - begin, true);
+        m_recorderPointers.push_back(&recorder);
+    }
+    m_renderQueue.ExecuteParallel(m_jobSystem, m_recorderPointers.data(), recorderCount);
+
+    auto submitStart = std::chrono::steady_clock::now();
+    if (m_constantRing.IsInitialized()) {
+        m_constantRing.Flush();
+    }
+
+    // Submitting in partition order keeps the global key order
+    for (uint32_t i = 0; i < recorderCount; ++i) {
+        ContextRecorder& recorder = m_deferredRecorders[i];
+        if (recorder.commandList) {
+            m_deviceContext->ExecuteCommandList(recorder.commandList.Get(), TRUE);
+            recorder.commandList.Reset();
+        }
+    }
+
+    auto submitEnd = std::chrono::steady_clock::now();
+    m_recordStats.recorders = recorderCount;
+    m_recordStats.recordMilliseconds = std::chrono::duration<double, std::milli>(submitStart - recordStart).count();
+    m_recordStats.submitMilliseconds = std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+}
+
+void Renderer::RenderParticles(Camera* camera) {
+    if (!m_particles || !m_particleInstanceBuffer) return;
+
+    ParticleConstants constants;
+    constants.viewProjection = XMMatrixTranspose(camera->GetViewMatrix() * camera->GetProjectionMatrix());
+    constants.cameraRight = camera->GetRight();
+    constants.cameraUp = camera->GetUp();
+    constants.padding0 = constants.padding1 = 0.0f;
+    WriteBuffer(m_particleConstantBuffer.Get(), &constants, sizeof(constants));
+
+    UINT stride = sizeof(ParticleInstance);
+    UINT offset = 0;
+    m_deviceContext->OMSetDepthStencilState(m_particleDepthState.Get(), 0);
+    m_deviceContext->IASetInputLayout(m_particleInputLayout.Get());
+    m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    m_deviceContext->IASetVertexBuffers(0, 1, m_particleInstanceBuffer.GetAddressOf(), &stride, &offset);
+    m_deviceContext->VSSetShader(m_particleVertexShader.Get(), nullptr, 0);
+    m_deviceContext->VSSetConstantBuffers(0, 1, m_particleConstantBuffer.GetAddressOf());
+    m_deviceContext->PSSetShader(m_particlePixelShader.Get(), nullptr, 0);
+
+    // One instanced draw per type; the instances are written straight into the mapped buffer
+    for (uint32_t type = 0; type < PARTICLE_TYPE_COUNT; ++type) {
+        ParticleType particleType = static_cast<ParticleType>(type);
+        if (m_particles->GetCount(particleType) == 0) continue;
 
-    // Update constant buffer with new matrices
-    ConstantBuffer cb;
-    cb.world = XMMatrixIdentity();
-    cb.view = camera->GetViewMatrix();
-    cb.projection = camera->GetProjectionMatrix();
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(m_deviceContext->Map(m_particleInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return;
+        uint32_t count = m_particles->WriteInstances(particleType, static_cast<ParticleInstance*>(mapped.pData),
+                                                     PARTICLE_INSTANCE_CAPACITY, &m_jobSystem);
+        m_deviceContext->Unmap(m_particleInstanceBuffer.Get(), 0);
+
+        bool additive = m_particles->GetTypeSettings(particleType).additive;
+        m_deviceContext->OMSetBlendState(additive ? m_particleAdditiveBlend.Get() : m_particleAlphaBlend.Get(),
+                                         nullptr, 0xffffffff);
+        m_deviceContext->DrawInstanced(4, count, 0, 0);
+        if (m_capture) {
+            m_capture->DrawBatch(CaptureTarget::BATCH_PARTICLES, type, count);
+        }
+    }
+
+    m_deviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+    m_deviceContext->OMSetDepthStencilState(m_depthStencilState.Get(), 0);
+    m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
 
-    m_deviceContext->UpdateSubresource(m_constantBuffer.Get(), 0, nullptr, &cb, 0, 0);
+void Renderer::UpscaleScene() {
+    BindBackBuffer();
+    if (!m_sceneTargetView) return;
 
-    // Set shaders and constant buffers
-    m_deviceContext->VSSetShader(m_vertexShader.Get(), nullptr, 0);
-    m_deviceContext->PSSetShader(m_pixelShader.Get(), nullptr, 0);
-    m_deviceContext->VSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+    UpscaleConstants constants;
+    constants.uvScale = XMFLOAT2(static_cast<float>(m_sceneWidth) / m_width, static_cast<float>(m_sceneHeight) / m_height);
+    constants.uvMax = XMFLOAT2((m_sceneWidth - 0.5f) / m_width, (m_sceneHeight - 0.5f) / m_height);
+    WriteBuffer(m_upscaleConstantBuffer.Get(), &constants, sizeof(constants));
 
-    // Set the input layout and primitive topology
-    m_deviceContext->IASetInputLayout(m_inputLayout.Get());
+    m_deviceContext->OMSetDepthStencilState(m_upscaleDepthState.Get(), 0);
+    m_deviceContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+    m_deviceContext->IASetInputLayout(nullptr);
     m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    m_deviceContext->VSSetShader(m_upscaleVertexShader.Get(), nullptr, 0);
+    m_deviceContext->VSSetConstantBuffers(0, 1, m_upscaleConstantBuffer.GetAddressOf());
+    m_deviceContext->PSSetShader(m_upscalePixelShader.Get(), nullptr, 0);
+    m_deviceContext->PSSetConstantBuffers(0, 1, m_upscaleConstantBuffer.GetAddressOf());
+    m_deviceContext->PSSetShaderResources(0, 1, m_sceneTargetResource.GetAddressOf());
+    m_deviceContext->PSSetSamplers(0, 1, m_upscaleSampler.GetAddressOf());
+    m_deviceContext->Draw(3, 0);
+    if (m_capture) {
+        m_capture->DrawBatch(CaptureTarget::BATCH_FULLSCREEN, 0, 1);
+    }
+
+    // The scene target is rendered to again next frame
+    ID3D11ShaderResourceView* nullView = nullptr;
+    m_deviceContext->PSSetShaderResources(0, 1, &nullView);
+}
+
+void Renderer::ReadSceneTimers() {
+    // Oldest first; a query that is not ready yet is left for a later frame
+    for (uint32_t i = 0; i < ARRAYSIZE(m_sceneTimers); ++i) {
+        SceneTimer& timer = m_sceneTimers[(m_sceneTimerFrame + i) % ARRAYSIZE(m_sceneTimers)];
+        if (!timer.pending) continue;
+
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+        UINT64 begin, end;
+        if (m_deviceContext->GetData(timer.disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+            m_deviceContext->GetData(timer.begin.Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+            m_deviceContext->GetData(timer.end.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+            break;
+        }
+        timer.pending = false;
+        if (!disjoint.Disjoint && end > begin) {
+            m_dynamicResolution.Update(static_cast<float>(static_cast<double>(end - begin) * 1000.0 / disjoint.Frequency));
+        }
+    }
+}
+
+void Renderer::SubmitScene(Camera* camera) {
+    struct SceneObject {
+        uint32_t mesh;
+        XMFLOAT3 position;
+        XMFLOAT3 halfExtents;
+        bool occluder;
+    };
+    static const SceneObject objects[] = {
+        { MESH_FLOOR, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(10.0f, 0.0f, 10.0f), false },
+        { MESH_CUBE, XMFLOAT3(0.0f, 0.5f, -2.0f), XMFLOAT3(0.5f, 0.5f, 0.5f), true },
+        { MESH_CUBE, XMFLOAT3(-2.0f, 0.5f, -2.0f), XMFLOAT3(0.5f, 0.5f, 0.5f), true },
+        { MESH_CUBE, XMFLOAT3(2.0f, 0.5f, -2.0f), XMFLOAT3(0.5f, 0.5f, 0.5f), true }
+    };
+
+    // Rasterize the occluders first, then test everything else against them
+    Float4x4 viewProjection;
+    XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProjection),
+                    camera->GetViewMatrix() * camera->GetProjectionMatrix());
+    auto boundsMin = [](const SceneObject& object) {
+        return Float3{ object.position.x - object.halfExtents.x, object.position.y - object.halfExtents.y,
+                       object.position.z - object.halfExtents.z };
+    };
+    auto boundsMax = [](const SceneObject& object) {
+        return Float3{ object.position.x + object.halfExtents.x, object.position.y + object.halfExtents.y,
+                       object.position.z + object.halfExtents.z };
+    };
+
+    {
+        MemoryTagScope tag(MemoryTag::Culling);
+        m_occlusionCuller.BeginFrame(viewProjection);
+        for (const SceneObject& object : objects) {
+            if (object.occluder) {
+                m_occlusionCuller.RasterizeBox(boundsMin(object), boundsMax(object), Float4x4::Identity());
+            }
+        }
+        m_occlusionCuller.EndOccluders();
+    }
+
+    const size_t objectCount = sizeof(objects) / sizeof(objects[0]);
+    m_objectLods.resize(objectCount, 0);
+    m_lodSelector.SetProjection(camera->GetFieldOfView(), static_cast<float>(m_sceneHeight));
+    m_lodSelector.SetThreshold(LOD_PIXEL_ERROR);
+    m_lodSelector.ResetStats();
+    XMFLOAT3 eye = camera->GetPosition();
+
+    for (size_t i = 0; i < objectCount; ++i) {
+        const SceneObject& object = objects[i];
+
+        // Occluders would only be hidden by their own depth, so they are always drawn
+        if (!object.occluder && !m_occlusionCuller.IsVisible(boundsMin(object), boundsMax(object))) {
+            continue;
+        }
+
+        // Distance to the nearest point of the bounds, so large objects refine as they are approached
+        float dx = (std::max)(fabsf(eye.x - object.position.x) - object.halfExtents.x, 0.0f);
+        float dy = (std::max)(fabsf(eye.y - object.position.y) - object.halfExtents.y, 0.0f);
+        float dz = (std::max)(fabsf(eye.z - object.position.z) - object.halfExtents.z, 0.0f);
+        const Mesh& mesh = m_meshes[object.mesh];
+        m_objectLods[i] = m_lodSelector.Select(mesh.lods.data(), static_cast<uint32_t>(mesh.lods.size()),
+                                               sqrtf(dx * dx + dy * dy + dz * dz), m_objectLods[i]);
+
+        SubmitDraw(camera, object.mesh, m_objectLods[i], MATERIAL_OPAQUE,
+                   XMMatrixTranslation(object.position.x, object.position.y, object.position.z));
+    }
+}
+
+void Renderer::SubmitWorld(Camera* camera) {
+    Float4x4 viewProjection;
+    XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&viewProjection),
+                    camera->GetViewMatrix() * camera->GetProjectionMatrix());
+    auto boundsOf = [](const WorldObject& object, Float3& boundsMin, Float3& boundsMax) {
+        boundsMin = { object.position.x - object.halfExtents.x, object.position.y - object.halfExtents.y,
+                      object.position.z - object.halfExtents.z };
+        boundsMax = { object.position.x + object.halfExtents.x, object.position.y + object.halfExtents.y,
+                      object.position.z + object.halfExtents.z };
+    };
+
+    const std::vector<const WorldChunk*>& chunks = m_world->GetResidentChunks();
+    Float3 boundsMin, boundsMax;
+    {
+        MemoryTagScope tag(MemoryTag::Culling);
+        m_occlusionCuller.BeginFrame(viewProjection);
+        for (const WorldChunk* chunk : chunks) {
+            for (const WorldObject& object : chunk->objects) {
+                if (object.flags & WORLD_OBJECT_OCCLUDER) {
+                    boundsOf(object, boundsMin, boundsMax);
+                    m_occlusionCuller.RasterizeBox(boundsMin, boundsMax, Float4x4::Identity());
+                }
+            }
+        }
+        m_occlusionCuller.EndOccluders();
+    }
+
+    m_lodSelector.SetProjection(camera->GetFieldOfView(), static_cast<float>(m_sceneHeight));
+    m_lodSelector.SetThreshold(LOD_PIXEL_ERROR);
+    m_lodSelector.ResetStats();
+    XMFLOAT3 eye = camera->GetPosition();
+
+    for (const WorldChunk* chunk : chunks) {
+        for (const WorldObject& object : chunk->objects) {
+            boundsOf(object, boundsMin, boundsMax);
+            if (!(object.flags & WORLD_OBJECT_OCCLUDER) && !m_occlusionCuller.IsVisible(boundsMin, boundsMax)) {
+                continue;
+            }
 
-    // TODO: Add actual geometry rendering here
-    // For now, this is just a placeholder for the rendering pipeline
+            // Meshes fill a unit box, except the floor grid which is flat and 20 units across
+            float meshHalfSize = object.mesh == MESH_FLOOR ? 10.0f : 0.5f;
+            float scaleY = object.mesh == MESH_FLOOR ? 1.0f : object.halfExtents.y / meshHalfSize;
+            float scale = object.halfExtents.x / meshHalfSize;
+
+            // Streamed objects keep no LOD history, so they select without hysteresis
+            float dx = (std::max)(fabsf(eye.x - object.position.x) - object.halfExtents.x, 0.0f);
+            float dy = (std::max)(fabsf(eye.y - object.position.y) - object.halfExtents.y, 0.0f);
+            float dz = (std::max)(fabsf(eye.z - object.position.z) - object.halfExtents.z, 0.0f);
+            const Mesh& mesh = m_meshes[object.mesh];
+            uint32_t lod = m_lodSelector.Select(mesh.lods.data(), static_cast<uint32_t>(mesh.lods.size()),
+                                                sqrtf(dx * dx + dy * dy + dz * dz) / scale, 0);
+
+            SubmitDraw(camera, object.mesh, lod, MATERIAL_OPAQUE,
+                       XMMatrixScaling(scale, scaleY, object.halfExtents.z / meshHalfSize) *
+                       XMMatrixTranslation(object.position.x, object.position.y, object.position.z));
+        }
+    }
+}
+
+void Renderer::SubmitPhysics(Camera* camera) {
+    if (!m_physics) return;
+    // The cube mesh is a unit cube, so it is scaled to the box's full extents
+    for (uint32_t body = m_firstPhysicsBody; body < m_physics->GetBodyCount(); ++body) {
+        Float3 halfExtents = m_physics->GetHalfExtents(body);
+        Float4x4 world = m_physics->GetWorldMatrix(body);
+        SubmitDraw(camera, MESH_CUBE, 0, MATERIAL_OPAQUE,
+                   XMMatrixScaling(halfExtents.x * 2.0f, halfExtents.y * 2.0f, halfExtents.z * 2.0f) *
+                       XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&world)));
+    }
+}
+
+void Renderer::SubmitSceneGraph(Camera* camera) {
+    if (!m_sceneGraph) return;
+    const Float4x4* worlds = m_sceneGraph->GetWorldMatrices();
+    const uint32_t* meshes = m_sceneGraph->GetSlotUserData();
+    for (uint32_t slot = 0; slot < m_sceneGraph->GetNodeCount(); ++slot) {
+        if (meshes[slot] != MESH_FLOOR && meshes[slot] != MESH_CUBE) continue;
+        SubmitDraw(camera, meshes[slot], 0, MATERIAL_OPAQUE, XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&worlds[slot])));
+    }
+}
+
+void Renderer::SubmitDraw(Camera* camera, uint32_t mesh, uint32_t lod, uint32_t material, const XMMATRIX& world) {
+    DrawItem item;
+    XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&item.world), world);
+    item.shader = m_sceneShader;
+    item.material = material;
+    item.mesh = mesh;
+    item.lod = lod;
+    item.userData = 0;
+
+    // View-space depth of the object origin, normalized to the far plane
+    XMVECTOR origin = XMVector3TransformCoord(world.r[3], camera->GetViewMatrix());
+    float depth = XMVectorGetZ(origin) / camera->GetFarPlane();
+
+    m_renderQueue.Submit(RenderQueue::MakeKey(RenderQueue::PASS_OPAQUE, item.shader, material, mesh, depth), item);
+}
+
+void Renderer::WriteDrawConstants(const DrawItem& item, void* destination) const {
+    ConstantBuffer* cb = static_cast<ConstantBuffer*>(destination);
+    cb->world = XMMatrixTranspose(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&item.world)));
+    cb->view = m_frameView;
+    cb->projection = m_frameProjection;
+}
+
+Renderer::ContextRecorder::ContextRecorder() :
+    m_renderer(nullptr),
+    m_currentMesh(nullptr),
+    m_constants(),
+    m_hasConstants(false),
+    m_writeConstants(false),
+    m_drawIndex(0) {
+}
+
+void Renderer::ContextRecorder::Prepare(Renderer* renderer, ID3D11DeviceContext* targetContext,
+                                        size_t drawCount, bool writeConstants) {
+    m_renderer = renderer;
+    m_currentMesh = nullptr;
+    m_drawIndex = 0;
+    m_writeConstants = writeConstants;
+    if (!context) {
+        context = targetContext;
+        context.As(&context1);
+    }
+
+    // Reserve this slice's constants up front; the ring itself is not thread-safe
+    D3D11ConstantRing& ring = renderer->m_constantRing;
+    m_hasConstants = ring.IsInitialized() && context1 && drawCount > 0 &&
+                     ring.Allocate(static_cast<UINT>(drawCount) * CONSTANTS_PER_DRAW * 16, m_constants);
+
+    // The immediate path fills constants here so they can be uploaded before any draw is issued
+    if (m_hasConstants && !writeConstants) {
+        BYTE* destination = static_cast<BYTE*>(m_constants.data);
+        for (size_t i = 0; i < drawCount; ++i) {
+            renderer->WriteDrawConstants(renderer->m_renderQueue.GetSortedItem(i),
+                                         destination + i * CONSTANTS_PER_DRAW * 16);
+        }
+    }
+}
+
+void Renderer::ContextRecorder::BeginRange() {
+    m_currentMesh = nullptr;
+    if (context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED) {
+        m_renderer->BindSceneState(context.Get());
+    }
+}
+
+void Renderer::ContextRecorder::EndRange() {
+    if (context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED) {
+        context->FinishCommandList(FALSE, commandList.ReleaseAndGetAddressOf());
+    }
+}
+
+void Renderer::ContextRecorder::SetShader(uint32_t shader) {
+    const ShaderProgram& program = m_renderer->m_shaders[shader];
+    context->VSSetShader(program.vertexShader.Get(), nullptr, 0);
+    context->PSSetShader(program.pixelShader.Get(), nullptr, 0);
+    context->IASetInputLayout(program.inputLayout.Get());
+}
+
+void Renderer::ContextRecorder::SetMaterial(uint32_t material) {
+    context->OMSetBlendState(m_renderer->m_materials[material].blendState.Get(), nullptr, 0xffffffff);
+}
+
+void Renderer::ContextRecorder::SetMesh(uint32_t mesh) {
+    m_currentMesh = &m_renderer->m_meshes[mesh];
+    UINT offset = 0;
+    context->IASetVertexBuffers(0, 1, m_currentMesh->vertexBuffer.GetAddressOf(),
+                                &m_currentMesh->stride, &offset);
+    context->IASetIndexBuffer(m_currentMesh->indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+}
+
+void Renderer::ContextRecorder::Draw(const DrawItem& item) {
+    if (m_hasConstants) {
+        D3D11ConstantRing::Allocation constants = m_constants;
+        constants.firstConstant += m_drawIndex * CONSTANTS_PER_DRAW;
+        constants.numConstants = CONSTANTS_PER_DRAW;
+        if (m_writeConstants) {
+            m_renderer->WriteDrawConstants(item, static_cast<BYTE*>(m_constants.data) + m_drawIndex * CONSTANTS_PER_DRAW * 16);
+        }
+        m_renderer->m_constantRing.BindVS(context1.Get(), 0, constants);
+    } else {
+        ConstantBuffer cb;
+        m_renderer->WriteDrawConstants(item, &cb);
+        context->UpdateSubresource(m_renderer->m_constantBuffer.Get(), 0, nullptr, &cb, 0, 0);
+        context->VSSetConstantBuffers(0, 1, m_renderer->m_constantBuffer.GetAddressOf());
+    }
+    m_drawIndex++;
+
+    const MeshLod& lod = m_currentMesh->lods[item.lod];
+    context->DrawIndexed(lod.indexCount, lod.firstIndex, 0);
+}
+
+void Renderer::SetMetrics(MetricsRegistry* metrics) {
+    m_metrics = metrics;
+    m_endSceneMetric = metrics ? metrics->AddHistogram("fpsgame_render_end_scene", "EndScene time, including Present")
+                               : MetricsRegistry::INVALID_METRIC;
 }
 
 void Renderer::EndScene() {
+    MetricsTimerScope timer(m_metrics, m_endSceneMetric);
+    if (m_capture) {
+        m_capture->EndFrame();
+    }
+    if (m_constantRing.IsInitialized()) {
+        m_constantRing.EndFrame();
+    }
+
     m_swapChain->Present(1, 0);
+
+    if (m_dynamicResolutionEnabled) {
+        ReadSceneTimers();
+    }
 }
@@ -3,16 +3,47 @@
 #include <d3d11.h>
 #include <directxmath.h>
 #include <wrl/client.h>
+#include <vector>
 #include "Camera.h"
+#include "ClusteredLighting.h"
+#include "D3D11ConstantRing.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "MetricsRegistry.h"
+#include "OcclusionCuller.h"
+#include "ParticleSystem.h"
+#include "PhysicsWorld.h"
+#include "RenderCapture.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "StartupGraph.h"
+#include "VertexFormats.h"
+#include "WorldStreamer.h"
 
 using Microsoft::WRL::ComPtr;
 
 class Renderer {
 public:
+    // Registered pipeline objects, referenced by DrawItem ids
+    enum ShaderId : uint32_t { SHADER_VERTEX_COLOR = 0, SHADER_CLUSTERED_LIT = 1, SHADER_COUNT };
+    enum MaterialId : uint32_t { MATERIAL_OPAQUE = 0, MATERIAL_TRANSLUCENT = 1 };
+    enum MeshId : uint32_t { MESH_FLOOR = 0, MESH_CUBE = 1 };
+
     Renderer();
     ~Renderer();
 
     bool Initialize(HWND hwnd, int width, int height);
+
+    // Adds initialization to a startup graph instead: the device is created on
+    // the main thread, then shaders, meshes, lighting and the other parts that
+    // only need the device are built concurrently
+    struct StartupStages {
+        StartupGraph::StageId device;  // Device and swap chain exist
+        StartupGraph::StageId ready;   // Everything is initialized
+    };
+    StartupStages AddStartupStages(StartupGraph& graph, HWND hwnd, int width, int height);
     void BeginScene();
     void Render(Camera* camera, bool dimScene = false);
     void EndScene();
@@ -20,11 +51,70 @@ public:
     // Getter for Direct3D device (needed by other components)
     ID3D11Device* GetDevice() const { return m_device.Get(); }
     ID3D11DeviceContext* GetDeviceContext() const { return m_deviceContext.Get(); }
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // The 3D scene renders at a scale of the window size chosen from GPU scene
+    // time, then is upscaled under the native-resolution UI
+    void SetDynamicResolutionEnabled(bool enabled);
+    bool IsDynamicResolutionEnabled() const { return m_dynamicResolutionEnabled; }
+    DynamicResolution& GetDynamicResolution() { return m_dynamicResolution; }
+    int GetSceneWidth() const { return m_sceneWidth; }
+    int GetSceneHeight() const { return m_sceneHeight; }
+
+    // Transient per-draw constants for the current frame
+    D3D11ConstantRing& GetConstantRing() { return m_constantRing; }
+
+    // Point lights for the next Render call; cleared once they are uploaded
+    void SubmitLight(const PointLight& light) { m_lights.push_back(light); }
+
+    // Draws the streamer's resident chunks instead of the built-in scene; null restores it
+    void SetWorld(const WorldStreamer* world) { m_world = world; }
+
+    // Drawn after the scene with one instanced draw per particle type; null draws none
+    void SetParticles(const ParticleSystem* particles) { m_particles = particles; }
+
+    // Boxes from firstBody on are drawn with the cube mesh; null draws none
+    void SetPhysics(const PhysicsWorld* physics, uint32_t firstBody) {
+        m_physics = physics;
+        m_firstPhysicsBody = firstBody;
+    }
+
+    // Nodes whose user data is a MeshId are drawn at their world matrices; null draws none
+    void SetSceneGraph(const SceneGraph* sceneGraph) { m_sceneGraph = sceneGraph; }
+
+    // Frames go to the capture while it is capturing: the sorted queue, particle,
+    // full-screen and (through UIOverlay) UI batches, between BeginScene and EndScene
+    void SetCapture(RenderCapture* capture) { m_capture = capture; }
+    RenderCapture* GetCapture() const { return m_capture; }
+
+    // Registers the renderer's metrics and times every EndScene into them; null records nothing
+    void SetMetrics(MetricsRegistry* metrics);
+
+    // Worker threads shared by the renderer and other subsystems
+    JobSystem& GetJobSystem() { return m_jobSystem; }
+
+    // Scratch memory per job system thread, released at the next BeginScene
+    FrameArena& GetFrameArena() { return m_frameArena; }
+
+    struct RecordStats {
+        uint32_t recorders;         // Contexts that recorded the last frame; 0 means the immediate context
+        double recordMilliseconds;  // Writing constants and recording commands
+        double submitMilliseconds;  // Constant upload and ExecuteCommandList
+    };
+
+    // Draw statistics for the last rendered frame
+    const RenderQueue::Stats& GetRenderStats() const { return m_renderQueue.GetStats(); }
+    const RecordStats& GetRecordStats() const { return m_recordStats; }
+    const OcclusionCuller::Stats& GetOcclusionStats() const { return m_occlusionCuller.GetStats(); }
+    const LodSelector::Stats& GetLodStats() const { return m_lodSelector.GetStats(); }
+    const ClusteredLighting::Stats& GetLightingStats() const { return m_clusteredLighting.GetStats(); }
 
 private:
     // DirectX objects
     ComPtr<ID3D11Device> m_device;
     ComPtr<ID3D11DeviceContext> m_deviceContext;
+    D3D_FEATURE_LEVEL m_featureLevel;
     ComPtr<IDXGISwapChain> m_swapChain;
     ComPtr<ID3D11RenderTargetView> m_renderTargetView;
     ComPtr<ID3D11DepthStencilView> m_depthStencilView;
@@ -35,28 +125,218 @@ private:
     ComPtr<ID3D11VertexShader> m_vertexShader;
     ComPtr<ID3D11PixelShader> m_pixelShader;
     ComPtr<ID3D11InputLayout> m_inputLayout;
-    ComPtr<ID3D11Buffer> m_constantBuffer;
+    ComPtr<ID3D11Buffer> m_constantBuffer;  // Used when the runtime lacks constant buffer offsets
+    D3D11ConstantRing m_constantRing;
+
+    // Scaled scene target and the pass that stretches it over the back buffer
+    ComPtr<ID3D11Texture2D> m_sceneTarget;
+    ComPtr<ID3D11RenderTargetView> m_sceneTargetView;
+    ComPtr<ID3D11ShaderResourceView> m_sceneTargetResource;
+    ComPtr<ID3D11VertexShader> m_upscaleVertexShader;
+    ComPtr<ID3D11PixelShader> m_upscalePixelShader;
+    ComPtr<ID3D11Buffer> m_upscaleConstantBuffer;
+    ComPtr<ID3D11SamplerState> m_upscaleSampler;
+    ComPtr<ID3D11DepthStencilState> m_upscaleDepthState;
+    DynamicResolution m_dynamicResolution;
+    bool m_dynamicResolutionEnabled;
+    int m_sceneWidth;
+    int m_sceneHeight;
+
+    // Scene pass timestamps, read back a few frames later without stalling
+    struct SceneTimer {
+        ComPtr<ID3D11Query> disjoint;
+        ComPtr<ID3D11Query> begin;
+        ComPtr<ID3D11Query> end;
+        bool pending;
+    };
+    SceneTimer m_sceneTimers[4];
+    uint32_t m_sceneTimerFrame;
+
+    // Clustered point lighting; absent below feature level 11_0
+    ClusteredLighting m_clusteredLighting;
+    std::vector<PointLight> m_lights;
+    uint32_t m_sceneShader;                            // Lit when available, otherwise vertex color
+    ComPtr<ID3D11Buffer> m_lightConstantBuffer;        // Directional light, b1
+    ComPtr<ID3D11Buffer> m_clusterConstantBuffer;      // Grid parameters, b2
+    ComPtr<ID3D11Buffer> m_lightDataBuffer;
+    ComPtr<ID3D11Buffer> m_clusterBuffer;
+    ComPtr<ID3D11Buffer> m_lightIndexBuffer;
+    ComPtr<ID3D11ShaderResourceView> m_lightingViews[3];  // t0 lights, t1 clusters, t2 indices
+
+    // Rigid boxes, read from the game's physics world each frame
+    const PhysicsWorld* m_physics;
+    uint32_t m_firstPhysicsBody;
+
+    // Attached and moving objects, updated by the game before Render
+    const SceneGraph* m_sceneGraph;
+
+    RenderCapture* m_capture;
+
+    // EndScene time, Present included
+    MetricsRegistry* m_metrics;
+    uint32_t m_endSceneMetric;
+
+    // Particle billboards, read from the game's particle system each frame
+    const ParticleSystem* m_particles;
+    ComPtr<ID3D11VertexShader> m_particleVertexShader;
+    ComPtr<ID3D11PixelShader> m_particlePixelShader;
+    ComPtr<ID3D11InputLayout> m_particleInputLayout;
+    ComPtr<ID3D11Buffer> m_particleInstanceBuffer;  // Dynamic, rewritten for every type
+    ComPtr<ID3D11Buffer> m_particleConstantBuffer;
+    ComPtr<ID3D11BlendState> m_particleAdditiveBlend;
+    ComPtr<ID3D11BlendState> m_particleAlphaBlend;
+    ComPtr<ID3D11DepthStencilState> m_particleDepthState;  // Depth test without writes
+
+    // Draw submission
+    struct ShaderProgram {
+        ComPtr<ID3D11VertexShader> vertexShader;
+        ComPtr<ID3D11PixelShader> pixelShader;
+        ComPtr<ID3D11InputLayout> inputLayout;
+    };
+    struct Material {
+        ComPtr<ID3D11BlendState> blendState;  // Null for opaque
+    };
+    struct Mesh {
+        ComPtr<ID3D11Buffer> vertexBuffer;
+        ComPtr<ID3D11Buffer> indexBuffer;
+        UINT stride;
+        std::vector<MeshLod> lods;  // Ranges of the shared index buffer, finest first
+    };
+    std::vector<ShaderProgram> m_shaders;
+    std::vector<Material> m_materials;
+    std::vector<Mesh> m_meshes;
+    RenderQueue m_renderQueue;
+    OcclusionCuller m_occlusionCuller;
+    LodSelector m_lodSelector;
+    std::vector<uint32_t> m_objectLods;   // LOD each scene object used last frame
+    const WorldStreamer* m_world;
+    DirectX::XMMATRIX m_frameView;        // Transposed
+    DirectX::XMMATRIX m_frameProjection;
+
+    // Records a slice of the sorted queue into one device context. Deferred
+    // recorders write their own draw constants and finish into a command list.
+    class ContextRecorder : public RenderBackend {
+    public:
+        ContextRecorder();
+
+        void Prepare(Renderer* renderer, ID3D11DeviceContext* context, size_t drawCount, bool writeConstants);
+
+        void BeginRange() override;
+        void EndRange() override;
+        void SetShader(uint32_t shader) override;
+        void SetMaterial(uint32_t material) override;
+        void SetMesh(uint32_t mesh) override;
+        void Draw(const DrawItem& item) override;
+
+        ComPtr<ID3D11DeviceContext> context;
+        ComPtr<ID3D11DeviceContext1> context1;
+        ComPtr<ID3D11CommandList> commandList;
+
+    private:
+        Renderer* m_renderer;
+        const Mesh* m_currentMesh;
+        D3D11ConstantRing::Allocation m_constants;
+        bool m_hasConstants;
+        bool m_writeConstants;
+        UINT m_drawIndex;
+    };
+    JobSystem m_jobSystem;
+    FrameArena m_frameArena;
+    ContextRecorder m_immediateRecorder;
+    std::vector<ContextRecorder> m_deferredRecorders;
+    std::vector<RenderBackend*> m_recorderPointers;
+    RecordStats m_recordStats;
 
     // Window properties
     HWND m_hwnd;
     int m_width;
     int m_height;
 
-    // Initialize DirectX components
+    // Initialize DirectX components; failures throw with the call and HRESULT as the stage's cause
     bool InitializeDevice();
     bool InitializeRenderTarget();
     bool InitializeDepthStencil();
     bool InitializeRasterizerState();
     bool InitializeShaders();
     bool InitializeConstantBuffer();
+    bool InitializeMaterials();
+    bool InitializeMeshes();
+    bool InitializeRecorders();
+    bool InitializeLighting();
+    bool InitializeDynamicResolution();
+    bool InitializeParticles();
+    void CreateStructuredBuffer(const char* name, UINT stride, UINT count, ComPtr<ID3D11Buffer>& buffer,
+                                ComPtr<ID3D11ShaderResourceView>& view);
+
+    // Scene submission
+    void SubmitScene(Camera* camera);
+    void SubmitWorld(Camera* camera);
+    void SubmitPhysics(Camera* camera);
+    void SubmitSceneGraph(Camera* camera);
+    void SubmitDraw(Camera* camera, uint32_t mesh, uint32_t lod, uint32_t material, const DirectX::XMMATRIX& world);
+    // Builds the LOD chain offline; vertices must start with a float3 position
+    void CreateMesh(const char* name, const void* vertices, UINT vertexCount, UINT stride,
+                    const UINT* indices, UINT indexCount, Mesh& mesh);
+    void WriteDrawConstants(const DrawItem& item, void* destination) const;
+    void BindSceneState(ID3D11DeviceContext* context);
+    void BindBackBuffer();
+    void RenderScene(Camera* camera);
+    void RenderParticles(Camera* camera);
+    void UpscaleScene();
+    void ReadSceneTimers();
+    void UploadLights(Camera* camera);
+    void WriteBuffer(ID3D11Buffer* buffer, const void* data, size_t size);
 
-    // Shader compilation helper
-    bool CompileShaderFromFile(const WCHAR* filename, const char* entryPoint, 
+    // Shader compilation helper; #include "VertexLayout.hlsli" is served from SceneVertexLayout.
+    // Throws with the compiler log on failure.
+    void CompileShaderFromFile(const WCHAR* filename, const char* entryPoint, 
                              const char* shaderModel, ID3DBlob** blob);
 
+    // Constants
+    static constexpr UINT CONSTANT_RING_SIZE = 4 * 1024 * 1024;  // Initial; grows when a frame needs more
+
+    static constexpr UINT CONSTANTS_PER_DRAW = 16;       // ConstantBuffer rounded to the 256-byte offset granularity
+    static constexpr size_t PARALLEL_RECORD_MIN_DRAWS = 2048;
+    static constexpr size_t DRAWS_PER_RECORDER = 1024;
+    static constexpr uint32_t OCCLUSION_WIDTH = 256;
+    static constexpr uint32_t OCCLUSION_HEIGHT = 128;
+    static constexpr float LOD_PIXEL_ERROR = 1.0f;
+    static constexpr uint32_t CLUSTER_TILES_X = 16;
+    static constexpr uint32_t CLUSTER_TILES_Y = 9;
+    static constexpr uint32_t CLUSTER_SLICES = 24;
+    static constexpr float SCENE_TARGET_MILLISECONDS = 14.0f;   // GPU budget for the scene pass at 60 Hz
+    static constexpr float MIN_SCENE_SCALE = 0.5f;
+    static constexpr uint32_t RESOLUTION_TRACE_FRAMES = 60 * 60;
+    static constexpr uint32_t PARTICLE_INSTANCE_CAPACITY = 65536;  // Per type per frame; the rest are not drawn
+
     struct ConstantBuffer {
         DirectX::XMMATRIX world;
         DirectX::XMMATRIX view;
         DirectX::XMMATRIX projection;
     };
+
+    struct UpscaleConstants {
+        DirectX::XMFLOAT2 uvScale;   // Rendered fraction of the scene target
+        DirectX::XMFLOAT2 uvMax;     // Last texel centre inside it, so filtering never reads outside
+    };
+
+    struct ParticleConstants {
+        DirectX::XMMATRIX viewProjection;  // Transposed
+        DirectX::XMFLOAT3 cameraRight;
+        float padding0;
+        DirectX::XMFLOAT3 cameraUp;
+        float padding1;
+    };
+
+    struct LightConstants {
+        DirectX::XMFLOAT3 lightDirection;
+        float lightIntensity;
+        DirectX::XMFLOAT3 ambientColor;
+        float ambientIntensity;
+    };
+
+    // Position first: CreateMesh reads it as a Float3 for the LOD chain
+    using SceneVertex = SceneVertexLayout::Vertex;
+    static_assert(SceneVertexLayout::ELEMENTS[0].semantic == VertexSemantic::Position &&
+                  SceneVertexLayout::ELEMENTS[0].format == VertexFormat::Float3, "Scene vertices must start with a Float3 position");
 };
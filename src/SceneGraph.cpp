@@ -0,0 +1,173 @@
+#include "SceneGraph.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <chrono>
+
+SceneGraph::SceneGraph() :
+    m_useSimd(IsSimdSupported()),
+    m_stats() {
+}
+
+SceneGraph::~SceneGraph() {
+}
+
+void SceneGraph::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+bool SceneGraph::IsSimdSupported() {
+    return CpuHasAvx2();
+}
+
+uint32_t SceneGraph::AddNode(uint32_t parent, const Float4x4& local, uint32_t userData) {
+    uint32_t node = static_cast<uint32_t>(m_nodes.size());
+    uint32_t parentSlot = parent == INVALID_NODE ? INVALID_NODE : m_slots[parent];
+    uint32_t slot = parentSlot == INVALID_NODE ? node : parentSlot + m_subtreeSizes[parentSlot];
+
+    m_local.insert(m_local.begin() + slot, local);
+    m_world.insert(m_world.begin() + slot, local);
+    m_parents.insert(m_parents.begin() + slot, parentSlot);
+    m_subtreeSizes.insert(m_subtreeSizes.begin() + slot, 1);
+    m_nodes.insert(m_nodes.begin() + slot, node);
+    m_userData.insert(m_userData.begin() + slot, userData);
+    m_slots.push_back(slot);
+    m_dirty.push_back(0);
+
+    // Everything after the new slot moved up by one
+    if (slot + 1 < m_nodes.size()) {
+        for (uint32_t i = slot + 1; i < m_nodes.size(); ++i) {
+            m_slots[m_nodes[i]] = i;
+            if (m_parents[i] != INVALID_NODE && m_parents[i] >= slot) m_parents[i]++;
+        }
+    }
+    for (uint32_t ancestor = parentSlot; ancestor != INVALID_NODE; ancestor = m_parents[ancestor]) {
+        m_subtreeSizes[ancestor]++;
+    }
+
+    m_dirty[node] = 1;
+    m_dirtyNodes.push_back(node);
+    return node;
+}
+
+void SceneGraph::Clear() {
+    m_local.clear();
+    m_world.clear();
+    m_parents.clear();
+    m_subtreeSizes.clear();
+    m_nodes.clear();
+    m_userData.clear();
+    m_slots.clear();
+    m_dirty.clear();
+    m_dirtyNodes.clear();
+}
+
+uint32_t SceneGraph::GetParent(uint32_t node) const {
+    uint32_t parentSlot = m_parents[m_slots[node]];
+    return parentSlot == INVALID_NODE ? INVALID_NODE : m_nodes[parentSlot];
+}
+
+void SceneGraph::SetLocal(uint32_t node, const Float4x4& local) {
+    m_local[m_slots[node]] = local;
+    if (!m_dirty[node]) {
+        m_dirty[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+void SceneGraph::Update() {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.nodes = static_cast<uint32_t>(m_nodes.size());
+    m_stats.dirtyNodes = static_cast<uint32_t>(m_dirtyNodes.size());
+    m_stats.ranges = 0;
+    m_stats.recomputed = 0;
+
+    m_dirtySlots.clear();
+    for (uint32_t node : m_dirtyNodes) {
+        m_dirtySlots.push_back(m_slots[node]);
+        m_dirty[node] = 0;
+    }
+    m_dirtyNodes.clear();
+
+    // Subtrees nest, so a dirty slot inside the last range is already covered
+    std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+    uint32_t rangeEnd = 0;
+    for (uint32_t slot : m_dirtySlots) {
+        if (slot < rangeEnd) continue;
+        rangeEnd = slot + m_subtreeSizes[slot];
+        ComputeRange(slot, rangeEnd);
+        m_stats.ranges++;
+        m_stats.recomputed += rangeEnd - slot;
+    }
+
+    m_stats.skipped = m_stats.nodes - m_stats.recomputed;
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneGraph::UpdateAll() {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t node : m_dirtyNodes) m_dirty[node] = 0;
+    m_stats.dirtyNodes = static_cast<uint32_t>(m_dirtyNodes.size());
+    m_dirtyNodes.clear();
+
+    uint32_t count = static_cast<uint32_t>(m_nodes.size());
+    ComputeRange(0, count);
+    m_stats.nodes = count;
+    m_stats.ranges = count > 0 ? 1 : 0;
+    m_stats.recomputed = count;
+    m_stats.skipped = 0;
+    m_stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneGraph::ComputeRange(uint32_t begin, uint32_t end) {
+#if FPSGAME_AVX2
+    if (m_useSimd) {
+        ComputeRangeSimd(begin, end);
+        return;
+    }
+#endif
+    ComputeRangeScalar(begin, end);
+}
+
+void SceneGraph::ComputeRangeScalar(uint32_t begin, uint32_t end) {
+    // Parents precede children, so each parent's world is final by the time it is read
+    for (uint32_t slot = begin; slot < end; ++slot) {
+        uint32_t parent = m_parents[slot];
+        m_world[slot] = parent == INVALID_NODE ? m_local[slot] : Multiply(m_local[slot], m_world[parent]);
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void SceneGraph::ComputeRangeSimd(uint32_t begin, uint32_t end) {
+    for (uint32_t slot = begin; slot < end; ++slot) {
+        uint32_t parent = m_parents[slot];
+        const float* a = &m_local[slot].m[0][0];
+        float* result = &m_world[slot].m[0][0];
+        if (parent == INVALID_NODE) {
+            _mm256_storeu_ps(result, _mm256_loadu_ps(a));
+            _mm256_storeu_ps(result + 8, _mm256_loadu_ps(a + 8));
+            continue;
+        }
+
+        // Each parent row in both halves; an in-lane permute spreads a local
+        // element across its own row's half, so one register does two rows
+        const Float4x4& b = m_world[parent];
+        __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[0]));
+        __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[1]));
+        __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[2]));
+        __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b.m[3]));
+        for (int rows = 0; rows < 2; ++rows) {
+            __m256 ab = _mm256_loadu_ps(a + rows * 8);
+            __m256 sum = _mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(ab, 0x00), b0),
+                                       _mm256_mul_ps(_mm256_permute_ps(ab, 0x55), b1));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_permute_ps(ab, 0xAA), b2));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_permute_ps(ab, 0xFF), b3));
+            _mm256_storeu_ps(result + rows * 8, sum);
+        }
+    }
+}
+#else
+void SceneGraph::ComputeRangeSimd(uint32_t begin, uint32_t end) {
+    ComputeRangeScalar(begin, end);
+}
+#endif
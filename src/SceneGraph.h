@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// Transform hierarchy for things that move together: a weapon held in front
+// of the camera, props riding a moving platform. Nodes live in flat arrays in
+// depth-first order, so every parent comes before its children and each
+// node's subtree is the contiguous run of slots after it. Node ids stay fixed
+// while slots move as nodes are inserted.
+//
+// SetLocal only marks the node dirty. Update merges the dirty nodes into
+// disjoint subtree ranges and recomputes world = local * parent world over
+// each range, front to back; everything outside them is skipped. The
+// multiply has an AVX2 path (two rows per register) and a scalar path that
+// add the products in the same order, so both give identical matrices.
+class SceneGraph {
+public:
+    struct Stats {
+        uint32_t nodes;
+        uint32_t dirtyNodes;        // Nodes given a new local transform since the last Update
+        uint32_t ranges;            // Disjoint subtrees recomputed
+        uint32_t recomputed;        // World matrices rebuilt, dirty nodes and their descendants
+        uint32_t skipped;           // Clean nodes left alone
+        double updateMilliseconds;
+    };
+
+    SceneGraph();
+    ~SceneGraph();
+
+    // parent is INVALID_NODE for a root. Building depth first (a node, then
+    // its whole subtree) only ever appends; inserting into an earlier subtree
+    // moves every slot after it. userData is the owner's, e.g. the mesh the
+    // node draws.
+    uint32_t AddNode(uint32_t parent, const Float4x4& local, uint32_t userData = NO_USER_DATA);
+    void Clear();
+
+    void SetLocal(uint32_t node, const Float4x4& local);
+    const Float4x4& GetLocal(uint32_t node) const { return m_local[m_slots[node]]; }
+    // As of the last Update
+    const Float4x4& GetWorld(uint32_t node) const { return m_world[m_slots[node]]; }
+    uint32_t GetParent(uint32_t node) const;
+    uint32_t GetUserData(uint32_t node) const { return m_userData[m_slots[node]]; }
+    uint32_t GetNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+
+    // Slot order, parents first; nodes with no user data are transforms only
+    uint32_t GetNodeAtSlot(uint32_t slot) const { return m_nodes[slot]; }
+    const Float4x4* GetWorldMatrices() const { return m_world.data(); }
+    const uint32_t* GetSlotUserData() const { return m_userData.data(); }
+
+    void Update();
+    // Recomputes every node, dirty or not
+    void UpdateAll();
+    const Stats& GetStats() const { return m_stats; }
+
+    // Switches between the AVX2 and scalar paths; ignored if AVX2 is unavailable
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    // Constants
+    static constexpr uint32_t INVALID_NODE = 0xFFFFFFFF;
+    static constexpr uint32_t NO_USER_DATA = 0xFFFFFFFF;
+
+private:
+    // Indexed by slot
+    std::vector<Float4x4> m_local;
+    std::vector<Float4x4> m_world;
+    std::vector<uint32_t> m_parents;        // Parent's slot, or INVALID_NODE
+    std::vector<uint32_t> m_subtreeSizes;   // The node itself and every descendant
+    std::vector<uint32_t> m_nodes;          // Node id in each slot
+    std::vector<uint32_t> m_userData;
+
+    // Indexed by node id
+    std::vector<uint32_t> m_slots;
+    std::vector<uint8_t> m_dirty;
+
+    std::vector<uint32_t> m_dirtyNodes;
+    std::vector<uint32_t> m_dirtySlots;     // Scratch for Update
+    bool m_useSimd;
+    Stats m_stats;
+
+    void ComputeRange(uint32_t begin, uint32_t end);
+    void ComputeRangeScalar(uint32_t begin, uint32_t end);
+    void ComputeRangeSimd(uint32_t begin, uint32_t end);
+};
@@ -0,0 +1,246 @@
+#include "Simulation.h"
+#include <cfenv>
+#include <cfloat>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define SIMULATION_X86 1
+#endif
+
+// x87 arithmetic keeps intermediates in extended precision, so results would
+// depend on register allocation; the simulation needs SSE floating point
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+#error "Simulation requires FLT_EVAL_METHOD == 0 (SSE floating point)"
+#endif
+
+namespace {
+
+const float PI = 3.14159265f;
+const float TWO_PI = 6.28318531f;
+const float HALF_PI = 1.57079633f;
+
+// MXCSR fields
+const uint32_t CSR_EXCEPTION_MASKS = 0x1F80;
+const uint32_t CSR_ROUNDING = 0x6000;
+const uint32_t CSR_FLUSH_TO_ZERO = 0x8000;
+const uint32_t CSR_DENORMALS_ARE_ZERO = 0x0040;
+
+// Into [-pi, pi) for angles within one turn of it
+float WrapAngle(float radians) {
+    if (radians >= PI) radians -= TWO_PI;
+    if (radians < -PI) radians += TWO_PI;
+    return radians;
+}
+
+void Mix(uint64_t& hash, uint32_t word) {
+    for (int byte = 0; byte < 4; ++byte) {
+        hash ^= (word >> (byte * 8)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+}
+
+void Mix(uint64_t& hash, float value) {
+    uint32_t bits;
+    static_assert(sizeof(bits) == sizeof(value), "float must be 32 bits");
+    memcpy(&bits, &value, sizeof(bits));
+    Mix(hash, bits);
+}
+
+} // namespace
+
+FloatEnvironmentScope::FloatEnvironmentScope() :
+    m_rounding(fegetround()),
+    m_controlStatus(0) {
+    fesetround(FE_TONEAREST);
+#ifdef SIMULATION_X86
+    m_controlStatus = _mm_getcsr();
+    _mm_setcsr((m_controlStatus & ~(CSR_ROUNDING | CSR_FLUSH_TO_ZERO | CSR_DENORMALS_ARE_ZERO)) | CSR_EXCEPTION_MASKS);
+#endif
+}
+
+FloatEnvironmentScope::~FloatEnvironmentScope() {
+#ifdef SIMULATION_X86
+    _mm_setcsr(m_controlStatus);
+#endif
+    fesetround(m_rounding);
+}
+
+Simulation::Simulation() :
+    m_tick(0) {
+}
+
+Simulation::~Simulation() {
+}
+
+bool Simulation::Initialize(uint32_t playerCount) {
+    if (playerCount == 0) return false;
+    m_players.resize(playerCount);
+    for (uint32_t player = 0; player < playerCount; ++player) {
+        m_players[player] = SpawnPlayer(player);
+    }
+    m_fired.assign(playerCount, 0);
+    m_tick = 0;
+    return true;
+}
+
+Simulation::PlayerState Simulation::SpawnPlayer(uint32_t player) {
+    // Pairs facing each other across a gap, the pairs spread along x
+    PlayerState state = {};
+    state.position = { static_cast<float>(player / 2) * SPAWN_SPACING, 0.0f, (player & 1) ? 2.0f * SPAWN_SPACING : 0.0f };
+    state.yaw = (player & 1) ? PI : 0.0f;
+    state.health = MAX_HEALTH;
+    state.ammo = MAX_AMMO;
+    state.grounded = true;
+    return state;
+}
+
+float Simulation::Sine(float radians) {
+    // Fold into [-pi/2, pi/2], where the Taylor series to x^11 is within 6e-8
+    float x = WrapAngle(radians);
+    if (x > HALF_PI) x = PI - x;
+    if (x < -HALF_PI) x = -PI - x;
+    float x2 = x * x;
+    return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f +
+               x2 * (1.0f / 362880.0f + x2 * (-1.0f / 39916800.0f))))));
+}
+
+float Simulation::Cosine(float radians) {
+    return Sine(WrapAngle(radians) + HALF_PI);
+}
+
+Float3 Simulation::GetForward(const PlayerState& state) {
+    // Matches the camera: yaw about y, then pitch about the rotated x axis
+    float cosinePitch = Cosine(state.pitch);
+    return { Sine(state.yaw) * cosinePitch, -Sine(state.pitch), Cosine(state.yaw) * cosinePitch };
+}
+
+bool Simulation::StepPlayer(PlayerState& state, const PlayerCommand& command, uint32_t tick) {
+    if (state.health <= 0.0f) return false;
+
+    state.pitch -= static_cast<float>(command.lookY) * LOOK_RADIANS_PER_COUNT;
+    state.yaw -= static_cast<float>(command.lookX) * LOOK_RADIANS_PER_COUNT;
+    if (state.pitch > HALF_PI) state.pitch = HALF_PI;
+    if (state.pitch < -HALF_PI) state.pitch = -HALF_PI;
+    while (state.yaw >= TWO_PI) state.yaw -= TWO_PI;
+    while (state.yaw < 0.0f) state.yaw += TWO_PI;
+
+    // Walking on the ground plane, turned by yaw; diagonals are no faster
+    float forward = static_cast<float>(command.forward < 0 ? -1 : (command.forward > 0 ? 1 : 0));
+    float right = static_cast<float>(command.right < 0 ? -1 : (command.right > 0 ? 1 : 0));
+    float speed = forward != 0.0f && right != 0.0f ? MOVE_SPEED * 0.70710678f : MOVE_SPEED;
+    float sine = Sine(state.yaw), cosine = Cosine(state.yaw);
+    state.velocity.x = (right * cosine + forward * sine) * speed;
+    state.velocity.z = (forward * cosine - right * sine) * speed;
+
+    if ((command.buttons & BUTTON_JUMP) && state.grounded) {
+        state.velocity.y = JUMP_SPEED;
+        state.grounded = false;
+    }
+    if (!state.grounded) {
+        state.velocity.y += GRAVITY * TICK_SECONDS;
+    }
+    state.position.x += state.velocity.x * TICK_SECONDS;
+    state.position.y += state.velocity.y * TICK_SECONDS;
+    state.position.z += state.velocity.z * TICK_SECONDS;
+    if (state.position.y <= 0.0f) {
+        state.position.y = 0.0f;
+        state.velocity.y = 0.0f;
+        state.grounded = true;
+    }
+
+    if (!(command.buttons & BUTTON_FIRE) || state.ammo <= 0 || tick < state.nextShotTick) return false;
+    state.ammo--;
+    state.nextShotTick = tick + SHOT_COOLDOWN_TICKS;
+    return true;
+}
+
+uint32_t Simulation::FindShotTarget(uint32_t shooter) const {
+    const PlayerState& from = m_players[shooter];
+    Float3 direction = GetForward(from);
+    uint32_t target = GetPlayerCount();
+    float nearest = SHOT_RANGE;
+    for (uint32_t player = 0; player < GetPlayerCount(); ++player) {
+        const PlayerState& other = m_players[player];
+        if (player == shooter || other.health <= 0.0f) continue;
+
+        // Slab test against the hit box
+        const float low[3] = { other.position.x - BODY_HALF_WIDTH, other.position.y - BODY_BELOW_EYE,
+                               other.position.z - BODY_HALF_WIDTH };
+        const float high[3] = { other.position.x + BODY_HALF_WIDTH, other.position.y + BODY_ABOVE_EYE,
+                                other.position.z + BODY_HALF_WIDTH };
+        const float origin[3] = { from.position.x, from.position.y, from.position.z };
+        const float step[3] = { direction.x, direction.y, direction.z };
+        float enter = 0.0f, exit = nearest;
+        for (int axis = 0; axis < 3 && enter <= exit; ++axis) {
+            if (step[axis] == 0.0f) {
+                if (origin[axis] < low[axis] || origin[axis] > high[axis]) exit = -1.0f;
+                continue;
+            }
+            float a = (low[axis] - origin[axis]) / step[axis];
+            float b = (high[axis] - origin[axis]) / step[axis];
+            if (a > b) {
+                float swap = a;
+                a = b;
+                b = swap;
+            }
+            if (a > enter) enter = a;
+            if (b < exit) exit = b;
+        }
+        if (enter <= exit && enter < nearest) {
+            nearest = enter;
+            target = player;
+        }
+    }
+    return target;
+}
+
+void Simulation::Step(const PlayerCommand* commands) {
+    FloatEnvironmentScope environment;
+
+    // Everyone moves first, then shots are resolved against the new positions in player order
+    for (uint32_t player = 0; player < GetPlayerCount(); ++player) {
+        PlayerState& state = m_players[player];
+        if (state.health <= 0.0f && m_tick >= state.respawnTick) {
+            uint32_t kills = state.kills;
+            state = SpawnPlayer(player);
+            state.kills = kills;
+        }
+        m_fired[player] = StepPlayer(state, commands[player], m_tick) ? 1 : 0;
+    }
+    for (uint32_t player = 0; player < GetPlayerCount(); ++player) {
+        if (!m_fired[player]) continue;
+        uint32_t target = FindShotTarget(player);
+        if (target == GetPlayerCount()) continue;
+        PlayerState& victim = m_players[target];
+        victim.health -= SHOT_DAMAGE;
+        if (victim.health <= 0.0f) {
+            victim.velocity = { 0.0f, 0.0f, 0.0f };
+            victim.respawnTick = m_tick + RESPAWN_TICKS;
+            m_players[player].kills++;
+        }
+    }
+    m_tick++;
+}
+
+uint64_t Simulation::Checksum() const {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    Mix(hash, m_tick);
+    for (const PlayerState& state : m_players) {
+        Mix(hash, state.position.x);
+        Mix(hash, state.position.y);
+        Mix(hash, state.position.z);
+        Mix(hash, state.velocity.x);
+        Mix(hash, state.velocity.y);
+        Mix(hash, state.velocity.z);
+        Mix(hash, state.pitch);
+        Mix(hash, state.yaw);
+        Mix(hash, state.health);
+        Mix(hash, static_cast<uint32_t>(state.ammo));
+        Mix(hash, state.nextShotTick);
+        Mix(hash, state.respawnTick);
+        Mix(hash, state.kills);
+        Mix(hash, state.grounded ? 1u : 0u);
+    }
+    return hash;
+}
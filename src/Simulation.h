@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MathTypes.h"
+
+// Sets the floating-point environment the simulation depends on for its
+// lifetime: round to nearest, denormals kept (no flush-to-zero or
+// denormals-are-zero) and exceptions masked. The caller's settings come back
+// at the end of the scope.
+class FloatEnvironmentScope {
+public:
+    FloatEnvironmentScope();
+    ~FloatEnvironmentScope();
+
+    FloatEnvironmentScope(const FloatEnvironmentScope&) = delete;
+    FloatEnvironmentScope& operator=(const FloatEnvironmentScope&) = delete;
+
+private:
+    int m_rounding;
+    uint32_t m_controlStatus;   // MXCSR on x86
+};
+
+// Gameplay state advanced in fixed ticks from per-player commands, and
+// nothing else: time is the tick index, cooldowns are tick deadlines, and no
+// clock is read. Given the same commands, every build gives bit-identical
+// state. The math is plain IEEE single precision in a fixed environment
+// (FloatEnvironmentScope), with no fused multiply-adds (the build disables
+// contraction) and sine and cosine computed here rather than by the C
+// library, whose results differ between platforms. Checksum hashes the state
+// so peers in lockstep, or a replay, can compare one number per tick instead
+// of the whole state.
+class Simulation {
+public:
+    enum Button : uint8_t {
+        BUTTON_JUMP = 1 << 0,   // Set on the tick the key went down
+        BUTTON_FIRE = 1 << 1,   // Held
+    };
+
+    // One player's input for one tick, already quantized so it can be recorded exactly
+    struct PlayerCommand {
+        int8_t forward;     // -1, 0 or 1
+        int8_t right;
+        uint8_t buttons;
+        int16_t lookX;      // Mouse counts since the last tick
+        int16_t lookY;
+    };
+
+    struct PlayerState {
+        Float3 position;    // Eye position; the ground is at y = 0
+        Float3 velocity;
+        float pitch;        // Radians, positive looks down
+        float yaw;          // Radians in [0, 2 pi), 0 faces +z
+        float health;
+        int32_t ammo;
+        uint32_t nextShotTick;
+        uint32_t respawnTick;   // While dead
+        uint32_t kills;
+        bool grounded;
+    };
+
+    Simulation();
+    ~Simulation();
+
+    bool Initialize(uint32_t playerCount);
+
+    // Advances one tick with one command per player, in player order
+    void Step(const PlayerCommand* commands);
+
+    uint32_t GetTick() const { return m_tick; }
+    uint32_t GetPlayerCount() const { return static_cast<uint32_t>(m_players.size()); }
+    const PlayerState& GetPlayer(uint32_t player) const { return m_players[player]; }
+
+    // FNV-1a over every state field's bits, in a fixed order
+    uint64_t Checksum() const;
+
+    // Spawn state for the player'th slot
+    static PlayerState SpawnPlayer(uint32_t player);
+    // Look, movement and the shot cooldown for one player; returns whether the player fired.
+    // Hits are resolved by Step, so a lone player can be driven with this alone.
+    static bool StepPlayer(PlayerState& state, const PlayerCommand& command, uint32_t tick);
+    // Unit view direction from pitch and yaw
+    static Float3 GetForward(const PlayerState& state);
+    // Platform-independent sine and cosine, accurate to about 1e-7
+    static float Sine(float radians);
+    static float Cosine(float radians);
+
+    // Constants
+    static constexpr uint32_t TICK_RATE = 60;
+    static constexpr float TICK_SECONDS = 1.0f / TICK_RATE;
+    static constexpr float MOVE_SPEED = 5.0f;           // Metres per second
+    static constexpr float JUMP_SPEED = 5.0f;
+    static constexpr float GRAVITY = -9.81f;
+    static constexpr float LOOK_RADIANS_PER_COUNT = 0.003f;
+    static constexpr float MAX_HEALTH = 100.0f;
+    static constexpr int32_t MAX_AMMO = 30;
+    static constexpr uint32_t SHOT_COOLDOWN_TICKS = 6;  // 0.1 s
+    static constexpr uint32_t RESPAWN_TICKS = 3 * TICK_RATE;
+    static constexpr float SHOT_DAMAGE = 25.0f;
+    static constexpr float SHOT_RANGE = 100.0f;
+
+private:
+    std::vector<PlayerState> m_players;
+    std::vector<uint8_t> m_fired;
+    uint32_t m_tick;
+
+    // Nearest other living player the shot's ray meets, or the player count for none
+    uint32_t FindShotTarget(uint32_t shooter) const;
+
+    // Constants
+    static constexpr float SPAWN_SPACING = 4.0f;
+    static constexpr float BODY_HALF_WIDTH = 0.4f;      // Hit box around the eye
+    static constexpr float BODY_BELOW_EYE = 1.6f;
+    static constexpr float BODY_ABOVE_EYE = 0.2f;
+};
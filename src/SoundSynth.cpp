@@ -0,0 +1,56 @@
+#include "SoundSynth.h"
+#include <cmath>
+
+namespace {
+
+// Uniform in [-1, 1)
+float Noise(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+} // namespace
+
+std::vector<float> SynthesizeGunshot(uint32_t sampleRate) {
+    const float PI = 3.14159265f;
+    std::vector<float> samples(static_cast<size_t>(sampleRate * 0.4f));
+    uint32_t state = 0x9E3779B9u;
+    float phase = 0.0f;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float t = static_cast<float>(i) / sampleRate;
+        // The thump drops in pitch from 120 Hz to 50 Hz
+        phase += 2.0f * PI * (50.0f + 70.0f * std::exp(-t * 30.0f)) / sampleRate;
+        float crack = Noise(state) * std::exp(-t * 40.0f);
+        float thump = std::sin(phase) * std::exp(-t * 12.0f);
+        samples[i] = 0.6f * crack + 0.5f * thump;
+    }
+    return samples;
+}
+
+std::vector<float> SynthesizeFootstep(uint32_t sampleRate, uint32_t seed) {
+    std::vector<float> samples(static_cast<size_t>(sampleRate * 0.15f));
+    uint32_t state = seed * 2654435761u + 1;
+    float filtered = 0.0f;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float t = static_cast<float>(i) / sampleRate;
+        // One-pole low-pass takes the hiss out of the noise
+        filtered += 0.15f * (Noise(state) - filtered);
+        float envelope = (1.0f - std::exp(-t * 400.0f)) * std::exp(-t * 35.0f);
+        samples[i] = 1.2f * filtered * envelope;
+    }
+    return samples;
+}
+
+std::vector<float> SynthesizeImpact(uint32_t sampleRate) {
+    std::vector<float> samples(static_cast<size_t>(sampleRate * 0.2f));
+    uint32_t state = 0x85EBCA6Bu;
+    float previous = 0.0f;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float t = static_cast<float>(i) / sampleRate;
+        // Differencing the noise tilts it towards high frequencies
+        float noise = Noise(state);
+        samples[i] = 0.5f * (noise - previous) * std::exp(-t * 60.0f);
+        previous = noise;
+    }
+    return samples;
+}
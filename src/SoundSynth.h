@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Procedural placeholder effects, mono in [-1, 1], until recorded sounds ship
+
+// Sharp noise crack over a decaying low thump, about 0.4 s
+std::vector<float> SynthesizeGunshot(uint32_t sampleRate);
+// Short low-passed scuff; seeds give slightly different steps
+std::vector<float> SynthesizeFootstep(uint32_t sampleRate, uint32_t seed);
+// Bright crack of a bullet striking something, about 0.2 s
+std::vector<float> SynthesizeImpact(uint32_t sampleRate);
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Each side owns one index and only reads the other's, so a push or
+// pop is a copy and one release store; Push fails instead of blocking when
+// the ring is full. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue {
+public:
+    SpscQueue() : m_mask(0), m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Not thread-safe; call before any Push or Pop
+    bool Initialize(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_slots.reset(new T[size]);
+        m_mask = size - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedHead = 0;
+        m_cachedTail = 0;
+        return true;
+    }
+
+    // Producer thread only
+    bool Push(const T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead > m_mask) {
+            // Looks full from the last known head; refresh it before giving up
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead > m_mask) return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool Pop(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+    std::unique_ptr<T[]> m_slots;
+    size_t m_mask;
+    // Consumer's index and its copy of the producer's, then the reverse, on separate cache lines
+    alignas(64) std::atomic<size_t> m_head;
+    size_t m_cachedTail;
+    alignas(64) std::atomic<size_t> m_tail;
+    size_t m_cachedHead;
+};
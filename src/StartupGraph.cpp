@@ -0,0 +1,233 @@
+#include "StartupGraph.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+StartupGraph::StartupGraph() :
+    m_totalMilliseconds(0.0) {
+}
+
+StartupGraph::StageId StartupGraph::AddStage(const char* name, StageFunction function,
+                                             std::vector<StageId> dependencies, uint32_t flags) {
+    StageId id = static_cast<StageId>(m_stages.size());
+
+    // Dependencies that do not exist yet would allow cycles; they are dropped and Run refuses to start
+    for (StageId dependency : dependencies) {
+        if (dependency >= id) {
+            m_graphError += "Startup stage '" + std::string(name) + "' depends on stage " + std::to_string(dependency) +
+                            ", which was not added before it\n";
+        }
+    }
+    dependencies.erase(std::remove_if(dependencies.begin(), dependencies.end(),
+                                      [id](StageId dependency) { return dependency >= id; }),
+                       dependencies.end());
+
+    Stage stage;
+    stage.name = name;
+    stage.function = std::move(function);
+    stage.dependencies = std::move(dependencies);
+    stage.flags = flags;
+    stage.waitingOn = 0;
+    stage.status = StageStatus::Pending;
+    stage.thread = 0;
+    stage.startMilliseconds = 0.0;
+    stage.endMilliseconds = 0.0;
+    for (StageId dependency : stage.dependencies) {
+        m_stages[dependency].dependents.push_back(id);
+    }
+    m_stages.push_back(std::move(stage));
+    return id;
+}
+
+bool StartupGraph::Run(uint32_t workerCount) {
+    m_start = std::chrono::steady_clock::now();
+    m_error = m_graphError;
+    if (!m_error.empty()) {
+        m_totalMilliseconds = 0.0;
+        return false;
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<StageId> ready;
+    std::deque<StageId> mainReady;
+    size_t remaining = m_stages.size();
+
+    for (StageId id = 0; id < m_stages.size(); ++id) {
+        Stage& stage = m_stages[id];
+        stage.status = StageStatus::Pending;
+        stage.error.clear();
+        stage.waitingOn = static_cast<uint32_t>(stage.dependencies.size());
+        if (stage.waitingOn == 0) {
+            (stage.flags & STAGE_MAIN_THREAD ? mainReady : ready).push_back(id);
+        }
+    }
+
+    // Called with the lock held once a stage has its final status
+    auto complete = [&](StageId finished) {
+        std::vector<StageId> settled = { finished };
+        while (!settled.empty()) {
+            const Stage& stage = m_stages[settled.back()];
+            settled.pop_back();
+            remaining--;
+
+            for (StageId dependentId : stage.dependents) {
+                Stage& dependent = m_stages[dependentId];
+                if (stage.status != StageStatus::Succeeded && dependent.error.empty()) {
+                    dependent.error = "needs '" + stage.name + "'";
+                }
+                if (--dependent.waitingOn > 0) continue;
+
+                if (!dependent.error.empty()) {
+                    dependent.status = StageStatus::Skipped;
+                    dependent.startMilliseconds = dependent.endMilliseconds = Elapsed();
+                    settled.push_back(dependentId);
+                } else {
+                    (dependent.flags & STAGE_MAIN_THREAD ? mainReady : ready).push_back(dependentId);
+                }
+            }
+        }
+        wake.notify_all();
+    };
+
+    auto runStages = [&](uint32_t thread) {
+        const bool mainThread = thread == 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return remaining == 0 || !ready.empty() || (mainThread && !mainReady.empty()); });
+            if (remaining == 0) return;
+
+            std::deque<StageId>& queue = mainThread && !mainReady.empty() ? mainReady : ready;
+            StageId id = queue.front();
+            queue.pop_front();
+
+            lock.unlock();
+            Execute(m_stages[id], thread);
+            lock.lock();
+            complete(id);
+        }
+    };
+
+    if (workerCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    // Fewer workers than asked for only makes startup slower
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        try {
+            workers.emplace_back(runStages, i + 1);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    runStages(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    m_totalMilliseconds = Elapsed();
+
+    std::string skipped;
+    for (const Stage& stage : m_stages) {
+        if (stage.status == StageStatus::Failed) {
+            m_error += "Startup stage '" + stage.name + "' failed: " + stage.error + "\n";
+        } else if (stage.status == StageStatus::Skipped) {
+            skipped += skipped.empty() ? "Skipped: " : ", ";
+            skipped += stage.name + " (" + stage.error + ")";
+        }
+    }
+    if (!skipped.empty()) {
+        m_error += skipped + "\n";
+    }
+    return m_error.empty();
+}
+
+void StartupGraph::Execute(Stage& stage, uint32_t thread) {
+    stage.thread = thread;
+    stage.startMilliseconds = Elapsed();
+
+    bool succeeded = false;
+    try {
+        succeeded = !stage.function || stage.function();
+        if (!succeeded) {
+            stage.error = "returned false";
+        }
+    } catch (const std::exception& e) {
+        stage.error = e.what();
+    } catch (...) {
+        stage.error = "unknown exception";
+    }
+
+    stage.endMilliseconds = Elapsed();
+    stage.status = succeeded ? StageStatus::Succeeded : StageStatus::Failed;
+}
+
+double StartupGraph::Elapsed() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+std::vector<StartupGraph::StageTiming> StartupGraph::GetTimeline() const {
+    std::vector<StageTiming> timeline;
+    timeline.reserve(m_stages.size());
+    for (const Stage& stage : m_stages) {
+        timeline.push_back({ stage.name.c_str(), stage.status, stage.thread,
+                             stage.startMilliseconds, stage.endMilliseconds });
+    }
+    std::stable_sort(timeline.begin(), timeline.end(), [](const StageTiming& a, const StageTiming& b) {
+        return a.startMilliseconds < b.startMilliseconds;
+    });
+    return timeline;
+}
+
+double StartupGraph::GetCriticalPathMilliseconds() const {
+    // Stages are stored in a topological order, so one forward pass suffices
+    std::vector<double> finish(m_stages.size(), 0.0);
+    double longest = 0.0;
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        const Stage& stage = m_stages[i];
+        double start = 0.0;
+        for (StageId dependency : stage.dependencies) {
+            start = (std::max)(start, finish[dependency]);
+        }
+        finish[i] = start + (stage.endMilliseconds - stage.startMilliseconds);
+        longest = (std::max)(longest, finish[i]);
+    }
+    return longest;
+}
+
+std::string StartupGraph::FormatTimeline() const {
+    static const char* const STATUS_NAMES[] = { "pending", "ok", "FAILED", "skipped" };
+
+    size_t nameWidth = 0;
+    for (const Stage& stage : m_stages) {
+        nameWidth = (std::max)(nameWidth, stage.name.size());
+    }
+
+    std::string text;
+    char line[256];
+    double scale = m_totalMilliseconds > 0.0 ? TIMELINE_COLUMNS / m_totalMilliseconds : 0.0;
+    for (const StageTiming& timing : GetTimeline()) {
+        char bar[TIMELINE_COLUMNS + 1];
+        int first = (std::min)(static_cast<int>(timing.startMilliseconds * scale), TIMELINE_COLUMNS - 1);
+        int last = (std::min)(static_cast<int>(timing.endMilliseconds * scale), TIMELINE_COLUMNS - 1);
+        for (int i = 0; i < TIMELINE_COLUMNS; ++i) {
+            bar[i] = i >= first && i <= last ? '#' : '.';
+        }
+        bar[TIMELINE_COLUMNS] = '\0';
+
+        snprintf(line, sizeof(line), "%-*s  t%-2u %8.2f %8.2f ms  %s  %s\n", static_cast<int>(nameWidth), timing.name,
+                 timing.thread, timing.startMilliseconds, timing.endMilliseconds, bar,
+                 STATUS_NAMES[static_cast<int>(timing.status)]);
+        text += line;
+    }
+    snprintf(line, sizeof(line), "total %.2f ms, critical path %.2f ms\n", m_totalMilliseconds,
+             GetCriticalPathMilliseconds());
+    text += line;
+    return text;
+}
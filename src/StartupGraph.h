@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Runs initialization stages concurrently in dependency order. A stage may
+// only depend on stages added before it, so the graph cannot contain cycles;
+// any other dependency is an error, and Run then fails without running anything.
+// Stages report failure by returning false or throwing; the cause is kept,
+// every stage that depends on a failed one is skipped, and independent stages
+// still run so all failures are reported at once. Run records when each stage
+// started and finished on which thread, for the startup timeline.
+class StartupGraph {
+public:
+    using StageId = uint32_t;
+    using StageFunction = std::function<bool()>;
+
+    enum StageFlags : uint32_t {
+        STAGE_ANY_THREAD = 0,
+        STAGE_MAIN_THREAD = 1 << 0  // Needs the thread that calls Run, e.g. for window-affine APIs
+    };
+
+    enum class StageStatus { Pending, Succeeded, Failed, Skipped };
+
+    struct StageTiming {
+        const char* name;
+        StageStatus status;
+        uint32_t thread;           // 0 is the thread that called Run
+        double startMilliseconds;  // From the start of Run
+        double endMilliseconds;
+    };
+
+    StartupGraph();
+
+    // A null function makes a join point that only waits for its dependencies
+    StageId AddStage(const char* name, StageFunction function, std::vector<StageId> dependencies = {},
+                     uint32_t flags = STAGE_ANY_THREAD);
+
+    // workerCount 0 uses one worker per hardware thread besides the caller.
+    // Returns false if the graph is invalid or any stage failed or was skipped.
+    bool Run(uint32_t workerCount = 0);
+
+    StageStatus GetStatus(StageId stage) const { return m_stages[stage].status; }
+
+    // Invalid dependencies, or every failed stage with its cause, then the stages skipped because of them
+    const std::string& GetError() const { return m_error; }
+
+    std::vector<StageTiming> GetTimeline() const;
+    double GetTotalMilliseconds() const { return m_totalMilliseconds; }
+    // Longest chain of dependent stage durations; the lower bound on Run with unlimited threads
+    double GetCriticalPathMilliseconds() const;
+    // One line per stage in start order, with a bar across the run
+    std::string FormatTimeline() const;
+
+private:
+    struct Stage {
+        std::string name;
+        StageFunction function;
+        std::vector<StageId> dependencies;
+        std::vector<StageId> dependents;
+        uint32_t flags;
+        uint32_t waitingOn;
+        StageStatus status;
+        std::string error;
+        uint32_t thread;
+        double startMilliseconds;
+        double endMilliseconds;
+    };
+
+    std::vector<Stage> m_stages;
+    std::string m_error;
+    std::string m_graphError;  // Dependencies rejected by AddStage
+    double m_totalMilliseconds;
+    std::chrono::steady_clock::time_point m_start;
+
+    void Execute(Stage& stage, uint32_t thread);
+    double Elapsed() const;
+
+    // Constants
+    static constexpr int TIMELINE_COLUMNS = 40;
+};
@@ -0,0 +1,172 @@
+#include "TextLayoutCache.h"
+#include <algorithm>
+#include <cstring>
+
+TextLayoutCache::TextLayoutCache() : m_frame(0), m_stats() {
+}
+
+TextLayoutCache::~TextLayoutCache() {
+}
+
+TextLayoutCache::Handle TextLayoutCache::Acquire(const std::string& text, const FontAtlas& font, float scale) {
+    uint64_t key = HashKey(text, font.GetId(), scale);
+
+    auto range = m_lookup.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        Entry& entry = m_entries[it->second];
+        if (entry.fontId == font.GetId() && entry.scale == scale && entry.text == text) {
+            entry.lastUsedFrame = m_frame;
+            entry.references++;
+            m_stats.hits++;
+            return Handle{ it->second, entry.generation };
+        }
+    }
+
+    // Miss: reuse a released slot if one is available
+    uint32_t index;
+    if (!m_freeEntries.empty()) {
+        index = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back();
+        m_entries.back().generation = 0;
+    }
+
+    Entry& entry = m_entries[index];
+    entry.text = text;
+    entry.fontId = font.GetId();
+    entry.scale = scale;
+    entry.key = key;
+    entry.generation++;
+    entry.lastUsedFrame = m_frame;
+    entry.references = 1;
+    entry.inUse = true;
+    BuildLayout(text, font, scale, entry.layout);
+
+    m_lookup.emplace(key, index);
+    m_stats.misses++;
+    m_stats.residentLayouts++;
+    return Handle{ index, entry.generation };
+}
+
+void TextLayoutCache::Release(Handle handle) {
+    if (!IsValid(handle)) return;
+
+    // Kept until it ages out, so text that comes back soon is still a hit
+    Entry& entry = m_entries[handle.index];
+    if (entry.references > 0) {
+        entry.references--;
+        entry.lastUsedFrame = m_frame;
+    }
+}
+
+bool TextLayoutCache::IsValid(Handle handle) const {
+    return handle.index < m_entries.size() &&
+           m_entries[handle.index].inUse &&
+           m_entries[handle.index].generation == handle.generation;
+}
+
+const TextLayoutCache::Layout& TextLayoutCache::Get(Handle handle) {
+    Entry& entry = m_entries[handle.index];
+    entry.lastUsedFrame = m_frame;
+    return entry.layout;
+}
+
+void TextLayoutCache::BeginFrame() {
+    m_frame++;
+    if (m_frame % EVICT_AFTER_FRAMES != 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_entries.size(); ++i) {
+        const Entry& entry = m_entries[i];
+        if (entry.inUse && entry.references == 0 && m_frame - entry.lastUsedFrame > EVICT_AFTER_FRAMES) {
+            Evict(i);
+            m_stats.evictions++;
+        }
+    }
+}
+
+void TextLayoutCache::Clear() {
+    for (uint32_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].inUse) {
+            Evict(i);
+        }
+    }
+}
+
+void TextLayoutCache::Evict(uint32_t index) {
+    Entry& entry = m_entries[index];
+    auto range = m_lookup.equal_range(entry.key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == index) {
+            m_lookup.erase(it);
+            break;
+        }
+    }
+
+    entry.inUse = false;
+    entry.references = 0;
+    entry.text.clear();
+    entry.layout.quads.clear();
+    m_freeEntries.push_back(index);
+    m_stats.residentLayouts--;
+}
+
+uint64_t TextLayoutCache::HashKey(const std::string& text, uint32_t fontId, float scale) {
+    // FNV-1a over the text, then mix in font and scale
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+
+    uint32_t scaleBits;
+    std::memcpy(&scaleBits, &scale, sizeof(scaleBits));
+    hash = (hash ^ fontId) * 1099511628211ull;
+    hash = (hash ^ scaleBits) * 1099511628211ull;
+    return hash;
+}
+
+void TextLayoutCache::BuildLayout(const std::string& text, const FontAtlas& font, float scale, Layout& layout) {
+    layout.quads.clear();
+    layout.quads.reserve(text.size());
+
+    float penX = 0.0f;
+    float penY = 0.0f;
+    float maxWidth = 0.0f;
+    float lineHeight = font.GetLineHeight() * scale;
+
+    for (unsigned char c : text) {
+        if (c == '\n') {
+            maxWidth = std::max(maxWidth, penX);
+            penX = 0.0f;
+            penY += lineHeight;
+            continue;
+        }
+
+        const FontAtlas::Glyph* glyph = font.FindGlyph(c);
+        if (!glyph) {
+            glyph = font.FindGlyph('?');
+            if (!glyph) continue;
+        }
+
+        if (glyph->width > 0.0f && glyph->height > 0.0f) {
+            Quad quad;
+            quad.x0 = penX + glyph->offsetX * scale;
+            quad.y0 = penY + glyph->offsetY * scale;
+            quad.x1 = quad.x0 + glyph->width * scale;
+            quad.y1 = quad.y0 + glyph->height * scale;
+            quad.u0 = glyph->u0;
+            quad.v0 = glyph->v0;
+            quad.u1 = glyph->u1;
+            quad.v1 = glyph->v1;
+            layout.quads.push_back(quad);
+        }
+
+        penX += glyph->advance * scale;
+    }
+
+    layout.width = std::max(maxWidth, penX);
+    layout.height = penY + lineHeight;
+}
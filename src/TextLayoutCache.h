@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FontAtlas.h"
+
+// Caches laid-out strings keyed by text, font and scale. Callers keep the
+// returned handle so unchanged labels skip both hashing and layout. Each
+// Acquire pins the layout until a matching Release; only layouts nobody holds
+// age out.
+class TextLayoutCache {
+public:
+    static constexpr uint32_t INVALID_INDEX = 0xffffffffu;
+
+    struct Quad {
+        float x0, y0, x1, y1;   // Offsets from the label origin (top-left)
+        float u0, v0, u1, v1;
+    };
+
+    struct Layout {
+        std::vector<Quad> quads;
+        float width;
+        float height;
+    };
+
+    struct Handle {
+        uint32_t index = INVALID_INDEX;
+        uint32_t generation = 0;
+    };
+
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint32_t residentLayouts;
+    };
+
+    TextLayoutCache();
+    ~TextLayoutCache();
+
+    // Returns a pinned handle to the cached layout, building it on first use
+    Handle Acquire(const std::string& text, const FontAtlas& font, float scale);
+    // Unpins; stale handles are ignored
+    void Release(Handle handle);
+    bool IsValid(Handle handle) const;
+    const Layout& Get(Handle handle);
+
+    // Ages entries; unpinned layouts unused for EVICT_AFTER_FRAMES frames are evicted
+    void BeginFrame();
+    // Evicts everything, pinned or not; outstanding handles become invalid
+    void Clear();
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct Entry {
+        std::string text;
+        uint32_t fontId;
+        float scale;
+        uint64_t key;
+        uint32_t generation;
+        uint64_t lastUsedFrame;
+        uint32_t references;
+        bool inUse;
+        Layout layout;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_freeEntries;
+    std::unordered_multimap<uint64_t, uint32_t> m_lookup;
+    uint64_t m_frame;
+    Stats m_stats;
+
+    static uint64_t HashKey(const std::string& text, uint32_t fontId, float scale);
+    static void BuildLayout(const std::string& text, const FontAtlas& font, float scale, Layout& layout);
+    void Evict(uint32_t index);
+
+    // Constants
+    static constexpr uint64_t EVICT_AFTER_FRAMES = 120;
+};
@@ -0,0 +1,896 @@
+#include "TextureCooker.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// sRGB decode per byte, the linear value halfway between each pair of
+// neighbouring codes, and the code at the start of each of SRGB_BUCKETS equal
+// steps of linear light. A bucket spans at most one code boundary, so encoding
+// is a lookup and a step or two, and rounds exactly.
+const int SRGB_BUCKETS = 4096;
+
+struct SrgbTables {
+    float toLinear[256];
+    float thresholds[255];
+    uint8_t bucketCodes[SRGB_BUCKETS + 1];
+};
+
+float SrgbToLinear(double value) {
+    return static_cast<float>(value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4));
+}
+
+const SrgbTables& GetSrgbTables() {
+    static const SrgbTables tables = [] {
+        SrgbTables built;
+        for (int code = 0; code < 256; ++code) {
+            built.toLinear[code] = SrgbToLinear(code / 255.0);
+        }
+        for (int code = 0; code < 255; ++code) {
+            built.thresholds[code] = SrgbToLinear((code + 0.5) / 255.0);
+        }
+        for (int bucket = 0; bucket <= SRGB_BUCKETS; ++bucket) {
+            float linear = static_cast<float>(bucket) / SRGB_BUCKETS;
+            built.bucketCodes[bucket] = static_cast<uint8_t>(
+                std::upper_bound(built.thresholds, built.thresholds + 255, linear) - built.thresholds);
+        }
+        return built;
+    }();
+    return tables;
+}
+
+uint8_t EncodeSrgb(float linear) {
+    const SrgbTables& tables = GetSrgbTables();
+    linear = std::min(std::max(linear, 0.0f), 1.0f);
+    int code = tables.bucketCodes[static_cast<int>(linear * SRGB_BUCKETS)];
+    while (code < 255 && linear >= tables.thresholds[code]) ++code;
+    return static_cast<uint8_t>(code);
+}
+
+uint8_t EncodeUnorm(float value) {
+    return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Source texels and weights of one destination texel along an axis
+struct FilterTaps {
+    uint32_t first;
+    uint32_t count;
+    float weights[3];
+};
+
+FilterTaps GetFilterTaps(uint32_t sourceSize, uint32_t destinationSize, uint32_t index) {
+    FilterTaps taps = {};
+    if (sourceSize == 1) {
+        taps.count = 1;
+        taps.weights[0] = 1.0f;
+    } else if ((sourceSize & 1) == 0) {
+        taps.first = index * 2;
+        taps.count = 2;
+        taps.weights[0] = taps.weights[1] = 0.5f;
+    } else {
+        // Each destination texel covers 2 + 1/n source texels, straddling its neighbours' edges
+        float size = static_cast<float>(sourceSize);
+        taps.first = index * 2;
+        taps.count = 3;
+        taps.weights[0] = static_cast<float>(destinationSize - index) / size;
+        taps.weights[1] = static_cast<float>(destinationSize) / size;
+        taps.weights[2] = static_cast<float>(index + 1) / size;
+    }
+    return taps;
+}
+
+// A 4x4 block as 16 RGBA texels, reading past the image edge as the edge texel
+void LoadBlock(const TextureImage& image, uint32_t blockX, uint32_t blockY, uint8_t block[16 * 4]) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t sourceY = std::min(blockY * 4 + y, image.height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t sourceX = std::min(blockX * 4 + x, image.width - 1);
+            memcpy(block + (y * 4 + x) * 4, &image.pixels[(static_cast<size_t>(sourceY) * image.width + sourceX) * 4], 4);
+        }
+    }
+}
+
+// Little-endian bit packing for BC7's fields
+struct BlockBits {
+    uint8_t* bytes;
+    uint32_t cursor;
+
+    void Write(uint32_t value, uint32_t count) {
+        for (uint32_t bit = 0; bit < count; ++bit, ++cursor) {
+            if ((value >> bit) & 1) bytes[cursor >> 3] |= static_cast<uint8_t>(1 << (cursor & 7));
+        }
+    }
+
+    uint32_t Read(uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < count; ++bit, ++cursor) {
+            value |= static_cast<uint32_t>((bytes[cursor >> 3] >> (cursor & 7)) & 1) << bit;
+        }
+        return value;
+    }
+};
+
+// Principal axis of a block's texels in their first Channels channels, by power iteration
+template <int Channels>
+void FindPrincipalAxis(const float texels[16][4], float mean[4], float axis[4]) {
+    for (int c = 0; c < Channels; ++c) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; ++i) mean[c] += texels[i][c];
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[Channels][Channels] = {};
+    for (int i = 0; i < 16; ++i) {
+        float d[Channels];
+        for (int c = 0; c < Channels; ++c) d[c] = texels[i][c] - mean[c];
+        for (int r = 0; r < Channels; ++r) {
+            for (int c = 0; c < Channels; ++c) covariance[r][c] += d[r] * d[c];
+        }
+    }
+
+    // Start from the widest channel, which is never orthogonal to the principal axis unless the block is flat
+    int widest = 0;
+    for (int c = 1; c < Channels; ++c) {
+        if (covariance[c][c] > covariance[widest][widest]) widest = c;
+    }
+    for (int c = 0; c < Channels; ++c) axis[c] = covariance[widest][c];
+
+    for (uint32_t iteration = 0; iteration < TextureCooker::POWER_ITERATIONS; ++iteration) {
+        float next[Channels] = {};
+        float length = 0.0f;
+        for (int r = 0; r < Channels; ++r) {
+            for (int c = 0; c < Channels; ++c) next[r] += covariance[r][c] * axis[c];
+            length = std::max(length, fabsf(next[r]));
+        }
+        if (length <= 0.0f) break;
+        for (int c = 0; c < Channels; ++c) axis[c] = next[c] / length;
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < Channels; ++c) length += axis[c] * axis[c];
+    length = sqrtf(length);
+    for (int c = 0; c < Channels; ++c) axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+}
+
+// Endpoints at the extremes of the block's projection onto the axis
+template <int Channels>
+void FitLine(const float texels[16][4], float low[4], float high[4]) {
+    float mean[4], axis[4];
+    FindPrincipalAxis<Channels>(texels, mean, axis);
+    float minimum = 0.0f, maximum = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < Channels; ++c) t += (texels[i][c] - mean[c]) * axis[c];
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+    for (int c = 0; c < Channels; ++c) {
+        low[c] = mean[c] + axis[c] * minimum;
+        high[c] = mean[c] + axis[c] * maximum;
+    }
+}
+
+// Endpoints minimizing squared error for fixed per-texel weights, where a
+// texel reconstructs as (1 - weight) * low + weight * high. False if the
+// weights do not separate the endpoints.
+template <int Channels>
+bool SolveEndpoints(const float texels[16][4], const float weights[16], float low[4], float high[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < Channels; ++c) {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) return false;
+    for (int c = 0; c < Channels; ++c) {
+        low[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+        high[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+    }
+    return true;
+}
+
+void ToTexels(const uint8_t block[16 * 4], float texels[16][4]) {
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) texels[i][c] = block[i * 4 + c];
+    }
+}
+
+// BC1 color: two RGB565 endpoints and 2-bit indices, four-color mode
+
+uint16_t Pack565(const float color[4]) {
+    auto quantize = [](float value, int maximum) {
+        return static_cast<uint16_t>(std::min(std::max(static_cast<int>(value * maximum / 255.0f + 0.5f), 0), maximum));
+    };
+    return static_cast<uint16_t>((quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31));
+}
+
+void Unpack565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Palette entries 0 and 1 are the endpoints, 2 and 3 the thirds between them
+void BuildColorPalette(uint16_t color0, uint16_t color1, int palette[4][3]) {
+    Unpack565(color0, palette[0]);
+    Unpack565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+uint32_t SelectColorIndices(const uint8_t block[16 * 4], uint16_t color0, uint16_t color1, uint8_t indices[16]) {
+    int palette[4][3];
+    BuildColorPalette(color0, color1, palette);
+    uint32_t total = 0;
+    for (int i = 0; i < 16; ++i) {
+        uint32_t best = UINT32_MAX;
+        for (uint8_t entry = 0; entry < 4; ++entry) {
+            uint32_t error = 0;
+            for (int c = 0; c < 3; ++c) {
+                int d = palette[entry][c] - block[i * 4 + c];
+                error += static_cast<uint32_t>(d * d);
+            }
+            if (error < best) {
+                best = error;
+                indices[i] = entry;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+void EncodeColorBlock(const uint8_t block[16 * 4], uint8_t* destination) {
+    float texels[16][4];
+    ToTexels(block, texels);
+    float low[4], high[4];
+    FitLine<3>(texels, low, high);
+
+    uint16_t color0 = Pack565(high), color1 = Pack565(low);
+    uint8_t indices[16];
+    uint32_t error = SelectColorIndices(block, color0, color1, indices);
+
+    static const float INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };  // Toward color1
+    for (uint32_t iteration = 0; iteration < TextureCooker::REFINE_ITERATIONS && error > 0; ++iteration) {
+        float weights[16];
+        for (int i = 0; i < 16; ++i) weights[i] = INDEX_WEIGHTS[indices[i]];
+        if (!SolveEndpoints<3>(texels, weights, high, low)) break;
+        uint16_t refined0 = Pack565(high), refined1 = Pack565(low);
+        uint8_t refinedIndices[16];
+        uint32_t refinedError = SelectColorIndices(block, refined0, refined1, refinedIndices);
+        if (refinedError >= error) break;
+        color0 = refined0;
+        color1 = refined1;
+        error = refinedError;
+        memcpy(indices, refinedIndices, sizeof(indices));
+    }
+
+    // Four-color mode needs color0 > color1; equal endpoints decode every index as color0 or close to it
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        for (uint8_t& index : indices) index ^= 1;
+    } else if (color0 == color1) {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t packed = 0;
+    for (int i = 0; i < 16; ++i) packed |= static_cast<uint32_t>(indices[i]) << (i * 2);
+    memcpy(destination, &color0, 2);
+    memcpy(destination + 2, &color1, 2);
+    memcpy(destination + 4, &packed, 4);
+}
+
+// BC1 picks three-color mode with transparent black when color0 <= color1; BC3's color block never does
+void DecodeColorBlock(const uint8_t* source, bool allowThreeColor, uint8_t block[16 * 4]) {
+    uint16_t color0, color1;
+    uint32_t packed;
+    memcpy(&color0, source, 2);
+    memcpy(&color1, source + 2, 2);
+    memcpy(&packed, source + 4, 4);
+
+    int palette[4][3];
+    BuildColorPalette(color0, color1, palette);
+    bool threeColor = allowThreeColor && color0 <= color1;
+    if (threeColor) {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        uint32_t index = (packed >> (i * 2)) & 3;
+        for (int c = 0; c < 3; ++c) block[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        block[i * 4 + 3] = threeColor && index == 3 ? 0 : 255;
+    }
+}
+
+// BC4 single channel: two 8-bit endpoints and 3-bit indices, eight-value mode
+
+void BuildChannelPalette(uint8_t value0, uint8_t value1, int palette[8]) {
+    palette[0] = value0;
+    palette[1] = value1;
+    if (value0 > value1) {
+        for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+    } else {
+        for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+uint32_t SelectChannelIndices(const uint8_t values[16], uint8_t value0, uint8_t value1, uint8_t indices[16]) {
+    int palette[8];
+    BuildChannelPalette(value0, value1, palette);
+    uint32_t total = 0;
+    for (int i = 0; i < 16; ++i) {
+        uint32_t best = UINT32_MAX;
+        for (uint8_t entry = 0; entry < 8; ++entry) {
+            int d = palette[entry] - values[i];
+            uint32_t error = static_cast<uint32_t>(d * d);
+            if (error < best) {
+                best = error;
+                indices[i] = entry;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+void EncodeChannelBlock(const uint8_t block[16 * 4], int channel, uint8_t* destination) {
+    uint8_t values[16];
+    float texels[16][4] = {};
+    uint8_t minimum = 255, maximum = 0;
+    for (int i = 0; i < 16; ++i) {
+        values[i] = block[i * 4 + channel];
+        texels[i][0] = values[i];
+        minimum = std::min(minimum, values[i]);
+        maximum = std::max(maximum, values[i]);
+    }
+
+    uint8_t value0 = maximum, value1 = minimum;
+    uint8_t indices[16];
+    uint32_t error = SelectChannelIndices(values, value0, value1, indices);
+
+    static const float INDEX_WEIGHTS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+    for (uint32_t iteration = 0; iteration < TextureCooker::REFINE_ITERATIONS && error > 0 && value0 > value1; ++iteration) {
+        float weights[16];
+        for (int i = 0; i < 16; ++i) weights[i] = INDEX_WEIGHTS[indices[i]];
+        float low[4], high[4];
+        if (!SolveEndpoints<1>(texels, weights, high, low)) break;
+        uint8_t refined0 = static_cast<uint8_t>(std::min(std::max(high[0] + 0.5f, 0.0f), 255.0f));
+        uint8_t refined1 = static_cast<uint8_t>(std::min(std::max(low[0] + 0.5f, 0.0f), 255.0f));
+        if (refined0 <= refined1) break;  // Would switch to the six-value mode
+        uint8_t refinedIndices[16];
+        uint32_t refinedError = SelectChannelIndices(values, refined0, refined1, refinedIndices);
+        if (refinedError >= error) break;
+        value0 = refined0;
+        value1 = refined1;
+        error = refinedError;
+        memcpy(indices, refinedIndices, sizeof(indices));
+    }
+
+    uint64_t packed = 0;
+    for (int i = 0; i < 16; ++i) packed |= static_cast<uint64_t>(indices[i]) << (i * 3);
+    destination[0] = value0;
+    destination[1] = value1;
+    for (int i = 0; i < 6; ++i) destination[2 + i] = static_cast<uint8_t>(packed >> (i * 8));
+}
+
+void DecodeChannelBlock(const uint8_t* source, int channel, uint8_t block[16 * 4]) {
+    int palette[8];
+    BuildChannelPalette(source[0], source[1], palette);
+    uint64_t packed = 0;
+    for (int i = 0; i < 6; ++i) packed |= static_cast<uint64_t>(source[2 + i]) << (i * 8);
+    for (int i = 0; i < 16; ++i) {
+        block[i * 4 + channel] = static_cast<uint8_t>(palette[(packed >> (i * 3)) & 7]);
+    }
+}
+
+// BC7 mode 6: RGBA endpoints of 7 bits plus a shared low bit per endpoint, 4-bit indices
+
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Quantizes an endpoint to 7 bits per channel plus the low bit that fits it best
+void QuantizeMode6Endpoint(const float color[4], uint8_t quantized[4], uint32_t& lowBit) {
+    float bestError = 0.0f;
+    for (uint32_t bit = 0; bit < 2; ++bit) {
+        uint8_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            int value = static_cast<int>(floorf((color[c] - bit) * 0.5f + 0.5f));
+            candidate[c] = static_cast<uint8_t>(std::min(std::max(value, 0), 127));
+            float d = static_cast<float>(candidate[c] * 2 + bit) - color[c];
+            error += d * d;
+        }
+        if (bit == 0 || error < bestError) {
+            bestError = error;
+            memcpy(quantized, candidate, 4);
+            lowBit = bit;
+        }
+    }
+}
+
+void BuildMode6Palette(const uint8_t quantized0[4], uint32_t bit0, const uint8_t quantized1[4], uint32_t bit1,
+                       int palette[16][4]) {
+    for (int c = 0; c < 4; ++c) {
+        int endpoint0 = quantized0[c] * 2 + static_cast<int>(bit0);
+        int endpoint1 = quantized1[c] * 2 + static_cast<int>(bit1);
+        for (int i = 0; i < 16; ++i) {
+            palette[i][c] = ((64 - BC7_WEIGHTS[i]) * endpoint0 + BC7_WEIGHTS[i] * endpoint1 + 32) >> 6;
+        }
+    }
+}
+
+struct Mode6Fit {
+    uint8_t endpoints[2][4];
+    uint32_t lowBits[2];
+    uint8_t indices[16];
+    uint32_t error;
+};
+
+void EvaluateMode6(const uint8_t block[16 * 4], const float low[4], const float high[4], Mode6Fit& fit) {
+    QuantizeMode6Endpoint(low, fit.endpoints[0], fit.lowBits[0]);
+    QuantizeMode6Endpoint(high, fit.endpoints[1], fit.lowBits[1]);
+    int palette[16][4];
+    BuildMode6Palette(fit.endpoints[0], fit.lowBits[0], fit.endpoints[1], fit.lowBits[1], palette);
+
+    fit.error = 0;
+    for (int i = 0; i < 16; ++i) {
+        uint32_t best = UINT32_MAX;
+        for (uint8_t entry = 0; entry < 16; ++entry) {
+            uint32_t error = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = palette[entry][c] - block[i * 4 + c];
+                error += static_cast<uint32_t>(d * d);
+            }
+            if (error < best) {
+                best = error;
+                fit.indices[i] = entry;
+            }
+        }
+        fit.error += best;
+    }
+}
+
+void EncodeMode6Block(const uint8_t block[16 * 4], uint8_t* destination) {
+    float texels[16][4];
+    ToTexels(block, texels);
+    float low[4], high[4];
+    FitLine<4>(texels, low, high);
+
+    Mode6Fit fit;
+    EvaluateMode6(block, low, high, fit);
+    for (uint32_t iteration = 0; iteration < TextureCooker::REFINE_ITERATIONS && fit.error > 0; ++iteration) {
+        float weights[16];
+        for (int i = 0; i < 16; ++i) weights[i] = BC7_WEIGHTS[fit.indices[i]] / 64.0f;
+        if (!SolveEndpoints<4>(texels, weights, low, high)) break;
+        Mode6Fit refined;
+        EvaluateMode6(block, low, high, refined);
+        if (refined.error >= fit.error) break;
+        fit = refined;
+    }
+
+    // The first texel's index is stored without its top bit, so it must be in the lower half
+    if (fit.indices[0] >= 8) {
+        std::swap(fit.endpoints[0], fit.endpoints[1]);
+        std::swap(fit.lowBits[0], fit.lowBits[1]);
+        for (uint8_t& index : fit.indices) index = static_cast<uint8_t>(15 - index);
+    }
+
+    memset(destination, 0, 16);
+    BlockBits bits = { destination, 0 };
+    bits.Write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        bits.Write(fit.endpoints[0][c], 7);
+        bits.Write(fit.endpoints[1][c], 7);
+    }
+    bits.Write(fit.lowBits[0], 1);
+    bits.Write(fit.lowBits[1], 1);
+    bits.Write(fit.indices[0], 3);
+    for (int i = 1; i < 16; ++i) bits.Write(fit.indices[i], 4);
+}
+
+// Other modes are never written by the cooker and decode as opaque magenta, so they stand out
+void DecodeMode6Block(const uint8_t* source, uint8_t block[16 * 4]) {
+    BlockBits bits = { const_cast<uint8_t*>(source), 0 };
+    if (bits.Read(7) != (1 << 6)) {
+        for (int i = 0; i < 16; ++i) {
+            const uint8_t magenta[4] = { 255, 0, 255, 255 };
+            memcpy(block + i * 4, magenta, 4);
+        }
+        return;
+    }
+
+    uint8_t endpoints[2][4];
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = static_cast<uint8_t>(bits.Read(7));
+        endpoints[1][c] = static_cast<uint8_t>(bits.Read(7));
+    }
+    uint32_t bit0 = bits.Read(1), bit1 = bits.Read(1);
+    int palette[16][4];
+    BuildMode6Palette(endpoints[0], bit0, endpoints[1], bit1, palette);
+    for (int i = 0; i < 16; ++i) {
+        uint32_t index = bits.Read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c) block[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+    }
+}
+
+}  // namespace
+
+TextureCooker::TextureCooker() : m_useSimd(IsSimdSupported()) {
+}
+
+void TextureCooker::Cook(const TextureImage& source, TextureFormat format, uint32_t flags, TextureAsset& texture,
+                         JobSystem* jobs) const {
+    std::vector<TextureImage> mips;
+    GenerateMips(source, flags, mips, jobs);
+    texture.format = format;
+    texture.flags = flags;
+    texture.width = source.width;
+    texture.height = source.height;
+    EncodeLevels(mips, format, texture.mips, jobs);
+}
+
+void TextureCooker::GenerateMips(const TextureImage& source, uint32_t flags, std::vector<TextureImage>& mips,
+                                 JobSystem* jobs) const {
+    mips.assign(TextureFile::GetMipCount(source.width, source.height), TextureImage());
+    mips[0] = source;
+
+    if (mips.size() == 1) return;
+
+    // Each level filters the previous one at full precision, and only two are
+    // held at a time; the first reads the source bytes, so no full-size float copy is made
+    LinearImage current, next;
+    DownsampleSource(source, flags, current, jobs);
+    FromLinear(current, flags, mips[1], jobs);
+    for (size_t level = 2; level < mips.size(); ++level) {
+        Downsample(current, next, jobs);
+        FromLinear(next, flags, mips[level], jobs);
+        std::swap(current, next);
+    }
+}
+
+void TextureCooker::DownsampleSource(const TextureImage& source, uint32_t flags, LinearImage& destination, JobSystem* jobs) {
+    const SrgbTables& tables = GetSrgbTables();
+    bool srgb = (flags & TEXTURE_SRGB) != 0;
+    bool premultiply = (flags & TEXTURE_NORMAL_MAP) == 0;
+    destination.width = std::max(source.width / 2, 1u);
+    destination.height = std::max(source.height / 2, 1u);
+    destination.texels.resize(static_cast<size_t>(destination.width) * destination.height * 4);
+
+    auto filterRows = [&](size_t begin, size_t end, uint32_t) {
+        for (uint32_t y = static_cast<uint32_t>(begin); y < end; ++y) {
+            FilterTaps rows = GetFilterTaps(source.height, destination.height, y);
+            float* out = &destination.texels[static_cast<size_t>(y) * destination.width * 4];
+            for (uint32_t x = 0; x < destination.width; ++x) {
+                FilterTaps columns = GetFilterTaps(source.width, destination.width, x);
+                float sum[4] = {};
+                for (uint32_t row = 0; row < rows.count; ++row) {
+                    const uint8_t* sourceRow = &source.pixels[static_cast<size_t>(rows.first + row) * source.width * 4];
+                    for (uint32_t column = 0; column < columns.count; ++column) {
+                        const uint8_t* pixel = sourceRow + (columns.first + column) * 4;
+                        float alpha = pixel[3] / 255.0f;
+                        float weight = rows.weights[row] * columns.weights[column];
+                        float colorWeight = premultiply ? weight * alpha : weight;
+                        for (int c = 0; c < 3; ++c) {
+                            sum[c] += (srgb ? tables.toLinear[pixel[c]] : pixel[c] / 255.0f) * colorWeight;
+                        }
+                        sum[3] += alpha * weight;
+                    }
+                }
+                memcpy(out + x * 4, sum, sizeof(sum));
+            }
+        }
+    };
+    if (jobs && destination.texels.size() / 4 >= PARALLEL_MIN_PIXELS) {
+        jobs->ParallelFor(destination.height, 8, filterRows);
+    } else {
+        filterRows(0, destination.height, 0);
+    }
+}
+
+void TextureCooker::FromLinear(const LinearImage& linear, uint32_t flags, TextureImage& image, JobSystem* jobs) {
+    bool srgb = (flags & TEXTURE_SRGB) != 0;
+    bool normalMap = (flags & TEXTURE_NORMAL_MAP) != 0;
+    image.width = linear.width;
+    image.height = linear.height;
+    image.pixels.resize(static_cast<size_t>(linear.width) * linear.height * 4);
+
+    auto convertRows = [&](size_t begin, size_t end, uint32_t) {
+        for (size_t i = begin * linear.width * 4; i < end * linear.width * 4; i += 4) {
+            const float* texel = &linear.texels[i];
+            float color[3] = { texel[0], texel[1], texel[2] };
+            if (normalMap) {
+                // Averaging shortens normals; store the direction, as the shader renormalizes anyway
+                float n[3] = { color[0] * 2.0f - 1.0f, color[1] * 2.0f - 1.0f, color[2] * 2.0f - 1.0f };
+                float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int c = 0; c < 3 && length > 0.0f; ++c) color[c] = n[c] / length * 0.5f + 0.5f;
+            } else if (texel[3] > 0.0f) {
+                for (int c = 0; c < 3; ++c) color[c] /= texel[3];
+            }
+            for (int c = 0; c < 3; ++c) {
+                image.pixels[i + c] = srgb ? EncodeSrgb(color[c]) : EncodeUnorm(color[c]);
+            }
+            image.pixels[i + 3] = EncodeUnorm(texel[3]);
+        }
+    };
+    if (jobs && image.pixels.size() / 4 >= PARALLEL_MIN_PIXELS) {
+        jobs->ParallelFor(linear.height, 8, convertRows);
+    } else {
+        convertRows(0, linear.height, 0);
+    }
+}
+
+void TextureCooker::Downsample(const LinearImage& source, LinearImage& destination, JobSystem* jobs) const {
+    destination.width = std::max(source.width / 2, 1u);
+    destination.height = std::max(source.height / 2, 1u);
+    destination.texels.resize(static_cast<size_t>(destination.width) * destination.height * 4);
+
+    bool even = (source.width & 1) == 0 && (source.height & 1) == 0;
+    auto filterRows = [&](size_t begin, size_t end, uint32_t) {
+        uint32_t beginRow = static_cast<uint32_t>(begin), endRow = static_cast<uint32_t>(end);
+        if (!even) {
+            DownsampleRowsOdd(source, destination, beginRow, endRow);
+        } else if (m_useSimd) {
+            DownsampleRowsSimd(source, destination, beginRow, endRow);
+        } else {
+            DownsampleRowsScalar(source, destination, beginRow, endRow);
+        }
+    };
+    if (jobs && destination.texels.size() / 4 >= PARALLEL_MIN_PIXELS) {
+        jobs->ParallelFor(destination.height, 8, filterRows);
+    } else {
+        filterRows(0, destination.height, 0);
+    }
+}
+
+void TextureCooker::DownsampleRowsScalar(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow) {
+    // Sums in the same order as the SIMD path, so both give identical mips
+    for (uint32_t y = beginRow; y < endRow; ++y) {
+        const float* row0 = &source.texels[static_cast<size_t>(y) * 2 * source.width * 4];
+        const float* row1 = row0 + source.width * 4;
+        float* out = &destination.texels[static_cast<size_t>(y) * destination.width * 4];
+        for (uint32_t x = 0; x < destination.width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                float left = row0[x * 8 + c] + row1[x * 8 + c];
+                float right = row0[x * 8 + 4 + c] + row1[x * 8 + 4 + c];
+                out[x * 4 + c] = (left + right) * 0.25f;
+            }
+        }
+    }
+}
+
+#if FPSGAME_AVX2
+FPSGAME_AVX2_TARGET
+void TextureCooker::DownsampleRowsSimd(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow) {
+    // Two destination texels per step: four RGBA source texels from each row fill two registers per row
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    for (uint32_t y = beginRow; y < endRow; ++y) {
+        const float* row0 = &source.texels[static_cast<size_t>(y) * 2 * source.width * 4];
+        const float* row1 = row0 + source.width * 4;
+        float* out = &destination.texels[static_cast<size_t>(y) * destination.width * 4];
+        uint32_t x = 0;
+        for (; x + 2 <= destination.width; x += 2) {
+            __m256 first = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+            __m256 second = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+            __m256 left = _mm256_permute2f128_ps(first, second, 0x20);
+            __m256 right = _mm256_permute2f128_ps(first, second, 0x31);
+            _mm256_storeu_ps(out + x * 4, _mm256_mul_ps(_mm256_add_ps(left, right), quarter));
+        }
+        for (; x < destination.width; ++x) {
+            for (int c = 0; c < 4; ++c) {
+                float left = row0[x * 8 + c] + row1[x * 8 + c];
+                float right = row0[x * 8 + 4 + c] + row1[x * 8 + 4 + c];
+                out[x * 4 + c] = (left + right) * 0.25f;
+            }
+        }
+    }
+}
+#else
+void TextureCooker::DownsampleRowsSimd(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow) {
+    DownsampleRowsScalar(source, destination, beginRow, endRow);
+}
+#endif
+
+void TextureCooker::DownsampleRowsOdd(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow) {
+    for (uint32_t y = beginRow; y < endRow; ++y) {
+        FilterTaps rows = GetFilterTaps(source.height, destination.height, y);
+        float* out = &destination.texels[static_cast<size_t>(y) * destination.width * 4];
+        for (uint32_t x = 0; x < destination.width; ++x) {
+            FilterTaps columns = GetFilterTaps(source.width, destination.width, x);
+            float sum[4] = {};
+            for (uint32_t row = 0; row < rows.count; ++row) {
+                const float* sourceRow = &source.texels[static_cast<size_t>(rows.first + row) * source.width * 4];
+                for (uint32_t column = 0; column < columns.count; ++column) {
+                    float weight = rows.weights[row] * columns.weights[column];
+                    const float* texel = sourceRow + (columns.first + column) * 4;
+                    for (int c = 0; c < 4; ++c) sum[c] += texel[c] * weight;
+                }
+            }
+            memcpy(out + x * 4, sum, sizeof(sum));
+        }
+    }
+}
+
+void TextureCooker::Encode(const TextureImage& image, TextureFormat format, uint8_t* destination, JobSystem* jobs) {
+    if (format == TEXTURE_RGBA8) {
+        memcpy(destination, image.pixels.data(), image.pixels.size());
+        return;
+    }
+
+    uint32_t blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+    uint32_t blockBytes = TextureFile::GetBlockBytes(format);
+    auto encodeRows = [&](size_t begin, size_t end, uint32_t) {
+        uint8_t block[16 * 4];
+        for (size_t blockY = begin; blockY < end; ++blockY) {
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+                LoadBlock(image, blockX, static_cast<uint32_t>(blockY), block);
+                EncodeBlock(block, format, destination + (blockY * blocksX + blockX) * blockBytes);
+            }
+        }
+    };
+    if (jobs && static_cast<size_t>(image.width) * image.height >= PARALLEL_MIN_PIXELS) {
+        jobs->ParallelFor(blocksY, 1, encodeRows);
+    } else {
+        encodeRows(0, blocksY, 0);
+    }
+}
+
+void TextureCooker::EncodeLevels(const std::vector<TextureImage>& levels, TextureFormat format,
+                                 std::vector<std::vector<uint8_t>>& encoded, JobSystem* jobs) {
+    encoded.resize(levels.size());
+    for (size_t level = 0; level < levels.size(); ++level) {
+        encoded[level].resize(TextureFile::GetLevelSize(format, levels[level].width, levels[level].height));
+    }
+    if (format == TEXTURE_RGBA8) {
+        for (size_t level = 0; level < levels.size(); ++level) Encode(levels[level], format, encoded[level].data());
+        return;
+    }
+
+    // One item per block row of every level, largest first, so the tail of small levels balances the loop
+    struct BlockRow {
+        uint32_t level;
+        uint32_t blockY;
+    };
+    std::vector<BlockRow> rows;
+    for (uint32_t level = 0; level < levels.size(); ++level) {
+        for (uint32_t blockY = 0; blockY < (levels[level].height + 3) / 4; ++blockY) rows.push_back({ level, blockY });
+    }
+
+    uint32_t blockBytes = TextureFile::GetBlockBytes(format);
+    auto encodeRows = [&](size_t begin, size_t end, uint32_t) {
+        uint8_t block[16 * 4];
+        for (size_t i = begin; i < end; ++i) {
+            const TextureImage& image = levels[rows[i].level];
+            uint32_t blocksX = (image.width + 3) / 4;
+            uint8_t* destination = encoded[rows[i].level].data() + static_cast<size_t>(rows[i].blockY) * blocksX * blockBytes;
+            for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+                LoadBlock(image, blockX, rows[i].blockY, block);
+                EncodeBlock(block, format, destination + blockX * blockBytes);
+            }
+        }
+    };
+    if (jobs) {
+        jobs->ParallelFor(rows.size(), 1, encodeRows);
+    } else {
+        encodeRows(0, rows.size(), 0);
+    }
+}
+
+void TextureCooker::Decode(const uint8_t* encoded, uint32_t width, uint32_t height, TextureFormat format, TextureImage& image) {
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    if (format == TEXTURE_RGBA8) {
+        memcpy(image.pixels.data(), encoded, image.pixels.size());
+        return;
+    }
+
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    uint32_t blockBytes = TextureFile::GetBlockBytes(format);
+    uint8_t block[16 * 4];
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY) {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX) {
+            DecodeBlock(encoded + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes, format, block);
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+                    size_t pixel = static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x;
+                    memcpy(&image.pixels[pixel * 4], block + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+}
+
+void TextureCooker::EncodeBlock(const uint8_t block[16 * 4], TextureFormat format, uint8_t* destination) {
+    switch (format) {
+    case TEXTURE_BC1:
+        EncodeColorBlock(block, destination);
+        break;
+    case TEXTURE_BC3:
+        EncodeChannelBlock(block, 3, destination);
+        EncodeColorBlock(block, destination + 8);
+        break;
+    case TEXTURE_BC5:
+        EncodeChannelBlock(block, 0, destination);
+        EncodeChannelBlock(block, 1, destination + 8);
+        break;
+    case TEXTURE_BC7:
+        EncodeMode6Block(block, destination);
+        break;
+    default:
+        break;
+    }
+}
+
+void TextureCooker::DecodeBlock(const uint8_t* source, TextureFormat format, uint8_t block[16 * 4]) {
+    switch (format) {
+    case TEXTURE_BC1:
+        DecodeColorBlock(source, true, block);
+        break;
+    case TEXTURE_BC3:
+        DecodeColorBlock(source + 8, false, block);
+        DecodeChannelBlock(source, 3, block);
+        break;
+    case TEXTURE_BC5:
+        for (int i = 0; i < 16; ++i) {
+            block[i * 4 + 2] = 0;
+            block[i * 4 + 3] = 255;
+        }
+        DecodeChannelBlock(source, 0, block);
+        DecodeChannelBlock(source + 8, 1, block);
+        break;
+    case TEXTURE_BC7:
+        DecodeMode6Block(source, block);
+        break;
+    default:
+        break;
+    }
+}
+
+double TextureCooker::MeasurePsnr(const TextureImage& reference, const TextureImage& image, uint32_t channelMask) {
+    if (reference.width != image.width || reference.height != image.height || channelMask == 0) return 0.0;
+
+    uint64_t squaredError = 0, samples = 0;
+    for (size_t i = 0; i < reference.pixels.size(); i += 4) {
+        for (int c = 0; c < 4; ++c) {
+            if ((channelMask & (1u << c)) == 0) continue;
+            int d = static_cast<int>(reference.pixels[i + c]) - image.pixels[i + c];
+            squaredError += static_cast<uint64_t>(d * d);
+            ++samples;
+        }
+    }
+    if (squaredError == 0) return INFINITE_PSNR;
+    double meanSquaredError = static_cast<double>(squaredError) / samples;
+    return 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+}
+
+uint32_t TextureCooker::GetChannelMask(TextureFormat format) {
+    switch (format) {
+    case TEXTURE_BC1: return 0x7;
+    case TEXTURE_BC5: return 0x3;
+    default: return 0xF;
+    }
+}
+
+void TextureCooker::SetSimdEnabled(bool enabled) {
+    m_useSimd = enabled && IsSimdSupported();
+}
+
+bool TextureCooker::IsSimdSupported() {
+    return CpuHasAvx2();
+}
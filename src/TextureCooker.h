@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TextureFile.h"
+
+class JobSystem;
+
+// Uncompressed RGBA8 pixels, rows top to bottom
+struct TextureImage {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+};
+
+// Offline texture processing run when assets are cooked: a mip chain filtered
+// in linear light, then every level block-compressed across the job system.
+//
+// Mips are box filtered with alpha-weighted color, so transparent texels do
+// not bleed into their neighbours; sRGB color is decoded before filtering and
+// re-encoded after. Odd dimensions use the three-tap box that covers the
+// whole source texel row, so no texels are dropped.
+//
+// The block encoders fit a principal-axis line through each 4x4 block and
+// refine its endpoints by least squares. BC7 uses mode 6 only: one RGBA
+// line with 7-bit endpoints, per-endpoint low bits and 16 steps.
+class TextureCooker {
+public:
+    TextureCooker();
+
+    // Generates the mips and encodes every level; flags are TextureFlags
+    void Cook(const TextureImage& source, TextureFormat format, uint32_t flags, TextureAsset& texture,
+              JobSystem* jobs = nullptr) const;
+
+    // Every level down to 1x1, level 0 a copy of the source
+    void GenerateMips(const TextureImage& source, uint32_t flags, std::vector<TextureImage>& mips,
+                      JobSystem* jobs = nullptr) const;
+
+    // destination holds TextureFile::GetLevelSize bytes
+    static void Encode(const TextureImage& image, TextureFormat format, uint8_t* destination, JobSystem* jobs = nullptr);
+    // Encodes several levels as one parallel loop, so small levels share the threads
+    static void EncodeLevels(const std::vector<TextureImage>& levels, TextureFormat format,
+                             std::vector<std::vector<uint8_t>>& encoded, JobSystem* jobs = nullptr);
+    // Formats without a channel decode it as 0 for color and 255 for alpha
+    static void Decode(const uint8_t* encoded, uint32_t width, uint32_t height, TextureFormat format, TextureImage& image);
+
+    // Peak signal-to-noise ratio in dB over the channels set in channelMask
+    // (bit 0 red .. bit 3 alpha); identical images give INFINITE_PSNR
+    static double MeasurePsnr(const TextureImage& reference, const TextureImage& image, uint32_t channelMask);
+    // The channels a format stores
+    static uint32_t GetChannelMask(TextureFormat format);
+
+    void SetSimdEnabled(bool enabled);
+    bool IsSimdEnabled() const { return m_useSimd; }
+    static bool IsSimdSupported();
+
+    // Constants
+    static constexpr double INFINITE_PSNR = 999.0;
+    static constexpr uint32_t REFINE_ITERATIONS = 2;     // Least-squares endpoint passes per block
+    static constexpr uint32_t POWER_ITERATIONS = 8;      // For each block's principal axis
+    static constexpr size_t PARALLEL_MIN_PIXELS = 64 * 64;
+
+private:
+    // Linear, premultiplied RGBA; the chain is filtered at this precision and rounded once per level
+    struct LinearImage {
+        uint32_t width;
+        uint32_t height;
+        std::vector<float> texels;
+    };
+
+    bool m_useSimd;
+
+    void Downsample(const LinearImage& source, LinearImage& destination, JobSystem* jobs) const;
+    static void DownsampleRowsScalar(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow);
+    static void DownsampleRowsSimd(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow);
+    static void DownsampleRowsOdd(const LinearImage& source, LinearImage& destination, uint32_t beginRow, uint32_t endRow);
+    static void DownsampleSource(const TextureImage& source, uint32_t flags, LinearImage& destination, JobSystem* jobs);
+    static void FromLinear(const LinearImage& linear, uint32_t flags, TextureImage& image, JobSystem* jobs);
+
+    static void EncodeBlock(const uint8_t block[16 * 4], TextureFormat format, uint8_t* destination);
+    static void DecodeBlock(const uint8_t* source, TextureFormat format, uint8_t block[16 * 4]);
+};
@@ -0,0 +1,149 @@
+#include "TextureFile.h"
+
+TextureFile::TextureFile() : m_header() {
+}
+
+TextureFile::~TextureFile() {
+    Close();
+}
+
+bool TextureFile::Open(const char* path) {
+    Close();
+
+    m_stream.open(path, std::ios::binary);
+    if (!m_stream) return false;
+
+    m_stream.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(m_stream.tellg());
+    m_stream.seekg(0, std::ios::beg);
+
+    if (!m_stream.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) ||
+        m_header.magic != FILE_MAGIC || m_header.version != FILE_VERSION || m_header.format >= TEXTURE_FORMAT_COUNT ||
+        m_header.width == 0 || m_header.height == 0 || m_header.width > MAX_DIMENSION || m_header.height > MAX_DIMENSION ||
+        m_header.mipCount == 0 || m_header.mipCount > GetMipCount(m_header.width, m_header.height)) {
+        Close();
+        return false;
+    }
+
+    m_mips.resize(m_header.mipCount);
+    if (!m_stream.read(reinterpret_cast<char*>(m_mips.data()), m_mips.size() * sizeof(MipEntry))) {
+        Close();
+        return false;
+    }
+
+    // Sizes are fixed by the format, so a truncated or mislabelled file fails here rather than in the renderer
+    TextureFormat format = static_cast<TextureFormat>(m_header.format);
+    for (uint32_t level = 0; level < m_header.mipCount; ++level) {
+        const MipEntry& entry = m_mips[level];
+        uint64_t expected = GetLevelSize(format, GetMipDimension(m_header.width, level), GetMipDimension(m_header.height, level));
+        if (entry.size != expected || entry.offset + entry.size > fileSize) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextureFile::Close() {
+    if (m_stream.is_open()) {
+        m_stream.close();
+    }
+    m_stream.clear();
+    m_mips.clear();
+    m_header = {};
+}
+
+bool TextureFile::ReadMip(uint32_t level, std::vector<uint8_t>& data) {
+    if (!IsOpen() || level >= m_header.mipCount) return false;
+
+    const MipEntry& entry = m_mips[level];
+    data.resize(entry.size);
+    m_stream.seekg(static_cast<std::streamoff>(entry.offset), std::ios::beg);
+    if (!m_stream.read(reinterpret_cast<char*>(data.data()), entry.size)) {
+        m_stream.clear();
+        return false;
+    }
+    return true;
+}
+
+bool TextureFile::Write(const char* path, const TextureAsset& texture) {
+    if (texture.format >= TEXTURE_FORMAT_COUNT || texture.mips.empty() ||
+        texture.mips.size() > GetMipCount(texture.width, texture.height)) {
+        return false;
+    }
+    for (uint32_t level = 0; level < texture.mips.size(); ++level) {
+        uint64_t expected = GetLevelSize(texture.format, GetMipDimension(texture.width, level),
+                                         GetMipDimension(texture.height, level));
+        if (texture.mips[level].size() != expected) return false;
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    Header header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.format = texture.format;
+    header.flags = texture.flags;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mipCount = static_cast<uint32_t>(texture.mips.size());
+
+    std::vector<MipEntry> table(texture.mips.size(), MipEntry());
+    uint64_t offset = sizeof(header) + table.size() * sizeof(MipEntry);
+    for (size_t level = texture.mips.size(); level-- > 0;) {
+        table[level].offset = offset;
+        table[level].size = static_cast<uint32_t>(texture.mips[level].size());
+        offset += table[level].size;
+    }
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(MipEntry));
+    for (size_t level = texture.mips.size(); level-- > 0;) {
+        stream.write(reinterpret_cast<const char*>(texture.mips[level].data()), texture.mips[level].size());
+    }
+    return static_cast<bool>(stream);
+}
+
+bool TextureFile::Read(const char* path, TextureAsset& texture) {
+    TextureFile file;
+    if (!file.Open(path)) return false;
+
+    const Header& header = file.GetHeader();
+    texture.format = static_cast<TextureFormat>(header.format);
+    texture.flags = header.flags;
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.mips.resize(header.mipCount);
+    for (uint32_t level = 0; level < header.mipCount; ++level) {
+        if (!file.ReadMip(level, texture.mips[level])) return false;
+    }
+    return true;
+}
+
+uint32_t TextureFile::GetMipCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        ++count;
+    }
+    return count;
+}
+
+uint64_t TextureFile::GetLevelSize(TextureFormat format, uint32_t width, uint32_t height) {
+    if (format == TEXTURE_RGBA8) return static_cast<uint64_t>(width) * height * 4;
+    uint64_t blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint64_t blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return blocksX * blocksY * GetBlockBytes(format);
+}
+
+uint32_t TextureFile::GetBlockBytes(TextureFormat format) {
+    switch (format) {
+    case TEXTURE_BC1: return 8;
+    case TEXTURE_BC3:
+    case TEXTURE_BC5:
+    case TEXTURE_BC7: return 16;
+    default: return 0;
+    }
+}
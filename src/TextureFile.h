@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "WorldFile.h"
+
+// Stored formats, in D3D11 terms:
+//   TEXTURE_RGBA8   DXGI_FORMAT_R8G8B8A8_UNORM(_SRGB)
+//   TEXTURE_BC1     DXGI_FORMAT_BC1_UNORM(_SRGB)   8 bytes per 4x4 block, opaque color
+//   TEXTURE_BC3     DXGI_FORMAT_BC3_UNORM(_SRGB)   16 bytes per block, color and alpha
+//   TEXTURE_BC5     DXGI_FORMAT_BC5_UNORM          16 bytes per block, two channels (normal map XY)
+//   TEXTURE_BC7     DXGI_FORMAT_BC7_UNORM(_SRGB)   16 bytes per block, color and alpha
+enum TextureFormat : uint32_t {
+    TEXTURE_RGBA8 = 0,
+    TEXTURE_BC1 = 1,
+    TEXTURE_BC3 = 2,
+    TEXTURE_BC5 = 3,
+    TEXTURE_BC7 = 4,
+    TEXTURE_FORMAT_COUNT
+};
+
+enum TextureFlags : uint32_t {
+    TEXTURE_SRGB = 1,        // Color is sRGB encoded; sample through an _SRGB view
+    TEXTURE_NORMAL_MAP = 2   // RGB is a tangent-space normal, renormalized per mip
+};
+
+// A cooked texture: every mip level down to 1x1, each in the stored format
+struct TextureAsset {
+    TextureFormat format;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    std::vector<std::vector<uint8_t>> mips;  // Level 0 is full size
+};
+
+// Binary texture written by --cook-texture, little endian:
+//
+//   Header
+//   MipEntry[mipCount]    level 0 first
+//   mip data, smallest level first
+//
+// The small levels sit together right after the table, so a streamer can
+// read them in one request for a resident low-resolution fallback, and fetch
+// the large levels on demand as the texture comes into view.
+class TextureFile {
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;
+        uint32_t flags;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        uint32_t reserved;
+    };
+
+    struct MipEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    TextureFile();
+    ~TextureFile();
+
+    // Reads the header and mip table; level data is read on demand
+    bool Open(const char* path);
+    void Close();
+
+    // Not thread safe; give each reading thread its own TextureFile
+    bool ReadMip(uint32_t level, std::vector<uint8_t>& data);
+
+    bool IsOpen() const { return m_stream.is_open(); }
+    const Header& GetHeader() const { return m_header; }
+    const MipEntry& GetMipEntry(uint32_t level) const { return m_mips[level]; }
+
+    static bool Write(const char* path, const TextureAsset& texture);
+    // Opens, reads every level and closes
+    static bool Read(const char* path, TextureAsset& texture);
+
+    static uint32_t GetMipDimension(uint32_t size, uint32_t level) { return (size >> level) > 0 ? size >> level : 1; }
+    static uint32_t GetMipCount(uint32_t width, uint32_t height);
+    // Bytes of one level; block formats round each dimension up to whole blocks
+    static uint64_t GetLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+    static uint32_t GetBlockBytes(TextureFormat format);
+
+    // Constants
+    static constexpr uint32_t FILE_MAGIC = MakeFourCC('F', 'P', 'S', 'T');
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr uint32_t MAX_DIMENSION = 16384;  // D3D11's limit for 2D textures
+    static constexpr uint32_t BLOCK_SIZE = 4;
+
+private:
+    std::ifstream m_stream;
+    Header m_header;
+    std::vector<MipEntry> m_mips;
+};
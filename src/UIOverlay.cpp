@@ -1,92 +1,193 @@
 #include "UIOverlay.h"
+#include "AllocationTracker.h"
+#include "D3D11VertexLayout.h"
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 using namespace DirectX;
 
-UIOverlay::UIOverlay() : m_renderer(nullptr) {
+namespace {
+
+std::string DescribeFailure(const char* call, HRESULT hr) {
+    char text[128];
+    snprintf(text, sizeof(text), "%s failed (HRESULT 0x%08lX)", call, static_cast<unsigned long>(hr));
+    return text;
+}
+
+} // namespace
+
+UIOverlay::UIOverlay() :
+    m_renderer(nullptr),
+    m_input(nullptr),
+    m_startButton(nullptr),
+    m_optionsButton(nullptr),
+    m_exitButton(nullptr),
+    m_resumeButton(nullptr),
+    m_pauseExitButton(nullptr),
+    m_healthBar(nullptr),
+    m_healthLabel(nullptr),
+    m_ammoLabel(nullptr),
+    m_mousePosition(-1.0f, -1.0f),
+    m_transformWidth(0),
+    m_transformHeight(0),
+    m_metrics(nullptr),
+    m_framesMetric(MetricsRegistry::INVALID_METRIC),
+    m_skippedRebuildsMetric(MetricsRegistry::INVALID_METRIC),
+    m_textHitsMetric(MetricsRegistry::INVALID_METRIC),
+    m_textMissesMetric(MetricsRegistry::INVALID_METRIC),
+    m_publishedWidgetStats(),
+    m_publishedTextStats() {
 }
 
 UIOverlay::~UIOverlay() {
 }
 
-bool UIOverlay::Initialize(Renderer* renderer) {
-    if (!renderer) return false;
-    m_renderer = renderer;
+bool UIOverlay::Initialize(Renderer* renderer, Input* input) {
+    // The renderer is already initialized, so nothing has to wait for its device
+    StartupGraph graph;
+    AddStartupStages(graph, renderer, input, graph.AddStage("renderer", nullptr));
+    return graph.Run();
+}
 
-    if (!CreateShaders()) return false;
-    if (!CreateBuffers()) return false;
-    if (!CreateTextures()) return false;
-    if (!CreateStates()) return false;
-
-    // Initialize buttons
-    float screenCenterX = 1280.0f / 2.0f;  // Assuming 1280x720 resolution
-    float startY = 250.0f;
-
-    // Main menu buttons
-    m_startButton = { 
-        XMFLOAT2(screenCenterX - BUTTON_WIDTH / 2, startY),
-        XMFLOAT2(BUTTON_WIDTH, BUTTON_HEIGHT),
-        "Start Game",
-        false,
-        false
+StartupGraph::StageId UIOverlay::AddStartupStages(StartupGraph& graph, Renderer* renderer, Input* input,
+                                                  StartupGraph::StageId deviceReady) {
+    m_renderer = renderer;
+    m_input = input;
+    if (!renderer) {
+        return graph.AddStage("ui", []() -> bool { throw std::runtime_error("No renderer to draw the UI with"); });
+    }
+
+    StartupGraph::StageId glyphs = graph.AddStage("ui.glyphs", [this] { return RasterizeFont(); });
+    std::vector<StartupGraph::StageId> parts = {
+        graph.AddStage("ui.shaders", [this] { return CreateShaders(); }, { deviceReady }),
+        graph.AddStage("ui.resources", [this] {
+            return CreateBuffers() && CreateTextures() && CreateStates();
+        }, { deviceReady }),
+        graph.AddStage("ui.fontTexture", [this] { return CreateFontTexture(); },
+                       { glyphs, deviceReady }, StartupGraph::STAGE_MAIN_THREAD),
+        graph.AddStage("ui.layers", [this] {
+            CreateMainMenu();
+            CreateHUD();
+            CreatePauseMenu();
+            return true;
+        }, { glyphs })
     };
+    return graph.AddStage("ui", nullptr, parts);
+}
 
-    m_optionsButton = {
-        XMFLOAT2(screenCenterX - BUTTON_WIDTH / 2, startY + BUTTON_HEIGHT + BUTTON_PADDING),
-        XMFLOAT2(BUTTON_WIDTH, BUTTON_HEIGHT),
-        "Options",
-        false,
-        false
-    };
+void UIOverlay::BindPlayer(const Player* player) {
+    if (!player) return;
 
-    m_exitButton = {
-        XMFLOAT2(screenCenterX - BUTTON_WIDTH / 2, startY + 2 * (BUTTON_HEIGHT + BUTTON_PADDING)),
-        XMFLOAT2(BUTTON_WIDTH, BUTTON_HEIGHT),
-        "Exit",
-        false,
-        false
-    };
+    m_healthBar->Bind([player]() { return player->GetHealth(); }, 100.0f);
+    m_healthLabel->BindInt([player]() { return static_cast<int>(player->GetHealth()); }, "%d");
+    m_ammoLabel->BindInt([player]() { return player->GetAmmo(); }, "AMMO %d");
+}
 
-    // Pause menu button
-    m_resumeButton = {
-        XMFLOAT2(screenCenterX - BUTTON_WIDTH / 2, startY),
-        XMFLOAT2(BUTTON_WIDTH, BUTTON_HEIGHT),
-        "Resume",
-        false,
-        false
-    };
+void UIOverlay::SetMetrics(MetricsRegistry* metrics) {
+    m_metrics = metrics;
+    if (!metrics) return;
+    // The skipped-rebuild ratio is rate(skipped) / rate(frames)
+    m_framesMetric = metrics->AddCounter("fpsgame_ui_layer_frames_total", "UI layer updates");
+    m_skippedRebuildsMetric = metrics->AddCounter("fpsgame_ui_skipped_rebuilds_total",
+                                                  "UI layer updates that reused the cached geometry");
+    m_textHitsMetric = metrics->AddCounter("fpsgame_ui_text_layout_hits_total", "Text layouts found in the cache");
+    m_textMissesMetric = metrics->AddCounter("fpsgame_ui_text_layout_misses_total", "Text layouts built");
+    if (m_framesMetric == MetricsRegistry::INVALID_METRIC || m_skippedRebuildsMetric == MetricsRegistry::INVALID_METRIC ||
+        m_textHitsMetric == MetricsRegistry::INVALID_METRIC || m_textMissesMetric == MetricsRegistry::INVALID_METRIC) {
+        m_metrics = nullptr;
+    }
+}
 
-    return true;
+UIWidgetTree::Stats UIOverlay::GetWidgetStats() const {
+    UIWidgetTree::Stats total = {};
+    for (const Layer* layer : { &m_mainMenuLayer, &m_hudLayer, &m_pauseLayer }) {
+        const UIWidgetTree::Stats& stats = layer->tree.GetStats();
+        total.frames += stats.frames;
+        total.rebuilds += stats.rebuilds;
+        total.skippedRebuilds += stats.skippedRebuilds;
+    }
+    return total;
+}
+
+void UIOverlay::CreateMainMenu() {
+    UIWidgetTree& tree = m_mainMenuLayer.tree;
+    tree.Initialize(&m_font, &m_textCache);
+
+    float startY = -BUTTON_HEIGHT - BUTTON_PADDING;
+    m_startButton = static_cast<UIButton*>(tree.Add(std::make_unique<UIButton>(
+        UIAnchor::Center, 0.0f, startY, BUTTON_WIDTH, BUTTON_HEIGHT, "Start Game")));
+    m_optionsButton = static_cast<UIButton*>(tree.Add(std::make_unique<UIButton>(
+        UIAnchor::Center, 0.0f, startY + BUTTON_HEIGHT + BUTTON_PADDING, BUTTON_WIDTH, BUTTON_HEIGHT, "Options")));
+    m_exitButton = static_cast<UIButton*>(tree.Add(std::make_unique<UIButton>(
+        UIAnchor::Center, 0.0f, startY + 2 * (BUTTON_HEIGHT + BUTTON_PADDING), BUTTON_WIDTH, BUTTON_HEIGHT, "Exit")));
+}
+
+void UIOverlay::CreateHUD() {
+    UIWidgetTree& tree = m_hudLayer.tree;
+    tree.Initialize(&m_font, &m_textCache);
+
+    // Crosshair
+    UIColor crosshairColor = { 1.0f, 1.0f, 1.0f, 0.9f };
+    tree.Add(std::make_unique<UIPanel>(UIAnchor::Center, 0.0f, 0.0f, 20.0f, 2.0f, crosshairColor));
+    tree.Add(std::make_unique<UIPanel>(UIAnchor::Center, 0.0f, 0.0f, 2.0f, 20.0f, crosshairColor));
+
+    // Health bar with its value drawn on top
+    m_healthBar = static_cast<UIBar*>(tree.Add(std::make_unique<UIBar>(
+        UIAnchor::BottomLeft, 20.0f, 26.0f, 200.0f, 24.0f,
+        UIColor{ 0.1f, 0.1f, 0.1f, 0.7f }, UIColor{ 0.8f, 0.15f, 0.15f, 0.9f })));
+    m_healthLabel = static_cast<UILabel*>(m_healthBar->AddChild(std::make_unique<UILabel>(
+        UIAnchor::TopLeft, 6.0f, -2.0f, "100", 0.9f)));
+
+    // Ammo counter
+    m_ammoLabel = static_cast<UILabel*>(tree.Add(std::make_unique<UILabel>(
+        UIAnchor::BottomRight, 160.0f, 52.0f, "AMMO 30")));
+}
+
+void UIOverlay::CreatePauseMenu() {
+    UIWidgetTree& tree = m_pauseLayer.tree;
+    tree.Initialize(&m_font, &m_textCache);
+
+    // Dim the background
+    tree.Add(std::make_unique<UIPanel>(UIAnchor::Fill, 0.0f, 0.0f, 0.0f, 0.0f,
+                                       UIColor{ 0.0f, 0.0f, 0.0f, 0.5f }));
+
+    float startY = -(BUTTON_HEIGHT + BUTTON_PADDING) * 0.5f;
+    m_resumeButton = static_cast<UIButton*>(tree.Add(std::make_unique<UIButton>(
+        UIAnchor::Center, 0.0f, startY, BUTTON_WIDTH, BUTTON_HEIGHT, "Resume")));
+    m_pauseExitButton = static_cast<UIButton*>(tree.Add(std::make_unique<UIButton>(
+        UIAnchor::Center, 0.0f, startY + BUTTON_HEIGHT + BUTTON_PADDING, BUTTON_WIDTH, BUTTON_HEIGHT, "Exit")));
 }
 
 bool UIOverlay::CreateShaders() {
     // Shader source code for UI rendering
-    const char* vsSource = R"(
+    // VertexInput and DecodeVertex are generated from UIVertexLayout
+    const std::string vsSource = UIVertexLayout::GetHlslDeclarations() + R"(
         cbuffer ConstantBuffer : register(b0) {
             matrix Transform;
         };
 
-        struct VS_INPUT {
-            float3 Position : POSITION;
-            float2 TexCoord : TEXCOORD;
-            float4 Color : COLOR;
-        };
-
         struct VS_OUTPUT {
             float4 Position : SV_POSITION;
             float2 TexCoord : TEXCOORD;
             float4 Color : COLOR;
         };
 
-        VS_OUTPUT main(VS_INPUT input) {
+        VS_OUTPUT main(VertexInput input) {
+            VertexAttributes vertex = DecodeVertex(input);
             VS_OUTPUT output;
-            output.Position = mul(float4(input.Position, 1.0f), Transform);
-            output.TexCoord = input.TexCoord;
-            output.Color = input.Color;
+            output.Position = mul(vertex.Position, Transform);
+            output.TexCoord = vertex.TexCoord;
+            output.Color = vertex.Color;
             return output;
         }
     )";
+    static_assert(UIVertexLayout::Provides<VertexSemantic::Position, VertexSemantic::TexCoord, VertexSemantic::Color>(),
+                  "The UI vertex shader reads position, texture coordinates and color");
 
     const char* psSource = R"(
         Texture2D tex2D : register(t0);
@@ -109,80 +210,83 @@ bool UIOverlay::CreateShaders() {
     ComPtr<ID3DBlob> psBlob;
     ComPtr<ID3DBlob> errorBlob;
 
-    HRESULT hr = D3DCompile(vsSource, strlen(vsSource), nullptr, nullptr, nullptr,
+    // Compiler messages become the startup error
+    auto compileError = [&errorBlob](const char* shader) {
+        std::string text = std::string(shader) + " failed to compile";
+        if (errorBlob) {
+            text += ": ";
+            text.append(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+        }
+        return std::runtime_error(text);
+    };
+
+    HRESULT hr = D3DCompile(vsSource.data(), vsSource.size(), nullptr, nullptr, nullptr,
                            "main", "vs_4_0", 0, 0, vsBlob.GetAddressOf(), 
                            errorBlob.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw compileError("UI vertex shader");
 
     hr = D3DCompile(psSource, strlen(psSource), nullptr, nullptr, nullptr,
                     "main", "ps_4_0", 0, 0, psBlob.GetAddressOf(), 
                     errorBlob.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw compileError("UI pixel shader");
 
     // Create shader objects
     ID3D11Device* device = m_renderer->GetDevice();
     hr = device->CreateVertexShader(vsBlob->GetBufferPointer(), 
                                   vsBlob->GetBufferSize(), nullptr, 
                                   m_vertexShader.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateVertexShader (UI)", hr));
 
     hr = device->CreatePixelShader(psBlob->GetBufferPointer(), 
                                  psBlob->GetBufferSize(), nullptr, 
                                  m_pixelShader.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreatePixelShader (UI)", hr));
 
     // Create input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, 
-          D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, 
-          D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, 
-          D3D11_INPUT_PER_VERTEX_DATA, 0 }
-    };
-
-    hr = device->CreateInputLayout(layout, ARRAYSIZE(layout),
+    auto layout = MakeInputElements<UIVertexLayout>();
+    hr = device->CreateInputLayout(layout.data(), static_cast<UINT>(layout.size()),
                                  vsBlob->GetBufferPointer(),
                                  vsBlob->GetBufferSize(),
                                  m_inputLayout.GetAddressOf());
-    return SUCCEEDED(hr);
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateInputLayout (UI)", hr));
+    return true;
 }
 
 bool UIOverlay::CreateBuffers() {
-    // Create vertex buffer for UI elements
-    std::vector<UIVertex> vertices = {
-        // Crosshair vertices
-        { XMFLOAT3(-10.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(10.0f, 0.0f, 0.0f), XMFLOAT2(1.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(0.0f, -10.0f, 0.0f), XMFLOAT2(0.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(0.0f, 10.0f, 0.0f), XMFLOAT2(1.0f, 0.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) }
-    };
+    ID3D11Device* device = m_renderer->GetDevice();
+
+    // Static index buffer with two triangles per quad, shared by every layer
+    std::vector<UINT> indices(MAX_DRAW_QUADS * 6);
+    for (UINT i = 0; i < MAX_DRAW_QUADS; ++i) {
+        UINT base = i * 4;
+        indices[i * 6 + 0] = base + 0;
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 2;
+        indices[i * 6 + 3] = base + 0;
+        indices[i * 6 + 4] = base + 2;
+        indices[i * 6 + 5] = base + 3;
+    }
 
     D3D11_BUFFER_DESC bd = {};
-    bd.Usage = D3D11_USAGE_DYNAMIC;
-    bd.ByteWidth = sizeof(UIVertex) * vertices.size();
-    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    bd.Usage = D3D11_USAGE_DEFAULT;
+    bd.ByteWidth = sizeof(UINT) * static_cast<UINT>(indices.size());
+    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    bd.CPUAccessFlags = 0;
 
     D3D11_SUBRESOURCE_DATA initData = {};
-    initData.pSysMem = vertices.data();
-
-    HRESULT hr = m_renderer->GetDevice()->CreateBuffer(&bd, &initData, 
-                                                      m_vertexBuffer.GetAddressOf());
-    if (FAILED(hr)) return false;
+    initData.pSysMem = indices.data();
 
-    // Create index buffer
-    std::vector<UINT> indices = { 0, 1, 2, 3 };  // For crosshair lines
+    HRESULT hr = device->CreateBuffer(&bd, &initData, m_indexBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (UI indices)", hr));
 
+    // Screen-space projection
     bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(UINT) * indices.size();
-    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    initData.pSysMem = indices.data();
+    bd.ByteWidth = sizeof(XMMATRIX);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-    hr = m_renderer->GetDevice()->CreateBuffer(&bd, &initData, 
-                                             m_indexBuffer.GetAddressOf());
-    return SUCCEEDED(hr);
+    hr = device->CreateBuffer(&bd, nullptr, m_constantBuffer.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBuffer (UI constants)", hr));
+    return true;
 }
 
 bool UIOverlay::CreateTextures() {
@@ -204,7 +308,7 @@ bool UIOverlay::CreateStates() {
 
     HRESULT hr = m_renderer->GetDevice()->CreateSamplerState(&sampDesc, 
                                                             m_samplerState.GetAddressOf());
-    if (FAILED(hr)) return false;
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateSamplerState (UI)", hr));
 
     // Create blend state for alpha blending
     D3D11_BLEND_DESC blendDesc = {};
@@ -218,68 +322,251 @@ bool UIOverlay::CreateStates() {
     blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 
     hr = m_renderer->GetDevice()->CreateBlendState(&blendDesc, m_blendState.GetAddressOf());
-    return SUCCEEDED(hr);
-}
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateBlendState (UI)", hr));
 
-void UIOverlay::Update(GameState currentState) {
-    UpdateButtonStates();
+    // UI is drawn on top of the scene without depth testing
+    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+    dsDesc.DepthEnable = false;
+    dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+
+    hr = m_renderer->GetDevice()->CreateDepthStencilState(&dsDesc, m_depthStencilState.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateDepthStencilState (UI)", hr));
+    return true;
 }
 
-void UIOverlay::RenderMainMenu() {
-    // Set UI rendering states
-    ID3D11DeviceContext* context = m_renderer->GetDeviceContext();
-    context->OMSetBlendState(m_blendState.Get(), nullptr, 0xffffffff);
-    context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
+bool UIOverlay::RasterizeFont() {
+    if (!m_font.Initialize(0, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE)) {
+        throw std::runtime_error("Font atlas size is too small");
+    }
+
+    // Rasterize the printable ASCII range once with GDI
+    HDC dc = CreateCompatibleDC(nullptr);
+    if (!dc) throw std::runtime_error("CreateCompatibleDC failed");
+
+    HFONT font = CreateFontW(-FONT_PIXEL_SIZE, 0, 0, 0, FW_SEMIBOLD, FALSE, FALSE, FALSE,
+                             DEFAULT_CHARSET, OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS,
+                             ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+    if (!font) {
+        DeleteDC(dc);
+        throw std::runtime_error("CreateFontW (Segoe UI) failed");
+    }
+    HGDIOBJ previousFont = SelectObject(dc, font);
+
+    TEXTMETRICW metrics = {};
+    GetTextMetricsW(dc, &metrics);
+    m_font.SetMetrics(static_cast<float>(metrics.tmHeight), static_cast<float>(metrics.tmAscent));
+
+    const MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+    std::vector<BYTE> bitmap;
+    std::vector<uint8_t> coverage;
+    bool success = true;
+
+    for (wchar_t ch = 32; ch < 127 && success; ++ch) {
+        GLYPHMETRICS gm = {};
+        DWORD size = GetGlyphOutlineW(dc, ch, GGO_GRAY8_BITMAP, &gm, 0, nullptr, &identity);
+        if (size == GDI_ERROR) continue;
+
+        int width = 0;
+        int height = 0;
+        if (size > 0) {
+            bitmap.resize(size);
+            GetGlyphOutlineW(dc, ch, GGO_GRAY8_BITMAP, &gm, size, bitmap.data(), &identity);
+
+            // GGO_GRAY8 rows are DWORD aligned with 65 coverage levels
+            width = static_cast<int>(gm.gmBlackBoxX);
+            height = static_cast<int>(gm.gmBlackBoxY);
+            int pitch = (width + 3) & ~3;
+            coverage.resize(static_cast<size_t>(width) * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    coverage[y * width + x] = static_cast<uint8_t>(bitmap[y * pitch + x] * 255 / 64);
+                }
+            }
+        }
 
-    // Render background
-    // TODO: Implement background rendering
+        success = m_font.AddGlyph(ch, width, height, coverage.data(), width,
+                                  static_cast<float>(gm.gmptGlyphOrigin.x),
+                                  static_cast<float>(metrics.tmAscent - gm.gmptGlyphOrigin.y),
+                                  static_cast<float>(gm.gmCellIncX));
+    }
 
-    // Render buttons
-    RenderButton(m_startButton);
-    RenderButton(m_optionsButton);
-    RenderButton(m_exitButton);
+    SelectObject(dc, previousFont);
+    DeleteObject(font);
+    DeleteDC(dc);
+    if (!success) throw std::runtime_error("Font atlas is too small for the printable ASCII glyphs");
+    return true;
 }
 
-void UIOverlay::RenderHUD() {
-    RenderCrosshair();
-    RenderHealthBar(100.0f);  // TODO: Get actual health value
-    RenderAmmoCount(30);      // TODO: Get actual ammo count
+bool UIOverlay::CreateFontTexture() {
+    // White RGB with coverage in alpha so the existing UI pixel shader can sample it
+    D3D11_TEXTURE2D_DESC texDesc = {};
+    texDesc.Width = m_font.GetWidth();
+    texDesc.Height = m_font.GetHeight();
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    ID3D11Device* device = m_renderer->GetDevice();
+    HRESULT hr = device->CreateTexture2D(&texDesc, nullptr, m_fontTexture.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateTexture2D (font atlas)", hr));
+
+    hr = device->CreateShaderResourceView(m_fontTexture.Get(), nullptr, m_fontTextureView.GetAddressOf());
+    if (FAILED(hr)) throw std::runtime_error(DescribeFailure("CreateShaderResourceView (font atlas)", hr));
+
+    UploadFontAtlas();
+    return true;
 }
 
-void UIOverlay::RenderPauseMenu() {
-    // Dim the background
-    // TODO: Implement screen dimming
+void UIOverlay::UploadFontAtlas() {
+    int width = m_font.GetWidth();
+    int height = m_font.GetHeight();
+    const uint8_t* pixels = m_font.GetPixels();
+
+    std::vector<uint32_t> rgba(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        rgba[i] = 0x00ffffffu | (static_cast<uint32_t>(pixels[i]) << 24);
+    }
+
+    m_renderer->GetDeviceContext()->UpdateSubresource(m_fontTexture.Get(), 0, nullptr, rgba.data(),
+                                                     width * sizeof(uint32_t), 0);
+    m_font.ClearDirty();
+}
 
-    // Render pause menu elements
-    RenderButton(m_resumeButton);
-    RenderButton(m_exitButton);
+void UIOverlay::Update(GameState currentState) {
+    m_textCache.BeginFrame();
+    UpdateButtonStates();
+    PublishMetrics();
 }
 
-void UIOverlay::RenderButton(const Button& button) {
-    // TODO: Implement button rendering with proper texturing and text
+void UIOverlay::PublishMetrics() {
+    if (!m_metrics) return;
+
+    UIWidgetTree::Stats widgets = GetWidgetStats();
+    const TextLayoutCache::Stats& text = GetTextStats();
+    m_metrics->Increment(m_framesMetric, widgets.frames - m_publishedWidgetStats.frames);
+    m_metrics->Increment(m_skippedRebuildsMetric, widgets.skippedRebuilds - m_publishedWidgetStats.skippedRebuilds);
+    m_metrics->Increment(m_textHitsMetric, text.hits - m_publishedTextStats.hits);
+    m_metrics->Increment(m_textMissesMetric, text.misses - m_publishedTextStats.misses);
+    m_publishedWidgetStats = widgets;
+    m_publishedTextStats = text;
 }
 
-void UIOverlay::RenderText(const std::string& text, XMFLOAT2 position, float scale) {
-    // TODO: Implement text rendering
+void UIOverlay::RenderMainMenu() {
+    RenderLayer(m_mainMenuLayer);
 }
 
-void UIOverlay::RenderCrosshair() {
-    // TODO: Implement crosshair rendering
+void UIOverlay::RenderHUD() {
+    RenderLayer(m_hudLayer);
 }
 
-void UIOverlay::RenderHealthBar(float health) {
-    // TODO: Implement health bar rendering
+void UIOverlay::RenderPauseMenu() {
+    RenderLayer(m_pauseLayer);
 }
 
-void UIOverlay::RenderAmmoCount(int ammo) {
-    // TODO: Implement ammo counter rendering
+void UIOverlay::RenderLayer(Layer& layer) {
+    MemoryTagScope tag(MemoryTag::UI);
+
+    // Geometry is only regenerated when a binding, hover state or the screen size changed
+    layer.tree.Update(m_renderer->GetWidth(), m_renderer->GetHeight(), m_mousePosition.x, m_mousePosition.y);
+    if (layer.tree.GetGeometryVersion() != layer.uploadedVersion && !UploadLayer(layer)) {
+        return;
+    }
+
+    UINT vertexCount = static_cast<UINT>(layer.tree.GetVertices().size());
+    if (vertexCount == 0) return;
+
+    BindPipeline();
+
+    ID3D11DeviceContext* context = m_renderer->GetDeviceContext();
+    UINT stride = sizeof(UIVertex);
+    UINT offset = 0;
+    context->IASetVertexBuffers(0, 1, layer.vertexBuffer.GetAddressOf(), &stride, &offset);
+
+    // The shared index buffer covers MAX_DRAW_QUADS, so larger layers draw in chunks
+    UINT quadCount = vertexCount / 4;
+    for (UINT first = 0; first < quadCount; first += MAX_DRAW_QUADS) {
+        UINT count = (std::min)(quadCount - first, MAX_DRAW_QUADS);
+        context->DrawIndexed(count * 6, 0, static_cast<INT>(first * 4));
+        if (m_renderer->GetCapture()) {
+            m_renderer->GetCapture()->DrawBatch(CaptureTarget::BATCH_UI_QUADS, 0, count);
+        }
+    }
 }
 
-bool UIOverlay::IsPointInRect(XMFLOAT2 point, XMFLOAT2 position, XMFLOAT2 size) {
-    return point.x >= position.x && point.x <= position.x + size.x &&
-           point.y >= position.y && point.y <= position.y + size.y;
+bool UIOverlay::UploadLayer(Layer& layer) {
+    const std::vector<UIWidgetVertex>& vertices = layer.tree.GetVertices();
+    UINT vertexCount = static_cast<UINT>(vertices.size());
+
+    if (vertexCount > layer.vertexCapacity) {
+        UINT capacity = (std::max<UINT>)(layer.vertexCapacity * 2, 256);
+        while (capacity < vertexCount) capacity *= 2;
+
+        D3D11_BUFFER_DESC bd = {};
+        bd.Usage = D3D11_USAGE_DYNAMIC;
+        bd.ByteWidth = sizeof(UIVertex) * capacity;
+        bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        layer.vertexBuffer.Reset();
+        HRESULT hr = m_renderer->GetDevice()->CreateBuffer(&bd, nullptr, layer.vertexBuffer.GetAddressOf());
+        if (FAILED(hr)) {
+            layer.vertexCapacity = 0;
+            return false;
+        }
+        layer.vertexCapacity = capacity;
+    }
+
+    if (vertexCount > 0) {
+        ID3D11DeviceContext* context = m_renderer->GetDeviceContext();
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRESULT hr = context->Map(layer.vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+        if (FAILED(hr)) return false;
+        memcpy(mapped.pData, vertices.data(), vertexCount * sizeof(UIVertex));
+        context->Unmap(layer.vertexBuffer.Get(), 0);
+    }
+
+    layer.uploadedVersion = layer.tree.GetGeometryVersion();
+    return true;
 }
 
 void UIOverlay::UpdateButtonStates() {
-    // TODO: Implement button state updates based on mouse position and clicks
+    // Hover itself is resolved by the widget trees, which skip work when the mouse is still
+    if (m_input) {
+        m_mousePosition = m_input->GetMousePosition();
+    }
+}
+
+void UIOverlay::BindPipeline() {
+    ID3D11DeviceContext* context = m_renderer->GetDeviceContext();
+
+    if (m_font.IsDirty()) {
+        UploadFontAtlas();
+    }
+
+    // Pixel-space orthographic projection with the origin at the top-left
+    if (m_transformWidth != m_renderer->GetWidth() || m_transformHeight != m_renderer->GetHeight()) {
+        m_transformWidth = m_renderer->GetWidth();
+        m_transformHeight = m_renderer->GetHeight();
+        XMMATRIX transform = XMMatrixTranspose(XMMatrixOrthographicOffCenterLH(
+            0.0f, static_cast<float>(m_transformWidth),
+            static_cast<float>(m_transformHeight), 0.0f, 0.0f, 1.0f));
+        context->UpdateSubresource(m_constantBuffer.Get(), 0, nullptr, &transform, 0, 0);
+    }
+
+    context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+    context->IASetInputLayout(m_inputLayout.Get());
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    context->VSSetShader(m_vertexShader.Get(), nullptr, 0);
+    context->VSSetConstantBuffers(0, 1, m_constantBuffer.GetAddressOf());
+    context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+    context->PSSetShaderResources(0, 1, m_fontTextureView.GetAddressOf());
+    context->PSSetSamplers(0, 1, m_samplerState.GetAddressOf());
+
+    context->OMSetBlendState(m_blendState.Get(), nullptr, 0xffffffff);
+    context->OMSetDepthStencilState(m_depthStencilState.Get(), 0);
 }
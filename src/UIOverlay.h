@@ -3,7 +3,14 @@
 #include <directxmath.h>
 #include <wrl/client.h>
 #include <string>
+#include <vector>
 #include "Renderer.h"
+#include "Input.h"
+#include "Player.h"
+#include "FontAtlas.h"
+#include "TextLayoutCache.h"
+#include "UIWidgetTree.h"
+#include "MetricsRegistry.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -12,70 +19,114 @@ public:
     UIOverlay();
     ~UIOverlay();
 
-    bool Initialize(Renderer* renderer);
+    bool Initialize(Renderer* renderer, Input* input);
+    // Adds initialization to a startup graph instead. Glyphs are rasterized
+    // without waiting for the device; the font texture upload stays on the
+    // main thread, which owns the immediate context.
+    StartupGraph::StageId AddStartupStages(StartupGraph& graph, Renderer* renderer, Input* input,
+                                           StartupGraph::StageId deviceReady);
+    void BindPlayer(const Player* player);
+    // Registers the UI's metrics, published from every Update; null publishes nothing
+    void SetMetrics(MetricsRegistry* metrics);
 
     void Update(GameState currentState);
     void RenderMainMenu();
     void RenderHUD();
     void RenderPauseMenu();
 
+    const TextLayoutCache::Stats& GetTextStats() const { return m_textCache.GetStats(); }
+    UIWidgetTree::Stats GetWidgetStats() const;
+
 private:
     // Core components
     Renderer* m_renderer;
-    
+    Input* m_input;
+
     // DirectX resources
-    ComPtr<ID3D11Buffer> m_vertexBuffer;
     ComPtr<ID3D11Buffer> m_indexBuffer;
+    ComPtr<ID3D11Buffer> m_constantBuffer;
     ComPtr<ID3D11VertexShader> m_vertexShader;
     ComPtr<ID3D11PixelShader> m_pixelShader;
     ComPtr<ID3D11InputLayout> m_inputLayout;
     ComPtr<ID3D11SamplerState> m_samplerState;
     ComPtr<ID3D11BlendState> m_blendState;
+    ComPtr<ID3D11DepthStencilState> m_depthStencilState;
 
     // UI textures
     ComPtr<ID3D11ShaderResourceView> m_crosshairTexture;
     ComPtr<ID3D11ShaderResourceView> m_menuBackgroundTexture;
     ComPtr<ID3D11ShaderResourceView> m_buttonTexture;
+    ComPtr<ID3D11Texture2D> m_fontTexture;
+    ComPtr<ID3D11ShaderResourceView> m_fontTextureView;
 
-    // UI state
-    struct Button {
-        DirectX::XMFLOAT2 position;
-        DirectX::XMFLOAT2 size;
-        std::string text;
-        bool isHovered;
-        bool isPressed;
+    // Text rendering
+    FontAtlas m_font;
+    TextLayoutCache m_textCache;
+
+    // Retained widget trees with their cached GPU geometry; declared after m_textCache
+    // so their widgets release pinned layouts before the cache goes away
+    struct Layer {
+        UIWidgetTree tree;
+        ComPtr<ID3D11Buffer> vertexBuffer;
+        UINT vertexCapacity = 0;
+        uint64_t uploadedVersion = 0;
     };
+    Layer m_mainMenuLayer;
+    Layer m_hudLayer;
+    Layer m_pauseLayer;
 
     // UI elements
-    Button m_startButton;
-    Button m_optionsButton;
-    Button m_exitButton;
-    Button m_resumeButton;
+    UIButton* m_startButton;
+    UIButton* m_optionsButton;
+    UIButton* m_exitButton;
+    UIButton* m_resumeButton;
+    UIButton* m_pauseExitButton;
+    UIBar* m_healthBar;
+    UILabel* m_healthLabel;
+    UILabel* m_ammoLabel;
+
+    // Input state
+    DirectX::XMFLOAT2 m_mousePosition;
+
+    // Screen size the projection constant buffer was built for
+    int m_transformWidth;
+    int m_transformHeight;
+
+    // Counters, advanced by the stats gained since the previous Update
+    MetricsRegistry* m_metrics;
+    uint32_t m_framesMetric;
+    uint32_t m_skippedRebuildsMetric;
+    uint32_t m_textHitsMetric;
+    uint32_t m_textMissesMetric;
+    UIWidgetTree::Stats m_publishedWidgetStats;
+    TextLayoutCache::Stats m_publishedTextStats;
 
     // Helper methods
     bool CreateShaders();
     bool CreateBuffers();
     bool CreateTextures();
     bool CreateStates();
-    
-    void RenderButton(const Button& button);
-    void RenderText(const std::string& text, DirectX::XMFLOAT2 position, float scale = 1.0f);
-    void RenderCrosshair();
-    void RenderHealthBar(float health);
-    void RenderAmmoCount(int ammo);
-    
-    bool IsPointInRect(DirectX::XMFLOAT2 point, DirectX::XMFLOAT2 position, DirectX::XMFLOAT2 size);
+    bool RasterizeFont();
+    bool CreateFontTexture();
+    void UploadFontAtlas();
+    void CreateMainMenu();
+    void CreateHUD();
+    void CreatePauseMenu();
+
+    void RenderLayer(Layer& layer);
+    bool UploadLayer(Layer& layer);
+    void BindPipeline();
     void UpdateButtonStates();
+    void PublishMetrics();
 
-    // Vertex structure for UI elements
-    struct UIVertex {
-        DirectX::XMFLOAT3 position;
-        DirectX::XMFLOAT2 texCoord;
-        DirectX::XMFLOAT4 color;
-    };
+    // Vertex structure for UI elements, shared with the widget trees
+    using UIVertex = UIWidgetVertex;
 
     // Constants
     static constexpr float BUTTON_WIDTH = 200.0f;
     static constexpr float BUTTON_HEIGHT = 50.0f;
     static constexpr float BUTTON_PADDING = 20.0f;
+    static constexpr int FONT_ATLAS_SIZE = 512;
+    static constexpr int FONT_PIXEL_SIZE = 24;
+    static constexpr UINT MAX_DRAW_QUADS = 4096;   // Covered by the shared index buffer
 };
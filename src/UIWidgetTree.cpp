@@ -0,0 +1,325 @@
+#include "UIWidgetTree.h"
+#include <algorithm>
+#include <cstdio>
+
+UITextLayout::UITextLayout() :
+    m_cache(nullptr) {
+}
+
+UITextLayout::~UITextLayout() {
+    Reset();
+}
+
+void UITextLayout::Reset() {
+    if (m_cache) {
+        m_cache->Release(m_handle);
+        m_cache = nullptr;
+    }
+    m_handle = TextLayoutCache::Handle();
+}
+
+UIWidget::UIWidget(UIAnchor anchor, float offsetX, float offsetY, float width, float height) :
+    m_anchor(anchor),
+    m_offsetX(offsetX),
+    m_offsetY(offsetY),
+    m_width(width),
+    m_height(height),
+    m_visible(true),
+    m_visibilityChanged(false),
+    m_hovered(false),
+    m_rect{ 0.0f, 0.0f, width, height } {
+}
+
+UIWidget::~UIWidget() {
+}
+
+UIWidget* UIWidget::AddChild(std::unique_ptr<UIWidget> child) {
+    m_children.push_back(std::move(child));
+    m_visibilityChanged = true;
+    return m_children.back().get();
+}
+
+void UIWidget::SetVisible(bool visible) {
+    if (m_visible != visible) {
+        m_visible = visible;
+        m_visibilityChanged = true;
+    }
+}
+
+UIPanel::UIPanel(UIAnchor anchor, float offsetX, float offsetY, float width, float height, UIColor color) :
+    UIWidget(anchor, offsetX, offsetY, width, height),
+    m_color(color) {
+}
+
+void UIPanel::Build(UIWidgetTree& tree) {
+    tree.AddSolidQuad(m_rect, m_color);
+}
+
+UIBar::UIBar(UIAnchor anchor, float offsetX, float offsetY, float width, float height,
+             UIColor background, UIColor fill) :
+    UIWidget(anchor, offsetX, offsetY, width, height),
+    m_background(background),
+    m_fill(fill),
+    m_maxValue(1.0f),
+    m_fillPixels(-1) {
+}
+
+void UIBar::Bind(std::function<float()> value, float maxValue) {
+    m_value = std::move(value);
+    m_maxValue = maxValue > 0.0f ? maxValue : 1.0f;
+    m_fillPixels = -1;
+}
+
+bool UIBar::Sync() {
+    float fraction = m_value ? std::max(0.0f, std::min(m_value() / m_maxValue, 1.0f)) : 1.0f;
+    int fillPixels = static_cast<int>(fraction * m_rect.width + 0.5f);
+    if (fillPixels == m_fillPixels) {
+        return false;
+    }
+    m_fillPixels = fillPixels;
+    return true;
+}
+
+void UIBar::Build(UIWidgetTree& tree) {
+    tree.AddSolidQuad(m_rect, m_background);
+    if (m_fillPixels > 0) {
+        UIRect fill = { m_rect.x, m_rect.y, static_cast<float>(m_fillPixels), m_rect.height };
+        tree.AddSolidQuad(fill, m_fill);
+    }
+}
+
+UILabel::UILabel(UIAnchor anchor, float offsetX, float offsetY, const std::string& text,
+                 float scale, UIColor color) :
+    UIWidget(anchor, offsetX, offsetY, 0.0f, 0.0f),
+    m_text(text),
+    m_scale(scale),
+    m_color(color),
+    m_centered(false),
+    m_textChanged(true),
+    m_lastValue(0),
+    m_hasValue(false) {
+}
+
+void UILabel::SetText(const std::string& text) {
+    if (m_text != text) {
+        m_text = text;
+        m_textChanged = true;
+    }
+}
+
+void UILabel::BindInt(std::function<int()> value, const char* format) {
+    m_intValue = std::move(value);
+    m_format = format;
+    m_hasValue = false;
+}
+
+bool UILabel::Sync() {
+    if (m_intValue) {
+        int value = m_intValue();
+        if (!m_hasValue || value != m_lastValue) {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), m_format.c_str(), value);
+            m_lastValue = value;
+            m_hasValue = true;
+            SetText(buffer);
+        }
+    }
+
+    bool changed = m_textChanged;
+    if (changed) {
+        m_layout.Reset();
+        m_textChanged = false;
+    }
+    return changed;
+}
+
+void UILabel::Build(UIWidgetTree& tree) {
+    tree.AddText(m_layout, m_text, m_scale, m_rect.x, m_rect.y, m_centered, m_rect, m_color);
+}
+
+UIButton::UIButton(UIAnchor anchor, float offsetX, float offsetY, float width, float height,
+                   const std::string& text) :
+    UIWidget(anchor, offsetX, offsetY, width, height),
+    m_text(text) {
+}
+
+void UIButton::Build(UIWidgetTree& tree) {
+    UIColor background = m_hovered ? UIColor{ 0.35f, 0.45f, 0.6f, 0.9f }
+                                   : UIColor{ 0.15f, 0.2f, 0.3f, 0.85f };
+    tree.AddSolidQuad(m_rect, background);
+    tree.AddText(m_layout, m_text, 1.0f, m_rect.x, m_rect.y, true, m_rect, UIColor{ 1.0f, 1.0f, 1.0f, 1.0f });
+}
+
+UIWidgetTree::UIWidgetTree() :
+    m_font(nullptr),
+    m_textCache(nullptr),
+    m_screenWidth(0),
+    m_screenHeight(0),
+    m_mouseX(-1.0f),
+    m_mouseY(-1.0f),
+    m_geometryVersion(0),
+    m_forceRebuild(true),
+    m_stats() {
+}
+
+UIWidgetTree::~UIWidgetTree() {
+}
+
+void UIWidgetTree::Initialize(FontAtlas* font, TextLayoutCache* textCache) {
+    m_font = font;
+    m_textCache = textCache;
+    m_forceRebuild = true;
+}
+
+UIWidget* UIWidgetTree::Add(std::unique_ptr<UIWidget> widget) {
+    m_roots.push_back(std::move(widget));
+    m_forceRebuild = true;
+    return m_roots.back().get();
+}
+
+bool UIWidgetTree::Update(int screenWidth, int screenHeight, float mouseX, float mouseY) {
+    bool layoutChanged = m_forceRebuild || screenWidth != m_screenWidth || screenHeight != m_screenHeight;
+    bool mouseMoved = mouseX != m_mouseX || mouseY != m_mouseY;
+    m_screenWidth = screenWidth;
+    m_screenHeight = screenHeight;
+    m_mouseX = mouseX;
+    m_mouseY = mouseY;
+    m_stats.frames++;
+
+    UIRect screen = { 0.0f, 0.0f, static_cast<float>(screenWidth), static_cast<float>(screenHeight) };
+    bool dirty = layoutChanged;
+    for (auto& root : m_roots) {
+        dirty |= SyncWidget(*root, screen, layoutChanged, mouseMoved);
+    }
+
+    if (!dirty) {
+        m_stats.skippedRebuilds++;
+        return false;
+    }
+
+    m_vertices.clear();
+    for (auto& root : m_roots) {
+        BuildWidget(*root);
+    }
+
+    m_geometryVersion++;
+    m_forceRebuild = false;
+    m_stats.rebuilds++;
+    return true;
+}
+
+bool UIWidgetTree::SyncWidget(UIWidget& widget, const UIRect& parent, bool layoutChanged, bool mouseMoved) {
+    bool dirty = false;
+    if (widget.m_visibilityChanged) {
+        widget.m_visibilityChanged = false;
+        layoutChanged = true;
+        dirty = true;
+    }
+
+    if (!widget.m_visible) {
+        return dirty;
+    }
+
+    if (layoutChanged) {
+        widget.m_rect = ResolveRect(widget, parent);
+    }
+
+    dirty |= widget.Sync();
+
+    if (widget.IsInteractive() && (mouseMoved || layoutChanged)) {
+        const UIRect& r = widget.m_rect;
+        bool hovered = m_mouseX >= r.x && m_mouseX <= r.x + r.width &&
+                       m_mouseY >= r.y && m_mouseY <= r.y + r.height;
+        if (hovered != widget.m_hovered) {
+            widget.m_hovered = hovered;
+            dirty = true;
+        }
+    }
+
+    for (auto& child : widget.m_children) {
+        dirty |= SyncWidget(*child, widget.m_rect, layoutChanged, mouseMoved);
+    }
+    return dirty;
+}
+
+void UIWidgetTree::BuildWidget(UIWidget& widget) {
+    if (!widget.m_visible) return;
+
+    widget.Build(*this);
+    for (auto& child : widget.m_children) {
+        BuildWidget(*child);
+    }
+}
+
+UIRect UIWidgetTree::ResolveRect(const UIWidget& widget, const UIRect& parent) const {
+    UIRect rect = { 0.0f, 0.0f, widget.m_width, widget.m_height };
+    switch (widget.m_anchor) {
+        case UIAnchor::TopLeft:
+            rect.x = parent.x + widget.m_offsetX;
+            rect.y = parent.y + widget.m_offsetY;
+            break;
+        case UIAnchor::TopRight:
+            rect.x = parent.x + parent.width - widget.m_offsetX - widget.m_width;
+            rect.y = parent.y + widget.m_offsetY;
+            break;
+        case UIAnchor::BottomLeft:
+            rect.x = parent.x + widget.m_offsetX;
+            rect.y = parent.y + parent.height - widget.m_offsetY - widget.m_height;
+            break;
+        case UIAnchor::BottomRight:
+            rect.x = parent.x + parent.width - widget.m_offsetX - widget.m_width;
+            rect.y = parent.y + parent.height - widget.m_offsetY - widget.m_height;
+            break;
+        case UIAnchor::Center:
+            rect.x = parent.x + (parent.width - widget.m_width) * 0.5f + widget.m_offsetX;
+            rect.y = parent.y + (parent.height - widget.m_height) * 0.5f + widget.m_offsetY;
+            break;
+        case UIAnchor::Fill:
+            rect = parent;
+            break;
+    }
+    return rect;
+}
+
+void UIWidgetTree::AddQuad(float x0, float y0, float x1, float y1,
+                           float u0, float v0, float u1, float v1, const UIColor& color) {
+    UIWidgetVertex vertex;
+    vertex.Set<VertexSemantic::Color>({ color.r, color.g, color.b, color.a });
+    const float corners[4][4] = { { x0, y0, u0, v0 }, { x1, y0, u1, v0 }, { x1, y1, u1, v1 }, { x0, y1, u0, v1 } };
+    for (const float* corner : corners) {
+        vertex.Set<VertexSemantic::Position>({ corner[0], corner[1] });
+        vertex.Set<VertexSemantic::TexCoord>({ corner[2], corner[3] });
+        m_vertices.push_back(vertex);
+    }
+}
+
+void UIWidgetTree::AddSolidQuad(const UIRect& rect, const UIColor& color) {
+    const FontAtlas::Glyph& solid = m_font->GetSolidGlyph();
+    AddQuad(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height,
+            solid.u0, solid.v0, solid.u1, solid.v1, color);
+}
+
+void UIWidgetTree::AddText(UITextLayout& pinned, const std::string& text, float scale,
+                           float x, float y, bool centered, const UIRect& bounds, const UIColor& color) {
+    const TextLayoutCache::Layout& layout = ResolveText(pinned, text, scale);
+
+    if (centered) {
+        x = bounds.x + (bounds.width - layout.width) * 0.5f;
+        y = bounds.y + (bounds.height - layout.height) * 0.5f;
+    }
+
+    for (const TextLayoutCache::Quad& quad : layout.quads) {
+        AddQuad(x + quad.x0, y + quad.y0, x + quad.x1, y + quad.y1,
+                quad.u0, quad.v0, quad.u1, quad.v1, color);
+    }
+}
+
+const TextLayoutCache::Layout& UIWidgetTree::ResolveText(UITextLayout& pinned, const std::string& text, float scale) {
+    // Pinned layouts are never evicted, so this only re-acquires after a text change or Clear
+    if (pinned.m_cache != m_textCache || !m_textCache->IsValid(pinned.m_handle)) {
+        pinned.Reset();
+        pinned.m_handle = m_textCache->Acquire(text, *m_font, scale);
+        pinned.m_cache = m_textCache;
+    }
+    return m_textCache->Get(pinned.m_handle);
+}
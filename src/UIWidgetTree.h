@@ -0,0 +1,209 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "FontAtlas.h"
+#include "TextLayoutCache.h"
+#include "VertexFormats.h"
+
+struct UIColor {
+    float r, g, b, a;
+};
+
+struct UIRect {
+    float x, y, width, height;
+};
+
+// Top-level widgets are positioned relative to a screen anchor so a resize
+// only needs a geometry rebuild, not new offsets.
+enum class UIAnchor {
+    TopLeft,
+    TopRight,
+    BottomLeft,
+    BottomRight,
+    Center,
+    Fill  // Stretches over the parent; offsets and size are ignored
+};
+
+// UIOverlay draws the same vertex, so cached geometry uploads as-is
+using UIWidgetVertex = UIVertexLayout::Vertex;
+
+class UIWidgetTree;
+
+// A widget's layout pinned in its tree's TextLayoutCache; released when the
+// text changes or the widget is destroyed
+class UITextLayout {
+public:
+    UITextLayout();
+    ~UITextLayout();
+    UITextLayout(const UITextLayout&) = delete;
+    UITextLayout& operator=(const UITextLayout&) = delete;
+
+    void Reset();
+
+private:
+    friend class UIWidgetTree;
+
+    TextLayoutCache* m_cache;
+    TextLayoutCache::Handle m_handle;
+};
+
+class UIWidget {
+public:
+    UIWidget(UIAnchor anchor, float offsetX, float offsetY, float width, float height);
+    virtual ~UIWidget();
+
+    UIWidget* AddChild(std::unique_ptr<UIWidget> child);
+    void SetVisible(bool visible);
+    bool IsVisible() const { return m_visible; }
+    bool IsHovered() const { return m_hovered; }
+    const UIRect& GetRect() const { return m_rect; }
+
+protected:
+    friend class UIWidgetTree;
+
+    // Polls bound values; returns true if this widget's geometry changed
+    virtual bool Sync() { return false; }
+    virtual void Build(UIWidgetTree& tree) = 0;
+    virtual bool IsInteractive() const { return false; }
+
+    UIAnchor m_anchor;
+    float m_offsetX;
+    float m_offsetY;
+    float m_width;
+    float m_height;
+    bool m_visible;
+    bool m_visibilityChanged;
+    bool m_hovered;
+    UIRect m_rect;  // Resolved screen rectangle
+    std::vector<std::unique_ptr<UIWidget>> m_children;
+};
+
+class UIPanel : public UIWidget {
+public:
+    UIPanel(UIAnchor anchor, float offsetX, float offsetY, float width, float height, UIColor color);
+
+protected:
+    void Build(UIWidgetTree& tree) override;
+
+private:
+    UIColor m_color;
+};
+
+// Horizontal fill bar bound to a live value
+class UIBar : public UIWidget {
+public:
+    UIBar(UIAnchor anchor, float offsetX, float offsetY, float width, float height,
+          UIColor background, UIColor fill);
+
+    void Bind(std::function<float()> value, float maxValue);
+
+protected:
+    bool Sync() override;
+    void Build(UIWidgetTree& tree) override;
+
+private:
+    UIColor m_background;
+    UIColor m_fill;
+    std::function<float()> m_value;
+    float m_maxValue;
+    int m_fillPixels;  // Quantized so sub-pixel changes do not trigger rebuilds
+};
+
+class UILabel : public UIWidget {
+public:
+    UILabel(UIAnchor anchor, float offsetX, float offsetY, const std::string& text,
+            float scale = 1.0f, UIColor color = { 1.0f, 1.0f, 1.0f, 1.0f });
+
+    void SetText(const std::string& text);
+    // Text is re-formatted only when the bound integer changes
+    void BindInt(std::function<int()> value, const char* format);
+    void SetCentered(bool centered) { m_centered = centered; }
+
+protected:
+    bool Sync() override;
+    void Build(UIWidgetTree& tree) override;
+
+private:
+    std::string m_text;
+    float m_scale;
+    UIColor m_color;
+    bool m_centered;
+    bool m_textChanged;
+    UITextLayout m_layout;
+    std::function<int()> m_intValue;
+    std::string m_format;
+    int m_lastValue;
+    bool m_hasValue;
+};
+
+class UIButton : public UIWidget {
+public:
+    UIButton(UIAnchor anchor, float offsetX, float offsetY, float width, float height,
+             const std::string& text);
+
+    const std::string& GetText() const { return m_text; }
+
+protected:
+    void Build(UIWidgetTree& tree) override;
+    bool IsInteractive() const override { return true; }
+
+private:
+    std::string m_text;
+    UITextLayout m_layout;
+};
+
+// Retained UI: geometry is cached and rebuilt only when a bound value, hover
+// state, visibility or the screen size changes.
+class UIWidgetTree {
+public:
+    struct Stats {
+        uint64_t frames;
+        uint64_t rebuilds;
+        uint64_t skippedRebuilds;
+
+        double GetSkippedRebuildRatio() const {
+            return frames > 0 ? static_cast<double>(skippedRebuilds) / frames : 0.0;
+        }
+    };
+
+    UIWidgetTree();
+    ~UIWidgetTree();
+
+    void Initialize(FontAtlas* font, TextLayoutCache* textCache);
+    UIWidget* Add(std::unique_ptr<UIWidget> widget);
+
+    // Returns true if the cached geometry was rebuilt this frame
+    bool Update(int screenWidth, int screenHeight, float mouseX, float mouseY);
+
+    const std::vector<UIWidgetVertex>& GetVertices() const { return m_vertices; }
+    uint64_t GetGeometryVersion() const { return m_geometryVersion; }
+    const Stats& GetStats() const { return m_stats; }
+
+    // Used by widgets while building geometry
+    void AddQuad(float x0, float y0, float x1, float y1,
+                 float u0, float v0, float u1, float v1, const UIColor& color);
+    void AddSolidQuad(const UIRect& rect, const UIColor& color);
+    void AddText(UITextLayout& pinned, const std::string& text, float scale,
+                 float x, float y, bool centered, const UIRect& bounds, const UIColor& color);
+    const TextLayoutCache::Layout& ResolveText(UITextLayout& pinned, const std::string& text, float scale);
+
+private:
+    FontAtlas* m_font;
+    TextLayoutCache* m_textCache;
+    std::vector<std::unique_ptr<UIWidget>> m_roots;
+    std::vector<UIWidgetVertex> m_vertices;
+    int m_screenWidth;
+    int m_screenHeight;
+    float m_mouseX;
+    float m_mouseY;
+    uint64_t m_geometryVersion;
+    bool m_forceRebuild;
+    Stats m_stats;
+
+    bool SyncWidget(UIWidget& widget, const UIRect& parent, bool layoutChanged, bool mouseMoved);
+    void BuildWidget(UIWidget& widget);
+    UIRect ResolveRect(const UIWidget& widget, const UIRect& parent) const;
+};
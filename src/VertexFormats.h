@@ -0,0 +1,24 @@
+#pragma once
+#include "VertexLayout.h"
+
+// The game's vertex formats. Changing one here changes the vertex storage,
+// input layouts and shader declarations together; shaders/VertexLayout.hlsli
+// is the scene format's declarations for offline shader builds, checked
+// against this file by the VertexLayoutCheck test.
+
+// Floor and cube meshes: 20 bytes, was 40 with a float4 color and float3 normal
+using SceneVertexLayout = VertexLayout<
+    VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+    VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>,
+    VertexAttribute<VertexSemantic::Normal, VertexFormat::Octahedral16>>;
+
+// Screen-space UI quads: 16 bytes, was 36 with z, float UVs and a float4 color
+using UIVertexLayout = VertexLayout<
+    VertexAttribute<VertexSemantic::Position, VertexFormat::Float2>,
+    VertexAttribute<VertexSemantic::TexCoord, VertexFormat::Half2>,
+    VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
+
+// Camera-facing particle quads expanded on the CPU: 16 bytes, was 28
+using ParticleVertexLayout = VertexLayout<
+    VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+    VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>>;
@@ -0,0 +1,363 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "MathTypes.h"
+
+// Vertex formats declared once as a list of attributes, from which the vertex
+// storage, its byte offsets, the D3D11 input elements (D3D11VertexLayout.h),
+// the GL array bindings (GLVertexLayout.h) and the HLSL input declarations are
+// all generated, so they cannot drift apart:
+//
+//   using SceneVertexLayout = VertexLayout<
+//       VertexAttribute<VertexSemantic::Position, VertexFormat::Float3>,
+//       VertexAttribute<VertexSemantic::Color, VertexFormat::Unorm8x4>,
+//       VertexAttribute<VertexSemantic::Normal, VertexFormat::Octahedral16>>;
+//
+//   SceneVertexLayout::Vertex vertex;
+//   vertex.Set<VertexSemantic::Normal>({ 0.0f, 1.0f, 0.0f });  // Quantized here
+//
+// A repeated semantic, a format a semantic cannot use, setting an attribute
+// the layout lacks, or a value of the wrong type fails to compile, as does a
+// shader's static_assert(Layout::Provides<...>()) when inputs are missing.
+
+enum class VertexSemantic : uint8_t {
+    Position,
+    Color,
+    Normal,
+    TexCoord
+};
+
+// Everything but Octahedral16 is decoded by the input assembler; its two
+// SNORMs arrive as a float2 that DecodeVertex in the generated HLSL unfolds
+enum class VertexFormat : uint8_t {
+    Float2,
+    Float3,
+    Float4,
+    Half2,          // Exact for texel edges of power-of-two atlases up to 2048 texels
+    Unorm8x4,       // Colors in 1/255 steps
+    Octahedral16    // Unit vectors folded onto an octahedron, two 16-bit SNORMs
+};
+
+struct VertexElement {
+    VertexSemantic semantic;
+    VertexFormat format;
+    uint32_t offset;
+};
+
+inline const char* GetSemanticName(VertexSemantic semantic) {
+    static const char* const NAMES[] = { "POSITION", "COLOR", "NORMAL", "TEXCOORD" };
+    return NAMES[static_cast<uint32_t>(semantic)];
+}
+
+// Field name in the generated HLSL structs
+inline const char* GetSemanticField(VertexSemantic semantic) {
+    static const char* const FIELDS[] = { "Position", "Color", "Normal", "TexCoord" };
+    return FIELDS[static_cast<uint32_t>(semantic)];
+}
+
+constexpr uint32_t GetVertexFormatSize(VertexFormat format) {
+    return format == VertexFormat::Float2 ? 8 :
+           format == VertexFormat::Float3 ? 12 :
+           format == VertexFormat::Float4 ? 16 : 4;
+}
+
+constexpr bool IsVertexFormatAllowed(VertexSemantic semantic, VertexFormat format) {
+    switch (semantic) {
+        case VertexSemantic::Position:
+            return format == VertexFormat::Float2 || format == VertexFormat::Float3 || format == VertexFormat::Float4;
+        case VertexSemantic::Color:
+            return format == VertexFormat::Float4 || format == VertexFormat::Unorm8x4;
+        case VertexSemantic::Normal:
+            return format == VertexFormat::Float3 || format == VertexFormat::Octahedral16;
+        case VertexSemantic::TexCoord:
+            return format == VertexFormat::Float2 || format == VertexFormat::Half2;
+    }
+    return false;
+}
+
+// Round to nearest even; overflow becomes infinity and tiny values subnormals
+inline uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+    if (magnitude >= 0x7F800000u) {
+        return static_cast<uint16_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x47800000u) return static_cast<uint16_t>(sign | 0x7C00u);
+    if (magnitude < 0x38800000u) {
+        // Subnormal: shift the implicit-one mantissa into place, rounding the dropped bits
+        if (magnitude < 0x33000000u) return static_cast<uint16_t>(sign);
+        uint32_t exponent = magnitude >> 23;
+        uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (remainder > midpoint || (remainder == midpoint && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    uint32_t remainder = magnitude & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+inline float HalfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa != 0) {
+        float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    } else {
+        bits = sign;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline Float3 DecodeOctahedral(const int16_t encoded[2]) {
+    float x = std::fmax(encoded[0] / 32767.0f, -1.0f);
+    float y = std::fmax(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+    float t = std::fmax(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = sqrtf(x * x + y * y + z * z);
+    return { x / length, y / length, z / length };
+}
+
+// Encodes a unit vector; the reverse of DecodeOctahedral in the generated HLSL.
+// Of the four neighbouring SNORM pairs it keeps the one that decodes closest,
+// which keeps the worst error well under plain rounding's.
+inline void EncodeOctahedral(const Float3& normal, int16_t encoded[2]) {
+    float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    float x = length > 0.0f ? normal.x / length : 0.0f;
+    float y = length > 0.0f ? normal.y / length : 0.0f;
+    if (normal.z < 0.0f) {
+        float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    float baseX = floorf(x * 32767.0f), baseY = floorf(y * 32767.0f);
+    float bestDot = -2.0f;
+    for (int corner = 0; corner < 4; ++corner) {
+        float candidateX = std::fmin(std::fmax(baseX + (corner & 1), -32767.0f), 32767.0f);
+        float candidateY = std::fmin(std::fmax(baseY + (corner >> 1), -32767.0f), 32767.0f);
+        int16_t candidate[2] = { static_cast<int16_t>(candidateX), static_cast<int16_t>(candidateY) };
+        Float3 decoded = DecodeOctahedral(candidate);
+        float dot = decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z;
+        if (dot > bestDot) {
+            bestDot = dot;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+// The value a format is set from and read back as, and its encoding
+template <VertexFormat Format> struct VertexFormatTraits;
+
+template <> struct VertexFormatTraits<VertexFormat::Float2> {
+    using Value = Float2;
+    static void Encode(const Value& value, uint8_t* out) { memcpy(out, &value, sizeof(value)); }
+    static Value Decode(const uint8_t* in) { Value value; memcpy(&value, in, sizeof(value)); return value; }
+};
+
+template <> struct VertexFormatTraits<VertexFormat::Float3> {
+    using Value = Float3;
+    static void Encode(const Value& value, uint8_t* out) { memcpy(out, &value, sizeof(value)); }
+    static Value Decode(const uint8_t* in) { Value value; memcpy(&value, in, sizeof(value)); return value; }
+};
+
+template <> struct VertexFormatTraits<VertexFormat::Float4> {
+    using Value = Float4;
+    static void Encode(const Value& value, uint8_t* out) { memcpy(out, &value, sizeof(value)); }
+    static Value Decode(const uint8_t* in) { Value value; memcpy(&value, in, sizeof(value)); return value; }
+};
+
+template <> struct VertexFormatTraits<VertexFormat::Half2> {
+    using Value = Float2;
+    static void Encode(const Value& value, uint8_t* out) {
+        uint16_t halves[2] = { FloatToHalf(value.x), FloatToHalf(value.y) };
+        memcpy(out, halves, sizeof(halves));
+    }
+    static Value Decode(const uint8_t* in) {
+        uint16_t halves[2];
+        memcpy(halves, in, sizeof(halves));
+        return { HalfToFloat(halves[0]), HalfToFloat(halves[1]) };
+    }
+};
+
+template <> struct VertexFormatTraits<VertexFormat::Unorm8x4> {
+    using Value = Float4;
+    static void Encode(const Value& value, uint8_t* out) {
+        const float channels[4] = { value.x, value.y, value.z, value.w };
+        for (int i = 0; i < 4; ++i) {
+            float clamped = channels[i] < 0.0f ? 0.0f : (channels[i] > 1.0f ? 1.0f : channels[i]);
+            out[i] = static_cast<uint8_t>(clamped * 255.0f + 0.5f);
+        }
+    }
+    static Value Decode(const uint8_t* in) {
+        return { in[0] / 255.0f, in[1] / 255.0f, in[2] / 255.0f, in[3] / 255.0f };
+    }
+};
+
+template <> struct VertexFormatTraits<VertexFormat::Octahedral16> {
+    using Value = Float3;
+    static void Encode(const Value& value, uint8_t* out) {
+        int16_t encoded[2];
+        EncodeOctahedral(value, encoded);
+        memcpy(out, encoded, sizeof(encoded));
+    }
+    static Value Decode(const uint8_t* in) {
+        int16_t encoded[2];
+        memcpy(encoded, in, sizeof(encoded));
+        return DecodeOctahedral(encoded);
+    }
+};
+
+template <VertexSemantic Semantic, VertexFormat Format>
+struct VertexAttribute {
+    static_assert(IsVertexFormatAllowed(Semantic, Format), "Vertex format not usable for this semantic");
+    static_assert(GetVertexFormatSize(Format) % 4 == 0, "D3D11 needs every element 4-byte aligned");
+
+    static constexpr VertexSemantic SEMANTIC = Semantic;
+    static constexpr VertexFormat FORMAT = Format;
+};
+
+template <typename... Attributes>
+class VertexLayout {
+public:
+    static constexpr uint32_t ELEMENT_COUNT = sizeof...(Attributes);
+    static constexpr uint32_t STRIDE = (0u + ... + GetVertexFormatSize(Attributes::FORMAT));
+    static constexpr std::array<VertexElement, ELEMENT_COUNT> ELEMENTS = [] {
+        std::array<VertexElement, ELEMENT_COUNT> elements = {};
+        uint32_t index = 0, offset = 0;
+        ((elements[index++] = { Attributes::SEMANTIC, Attributes::FORMAT, offset },
+          offset += GetVertexFormatSize(Attributes::FORMAT)), ...);
+        return elements;
+    }();
+
+    static_assert(ELEMENT_COUNT > 0, "A vertex layout needs at least one attribute");
+    static_assert([] {
+        for (uint32_t i = 0; i < ELEMENT_COUNT; ++i) {
+            for (uint32_t j = i + 1; j < ELEMENT_COUNT; ++j) {
+                if (ELEMENTS[i].semantic == ELEMENTS[j].semantic) return false;
+            }
+        }
+        return true;
+    }(), "Each semantic may appear only once in a vertex layout");
+
+    static constexpr uint32_t IndexOf(VertexSemantic semantic) {
+        for (uint32_t i = 0; i < ELEMENT_COUNT; ++i) {
+            if (ELEMENTS[i].semantic == semantic) return i;
+        }
+        return ELEMENT_COUNT;
+    }
+
+    static constexpr bool Has(VertexSemantic semantic) { return IndexOf(semantic) < ELEMENT_COUNT; }
+
+    // For a shader's static_assert on the inputs it reads
+    template <VertexSemantic... Semantics>
+    static constexpr bool Provides() { return (true && ... && Has(Semantics)); }
+
+    // Takes any value for an attribute the layout lacks, so Set and Get get as far as their static_assert
+    struct MissingAttribute {
+        using Value = MissingAttribute;
+        template <typename... Args> MissingAttribute(Args&&...) {}
+        static void Encode(const Value&, uint8_t*) {}
+        static Value Decode(const uint8_t*) { return {}; }
+    };
+
+    template <VertexSemantic Semantic>
+    using Traits = std::conditional_t<Has(Semantic), VertexFormatTraits<ELEMENTS[Has(Semantic) ? IndexOf(Semantic) : 0].format>,
+                                      MissingAttribute>;
+
+    struct alignas(4) Vertex {
+        uint8_t bytes[STRIDE];
+
+        template <VertexSemantic Semantic>
+        void Set(const typename Traits<Semantic>::Value& value) {
+            static_assert(Has(Semantic), "The vertex layout has no such attribute");
+            Traits<Semantic>::Encode(value, bytes + ELEMENTS[IndexOf(Semantic)].offset);
+        }
+
+        template <VertexSemantic Semantic>
+        typename Traits<Semantic>::Value Get() const {
+            static_assert(Has(Semantic), "The vertex layout has no such attribute");
+            return Traits<Semantic>::Decode(bytes + ELEMENTS[IndexOf(Semantic)].offset);
+        }
+    };
+    static_assert(sizeof(Vertex) == STRIDE, "Vertex storage must be exactly one stride");
+
+    // HLSL struct VertexInput as the input assembler delivers it, struct
+    // VertexAttributes as the shader uses it (float4 Position with w = 1,
+    // float4 Color, float3 Normal, float2 TexCoord), and DecodeVertex between them
+    static std::string GetHlslDeclarations() {
+        std::string text = "struct VertexInput {\n";
+        for (const VertexElement& element : ELEMENTS) {
+            text += std::string("    ") + GetHlslStoredType(element.format) + " " + GetSemanticField(element.semantic) + " : " +
+                    GetSemanticName(element.semantic) + ";\n";
+        }
+        text += "};\n\nstruct VertexAttributes {\n";
+        for (const VertexElement& element : ELEMENTS) {
+            text += std::string("    ") + GetHlslDecodedType(element.semantic) + " " + GetSemanticField(element.semantic) + ";\n";
+        }
+        text += "};\n\n"
+                "float3 DecodeOctahedral(float2 e) {\n"
+                "    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));\n"
+                "    float t = saturate(-n.z);\n"
+                "    n.xy += n.xy >= 0.0f ? -t : t;\n"
+                "    return normalize(n);\n"
+                "}\n\n"
+                "VertexAttributes DecodeVertex(VertexInput input) {\n"
+                "    VertexAttributes output;\n";
+        for (const VertexElement& element : ELEMENTS) {
+            std::string field = GetSemanticField(element.semantic);
+            std::string value = "input." + field;
+            if (element.format == VertexFormat::Octahedral16) value = "DecodeOctahedral(" + value + ")";
+            if (element.format == VertexFormat::Float2 && element.semantic == VertexSemantic::Position) {
+                value = "float4(" + value + ", 0.0f, 1.0f)";
+            }
+            if (element.format == VertexFormat::Float3 && element.semantic == VertexSemantic::Position) {
+                value = "float4(" + value + ", 1.0f)";
+            }
+            text += "    output." + field + " = " + value + ";\n";
+        }
+        text += "    return output;\n}\n";
+        return text;
+    }
+
+private:
+    static const char* GetHlslStoredType(VertexFormat format) {
+        switch (format) {
+            case VertexFormat::Float3: return "float3";
+            case VertexFormat::Float4:
+            case VertexFormat::Unorm8x4: return "float4";
+            default: return "float2";
+        }
+    }
+
+    static const char* GetHlslDecodedType(VertexSemantic semantic) {
+        switch (semantic) {
+            case VertexSemantic::Position:
+            case VertexSemantic::Color: return "float4";
+            case VertexSemantic::Normal: return "float3";
+            default: return "float2";
+        }
+    }
+};
@@ -0,0 +1,126 @@
+#include "WasapiAudioSink.h"
+#include <mmreg.h>
+#include <algorithm>
+#include <cstring>
+
+WasapiAudioSink::WasapiAudioSink() :
+    m_device(nullptr),
+    m_client(nullptr),
+    m_render(nullptr),
+    m_bufferEvent(nullptr),
+    m_bufferFrames(0),
+    m_comInitialized(false),
+    m_started(false) {
+}
+
+WasapiAudioSink::~WasapiAudioSink() {
+    Close();
+}
+
+bool WasapiAudioSink::Open(uint32_t sampleRate) {
+    Close();
+    // Open runs on the mixer's caller, Write on the mixer thread; the multithreaded apartment serves both
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return false;
+    m_comInitialized = SUCCEEDED(hr);
+
+    IMMDeviceEnumerator* enumerator = nullptr;
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),
+                          reinterpret_cast<void**>(&enumerator));
+    if (FAILED(hr)) {
+        Close();
+        return false;
+    }
+    hr = enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &m_device);
+    enumerator->Release();
+    if (FAILED(hr)) {
+        Close();
+        return false;
+    }
+
+    hr = m_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, reinterpret_cast<void**>(&m_client));
+    if (FAILED(hr)) {
+        Close();
+        return false;
+    }
+
+    // The engine converts our float stereo to the device's mix format
+    WAVEFORMATEX format = {};
+    format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+    format.nChannels = 2;
+    format.nSamplesPerSec = sampleRate;
+    format.wBitsPerSample = 32;
+    format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+    format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+    DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM |
+                  AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY;
+    hr = m_client->Initialize(AUDCLNT_SHAREMODE_SHARED, flags, BUFFER_DURATION, 0, &format, nullptr);
+    if (FAILED(hr)) {
+        Close();
+        return false;
+    }
+
+    m_bufferEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!m_bufferEvent || FAILED(m_client->SetEventHandle(m_bufferEvent)) ||
+        FAILED(m_client->GetBufferSize(&m_bufferFrames)) ||
+        FAILED(m_client->GetService(__uuidof(IAudioRenderClient), reinterpret_cast<void**>(&m_render)))) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool WasapiAudioSink::Write(const float* frames, uint32_t frameCount) {
+    if (!m_render) return false;
+    while (frameCount > 0) {
+        UINT32 padding = 0;
+        if (FAILED(m_client->GetCurrentPadding(&padding))) return false;
+        UINT32 available = (std::min)(m_bufferFrames - padding, frameCount);
+        if (available == 0) {
+            // Woken each time the device consumes a period
+            WaitForSingleObject(m_bufferEvent, 100);
+            continue;
+        }
+
+        BYTE* buffer = nullptr;
+        if (FAILED(m_render->GetBuffer(available, &buffer))) return false;
+        memcpy(buffer, frames, available * 2 * sizeof(float));
+        if (FAILED(m_render->ReleaseBuffer(available, 0))) return false;
+        frames += available * 2;
+        frameCount -= available;
+
+        // Start once the first data is queued so playback does not begin on silence
+        if (!m_started) {
+            if (FAILED(m_client->Start())) return false;
+            m_started = true;
+        }
+    }
+    return true;
+}
+
+void WasapiAudioSink::Close() {
+    if (m_client && m_started) {
+        m_client->Stop();
+    }
+    m_started = false;
+    if (m_render) {
+        m_render->Release();
+        m_render = nullptr;
+    }
+    if (m_client) {
+        m_client->Release();
+        m_client = nullptr;
+    }
+    if (m_device) {
+        m_device->Release();
+        m_device = nullptr;
+    }
+    if (m_bufferEvent) {
+        CloseHandle(m_bufferEvent);
+        m_bufferEvent = nullptr;
+    }
+    if (m_comInitialized) {
+        CoUninitialize();
+        m_comInitialized = false;
+    }
+}
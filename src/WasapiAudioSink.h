@@ -0,0 +1,31 @@
+#pragma once
+#include <windows.h>
+#include <audioclient.h>
+#include <mmdeviceapi.h>
+#include "AudioSink.h"
+
+// Plays through the default output device in shared mode. Write waits until
+// the device buffer has room, so the mixer stays a fixed short distance ahead
+// of playback. Open fails on machines without an output device. Open and
+// Close must run on the same thread, which initializes COM for the sink.
+class WasapiAudioSink : public AudioSink {
+public:
+    WasapiAudioSink();
+    ~WasapiAudioSink() override;
+
+    bool Open(uint32_t sampleRate) override;
+    bool Write(const float* frames, uint32_t frameCount) override;
+    void Close() override;
+
+private:
+    IMMDevice* m_device;
+    IAudioClient* m_client;
+    IAudioRenderClient* m_render;
+    HANDLE m_bufferEvent;
+    UINT32 m_bufferFrames;
+    bool m_comInitialized;
+    bool m_started;
+
+    // Constants
+    static constexpr REFERENCE_TIME BUFFER_DURATION = 200000;  // 20 ms in 100 ns units
+};
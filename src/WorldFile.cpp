@@ -0,0 +1,141 @@
+#include "WorldFile.h"
+#include <cstring>
+
+WorldFile::WorldFile() : m_header(), m_fileSize(0) {
+}
+
+WorldFile::~WorldFile() {
+    Close();
+}
+
+bool WorldFile::Open(const char* path) {
+    Close();
+
+    m_stream.open(path, std::ios::binary);
+    if (!m_stream) return false;
+
+    m_stream.seekg(0, std::ios::end);
+    m_fileSize = static_cast<uint64_t>(m_stream.tellg());
+    m_stream.seekg(0, std::ios::beg);
+
+    if (!m_stream.read(reinterpret_cast<char*>(&m_header), sizeof(m_header)) ||
+        m_header.magic != FILE_MAGIC || m_header.version != FILE_VERSION ||
+        m_header.chunkSize <= 0.0f || m_header.chunksX == 0 || m_header.chunksZ == 0 ||
+        m_header.chunksX > MAX_CHUNKS_PER_SIDE || m_header.chunksZ > MAX_CHUNKS_PER_SIDE) {
+        Close();
+        return false;
+    }
+
+    // A truncated or corrupt header must not size the table past what the file holds
+    uint64_t tableSize = static_cast<uint64_t>(m_header.chunksX) * m_header.chunksZ * sizeof(ChunkEntry);
+    if (sizeof(Header) + tableSize > m_fileSize) {
+        Close();
+        return false;
+    }
+
+    m_chunks.resize(static_cast<size_t>(m_header.chunksX) * m_header.chunksZ);
+    if (!m_stream.read(reinterpret_cast<char*>(m_chunks.data()), m_chunks.size() * sizeof(ChunkEntry))) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void WorldFile::Close() {
+    if (m_stream.is_open()) {
+        m_stream.close();
+    }
+    m_stream.clear();
+    m_chunks.clear();
+    m_header = {};
+    m_fileSize = 0;
+}
+
+bool WorldFile::Contains(int32_t x, int32_t z) const {
+    return x >= 0 && z >= 0 && static_cast<uint32_t>(x) < m_header.chunksX && static_cast<uint32_t>(z) < m_header.chunksZ;
+}
+
+bool WorldFile::ReadChunk(int32_t x, int32_t z, WorldChunk& chunk) {
+    if (!IsOpen() || !Contains(x, z)) return false;
+
+    const ChunkEntry& entry = m_chunks[static_cast<size_t>(z) * m_header.chunksX + x];
+    if (entry.offset + entry.size > m_fileSize || entry.size < sizeof(ChunkHeader)) return false;
+
+    m_buffer.resize(entry.size);
+    m_stream.seekg(static_cast<std::streamoff>(entry.offset), std::ios::beg);
+    if (!m_stream.read(m_buffer.data(), entry.size)) {
+        m_stream.clear();
+        return false;
+    }
+
+    ChunkHeader header;
+    std::memcpy(&header, m_buffer.data(), sizeof(header));
+    if (header.magic != CHUNK_MAGIC) return false;
+
+    chunk.x = x;
+    chunk.z = z;
+    chunk.objects.clear();
+
+    size_t cursor = sizeof(ChunkHeader);
+    for (uint32_t i = 0; i < header.sectionCount; ++i) {
+        SectionHeader section;
+        if (cursor + sizeof(section) > m_buffer.size()) return false;
+        std::memcpy(&section, m_buffer.data() + cursor, sizeof(section));
+        cursor += sizeof(section);
+        if (cursor + section.size > m_buffer.size()) return false;
+
+        if (section.tag == SECTION_OBJECTS) {
+            chunk.objects.resize(section.size / sizeof(WorldObject));
+            std::memcpy(chunk.objects.data(), m_buffer.data() + cursor, chunk.objects.size() * sizeof(WorldObject));
+        }
+        cursor += section.size;
+    }
+
+    chunk.bytes = sizeof(WorldChunk) + chunk.objects.capacity() * sizeof(WorldObject);
+    return true;
+}
+
+bool WorldFile::Write(const char* path, uint32_t chunksX, uint32_t chunksZ, float chunkSize,
+                      float originX, float originZ, const ChunkBuilder& build) {
+    if (chunksX == 0 || chunksZ == 0 || chunksX > MAX_CHUNKS_PER_SIDE || chunksZ > MAX_CHUNKS_PER_SIDE) return false;
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    Header header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.chunksX = chunksX;
+    header.chunksZ = chunksZ;
+    header.chunkSize = chunkSize;
+    header.originX = originX;
+    header.originZ = originZ;
+
+    // The table is written last, once every chunk's offset is known
+    std::vector<ChunkEntry> table(static_cast<size_t>(chunksX) * chunksZ, ChunkEntry());
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(ChunkEntry));
+
+    std::vector<WorldObject> objects;
+    for (uint32_t z = 0; z < chunksZ; ++z) {
+        for (uint32_t x = 0; x < chunksX; ++x) {
+            objects.clear();
+            build(static_cast<int32_t>(x), static_cast<int32_t>(z), objects);
+
+            ChunkHeader chunkHeader = { CHUNK_MAGIC, 1 };
+            SectionHeader section = { SECTION_OBJECTS, static_cast<uint32_t>(objects.size() * sizeof(WorldObject)) };
+
+            ChunkEntry& entry = table[static_cast<size_t>(z) * chunksX + x];
+            entry.offset = static_cast<uint64_t>(stream.tellp());
+            entry.size = static_cast<uint32_t>(sizeof(chunkHeader) + sizeof(section) + section.size);
+
+            stream.write(reinterpret_cast<const char*>(&chunkHeader), sizeof(chunkHeader));
+            stream.write(reinterpret_cast<const char*>(&section), sizeof(section));
+            stream.write(reinterpret_cast<const char*>(objects.data()), section.size);
+        }
+    }
+
+    stream.seekp(sizeof(header), std::ios::beg);
+    stream.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(ChunkEntry));
+    return static_cast<bool>(stream);
+}
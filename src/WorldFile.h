@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <vector>
+#include "MathTypes.h"
+
+// Four characters packed as they appear in the file
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+}
+
+// One placed object; meshes are authored in a unit box and scaled to halfExtents
+struct WorldObject {
+    uint32_t mesh;
+    uint32_t flags;
+    Float3 position;     // Center of the bounds
+    Float3 halfExtents;
+};
+
+enum WorldObjectFlags : uint32_t {
+    WORLD_OBJECT_OCCLUDER = 1
+};
+
+// Decoded contents of one chunk
+struct WorldChunk {
+    int32_t x;
+    int32_t z;
+    std::vector<WorldObject> objects;
+    size_t bytes;  // Memory held by this chunk
+};
+
+// Binary world map split into a grid of square chunks, little endian:
+//
+//   Header
+//   ChunkEntry[chunksX * chunksZ]    row-major, z outer
+//   chunk blobs, each a ChunkHeader followed by tagged sections
+//
+// Readers skip section tags they do not know, so tools can append new
+// sections to chunks without breaking older builds.
+class WorldFile {
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t chunksX;
+        uint32_t chunksZ;
+        float chunkSize;
+        float originX;  // World position of chunk (0, 0)'s minimum corner
+        float originZ;
+        uint32_t reserved;
+    };
+
+    struct ChunkEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    struct ChunkHeader {
+        uint32_t magic;
+        uint32_t sectionCount;
+    };
+
+    struct SectionHeader {
+        uint32_t tag;
+        uint32_t size;  // Bytes of data following this header
+    };
+
+    // Fills in the objects of chunk (x, z) when writing
+    using ChunkBuilder = std::function<void(int32_t x, int32_t z, std::vector<WorldObject>& objects)>;
+
+    WorldFile();
+    ~WorldFile();
+
+    // Reads the header and chunk table; chunk data is read on demand
+    bool Open(const char* path);
+    void Close();
+
+    // Not thread safe; give each reading thread its own WorldFile
+    bool ReadChunk(int32_t x, int32_t z, WorldChunk& chunk);
+
+    bool IsOpen() const { return m_stream.is_open(); }
+    const Header& GetHeader() const { return m_header; }
+    bool Contains(int32_t x, int32_t z) const;
+    uint64_t GetFileSize() const { return m_fileSize; }
+
+    static bool Write(const char* path, uint32_t chunksX, uint32_t chunksZ, float chunkSize,
+                      float originX, float originZ, const ChunkBuilder& build);
+
+    // Constants
+    static constexpr uint32_t FILE_MAGIC = MakeFourCC('F', 'P', 'S', 'W');
+    static constexpr uint32_t CHUNK_MAGIC = MakeFourCC('C', 'H', 'N', 'K');
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr uint32_t SECTION_OBJECTS = MakeFourCC('O', 'B', 'J', 'S');  // WorldObject[]
+    static constexpr uint32_t MAX_CHUNKS_PER_SIDE = 4096;
+
+private:
+    std::ifstream m_stream;
+    Header m_header;
+    std::vector<ChunkEntry> m_chunks;
+    std::vector<char> m_buffer;
+    uint64_t m_fileSize;
+};
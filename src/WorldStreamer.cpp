@@ -0,0 +1,273 @@
+#include "WorldStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <system_error>
+
+WorldStreamer::WorldStreamer() :
+    m_header(),
+    m_loadRadius(0.0f),
+    m_unloadRadius(0.0f),
+    m_requiredRadius(0.0f),
+    m_prefetchSeconds(2.0f),
+    m_maxResidentChunks(0),
+    m_initialized(false),
+    m_updateNumber(0),
+    m_stats(),
+    m_inFlight(NO_CHUNK),
+    m_quit(false),
+    m_readDelayMilliseconds(0.0f) {
+}
+
+WorldStreamer::~WorldStreamer() {
+    Shutdown();
+}
+
+bool WorldStreamer::Initialize(const char* path, float loadRadius, uint32_t maxResidentChunks) {
+    Shutdown();
+
+    if (!m_loaderFile.Open(path)) return false;
+    m_header = m_loaderFile.GetHeader();
+    m_loadRadius = loadRadius;
+    m_unloadRadius = loadRadius + UNLOAD_MARGIN * m_header.chunkSize;
+    m_requiredRadius = std::min(loadRadius, m_header.chunkSize * 0.5f);
+    m_maxResidentChunks = std::max(maxResidentChunks, 1u);
+    m_updateNumber = 0;
+    m_stats = {};
+
+    m_quit = false;
+    try {
+        m_loader = std::thread(&WorldStreamer::LoaderMain, this);
+    } catch (const std::system_error&) {
+        m_loaderFile.Close();
+        return false;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void WorldStreamer::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+        m_queue.clear();
+    }
+    m_wake.notify_all();
+    if (m_loader.joinable()) {
+        m_loader.join();
+    }
+
+    m_completed.clear();
+    m_resident.clear();
+    m_residentList.clear();
+    m_loaderFile.Close();
+    m_initialized = false;
+}
+
+float WorldStreamer::ChunkDistance(int32_t x, int32_t z, float px, float pz) const {
+    float minX = m_header.originX + x * m_header.chunkSize;
+    float minZ = m_header.originZ + z * m_header.chunkSize;
+    float dx = std::max(std::max(minX - px, px - (minX + m_header.chunkSize)), 0.0f);
+    float dz = std::max(std::max(minZ - pz, pz - (minZ + m_header.chunkSize)), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+void WorldStreamer::WantChunksAround(float px, float pz, float radius, float penalty) {
+    const float size = m_header.chunkSize;
+    int32_t firstX = std::max(static_cast<int32_t>(std::floor((px - radius - m_header.originX) / size)), 0);
+    int32_t firstZ = std::max(static_cast<int32_t>(std::floor((pz - radius - m_header.originZ) / size)), 0);
+    int32_t lastX = std::min(static_cast<int32_t>(std::floor((px + radius - m_header.originX) / size)),
+                             static_cast<int32_t>(m_header.chunksX) - 1);
+    int32_t lastZ = std::min(static_cast<int32_t>(std::floor((pz + radius - m_header.originZ) / size)),
+                             static_cast<int32_t>(m_header.chunksZ) - 1);
+
+    for (int32_t z = firstZ; z <= lastZ; ++z) {
+        for (int32_t x = firstX; x <= lastX; ++x) {
+            float distance = ChunkDistance(x, z, px, pz);
+            if (distance > radius) continue;
+
+            // Duplicates from overlapping rings are merged by Update
+            m_wantedOrder.push_back({ Key(x, z), distance + penalty });
+        }
+    }
+}
+
+void WorldStreamer::Update(const Float3& position, const Float3& velocity) {
+    if (!m_initialized) return;
+    m_updateNumber++;
+
+    // The ring around the player, then the same ring at points it is heading for.
+    // A chunk near a point reached in t seconds is ranked as if it were speed * t further away.
+    m_wantedOrder.clear();
+    WantChunksAround(position.x, position.z, m_loadRadius, 0.0f);
+    float speed = std::sqrt(velocity.x * velocity.x + velocity.z * velocity.z);
+    if (m_prefetchSeconds > 0.0f && speed > 0.0f) {
+        for (uint32_t sample = 1; sample <= PREFETCH_SAMPLES; ++sample) {
+            float t = m_prefetchSeconds * sample / PREFETCH_SAMPLES;
+            WantChunksAround(position.x + velocity.x * t, position.z + velocity.z * t, m_loadRadius, speed * t);
+        }
+    }
+
+    // Keep each chunk once, at its best priority
+    std::sort(m_wantedOrder.begin(), m_wantedOrder.end(), [](const Request& a, const Request& b) {
+        return a.key < b.key || (a.key == b.key && a.priority < b.priority);
+    });
+    m_wantedOrder.erase(std::unique(m_wantedOrder.begin(), m_wantedOrder.end(),
+                                    [](const Request& a, const Request& b) { return a.key == b.key; }),
+                        m_wantedOrder.end());
+    std::sort(m_wantedOrder.begin(), m_wantedOrder.end(), [](const Request& a, const Request& b) {
+        return a.priority < b.priority || (a.priority == b.priority && a.key < b.key);
+    });
+
+    // Never want more than fits; the furthest prefetches go first
+    if (m_wantedOrder.size() > m_maxResidentChunks) {
+        m_wantedOrder.resize(m_maxResidentChunks);
+    }
+    m_wantedKeys.clear();
+    for (const Request& wanted : m_wantedOrder) {
+        m_wantedKeys.push_back(wanted.key);
+    }
+    std::sort(m_wantedKeys.begin(), m_wantedKeys.end());
+
+    for (const Request& wanted : m_wantedOrder) {
+        auto found = m_resident.find(wanted.key);
+        if (found != m_resident.end()) found->second.lastWanted = m_updateNumber;
+    }
+
+    // Unload what the player has left behind; the margin stops edge chunks from bouncing
+    for (auto it = m_resident.begin(); it != m_resident.end();) {
+        if (it->second.lastWanted != m_updateNumber &&
+            ChunkDistance(KeyX(it->first), KeyZ(it->first), position.x, position.z) > m_unloadRadius) {
+            m_stats.residentBytes -= it->second.chunk->bytes;
+            it = m_resident.erase(it);
+            m_stats.evictions++;
+        } else {
+            ++it;
+        }
+    }
+
+    AcceptCompleted();
+
+    // Replace the loader's queue with what is still missing, nearest last
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t inFlight = m_inFlight;
+        for (const Request& queued : m_queue) {
+            if (!IsWanted(queued.key)) m_stats.loadsCancelled++;
+        }
+
+        std::vector<Request>& previous = m_previousQueue;
+        previous.assign(m_queue.begin(), m_queue.end());
+        m_queue.clear();
+        for (auto it = m_wantedOrder.rbegin(); it != m_wantedOrder.rend(); ++it) {
+            if (it->key == inFlight || m_resident.count(it->key) != 0) continue;
+            m_queue.push_back(*it);
+        }
+        for (const Request& request : m_queue) {
+            bool wasQueued = std::any_of(previous.begin(), previous.end(),
+                                         [&](const Request& queued) { return queued.key == request.key; });
+            if (!wasQueued) m_stats.loadsRequested++;
+        }
+        m_stats.queuedLoads = static_cast<uint32_t>(m_queue.size());
+    }
+    if (m_stats.queuedLoads > 0) {
+        m_wake.notify_one();
+    }
+
+    // Anything close enough to be on screen right now must already be here
+    m_stats.missingChunks = 0;
+    const float size = m_header.chunkSize;
+    int32_t centerX = static_cast<int32_t>(std::floor((position.x - m_header.originX) / size));
+    int32_t centerZ = static_cast<int32_t>(std::floor((position.z - m_header.originZ) / size));
+    int32_t reach = static_cast<int32_t>(std::ceil(m_requiredRadius / size));
+    for (int32_t z = centerZ - reach; z <= centerZ + reach; ++z) {
+        for (int32_t x = centerX - reach; x <= centerX + reach; ++x) {
+            if (!m_loaderFile.Contains(x, z) || ChunkDistance(x, z, position.x, position.z) > m_requiredRadius) continue;
+            if (m_resident.count(Key(x, z)) == 0) m_stats.missingChunks++;
+        }
+    }
+    if (m_stats.missingChunks > 0) m_stats.hitchUpdates++;
+
+    m_residentList.clear();
+    for (const auto& resident : m_resident) {
+        m_residentList.push_back(resident.second.chunk.get());
+    }
+    m_stats.residentChunks = static_cast<uint32_t>(m_resident.size());
+    m_stats.peakResidentBytes = std::max(m_stats.peakResidentBytes, m_stats.residentBytes);
+}
+
+void WorldStreamer::AcceptCompleted() {
+    // Swapping keeps both lists' storage, so steady-state updates do not allocate
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_accepted.swap(m_completed);
+    }
+
+    for (std::unique_ptr<WorldChunk>& chunk : m_accepted) {
+        m_stats.loadsCompleted++;
+        uint64_t key = Key(chunk->x, chunk->z);
+        if (!IsWanted(key) || m_resident.count(key) != 0 || !MakeRoom()) {
+            m_stats.loadsDiscarded++;
+            continue;
+        }
+
+        m_stats.residentBytes += chunk->bytes;
+        m_resident[key] = { std::move(chunk), m_updateNumber };
+    }
+    m_accepted.clear();
+}
+
+bool WorldStreamer::IsWanted(uint64_t key) const {
+    return std::binary_search(m_wantedKeys.begin(), m_wantedKeys.end(), key);
+}
+
+bool WorldStreamer::MakeRoom() {
+    if (m_resident.size() < m_maxResidentChunks) return true;
+
+    // Evict the chunk that has gone unwanted the longest
+    auto oldest = m_resident.end();
+    for (auto it = m_resident.begin(); it != m_resident.end(); ++it) {
+        if (it->second.lastWanted == m_updateNumber) continue;
+        if (oldest == m_resident.end() || it->second.lastWanted < oldest->second.lastWanted) {
+            oldest = it;
+        }
+    }
+    if (oldest == m_resident.end()) return false;
+
+    m_stats.residentBytes -= oldest->second.chunk->bytes;
+    m_resident.erase(oldest);
+    m_stats.evictions++;
+    return true;
+}
+
+void WorldStreamer::LoaderMain() {
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+            if (m_quit) return;
+            request = m_queue.back();
+            m_queue.pop_back();
+            m_inFlight = request.key;
+        }
+
+        if (m_readDelayMilliseconds > 0.0f) {
+            std::this_thread::sleep_for(std::chrono::duration<float, std::milli>(m_readDelayMilliseconds));
+        }
+
+        // A chunk that fails to read is kept empty rather than retried every frame
+        std::unique_ptr<WorldChunk> chunk(new WorldChunk());
+        if (!m_loaderFile.ReadChunk(KeyX(request.key), KeyZ(request.key), *chunk)) {
+            chunk->x = KeyX(request.key);
+            chunk->z = KeyZ(request.key);
+            chunk->objects.clear();
+            chunk->bytes = sizeof(WorldChunk);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.push_back(std::move(chunk));
+        m_inFlight = NO_CHUNK;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "MathTypes.h"
+#include "WorldFile.h"
+
+// Keeps the chunks of a WorldFile resident in a ring around the player. A
+// loader thread reads chunks nearest first; chunks ahead of the player along
+// its velocity are requested early. The number of resident chunks never
+// exceeds the budget given to Initialize, whatever the size of the map.
+class WorldStreamer {
+public:
+    struct Stats {
+        uint32_t residentChunks;
+        uint32_t queuedLoads;
+        uint64_t residentBytes;
+        uint64_t peakResidentBytes;
+        uint64_t loadsRequested;
+        uint64_t loadsCompleted;
+        uint64_t loadsCancelled;    // Dequeued before the loader reached them
+        uint64_t loadsDiscarded;    // Finished after they stopped being wanted
+        uint64_t evictions;
+        uint32_t missingChunks;     // Chunks within the required radius not yet resident
+        uint64_t hitchUpdates;      // Updates with at least one missing chunk
+    };
+
+    WorldStreamer();
+    ~WorldStreamer();
+
+    // loadRadius is in world units; the budget must cover the load ring
+    bool Initialize(const char* path, float loadRadius, uint32_t maxResidentChunks);
+    void Shutdown();
+
+    // Call once per frame with the player's position and velocity
+    void Update(const Float3& position, const Float3& velocity);
+
+    // How far ahead, in seconds of movement, chunks are requested
+    void SetPrefetchSeconds(float seconds) { m_prefetchSeconds = seconds; }
+    // Chunks closer than this must be resident or the update counts as a hitch. Set
+    // after Initialize; clamped to the load radius.
+    void SetRequiredRadius(float radius) { m_requiredRadius = radius < m_loadRadius ? radius : m_loadRadius; }
+    // Adds a delay to every chunk read, to measure behaviour on slow storage
+    void SetReadDelay(float milliseconds) { m_readDelayMilliseconds = milliseconds; }
+
+    bool IsInitialized() const { return m_initialized; }
+    float GetChunkSize() const { return m_header.chunkSize; }
+    const WorldFile::Header& GetHeader() const { return m_header; }
+    bool IsResident(int32_t x, int32_t z) const { return m_resident.count(Key(x, z)) != 0; }
+
+    // Chunks usable this frame, refreshed by Update
+    const std::vector<const WorldChunk*>& GetResidentChunks() const { return m_residentList; }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct ResidentChunk {
+        std::unique_ptr<WorldChunk> chunk;
+        uint64_t lastWanted;  // Update number that last wanted this chunk
+    };
+
+    struct Request {
+        uint64_t key;
+        float priority;  // Smaller loads sooner
+    };
+
+    WorldFile::Header m_header;
+    float m_loadRadius;
+    float m_unloadRadius;
+    float m_requiredRadius;
+    float m_prefetchSeconds;
+    uint32_t m_maxResidentChunks;
+    bool m_initialized;
+    uint64_t m_updateNumber;
+
+    std::unordered_map<uint64_t, ResidentChunk> m_resident;
+    std::vector<const WorldChunk*> m_residentList;
+    std::vector<Request> m_wantedOrder;     // Scratch, rebuilt every update
+    std::vector<uint64_t> m_wantedKeys;     // The same chunks sorted by key, for lookups
+    std::vector<Request> m_previousQueue;   // Scratch, kept to reuse its storage
+    std::vector<std::unique_ptr<WorldChunk>> m_accepted;
+    Stats m_stats;
+
+    // Shared with the loader thread
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<Request> m_queue;   // Sorted so the next load is at the back
+    std::vector<std::unique_ptr<WorldChunk>> m_completed;
+    uint64_t m_inFlight;
+    bool m_quit;
+    std::atomic<float> m_readDelayMilliseconds;
+    WorldFile m_loaderFile;
+
+    static uint64_t Key(int32_t x, int32_t z) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+    }
+    static int32_t KeyX(uint64_t key) { return static_cast<int32_t>(key >> 32); }
+    static int32_t KeyZ(uint64_t key) { return static_cast<int32_t>(key & 0xffffffffu); }
+
+    // Distance from a point to the nearest edge of a chunk, 0 inside it
+    float ChunkDistance(int32_t x, int32_t z, float px, float pz) const;
+    void WantChunksAround(float px, float pz, float radius, float penalty);
+    void AcceptCompleted();
+    bool MakeRoom();
+    bool IsWanted(uint64_t key) const;
+    void LoaderMain();
+
+    // Constants
+    static constexpr float UNLOAD_MARGIN = 0.5f;        // Chunk sizes beyond the load radius before unloading
+    static constexpr uint32_t PREFETCH_SAMPLES = 4;     // Points along the velocity vector
+    static constexpr uint64_t NO_CHUNK = ~0ull;
+};
@@ -1,12 +1,44 @@
-#include <GL/glut.h>
+#include <GL/freeglut.h>
+#include <GL/glext.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
-
-// Camera position and orientation
-float cameraX = 0.0f;
-float cameraY = 1.7f;  // Eye level
-float cameraZ = 5.0f;
-float cameraAngleX = 0.0f;
-float cameraAngleY = 0.0f;
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AllocationTracker.h"
+#include "AnimationSystem.h"
+#include "AudioMixer.h"
+#include "AudioSink.h"
+#include "ClusteredLighting.h"
+#include "CommandStream.h"
+#include "DynamicResolution.h"
+#include "InterestManager.h"
+#include "GLScene.h"
+#include "GLVertexLayout.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "MeshSimplifier.h"
+#include "MetricsRegistry.h"
+#include "OcclusionCuller.h"
+#include "ParticleSystem.h"
+#include "PhysicsWorld.h"
+#include "RenderCapture.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "Simulation.h"
+#include "SoundSynth.h"
+#include "StartupGraph.h"
+#include "VertexFormats.h"
+#include "WorldFile.h"
+#include "WorldStreamer.h"
 
 // Movement speed and mouse sensitivity
 const float moveSpeed = 0.1f;
@@ -20,93 +52,2296 @@ bool firstMouse = true;
 // Keyboard state
 bool keys[256] = {false};
 
-void init() {
-    glEnable(GL_DEPTH_TEST);
+// Frames captured with --capture <file> [frames], written once the last one is recorded
+const char* renderCapturePath = nullptr;
+uint32_t renderCaptureFrames = RenderCapture::DEFAULT_MAX_FRAMES;
+
+// Camera velocity, so the world streamed with --world is prefetched ahead of it
+Float3 cameraVelocity = { 0.0f, 0.0f, 0.0f };
+
+// With --startup-timeline the stage timeline is printed, then time to the first presented frame
+bool printStartupTimeline = false;
+std::chrono::steady_clock::time_point startupStart;
+
+// Dynamic resolution with --dynamic-resolution: the scene renders into the lower-left corner
+// of the back buffer, is copied to a texture and stretched over the window under the crosshair
+DynamicResolution dynamicResolution;
+bool dynamicResolutionEnabled = false;
+GLuint sceneTexture = 0;
+int windowWidth = 800;
+int windowHeight = 600;
+int sceneWidth = 800;
+int sceneHeight = 600;
+const char* RESOLUTION_TRACE_PATH = "resolution_trace.csv";
+const uint32_t RESOLUTION_TRACE_FRAMES = 60 * 60;
+
+// GL_TIME_ELAPSED queries around the scene, read back a few frames later
+const int SCENE_TIMER_FRAMES = 4;
+GLuint sceneTimers[SCENE_TIMER_FRAMES] = {};
+bool sceneTimerPending[SCENE_TIMER_FRAMES] = {};
+uint32_t sceneTimerFrame = 0;
+PFNGLGENQUERIESPROC glGenQueriesProc = nullptr;
+PFNGLBEGINQUERYPROC glBeginQueryProc = nullptr;
+PFNGLENDQUERYPROC glEndQueryProc = nullptr;
+PFNGLGETQUERYOBJECTIVPROC glGetQueryObjectivProc = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64vProc = nullptr;
+
+// Shots spawn a muzzle flash, sparks where the ray meets the ground and smoke
+ParticleSystem particles;
+std::vector<ParticleInstance> particleInstances;
+std::vector<ParticleVertexLayout::Vertex> particleVertices;  // Four corners per quad
+const float SHOT_RANGE = 50.0f;
+uint32_t shotCount = 0;
+
+// Gunfire and footsteps. There is no device sink here, so the mixer paces itself
+// against a null sink, or writes the session to a WAV file with --audio-capture.
+// The sinks are declared first so they outlive the mixer thread at exit.
+NullAudioSink nullAudioSink;
+std::unique_ptr<WavAudioSink> audioCapture;
+AudioMixer audio;
+uint32_t gunshotSound = AudioMixer::INVALID_SOUND;
+uint32_t impactSound = AudioMixer::INVALID_SOUND;
+const uint32_t FOOTSTEP_VARIATIONS = 4;
+uint32_t footstepSounds[FOOTSTEP_VARIATIONS];
+uint32_t footstepCount = 0;
+float strideDistance = 0.0f;
+const float STRIDE_LENGTH = 0.8f;  // Metres walked per footstep
+
+// Frame and update times, shots and awake crates; exported with --metrics <path>
+MetricsRegistry metrics;
+uint32_t frameMetric = MetricsRegistry::INVALID_METRIC;
+uint32_t updateMetric = MetricsRegistry::INVALID_METRIC;
+uint32_t shotMetric = MetricsRegistry::INVALID_METRIC;
+uint32_t awakeCratesMetric = MetricsRegistry::INVALID_METRIC;
+uint32_t sceneRecomputedMetric = MetricsRegistry::INVALID_METRIC;
+uint32_t sceneSkippedMetric = MetricsRegistry::INVALID_METRIC;
+
+// Replays captures into GL: queue commands go to the scene backend, batches are
+// drawn as that many placeholder quads or lines, which is what they cost to submit
+class GLReplayTarget : public CaptureTarget {
+public:
+    void BeginRange() override { sceneBackend.BeginRange(); }
+    void EndRange() override { sceneBackend.EndRange(); }
+    void SetShader(uint32_t shader) override { sceneBackend.SetShader(shader); }
+    void SetMaterial(uint32_t material) override { sceneBackend.SetMaterial(material); }
+    void SetMesh(uint32_t mesh) override { sceneBackend.SetMesh(mesh); }
+    void Draw(const DrawItem& item) override { sceneBackend.Draw(item); }
+
+    void BeginFrame() override {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glLoadIdentity();
+        glTranslatef(0.0f, -1.7f, -5.0f);
+        sceneBackend.BeginFrame();
+    }
+
+    // Waits for the frame, so a slow rasterizer cannot queue work past the measurement
+    void EndFrame() override {
+        sceneBackend.EndFrame();
+        glFinish();
+    }
+
+    void DrawBatch(BatchKind kind, uint32_t, uint32_t count) override {
+        if (kind == BATCH_LINES) {
+            glBegin(GL_LINES);
+            for (uint32_t i = 0; i < count * 2; ++i) glVertex2f(0.0f, 0.0f);
+            glEnd();
+            return;
+        }
+        uint32_t quads = kind == BATCH_FULLSCREEN ? 1 : count;
+        m_vertices.assign(static_cast<size_t>(quads) * 4 * 3, 0.0f);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, m_vertices.data());
+        glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(quads * 4));
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+private:
+    std::vector<float> m_vertices;
+};
+
+// Headless measurement of draw recording on 1..N threads
+int runRecordBenchmark(size_t objectCount) {
+    const int FRAMES = 20;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    printf("Recording %zu objects, %d frames per thread count\n", objectCount, FRAMES);
+    printf("threads  build ms  sort ms  record ms  total ms  speedup\n");
+
+    double baseline = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+        if (!jobSystem.Initialize(threads - 1)) return 1;
+
+        double buildTotal = 0.0, sortTotal = 0.0, recordTotal = 0.0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            auto start = std::chrono::steady_clock::now();
+
+            // Per-object draw data is built in parallel into disjoint queue slots
+            renderQueue.Resize(objectCount);
+            jobSystem.ParallelFor(objectCount, 4096, [&](size_t begin, size_t end, uint32_t) {
+                for (size_t i = begin; i < end; ++i) {
+                    uint32_t mesh = static_cast<uint32_t>(i % 7 == 0 ? MESH_FLOOR : MESH_CUBE);
+                    uint32_t material = static_cast<uint32_t>(i % 13 == 0 ? MATERIAL_TRANSLUCENT : MATERIAL_OPAQUE);
+                    float x = static_cast<float>(i % 317) - 158.0f;
+                    float z = -static_cast<float>((i / 317) % 317);
+                    DrawItem item = { Float4x4::Translation(x, 0.5f, z), 0, material, mesh, 0, 0 };
+                    uint32_t pass = material == MATERIAL_TRANSLUCENT ? RenderQueue::PASS_TRANSLUCENT : RenderQueue::PASS_OPAQUE;
+                    renderQueue.Set(i, RenderQueue::MakeKey(pass, 0, material, mesh, -z / 317.0f), item);
+                }
+            });
+            auto built = std::chrono::steady_clock::now();
+
+            renderQueue.Sort();
+            auto sorted = std::chrono::steady_clock::now();
+
+            recordStreams(threads);
+            auto recorded = std::chrono::steady_clock::now();
+
+            buildTotal += std::chrono::duration<double, std::milli>(built - start).count();
+            sortTotal += std::chrono::duration<double, std::milli>(sorted - built).count();
+            recordTotal += std::chrono::duration<double, std::milli>(recorded - sorted).count();
+        }
+
+        double build = buildTotal / FRAMES, sort = sortTotal / FRAMES, record = recordTotal / FRAMES;
+        double total = build + sort + record;
+        if (threads == 1) baseline = total;
+        printf("%7u  %8.3f  %7.3f  %9.3f  %8.3f  %6.2fx\n", threads, build, sort, record, total, baseline / total);
+    }
+
+    jobSystem.Shutdown();
+    return 0;
+}
+
+// A pile of crates that shots knock over; the scene's cubes are static bodies in the same world
+const float SHOT_IMPULSE = 15.0f;
+
+bool initPhysics() {
+    if (!crates.Initialize(64)) return false;
+    for (const SceneObject& object : sceneObjects) {
+        if (object.mesh != MESH_CUBE) continue;
+        PhysicsWorld::BoxDesc desc = {};
+        desc.position = { (object.boundsMin.x + object.boundsMax.x) * 0.5f, (object.boundsMin.y + object.boundsMax.y) * 0.5f,
+                          (object.boundsMin.z + object.boundsMax.z) * 0.5f };
+        desc.orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        desc.halfExtents = { (object.boundsMax.x - object.boundsMin.x) * 0.5f, (object.boundsMax.y - object.boundsMin.y) * 0.5f,
+                             (object.boundsMax.z - object.boundsMin.z) * 0.5f };
+        crates.AddBox(desc);
+    }
+    firstCrate = crates.GetBodyCount();
+    for (uint32_t i = 0; i < 27; ++i) {
+        PhysicsWorld::BoxDesc desc = {};
+        desc.position = { (i % 3 - 1.0f) * 0.52f, CRATE_HALF_SIZE + (i / 9) * 0.52f, -5.0f + (i / 3 % 3 - 1.0f) * 0.52f };
+        desc.orientation = { 0.0f, 0.0f, 0.0f, 1.0f };
+        desc.halfExtents = { CRATE_HALF_SIZE, CRATE_HALF_SIZE, CRATE_HALF_SIZE };
+        desc.mass = 5.0f;
+        crates.AddBox(desc);
+    }
+    return true;
+}
+
+// Things that move together: the weapon hangs off the camera, a crate rides the platform
+uint32_t cameraNode = SceneGraph::INVALID_NODE;
+uint32_t platformNode = SceneGraph::INVALID_NODE;
+float platformSeconds = 0.0f;
+const float PLATFORM_TRAVEL = 3.0f;     // Metres either side of the middle
+const float PLATFORM_PERIOD = 6.0f;     // Seconds per round trip
+
+// Inverse of the view in buildViewProjection: the rotations transposed, in reverse order
+Float4x4 cameraWorld() {
+    float pitch = cameraAngleX * 3.14159f / 180.0f;
+    float yaw = cameraAngleY * 3.14159f / 180.0f;
+    Float4x4 rotateX = Float4x4::Identity();
+    rotateX.m[1][1] = cosf(pitch);
+    rotateX.m[1][2] = -sinf(pitch);
+    rotateX.m[2][1] = sinf(pitch);
+    rotateX.m[2][2] = cosf(pitch);
+    Float4x4 rotateY = Float4x4::Identity();
+    rotateY.m[0][0] = cosf(yaw);
+    rotateY.m[0][2] = sinf(yaw);
+    rotateY.m[2][0] = -sinf(yaw);
+    rotateY.m[2][2] = cosf(yaw);
+    return Multiply(Multiply(rotateX, rotateY), Float4x4::Translation(cameraX, cameraY, cameraZ));
+}
+
+bool initSceneGraph() {
+    // The platform's mesh is a child so its scale does not stretch the crate riding on it
+    cameraNode = sceneGraph.AddNode(SceneGraph::INVALID_NODE, cameraWorld());
+    sceneGraph.AddNode(cameraNode, Multiply(Float4x4::Scale(0.08f, 0.08f, 0.5f), Float4x4::Translation(0.25f, -0.2f, -0.6f)),
+                       MESH_CUBE);
+    platformNode = sceneGraph.AddNode(SceneGraph::INVALID_NODE, Float4x4::Translation(0.0f, 0.1f, -8.0f));
+    sceneGraph.AddNode(platformNode, Float4x4::Scale(2.0f, 0.2f, 2.0f), MESH_CUBE);
+    sceneGraph.AddNode(platformNode, Multiply(Float4x4::Scale(0.5f, 0.5f, 0.5f), Float4x4::Translation(0.4f, 0.35f, 0.0f)),
+                       MESH_CUBE);
+    sceneGraph.Update();
+    return true;
+}
+
+void updateSceneGraph(float deltaSeconds) {
+    sceneGraph.SetLocal(cameraNode, cameraWorld());
+    platformSeconds = fmodf(platformSeconds + deltaSeconds, PLATFORM_PERIOD);
+    float phase = platformSeconds / PLATFORM_PERIOD * 6.2831853f;
+    sceneGraph.SetLocal(platformNode, Float4x4::Translation(sinf(phase) * PLATFORM_TRAVEL, 0.1f, -8.0f));
+
+    sceneGraph.Update();
+    metrics.SetGauge(sceneRecomputedMetric, sceneGraph.GetStats().recomputed);
+    metrics.SetGauge(sceneSkippedMetric, sceneGraph.GetStats().skipped);
+}
+
+// One quad draw per particle type, facing the camera; instances are expanded to
+// corners here because the fixed-function path has no instancing
+void drawParticles() {
+    GLfloat modelview[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    const Float3 right = { modelview[0], modelview[4], modelview[8] };
+    const Float3 up = { modelview[1], modelview[5], modelview[9] };
+    static const float CORNERS[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+    for (uint32_t type = 0; type < PARTICLE_TYPE_COUNT; ++type) {
+        ParticleType particleType = static_cast<ParticleType>(type);
+        uint32_t count = particles.GetCount(particleType);
+        if (count == 0) continue;
+        particleInstances.resize(count);
+        count = particles.WriteInstances(particleType, particleInstances.data(), count, &jobSystem);
+        renderCapture.DrawBatch(CaptureTarget::BATCH_PARTICLES, type, count);
+
+        particleVertices.resize(static_cast<size_t>(count) * 4);
+        ParticleVertexLayout::Vertex* vertex = particleVertices.data();
+        for (uint32_t i = 0; i < count; ++i) {
+            const ParticleInstance& instance = particleInstances[i];
+            // The color is quantized once and shared by the four corners
+            ParticleVertexLayout::Vertex corner;
+            corner.Set<VertexSemantic::Color>(instance.color);
+            for (const float* offset : CORNERS) {
+                float x = offset[0] * instance.size, y = offset[1] * instance.size;
+                corner.Set<VertexSemantic::Position>({ instance.position.x + right.x * x + up.x * y,
+                                                       instance.position.y + right.y * x + up.y * y,
+                                                       instance.position.z + right.z * x + up.z * y });
+                *vertex++ = corner;
+            }
+        }
+
+        glBlendFunc(GL_SRC_ALPHA, particles.GetTypeSettings(particleType).additive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+        BindFixedFunctionArrays<ParticleVertexLayout>(particleVertices.data());
+        glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(count * 4));
+    }
+    UnbindFixedFunctionArrays<ParticleVertexLayout>();
     glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
 }
 
-void drawCube(float x, float y, float z) {
-    glPushMatrix();
-    glTranslatef(x, y, z);
-    glBegin(GL_QUADS);
-    
-    // Front face (red)
-    glColor3f(1.0f, 0.0f, 0.0f);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-
-    // Back face (green)
-    glColor3f(0.0f, 1.0f, 0.0f);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-
-    // Top face (blue)
-    glColor3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-
-    // Bottom face (yellow)
-    glColor3f(1.0f, 1.0f, 0.0f);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-
-    // Right face (magenta)
-    glColor3f(1.0f, 0.0f, 1.0f);
-    glVertex3f(0.5f, -0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, -0.5f);
-    glVertex3f(0.5f, 0.5f, 0.5f);
-    glVertex3f(0.5f, -0.5f, 0.5f);
-
-    // Left face (cyan)
-    glColor3f(0.0f, 1.0f, 1.0f);
-    glVertex3f(-0.5f, -0.5f, -0.5f);
-    glVertex3f(-0.5f, -0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, 0.5f);
-    glVertex3f(-0.5f, 0.5f, -0.5f);
+// Headless measurement of occlusion culling in a dense grid of rooms
+int runOcclusionBenchmark() {
+    const int ROOMS = 24;
+    const float ROOM_SIZE = 4.0f;
+    const float WALL_HEIGHT = 3.0f;
+    const float WALL_HALF_THICKNESS = 0.1f;
+    const float DOOR_HALF_WIDTH = 0.5f;
+    const int PROPS_PER_ROOM = 24;
+    const size_t MAX_OCCLUDERS = 96;
+    const int FRAMES = 20;
 
-    glEnd();
-    glPopMatrix();
+    // Walls on every grid line with a doorway in the middle of each room side
+    std::vector<SceneObject> walls;
+    for (int line = 0; line <= ROOMS; ++line) {
+        float offset = line * ROOM_SIZE;
+        for (int cell = 0; cell < ROOMS; ++cell) {
+            float start = cell * ROOM_SIZE;
+            float doorway = start + ROOM_SIZE * 0.5f;
+            walls.push_back({ MESH_CUBE, { start, 0.0f, offset - WALL_HALF_THICKNESS },
+                              { doorway - DOOR_HALF_WIDTH, WALL_HEIGHT, offset + WALL_HALF_THICKNESS }, true });
+            walls.push_back({ MESH_CUBE, { doorway + DOOR_HALF_WIDTH, 0.0f, offset - WALL_HALF_THICKNESS },
+                              { start + ROOM_SIZE, WALL_HEIGHT, offset + WALL_HALF_THICKNESS }, true });
+            walls.push_back({ MESH_CUBE, { offset - WALL_HALF_THICKNESS, 0.0f, start },
+                              { offset + WALL_HALF_THICKNESS, WALL_HEIGHT, doorway - DOOR_HALF_WIDTH }, true });
+            walls.push_back({ MESH_CUBE, { offset - WALL_HALF_THICKNESS, 0.0f, doorway + DOOR_HALF_WIDTH },
+                              { offset + WALL_HALF_THICKNESS, WALL_HEIGHT, start + ROOM_SIZE }, true });
+        }
+    }
+
+    // Small props scattered through every room with a fixed seed
+    std::vector<SceneObject> props;
+    uint32_t seed = 12345;
+    auto random01 = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+    };
+    for (int roomZ = 0; roomZ < ROOMS; ++roomZ) {
+        for (int roomX = 0; roomX < ROOMS; ++roomX) {
+            for (int i = 0; i < PROPS_PER_ROOM; ++i) {
+                float x = roomX * ROOM_SIZE + 0.4f + random01() * (ROOM_SIZE - 0.8f);
+                float z = roomZ * ROOM_SIZE + 0.4f + random01() * (ROOM_SIZE - 0.8f);
+                float size = 0.1f + random01() * 0.3f;
+                props.push_back({ MESH_CUBE, { x - size, 0.0f, z - size }, { x + size, size * 2.0f, z + size }, false });
+            }
+        }
+    }
+
+    // Camera stands in a room looking along or across the doorway axes
+    struct Viewpoint {
+        float x, z, angleY;
+    };
+    const Viewpoint viewpoints[] = {
+        { 2.0f, 2.0f, 135.0f }, { 30.0f, 30.0f, 0.0f }, { 50.0f, 10.0f, 90.0f },
+        { 10.0f, 60.0f, 180.0f }, { 70.0f, 70.0f, 270.0f }, { 46.0f, 46.0f, 45.0f }
+    };
+    const int VIEWPOINT_COUNT = sizeof(viewpoints) / sizeof(viewpoints[0]);
+
+    OcclusionCuller culler;
+    culler.Initialize();
+    CommandStream stream;
+
+    printf("%zu walls, %zu props, %d viewpoints, %ux%u depth buffer\n",
+           walls.size(), props.size(), VIEWPOINT_COUNT, culler.GetWidth(), culler.GetHeight());
+
+    std::vector<const SceneObject*> nearest;
+    std::vector<const SceneObject*> inFrustum;
+    std::vector<const SceneObject*> visible;
+
+    // Submission cost of a list of props: queue, sort and record
+    auto submit = [&](const std::vector<const SceneObject*>& objects) {
+        auto start = std::chrono::steady_clock::now();
+        renderQueue.Clear();
+        for (const SceneObject* object : objects) {
+            DrawItem item = { Float4x4::Translation(object->boundsMin.x, object->boundsMin.y, object->boundsMin.z),
+                              0, MATERIAL_OPAQUE, object->mesh, 0, 0 };
+            renderQueue.Submit(RenderQueue::MakeKey(RenderQueue::PASS_OPAQUE, 0, MATERIAL_OPAQUE, object->mesh, 0.5f), item);
+        }
+        renderQueue.Sort();
+        stream.Reset();
+        renderQueue.Execute(stream);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    for (int pass = 0; pass < 2; ++pass) {
+        bool simd = pass == 0;
+        culler.SetSimdEnabled(simd);
+        if (simd && !culler.IsSimdEnabled()) continue;
+
+        double rasterMs = 0.0, testMs = 0.0, culledSubmitMs = 0.0, frustumSubmitMs = 0.0;
+        uint64_t frustumVisible = 0, occlusionVisible = 0;
+
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            for (const Viewpoint& viewpoint : viewpoints) {
+                Float4x4 viewProjection = buildViewProjection(viewpoint.x, 1.7f, viewpoint.z, 0.0f, viewpoint.angleY, 16.0f / 9.0f);
+
+                // Frustum-only reference: an empty depth buffer only rejects off-screen boxes
+                culler.BeginFrame(viewProjection);
+                culler.EndOccluders();
+                inFrustum.clear();
+                for (const SceneObject& prop : props) {
+                    if (culler.IsVisible(prop.boundsMin, prop.boundsMax)) inFrustum.push_back(&prop);
+                }
+
+                auto start = std::chrono::steady_clock::now();
+
+                // The closest walls make the best occluders
+                auto distance = [&](const SceneObject* object) {
+                    float dx = (object->boundsMin.x + object->boundsMax.x) * 0.5f - viewpoint.x;
+                    float dz = (object->boundsMin.z + object->boundsMax.z) * 0.5f - viewpoint.z;
+                    return dx * dx + dz * dz;
+                };
+                nearest.clear();
+                for (const SceneObject& wall : walls) nearest.push_back(&wall);
+                size_t occluderCount = std::min(MAX_OCCLUDERS, nearest.size());
+                std::partial_sort(nearest.begin(), nearest.begin() + occluderCount, nearest.end(),
+                                  [&](const SceneObject* a, const SceneObject* b) { return distance(a) < distance(b); });
+
+                culler.BeginFrame(viewProjection);
+                for (size_t i = 0; i < occluderCount; ++i) {
+                    culler.RasterizeBox(nearest[i]->boundsMin, nearest[i]->boundsMax, Float4x4::Identity());
+                }
+                culler.EndOccluders();
+                auto rasterized = std::chrono::steady_clock::now();
+
+                visible.clear();
+                for (const SceneObject* prop : inFrustum) {
+                    if (culler.IsVisible(prop->boundsMin, prop->boundsMax)) visible.push_back(prop);
+                }
+                auto tested = std::chrono::steady_clock::now();
+
+                frustumSubmitMs += submit(inFrustum);
+                culledSubmitMs += submit(visible);
+                rasterMs += std::chrono::duration<double, std::milli>(rasterized - start).count();
+                testMs += std::chrono::duration<double, std::milli>(tested - rasterized).count();
+                frustumVisible += inFrustum.size();
+                occlusionVisible += visible.size();
+            }
+        }
+
+        double views = static_cast<double>(FRAMES) * VIEWPOINT_COUNT;
+        printf("\n%s path, averages per view:\n", simd ? "AVX2" : "Scalar");
+        printf("  occluder raster  %8.3f ms\n", rasterMs / views);
+        printf("  bounds tests     %8.3f ms\n", testMs / views);
+        printf("  draws in frustum %8.1f\n", frustumVisible / views);
+        printf("  draws after cull %8.1f  (%.1f%% saved)\n", occlusionVisible / views,
+               frustumVisible ? 100.0 * (frustumVisible - occlusionVisible) / frustumVisible : 0.0);
+        printf("  submit frustum   %8.3f ms\n", frustumSubmitMs / views);
+        printf("  submit culled    %8.3f ms\n", culledSubmitMs / views);
+        // Recording here is a vector push; a real driver pays microseconds per draw
+        uint64_t saved = frustumVisible - occlusionVisible;
+        printf("  cull cost/saved  %8.3f us per draw removed\n",
+               saved ? 1000.0 * (rasterMs + testMs) / saved : 0.0);
+    }
+
+    return 0;
 }
 
-void drawScene() {
-    // Draw floor
-    glBegin(GL_QUADS);
-    glColor3f(0.5f, 0.5f, 0.5f);
-    for(int x = -10; x < 10; x++) {
-        for(int z = -10; z < 10; z++) {
-            glVertex3f(x, 0, z);
-            glVertex3f(x + 1, 0, z);
-            glVertex3f(x + 1, 0, z + 1);
-            glVertex3f(x, 0, z + 1);
+// Headless measurement of LOD selection over a large outdoor scene
+int runLodBenchmark() {
+    const int CHUNKS = 4;              // Terrain is CHUNKS x CHUNKS meshes
+    const int CHUNK_QUADS = 64;
+    const float QUAD_SIZE = 4.0f;      // 1 km of terrain
+    const int ROCK_COUNT = 4000;
+    const float VIEWPORT_HEIGHT = 1080.0f;
+    const float VERTICAL_FOV = 3.14159f / 4.0f;  // Matches Camera
+    const int WALK_FRAMES = 600;
+
+    auto terrainHeight = [](float x, float z) {
+        return 18.0f * sinf(x * 0.011f) * cosf(z * 0.013f) + 6.0f * sinf(x * 0.047f + z * 0.031f) +
+               1.5f * sinf(x * 0.21f) * sinf(z * 0.17f);
+    };
+
+    struct LodObject {
+        const MeshLodChain* chain;
+        Float3 boundsMin;
+        Float3 boundsMax;
+        float scale;  // Uniform instance scale applied to the chain's errors
+    };
+    std::vector<LodObject> objects;
+
+    auto buildStart = std::chrono::steady_clock::now();
+
+    // Terrain chunks in world space, each simplified on its own
+    std::vector<std::vector<Float3>> chunkPositions(CHUNKS * CHUNKS);
+    std::vector<MeshLodChain> chunkChains(CHUNKS * CHUNKS);
+    for (int chunk = 0; chunk < CHUNKS * CHUNKS; ++chunk) {
+        float originX = (chunk % CHUNKS) * CHUNK_QUADS * QUAD_SIZE;
+        float originZ = (chunk / CHUNKS) * CHUNK_QUADS * QUAD_SIZE;
+        std::vector<Float3>& positions = chunkPositions[chunk];
+        std::vector<uint32_t> indices;
+        Float3 boundsMin = { originX, 1e30f, originZ };
+        Float3 boundsMax = { originX + CHUNK_QUADS * QUAD_SIZE, -1e30f, originZ + CHUNK_QUADS * QUAD_SIZE };
+        for (int z = 0; z <= CHUNK_QUADS; ++z) {
+            for (int x = 0; x <= CHUNK_QUADS; ++x) {
+                float px = originX + x * QUAD_SIZE;
+                float pz = originZ + z * QUAD_SIZE;
+                float py = terrainHeight(px, pz);
+                positions.push_back({ px, py, pz });
+                boundsMin.y = std::min(boundsMin.y, py);
+                boundsMax.y = std::max(boundsMax.y, py);
+            }
+        }
+        for (int z = 0; z < CHUNK_QUADS; ++z) {
+            for (int x = 0; x < CHUNK_QUADS; ++x) {
+                uint32_t corner = z * (CHUNK_QUADS + 1) + x;
+                uint32_t next = corner + CHUNK_QUADS + 1;
+                indices.insert(indices.end(), { corner, corner + 1, next + 1, corner, next + 1, next });
+            }
+        }
+        chunkChains[chunk] = MeshSimplifier::BuildLodChain(positions.data(), static_cast<uint32_t>(positions.size()),
+                                                           indices.data(), static_cast<uint32_t>(indices.size()));
+        objects.push_back({ &chunkChains[chunk], boundsMin, boundsMax, 1.0f });
+    }
+
+    // A lumpy unit rock: a subdivided octahedron pushed in and out along its normals
+    std::vector<Float3> rockPositions;
+    std::vector<uint32_t> rockIndices;
+    {
+        const int SUBDIVISIONS = 16;
+        const Float3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        const int faces[8][3] = { { 0, 2, 4 }, { 4, 2, 1 }, { 1, 2, 5 }, { 5, 2, 0 },
+                                  { 0, 4, 3 }, { 4, 1, 3 }, { 1, 5, 3 }, { 5, 0, 3 } };
+        for (const auto& face : faces) {
+            const Float3& a = axes[face[0]];
+            const Float3& b = axes[face[1]];
+            const Float3& c = axes[face[2]];
+            uint32_t base = static_cast<uint32_t>(rockPositions.size());
+            for (int row = 0; row <= SUBDIVISIONS; ++row) {
+                for (int column = 0; column <= SUBDIVISIONS - row; ++column) {
+                    float u = static_cast<float>(column) / SUBDIVISIONS;
+                    float v = static_cast<float>(row) / SUBDIVISIONS;
+                    float w = 1.0f - u - v;
+                    Float3 p = { a.x * w + b.x * u + c.x * v, a.y * w + b.y * u + c.y * v, a.z * w + b.z * u + c.z * v };
+                    float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+                    float radius = 1.0f + 0.15f * sinf(p.x * 5.0f) * cosf(p.y * 4.0f + p.z * 3.0f);
+                    rockPositions.push_back({ p.x / length * radius, p.y / length * radius, p.z / length * radius });
+                }
+            }
+            // Faces keep their own edge vertices, like an artist mesh split at UV seams
+            auto vertex = [&](int row, int column) {
+                return base + row * (SUBDIVISIONS + 1) - row * (row - 1) / 2 + column;
+            };
+            for (int row = 0; row < SUBDIVISIONS; ++row) {
+                for (int column = 0; column < SUBDIVISIONS - row; ++column) {
+                    rockIndices.insert(rockIndices.end(), { vertex(row, column), vertex(row + 1, column), vertex(row, column + 1) });
+                    if (column + 1 < SUBDIVISIONS - row) {
+                        rockIndices.insert(rockIndices.end(), { vertex(row, column + 1), vertex(row + 1, column),
+                                                                vertex(row + 1, column + 1) });
+                    }
+                }
+            }
+        }
+    }
+    MeshLodChain rockChain = MeshSimplifier::BuildLodChain(rockPositions.data(), static_cast<uint32_t>(rockPositions.size()),
+                                                           rockIndices.data(), static_cast<uint32_t>(rockIndices.size()));
+
+    uint32_t seed = 12345;
+    auto random01 = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+    };
+    const float worldSize = CHUNKS * CHUNK_QUADS * QUAD_SIZE;
+    for (int i = 0; i < ROCK_COUNT; ++i) {
+        float x = random01() * worldSize;
+        float z = random01() * worldSize;
+        float scale = 0.5f + random01() * random01() * 4.0f;
+        float y = terrainHeight(x, z);
+        objects.push_back({ &rockChain, { x - scale, y - scale, z - scale }, { x + scale, y + scale, z + scale }, scale });
+    }
+
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+    auto printChain = [](const char* name, const MeshLodChain& chain) {
+        printf("  %-8s", name);
+        for (const MeshLod& lod : chain.lods) {
+            printf("  %6u tris (%.3f)", lod.indexCount / 3, lod.error);
+        }
+        printf("\n");
+    };
+    printf("%d terrain chunks, %d rocks, LOD chains built in %.1f ms\n", CHUNKS * CHUNKS, ROCK_COUNT, buildMs);
+    printf("LOD chains, triangles (object-space error):\n");
+    printChain("terrain", chunkChains[0]);
+    printChain("rock", rockChain);
+
+    LodSelector selector;
+    selector.SetProjection(VERTICAL_FOV, VIEWPORT_HEIGHT);
+    selector.SetThreshold(LOD_PIXEL_ERROR);
+    std::vector<uint32_t> lods(objects.size(), 0);
+
+    // Selection over the whole scene; errors scale with each instance
+    auto selectAll = [&](const Float3& eye) {
+        for (size_t i = 0; i < objects.size(); ++i) {
+            const LodObject& object = objects[i];
+            float dx = std::max(std::max(object.boundsMin.x - eye.x, eye.x - object.boundsMax.x), 0.0f);
+            float dy = std::max(std::max(object.boundsMin.y - eye.y, eye.y - object.boundsMax.y), 0.0f);
+            float dz = std::max(std::max(object.boundsMin.z - eye.z, eye.z - object.boundsMax.z), 0.0f);
+            float distance = sqrtf(dx * dx + dy * dy + dz * dz) / object.scale;
+            lods[i] = selector.Select(object.chain->lods.data(), static_cast<uint32_t>(object.chain->lods.size()),
+                                      distance, lods[i]);
+        }
+    };
+
+    const Float3 viewpoints[] = {
+        { 512.0f, 0.0f, 512.0f }, { 40.0f, 0.0f, 40.0f }, { 900.0f, 0.0f, 300.0f }, { 256.0f, 0.0f, 800.0f }
+    };
+    printf("\nviewpoint          full tris    LOD tris  reduction  select ms\n");
+    for (const Float3& viewpoint : viewpoints) {
+        Float3 eye = { viewpoint.x, terrainHeight(viewpoint.x, viewpoint.z) + 1.7f, viewpoint.z };
+        std::fill(lods.begin(), lods.end(), 0);
+        selectAll(eye);
+        selector.ResetStats();
+        auto start = std::chrono::steady_clock::now();
+        selectAll(eye);
+        double selectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const LodSelector::Stats& stats = selector.GetStats();
+        printf("(%4.0f, %4.0f)      %10llu  %10llu  %8.1fx  %9.3f\n", viewpoint.x, viewpoint.z,
+               static_cast<unsigned long long>(stats.trianglesFull), static_cast<unsigned long long>(stats.trianglesSelected),
+               stats.trianglesSelected ? static_cast<double>(stats.trianglesFull) / stats.trianglesSelected : 0.0, selectMs);
+    }
+
+    // Walk with head bob: distances wobble across switch points every few frames
+    printf("\nLOD switches over a %d frame walk:\n", WALK_FRAMES);
+    const float hysteresisValues[] = { 0.0f, LodSelector::DEFAULT_HYSTERESIS };
+    for (float hysteresis : hysteresisValues) {
+        selector.SetThreshold(LOD_PIXEL_ERROR, hysteresis);
+        std::fill(lods.begin(), lods.end(), 0);
+        uint64_t switches = 0, triangles = 0;
+        for (int frame = 0; frame < WALK_FRAMES; ++frame) {
+            float x = 100.0f + frame * 0.1f + 0.3f * sinf(frame * 1.3f);
+            float z = 100.0f + frame * 0.05f;
+            Float3 eye = { x, terrainHeight(x, z) + 1.7f + 0.1f * sinf(frame * 0.7f), z };
+            selector.ResetStats();
+            selectAll(eye);
+            if (frame > 0) switches += selector.GetStats().switches;
+            triangles += selector.GetStats().trianglesSelected;
+        }
+        printf("  hysteresis %.2f  %8llu switches  %10.0f tris per frame\n", hysteresis,
+               static_cast<unsigned long long>(switches), static_cast<double>(triangles) / WALK_FRAMES);
+    }
+
+    return 0;
+}
+
+// Headless flythrough of a streamed map, with and without prefetching
+int runStreamBenchmark(float seconds, float readDelayMilliseconds) {
+    const char* WORLD_PATH = "stream_benchmark.world";
+    const float WORLD_SIZE = 4096.0f;
+    const float SPEED = 60.0f;          // Metres per second, a fast vehicle
+    const float TURN_INTERVAL = 3.0f;   // Seconds between heading changes
+    const float FRAME_SECONDS = 1.0f / 60.0f;
+
+    if (!generateWorld(WORLD_PATH, WORLD_SIZE)) {
+        printf("Failed to write %s\n", WORLD_PATH);
+        return 1;
+    }
+
+    int frames = static_cast<int>(seconds / FRAME_SECONDS);
+    printf("%.0f m map, %d frames at 60 Hz, %.0f m/s, %.1f ms per chunk read\n",
+           WORLD_SIZE, frames, SPEED, readDelayMilliseconds);
+    printf("prefetch  hitches  missing  loads  cancelled  discarded  evictions  peak chunks  peak KB  file KB  update ms (max)\n");
+
+    const float prefetchValues[] = { 0.0f, 2.0f };
+    for (float prefetch : prefetchValues) {
+        WorldStreamer streamer;
+        if (!streamer.Initialize(WORLD_PATH, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS)) {
+            printf("Failed to open %s\n", WORLD_PATH);
+            return 1;
+        }
+        streamer.SetPrefetchSeconds(prefetch);
+        streamer.SetReadDelay(readDelayMilliseconds);
+        streamer.SetRequiredRadius(farPlane);
+
+        // Let the starting ring load, as a loading screen would
+        Float3 position = { 0.0f, 1.7f, 0.0f };
+        Float3 stopped = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 1000 && (i == 0 || streamer.GetStats().queuedLoads > 0 || streamer.GetStats().missingChunks > 0); ++i) {
+            streamer.Update(position, stopped);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        uint64_t startHitches = streamer.GetStats().hitchUpdates;
+
+        uint32_t seed = 777;
+        float heading = 0.0f;
+        uint32_t peakChunks = 0, peakMissing = 0;
+        double updateTotal = 0.0, updateMax = 0.0;
+        auto frameStart = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            if (frame % static_cast<int>(TURN_INTERVAL / FRAME_SECONDS) == 0) {
+                seed = seed * 1664525u + 1013904223u;
+                heading += (static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) - 0.5f) * 2.0f;
+            }
+            // Stay inside the map by steering back toward the centre near the edge
+            if (fabsf(position.x) > WORLD_SIZE * 0.4f || fabsf(position.z) > WORLD_SIZE * 0.4f) {
+                heading = atan2f(-position.x, -position.z);
+            }
+            Float3 velocity = { sinf(heading) * SPEED, 0.0f, cosf(heading) * SPEED };
+            position.x += velocity.x * FRAME_SECONDS;
+            position.z += velocity.z * FRAME_SECONDS;
+
+            auto start = std::chrono::steady_clock::now();
+            streamer.Update(position, velocity);
+            double updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            updateTotal += updateMs;
+            updateMax = std::max(updateMax, updateMs);
+            peakChunks = std::max(peakChunks, streamer.GetStats().residentChunks);
+            peakMissing = std::max(peakMissing, streamer.GetStats().missingChunks);
+
+            // Real frame pacing so the loader runs against the clock
+            frameStart += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(FRAME_SECONDS));
+            std::this_thread::sleep_until(frameStart);
+        }
+
+        const WorldStreamer::Stats& stats = streamer.GetStats();
+        WorldFile file;
+        file.Open(WORLD_PATH);
+        printf("%6.1f s  %7llu  %7u  %5llu  %9llu  %9llu  %9llu  %11u  %7llu  %7llu  %6.3f (%.3f)\n", prefetch,
+               static_cast<unsigned long long>(stats.hitchUpdates - startHitches), peakMissing,
+               static_cast<unsigned long long>(stats.loadsCompleted), static_cast<unsigned long long>(stats.loadsCancelled),
+               static_cast<unsigned long long>(stats.loadsDiscarded), static_cast<unsigned long long>(stats.evictions),
+               peakChunks, static_cast<unsigned long long>(stats.peakResidentBytes / 1024),
+               static_cast<unsigned long long>(file.GetFileSize() / 1024), updateTotal / frames, updateMax);
+        streamer.Shutdown();
+    }
+
+    std::remove(WORLD_PATH);
+    return 0;
+}
+
+// Headless measurement of clustered light binning and the per-pixel light loop it saves
+int runClusterBenchmark() {
+    const uint32_t lightCounts[] = { 1, 10, 100, 250, 500, 1000, 2000 };
+    const float AREA = 200.0f;          // Lights are scattered over a square this wide around the camera
+    const float VIEW_DISTANCE = 200.0f;
+    const float EYE_HEIGHT = 1.7f;
+    const float ASPECT = 16.0f / 9.0f;
+    const uint32_t SAMPLES_X = 160;
+    const uint32_t SAMPLES_Y = 90;
+    const int ITERATIONS = 200;
+
+    ClusteredLighting clusters;
+    clusters.Initialize();
+    const float tanHalfY = tanf(fieldOfView * 3.14159f / 360.0f);
+    const float tanHalfX = tanHalfY * ASPECT;
+    clusters.SetProjection(fieldOfView * 3.14159f / 180.0f, ASPECT, nearPlane, VIEW_DISTANCE);
+
+    // The GL view looks down -z; the clusters expect +z forward
+    const float headings[] = { 0.0f, 90.0f, 180.0f, 270.0f };
+    std::vector<Float4x4> views;
+    for (float heading : headings) {
+        float yaw = heading * 3.14159f / 180.0f;
+        Float4x4 rotateY = Float4x4::Identity();
+        rotateY.m[0][0] = cosf(yaw);
+        rotateY.m[0][2] = -sinf(yaw);
+        rotateY.m[2][0] = sinf(yaw);
+        rotateY.m[2][2] = cosf(yaw);
+        views.push_back(Multiply(Multiply(Float4x4::Translation(0.0f, -EYE_HEIGHT, 0.0f), rotateY),
+                                 Float4x4::Scale(1.0f, 1.0f, -1.0f)));
+    }
+
+    printf("%ux%ux%u clusters, %.0f m square of lights, %ux%u ground samples, %u worker threads\n",
+           clusters.GetTilesX(), clusters.GetTilesY(), clusters.GetSliceCount(), AREA,
+           SAMPLES_X, SAMPLES_Y, jobSystem.GetThreadCount());
+    printf("lights  visible  indices  max/cluster  scalar us  avx2 us  avx2+jobs us  lights/pixel  in range/pixel  naive/pixel\n");
+
+    std::vector<PointLight> lights;
+    for (uint32_t lightCount : lightCounts) {
+        uint32_t seed = 4242;
+        auto random01 = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        };
+        lights.resize(lightCount);
+        for (PointLight& light : lights) {
+            light.position = { (random01() - 0.5f) * AREA, 0.5f + random01() * 3.5f, (random01() - 0.5f) * AREA };
+            light.radius = 2.0f + random01() * 8.0f;
+            light.color = { 1.0f, 0.8f, 0.5f };
+            light.intensity = 1.0f;
+        }
+
+        // Build time per path, averaged over all headings
+        double times[3] = {};
+        for (int path = 0; path < 3; ++path) {
+            clusters.SetSimdEnabled(path > 0);
+            if (path > 0 && !clusters.IsSimdEnabled()) {
+                times[path] = -1.0;
+                continue;
+            }
+            JobSystem* jobs = path == 2 ? &jobSystem : nullptr;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                clusters.Build(lights.data(), lightCount, views[i % views.size()], jobs);
+            }
+            times[path] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+        }
+
+        // Lights a pixel shader would loop over, sampled on the ground plane
+        uint64_t evaluated = 0, inRange = 0, pixels = 0;
+        uint32_t visible = 0, indices = 0, maxPerCluster = 0;
+        for (const Float4x4& view : views) {
+            clusters.Build(lights.data(), lightCount, view, &jobSystem);
+            const ClusteredLighting::Stats& stats = clusters.GetStats();
+            visible += stats.visibleLights;
+            indices += stats.indices;
+            maxPerCluster = std::max(maxPerCluster, stats.maxLightsPerCluster);
+
+            const std::vector<ClusteredLighting::Cluster>& clusterList = clusters.GetClusters();
+            const std::vector<ClusteredLighting::GpuLight>& gpuLights = clusters.GetGpuLights();
+            for (uint32_t sy = 0; sy < SAMPLES_Y; ++sy) {
+                for (uint32_t sx = 0; sx < SAMPLES_X; ++sx) {
+                    float u = (sx + 0.5f) / SAMPLES_X;
+                    float v = (sy + 0.5f) / SAMPLES_Y;
+                    float dirX = (2.0f * u - 1.0f) * tanHalfX;
+                    float dirY = (1.0f - 2.0f * v) * tanHalfY;
+                    if (dirY >= 0.0f) continue;
+                    float t = EYE_HEIGHT / -dirY;
+                    Float3 point = { dirX * t, -EYE_HEIGHT, t };
+                    if (point.z > VIEW_DISTANCE) continue;
+
+                    uint32_t tileX = std::min(static_cast<uint32_t>(u * clusters.GetTilesX()), clusters.GetTilesX() - 1);
+                    uint32_t tileY = std::min(static_cast<uint32_t>(v * clusters.GetTilesY()), clusters.GetTilesY() - 1);
+                    const ClusteredLighting::Cluster& cluster =
+                        clusterList[clusters.GetClusterIndex(tileX, tileY, clusters.GetSlice(point.z))];
+                    evaluated += cluster.count;
+                    for (const ClusteredLighting::GpuLight& light : gpuLights) {
+                        float dx = light.positionRadius.x - point.x;
+                        float dy = light.positionRadius.y - point.y;
+                        float dz = light.positionRadius.z - point.z;
+                        if (dx * dx + dy * dy + dz * dz < light.positionRadius.w * light.positionRadius.w) inRange++;
+                    }
+                    pixels++;
+                }
+            }
+        }
+
+        const double viewCount = static_cast<double>(views.size());
+        printf("%6u  %7.1f  %7.0f  %11u  %9.1f  %7.1f  %12.1f  %12.2f  %14.2f  %11u\n", lightCount,
+               visible / viewCount, indices / viewCount, maxPerCluster, times[0], times[1], times[2],
+               static_cast<double>(evaluated) / pixels, static_cast<double>(inRange) / pixels, lightCount);
+    }
+    return 0;
+}
+
+// Headless run of the resolution controller against a simulated GPU whose cost
+// follows pixel count: a quiet stretch, a heavy fight with explosion spikes, then quiet again
+int runDynamicResolutionBenchmark(const char* tracePath) {
+    const int FRAMES = 2400;
+    const float TARGET_MS = 14.0f;
+    const float FIXED_MS = 1.5f;        // Cost that does not scale with resolution (UI, upscale, present)
+    const float QUIET_MS = 9.0f;        // Scene cost at full resolution
+    const float FIGHT_MS = 24.0f;
+    const int FIGHT_START = 600;
+    const int FIGHT_END = 1600;
+    const int RAMP_FRAMES = 60;
+    const int LATENCY = 2;              // GPU timings arrive this many frames late
+
+    auto sceneCost = [&](int frame) {
+        float fight = 0.0f;
+        if (frame >= FIGHT_START && frame < FIGHT_END) {
+            fight = std::min(1.0f, std::min(static_cast<float>(frame - FIGHT_START), static_cast<float>(FIGHT_END - frame)) / RAMP_FRAMES);
+        }
+        float cost = QUIET_MS + (FIGHT_MS - QUIET_MS) * fight;
+        // Explosions: a few frames of heavy overdraw every second or so during the fight
+        if (fight > 0.5f && frame % 70 < 4) cost += 10.0f;
+        return cost;
+    };
+
+    struct Mode {
+        const char* name;
+        bool adaptive;
+        float proportional, integral, derivative;
+    };
+    const Mode modes[] = {
+        { "fixed", false, 0.0f, 0.0f, 0.0f },
+        { "I only", true, 0.0f, DynamicResolution::DEFAULT_INTEGRAL, 0.0f },
+        { "PID", true, DynamicResolution::DEFAULT_PROPORTIONAL, DynamicResolution::DEFAULT_INTEGRAL,
+          DynamicResolution::DEFAULT_DERIVATIVE }
+    };
+
+    printf("%d frames, %.1f ms target, fight from frame %d to %d, timings %d frames late\n",
+           FRAMES, TARGET_MS, FIGHT_START, FIGHT_END, LATENCY);
+    printf("mode     over target  fight over  p99 ms  max ms  avg scale  min scale  changes\n");
+
+    for (const Mode& mode : modes) {
+        DynamicResolution controller;
+        controller.Initialize(TARGET_MS);
+        controller.SetGains(mode.proportional, mode.integral, mode.derivative);
+        controller.SetTraceCapacity(FRAMES);
+
+        uint32_t seed = 99;
+        std::vector<float> scales(FRAMES + LATENCY, 1.0f);
+        std::vector<float> frameTimes;
+        int fightOver = 0;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = 1.0f + (static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) - 0.5f) * 0.1f;
+            float scale = scales[frame];
+            float frameMs = FIXED_MS + sceneCost(frame) * scale * scale * noise;
+            frameTimes.push_back(frameMs);
+            if (frame >= FIGHT_START && frame < FIGHT_END && frameMs > TARGET_MS) fightOver++;
+
+            // The measured frame decides the scale of a frame that has not been recorded yet
+            scales[frame + LATENCY] = mode.adaptive ? controller.Update(frameMs) : 1.0f;
+            if (!mode.adaptive) controller.Update(frameMs);
+        }
+
+        std::vector<float> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        float averageScale = 0.0f, minScale = 1.0f;
+        for (int frame = 0; frame < FRAMES; ++frame) {
+            averageScale += scales[frame] / FRAMES;
+            minScale = std::min(minScale, scales[frame]);
+        }
+        const DynamicResolution::Stats& stats = controller.GetStats();
+        printf("%-7s  %11u  %10d  %6.2f  %6.2f  %9.3f  %9.3f  %7u\n", mode.name, stats.framesOverTarget, fightOver,
+               sorted[FRAMES * 99 / 100], sorted.back(), averageScale, minScale, mode.adaptive ? stats.scaleChanges : 0);
+
+        if (tracePath && mode.adaptive && mode.derivative > 0.0f) {
+            if (controller.WriteTrace(tracePath)) {
+                printf("Wrote %s\n", tracePath);
+            } else {
+                printf("Failed to write %s\n", tracePath);
+            }
+        }
+    }
+    return 0;
+}
+
+// Startup work that needs no window, run in order and then as a startup graph
+int runStartupBenchmark() {
+    const char* WORLD_PATH = "startup_benchmark.world";
+    const int TERRAIN_CHUNKS = 8;
+    const int CHUNK_QUADS = 48;
+
+    JobSystem jobs;
+    OcclusionCuller culler;
+    ClusteredLighting lighting;
+    WorldStreamer streamer;
+    LodMesh floor;
+    std::vector<LodMesh> terrain(TERRAIN_CHUNKS);
+    const char* worldPath = WORLD_PATH;
+
+    auto buildTerrainChunk = [&](int chunk) {
+        LodMesh& mesh = terrain[chunk];
+        mesh = LodMesh();
+        std::vector<uint32_t> indices;
+        for (int z = 0; z <= CHUNK_QUADS; ++z) {
+            for (int x = 0; x <= CHUNK_QUADS; ++x) {
+                float px = static_cast<float>(chunk * CHUNK_QUADS + x) * 4.0f;
+                float pz = static_cast<float>(z) * 4.0f;
+                mesh.positions.push_back({ px, 18.0f * sinf(px * 0.011f) * cosf(pz * 0.013f) + 1.5f * sinf(px * 0.21f), pz });
+            }
+        }
+        for (int z = 0; z < CHUNK_QUADS; ++z) {
+            for (int x = 0; x < CHUNK_QUADS; ++x) {
+                uint32_t corner = z * (CHUNK_QUADS + 1) + x;
+                uint32_t next = corner + CHUNK_QUADS + 1;
+                indices.insert(indices.end(), { corner, corner + 1, next + 1, corner, next + 1, next });
+            }
+        }
+        mesh.chain = MeshSimplifier::BuildLodChain(mesh.positions.data(), static_cast<uint32_t>(mesh.positions.size()),
+                                                   indices.data(), static_cast<uint32_t>(indices.size()));
+        return true;
+    };
+
+    // Same work and dependencies as the real startup, minus the window
+    auto buildGraph = [&](StartupGraph& graph) {
+        std::vector<StartupGraph::StageId> parts;
+        parts.push_back(graph.AddStage("jobs", [&] { return jobs.Initialize(); }));
+        parts.push_back(graph.AddStage("occlusion", [&] { return culler.Initialize(); }));
+        parts.push_back(graph.AddStage("lighting", [&] { return lighting.Initialize(); }));
+        parts.push_back(graph.AddStage("floorMesh", [&] { buildFloorMesh(floor); return true; }));
+        for (int chunk = 0; chunk < TERRAIN_CHUNKS; ++chunk) {
+            static const char* const NAMES[] = { "terrain0", "terrain1", "terrain2", "terrain3",
+                                                 "terrain4", "terrain5", "terrain6", "terrain7" };
+            parts.push_back(graph.AddStage(NAMES[chunk], [&, chunk] { return buildTerrainChunk(chunk); }));
+        }
+        StartupGraph::StageId generate = graph.AddStage("world.generate", [&] {
+            if (!generateWorld(worldPath, 2048.0f)) throw std::runtime_error(std::string("could not write ") + worldPath);
+            return true;
+        });
+        parts.push_back(graph.AddStage("world.stream", [&] {
+            return streamer.Initialize(worldPath, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS);
+        }, { generate }));
+        graph.AddStage("scene", nullptr, parts);
+    };
+
+    // Sequential baseline, the way startup ran before: each step after the last
+    auto start = std::chrono::steady_clock::now();
+    jobs.Initialize();
+    culler.Initialize();
+    lighting.Initialize();
+    buildFloorMesh(floor);
+    for (int chunk = 0; chunk < TERRAIN_CHUNKS; ++chunk) {
+        buildTerrainChunk(chunk);
+    }
+    generateWorld(worldPath, 2048.0f);
+    streamer.Initialize(worldPath, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS);
+    double sequentialMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    streamer.Shutdown();
+    jobs.Shutdown();
+    floor = LodMesh();
+
+    StartupGraph graph;
+    buildGraph(graph);
+    bool succeeded = graph.Run();
+    printf("%u hardware threads\n\n%s\n", std::max(1u, std::thread::hardware_concurrency()), graph.FormatTimeline().c_str());
+    printf("sequential %.2f ms, graph %.2f ms (%.2fx)\n", sequentialMilliseconds, graph.GetTotalMilliseconds(),
+           sequentialMilliseconds / std::max(graph.GetTotalMilliseconds(), 0.001));
+    streamer.Shutdown();
+    jobs.Shutdown();
+    remove(WORLD_PATH);
+    if (!succeeded) {
+        printf("%s", graph.GetError().c_str());
+        return 1;
+    }
+
+    // A failing stage reports its cause and skips only what depends on it
+    worldPath = "missing-directory/startup_benchmark.world";
+    StartupGraph failing;
+    buildGraph(failing);
+    bool failed = !failing.Run();
+    printf("\nwith an unwritable world path:\n%s", failing.GetError().c_str());
+    streamer.Shutdown();
+    jobs.Shutdown();
+
+    // A dependency on a stage added later is reported, and nothing runs
+    StartupGraph malformed;
+    bool ran = false;
+    malformed.AddStage("early", [&] { ran = true; return true; }, { 1 });
+    malformed.AddStage("late", nullptr);
+    bool rejected = !malformed.Run() && !ran;
+    printf("\nwith a dependency on a later stage:\n%s", malformed.GetError().c_str());
+    return failed && rejected ? 0 : 1;
+}
+
+// Headless particle update and instance writing: scalar against AVX2, then AVX2 on 1..N threads.
+// Dead smoke particles are replaced every frame so the population stays near count.
+int runParticleBenchmark(uint32_t count) {
+    const int WARMUP_FRAMES = 180;
+    const int FRAMES = 120;
+    const float DELTA_SECONDS = 1.0f / 60.0f;
+    const uint32_t BURST_SIZE = 1000;
+
+    auto makeSystem = [&](ParticleSystem& system, bool simd) {
+        system.Initialize((count + BURST_SIZE - 1) / BURST_SIZE + 64);
+        system.SetSimdEnabled(simd);
+        ParticleSystem::TypeSettings smoke = system.GetTypeSettings(PARTICLE_SMOKE);
+        smoke.minLifetime = 1.0f;
+        smoke.maxLifetime = 3.0f;
+        smoke.maxParticles = count;
+        system.SetTypeSettings(PARTICLE_SMOKE, smoke);
+    };
+    auto replenish = [&](ParticleSystem& system, uint32_t& seed) {
+        uint32_t missing = count - system.GetCount(PARTICLE_SMOKE);
+        for (uint32_t emitted = 0; emitted < missing; emitted += BURST_SIZE) {
+            float x = static_cast<float>(seed % 64) - 32.0f;
+            system.Emit({ PARTICLE_SMOKE, (std::min)(BURST_SIZE, missing - emitted), { x, 1.0f, -10.0f },
+                          { 0.0f, 1.0f, 0.0f }, 1.5f, 0.8f, seed++ });
+        }
+    };
+
+    std::vector<ParticleInstance> instances(count);
+    auto measure = [&](bool simd, JobSystem* jobs, double& updateMilliseconds, double& writeMilliseconds) {
+        ParticleSystem system;
+        makeSystem(system, simd);
+        uint32_t seed = 1;
+        updateMilliseconds = writeMilliseconds = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; ++frame) {
+            replenish(system, seed);
+            system.Update(DELTA_SECONDS, jobs);
+            auto start = std::chrono::steady_clock::now();
+            system.WriteInstances(PARTICLE_SMOKE, instances.data(), count, jobs);
+            if (frame < WARMUP_FRAMES) continue;
+            updateMilliseconds += system.GetStats().updateMilliseconds;
+            writeMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        updateMilliseconds /= FRAMES;
+        writeMilliseconds /= FRAMES;
+    };
+
+    printf("%u particles, %d frames after %d warm-up frames%s\n", count, FRAMES, WARMUP_FRAMES,
+           ParticleSystem::IsSimdSupported() ? "" : " (AVX2 unavailable, both rows are scalar)");
+    printf("path    threads  update ms  instances ms  total ms  speedup\n");
+    double update = 0.0, write = 0.0;
+    measure(false, nullptr, update, write);
+    double baseline = update + write;
+    printf("scalar  %7u  %9.3f  %12.3f  %8.3f  %6.2fx\n", 1u, update, write, baseline, 1.0);
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+        if (!jobSystem.Initialize(threads - 1)) return 1;
+        measure(true, &jobSystem, update, write);
+        printf("avx2    %7u  %9.3f  %12.3f  %8.3f  %6.2fx\n", threads, update, write, update + write,
+               baseline / (update + write));
+    }
+
+    // Both paths must produce the same particles, serially and split into blocks across
+    // workers (forced here so the block path runs even on one core)
+    if (!jobSystem.Initialize(3)) return 1;
+    ParticleSystem scalar, simd;
+    makeSystem(scalar, false);
+    makeSystem(simd, true);
+    uint32_t scalarSeed = 1, simdSeed = 1;
+    for (int frame = 0; frame < 60; ++frame) {
+        replenish(scalar, scalarSeed);
+        replenish(simd, simdSeed);
+        scalar.Update(DELTA_SECONDS);
+        simd.Update(DELTA_SECONDS, &jobSystem);
+    }
+    std::vector<ParticleInstance> simdInstances(count);
+    uint32_t scalarCount = scalar.WriteInstances(PARTICLE_SMOKE, instances.data(), count);
+    uint32_t simdCount = simd.WriteInstances(PARTICLE_SMOKE, simdInstances.data(), count, &jobSystem);
+    bool identical = scalarCount == simdCount &&
+                     memcmp(instances.data(), simdInstances.data(), scalarCount * sizeof(ParticleInstance)) == 0;
+    printf("scalar and avx2 instances: %s (%u particles)\n", identical ? "identical" : "DIFFERENT", scalarCount);
+    jobSystem.Shutdown();
+
+    // Bursts from several threads while the owner keeps updating; producers retry when the
+    // queue is full, and every particle must come out exactly once
+    const uint32_t PRODUCERS = 4;
+    const uint32_t BURSTS_PER_PRODUCER = 5000;
+    const uint32_t PARTICLES_PER_BURST = 3;
+    ParticleSystem shared;
+    shared.Initialize(256);
+    std::atomic<uint32_t> finished(0);
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < PRODUCERS; ++producer) {
+        producers.emplace_back([&, producer] {
+            for (uint32_t burst = 0; burst < BURSTS_PER_PRODUCER; ++burst) {
+                ParticleType type = static_cast<ParticleType>(burst % PARTICLE_TYPE_COUNT);
+                while (!shared.Emit({ type, PARTICLES_PER_BURST, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 1.0f, 0.5f,
+                                      producer * 7919u + burst })) {
+                    std::this_thread::yield();
+                }
+            }
+            finished.fetch_add(1);
+        });
+    }
+    uint64_t spawned = 0;
+    bool draining = true;
+    while (draining) {
+        draining = finished.load() < PRODUCERS;
+        shared.Update(DELTA_SECONDS);
+        spawned += shared.GetStats().spawned;
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    const uint64_t expected = uint64_t(PRODUCERS) * BURSTS_PER_PRODUCER * PARTICLES_PER_BURST;
+    bool delivered = spawned == expected;
+    printf("%u producers: %llu of %llu particles spawned, %u full-queue retries: %s\n", PRODUCERS,
+           static_cast<unsigned long long>(spawned), static_cast<unsigned long long>(expected),
+           shared.GetStats().dropped / PARTICLES_PER_BURST, delivered ? "none lost" : "LOST PARTICLES");
+    return identical && delivered ? 0 : 1;
+}
+
+int runAnimationBenchmark(uint32_t characterCount) {
+    const int WARMUP_FRAMES = 30;
+    const int FRAMES = 120;
+    const float DELTA_SECONDS = 1.0f / 60.0f;
+    const float FRAMES_PER_SECOND = 30.0f;
+    const uint32_t CLIP_FRAMES = 61;  // Two seconds, the last frame repeating the first
+    const uint32_t MESH_VERTICES = 2000;
+    const float PI = 3.14159265f;
+
+    // A 64-joint humanoid: spine, head with face joints that never move, arms with
+    // three-segment fingers, and legs
+    std::vector<int32_t> parents;
+    std::vector<JointTransform> bindPose;
+    std::vector<float> amplitudes;  // Swing of each joint in radians
+    auto addJoint = [&](int32_t parent, Float3 offset, float amplitude) {
+        parents.push_back(parent);
+        bindPose.push_back({ { 0.0f, 0.0f, 0.0f, 1.0f }, offset, 1.0f });
+        amplitudes.push_back(amplitude);
+        return static_cast<int32_t>(parents.size()) - 1;
+    };
+    int32_t pelvis = addJoint(-1, { 0.0f, 1.0f, 0.0f }, 0.1f);
+    int32_t spine = pelvis;
+    for (int segment = 0; segment < 4; ++segment) {
+        spine = addJoint(spine, { 0.0f, 0.12f, 0.0f }, 0.08f);
+    }
+    int32_t head = addJoint(addJoint(spine, { 0.0f, 0.1f, 0.0f }, 0.1f), { 0.0f, 0.12f, 0.0f }, 0.15f);
+    for (int face = 0; face < 11; ++face) {
+        addJoint(head, { 0.01f * (face - 5), 0.05f, 0.08f }, 0.0f);
+    }
+    for (float side : { -1.0f, 1.0f }) {
+        int32_t shoulder = addJoint(spine, { side * 0.18f, 0.0f, 0.0f }, 0.1f);
+        int32_t upperArm = addJoint(shoulder, { side * 0.12f, 0.0f, 0.0f }, 0.6f);
+        int32_t hand = addJoint(addJoint(upperArm, { side * 0.28f, 0.0f, 0.0f }, 0.5f), { side * 0.25f, 0.0f, 0.0f }, 0.3f);
+        for (int finger = 0; finger < 5; ++finger) {
+            int32_t joint = hand;
+            for (int segment = 0; segment < 3; ++segment) {
+                joint = addJoint(joint, { side * 0.03f, 0.0f, 0.02f * (finger - 2) }, 0.2f);
+            }
+        }
+    }
+    for (float side : { -1.0f, 1.0f }) {
+        int32_t thigh = addJoint(pelvis, { side * 0.1f, -0.05f, 0.0f }, 0.7f);
+        int32_t foot = addJoint(addJoint(thigh, { 0.0f, -0.45f, 0.0f }, 0.6f), { 0.0f, -0.45f, 0.0f }, 0.3f);
+        addJoint(foot, { 0.0f, -0.05f, 0.12f }, 0.2f);
+    }
+    const uint32_t jointCount = static_cast<uint32_t>(parents.size());
+    Skeleton skeleton;
+    if (!skeleton.Initialize(parents.data(), bindPose.data(), jointCount)) return 1;
+
+    // Looping gaits: every joint swings about its own axis, and the pelvis bobs twice per cycle
+    auto makeFrames = [&](float cyclesPerSecond, float stride, float bounce) {
+        std::vector<JointTransform> frames(static_cast<size_t>(CLIP_FRAMES) * jointCount);
+        for (uint32_t frame = 0; frame < CLIP_FRAMES; ++frame) {
+            float phase = 2.0f * PI * cyclesPerSecond * (frame % (CLIP_FRAMES - 1)) / FRAMES_PER_SECOND;
+            for (uint32_t joint = 0; joint < jointCount; ++joint) {
+                Float3 axis = { std::sin(joint * 1.3f), std::cos(joint * 0.7f), 0.5f };
+                float length = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+                float angle = stride * amplitudes[joint] * std::sin(phase + joint * 0.7f);
+                float s = std::sin(angle * 0.5f) / length;
+                JointTransform& transform = frames[static_cast<size_t>(frame) * jointCount + joint];
+                transform = bindPose[joint];
+                transform.rotation = { axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+                if (joint == static_cast<uint32_t>(pelvis)) {
+                    transform.translation.y += bounce * std::sin(2.0f * phase);
+                }
+            }
+        }
+        return frames;
+    };
+    const AnimationClip::CompressionSettings settings = { 0.002f, 0.001f, 0.001f };
+    const char* clipNames[2] = { "walk", "run" };
+    std::vector<JointTransform> clipFrames[2] = { makeFrames(1.0f, 1.0f, 0.03f), makeFrames(1.5f, 1.4f, 0.06f) };
+    AnimationClip clips[2];
+    AnimationSystem animation;
+
+    // Decoded clips against the source frames, locally and at every joint's model-space position
+    printf("%u joints, %u frames per clip at %.0f fps\n", jointCount, CLIP_FRAMES, FRAMES_PER_SECOND);
+    printf("clip  keys   raw KB  compressed KB  ratio  max rotation error  max position error\n");
+    std::vector<Float4x4> sourceModel(jointCount), sampledModel(jointCount), skinning(jointCount);
+    Pose source, sampled;
+    source.Resize(jointCount);
+    for (int clip = 0; clip < 2; ++clip) {
+        if (!clips[clip].Build(skeleton, clipFrames[clip].data(), CLIP_FRAMES, FRAMES_PER_SECOND, settings)) return 1;
+        float rotationError = 0.0f, positionError = 0.0f;
+        for (uint32_t frame = 0; frame < CLIP_FRAMES - 1; ++frame) {
+            animation.SampleClip(clips[clip], frame / FRAMES_PER_SECOND, sampled);
+            for (uint32_t joint = 0; joint < jointCount; ++joint) {
+                const JointTransform& expected = clipFrames[clip][static_cast<size_t>(frame) * jointCount + joint];
+                Float4 q = sampled.GetJoint(joint).rotation;
+                float dot = std::fabs(q.x * expected.rotation.x + q.y * expected.rotation.y +
+                                      q.z * expected.rotation.z + q.w * expected.rotation.w);
+                rotationError = (std::max)(rotationError, 2.0f * std::acos((std::min)(dot, 1.0f)));
+                source.SetJoint(joint, expected);
+            }
+            AnimationSystem::ComputeSkinningMatrices(skeleton, source, sourceModel.data(), skinning.data());
+            AnimationSystem::ComputeSkinningMatrices(skeleton, sampled, sampledModel.data(), skinning.data());
+            for (uint32_t joint = 0; joint < jointCount; ++joint) {
+                float dx = sourceModel[joint].m[3][0] - sampledModel[joint].m[3][0];
+                float dy = sourceModel[joint].m[3][1] - sampledModel[joint].m[3][1];
+                float dz = sourceModel[joint].m[3][2] - sampledModel[joint].m[3][2];
+                positionError = (std::max)(positionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+        }
+        size_t raw = clips[clip].GetUncompressedBytes(), compressed = clips[clip].GetMemoryBytes();
+        printf("%-4s  %5u  %7.1f  %13.1f  %4.1fx  %14.3f deg  %15.2f mm\n", clipNames[clip], clips[clip].GetKeyCount(),
+               raw / 1024.0, compressed / 1024.0, static_cast<double>(raw) / compressed, rotationError * 180.0f / PI,
+               positionError * 1000.0f);
+    }
+
+    // Characters blending walk into run, each at its own phase
+    auto addCharacters = [&](AnimationSystem& system) {
+        for (uint32_t character = 0; character < characterCount; ++character) {
+            float phase = (character % 97) / 97.0f;
+            system.AddCharacter({ &skeleton, { &clips[0], &clips[1] },
+                                  { phase * clips[0].GetDuration(), phase * clips[1].GetDuration() },
+                                  { 1.0f, 1.0f }, (character % 11) / 10.0f });
+        }
+    };
+    auto measure = [&](bool simd, JobSystem* jobs) {
+        AnimationSystem system;
+        system.SetSimdEnabled(simd);
+        addCharacters(system);
+        double milliseconds = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; ++frame) {
+            system.Update(DELTA_SECONDS, jobs);
+            if (frame >= WARMUP_FRAMES) milliseconds += system.GetStats().updateMilliseconds;
+        }
+        return milliseconds / FRAMES;
+    };
+
+    printf("%u characters blending two clips, %d frames after %d warm-up frames%s\n", characterCount, FRAMES,
+           WARMUP_FRAMES, AnimationSystem::IsSimdSupported() ? "" : " (AVX2 unavailable, both rows are scalar)");
+    printf("path    threads  update ms  characters/ms  speedup\n");
+    double baseline = measure(false, nullptr);
+    printf("scalar  %7u  %9.3f  %13.1f  %6.2fx\n", 1u, baseline, characterCount / baseline, 1.0);
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+        if (!jobSystem.Initialize(threads - 1)) return 1;
+        double milliseconds = measure(true, &jobSystem);
+        printf("avx2    %7u  %9.3f  %13.1f  %6.2fx\n", threads, milliseconds, characterCount / milliseconds,
+               baseline / milliseconds);
+    }
+
+    // Both paths must pose every character the same, serially and spread across workers
+    // (forced here so the parallel path runs even on one core)
+    if (!jobSystem.Initialize(3)) return 1;
+    AnimationSystem scalar, simd;
+    scalar.SetSimdEnabled(false);
+    simd.SetSimdEnabled(true);
+    addCharacters(scalar);
+    addCharacters(simd);
+    for (int frame = 0; frame < 45; ++frame) {
+        scalar.Update(DELTA_SECONDS);
+        simd.Update(DELTA_SECONDS, &jobSystem);
+    }
+    jobSystem.Shutdown();
+    bool identical = true;
+    for (uint32_t character = 0; character < characterCount; ++character) {
+        identical = identical && memcmp(scalar.GetSkinningMatrices(character), simd.GetSkinningMatrices(character),
+                                        jointCount * sizeof(Float4x4)) == 0;
+    }
+    printf("scalar and avx2 skinning matrices: %s\n", identical ? "identical" : "DIFFERENT");
+
+    // CPU skinning as a headless process would do it: a hit mesh bound to each joint and its parent
+    AnimationSystem::SkinnedMesh mesh;
+    mesh.Resize(MESH_VERTICES);
+    for (uint32_t joint = 0; joint < jointCount; ++joint) {
+        source.SetJoint(joint, bindPose[joint]);
+    }
+    AnimationSystem::ComputeSkinningMatrices(skeleton, source, sourceModel.data(), skinning.data());
+    for (uint32_t vertex = 0; vertex < MESH_VERTICES; ++vertex) {
+        uint32_t joint = vertex % jointCount;
+        int32_t parent = parents[joint] < 0 ? 0 : parents[joint];
+        float offset = 0.01f * static_cast<float>(vertex % 7) - 0.03f;
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            mesh.positions[axis][vertex] = sourceModel[joint].m[3][axis] + offset;
+        }
+        mesh.joints[0][vertex] = static_cast<int32_t>(joint);
+        mesh.joints[1][vertex] = parent;
+        mesh.weights[0][vertex] = 0.7f;
+        mesh.weights[1][vertex] = 0.3f;
+    }
+    std::vector<float> skinned[2][3];
+    for (int path = 0; path < 2; ++path) {
+        for (std::vector<float>& axis : skinned[path]) {
+            axis.resize(MESH_VERTICES);
         }
     }
+    printf("path    vertices  skin ms  vertices/ms\n");
+    for (int path = 0; path < 2; ++path) {
+        AnimationSystem& system = path == 0 ? scalar : simd;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t character = 0; character < characterCount; ++character) {
+            system.SkinPositions(mesh, system.GetSkinningMatrices(character), skinned[path][0].data(),
+                                 skinned[path][1].data(), skinned[path][2].data());
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        double vertices = static_cast<double>(MESH_VERTICES) * characterCount;
+        printf("%-6s  %8.0f  %7.3f  %11.0f\n", path == 0 ? "scalar" : "avx2", vertices, milliseconds,
+               vertices / milliseconds);
+    }
+    bool skinnedIdentical = true;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        skinnedIdentical = skinnedIdentical &&
+                           memcmp(skinned[0][axis].data(), skinned[1][axis].data(), MESH_VERTICES * sizeof(float)) == 0;
+    }
+    printf("scalar and avx2 skinned positions: %s\n", skinnedIdentical ? "identical" : "DIFFERENT");
+
+    // Hit capsules along each limb bone, placed for every character
+    std::vector<AnimationSystem::Hitbox> hitboxes;
+    for (uint32_t joint = 1; joint < jointCount; ++joint) {
+        if (amplitudes[joint] >= 0.3f) {
+            const Float4x4& start = sourceModel[parents[joint]];
+            const Float4x4& end = sourceModel[joint];
+            hitboxes.push_back({ joint, { start.m[3][0], start.m[3][1], start.m[3][2] },
+                                 { end.m[3][0], end.m[3][1], end.m[3][2] }, 0.06f });
+        }
+    }
+    std::vector<AnimationSystem::Capsule> capsules(hitboxes.size());
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t character = 0; character < characterCount; ++character) {
+        AnimationSystem::PlaceHitboxes(hitboxes.data(), static_cast<uint32_t>(hitboxes.size()),
+                                       simd.GetSkinningMatrices(character), capsules.data());
+    }
+    printf("%zu hitboxes per character placed in %.3f ms\n", hitboxes.size(),
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return identical && skinnedIdentical ? 0 : 1;
+}
+
+int runAudioBenchmark(uint32_t voiceCount, const char* capturePath) {
+    const float PI = 3.14159265f;
+    const uint32_t SECONDS = 10;
+    const uint32_t BLOCKS = SECONDS * AudioMixer::SAMPLE_RATE / AudioMixer::BLOCK_FRAMES;
+    const double BLOCK_MILLISECONDS = 1000.0 * AudioMixer::BLOCK_FRAMES / AudioMixer::SAMPLE_RATE;
+
+    std::vector<float> sounds[3] = { SynthesizeGunshot(AudioMixer::SAMPLE_RATE), SynthesizeImpact(AudioMixer::SAMPLE_RATE),
+                                     SynthesizeFootstep(AudioMixer::SAMPLE_RATE, 1) };
+    auto makeMixer = [&](AudioMixer& mixer, bool simd) {
+        mixer.Initialize(voiceCount);
+        mixer.SetSimdEnabled(simd);
+        for (const std::vector<float>& sound : sounds) {
+            mixer.AddSound(sound.data(), static_cast<uint32_t>(sound.size()));
+        }
+    };
+
+    // A firefight around a turning listener: each block tops the voices back up with
+    // sounds at pseudo-random spots within 60 m, so every voice is busy throughout
+    std::vector<float> block(AudioMixer::BLOCK_FRAMES * 2);
+    auto render = [&](bool simd, std::vector<float>* output, double& averageMilliseconds, double& maxMilliseconds) {
+        AudioMixer mixer;
+        makeMixer(mixer, simd);
+        uint32_t seed = 12345;
+        auto random = [&seed] {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / 16777216.0f;
+        };
+        averageMilliseconds = maxMilliseconds = 0.0;
+        for (uint32_t index = 0; index < BLOCKS; ++index) {
+            float heading = 2.0f * PI * index / BLOCKS;
+            mixer.SetListener({ 0.0f, 1.7f, 0.0f }, { cosf(heading), 0.0f, sinf(heading) });
+            uint32_t missing = voiceCount - mixer.GetStats().activeVoices;
+            for (uint32_t i = 0; i < missing; ++i) {
+                float angle = 2.0f * PI * random(), distance = 60.0f * random();
+                mixer.Play(i % 3, { cosf(angle) * distance, 0.0f, sinf(angle) * distance }, 0.2f,
+                           static_cast<uint8_t>(random() * 255.0f));
+            }
+            auto start = std::chrono::steady_clock::now();
+            mixer.MixBlock(block.data());
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            averageMilliseconds += milliseconds;
+            maxMilliseconds = (std::max)(maxMilliseconds, milliseconds);
+            if (output) output->insert(output->end(), block.begin(), block.end());
+        }
+        averageMilliseconds /= BLOCKS;
+    };
+
+    printf("%u voices, %u s of %u-frame blocks at %u Hz%s\n", voiceCount, SECONDS, AudioMixer::BLOCK_FRAMES,
+           AudioMixer::SAMPLE_RATE, AudioMixer::IsSimdSupported() ? "" : " (AVX2 unavailable, both rows are scalar)");
+    printf("path    mix ms/block  max ms  real-time factor  voice-blocks/ms\n");
+    std::vector<float> outputs[2];
+    for (int path = 0; path < 2; ++path) {
+        double average = 0.0, maximum = 0.0;
+        outputs[path].reserve(static_cast<size_t>(BLOCKS) * block.size());
+        render(path == 1, &outputs[path], average, maximum);
+        printf("%-6s  %12.4f  %6.3f  %15.1fx  %15.0f\n", path == 0 ? "scalar" : "avx2", average, maximum,
+               BLOCK_MILLISECONDS / average, voiceCount / average);
+    }
+    bool identical = memcmp(outputs[0].data(), outputs[1].data(), outputs[0].size() * sizeof(float)) == 0;
+    printf("scalar and avx2 output: %s\n", identical ? "identical" : "DIFFERENT");
+
+    // Twice as many sounds as voices in one block: the first half fills the voices at
+    // low priority, the second half must take them all over
+    AudioMixer stealing;
+    makeMixer(stealing, true);
+    for (uint32_t i = 0; i < voiceCount * 2; ++i) {
+        stealing.Play(0, { static_cast<float>(i % 40), 0.0f, 5.0f }, 1.0f, i < voiceCount ? 10 : 200);
+    }
+    stealing.MixBlock(block.data());
+    AudioMixer::Stats stats = stealing.GetStats();
+    bool stolen = stats.stolenVoices == voiceCount && stats.droppedSounds == 0;
+    printf("%u sounds for %u voices: %llu stolen, %llu dropped: %s\n", voiceCount * 2, voiceCount,
+           static_cast<unsigned long long>(stats.stolenVoices), static_cast<unsigned long long>(stats.droppedSounds),
+           stolen ? "ok" : "WRONG");
+
+    // On the mixer thread against a real-time null sink, with the game thread sending
+    // a shot and a footstep every 16 ms
+    AudioMixer threaded;
+    makeMixer(threaded, true);
+    NullAudioSink sink(true);
+    uint64_t audioAllocations = AllocationTracker::GetTotals(MemoryTag::Audio).allocations;
+    uint64_t violations = AllocationTracker::GetViolations();
+    if (!threaded.Start(&sink)) return 1;
+    for (int frame = 0; frame < 120; ++frame) {
+        float angle = frame * 0.2f;
+        threaded.SetListener({ 0.0f, 1.7f, 0.0f }, { cosf(angle), 0.0f, sinf(angle) });
+        threaded.PlayLocal(0, 0.5f, 255);
+        threaded.Play(2, { 3.0f, 0.0f, 0.0f }, 0.5f, 64);
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+    threaded.Shutdown();
+    stats = threaded.GetStats();
+    audioAllocations = AllocationTracker::GetTotals(MemoryTag::Audio).allocations - audioAllocations;
+    violations = AllocationTracker::GetViolations() - violations;
+    printf("mixer thread: %llu blocks, %llu frames to the sink, max mix %.1f us, max start latency %.2f ms "
+           "(one block is %.2f ms), %llu commands rejected, %llu allocations\n",
+           static_cast<unsigned long long>(stats.blocks), static_cast<unsigned long long>(sink.GetFramesWritten()),
+           stats.maxMixMicroseconds, stats.maxStartLatencyMicroseconds / 1000.0, BLOCK_MILLISECONDS,
+           static_cast<unsigned long long>(stats.rejectedCommands),
+           static_cast<unsigned long long>(audioAllocations + violations));
+
+    if (capturePath) {
+        WavAudioSink capture(capturePath);
+        if (!capture.Open(AudioMixer::SAMPLE_RATE) ||
+            !capture.Write(outputs[1].data(), static_cast<uint32_t>(outputs[1].size() / 2))) {
+            fprintf(stderr, "Could not write %s\n", capturePath);
+            return 1;
+        }
+        capture.Close();
+        printf("Wrote %s\n", capturePath);
+    }
+    return identical && stolen && audioAllocations + violations == 0 ? 0 : 1;
+}
+
+// Piles of 100 boxes (4 layers of 5 x 5, each box slightly turned and offset) dropped
+// from just above the ground, 8 m apart on a square grid
+void buildBoxPiles(PhysicsWorld& world, uint32_t boxCount) {
+    const uint32_t PILE_SIZE = 100;
+    const float SPACING = 8.0f;
+    uint32_t piles = (boxCount + PILE_SIZE - 1) / PILE_SIZE;
+    uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(piles))));
+    uint32_t seed = 7;
+    auto random = [&seed] {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+    };
+    world.Initialize(boxCount);
+    for (uint32_t box = 0; box < boxCount; ++box) {
+        uint32_t pile = box / PILE_SIZE, slot = box % PILE_SIZE;
+        float pileX = (static_cast<float>(pile % columns) - columns * 0.5f) * SPACING;
+        float pileZ = (static_cast<float>(pile / columns) - columns * 0.5f) * SPACING;
+        float angle = random() * 0.3f;
+        PhysicsWorld::BoxDesc desc = {};
+        desc.position = { pileX + (slot % 5) * 1.1f + random() * 0.2f, 0.6f + (slot / 25) * 1.15f,
+                          pileZ + (slot / 5 % 5) * 1.1f + random() * 0.2f };
+        desc.orientation = { 0.0f, sinf(angle * 0.5f), 0.0f, cosf(angle * 0.5f) };
+        desc.halfExtents = { 0.5f, 0.5f, 0.5f };
+        desc.mass = 1.0f;
+        world.AddBox(desc);
+    }
+}
+
+int runPhysicsBenchmark(uint32_t boxCount) {
+    const float DELTA_SECONDS = 1.0f / 60.0f;
+    const int STEPS = 180;
+    const int SETTLE_STEPS = 1200;
+
+    // The first three seconds, while the piles collapse and settle
+    auto measure = [&](JobSystem* jobs, double& averageMilliseconds, PhysicsWorld::Stats& peak) {
+        PhysicsWorld world;
+        buildBoxPiles(world, boxCount);
+        averageMilliseconds = 0.0;
+        peak = {};
+        for (int step = 0; step < STEPS; ++step) {
+            world.Step(DELTA_SECONDS, jobs);
+            const PhysicsWorld::Stats& stats = world.GetStats();
+            averageMilliseconds += stats.stepMilliseconds;
+            peak.islands = (std::max)(peak.islands, stats.islands);
+            peak.largestIsland = (std::max)(peak.largestIsland, stats.largestIsland);
+            peak.contacts = (std::max)(peak.contacts, stats.contacts);
+        }
+        averageMilliseconds /= STEPS;
+    };
+
+    printf("%u boxes in piles of 100, %d steps of %.1f ms\n", boxCount, STEPS, DELTA_SECONDS * 1000.0f);
+    printf("threads  step ms  steps/s  peak islands  largest  contacts  speedup\n");
+    double baseline = 0.0;
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; ++threads) {
+        double average = 0.0;
+        PhysicsWorld::Stats stats = {};
+        if (threads == 1) {
+            measure(nullptr, average, stats);
+            baseline = average;
+        } else {
+            if (!jobSystem.Initialize(threads - 1)) return 1;
+            measure(&jobSystem, average, stats);
+        }
+        printf("%7u  %7.3f  %7.0f  %12u  %7u  %8u  %6.2fx\n", threads, average, 1000.0 / average, stats.islands,
+               stats.largestIsland, stats.contacts, baseline / average);
+    }
+
+    // Islands are solved in parallel but each one alone, so positions after the same
+    // steps must not depend on the thread count (workers forced so the parallel path runs)
+    if (!jobSystem.Initialize(3)) return 1;
+    PhysicsWorld serial, parallel;
+    buildBoxPiles(serial, boxCount);
+    buildBoxPiles(parallel, boxCount);
+    double settleMilliseconds = 0.0;
+    int settledStep = -1;
+    for (int step = 0; step < SETTLE_STEPS; ++step) {
+        serial.Step(DELTA_SECONDS);
+        parallel.Step(DELTA_SECONDS, &jobSystem);
+        settleMilliseconds += parallel.GetStats().stepMilliseconds;
+        if (settledStep < 0 && parallel.GetStats().awakeBodies == 0) settledStep = step + 1;
+    }
+    bool identical = true;
+    float lowest = 1e30f;
+    for (uint32_t body = 0; body < boxCount && identical; ++body) {
+        Float3 a = serial.GetPosition(body), b = parallel.GetPosition(body);
+        Float4 p = serial.GetOrientation(body), q = parallel.GetOrientation(body);
+        identical = memcmp(&a, &b, sizeof(a)) == 0 && memcmp(&p, &q, sizeof(p)) == 0;
+        lowest = (std::min)(lowest, b.y);
+    }
+    printf("1 and 4 threads after %d steps: %s\n", SETTLE_STEPS, identical ? "identical" : "DIFFERENT");
+
+    // Once the piles have settled every island is asleep and a step only has to notice that
+    PhysicsWorld::Stats settled = parallel.GetStats();
+    bool asleep = settledStep > 0 && settled.sleepingBodies == boxCount;
+    double sleepingMilliseconds = 0.0;
+    for (int step = 0; step < STEPS; ++step) {
+        parallel.Step(DELTA_SECONDS, &jobSystem);
+        sleepingMilliseconds += parallel.GetStats().stepMilliseconds;
+    }
+    sleepingMilliseconds /= STEPS;
+    printf("settled: %u of %u asleep after %d steps (%.0f ms of stepping), lowest box center %.3f m, "
+           "step while asleep %.4f ms\n", settled.sleepingBodies, boxCount, settledStep,
+           settleMilliseconds, lowest, sleepingMilliseconds);
+
+    // A shot into one pile wakes that pile alone
+    uint32_t target = boxCount / 2;
+    Float3 center = parallel.GetPosition(target);
+    parallel.ApplyImpulse(target, { 4.0f, 0.0f, 0.0f }, { center.x, center.y + 0.25f, center.z });
+    parallel.Step(DELTA_SECONDS, &jobSystem);
+    uint32_t woken = parallel.GetStats().awakeBodies;
+    bool local = woken > 0 && woken <= 100;
+    printf("impulse on box %u: %u boxes woke: %s\n", target, woken, local ? "ok" : "WRONG");
+    jobSystem.Shutdown();
+    return identical && asleep && local && lowest > 0.4f ? 0 : 1;
+}
+
+// Cost of recording from hot paths, sharded against one shared atomic as threads are
+// added, histogram percentile accuracy, and a background export to a file
+int runMetricsBenchmark() {
+    const uint64_t OPERATIONS = 20000000;
+    const uint32_t PERCENTILE_SAMPLES = 1000000;
+    MetricsRegistry registry;
+    if (!registry.Initialize()) return 1;
+    uint32_t counter = registry.AddCounter("benchmark_operations_total", "Increments");
+    uint32_t latency = registry.AddHistogram("benchmark_latency", "Recorded values");
+    uint32_t gauge = registry.AddGauge("benchmark_threads", "Threads recording");
+    if (counter == MetricsRegistry::INVALID_METRIC || latency == MetricsRegistry::INVALID_METRIC ||
+        gauge == MetricsRegistry::INVALID_METRIC) {
+        return 1;
+    }
+
+    auto nanosecondsPer = [](uint64_t count, const auto& run) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(count);
+    };
+    printf("single thread, ns per operation\n");
+    printf("  Increment          %6.2f\n", nanosecondsPer(OPERATIONS, [&] {
+        for (uint64_t i = 0; i < OPERATIONS; ++i) registry.Increment(counter);
+    }));
+    printf("  RecordNanoseconds  %6.2f\n", nanosecondsPer(OPERATIONS, [&] {
+        for (uint64_t i = 0; i < OPERATIONS; ++i) registry.RecordNanoseconds(latency, i & 0xFFFFF);
+    }));
+    printf("  MetricsTimerScope  %6.2f  (two clock reads included)\n", nanosecondsPer(OPERATIONS / 10, [&] {
+        for (uint64_t i = 0; i < OPERATIONS / 10; ++i) MetricsTimerScope timer(&registry, latency);
+    }));
+    bool counted = registry.GetCounter(counter) == OPERATIONS;
+
+    // Every thread increments the same counter; the shared atomic's cache line bounces between cores
+    printf("threads  sharded ns/op  shared ns/op\n");
+    unsigned int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        const uint64_t perThread = OPERATIONS / threads;
+        std::atomic<uint64_t> shared(0);
+        uint64_t before = registry.GetCounter(counter);
+        auto runThreads = [&](bool sharded) {
+            return nanosecondsPer(perThread, [&] {
+                std::vector<std::thread> workers;
+                for (unsigned int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&] {
+                        for (uint64_t i = 0; i < perThread; ++i) {
+                            if (sharded) registry.Increment(counter);
+                            else shared.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    });
+                }
+                for (std::thread& worker : workers) worker.join();
+            });
+        };
+        double sharded = runThreads(true);
+        double unsharded = runThreads(false);
+        registry.SetGauge(gauge, threads);
+        counted = counted && registry.GetCounter(counter) - before == perThread * threads;
+        printf("%7u  %13.2f  %12.2f\n", threads, sharded, unsharded);
+    }
+    printf("counter totals: %s\n", counted ? "exact" : "WRONG");
+
+    // Log-uniform values from 100 ns to 100 ms against exact percentiles
+    MetricsRegistry accuracy;
+    accuracy.Initialize();
+    uint32_t values = accuracy.AddHistogram("benchmark_values", "Log-uniform values");
+    std::vector<uint64_t> samples(PERCENTILE_SAMPLES);
+    uint32_t seed = 12345;
+    for (uint64_t& sample : samples) {
+        seed = seed * 1664525u + 1013904223u;
+        sample = static_cast<uint64_t>(100.0 * pow(1e6, (seed >> 8) / 16777216.0));
+        accuracy.RecordNanoseconds(values, sample);
+    }
+    std::sort(samples.begin(), samples.end());
+    MetricsRegistry::HistogramSnapshot snapshot = accuracy.GetHistogram(values);
+    double worstError = 0.0;
+    printf("quantile       exact   histogram   error\n");
+    for (double quantile : { 0.5, 0.9, 0.99, 0.999 }) {
+        uint64_t exact = samples[static_cast<size_t>(quantile * (samples.size() - 1))];
+        uint64_t estimate = MetricsRegistry::GetPercentile(snapshot, quantile);
+        double error = fabs(static_cast<double>(estimate) - static_cast<double>(exact)) / static_cast<double>(exact);
+        worstError = std::max(worstError, error);
+        printf("%8.3f  %10llu  %10llu  %5.2f%%\n", quantile, static_cast<unsigned long long>(exact),
+               static_cast<unsigned long long>(estimate), error * 100.0);
+    }
+    // Buckets are at most 1/8 of their start wide, so a midpoint is within 1/16
+    bool accurate = snapshot.count == PERCENTILE_SAMPLES && worstError <= 1.0 / 16.0;
+
+    // The exporter flushes while a thread keeps recording, then once more on stop
+    const char* EXPORT_PATH = "metrics_benchmark.prom";
+    double formatMicroseconds = nanosecondsPer(100, [&] {
+        for (int i = 0; i < 100; ++i) registry.FormatPrometheus();
+    }) / 1000.0;
+    if (!registry.StartExport(EXPORT_PATH, 20)) return 1;
+    auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < stop) {
+        MetricsTimerScope timer(&registry, latency);
+        registry.Increment(counter);
+    }
+    registry.StopExport();
+    std::string expected = "benchmark_operations_total " + std::to_string(registry.GetCounter(counter)) + "\n";
+    std::string exported;
+    if (FILE* file = fopen(EXPORT_PATH, "rb")) {
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) exported.append(buffer, read);
+        fclose(file);
+    }
+    remove(EXPORT_PATH);
+    bool exportedLatest = exported.find(expected) != std::string::npos &&
+                          exported.find("benchmark_latency_seconds_bucket{le=\"+Inf\"}") != std::string::npos;
+    printf("export: %llu flushes, %llu failed, %.1f us to format, %zu bytes, final snapshot %s\n",
+           static_cast<unsigned long long>(registry.GetExportCount()),
+           static_cast<unsigned long long>(registry.GetExportFailures()), formatMicroseconds, exported.size(),
+           exportedLatest ? "current" : "STALE");
+    bool exportedOften = registry.GetExportCount() >= 5 && registry.GetExportFailures() == 0;
+    return counted && accurate && exportedLatest && exportedOften ? 0 : 1;
+}
+
+// Per command type: how many, and what they cost to submit with the clock overhead taken off
+void printReplayStats(const CaptureReplayer::Stats& untimed, const CaptureReplayer::Stats& timed) {
+    uint32_t frames = std::max(1u, untimed.frames);
+    printf("%u frames: %.3f ms per frame, slowest %.3f ms, %.1f ms in all\n", untimed.frames,
+           untimed.totalMilliseconds / frames, untimed.maxFrameMilliseconds, untimed.totalMilliseconds);
+    double timedTotal = 0.0;
+    for (const CaptureReplayer::CommandStats& command : timed.commands) timedTotal += command.milliseconds;
+    printf("command      per frame  ms per frame  ns each  share\n");
+    for (uint32_t type = 0; type < CaptureReplayer::COMMAND_TYPE_COUNT; ++type) {
+        const CaptureReplayer::CommandStats& command = timed.commands[type];
+        if (command.count == 0) continue;
+        printf("%-11s  %9.1f  %12.4f  %7.1f  %4.1f%%\n", CaptureReplayer::GetCommandName(static_cast<CaptureReplayer::CommandType>(type)),
+               static_cast<double>(command.count) / frames, command.milliseconds / frames,
+               command.milliseconds * 1e6 / static_cast<double>(command.count),
+               timedTotal > 0.0 ? command.milliseconds * 100.0 / timedTotal : 0.0);
+    }
+}
+
+// Replays a --capture file headlessly into a null target, or into GL (use
+// LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe); the best of three untimed runs gives
+// frame times, then one timed run the per-command breakdown
+int runCaptureReplay(const char* path, bool useGL, int argc, char** argv) {
+    const int REPEATS = 3;
+    CaptureReplayer replayer;
+    if (!replayer.Load(path)) {
+        printf("%s is not a valid render capture\n", path);
+        return 1;
+    }
+    printf("%s: %u frames, %zu bytes, replaying into %s\n", path, replayer.GetFrameCount(), replayer.GetByteCount(),
+           useGL ? "GL" : "a null target");
+
+    NullCaptureTarget nullTarget;
+    std::unique_ptr<GLReplayTarget> glTarget;
+    CaptureTarget* target = &nullTarget;
+    if (useGL) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(800, 600);
+        glutCreateWindow("FPS Game replay");
+        init();
+        buildFloorMesh(floorMesh);
+        printf("renderer: %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        glTarget.reset(new GLReplayTarget());
+        target = glTarget.get();
+    }
+
+    CaptureReplayer::Stats best = replayer.Replay(*target, false);
+    for (int repeat = 1; repeat < REPEATS; ++repeat) {
+        CaptureReplayer::Stats stats = replayer.Replay(*target, false);
+        if (stats.totalMilliseconds < best.totalMilliseconds) best = stats;
+    }
+    printReplayStats(best, replayer.Replay(*target, true));
+    return 0;
+}
+
+// Captures synthetic frames, then checks the file round-trips: replaying it into
+// a second capture must give the same bytes. Also compares replay against
+// executing the queue directly, and the capture's size against raw draw items.
+int runCaptureBenchmark(size_t objectCount) {
+    const uint32_t FRAMES = 60;
+    const char* CAPTURE_PATH = "capture_benchmark.rcap";
+    NullCaptureTarget nullTarget;
+    RenderCapture capture;
+    capture.Start(FRAMES);
+    double executeMilliseconds = 0.0;
+    size_t draws = 0;
+    for (uint32_t frame = 0; frame < FRAMES; ++frame) {
+        // The camera slides along x, so every frame's matrices differ
+        float cameraShift = static_cast<float>(frame) * 0.25f;
+        renderQueue.Clear();
+        renderQueue.Reserve(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            uint32_t mesh = static_cast<uint32_t>(i % 7 == 0 ? MESH_FLOOR : MESH_CUBE);
+            uint32_t material = static_cast<uint32_t>(i % 13 == 0 ? MATERIAL_TRANSLUCENT : MATERIAL_OPAQUE);
+            float x = static_cast<float>(i % 317) - 158.0f - cameraShift;
+            float z = -static_cast<float>((i / 317) % 317);
+            DrawItem item = { Float4x4::Translation(x, 0.5f, z), 0, material, mesh, static_cast<uint32_t>(i % 3), 0 };
+            uint32_t pass = material == MATERIAL_TRANSLUCENT ? RenderQueue::PASS_TRANSLUCENT : RenderQueue::PASS_OPAQUE;
+            renderQueue.Submit(RenderQueue::MakeKey(pass, 0, material, mesh, -z / 317.0f), item);
+        }
+        renderQueue.Sort();
+        draws += renderQueue.GetSize();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        renderQueue.Execute(nullTarget);
+        executeMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        capture.BeginFrame();
+        renderQueue.Execute(capture);
+        for (uint32_t type = 0; type < PARTICLE_TYPE_COUNT; ++type) {
+            capture.DrawBatch(CaptureTarget::BATCH_PARTICLES, type, 1000 + frame * 10);
+        }
+        capture.DrawBatch(CaptureTarget::BATCH_UI_QUADS, 0, 240);
+        capture.DrawBatch(CaptureTarget::BATCH_LINES, 0, 2);
+        capture.EndFrame();
+    }
+    bool saved = !capture.IsCapturing() && capture.GetFrameCount() == FRAMES && capture.Save(CAPTURE_PATH);
+    CaptureReplayer replayer;
+    bool loaded = saved && replayer.Load(CAPTURE_PATH);
+    // Also removes whatever a failed Save left behind
+    remove(CAPTURE_PATH);
+    if (!saved) {
+        printf("capture failed\n");
+        return 1;
+    }
+    if (!loaded) {
+        printf("could not load the capture back\n");
+        return 1;
+    }
+    printf("%zu objects, %u frames: %zu bytes, %.1f bytes per draw (a DrawItem is %zu)\n", objectCount, FRAMES,
+           replayer.GetByteCount(), static_cast<double>(replayer.GetByteCount()) / draws, sizeof(DrawItem));
+
+    RenderCapture recapture;
+    recapture.Start(FRAMES);
+    replayer.Replay(recapture, false);
+    bool identical = recapture.GetBytes() == capture.GetBytes();
+    printf("replayed into a new capture: %s\n", identical ? "identical" : "DIFFERENT");
+
+    CaptureReplayer::Stats untimed = replayer.Replay(nullTarget, false);
+    printf("queue executed directly: %.3f ms per frame\n", executeMilliseconds / FRAMES);
+    printReplayStats(untimed, replayer.Replay(nullTarget, true));
+    return identical && untimed.frames == FRAMES ? 0 : 1;
+}
+
+// Headless measurement of lazy scene graph updates: a forest of props, each a
+// root with a few levels of attachments, with a growing share moved per frame.
+// Dirty updates must match full recomputes, and AVX2 the scalar path, exactly.
+int runSceneGraphBenchmark(uint32_t nodeCount) {
+    const uint32_t BRANCHING = 4;
+    const uint32_t DEPTH = 3;           // Levels below each root: 1 + 4 + 16 + 64 nodes per tree
+    const int FRAMES = 100;
+    uint32_t treeSize = 0;
+    for (uint32_t level = 0, width = 1; level <= DEPTH; ++level, width *= BRANCHING) treeSize += width;
+    uint32_t treeCount = std::max(1u, nodeCount / treeSize);
+
+    // Depth first, so every node is appended
+    auto build = [&](SceneGraph& graph) {
+        std::vector<uint32_t> roots;
+        uint32_t seed = 12345u;
+        auto random01 = [&seed]() {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        };
+        std::function<void(uint32_t, uint32_t)> addChildren = [&](uint32_t parent, uint32_t level) {
+            if (level == DEPTH) return;
+            for (uint32_t i = 0; i < BRANCHING; ++i) {
+                uint32_t child = graph.AddNode(parent, Multiply(Float4x4::Scale(0.9f, 0.9f, 0.9f),
+                                                                Float4x4::Translation(random01() - 0.5f, 0.5f, random01() - 0.5f)), MESH_CUBE);
+                addChildren(child, level + 1);
+            }
+        };
+        for (uint32_t tree = 0; tree < treeCount; ++tree) {
+            uint32_t root = graph.AddNode(SceneGraph::INVALID_NODE,
+                                          Float4x4::Translation(random01() * 500.0f, 0.0f, random01() * 500.0f), MESH_CUBE);
+            roots.push_back(root);
+            addChildren(root, 0);
+        }
+        graph.Update();
+        return roots;
+    };
+
+    SceneGraph graphs[2];
+    std::vector<uint32_t> roots = build(graphs[0]);
+    build(graphs[1]);
+    graphs[0].SetSimdEnabled(false);
+    graphs[1].SetSimdEnabled(true);
+    uint32_t count = graphs[0].GetNodeCount();
+    printf("%u nodes in %u trees of %u, AVX2 %s\n", count, treeCount, treeSize,
+           SceneGraph::IsSimdSupported() ? "available" : "unavailable");
+
+    // Moves every stride-th tree; a third of the moves are to a mid-level attachment instead of the root
+    auto move = [&](SceneGraph& graph, int frame, uint32_t stride) {
+        for (uint32_t tree = static_cast<uint32_t>(frame) % stride; tree < treeCount; tree += stride) {
+            uint32_t node = tree % 3 == 0 ? roots[tree] + 1 : roots[tree];
+            Float4x4 local = graph.GetLocal(node);
+            local.m[3][1] = 0.01f * (frame % 50);
+            graph.SetLocal(node, local);
+        }
+    };
+
+    printf(" moved  path    dirty  ranges  recomputed    skipped  update ms  full ms  speedup\n");
+    const uint32_t strides[] = { 1000, 100, 10, 1 };
+    bool identical = true;
+    for (uint32_t stride : strides) {
+        for (int path = 0; path < 2; ++path) {
+            SceneGraph& graph = graphs[path];
+            if (path == 1 && !graph.IsSimdEnabled()) continue;
+            double update = 0.0, full = 0.0;
+            SceneGraph::Stats totals = {};
+            for (int frame = 0; frame < FRAMES; ++frame) {
+                move(graph, frame, stride);
+                graph.Update();
+                const SceneGraph::Stats& stats = graph.GetStats();
+                update += stats.updateMilliseconds;
+                totals.dirtyNodes += stats.dirtyNodes;
+                totals.ranges += stats.ranges;
+                totals.recomputed += stats.recomputed;
+                totals.skipped += stats.skipped;
+
+                // A full recompute must not change a single bit
+                if (frame % 10 == 0) {
+                    std::vector<Float4x4> lazy(graph.GetWorldMatrices(), graph.GetWorldMatrices() + count);
+                    graph.UpdateAll();
+                    full += graph.GetStats().updateMilliseconds * 10.0;
+                    identical = identical && memcmp(lazy.data(), graph.GetWorldMatrices(), count * sizeof(Float4x4)) == 0;
+                }
+            }
+            printf("%5.1f%%  %-6s  %6u  %6u  %10u  %9u  %9.4f  %7.4f  %6.1fx\n", 100.0 / stride, path ? "AVX2" : "scalar",
+                   totals.dirtyNodes / FRAMES, totals.ranges / FRAMES, totals.recomputed / FRAMES, totals.skipped / FRAMES,
+                   update / FRAMES, full / FRAMES, update > 0.0 ? full / update : 0.0);
+        }
+        if (graphs[1].IsSimdEnabled()) {
+            identical = identical && memcmp(graphs[0].GetWorldMatrices(), graphs[1].GetWorldMatrices(), count * sizeof(Float4x4)) == 0;
+        }
+    }
+
+    if (!identical) {
+        printf("FAILED: lazy, full, scalar and AVX2 world matrices differ\n");
+        return 1;
+    }
+    printf("OK: lazy, full, scalar and AVX2 world matrices identical\n");
+    return 0;
+}
+
+// Headless check of server interest management: clients riding on moving
+// players among wandering entities and buildings, timed per tick against
+// testing every entity for every client
+int runInterestBenchmark(uint32_t clientCount, uint32_t entityCount) {
+    const float WORLD_SIZE = 2048.0f;
+    const float VIEW_DISTANCE = 150.0f;
+    const uint32_t SEND_BUDGET = 32;
+    const uint32_t TICKS = 300;
+    const uint32_t RESPAWNS_PER_TICK = 5;
+    const uint32_t MAX_WAIT_TICKS = 2 * Simulation::TICK_RATE;
+    clientCount = std::min(clientCount, entityCount);
+
+    uint32_t seed = 2024u;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+    };
+
+    // Three managers fed the same moves: one thread, all threads, and all threads with buildings hiding cells
+    const char* names[3] = { "hash, 1 thread", "hash, all threads", "hash + visibility" };
+    InterestManager managers[3];
+    for (InterestManager& manager : managers) manager.Initialize(entityCount, clientCount);
+    managers[0].SetVisibilityEnabled(false);
+    managers[1].SetVisibilityEnabled(false);
+    for (int building = 0; building < 400; ++building) {
+        float x = random() * WORLD_SIZE, z = random() * WORLD_SIZE;
+        float width = 15.0f + random() * 35.0f, depth = 15.0f + random() * 35.0f, height = 8.0f + random() * 30.0f;
+        managers[2].AddOccluder({ x, 0.0f, z }, { x + width, height, z + depth });
+    }
+
+    // The first clientCount entities are the players the clients look through
+    std::vector<Float3> positions(entityCount), velocities(entityCount);
+    std::vector<uint32_t> ids(entityCount);
+    auto spawn = [&](uint32_t i) {
+        positions[i] = { random() * WORLD_SIZE, 1.0f, random() * WORLD_SIZE };
+        float angle = random() * 6.2831853f, speed = i < clientCount ? 6.0f : 1.0f + random() * 4.0f;
+        velocities[i] = { cosf(angle) * speed, 0.0f, sinf(angle) * speed };
+    };
+    for (uint32_t i = 0; i < entityCount; ++i) {
+        spawn(i);
+        float importance = i < clientCount ? 4.0f : (i % 10 == 0 ? 2.0f : 1.0f);
+        for (InterestManager& manager : managers) ids[i] = manager.AddEntity(positions[i], importance);
+    }
+    auto viewOf = [&](uint32_t client) {
+        const Float3& p = positions[client];
+        return InterestManager::ClientView{ { p.x, p.y + 0.6f, p.z }, VIEW_DISTANCE, SEND_BUDGET };
+    };
+    for (uint32_t client = 0; client < clientCount; ++client) {
+        for (InterestManager& manager : managers) manager.AddClient(viewOf(client));
+    }
+
+    jobSystem.Initialize();
+    double moveMilliseconds[3] = {}, updateMilliseconds[3] = {}, worstMilliseconds[4] = {}, bruteMilliseconds = 0.0;
+    uint64_t relevant[3] = {}, sent[3] = {}, hidden[3] = {}, visited[3] = {}, cellChanges = 0;
+    bool ok = true;
+
+    // Per client and entity, for the longest wait of an entity in view: the tick it was last sent or came into view
+    std::vector<uint32_t> waitingSince(static_cast<size_t>(clientCount) * entityCount, 0);
+    std::vector<uint32_t> lastRelevant(static_cast<size_t>(clientCount) * entityCount, UINT32_MAX);
+    uint32_t longestWait = 0;
+    std::vector<uint32_t> expected, actual;
+
+    // Brute force keeps its own send history, one slot per client and entity
+    std::vector<float> importances(entityCount);
+    for (uint32_t i = 0; i < entityCount; ++i) importances[i] = i < clientCount ? 4.0f : (i % 10 == 0 ? 2.0f : 1.0f);
+    std::vector<uint32_t> bruteLastSent(static_cast<size_t>(clientCount) * entityCount, 0);
+    std::vector<InterestManager::RelevantEntity> bruteRelevantList;
+    std::vector<uint32_t> bruteSendList;
+
+    for (uint32_t tick = 0; tick < TICKS; ++tick) {
+        // Wander, turning now and then and bouncing off the edges; a few non-players respawn
+        for (uint32_t i = 0; i < entityCount; ++i) {
+            if (random() < 0.02f) {
+                float angle = random() * 6.2831853f, speed = sqrtf(velocities[i].x * velocities[i].x + velocities[i].z * velocities[i].z);
+                velocities[i] = { cosf(angle) * speed, 0.0f, sinf(angle) * speed };
+            }
+            positions[i].x += velocities[i].x * Simulation::TICK_SECONDS;
+            positions[i].z += velocities[i].z * Simulation::TICK_SECONDS;
+            if (positions[i].x < 0.0f || positions[i].x > WORLD_SIZE) velocities[i].x = -velocities[i].x;
+            if (positions[i].z < 0.0f || positions[i].z > WORLD_SIZE) velocities[i].z = -velocities[i].z;
+        }
+        std::vector<uint32_t> respawned;
+        for (uint32_t r = 0; r < RESPAWNS_PER_TICK && entityCount > clientCount; ++r) {
+            uint32_t i = clientCount + static_cast<uint32_t>(random() * (entityCount - clientCount)) % (entityCount - clientCount);
+            spawn(i);
+            respawned.push_back(i);
+        }
+
+        for (int m = 0; m < 3; ++m) {
+            InterestManager& manager = managers[m];
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i : respawned) {
+                float importance = i % 10 == 0 ? 2.0f : 1.0f;
+                manager.RemoveEntity(ids[i]);
+                if (manager.AddEntity(positions[i], importance) != ids[i]) ok = false;
+            }
+            for (uint32_t i = 0; i < entityCount; ++i) manager.MoveEntity(ids[i], positions[i]);
+            for (uint32_t client = 0; client < clientCount; ++client) manager.SetClientView(client, viewOf(client));
+            moveMilliseconds[m] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            manager.Update(m == 0 ? nullptr : &jobSystem);
+            const InterestManager::Stats& stats = manager.GetStats();
+            updateMilliseconds[m] += stats.updateMilliseconds;
+            double total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            worstMilliseconds[m] = std::max(worstMilliseconds[m], total);
+            relevant[m] += stats.relevant;
+            sent[m] += stats.sent;
+            hidden[m] += stats.hidden;
+            visited[m] += stats.entriesVisited;
+            if (m == 0) cellChanges += stats.cellChanges;
+        }
+        if (!ok) {
+            printf("FAILED: a respawned entity did not get its index back\n");
+            break;
+        }
+
+        // Thread count must not change what is sent
+        for (uint32_t client = 0; client < clientCount && ok; ++client) {
+            if (managers[0].GetSendList(client) != managers[1].GetSendList(client)) {
+                printf("FAILED: client %u send list differs between one and all threads at tick %u\n", client, tick);
+                ok = false;
+            }
+        }
+
+        // The same scoring and selection with no interest management: every client tests every
+        // entity, then picks its sends; the result must match the single-threaded hash exactly
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i : respawned) {
+            for (uint32_t client = 0; client < clientCount; ++client) bruteLastSent[static_cast<size_t>(client) * entityCount + ids[i]] = 0;
+        }
+        uint64_t bruteRelevant = 0;
+        bool bruteMatches = true;
+        const float rangeSquared = VIEW_DISTANCE * VIEW_DISTANCE;
+        for (uint32_t client = 0; client < clientCount; ++client) {
+            Float3 eye = viewOf(client).position;
+            uint32_t* lastSent = &bruteLastSent[static_cast<size_t>(client) * entityCount];
+            bruteRelevantList.clear();
+            for (uint32_t i = 0; i < entityCount; ++i) {
+                float dx = positions[i].x - eye.x, dy = positions[i].y - eye.y, dz = positions[i].z - eye.z;
+                float distanceSquared = dx * dx + dy * dy + dz * dz;
+                if (distanceSquared > rangeSquared) continue;
+                uint32_t waited = lastSent[ids[i]] == 0 ? InterestManager::MAX_STALE_TICKS
+                                                         : std::min(tick + 1 - lastSent[ids[i]], InterestManager::MAX_STALE_TICKS);
+                float score = importances[i] * static_cast<float>(waited) /
+                              (1.0f + std::sqrt(distanceSquared) / InterestManager::PRIORITY_FALLOFF);
+                bruteRelevantList.push_back({ ids[i], score });
+            }
+            bruteRelevant += bruteRelevantList.size();
+
+            size_t sendCount = std::min<size_t>(SEND_BUDGET, bruteRelevantList.size());
+            std::partial_sort(bruteRelevantList.begin(), bruteRelevantList.begin() + sendCount, bruteRelevantList.end(),
+                              [](const InterestManager::RelevantEntity& a, const InterestManager::RelevantEntity& b) {
+                                  return a.score > b.score || (a.score == b.score && a.entity < b.entity);
+                              });
+            bruteSendList.clear();
+            for (size_t i = 0; i < sendCount; ++i) {
+                bruteSendList.push_back(bruteRelevantList[i].entity);
+                lastSent[bruteRelevantList[i].entity] = tick + 1;
+            }
+            bruteMatches = bruteMatches && bruteSendList == managers[0].GetSendList(client);
+        }
+        double brute = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bruteMilliseconds += brute;
+        worstMilliseconds[3] = std::max(worstMilliseconds[3], brute);
+        if (ok && !bruteMatches) {
+            printf("FAILED: a send list differs from brute force at tick %u\n", tick);
+            ok = false;
+        }
+        if (bruteRelevant != managers[0].GetStats().relevant) {
+            printf("FAILED: %llu entities in range, the hash found %llu at tick %u\n", static_cast<unsigned long long>(bruteRelevant),
+                   static_cast<unsigned long long>(managers[0].GetStats().relevant), tick);
+            ok = false;
+        }
+        // And the same entities, checked in full now and then
+        for (uint32_t client = 0; client < clientCount && ok && tick % 30 == 0; ++client) {
+            Float3 eye = viewOf(client).position;
+            expected.clear();
+            actual.clear();
+            for (uint32_t i = 0; i < entityCount; ++i) {
+                float dx = positions[i].x - eye.x, dy = positions[i].y - eye.y, dz = positions[i].z - eye.z;
+                if (dx * dx + dy * dy + dz * dz <= VIEW_DISTANCE * VIEW_DISTANCE) expected.push_back(ids[i]);
+            }
+            for (const InterestManager::RelevantEntity& entity : managers[0].GetRelevant(client)) actual.push_back(entity.entity);
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            if (expected != actual) {
+                printf("FAILED: client %u relevant set differs from brute force at tick %u\n", client, tick);
+                ok = false;
+            }
+        }
+
+        // Nothing in view waits long: the score grows with every tick an entity is not sent
+        for (uint32_t client = 0; client < clientCount; ++client) {
+            size_t row = static_cast<size_t>(client) * entityCount;
+            for (const InterestManager::RelevantEntity& entity : managers[2].GetRelevant(client)) {
+                if (lastRelevant[row + entity.entity] + 1 != tick) waitingSince[row + entity.entity] = tick;
+                lastRelevant[row + entity.entity] = tick;
+            }
+            for (uint32_t entity : managers[2].GetSendList(client)) waitingSince[row + entity] = tick;
+            for (const InterestManager::RelevantEntity& entity : managers[2].GetRelevant(client)) {
+                longestWait = std::max(longestWait, tick - waitingSince[row + entity.entity]);
+            }
+        }
+        if (!ok) break;
+    }
+
+    printf("%u clients, %u entities, %.0f m view, %u sends per client per tick, %u threads, %.1f cell changes per tick\n",
+           clientCount, entityCount, VIEW_DISTANCE, SEND_BUDGET, jobSystem.GetThreadCount(), static_cast<double>(cellChanges) / TICKS);
+    printf("method                ms/tick  (move + update)  worst ms  relevant/client  sent/client  hidden/client  entries visited/client\n");
+    double perClient = static_cast<double>(TICKS) * clientCount;
+    printf("%-20s  %7.3f                     %8.3f  %15.1f  %11.1f\n", "test every entity", bruteMilliseconds / TICKS,
+           worstMilliseconds[3], static_cast<double>(relevant[0]) / perClient, sent[0] / perClient);
+    for (int m = 0; m < 3; ++m) {
+        printf("%-20s  %7.3f  (%5.3f + %6.3f)  %8.3f  %15.1f  %11.1f  %13.1f  %22.1f\n", names[m],
+               (moveMilliseconds[m] + updateMilliseconds[m]) / TICKS, moveMilliseconds[m] / TICKS, updateMilliseconds[m] / TICKS,
+               worstMilliseconds[m], relevant[m] / perClient, sent[m] / perClient, hidden[m] / perClient, visited[m] / perClient);
+    }
+    printf("longest wait of an entity in view: %u ticks\n", longestWait);
+    if (ok && longestWait > MAX_WAIT_TICKS) {
+        printf("FAILED: an entity in view waited over %u ticks\n", MAX_WAIT_TICKS);
+        ok = false;
+    }
+
+    if (!ok) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("OK: same entities and sends as testing every one, same sends on every thread count, no entity starved\n");
+    return 0;
+}
+
+void writeResolutionTrace() {
+    if (dynamicResolution.WriteTrace(RESOLUTION_TRACE_PATH)) {
+        printf("Wrote %s\n", RESOLUTION_TRACE_PATH);
+    }
+}
+
+// Needs timer queries (GL 3.3 or ARB_timer_query); returns false without them
+bool initDynamicResolution(float targetMilliseconds) {
+    glGenQueriesProc = reinterpret_cast<PFNGLGENQUERIESPROC>(glutGetProcAddress("glGenQueries"));
+    glBeginQueryProc = reinterpret_cast<PFNGLBEGINQUERYPROC>(glutGetProcAddress("glBeginQuery"));
+    glEndQueryProc = reinterpret_cast<PFNGLENDQUERYPROC>(glutGetProcAddress("glEndQuery"));
+    glGetQueryObjectivProc = reinterpret_cast<PFNGLGETQUERYOBJECTIVPROC>(glutGetProcAddress("glGetQueryObjectiv"));
+    glGetQueryObjectui64vProc = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VPROC>(glutGetProcAddress("glGetQueryObjectui64v"));
+    if (!glGenQueriesProc || !glBeginQueryProc || !glEndQueryProc || !glGetQueryObjectivProc || !glGetQueryObjectui64vProc) {
+        return false;
+    }
+    glGenQueriesProc(SCENE_TIMER_FRAMES, sceneTimers);
+
+    // Window-sized copy target; only the rendered corner is ever read
+    glGenTextures(1, &sceneTexture);
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, windowWidth, windowHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    dynamicResolution.Initialize(targetMilliseconds);
+    dynamicResolution.SetTraceCapacity(RESOLUTION_TRACE_FRAMES);
+    atexit(writeResolutionTrace);
+    return true;
+}
+
+// Feeds finished scene timings to the controller without waiting on the GPU
+void readSceneTimers() {
+    for (int i = 0; i < SCENE_TIMER_FRAMES; ++i) {
+        int slot = (sceneTimerFrame + i) % SCENE_TIMER_FRAMES;
+        if (!sceneTimerPending[slot]) continue;
+        GLint available = 0;
+        glGetQueryObjectivProc(sceneTimers[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64vProc(sceneTimers[slot], GL_QUERY_RESULT, &nanoseconds);
+        sceneTimerPending[slot] = false;
+        dynamicResolution.Update(static_cast<float>(nanoseconds / 1.0e6));
+    }
+}
+
+// Stretches the rendered corner of the back buffer over the whole window
+void upscaleScene() {
+    glBindTexture(GL_TEXTURE_2D, sceneTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, sceneWidth, sceneHeight);
+    renderCapture.DrawBatch(CaptureTarget::BATCH_FULLSCREEN, 0, 1);
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, 1.0, 0.0, 1.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    float u = static_cast<float>(sceneWidth) / windowWidth;
+    float v = static_cast<float>(sceneHeight) / windowHeight;
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, 0.0f);
+    glTexCoord2f(u, 0.0f);    glVertex2f(1.0f, 0.0f);
+    glTexCoord2f(u, v);       glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, v);    glVertex2f(0.0f, 1.0f);
     glEnd();
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    // Draw some cubes
-    drawCube(0.0f, 0.5f, -2.0f);
-    drawCube(-2.0f, 0.5f, -2.0f);
-    drawCube(2.0f, 0.5f, -2.0f);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
 }
 
 void display() {
+    MetricsTimerScope timer(&metrics, frameMetric);
+    renderCapture.BeginFrame();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glLoadIdentity();
 
+    // Render the scene at the controller's scale
+    int timerSlot = sceneTimerFrame % SCENE_TIMER_FRAMES;
+    bool timed = dynamicResolutionEnabled && !sceneTimerPending[timerSlot];
+    if (dynamicResolutionEnabled) {
+        float scale = dynamicResolution.GetScale();
+        sceneWidth = std::max(1, static_cast<int>(windowWidth * scale + 0.5f));
+        sceneHeight = std::max(1, static_cast<int>(windowHeight * scale + 0.5f));
+        glViewport(0, 0, sceneWidth, sceneHeight);
+        lodSelector.SetProjection(fieldOfView * 3.14159f / 180.0f, static_cast<float>(sceneHeight));
+        if (timed) glBeginQueryProc(GL_TIME_ELAPSED, sceneTimers[timerSlot]);
+    }
+
     // Apply camera transformation
     glRotatef(cameraAngleX, 1.0f, 0.0f, 0.0f);
     glRotatef(cameraAngleY, 0.0f, 1.0f, 0.0f);
     glTranslatef(-cameraX, -cameraY, -cameraZ);
 
     drawScene();
+    drawParticles();
+
+    if (dynamicResolutionEnabled) {
+        if (timed) {
+            glEndQueryProc(GL_TIME_ELAPSED);
+            sceneTimerPending[timerSlot] = true;
+        }
+        sceneTimerFrame++;
+        upscaleScene();
+    }
 
     // Draw crosshair
     glMatrixMode(GL_PROJECTION);
@@ -118,6 +2353,7 @@ void display() {
     glLoadIdentity();
     
     glColor3f(1.0f, 1.0f, 1.0f);
+    renderCapture.DrawBatch(CaptureTarget::BATCH_LINES, 0, 2);
     glBegin(GL_LINES);
     glVertex2f(-0.02f, 0.0f);
     glVertex2f(0.02f, 0.0f);
@@ -131,13 +2367,43 @@ void display() {
     glMatrixMode(GL_MODELVIEW);
 
     glutSwapBuffers();
+
+    if (renderCapture.IsCapturing()) {
+        renderCapture.EndFrame();
+        if (!renderCapture.IsCapturing()) {
+            bool saved = renderCapture.Save(renderCapturePath);
+            printf("%s %u frames to %s\n", saved ? "Captured" : "Could not write", renderCapture.GetFrameCount(),
+                   renderCapturePath);
+        }
+    }
+
+    if (dynamicResolutionEnabled) {
+        readSceneTimers();
+    }
+
+    if (printStartupTimeline) {
+        printStartupTimeline = false;
+        printf("first frame %.2f ms\n", std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startupStart).count());
+    }
 }
 
 void reshape(int w, int h) {
+    windowWidth = w > 0 ? w : 1;
+    windowHeight = h > 0 ? h : 1;
+    sceneWidth = windowWidth;
+    sceneHeight = windowHeight;
+    if (sceneTexture) {
+        glBindTexture(GL_TEXTURE_2D, sceneTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, windowWidth, windowHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
     glViewport(0, 0, w, h);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(45.0f, (float)w / h, 0.1f, 100.0f);
+    aspectRatio = (float)w / (h > 0 ? h : 1);
+    gluPerspective(fieldOfView, aspectRatio, nearPlane, farPlane);
+    lodSelector.SetProjection(fieldOfView * 3.14159f / 180.0f, static_cast<float>(h > 0 ? h : 1));
     glMatrixMode(GL_MODELVIEW);
 }
 
@@ -176,10 +2442,78 @@ void mouseMotion(int x, int y) {
     glutPostRedisplay();
 }
 
+bool initAudio(const char* capturePath) {
+    if (!audio.Initialize()) return false;
+    std::vector<float> samples = SynthesizeGunshot(AudioMixer::SAMPLE_RATE);
+    gunshotSound = audio.AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
+    samples = SynthesizeImpact(AudioMixer::SAMPLE_RATE);
+    impactSound = audio.AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
+    for (uint32_t i = 0; i < FOOTSTEP_VARIATIONS; ++i) {
+        samples = SynthesizeFootstep(AudioMixer::SAMPLE_RATE, i);
+        footstepSounds[i] = audio.AddSound(samples.data(), static_cast<uint32_t>(samples.size()));
+    }
+
+    AudioSink* sink = &nullAudioSink;
+    if (capturePath) {
+        audioCapture.reset(new WavAudioSink(capturePath));
+        sink = audioCapture.get();
+    }
+    if (!audio.Start(sink)) {
+        throw std::runtime_error(capturePath ? std::string("could not write ") + capturePath : "could not start audio");
+    }
+    return true;
+}
+
+bool initMetrics(const char* exportPath) {
+    if (!metrics.Initialize()) return false;
+    frameMetric = metrics.AddHistogram("fpsgame_frame", "display() time");
+    updateMetric = metrics.AddHistogram("fpsgame_update", "update() time");
+    shotMetric = metrics.AddCounter("fpsgame_shots_total", "Shots fired");
+    awakeCratesMetric = metrics.AddGauge("fpsgame_physics_awake_bodies", "Crates simulated last step");
+    sceneRecomputedMetric = metrics.AddGauge("fpsgame_scene_nodes_recomputed", "Scene graph world matrices rebuilt last frame");
+    sceneSkippedMetric = metrics.AddGauge("fpsgame_scene_nodes_skipped", "Clean scene graph nodes skipped last frame");
+    if (exportPath && !metrics.StartExport(exportPath)) {
+        throw std::runtime_error(std::string("could not export metrics to ") + exportPath);
+    }
+    return true;
+}
+
+void mouseButton(int button, int state, int x, int y) {
+    if (button != GLUT_LEFT_BUTTON || state != GLUT_DOWN) return;
+
+    float pitch = cameraAngleX * 3.14159f / 180.0f;
+    float yaw = cameraAngleY * 3.14159f / 180.0f;
+    Float3 forward = { sinf(yaw) * cosf(pitch), -sinf(pitch), -cosf(yaw) * cosf(pitch) };
+    Float3 muzzle = { cameraX + forward.x * 0.6f, cameraY - 0.15f + forward.y * 0.6f, cameraZ + forward.z * 0.6f };
+
+    // Hits the ground plane, or stops at the end of its range; a crate in the way is pushed
+    float distance = forward.y < -0.001f ? (std::min)(-cameraY / forward.y, SHOT_RANGE) : SHOT_RANGE;
+    PhysicsWorld::RayHit crateHit;
+    if (crates.RayCast({ cameraX, cameraY, cameraZ }, forward, distance, crateHit)) {
+        distance = crateHit.distance;
+        crates.ApplyImpulse(crateHit.body, { forward.x * SHOT_IMPULSE, forward.y * SHOT_IMPULSE, forward.z * SHOT_IMPULSE },
+                            crateHit.point);
+    }
+    Float3 hit = { cameraX + forward.x * distance, cameraY + forward.y * distance, cameraZ + forward.z * distance };
+    Float3 back = { -forward.x, -forward.y, -forward.z };
+
+    metrics.Increment(shotMetric);
+    uint32_t seed = ++shotCount * 2654435761u;
+    particles.Emit({ PARTICLE_MUZZLE_FLASH, 24, muzzle, forward, 3.0f, 0.6f, seed });
+    particles.Emit({ PARTICLE_IMPACT, 48, hit, back, 4.0f, 1.0f, seed + 1 });
+    particles.Emit({ PARTICLE_SMOKE, 12, hit, back, 0.4f, 1.0f, seed + 2 });
+
+    // Our own gun never gives way to other sounds; impacts are placed in the world
+    audio.PlayLocal(gunshotSound, 0.8f, 255);
+    audio.Play(impactSound, hit, 1.0f, 160);
+}
+
 void update(int value) {
+    MetricsTimerScope timer(&metrics, updateMetric);
     float angleRad = cameraAngleY * 3.14159f / 180.0f;
     float forwardX = sin(angleRad);
     float forwardZ = -cos(angleRad);
+    float previousX = cameraX, previousY = cameraY, previousZ = cameraZ;
 
     // Handle WASD movement
     if (keys['w']) {
@@ -205,23 +2539,173 @@ void update(int value) {
         cameraY -= moveSpeed;
     }
 
+    // Per-tick movement scaled to units per second for streaming prefetch
+    cameraVelocity = { (cameraX - previousX) / 0.016f, (cameraY - previousY) / 0.016f, (cameraZ - previousZ) / 0.016f };
+    worldStreamer.Update({ cameraX, cameraY, cameraZ }, cameraVelocity);
+    particles.Update(0.016f, &jobSystem);
+    crates.Step(0.016f, &jobSystem);
+    metrics.SetGauge(awakeCratesMetric, crates.GetStats().awakeBodies);
+    updateSceneGraph(0.016f);
+
+    // A footstep every stride walked on the ground, then the listener follows the camera
+    float dx = cameraX - previousX, dz = cameraZ - previousZ;
+    strideDistance += sqrtf(dx * dx + dz * dz);
+    if (strideDistance >= STRIDE_LENGTH) {
+        strideDistance -= STRIDE_LENGTH;
+        audio.PlayLocal(footstepSounds[footstepCount++ % FOOTSTEP_VARIATIONS], 0.5f, 64);
+    }
+    audio.SetListener({ cameraX, cameraY, cameraZ }, { cosf(angleRad), 0.0f, sinf(angleRad) });
+
     glutPostRedisplay();
     glutTimerFunc(16, update, 0); // 60 FPS
 }
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-    glutInitWindowSize(800, 600);
-    glutCreateWindow("FPS Game");
+    startupStart = std::chrono::steady_clock::now();
+    const char* worldPath = nullptr;
+    const char* audioCapturePath = nullptr;
+    const char* metricsPath = nullptr;
+    float resolutionTarget = 0.0f;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record-benchmark") == 0) {
+            size_t objects = (i + 1 < argc) ? strtoul(argv[i + 1], nullptr, 10) : 100000;
+            return runRecordBenchmark(objects > 0 ? objects : 100000);
+        }
+        if (strcmp(argv[i], "--occlusion-benchmark") == 0) {
+            return runOcclusionBenchmark();
+        }
+        if (strcmp(argv[i], "--cluster-benchmark") == 0) {
+            jobSystem.Initialize();
+            return runClusterBenchmark();
+        }
+        if (strcmp(argv[i], "--dynres-benchmark") == 0) {
+            return runDynamicResolutionBenchmark(i + 1 < argc ? argv[i + 1] : nullptr);
+        }
+        if (strcmp(argv[i], "--particle-benchmark") == 0) {
+            uint32_t count = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 1000000;
+            return runParticleBenchmark(count > 0 ? count : 1000000);
+        }
+        if (strcmp(argv[i], "--animation-benchmark") == 0) {
+            uint32_t characters = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 500;
+            return runAnimationBenchmark(characters > 0 ? characters : 500);
+        }
+        if (strcmp(argv[i], "--audio-benchmark") == 0) {
+            uint32_t voices = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 256;
+            return runAudioBenchmark(voices > 0 ? voices : 256, i + 2 < argc ? argv[i + 2] : nullptr);
+        }
+        if (strcmp(argv[i], "--physics-benchmark") == 0) {
+            uint32_t boxes = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 10000;
+            return runPhysicsBenchmark(boxes > 0 ? boxes : 10000);
+        }
+        if (strcmp(argv[i], "--metrics-benchmark") == 0) {
+            return runMetricsBenchmark();
+        }
+        if (strcmp(argv[i], "--capture-benchmark") == 0) {
+            size_t objects = (i + 1 < argc) ? strtoul(argv[i + 1], nullptr, 10) : 10000;
+            return runCaptureBenchmark(objects > 0 ? objects : 10000);
+        }
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            bool useGL = i + 2 < argc && strcmp(argv[i + 2], "gl") == 0;
+            return runCaptureReplay(argv[i + 1], useGL, argc, argv);
+        }
+        if (strcmp(argv[i], "--scenegraph-benchmark") == 0) {
+            uint32_t nodes = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 100000;
+            return runSceneGraphBenchmark(nodes > 0 ? nodes : 100000);
+        }
+        if (strcmp(argv[i], "--interest-benchmark") == 0) {
+            uint32_t clients = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 200;
+            uint32_t entities = (i + 2 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 2], nullptr, 10)) : 10000;
+            return runInterestBenchmark(clients > 0 ? clients : 200, entities > 0 ? entities : 10000);
+        }
+        if (strcmp(argv[i], "--startup-benchmark") == 0) {
+            return runStartupBenchmark();
+        }
+        if (strcmp(argv[i], "--startup-timeline") == 0) {
+            printStartupTimeline = true;
+        }
+        if (strcmp(argv[i], "--lod-benchmark") == 0) {
+            return runLodBenchmark();
+        }
+        if (strcmp(argv[i], "--stream-benchmark") == 0) {
+            float seconds = (i + 1 < argc) ? static_cast<float>(atof(argv[i + 1])) : 20.0f;
+            float readDelay = (i + 2 < argc) ? static_cast<float>(atof(argv[i + 2])) : 150.0f;
+            return runStreamBenchmark(seconds > 0.0f ? seconds : 20.0f, readDelay);
+        }
+        if (strcmp(argv[i], "--make-world") == 0 && i + 1 < argc) {
+            float size = (i + 2 < argc) ? static_cast<float>(atof(argv[i + 2])) : 4096.0f;
+            return generateWorld(argv[i + 1], size > 0.0f ? size : 4096.0f) ? 0 : 1;
+        }
+        if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+            worldPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--audio-capture") == 0 && i + 1 < argc) {
+            audioCapturePath = argv[++i];
+        }
+        if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            renderCapturePath = argv[++i];
+            char* end = nullptr;
+            unsigned long frames = (i + 1 < argc) ? strtoul(argv[i + 1], &end, 10) : 0;
+            renderCaptureFrames = frames > 0 && end && *end == '\0' ? static_cast<uint32_t>(frames) : RenderCapture::DEFAULT_MAX_FRAMES;
+        }
+        if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--dynamic-resolution") == 0) {
+            float target = (i + 1 < argc) ? static_cast<float>(atof(argv[i + 1])) : 0.0f;
+            resolutionTarget = target > 0.0f ? target : 14.0f;
+        }
+    }
 
-    init();
+    // Window and GL state stay on the main thread; everything else overlaps with them
+    StartupGraph startup;
+    StartupGraph::StageId window = startup.AddStage("window", [&] {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(800, 600);
+        glutCreateWindow("FPS Game");
+        init();
+        return true;
+    }, {}, StartupGraph::STAGE_MAIN_THREAD);
+    startup.AddStage("jobs", [] { return jobSystem.Initialize(); });
+    startup.AddStage("occlusion", [] { return occlusionCuller.Initialize(); });
+    startup.AddStage("floorMesh", [] { buildFloorMesh(floorMesh); return true; });
+    startup.AddStage("particles", [] { return particles.Initialize(); });
+    startup.AddStage("physics", [] { return initPhysics(); });
+    startup.AddStage("sceneGraph", [] { return initSceneGraph(); });
+    startup.AddStage("audio", [audioCapturePath] { return initAudio(audioCapturePath); });
+    startup.AddStage("metrics", [metricsPath] { return initMetrics(metricsPath); });
+    startup.AddStage("world", [worldPath] {
+        if (worldPath && !worldStreamer.Initialize(worldPath, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS)) {
+            fprintf(stderr, "Could not open world %s, using the built-in scene\n", worldPath);
+        }
+        worldStreamer.SetRequiredRadius(farPlane);
+        return true;
+    });
+    if (resolutionTarget > 0.0f) {
+        startup.AddStage("resolution", [resolutionTarget] {
+            dynamicResolutionEnabled = initDynamicResolution(resolutionTarget);
+            if (!dynamicResolutionEnabled) {
+                fprintf(stderr, "Timer queries unavailable, rendering at full resolution\n");
+            }
+            return true;
+        }, { window }, StartupGraph::STAGE_MAIN_THREAD);
+    }
+    if (!startup.Run()) {
+        fprintf(stderr, "%s", startup.GetError().c_str());
+        return 1;
+    }
+    if (printStartupTimeline) {
+        printf("%s", startup.FormatTimeline().c_str());
+    }
+    lodSelector.SetThreshold(LOD_PIXEL_ERROR);
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutKeyboardUpFunc(keyboardUp);
     glutPassiveMotionFunc(mouseMotion);
+    glutMotionFunc(mouseMotion);
+    glutMouseFunc(mouseButton);
     glutSetCursor(GLUT_CURSOR_NONE); // Hide cursor
     glutWarpPointer(400, 300); // Center cursor
 
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "AllocationTracker.h"
+#include "ClusteredLighting.h"
+#include "DynamicResolution.h"
+#include "GLScene.h"
+
+// Steady-state allocation gate for the CPU side of the renderer, run by ctest:
+//   AllocationCheck [frames]
+// Streams a generated world around a turning camera and fails if any frame
+// after warm-up touches the heap. Always built with allocation tracking.
+
+int runAllocationCheck(int frames) {
+    const char* WORLD_PATH = "alloc_check.world";
+    const float TURN_DEGREES_PER_FRAME = 1.5f;
+    const int WARMUP_FRAMES = static_cast<int>(360.0f / TURN_DEGREES_PER_FRAME);  // One full turn grows every list to its peak
+    const uint32_t LIGHT_COUNT = 200;
+
+    if (!AllocationTracker::IsEnabled()) {
+        printf("FAILED: allocation tracking is compiled out; build with FPSGAME_TRACK_ALLOCATIONS\n");
+        return 1;
+    }
+    if (!generateWorld(WORLD_PATH, 512.0f)) {
+        printf("Failed to write %s\n", WORLD_PATH);
+        return 1;
+    }
+
+    jobSystem.Initialize();
+    occlusionCuller.Initialize();
+    buildFloorMesh(floorMesh);
+    lodSelector.SetProjection(fieldOfView * 3.14159f / 180.0f, 600.0f);
+    lodSelector.SetThreshold(LOD_PIXEL_ERROR);
+    aspectRatio = 800.0f / 600.0f;
+    if (!worldStreamer.Initialize(WORLD_PATH, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS)) {
+        printf("Failed to open %s\n", WORLD_PATH);
+        return 1;
+    }
+    worldStreamer.SetRequiredRadius(farPlane);
+
+    ClusteredLighting clusters;
+    clusters.Initialize();
+    clusters.SetProjection(fieldOfView * 3.14159f / 180.0f, aspectRatio, nearPlane, farPlane);
+    std::vector<PointLight> lights(LIGHT_COUNT);
+    for (uint32_t i = 0; i < LIGHT_COUNT; ++i) {
+        float angle = i * 0.37f;
+        lights[i] = { { cosf(angle) * (5.0f + i * 0.2f), 1.5f, sinf(angle) * (5.0f + i * 0.2f) }, 6.0f, { 1.0f, 0.7f, 0.4f }, 1.0f };
+    }
+
+    DynamicResolution resolution;
+    resolution.Initialize(14.0f);
+    resolution.SetTraceCapacity(static_cast<uint32_t>(frames));
+
+    // Standing still while looking around keeps the resident set fixed after the first loads
+    cameraX = 0.0f;
+    cameraY = 1.7f;
+    cameraZ = 0.0f;
+    Float3 stopped = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 1000 && (i == 0 || worldStreamer.GetStats().queuedLoads > 0); ++i) {
+        worldStreamer.Update({ cameraX, cameraY, cameraZ }, stopped);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    printf("%d frames after %d warm-up frames, %u worker threads\n", frames, WARMUP_FRAMES, jobSystem.GetThreadCount());
+
+    uint64_t steadyAllocations = 0, steadyBytes = 0;
+    uint64_t tagAllocations[static_cast<size_t>(MemoryTag::Count)] = {};
+    int failingFrames = 0;
+    for (int frame = 0; frame < WARMUP_FRAMES + frames; ++frame) {
+        AllocationTracker::BeginFrame();
+
+        cameraAngleY = frame * TURN_DEGREES_PER_FRAME;
+        Float4x4 viewProjection = buildViewProjection(cameraX, cameraY, cameraZ, cameraAngleX, cameraAngleY, aspectRatio);
+        {
+            MemoryTagScope tag(MemoryTag::World);
+            worldStreamer.Update({ cameraX, cameraY, cameraZ }, stopped);
+        }
+        {
+            MemoryTagScope tag(MemoryTag::Render);
+            renderQueue.Clear();
+            lodSelector.ResetStats();
+            occlusionCuller.BeginFrame(viewProjection);
+            submitStreamedWorld();
+            renderQueue.Sort();
+            recordStreams(std::max(2u, jobSystem.GetThreadCount()));
+        }
+        {
+            MemoryTagScope tag(MemoryTag::Lighting);
+            float yaw = cameraAngleY * 3.14159f / 180.0f;
+            Float4x4 rotateY = Float4x4::Identity();
+            rotateY.m[0][0] = cosf(yaw);
+            rotateY.m[0][2] = -sinf(yaw);
+            rotateY.m[2][0] = sinf(yaw);
+            rotateY.m[2][2] = cosf(yaw);
+            Float4x4 view = Multiply(Multiply(Float4x4::Translation(-cameraX, -cameraY, -cameraZ), rotateY),
+                                     Float4x4::Scale(1.0f, 1.0f, -1.0f));
+            clusters.Build(lights.data(), LIGHT_COUNT, view, &jobSystem);
+        }
+        resolution.Update(10.0f + (frame % 7));
+
+        const AllocationTracker::FrameStats& stats = AllocationTracker::EndFrame();
+        if (frame < WARMUP_FRAMES) continue;
+        steadyAllocations += stats.allocations;
+        steadyBytes += stats.bytesAllocated;
+        for (size_t tag = 0; tag < static_cast<size_t>(MemoryTag::Count); ++tag) {
+            tagAllocations[tag] += stats.tags[tag].allocations;
+        }
+        if (stats.allocations > 0) failingFrames++;
+    }
+
+    printf("tag        allocations\n");
+    for (size_t tag = 0; tag < static_cast<size_t>(MemoryTag::Count); ++tag) {
+        printf("%-9s  %11llu\n", AllocationTracker::GetTagName(static_cast<MemoryTag>(tag)),
+               static_cast<unsigned long long>(tagAllocations[tag]));
+    }
+    printf("%llu allocations (%llu bytes) in %d of %d steady-state frames, %u draws per frame\n",
+           static_cast<unsigned long long>(steadyAllocations), static_cast<unsigned long long>(steadyBytes),
+           failingFrames, frames, static_cast<uint32_t>(renderQueue.GetSize()));
+
+    worldStreamer.Shutdown();
+    std::remove(WORLD_PATH);
+    if (failingFrames > 0) {
+        printf("FAILED: steady-state frames allocated\n");
+        return 1;
+    }
+    printf("OK: no steady-state allocations\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    return runAllocationCheck(frames > 0 ? frames : 300);
+}
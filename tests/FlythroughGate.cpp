@@ -0,0 +1,434 @@
+#include <GL/freeglut.h>
+#if defined(FPSGAME_HAVE_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+#include "AllocationTracker.h"
+#include "GLScene.h"
+#include "WorldFile.h"
+
+// Frame-time regression gate for the OpenGL build's scene path, run by ctest:
+//   FlythroughGate <baseline> [margin] [gl|offscreen]
+//   FlythroughGate --record <baseline> [gl|offscreen]
+// gl draws into a GLUT window; offscreen draws into a Mesa pbuffer through
+// EGL's surfaceless platform, so it needs no display.
+
+enum RenderMode { RENDER_NONE, RENDER_WINDOW, RENDER_OFFSCREEN };
+const char* const RENDER_MODE_NAMES[] = { "headless", "gl", "offscreen" };
+
+// Counts what the render queue submits, optionally passing it on to GL. The GL
+// driver allocates as it pleases (llvmpipe compiles new state combinations with
+// LLVM), so forwarded calls are charged Untagged and left out of the gate.
+class FlythroughBackend : public RenderBackend {
+public:
+    explicit FlythroughBackend(RenderBackend* forward) : m_forward(forward), m_mesh(MESH_FLOOR), m_draws(0), m_triangles(0) {}
+
+    void BeginRange() override {
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->BeginRange();
+    }
+
+    void EndRange() override {
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->EndRange();
+    }
+
+    void SetShader(uint32_t shader) override {
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->SetShader(shader);
+    }
+
+    void SetMaterial(uint32_t material) override {
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->SetMaterial(material);
+    }
+
+    void SetMesh(uint32_t mesh) override {
+        m_mesh = mesh;
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->SetMesh(mesh);
+    }
+
+    void Draw(const DrawItem& item) override {
+        m_draws++;
+        m_triangles += m_mesh == MESH_CUBE ? 12 : floorMesh.chain.lods[item.lod].indexCount / 3;
+        if (!m_forward) return;
+        MemoryTagScope driver(MemoryTag::Untagged);
+        m_forward->Draw(item);
+    }
+
+    uint64_t GetDraws() const { return m_draws; }
+    uint64_t GetTriangles() const { return m_triangles; }
+    void ResetCounts() { m_draws = m_triangles = 0; }
+
+private:
+    RenderBackend* m_forward;
+    uint32_t m_mesh;
+    uint64_t m_draws;
+    uint64_t m_triangles;
+};
+
+// Dense prop field: a grid of small crates on every chunk, broken up by a few walls
+bool generatePropField(const char* path) {
+    const float CHUNK_SIZE = 64.0f;
+    const uint32_t CHUNKS = 4;
+    const int PROPS_PER_SIDE = 40;
+    float origin = -0.5f * CHUNKS * CHUNK_SIZE;
+
+    return WorldFile::Write(path, CHUNKS, CHUNKS, CHUNK_SIZE, origin, origin,
+        [&](int32_t chunkX, int32_t chunkZ, std::vector<WorldObject>& objects) {
+            uint32_t seed = static_cast<uint32_t>(chunkX) * 73856093u ^ static_cast<uint32_t>(chunkZ) * 19349663u;
+            auto random01 = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+            };
+
+            float minX = origin + chunkX * CHUNK_SIZE;
+            float minZ = origin + chunkZ * CHUNK_SIZE;
+            float half = CHUNK_SIZE * 0.5f;
+            objects.push_back({ MESH_FLOOR, 0, { minX + half, 0.0f, minZ + half }, { half, 0.0f, half } });
+
+            // Walls along the chunk edge leave the middle open for the camera path
+            Float3 wall = { 6.0f, 2.5f, 0.3f };
+            objects.push_back({ MESH_CUBE, WORLD_OBJECT_OCCLUDER, { minX + 8.0f + random01() * 16.0f, wall.y, minZ + 2.0f }, wall });
+
+            float spacing = CHUNK_SIZE / PROPS_PER_SIDE;
+            for (int z = 0; z < PROPS_PER_SIDE; ++z) {
+                for (int x = 0; x < PROPS_PER_SIDE; ++x) {
+                    float size = 0.15f + random01() * 0.25f;
+                    float px = minX + (x + 0.5f) * spacing + (random01() - 0.5f) * spacing * 0.5f;
+                    float pz = minZ + (z + 0.5f) * spacing + (random01() - 0.5f) * spacing * 0.5f;
+                    objects.push_back({ MESH_CUBE, 0, { px, size, pz }, { size, size, size } });
+                }
+            }
+        });
+}
+
+// Closed Catmull-Rom spline through a scene's control points, at t in [0, 1)
+Float3 evaluatePath(const std::vector<Float3>& points, float t) {
+    size_t count = points.size();
+    float scaled = t * count;
+    size_t segment = static_cast<size_t>(scaled) % count;
+    float u = scaled - floorf(scaled);
+    const Float3& p0 = points[(segment + count - 1) % count];
+    const Float3& p1 = points[segment];
+    const Float3& p2 = points[(segment + 1) % count];
+    const Float3& p3 = points[(segment + 2) % count];
+    auto blend = [u](float a, float b, float c, float d) {
+        return 0.5f * (2.0f * b + (c - a) * u + (2.0f * a - 5.0f * b + 4.0f * c - d) * u * u + (3.0f * b - a - 3.0f * c + d) * u * u * u);
+    };
+    return { blend(p0.x, p1.x, p2.x, p3.x), blend(p0.y, p1.y, p2.y, p3.y), blend(p0.z, p1.z, p2.z, p3.z) };
+}
+
+struct FlythroughResult {
+    const char* scene;
+    double values[7];
+};
+
+const char* const FLYTHROUGH_METRICS[] = { "p50_ms", "p95_ms", "p99_ms", "max_ms", "draws", "triangles", "allocations" };
+const size_t FLYTHROUGH_METRIC_COUNT = sizeof(FLYTHROUGH_METRICS) / sizeof(FLYTHROUGH_METRICS[0]);
+const size_t FLYTHROUGH_MAX_METRIC = 3;  // Reported only: one descheduled frame decides it
+
+// Flies the camera along a path through a streamed scene: one untimed warm-up
+// lap, then measured laps. Streaming is waited for outside the timed part, so
+// every lap draws the same chunks; the frame times, draw and triangle counts
+// cover culling, LOD selection, submission, sorting and execution, plus the GL
+// draw and glFinish when rendering. Each frame's time is the fastest of the
+// measured laps, so a frame that lost the CPU to another process does not
+// decide a percentile.
+bool runFlythroughScene(const char* scene, const char* worldPath, const std::vector<Float3>& points, bool useGL,
+                        FlythroughResult& result) {
+    const int FRAMES_PER_LAP = 600;
+    const int LAPS = 3;
+    const float LOOK_AHEAD = 0.002f;
+
+    if (!worldStreamer.Initialize(worldPath, WORLD_LOAD_RADIUS, WORLD_MAX_RESIDENT_CHUNKS)) {
+        printf("Failed to open %s\n", worldPath);
+        return false;
+    }
+    worldStreamer.SetRequiredRadius(farPlane);
+
+    FlythroughBackend backend(useGL ? &sceneBackend : nullptr);
+    std::vector<double> frameTimes(FRAMES_PER_LAP, std::numeric_limits<double>::max());
+    double pathLength = 0.0;
+    uint64_t allocations = 0;
+    Float3 stopped = { 0.0f, 0.0f, 0.0f };
+
+    for (int lap = 0; lap <= LAPS; ++lap) {
+        bool measured = lap > 0;
+        if (lap == 1) backend.ResetCounts();
+        for (int frame = 0; frame < FRAMES_PER_LAP; ++frame) {
+            float t = static_cast<float>(frame) / FRAMES_PER_LAP;
+            Float3 eye = evaluatePath(points, t);
+            Float3 ahead = evaluatePath(points, t + LOOK_AHEAD);
+            Float3 direction = { ahead.x - eye.x, ahead.y - eye.y, ahead.z - eye.z };
+            float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+            if (lap == 0) pathLength += length;
+            if (length > 0.0f) {
+                cameraAngleY = atan2f(direction.x, -direction.z) * 180.0f / 3.14159f;
+                cameraAngleX = -asinf(direction.y / length) * 180.0f / 3.14159f;
+            }
+            cameraX = eye.x;
+            cameraY = eye.y;
+            cameraZ = eye.z;
+
+            for (int i = 0; i < 2000; ++i) {
+                worldStreamer.Update(eye, stopped);
+                const WorldStreamer::Stats& stats = worldStreamer.GetStats();
+                if (stats.queuedLoads == 0 && stats.missingChunks == 0) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            AllocationTracker::BeginFrame();
+            auto start = std::chrono::steady_clock::now();
+            if (useGL) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glLoadIdentity();
+                glRotatef(cameraAngleX, 1.0f, 0.0f, 0.0f);
+                glRotatef(cameraAngleY, 0.0f, 1.0f, 0.0f);
+                glTranslatef(-cameraX, -cameraY, -cameraZ);
+            }
+            {
+                MemoryTagScope tag(MemoryTag::Render);
+                drawScene(backend);
+            }
+            if (useGL) glFinish();
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            const AllocationTracker::FrameStats& stats = AllocationTracker::EndFrame();
+            if (measured) {
+                frameTimes[frame] = std::min(frameTimes[frame], milliseconds);
+                allocations += stats.allocations - stats.tags[static_cast<size_t>(MemoryTag::Untagged)].allocations;
+            }
+        }
+    }
+    worldStreamer.Shutdown();
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    auto percentile = [&frameTimes](double quantile) {
+        return frameTimes[static_cast<size_t>(quantile * (frameTimes.size() - 1))];
+    };
+    double measuredFrames = static_cast<double>(FRAMES_PER_LAP) * LAPS;
+    result.scene = scene;
+    result.values[0] = percentile(0.50);
+    result.values[1] = percentile(0.95);
+    result.values[2] = percentile(0.99);
+    result.values[3] = frameTimes.back();
+    result.values[4] = backend.GetDraws() / measuredFrames;
+    result.values[5] = backend.GetTriangles() / measuredFrames;
+    result.values[6] = static_cast<double>(allocations);
+    printf("%-6s %5.0f m  %6.3f  %6.3f  %6.3f  %6.3f  %8.0f  %10.0f  %11llu\n", scene, pathLength, result.values[0],
+           result.values[1], result.values[2], result.values[3], result.values[4], result.values[5],
+           static_cast<unsigned long long>(allocations));
+    return true;
+}
+
+// Frame-time regression gate: flies scripted paths through a dense prop field
+// and a large open map, then either records the results as the baseline or
+// fails when any metric exceeds its baseline by more than the margin. Frame
+// times also get TIME_SLACK_MS, so sub-millisecond noise cannot fail the run,
+// and the single worst frame is reported but not gated.
+// With gl the frames are drawn too (LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe);
+// GL and headless results need baselines of their own.
+#if defined(FPSGAME_HAVE_EGL)
+// A pbuffer-backed compatibility context on Mesa's surfaceless platform
+bool createOffscreenContext(int width, int height) {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (!getPlatformDisplay) return false;
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) return false;
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) return false;
+    if (!eglBindAPI(EGL_OPENGL_API)) return false;
+
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+        return false;
+    }
+    // GLUT is never initialized, so it cannot resolve entry points
+    glProcLoader = eglGetProcAddress;
+    return true;
+}
+#endif
+
+int runFlythrough(const char* baselinePath, bool record, double margin, RenderMode mode, int argc, char** argv) {
+    const char* PROP_FIELD_PATH = "flythrough_props.world";
+    const char* OPEN_MAP_PATH = "flythrough_open.world";
+    const double TIME_SLACK_MS = 0.1;
+
+    if (!generatePropField(PROP_FIELD_PATH) || !generateWorld(OPEN_MAP_PATH, 2048.0f)) {
+        printf("Failed to write the flythrough worlds\n");
+        return 1;
+    }
+    const int WIDTH = 800;
+    const int HEIGHT = 600;
+    const bool useGL = mode != RENDER_NONE;
+
+    // Allocations are a gated metric, so a build that cannot count them must not pass
+    if (!AllocationTracker::IsEnabled()) {
+        printf("FAILED: allocation tracking is compiled out; build with FPSGAME_TRACK_ALLOCATIONS\n");
+        return 1;
+    }
+    if (mode == RENDER_WINDOW) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(WIDTH, HEIGHT);
+        glutCreateWindow("FPS Game flythrough");
+    } else if (mode == RENDER_OFFSCREEN) {
+#if defined(FPSGAME_HAVE_EGL)
+        bool created = createOffscreenContext(WIDTH, HEIGHT);
+#else
+        bool created = false;
+#endif
+        if (!created) {
+            printf("FAILED: could not create an offscreen EGL context\n");
+            return 1;
+        }
+    }
+    if (useGL) {
+        init();
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        gluPerspective(fieldOfView, static_cast<float>(WIDTH) / HEIGHT, nearPlane, farPlane);
+        glMatrixMode(GL_MODELVIEW);
+        printf("renderer: %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    }
+    jobSystem.Initialize();
+    occlusionCuller.Initialize();
+    buildFloorMesh(floorMesh);
+    aspectRatio = static_cast<float>(WIDTH) / HEIGHT;
+    lodSelector.SetProjection(fieldOfView * 3.14159f / 180.0f, static_cast<float>(HEIGHT));
+    lodSelector.SetThreshold(LOD_PIXEL_ERROR);
+
+    // Weaving through the props at head height, then a low pass and a climb over the open map
+    const std::vector<Float3> propPath = {
+        { -90.0f, 1.7f, -90.0f }, { 0.0f, 1.7f, -70.0f }, { 90.0f, 1.7f, -90.0f }, { 70.0f, 1.7f, 0.0f },
+        { 90.0f, 1.7f, 90.0f }, { 0.0f, 1.7f, 70.0f }, { -90.0f, 1.7f, 90.0f }, { -70.0f, 1.7f, 0.0f }
+    };
+    const std::vector<Float3> openPath = {
+        { -800.0f, 1.7f, -800.0f }, { 0.0f, 3.0f, -600.0f }, { 800.0f, 40.0f, -800.0f },
+        { 600.0f, 10.0f, 0.0f }, { 800.0f, 1.7f, 800.0f }, { -600.0f, 25.0f, 600.0f }
+    };
+
+    printf("%s, %u worker threads\n", RENDER_MODE_NAMES[mode], jobSystem.GetThreadCount());
+    printf("scene  path     p50 ms  p95 ms  p99 ms  max ms  draws/f  triangles/f  allocations\n");
+    FlythroughResult results[2];
+    bool ran = runFlythroughScene("props", PROP_FIELD_PATH, propPath, useGL, results[0]) &&
+               runFlythroughScene("open", OPEN_MAP_PATH, openPath, useGL, results[1]);
+    std::remove(PROP_FIELD_PATH);
+    std::remove(OPEN_MAP_PATH);
+    if (!ran) return 1;
+
+    if (record) {
+        FILE* file = fopen(baselinePath, "w");
+        if (!file) {
+            printf("Could not write %s\n", baselinePath);
+            return 1;
+        }
+        fprintf(file, "# scene metric value, from FlythroughGate --record %s\n", RENDER_MODE_NAMES[mode]);
+        for (const FlythroughResult& result : results) {
+            for (size_t metric = 0; metric < FLYTHROUGH_METRIC_COUNT; ++metric) {
+                fprintf(file, "%s %s %.6g\n", result.scene, FLYTHROUGH_METRICS[metric], result.values[metric]);
+            }
+        }
+        bool written = fclose(file) == 0;
+        printf("%s baseline %s\n", written ? "Wrote" : "Could not write", baselinePath);
+        return written ? 0 : 1;
+    }
+
+    FILE* file = fopen(baselinePath, "r");
+    if (!file) {
+        printf("Could not read baseline %s; write one with --record\n", baselinePath);
+        return 1;
+    }
+    double baseline[2][FLYTHROUGH_METRIC_COUNT];
+    bool found[2][FLYTHROUGH_METRIC_COUNT] = {};
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char scene[64], metric[64];
+        double value;
+        if (line[0] == '#' || sscanf(line, "%63s %63s %lf", scene, metric, &value) != 3) continue;
+        for (size_t s = 0; s < 2; ++s) {
+            for (size_t m = 0; m < FLYTHROUGH_METRIC_COUNT; ++m) {
+                if (strcmp(scene, results[s].scene) == 0 && strcmp(metric, FLYTHROUGH_METRICS[m]) == 0) {
+                    baseline[s][m] = value;
+                    found[s][m] = true;
+                }
+            }
+        }
+    }
+    fclose(file);
+
+    printf("\nmargin %.0f%% over %s\n", margin * 100.0, baselinePath);
+    int regressions = 0;
+    for (size_t s = 0; s < 2; ++s) {
+        for (size_t m = 0; m < FLYTHROUGH_METRIC_COUNT; ++m) {
+            if (!found[s][m]) {
+                printf("  %-6s %-11s %12.3f  (no baseline)\n", results[s].scene, FLYTHROUGH_METRICS[m], results[s].values[m]);
+                continue;
+            }
+            if (m == FLYTHROUGH_MAX_METRIC) {
+                printf("  %-6s %-11s %12.3f  baseline %12.3f  (not gated)\n", results[s].scene, FLYTHROUGH_METRICS[m],
+                       results[s].values[m], baseline[s][m]);
+                continue;
+            }
+            double limit = baseline[s][m] * (1.0 + margin);
+            if (m < FLYTHROUGH_MAX_METRIC) limit = std::max(limit, baseline[s][m] + TIME_SLACK_MS);
+            bool regressed = results[s].values[m] > limit;
+            if (regressed) regressions++;
+            printf("  %-6s %-11s %12.3f  baseline %12.3f  limit %12.3f  %s\n", results[s].scene, FLYTHROUGH_METRICS[m],
+                   results[s].values[m], baseline[s][m], limit, regressed ? "REGRESSED" : "ok");
+        }
+    }
+    if (regressions > 0) {
+        printf("FAILED: %d metrics over the baseline\n", regressions);
+        return 1;
+    }
+    printf("OK: every metric within the baseline\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    bool record = argc > 1 && strcmp(argv[1], "--record") == 0;
+    int first = record ? 2 : 1;
+    if (first >= argc) {
+        printf("usage: %s [--record] <baseline> [margin] [gl|offscreen]\n", argv[0]);
+        return 1;
+    }
+
+    double margin = 0.2;
+    RenderMode mode = RENDER_NONE;
+    for (int i = first + 1; i < argc; ++i) {
+        if (strcmp(argv[i], "gl") == 0) {
+            mode = RENDER_WINDOW;
+        } else if (strcmp(argv[i], "offscreen") == 0) {
+            mode = RENDER_OFFSCREEN;
+        } else if (atof(argv[i]) > 0.0) {
+            margin = atof(argv[i]);
+        }
+    }
+    return runFlythrough(argv[first], record, margin, mode, argc, argv);
+}
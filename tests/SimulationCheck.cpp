@@ -0,0 +1,144 @@
+#include <cfenv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Simulation.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+// Cross-build determinism gate for gameplay, run by ctest:
+//   SimulationCheck <checksums>
+//   SimulationCheck --record <checksums> [ticks]
+// Plays a scripted match of eight bots and compares the gameplay checksum after
+// every tick with the checked-in recording, which any build or compiler must
+// reproduce exactly.
+
+// Scripted input for the simulation checks: each bot's commands come from its own
+// integer LCG, so a run is fully described by the bot count and tick count
+void scriptBotCommands(uint32_t tick, std::vector<uint32_t>& seeds, std::vector<Simulation::PlayerCommand>& commands) {
+    for (size_t bot = 0; bot < commands.size(); ++bot) {
+        Simulation::PlayerCommand& command = commands[bot];
+        auto next = [&]() {
+            seeds[bot] = seeds[bot] * 1664525u + 1013904223u;
+            return seeds[bot] >> 8;
+        };
+        // Hold a direction for half a second at a time
+        if (tick % 30 == 0) {
+            command.forward = static_cast<int8_t>(static_cast<int>(next() % 3) - 1);
+            command.right = static_cast<int8_t>(static_cast<int>(next() % 3) - 1);
+        }
+        command.lookX = static_cast<int16_t>(static_cast<int>(next() % 41) - 20);
+        command.lookY = static_cast<int16_t>(static_cast<int>(next() % 9) - 4);
+        command.buttons = 0;
+        if (next() % 4 != 0) command.buttons |= Simulation::BUTTON_FIRE;
+        if (next() % 90 == 0) command.buttons |= Simulation::BUTTON_JUMP;
+    }
+}
+
+// Runs the scripted match, collecting the checksum after every tick. With a hostile
+// caller environment (flush-to-zero, round toward zero) set around the run, the
+// simulation's own environment has to be what decides the results.
+double runScriptedMatch(uint32_t ticks, bool hostileEnvironment, std::vector<uint64_t>& checksums) {
+    const uint32_t BOTS = 8;
+    Simulation simulation;
+    simulation.Initialize(BOTS);
+    std::vector<uint32_t> seeds(BOTS);
+    for (uint32_t bot = 0; bot < BOTS; ++bot) seeds[bot] = 0x9E3779B9u * (bot + 1);
+    std::vector<Simulation::PlayerCommand> commands(BOTS, Simulation::PlayerCommand{});
+    checksums.resize(ticks);
+
+    int rounding = fegetround();
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int controlStatus = _mm_getcsr();
+#endif
+    if (hostileEnvironment) {
+        fesetround(FE_TOWARDZERO);
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_setcsr(controlStatus | 0x8040);   // Flush-to-zero and denormals-are-zero
+#endif
+    }
+    double milliseconds = 0.0;
+    for (uint32_t tick = 0; tick < ticks; ++tick) {
+        scriptBotCommands(tick, seeds, commands);
+        auto start = std::chrono::high_resolution_clock::now();
+        simulation.Step(commands.data());
+        auto end = std::chrono::high_resolution_clock::now();
+        milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        checksums[tick] = simulation.Checksum();
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_setcsr(controlStatus);
+#endif
+    fesetround(rounding);
+
+    uint32_t kills = 0;
+    for (uint32_t bot = 0; bot < BOTS; ++bot) kills += simulation.GetPlayer(bot).kills;
+    if (!hostileEnvironment) printf("%u bots, %u ticks: %u kills\n", BOTS, ticks, kills);
+    return milliseconds;
+}
+
+// Recording writes one checksum per tick; verifying replays the same match and
+// names the first tick that differs, so two builds (or compilers) can be compared
+int runSimulationCheck(const char* recordPath, const char* verifyPath, uint32_t ticks) {
+    std::vector<uint64_t> expected;
+    if (verifyPath) {
+        FILE* file = fopen(verifyPath, "r");
+        if (!file) {
+            printf("cannot open %s\n", verifyPath);
+            return 1;
+        }
+        unsigned long long checksum = 0;
+        while (fscanf(file, "%llx", &checksum) == 1) expected.push_back(checksum);
+        fclose(file);
+        if (expected.empty()) {
+            printf("%s holds no checksums\n", verifyPath);
+            return 1;
+        }
+        ticks = static_cast<uint32_t>(expected.size());
+    }
+
+    std::vector<uint64_t> checksums, hostile;
+    double milliseconds = runScriptedMatch(ticks, false, checksums);
+    runScriptedMatch(ticks, true, hostile);
+    printf("%.3f us per tick, %.0f ticks/s, final checksum %016llx\n", milliseconds * 1000.0 / ticks,
+           ticks * 1000.0 / milliseconds, static_cast<unsigned long long>(checksums.back()));
+    bool stable = checksums == hostile;
+    printf("caller's float environment changed: %s\n", stable ? "identical" : "DIFFERENT");
+
+    if (recordPath) {
+        FILE* file = fopen(recordPath, "w");
+        if (!file) {
+            printf("cannot write %s\n", recordPath);
+            return 1;
+        }
+        for (uint64_t checksum : checksums) fprintf(file, "%016llx\n", static_cast<unsigned long long>(checksum));
+        fclose(file);
+        printf("wrote %u checksums to %s\n", ticks, recordPath);
+    }
+    if (verifyPath) {
+        uint32_t mismatch = 0;
+        while (mismatch < ticks && checksums[mismatch] == expected[mismatch]) ++mismatch;
+        if (mismatch < ticks) {
+            printf("%s: first mismatch at tick %u\n", verifyPath, mismatch);
+            return 1;
+        }
+        printf("%s: all %u ticks match\n", verifyPath, ticks);
+    }
+    return stable ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "--record") == 0) {
+        uint32_t ticks = argc > 3 ? static_cast<uint32_t>(strtoul(argv[3], nullptr, 10)) : 0;
+        return runSimulationCheck(argv[2], nullptr, ticks > 0 ? ticks : 10800);
+    }
+    if (argc == 2) {
+        return runSimulationCheck(nullptr, argv[1], 0);
+    }
+    printf("usage: SimulationCheck <checksums> | SimulationCheck --record <checksums> [ticks]\n");
+    return 1;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "VertexFormats.h"
+
+// Packed vertex format gate, run by ctest:
+//   VertexLayoutCheck <hlsli>
+//   VertexLayoutCheck --write <hlsli>
+// Fails if a packed attribute loses more precision than its limit or the
+// checked-in shader declarations no longer match SceneVertexLayout; --write
+// regenerates them.
+
+// The scene format's declarations as written to shaders/VertexLayout.hlsli
+std::string sceneVertexHlsl() {
+    return "// Generated from SceneVertexLayout in src/VertexFormats.h by VertexLayoutCheck --write; do not edit\n\n" +
+           SceneVertexLayout::GetHlslDeclarations();
+}
+
+// Headless check of the packed vertex formats: sizes against the unpacked
+// vertices they replaced, worst-case quantization error, and whether the
+// checked-in shader declarations still match the layout they came from
+int runVertexLayoutCheck(const char* hlslPath, bool write) {
+    struct Format {
+        const char* name;
+        uint32_t packed;
+        uint32_t unpacked;
+    };
+    const Format formats[] = {
+        { "scene", SceneVertexLayout::STRIDE, 40 },
+        { "ui", UIVertexLayout::STRIDE, 36 },
+        { "particle", ParticleVertexLayout::STRIDE, 28 }
+    };
+    printf("format    bytes  was  saved\n");
+    for (const Format& format : formats) {
+        printf("%-8s  %5u  %3u  %4.0f%%\n", format.name, format.packed, format.unpacked,
+               100.0 * (format.unpacked - format.packed) / format.unpacked);
+    }
+
+    // Normals spread evenly over the sphere, plus the axes and the octahedron's seams
+    SceneVertexLayout::Vertex vertex;
+    double worstNormalDegrees = 0.0;
+    const uint32_t NORMAL_SAMPLES = 200000;
+    auto checkNormal = [&](Float3 normal) {
+        vertex.Set<VertexSemantic::Normal>(normal);
+        Float3 decoded = vertex.Get<VertexSemantic::Normal>();
+        // acos of a float dot product cannot resolve angles this small
+        double cx = static_cast<double>(normal.y) * decoded.z - static_cast<double>(normal.z) * decoded.y;
+        double cy = static_cast<double>(normal.z) * decoded.x - static_cast<double>(normal.x) * decoded.z;
+        double cz = static_cast<double>(normal.x) * decoded.y - static_cast<double>(normal.y) * decoded.x;
+        double dot = static_cast<double>(normal.x) * decoded.x + static_cast<double>(normal.y) * decoded.y +
+                     static_cast<double>(normal.z) * decoded.z;
+        double degrees = atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / M_PI;
+        worstNormalDegrees = std::max(worstNormalDegrees, degrees);
+    };
+    for (uint32_t i = 0; i < NORMAL_SAMPLES; ++i) {
+        float z = 1.0f - 2.0f * (i + 0.5f) / NORMAL_SAMPLES;
+        float radius = sqrtf(std::max(0.0f, 1.0f - z * z));
+        float angle = 2.39996323f * i;
+        checkNormal({ radius * cosf(angle), radius * sinf(angle), z });
+    }
+    const Float3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+                            { 0.70710678f, 0.70710678f, 0 }, { -0.70710678f, 0, -0.70710678f }, { 0, 0.70710678f, -0.70710678f } };
+    for (const Float3& axis : axes) checkNormal(axis);
+
+    // Every 8-bit level must round-trip to within half a step
+    double worstColor = 0.0;
+    for (int level = 0; level <= 1000; ++level) {
+        float value = level / 1000.0f;
+        vertex.Set<VertexSemantic::Color>({ value, value, value, value });
+        worstColor = std::max(worstColor, static_cast<double>(fabsf(vertex.Get<VertexSemantic::Color>().x - value)));
+    }
+
+    // Half-float UVs must hit every texel edge of the atlas sizes the UI uses exactly
+    UIVertexLayout::Vertex uiVertex;
+    uint32_t inexactUVs = 0;
+    for (int size = 64; size <= 2048; size *= 2) {
+        for (int texel = 0; texel <= size; ++texel) {
+            float u = static_cast<float>(texel) / size;
+            uiVertex.Set<VertexSemantic::TexCoord>({ u, 1.0f - u });
+            Float2 decoded = uiVertex.Get<VertexSemantic::TexCoord>();
+            if (decoded.x != u || decoded.y != 1.0f - u) inexactUVs++;
+        }
+    }
+
+    printf("normal error   %.4f degrees (limit %.2f)\n", worstNormalDegrees, 0.01);
+    printf("color error    %.5f (limit %.5f)\n", worstColor, 0.5 / 255.0 + 1e-6);
+    printf("inexact UVs    %u\n", inexactUVs);
+    bool ok = worstNormalDegrees <= 0.01 && worstColor <= 0.5 / 255.0 + 1e-6 && inexactUVs == 0;
+
+    std::string expected = sceneVertexHlsl();
+    if (write) {
+        FILE* file = fopen(hlslPath, "wb");
+        if (!file || fwrite(expected.data(), 1, expected.size(), file) != expected.size()) {
+            if (file) fclose(file);
+            printf("FAILED: could not write %s\n", hlslPath);
+            return 1;
+        }
+        fclose(file);
+        printf("Wrote %s\n", hlslPath);
+    } else {
+        std::string existing;
+        if (FILE* file = fopen(hlslPath, "rb")) {
+            char buffer[4096];
+            size_t read;
+            while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) existing.append(buffer, read);
+            fclose(file);
+        }
+        if (existing != expected) {
+            printf("FAILED: %s does not match SceneVertexLayout; rerun with --write\n", hlslPath);
+            return 1;
+        }
+        printf("%s matches SceneVertexLayout\n", hlslPath);
+    }
+
+    if (!ok) {
+        printf("FAILED: quantization error over the limit\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--write") == 0) {
+        return runVertexLayoutCheck(argv[2], true);
+    }
+    if (argc == 2) {
+        return runVertexLayoutCheck(argv[1], false);
+    }
+    printf("usage: VertexLayoutCheck [--write] <hlsli>\n");
+    return 1;
+}
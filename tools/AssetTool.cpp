@@ -0,0 +1,702 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "JobSystem.h"
+#include "MathTypes.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "TextureCooker.h"
+#include "TextureFile.h"
+#include "VertexFormats.h"
+
+// Offline asset conversion, kept out of the game binary:
+//   AssetTool --convert-mesh <input.obj> <output.mesh> [compress]
+//   AssetTool --mesh-optimize-benchmark
+//   AssetTool --cook-texture <input.tga> <output.tex> [format] [linear|normal]
+//   AssetTool --texture-benchmark [size]
+
+JobSystem jobSystem;
+
+using SceneVertex = SceneVertexLayout::Vertex;
+
+// Deduplicates a triangle soup, builds its LOD chain, orders every level for
+// the vertex cache and overdraw, then orders the vertices by first use
+MeshAsset buildMeshAsset(const std::vector<SceneVertex>& soup) {
+    uint32_t soupCount = static_cast<uint32_t>(soup.size());
+    std::vector<uint32_t> remap(soupCount);
+    uint32_t unique = MeshOptimizer::GenerateVertexRemap(remap.data(), nullptr, 0, soup.data(), soupCount, sizeof(SceneVertex));
+    std::vector<SceneVertex> vertices(unique);
+    MeshOptimizer::RemapVertexBuffer(vertices.data(), soup.data(), soupCount, sizeof(SceneVertex), remap.data());
+    std::vector<uint32_t> indices(remap.begin(), remap.end());
+
+    std::vector<Float3> positions(unique);
+    for (uint32_t i = 0; i < unique; ++i) positions[i] = vertices[i].Get<VertexSemantic::Position>();
+    MeshAsset mesh;
+    mesh.chain = MeshSimplifier::BuildLodChain(positions.data(), unique, indices.data(), static_cast<uint32_t>(indices.size()));
+    MeshOptimizer::OptimizeLodChain(mesh.chain, positions.data(), unique);
+
+    // LOD 0 comes first in the chain, so its vertices are the front of the buffer
+    uint32_t used = MeshOptimizer::GenerateVertexFetchRemap(remap.data(), mesh.chain.indices.data(),
+                                                            static_cast<uint32_t>(mesh.chain.indices.size()), unique);
+    MeshOptimizer::RemapIndexBuffer(mesh.chain.indices.data(), mesh.chain.indices.data(),
+                                    static_cast<uint32_t>(mesh.chain.indices.size()), remap.data());
+    mesh.elements.assign(SceneVertexLayout::ELEMENTS.begin(), SceneVertexLayout::ELEMENTS.end());
+    mesh.stride = SceneVertexLayout::STRIDE;
+    mesh.vertices.resize(static_cast<size_t>(used) * mesh.stride);
+    MeshOptimizer::RemapVertexBuffer(mesh.vertices.data(), vertices.data(), unique, mesh.stride, remap.data());
+    return mesh;
+}
+
+// Wavefront OBJ as a triangle soup of scene vertices. OBJ is right handed
+// with counter-clockwise front faces, so z is negated and each triangle
+// reversed for the D3D11 renderer; faces without normals get flat ones.
+bool loadObjMesh(const char* path, std::vector<SceneVertex>& soup) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    std::vector<Float3> positions, normals;
+    std::vector<int> corners;  // Position and normal index pairs of the current face, zero based
+    char line[1024];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        if (line[0] == 'v' && line[1] == ' ') {
+            Float3 p = {};
+            ok = sscanf(line + 2, "%f %f %f", &p.x, &p.y, &p.z) == 3;
+            positions.push_back({ p.x, p.y, -p.z });
+        } else if (line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
+            Float3 n = {};
+            ok = sscanf(line + 3, "%f %f %f", &n.x, &n.y, &n.z) == 3;
+            normals.push_back({ n.x, n.y, -n.z });
+        } else if (line[0] == 'f' && line[1] == ' ') {
+            corners.clear();
+            for (char* token = strtok(line + 2, " \t\r\n"); token; token = strtok(nullptr, " \t\r\n")) {
+                // p, p/t, p//n or p/t/n; negative indices count back from the end
+                int position = atoi(token), normal = 0;
+                char* slash = strchr(token, '/');
+                if (slash && (slash = strchr(slash + 1, '/'))) normal = atoi(slash + 1);
+                position = position < 0 ? static_cast<int>(positions.size()) + position : position - 1;
+                normal = normal < 0 ? static_cast<int>(normals.size()) + normal : normal - 1;
+                if (position < 0 || position >= static_cast<int>(positions.size()) || normal >= static_cast<int>(normals.size())) {
+                    ok = false;
+                    break;
+                }
+                corners.insert(corners.end(), { position, normal });
+            }
+
+            // Fan triangulation, wound the other way round after the z flip
+            for (size_t i = 2; ok && i < corners.size() / 2; ++i) {
+                const int triangle[3] = { 0, static_cast<int>(i), static_cast<int>(i - 1) };
+                const Float3& a = positions[corners[0]];
+                const Float3& b = positions[corners[i * 2]];
+                const Float3& c = positions[corners[(i - 1) * 2]];
+                Float3 ab = { b.x - a.x, b.y - a.y, b.z - a.z }, ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+                Float3 flat = { ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x };
+                for (int corner : triangle) {
+                    SceneVertex vertex;
+                    int normal = corners[corner * 2 + 1];
+                    vertex.Set<VertexSemantic::Position>(positions[corners[corner * 2]]);
+                    vertex.Set<VertexSemantic::Color>({ 1.0f, 1.0f, 1.0f, 1.0f });
+                    vertex.Set<VertexSemantic::Normal>(normal >= 0 ? normals[normal] : flat);
+                    soup.push_back(vertex);
+                }
+            }
+        }
+    }
+    fclose(file);
+    return ok && !soup.empty();
+}
+
+// The binary asset conversion step for meshes: OBJ in, optimized MeshFile out
+int convertMesh(const char* inputPath, const char* outputPath, bool compressIndices) {
+    std::vector<SceneVertex> soup;
+    if (!loadObjMesh(inputPath, soup)) {
+        printf("FAILED: could not read %s\n", inputPath);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    MeshAsset mesh = buildMeshAsset(soup);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!MeshFile::Write(outputPath, mesh, compressIndices)) {
+        printf("FAILED: could not write %s\n", outputPath);
+        return 1;
+    }
+
+    // Read it back, so a broken file never reaches the game
+    MeshAsset check;
+    if (!MeshFile::Read(outputPath, check) || check.vertices != mesh.vertices || check.chain.indices != mesh.chain.indices) {
+        printf("FAILED: %s does not read back\n", outputPath);
+        return 1;
+    }
+
+    const MeshLod& lod0 = mesh.chain.lods[0];
+    const uint32_t* indices = &mesh.chain.indices[lod0.firstIndex];
+    uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size() / mesh.stride);
+    MeshOptimizer::VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(indices, lod0.indexCount, vertexCount);
+    printf("%s: %u triangles, %zu corners merged into %u vertices of %u bytes, %zu LODs, built in %.1f ms\n",
+           outputPath, lod0.indexCount / 3, soup.size(), vertexCount, mesh.stride, mesh.chain.lods.size(), milliseconds);
+    printf("LOD 0 ACMR %.3f ATVR %.3f%s\n", cache.acmr, cache.atvr, compressIndices ? ", indices compressed" : "");
+    return 0;
+}
+
+// Test meshes with outward normals, each a soup of triangles wound clockwise from outside
+void addMeshTriangle(std::vector<SceneVertex>& soup, Float3 a, Float3 b, Float3 c, Float3 normalA, Float3 normalB,
+                     Float3 normalC, const Float4& color) {
+    Float3 ab = { b.x - a.x, b.y - a.y, b.z - a.z }, ac = { c.x - a.x, c.y - a.y, c.z - a.z };
+    Float3 face = { ab.y * ac.z - ab.z * ac.y, ab.z * ac.x - ab.x * ac.z, ab.x * ac.y - ab.y * ac.x };
+    Float3 normal = { normalA.x + normalB.x + normalC.x, normalA.y + normalB.y + normalC.y, normalA.z + normalB.z + normalC.z };
+    if (face.x * normal.x + face.y * normal.y + face.z * normal.z < 0.0f) {
+        std::swap(b, c);
+        std::swap(normalB, normalC);
+    }
+    const Float3 positions[3] = { a, b, c };
+    const Float3 normals[3] = { normalA, normalB, normalC };
+    for (int i = 0; i < 3; ++i) {
+        SceneVertex vertex;
+        vertex.Set<VertexSemantic::Position>(positions[i]);
+        vertex.Set<VertexSemantic::Color>(color);
+        vertex.Set<VertexSemantic::Normal>(normals[i]);
+        soup.push_back(vertex);
+    }
+}
+
+// A surface sampled on a rows x columns grid, wrapping in u and optionally v
+template <typename Surface>
+void addMeshGrid(std::vector<SceneVertex>& soup, int rows, int columns, bool wrapV, const Float4& color, Surface surface) {
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            Float3 p[4], n[4];
+            const int offsets[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+            for (int i = 0; i < 4; ++i) {
+                float u = static_cast<float>(column + offsets[i][0]) / columns;
+                float v = wrapV ? static_cast<float>((row + offsets[i][1]) % rows) / rows
+                                : static_cast<float>(row + offsets[i][1]) / rows;
+                surface(u, v, p[i], n[i]);
+            }
+            addMeshTriangle(soup, p[0], p[1], p[2], n[0], n[1], n[2], color);
+            addMeshTriangle(soup, p[0], p[2], p[3], n[0], n[2], n[3], color);
+        }
+    }
+}
+
+// Headless check of the mesh optimizer on test meshes in exporter order:
+// a triangle soup with its triangles shuffled, deduplicated as is
+int runMeshOptimizeBenchmark() {
+    const float PI = 3.14159265f;
+    const Float4 white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    struct TestMesh {
+        const char* name;
+        std::vector<SceneVertex> soup;
+    };
+    std::vector<TestMesh> meshes(4);
+
+    meshes[0].name = "terrain";
+    addMeshGrid(meshes[0].soup, 96, 96, false, white, [](float u, float v, Float3& p, Float3& n) {
+        float x = u * 192.0f, z = v * 192.0f;
+        p = { x, 6.0f * sinf(x * 0.05f) * cosf(z * 0.07f), z };
+        n = { 0.0f, 1.0f, 0.0f };
+    });
+
+    meshes[1].name = "rock";
+    addMeshGrid(meshes[1].soup, 64, 128, false, white, [PI](float u, float v, Float3& p, Float3& n) {
+        float theta = u * 2.0f * PI, phi = v * PI;
+        Float3 direction = { sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) };
+        float radius = 1.0f + 0.15f * sinf(direction.x * 5.0f) * cosf(direction.y * 4.0f + direction.z * 3.0f);
+        p = { direction.x * radius, direction.y * radius, direction.z * radius };
+        n = direction;
+    });
+
+    // A (2, 3) torus knot: the tube passes in front of itself, so order matters for overdraw
+    meshes[2].name = "knot";
+    addMeshGrid(meshes[2].soup, 16, 512, true, white, [PI](float u, float v, Float3& p, Float3& n) {
+        auto curve = [](float t) {
+            float r = 2.0f + cosf(3.0f * t);
+            return Float3{ r * cosf(2.0f * t), sinf(3.0f * t), r * sinf(2.0f * t) };
+        };
+        float t = u * 2.0f * PI;
+        Float3 center = curve(t), ahead = curve(t + 0.001f);
+        Float3 tangent = { ahead.x - center.x, ahead.y - center.y, ahead.z - center.z };
+        Float3 side = { tangent.z, 0.0f, -tangent.x };
+        float sideLength = sqrtf(side.x * side.x + side.z * side.z);
+        side = { side.x / sideLength, 0.0f, side.z / sideLength };
+        Float3 up = { tangent.y * side.z - tangent.z * side.y, tangent.z * side.x - tangent.x * side.z,
+                      tangent.x * side.y - tangent.y * side.x };
+        float upLength = sqrtf(up.x * up.x + up.y * up.y + up.z * up.z);
+        float angle = v * 2.0f * PI;
+        n = { (side.x * cosf(angle) + up.x / upLength * sinf(angle)), (up.y / upLength * sinf(angle)),
+              (side.z * cosf(angle) + up.z / upLength * sinf(angle)) };
+        p = { center.x + 0.4f * n.x, center.y + 0.4f * n.y, center.z + 0.4f * n.z };
+    });
+
+    // A crate pile: flat-shaded boxes, so corners split at every edge
+    meshes[3].name = "crates";
+    for (int i = 0; i < 8 * 8 * 4; ++i) {
+        Float3 center = { static_cast<float>(i % 8) * 1.1f, static_cast<float>(i / 64) * 1.1f, static_cast<float>(i / 8 % 8) * 1.1f };
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float sign = -1.0f; sign <= 1.0f; sign += 2.0f) {
+                float normal[3] = { 0.0f, 0.0f, 0.0f };
+                normal[axis] = sign;
+                Float3 corners[4];
+                for (int corner = 0; corner < 4; ++corner) {
+                    float offset[3];
+                    offset[axis] = 0.5f * sign;
+                    offset[(axis + 1) % 3] = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+                    offset[(axis + 2) % 3] = corner >= 2 ? 0.5f : -0.5f;
+                    corners[corner] = { center.x + offset[0], center.y + offset[1], center.z + offset[2] };
+                }
+                Float3 n = { normal[0], normal[1], normal[2] };
+                addMeshTriangle(meshes[3].soup, corners[0], corners[1], corners[2], n, n, n, white);
+                addMeshTriangle(meshes[3].soup, corners[0], corners[2], corners[3], n, n, n, white);
+            }
+        }
+    }
+
+    // Triangles as sorted byte strings, rotated to start at their smallest corner, so orders can be compared
+    auto canonicalTriangles = [](const SceneVertex* vertices, const uint32_t* indices, uint32_t indexCount) {
+        std::vector<std::string> triangles;
+        for (uint32_t t = 0; t < indexCount; t += 3) {
+            std::string corners[3];
+            for (int i = 0; i < 3; ++i) {
+                corners[i].assign(reinterpret_cast<const char*>(vertices[indices[t + i]].bytes), sizeof(SceneVertex));
+            }
+            int first = corners[0] <= corners[1] && corners[0] <= corners[2] ? 0 : (corners[1] <= corners[2] ? 1 : 2);
+            triangles.push_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+
+    printf("mesh      order       tris   verts   ACMR   ATVR  overdraw  overfetch  index KB  ms\n");
+    bool ok = true;
+    uint32_t seed = 12345u;
+    for (TestMesh& test : meshes) {
+        // Exporter order: triangles shuffled
+        uint32_t triangleCount = static_cast<uint32_t>(test.soup.size() / 3);
+        for (uint32_t t = triangleCount - 1; t > 0; --t) {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t other = (seed >> 8) % (t + 1);
+            std::swap_ranges(test.soup.begin() + t * 3, test.soup.begin() + t * 3 + 3, test.soup.begin() + other * 3);
+        }
+
+        uint32_t soupCount = static_cast<uint32_t>(test.soup.size());
+        std::vector<uint32_t> remap(soupCount);
+        uint32_t unique = MeshOptimizer::GenerateVertexRemap(remap.data(), nullptr, 0, test.soup.data(), soupCount, sizeof(SceneVertex));
+        std::vector<SceneVertex> vertices(unique);
+        MeshOptimizer::RemapVertexBuffer(vertices.data(), test.soup.data(), soupCount, sizeof(SceneVertex), remap.data());
+        std::vector<uint32_t> indices(remap.begin(), remap.end());
+        std::vector<Float3> positions(unique);
+        for (uint32_t i = 0; i < unique; ++i) positions[i] = vertices[i].Get<VertexSemantic::Position>();
+
+        auto report = [&](const char* order, const std::vector<Float3>& meshPositions, const std::vector<uint32_t>& meshIndices,
+                          double milliseconds) {
+            uint32_t indexCount = static_cast<uint32_t>(meshIndices.size());
+            MeshOptimizer::VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(meshIndices.data(), indexCount, unique);
+            MeshOptimizer::OverdrawStats overdraw = MeshOptimizer::AnalyzeOverdraw(meshIndices.data(), indexCount,
+                                                                                   meshPositions.data(), unique);
+            MeshOptimizer::VertexFetchStats fetch = MeshOptimizer::AnalyzeVertexFetch(meshIndices.data(), indexCount, unique,
+                                                                                      sizeof(SceneVertex));
+            std::vector<uint8_t> encoded;
+            MeshOptimizer::EncodeIndexBuffer(encoded, meshIndices.data(), indexCount);
+            std::vector<uint32_t> decoded(indexCount);
+            ok = ok && MeshOptimizer::DecodeIndexBuffer(decoded.data(), indexCount, encoded.data(), encoded.size()) &&
+                 decoded == meshIndices;
+            printf("%-8s  %-9s  %6u  %6u  %5.3f  %5.3f  %8.3f  %9.3f  %4.0f>%-4.0f  %5.1f\n", test.name, order, indexCount / 3,
+                   unique, cache.acmr, cache.atvr, overdraw.overdraw, fetch.overfetch, indexCount * 4.0 / 1024.0,
+                   encoded.size() / 1024.0, milliseconds);
+            return std::make_pair(cache, overdraw);
+        };
+        printf("%-8s  %-9s  %6u  %6u\n", test.name, "soup", triangleCount, soupCount);
+        auto exporter = report("exporter", positions, indices, 0.0);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> cacheOrder(indices.size()), optimized(indices.size());
+        MeshOptimizer::OptimizeVertexCache(cacheOrder.data(), indices.data(), static_cast<uint32_t>(indices.size()), unique);
+        MeshOptimizer::OptimizeOverdraw(optimized.data(), cacheOrder.data(), static_cast<uint32_t>(cacheOrder.size()),
+                                        positions.data(), unique);
+        MeshOptimizer::GenerateVertexFetchRemap(remap.data(), optimized.data(), static_cast<uint32_t>(optimized.size()), unique);
+        MeshOptimizer::RemapIndexBuffer(optimized.data(), optimized.data(), static_cast<uint32_t>(optimized.size()), remap.data());
+        std::vector<SceneVertex> fetchOrder(unique);
+        std::vector<Float3> fetchPositions(unique);
+        MeshOptimizer::RemapVertexBuffer(fetchOrder.data(), vertices.data(), unique, sizeof(SceneVertex), remap.data());
+        MeshOptimizer::RemapVertexBuffer(fetchPositions.data(), positions.data(), unique, sizeof(Float3), remap.data());
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto result = report("optimized", fetchPositions, optimized, milliseconds);
+
+        // Same triangles, same winding, and no worse on either measure
+        bool same = canonicalTriangles(vertices.data(), indices.data(), static_cast<uint32_t>(indices.size())) ==
+                    canonicalTriangles(fetchOrder.data(), optimized.data(), static_cast<uint32_t>(optimized.size()));
+        if (!same) printf("FAILED: %s triangles changed\n", test.name);
+        if (result.first.acmr > exporter.first.acmr || result.second.overdraw > exporter.second.overdraw) {
+            printf("FAILED: %s got worse\n", test.name);
+            same = false;
+        }
+        ok = ok && same;
+    }
+
+    if (!ok) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("OK: same triangles, better cache and overdraw order, indices round-trip\n");
+    return 0;
+}
+
+// Uncompressed or run-length encoded 24/32-bit TGA, the usual texture exporter output
+bool loadTgaImage(const char* path, TextureImage& image) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + read);
+    fclose(file);
+
+    if (data.size() < 18) return false;
+    uint8_t idLength = data[0], colorMapType = data[1], imageType = data[2], bitsPerPixel = data[16], descriptor = data[17];
+    uint32_t width = data[12] | (data[13] << 8), height = data[14] | (data[15] << 8);
+    bool rle = imageType == 10;
+    if (colorMapType != 0 || (imageType != 2 && !rle) || (bitsPerPixel != 24 && bitsPerPixel != 32) || width == 0 ||
+        height == 0 || width > TextureFile::MAX_DIMENSION || height > TextureFile::MAX_DIMENSION) {
+        return false;
+    }
+
+    // Pixels in file order, BGR(A)
+    uint32_t bytesPerPixel = bitsPerPixel / 8;
+    size_t pixelCount = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> pixels(pixelCount * bytesPerPixel);
+    size_t cursor = 18 + idLength;
+    if (!rle) {
+        if (cursor + pixels.size() > data.size()) return false;
+        memcpy(pixels.data(), &data[cursor], pixels.size());
+    } else {
+        for (size_t pixel = 0; pixel < pixelCount;) {
+            if (cursor >= data.size()) return false;
+            uint8_t packet = data[cursor++];
+            size_t count = (packet & 0x7F) + 1u;
+            bool repeat = (packet & 0x80) != 0;
+            size_t bytes = (repeat ? 1 : count) * bytesPerPixel;
+            if (pixel + count > pixelCount || cursor + bytes > data.size()) return false;
+            for (size_t i = 0; i < count; ++i) {
+                memcpy(&pixels[(pixel + i) * bytesPerPixel], &data[cursor + (repeat ? 0 : i * bytesPerPixel)], bytesPerPixel);
+            }
+            pixel += count;
+            cursor += bytes;
+        }
+    }
+
+    // Rows are stored bottom up unless descriptor bit 5 is set
+    bool topDown = (descriptor & 0x20) != 0;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(pixelCount * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* row = &pixels[static_cast<size_t>(topDown ? y : height - 1 - y) * width * bytesPerPixel];
+        for (uint32_t x = 0; x < width; ++x) {
+            const uint8_t* source = row + x * bytesPerPixel;
+            uint8_t* destination = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+            destination[0] = source[2];
+            destination[1] = source[1];
+            destination[2] = source[0];
+            destination[3] = bytesPerPixel == 4 ? source[3] : 255;
+        }
+    }
+    return true;
+}
+
+bool parseTextureFormat(const char* name, TextureFormat& format) {
+    const char* names[TEXTURE_FORMAT_COUNT] = { "rgba8", "bc1", "bc3", "bc5", "bc7" };
+    for (uint32_t i = 0; i < TEXTURE_FORMAT_COUNT; ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            format = static_cast<TextureFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int cookTexture(const char* inputPath, const char* outputPath, TextureFormat format, uint32_t flags) {
+    TextureImage source;
+    if (!loadTgaImage(inputPath, source)) {
+        printf("FAILED: could not read %s\n", inputPath);
+        return 1;
+    }
+
+    jobSystem.Initialize();
+    TextureCooker cooker;
+    TextureAsset texture;
+    auto start = std::chrono::steady_clock::now();
+    cooker.Cook(source, format, flags, texture, &jobSystem);
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!TextureFile::Write(outputPath, texture)) {
+        printf("FAILED: could not write %s\n", outputPath);
+        return 1;
+    }
+
+    // Read it back, so a broken file never reaches the game
+    TextureAsset check;
+    if (!TextureFile::Read(outputPath, check) || check.mips != texture.mips) {
+        printf("FAILED: %s does not read back\n", outputPath);
+        return 1;
+    }
+
+    uint64_t bytes = 0, uncompressedBytes = 0;
+    for (uint32_t level = 0; level < texture.mips.size(); ++level) {
+        bytes += texture.mips[level].size();
+        uncompressedBytes += TextureFile::GetLevelSize(TEXTURE_RGBA8, TextureFile::GetMipDimension(source.width, level),
+                                                       TextureFile::GetMipDimension(source.height, level));
+    }
+    TextureImage decoded;
+    TextureCooker::Decode(texture.mips[0].data(), source.width, source.height, format, decoded);
+    printf("%s: %ux%u, %zu mips, %.1f KB (%.1f%% of RGBA8), cooked in %.1f ms on %u threads\n", outputPath, source.width,
+           source.height, texture.mips.size(), bytes / 1024.0, 100.0 * bytes / uncompressedBytes, milliseconds,
+           jobSystem.GetThreadCount());
+    printf("level 0 PSNR %.2f dB\n", TextureCooker::MeasurePsnr(source, decoded, TextureCooker::GetChannelMask(format)));
+    return 0;
+}
+
+// Smooth value noise in [0, 1] with a period of cells, so test textures tile
+float textureNoise(float x, float y, uint32_t cells, uint32_t seed) {
+    auto lattice = [&](uint32_t ix, uint32_t iy) {
+        uint32_t h = (ix % cells) * 73856093u ^ (iy % cells) * 19349663u ^ seed * 83492791u;
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        return static_cast<float>(h & 0xFFFF) / 65535.0f;
+    };
+    float fx = x * cells, fy = y * cells;
+    uint32_t ix = static_cast<uint32_t>(fx), iy = static_cast<uint32_t>(fy);
+    float tx = fx - ix, ty = fy - iy;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    ty = ty * ty * (3.0f - 2.0f * ty);
+    float top = lattice(ix, iy) + (lattice(ix + 1, iy) - lattice(ix, iy)) * tx;
+    float bottom = lattice(ix, iy + 1) + (lattice(ix + 1, iy + 1) - lattice(ix, iy + 1)) * tx;
+    return top + (bottom - top) * ty;
+}
+
+float textureFractal(float x, float y, uint32_t seed) {
+    float sum = 0.0f, amplitude = 0.5f;
+    for (uint32_t octave = 0; octave < 5; ++octave, amplitude *= 0.5f) {
+        sum += textureNoise(x, y, 4u << octave, seed + octave) * amplitude;
+    }
+    return sum / 0.96875f;
+}
+
+// Headless check of the texture cooker on procedural textures: gamma-correct
+// mips, every block format on one and all threads, quality against the source
+// mips, and the streaming file round trip
+int runTextureBenchmark(uint32_t size) {
+    auto toByte = [](float value) { return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    struct TestTexture {
+        const char* name;
+        uint32_t flags;
+        std::vector<TextureFormat> formats;
+        TextureImage image;
+    };
+    std::vector<TestTexture> textures(3);
+
+    // Bricks with mortar and weathering: sharp edges over smooth variation
+    textures[0].name = "albedo";
+    textures[0].flags = TEXTURE_SRGB;
+    textures[0].formats = { TEXTURE_BC1, TEXTURE_BC7 };
+    textures[0].image = { size, size, std::vector<uint8_t>(static_cast<size_t>(size) * size * 4) };
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            float u = static_cast<float>(x) / size, v = static_cast<float>(y) / size;
+            float row = v * 16.0f, column = u * 8.0f + (static_cast<int>(row) % 2) * 0.5f;
+            bool mortar = row - floorf(row) < 0.08f || column - floorf(column) < 0.04f;
+            float grain = textureFractal(u, v, 1);
+            float brick = textureNoise(floorf(column) / 8.0f, floorf(row) / 16.0f, 16, 2);
+            uint8_t* pixel = &textures[0].image.pixels[(static_cast<size_t>(y) * size + x) * 4];
+            if (mortar) {
+                pixel[0] = pixel[1] = pixel[2] = toByte(0.55f + 0.2f * grain);
+            } else {
+                pixel[0] = toByte(0.45f + 0.25f * brick + 0.2f * grain);
+                pixel[1] = toByte(0.18f + 0.1f * brick + 0.15f * grain);
+                pixel[2] = toByte(0.12f + 0.1f * grain);
+            }
+            pixel[3] = 255;
+        }
+    }
+
+    // Soft-edged translucent blobs on an odd size, so the three-tap filter runs
+    uint32_t decalWidth = size * 3 / 4 + 1, decalHeight = size / 2 + 3;
+    textures[1].name = "decal";
+    textures[1].flags = TEXTURE_SRGB;
+    textures[1].formats = { TEXTURE_BC3, TEXTURE_BC7 };
+    textures[1].image = { decalWidth, decalHeight, std::vector<uint8_t>(static_cast<size_t>(decalWidth) * decalHeight * 4) };
+    for (uint32_t y = 0; y < decalHeight; ++y) {
+        for (uint32_t x = 0; x < decalWidth; ++x) {
+            float u = static_cast<float>(x) / decalWidth, v = static_cast<float>(y) / decalHeight;
+            float shape = textureFractal(u, v, 3);
+            float alpha = std::min(std::max((shape - 0.45f) * 8.0f, 0.0f), 1.0f);
+            uint8_t* pixel = &textures[1].image.pixels[(static_cast<size_t>(y) * decalWidth + x) * 4];
+            pixel[0] = toByte(0.2f + 0.7f * u);
+            pixel[1] = toByte(0.8f * shape);
+            pixel[2] = toByte(0.3f + 0.5f * v);
+            pixel[3] = toByte(alpha);
+        }
+    }
+
+    // Tangent-space normals of a bumpy height field
+    textures[2].name = "normal";
+    textures[2].flags = TEXTURE_NORMAL_MAP;
+    textures[2].formats = { TEXTURE_BC5 };
+    textures[2].image = { size, size, std::vector<uint8_t>(static_cast<size_t>(size) * size * 4) };
+    {
+        std::vector<float> height(static_cast<size_t>(size) * size);
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                height[static_cast<size_t>(y) * size + x] = textureFractal(static_cast<float>(x) / size, static_cast<float>(y) / size, 4);
+            }
+        }
+        float strength = size / 16.0f;
+        for (uint32_t y = 0; y < size; ++y) {
+            for (uint32_t x = 0; x < size; ++x) {
+                float dx = height[static_cast<size_t>(y) * size + (x + 1) % size] - height[static_cast<size_t>(y) * size + (x + size - 1) % size];
+                float dy = height[static_cast<size_t>((y + 1) % size) * size + x] - height[static_cast<size_t>((y + size - 1) % size) * size + x];
+                float n[3] = { -dx * strength, -dy * strength, 1.0f };
+                float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                uint8_t* pixel = &textures[2].image.pixels[(static_cast<size_t>(y) * size + x) * 4];
+                for (int c = 0; c < 3; ++c) pixel[c] = toByte(n[c] / length * 0.5f + 0.5f);
+                pixel[3] = 255;
+            }
+        }
+    }
+
+    // Minimum level 0 PSNR per format, in dB
+    const double PSNR_FLOOR[TEXTURE_FORMAT_COUNT] = { 0.0, 33.0, 33.0, 40.0, 38.0 };
+    const char* FORMAT_NAMES[TEXTURE_FORMAT_COUNT] = { "RGBA8", "BC1", "BC3", "BC5", "BC7" };
+
+    jobSystem.Initialize();
+    uint32_t threads = jobSystem.GetThreadCount();
+    TextureCooker cooker;
+    printf("texture  size       mips ms (scalar/simd)  format  1 thread MP/s  %2u threads MP/s  per core  PSNR L0  PSNR L1  KB\n",
+           threads);
+    bool ok = true;
+    for (TestTexture& test : textures) {
+        const TextureImage& source = test.image;
+
+        // Scalar and SIMD filtering must agree exactly, as must one and many threads
+        std::vector<TextureImage> mips, scalarMips;
+        cooker.SetSimdEnabled(false);
+        auto start = std::chrono::steady_clock::now();
+        cooker.GenerateMips(source, test.flags, scalarMips);
+        double scalarMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cooker.SetSimdEnabled(true);
+        start = std::chrono::steady_clock::now();
+        cooker.GenerateMips(source, test.flags, mips);
+        double simdMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::vector<TextureImage> parallelMips;
+        cooker.GenerateMips(source, test.flags, parallelMips, &jobSystem);
+        for (size_t level = 0; level < mips.size(); ++level) {
+            if (mips[level].pixels != scalarMips[level].pixels || mips[level].pixels != parallelMips[level].pixels) {
+                printf("FAILED: %s mip %zu differs between paths\n", test.name, level);
+                ok = false;
+            }
+        }
+
+        uint64_t pixelCount = 0;
+        for (const TextureImage& level : mips) pixelCount += static_cast<uint64_t>(level.width) * level.height;
+        double megapixels = pixelCount / 1e6;
+
+        for (TextureFormat format : test.formats) {
+            std::vector<std::vector<uint8_t>> serial, parallel;
+            start = std::chrono::steady_clock::now();
+            TextureCooker::EncodeLevels(mips, format, serial);
+            double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            TextureCooker::EncodeLevels(mips, format, parallel, &jobSystem);
+            double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (serial != parallel) {
+                printf("FAILED: %s %s differs between one and %u threads\n", test.name, FORMAT_NAMES[format], threads);
+                ok = false;
+            }
+
+            // Each level against the uncompressed mip it was encoded from
+            uint32_t channels = TextureCooker::GetChannelMask(format);
+            double psnr[2] = {};
+            uint64_t bytes = 0;
+            for (size_t level = 0; level < mips.size(); ++level) {
+                if (level < 2) {
+                    TextureImage decoded;
+                    TextureCooker::Decode(parallel[level].data(), mips[level].width, mips[level].height, format, decoded);
+                    psnr[level] = TextureCooker::MeasurePsnr(mips[level], decoded, channels);
+                }
+                bytes += parallel[level].size();
+            }
+            double levelZero = psnr[0];
+            if (levelZero < PSNR_FLOOR[format]) {
+                printf("FAILED: %s %s PSNR %.2f dB is under %.0f dB\n", test.name, FORMAT_NAMES[format], levelZero, PSNR_FLOOR[format]);
+                ok = false;
+            }
+
+            // Streaming file round trip, smallest levels first in the file
+            const char* TEXTURE_PATH = "texture_benchmark.tex";
+            TextureAsset texture = { format, test.flags, source.width, source.height, parallel };
+            TextureAsset check;
+            bool roundTrip = TextureFile::Write(TEXTURE_PATH, texture) && TextureFile::Read(TEXTURE_PATH, check) &&
+                             check.mips == texture.mips && check.flags == texture.flags;
+            TextureFile file;
+            if (!roundTrip || !file.Open(TEXTURE_PATH) ||
+                file.GetMipEntry(file.GetHeader().mipCount - 1).offset > file.GetMipEntry(0).offset) {
+                printf("FAILED: %s %s does not round-trip through %s\n", test.name, FORMAT_NAMES[format], TEXTURE_PATH);
+                ok = false;
+            }
+            file.Close();
+            remove(TEXTURE_PATH);
+
+            printf("%-7s  %4ux%-4u  %5.1f/%-5.1f            %-6s  %13.1f  %16.1f  %8.1f  %7.2f  %7.2f  %.0f\n", test.name,
+                   source.width, source.height, scalarMilliseconds, simdMilliseconds, FORMAT_NAMES[format],
+                   megapixels / serialSeconds, megapixels / parallelSeconds, megapixels / parallelSeconds / threads,
+                   psnr[0], psnr[1], bytes / 1024.0);
+        }
+    }
+
+    if (!ok) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("OK: identical mips and blocks on every path, PSNR above the per-format floor, files round-trip\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--mesh-optimize-benchmark") == 0) {
+            return runMeshOptimizeBenchmark();
+        }
+        if (strcmp(argv[i], "--convert-mesh") == 0 && i + 2 < argc) {
+            bool compress = i + 3 < argc && strcmp(argv[i + 3], "compress") == 0;
+            return convertMesh(argv[i + 1], argv[i + 2], compress);
+        }
+        if (strcmp(argv[i], "--texture-benchmark") == 0) {
+            uint32_t size = (i + 1 < argc) ? static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10)) : 1024;
+            return runTextureBenchmark(size >= 16 ? size : 1024);
+        }
+        if (strcmp(argv[i], "--cook-texture") == 0 && i + 2 < argc) {
+            TextureFormat format = TEXTURE_BC7;
+            uint32_t flags = TEXTURE_SRGB;
+            for (int j = i + 3; j < argc; ++j) {
+                if (strcmp(argv[j], "linear") == 0) {
+                    flags = 0;
+                } else if (strcmp(argv[j], "normal") == 0) {
+                    flags = TEXTURE_NORMAL_MAP;
+                } else if (!parseTextureFormat(argv[j], format)) {
+                    printf("Unknown texture option %s\n", argv[j]);
+                    return 1;
+                }
+            }
+            return cookTexture(argv[i + 1], argv[i + 2], format, flags);
+        }
+    }
+    printf("usage: %s --convert-mesh <input.obj> <output.mesh> [compress] | --mesh-optimize-benchmark |\n"
+           "       --cook-texture <input.tga> <output.tex> [format] [linear|normal] | --texture-benchmark [size]\n", argv[0]);
+    return 1;
+}